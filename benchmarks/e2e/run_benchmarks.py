@@ -0,0 +1,266 @@
+"""@package docstring
+run_benchmarks: end-to-end performance benchmarks over the examples
+
+Runs fixed-length versions of the Frank-Read source, binary junction and
+strain hardening examples with the pydis, exadis and mixed pipelines and
+records per case the steps/s, the time per phase (pydis profiler), the
+peak RSS and the final node/segment counts to a JSON file. With a
+baseline file the steps/s are compared against it and slowdowns beyond
+the tolerance are reported.
+
+Every case runs in its own python process (peak RSS is per process, and
+the examples keep module globals); cases whose backend cannot be
+imported are recorded as skipped. The example scripts are run unchanged:
+their SimulateNetwork class is replaced by a subclass that fixes the
+number of steps and turns plotting, printing and output off.
+
+Usage:
+    python3 run_benchmarks.py [--cases NAME ...] [--steps N]
+                              [--output results.json]
+                              [--baseline baseline.json] [--tolerance 0.1]
+                              [--save-baseline] [--fail-on-regression]
+"""
+import argparse
+import datetime
+import importlib.util
+import json
+import os
+import platform
+import resource
+import subprocess
+import sys
+import time
+
+REPO_ROOT = os.path.abspath(os.path.join(os.path.dirname(__file__), '..', '..'))
+EXAMPLES_DIR = os.path.join(REPO_ROOT, 'examples')
+RESULT_MARKER = 'BENCHMARK_RESULT '
+
+# script: example run unchanged with its SimulateNetwork made fixed length
+# entry:  function of the script running the example
+# argv:   command line arguments of the script
+# exadis: pyexadis.initialize()/finalize() are called around the entry
+# builder: function of this file building the case instead of a script
+CASES = {
+    "frank_read_pydis": {
+        "script": "02_frank_read_src/test_frank_read_src_pydis.py", "backend": "pydis"},
+    "frank_read_exadis": {
+        "script": "02_frank_read_src/test_frank_read_src_exadis.py", "backend": "exadis", "exadis": True},
+    "frank_read_mixed": {
+        "script": "02_frank_read_src/test_frank_read_src_pydis_exadis.py", "argv": ["1"],
+        "backend": "mixed", "exadis": True},
+    "binary_junction_pydis": {
+        "script": "03_binary_junction/test_binary_junction_pydis.py", "backend": "pydis"},
+    "binary_junction_exadis": {
+        "script": "03_binary_junction/test_binary_junction_exadis.py", "backend": "exadis", "exadis": True},
+    "strain_hardening_pydis": {
+        "dir": "10_strain_hardening", "builder": "strain_hardening_pydis", "backend": "pydis"},
+    "strain_hardening_exadis": {
+        "script": "10_strain_hardening/test_strain_hardening_exadis.py",
+        "entry": "example_fcc_Cu_15um_1e3", "backend": "exadis"},
+}
+
+DEFAULT_STEPS = 20
+
+
+def fixed_length(cls, max_step: int, record: dict):
+    """fixed_length: subclass of a SimulateNetwork class running max_step
+    steps without plots, prints or output, timing its run into record
+    """
+    class FixedLength(cls):
+        def __init__(self, *args, **kwargs):
+            kwargs.update(max_step=max_step, print_freq=None, plot_freq=None, write_freq=None)
+            try:
+                from pydis import SimulateNetwork as PyDiS_SimulateNetwork
+                if issubclass(cls, PyDiS_SimulateNetwork):
+                    kwargs["profile"] = True
+            except ImportError:
+                pass
+            super().__init__(*args, **kwargs)
+
+        def run(self, DM, state):
+            t0 = time.perf_counter()
+            result = super().run(DM, state)
+            elapsed = time.perf_counter() - t0
+            record["wall_time"] = record.get("wall_time", 0.0) + elapsed
+            record["steps"] = record.get("steps", 0) + max_step
+            profiler = getattr(self, "profiler", None)
+            if hasattr(profiler, "results"):
+                record["profile"] = profiler.results()
+            try:
+                record["num_nodes"] = DM.num_nodes()
+                record["num_segments"] = DM.num_segments()
+            except Exception:
+                pass
+            return result
+
+    FixedLength.__name__ = cls.__name__
+    return FixedLength
+
+
+def strain_hardening_pydis(max_step: int, record: dict):
+    """strain_hardening_pydis: 10_strain_hardening initial configuration
+    (ParaDiS data file, native loader) with the pydis modules; SimpleGlide
+    stands in for the FCC_0 mobility law, which pydis does not have
+    """
+    import numpy as np
+    from framework.disnet_manager import DisNetManager
+    from pydis import DisNet, CellList, CalForce, MobilityLaw, TimeIntegration
+    from pydis import Topology, Collision, Remesh, SimulateNetwork
+
+    state = {"burgmag": 2.55e-10, "mu": 54.6e9, "nu": 0.324, "a": 6.0,
+             "maxseg": 2000.0, "minseg": 300.0, "rann": 10.0}
+    net = DisNetManager(DisNet())
+    net.read_paradis('180chains_16.10e.data')
+    nbrlist = CellList(cell=net.cell, n_div=[8,8,8])
+
+    calforce  = CalForce(force_mode='Elasticity_SBA', state=state)
+    mobility  = MobilityLaw(mobility_law='SimpleGlide', state=state)
+    timeint   = TimeIntegration(integrator='EulerForward', dt=1.0e-10, state=state)
+    topology  = Topology(split_mode='MaxDiss', state=state, force=calforce, mobility=mobility)
+    collision = Collision(collision_mode='Proximity', state=state, nbrlist=nbrlist)
+    remesh    = Remesh(remesh_rule='LengthBased', state=state)
+
+    sim = fixed_length(SimulateNetwork, max_step, record)(
+        calforce=calforce, mobility=mobility, timeint=timeint, topology=topology,
+        collision=collision, remesh=remesh, state=state, loading_mode="stress",
+        applied_stress=np.array([0.0, 0.0, 1.0e8, 0.0, 0.0, 0.0]))
+    sim.run(net, state)
+
+
+def run_case(name: str, max_step: int) -> dict:
+    """run_case: run one case in this process and return its record
+    """
+    case = CASES[name]
+    record = {"case": name, "backend": case["backend"], "status": "ok"}
+    case_dir = os.path.join(EXAMPLES_DIR, os.path.dirname(case["script"]) if "script" in case else case["dir"])
+    os.chdir(case_dir)
+    for path in ('python', 'lib', 'core/pydis/python', 'core/exadis/python'):
+        path = os.path.join(REPO_ROOT, path)
+        if path not in sys.path:
+            sys.path.append(path)
+
+    try:
+        if "builder" in case:
+            globals()[case["builder"]](max_step, record)
+        else:
+            script = os.path.join(EXAMPLES_DIR, case["script"])
+            sys.argv = [script] + case.get("argv", [])
+            spec = importlib.util.spec_from_file_location("benchmark_case", script)
+            module = importlib.util.module_from_spec(spec)
+            spec.loader.exec_module(module)
+            for attr in ("SimulateNetwork", "SimulateNetworkPerf"):
+                if isinstance(getattr(module, attr, None), type):
+                    setattr(module, attr, fixed_length(getattr(module, attr), max_step, record))
+            entry = getattr(module, case.get("entry", "main"))
+            if case.get("exadis"):
+                module.pyexadis.initialize()
+            try:
+                entry()
+            finally:
+                if case.get("exadis"):
+                    module.pyexadis.finalize()
+    except ImportError as e:
+        return {"case": name, "backend": case["backend"], "status": "skipped", "reason": str(e)}
+
+    if record.get("wall_time", 0.0) > 0.0:
+        record["steps_per_s"] = record["steps"] / record["wall_time"]
+    # ru_maxrss is in kilobytes on Linux (bytes on macOS)
+    maxrss = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss
+    record["peak_rss_mb"] = maxrss / (1024.0*1024.0 if sys.platform == 'darwin' else 1024.0)
+    return record
+
+
+def run_child(name: str, max_step: int, timeout: float) -> dict:
+    """run_child: run one case in a new python process
+    """
+    command = [sys.executable, os.path.abspath(__file__), "--child", name, "--steps", str(max_step)]
+    try:
+        proc = subprocess.run(command, capture_output=True, text=True, timeout=timeout)
+    except subprocess.TimeoutExpired:
+        return {"case": name, "backend": CASES[name]["backend"], "status": "timeout"}
+    for line in reversed(proc.stdout.splitlines()):
+        if line.startswith(RESULT_MARKER):
+            return json.loads(line[len(RESULT_MARKER):])
+    return {"case": name, "backend": CASES[name]["backend"], "status": "failed",
+            "returncode": proc.returncode, "stderr": proc.stderr[-2000:]}
+
+
+def compare(results: dict, baseline: dict, tolerance: float) -> list:
+    """compare: cases whose steps/s dropped by more than tolerance against the baseline
+    """
+    regressions = []
+    for name, record in results["cases"].items():
+        base = baseline.get("cases", {}).get(name)
+        if base is None or record.get("status") != "ok" or base.get("status") != "ok":
+            continue
+        if "steps_per_s" not in record or not base.get("steps_per_s"):
+            continue
+        ratio = record["steps_per_s"] / base["steps_per_s"]
+        record["baseline_ratio"] = ratio
+        if ratio < 1.0 - tolerance:
+            regressions.append((name, ratio))
+    return regressions
+
+
+def print_summary(results: dict) -> None:
+    print("%-26s %-8s %-8s %10s %10s %8s %8s %8s" % ("case", "backend", "status", "steps/s",
+                                                   "rss (MB)", "nodes", "segs", "vs base"))
+    for name, r in results["cases"].items():
+        print("%-26s %-8s %-8s %10s %10s %8s %8s %8s" % (
+            name, r.get("backend", ""), r.get("status", ""),
+            "%.3f" % r["steps_per_s"] if "steps_per_s" in r else "-",
+            "%.1f" % r["peak_rss_mb"] if "peak_rss_mb" in r else "-",
+            r.get("num_nodes", "-"), r.get("num_segments", "-"),
+            "%.3f" % r["baseline_ratio"] if "baseline_ratio" in r else "-"))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="End-to-end benchmarks over the examples")
+    parser.add_argument("--cases", nargs="+", choices=sorted(CASES), default=sorted(CASES))
+    parser.add_argument("--steps", type=int, default=DEFAULT_STEPS, help="time steps per case")
+    parser.add_argument("--output", default="benchmark_results.json")
+    parser.add_argument("--baseline", default=None, help="baseline results to compare against")
+    parser.add_argument("--tolerance", type=float, default=0.1, help="allowed relative steps/s drop")
+    parser.add_argument("--save-baseline", action="store_true", help="also write the results to --baseline")
+    parser.add_argument("--fail-on-regression", action="store_true")
+    parser.add_argument("--timeout", type=float, default=3600.0, help="seconds per case")
+    parser.add_argument("--child", default=None, help=argparse.SUPPRESS)
+    args = parser.parse_args()
+
+    if args.child is not None:
+        record = run_case(args.child, args.steps)
+        sys.stdout.flush()
+        print(RESULT_MARKER + json.dumps(record))
+        return 0
+
+    results = {
+        "meta": {"date": datetime.datetime.now().isoformat(timespec='seconds'),
+                 "host": platform.node(), "platform": platform.platform(),
+                 "python": platform.python_version(), "cpus": os.cpu_count(),
+                 "steps": args.steps},
+        "cases": {},
+    }
+    for name in args.cases:
+        print("running %s ..." % name, flush=True)
+        results["cases"][name] = run_child(name, args.steps, args.timeout)
+
+    regressions = []
+    if args.baseline is not None and os.path.exists(args.baseline) and not args.save_baseline:
+        with open(args.baseline) as f:
+            regressions = compare(results, json.load(f), args.tolerance)
+
+    with open(args.output, 'w') as f:
+        json.dump(results, f, indent=2)
+    if args.save_baseline and args.baseline is not None:
+        with open(args.baseline, 'w') as f:
+            json.dump(results, f, indent=2)
+
+    print_summary(results)
+    for name, ratio in regressions:
+        print("slowdown: %s runs at %.1f%% of the baseline steps/s" % (name, 100.0*ratio))
+
+    return 1 if (regressions and args.fail_on_regression) else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
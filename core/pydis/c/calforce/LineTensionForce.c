@@ -0,0 +1,89 @@
+#include "LineTensionForce.h"
+#include "SegSegForceDriver.h"
+#include "../include/Profile.h"
+
+/**************************************************************************
+ *
+ *      Function:    LineTensionForce
+ *      Description: Peach-Koehler force from a uniform applied stress
+ *                   and line tension self force of every segment, with
+ *                   the nodal forces assembled in the same call.  The
+ *                   PK force (sigext.b) x (R2-R1) is split evenly
+ *                   between the two end nodes; the self force is the
+ *                   DDLab segforcevec.m line tension
+ *                       fs2 = 2 NU/(1-NU) Ec bs be - (bs^2 + be^2/(1-NU)) Ec t
+ *                   on node 2 and -fs2 on node 1, where bs and be are
+ *                   the screw and edge parts of b along the line
+ *                   direction t.  Segments shorter than epsL get no self
+ *                   force.  Segments are processed in parallel.
+ *
+ *      Arguments:
+ *         numNodes     number of nodes
+ *         numSegs      number of segments
+ *         nodeIDs      [numSegs][2] indices of the two end nodes of
+ *                      each segment
+ *         R1, R2       [numSegs][3] positions of the end nodes (R2 must
+ *                      already be the image closest to R1)
+ *         burgers      [numSegs][3] burgers vector of each segment
+ *                      (from node 1 to node 2)
+ *         sigext       3x3 applied stress tensor (row-major)
+ *         NU           poisson ratio
+ *         Ec           core energy parameter of the line tension
+ *         epsL         minimum segment length for the self force
+ *         segForces    [numSegs][6] returned forces on the two end
+ *                      nodes of each segment
+ *         nodeForces   [numNodes][3] returned nodal forces
+ *
+ *************************************************************************/
+void LineTensionForce(int numNodes, int numSegs, int *nodeIDs,
+                      real8 *R1, real8 *R2, real8 *burgers,
+                      real8 *sigext, real8 NU, real8 Ec,
+                      real8 epsL, real8 *segForces, real8 *nodeForces)
+{
+    int   i;
+    real8 omninv;
+
+    ProfileStart(PROFILE_FORCE);
+
+    omninv = 1.0 / (1.0 - NU);
+
+#pragma omp parallel for schedule(static)
+    for (i = 0; i < numSegs; i++) {
+        int   k;
+        real8 *b = &burgers[3*i], *f = &segForces[6*i];
+        real8 dR[3], sigb[3], fpk[3], fs[3] = {0.0, 0.0, 0.0};
+        real8 L, t[3], bs, bev[3], be2, Score, LTcore;
+
+        for (k = 0; k < 3; k++) {
+            dR[k]   = R2[3*i+k] - R1[3*i+k];
+            sigb[k] = sigext[3*k]*b[0] + sigext[3*k+1]*b[1] + sigext[3*k+2]*b[2];
+        }
+
+        fpk[0] = sigb[1]*dR[2] - sigb[2]*dR[1];
+        fpk[1] = sigb[2]*dR[0] - sigb[0]*dR[2];
+        fpk[2] = sigb[0]*dR[1] - sigb[1]*dR[0];
+
+        L = sqrt(dR[0]*dR[0] + dR[1]*dR[1] + dR[2]*dR[2]);
+
+        if (L >= epsL) {
+            for (k = 0; k < 3; k++) t[k] = dR[k] / L;
+            bs = b[0]*t[0] + b[1]*t[1] + b[2]*t[2];
+            for (k = 0; k < 3; k++) bev[k] = b[k] - bs*t[k];
+            be2 = bev[0]*bev[0] + bev[1]*bev[1] + bev[2]*bev[2];
+            Score  = 2.0*NU*omninv*Ec*bs;
+            LTcore = (bs*bs + be2*omninv)*Ec;
+            for (k = 0; k < 3; k++) fs[k] = Score*bev[k] - LTcore*t[k];
+        }
+
+        for (k = 0; k < 3; k++) {
+            f[k]   = 0.5*fpk[k] - fs[k];
+            f[3+k] = 0.5*fpk[k] + fs[k];
+        }
+    }
+
+    AssembleNodeForces(numNodes, numSegs, nodeIDs, segForces, nodeForces);
+
+    ProfileStop(PROFILE_FORCE);
+
+    return;
+}
@@ -0,0 +1,7 @@
+#include <math.h>
+#define real8 double
+
+void LineTensionForce(int numNodes, int numSegs, int *nodeIDs,
+                      real8 *R1, real8 *R2, real8 *burgers,
+                      real8 *sigext, real8 NU, real8 Ec,
+                      real8 epsL, real8 *segForces, real8 *nodeForces);
@@ -0,0 +1,378 @@
+#include "LocalForce.h"
+#include "SegSegForceDriver.h"
+#include "StressDueToSeg.h"
+#include "../include/Error.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/*
+ *      Forces on a few nodes (e.g. the nodes of a trial split or of a
+ *      remesh / collision operation) without a full force evaluation:
+ *      the segments attached to the nodes interact with the segments
+ *      within a cutoff, and the remote segments enter through a
+ *      stress at each node that is computed once and cached by the
+ *      caller (SegStressFarField()).
+ */
+
+/**************************************************************************
+ *
+ *      Function:    SegMidpoints
+ *      Description: Midpoint (with R2 moved to the periodic image
+ *                   closest to R1) and half length of every segment.
+ *
+ *      Returns:  the largest segment length
+ *
+ *************************************************************************/
+static real8 SegMidpoints(int numSegs, real8 *R1, real8 *R2,
+                          real8 *h, real8 *hinv, int *isPeriodic,
+                          real8 *mid, real8 *halfLen)
+{
+    int   i, k;
+    real8 p2[3], dr[3], maxLen = 0.0;
+
+    for (i = 0; i < numSegs; i++) {
+        PBCClosestImage(h, hinv, isPeriodic, &R1[3*i], &R2[3*i], p2);
+        for (k = 0; k < 3; k++) {
+            mid[3*i+k] = 0.5 * (R1[3*i+k] + p2[k]);
+            dr[k] = p2[k] - R1[3*i+k];
+        }
+        halfLen[i] = 0.5 * sqrt(dr[0]*dr[0] + dr[1]*dr[1] + dr[2]*dr[2]);
+        if (2.0*halfLen[i] > maxLen) maxLen = 2.0*halfLen[i];
+    }
+
+    return(maxLen);
+}
+
+
+/**************************************************************************
+ *
+ *      Function:    SegStressFarField
+ *      Description: Stress at a set of field points from the segments
+ *                   that are remote from each point, i.e. whose
+ *                   midpoint (periodic image closest to the point)
+ *                   is farther than cutoff + half the segment length.
+ *                   These are the segments LocalNodeForces() leaves
+ *                   out of the near field of a node at the point.
+ *                   Uses StressDueToSeg(); points are distributed over
+ *                   OpenMP threads.
+ *
+ *      Arguments:
+ *         numPoints    number of field points
+ *         points       [numPoints][3] field point coordinates
+ *         cutoff       near-field cutoff distance
+ *         stress       [numPoints][6] returned stress at each point,
+ *                      in the order xx, yy, zz, xy, yz, xz
+ *         (others)     same as SegSegForceCellList()
+ *
+ *************************************************************************/
+void SegStressFarField(int numPoints, real8 *points,
+                       int numSegs, real8 *R1, real8 *R2, real8 *burgers,
+                       real8 *h, real8 *hinv, int *isPeriodic,
+                       real8 cutoff, real8 a, real8 MU, real8 NU,
+                       real8 *stress)
+{
+    int   p;
+    real8 *mid, *halfLen;
+
+    memset(stress, 0, 6 * numPoints * sizeof(real8));
+
+    if (numPoints <= 0 || numSegs <= 0) return;
+
+    mid     = (real8 *)malloc(3 * numSegs * sizeof(real8));
+    halfLen = (real8 *)malloc(numSegs * sizeof(real8));
+    if (mid == NULL || halfLen == NULL) {
+        free(mid);
+        free(halfLen);
+        ErrorRaise("SegStressFarField: out of memory");
+    }
+
+    SegMidpoints(numSegs, R1, R2, h, hinv, isPeriodic, mid, halfLen);
+
+#pragma omp parallel for schedule(dynamic, 4)
+    for (p = 0; p < numPoints; p++) {
+        int   j, k, m;
+        real8 sigma[6], midj[3], p1[3], p2[3], rmax, r2;
+        real8 *x = &points[3*p];
+
+        for (j = 0; j < numSegs; j++) {
+
+            if (halfLen[j] == 0.0) continue;
+
+            PBCClosestImage(h, hinv, isPeriodic, x, &mid[3*j], midj);
+            r2 = 0.0;
+            for (k = 0; k < 3; k++) {
+                r2 += (midj[k] - x[k]) * (midj[k] - x[k]);
+            }
+            rmax = cutoff + halfLen[j];
+            if (r2 <= rmax*rmax) continue;
+
+/*
+ *          Image of the segment centred at midj
+ */
+            for (k = 0; k < 3; k++) {
+                p1[k] = R1[3*j+k] + (midj[k] - mid[3*j+k]);
+                p2[k] = 2.0*midj[k] - p1[k];
+            }
+
+            StressDueToSeg(x[0], x[1], x[2],
+                           p1[0], p1[1], p1[2],
+                           p2[0], p2[1], p2[2],
+                           burgers[3*j], burgers[3*j+1], burgers[3*j+2],
+                           a, MU, NU, sigma);
+
+            for (m = 0; m < 6; m++) stress[6*p+m] += sigma[m];
+        }
+    }
+
+    free(mid);
+    free(halfLen);
+
+    return;
+}
+
+
+/**************************************************************************
+ *
+ *      Function:    LocalNodeForces
+ *      Description: Forces on the nodes subNodes, in one call, from the
+ *                   segments attached to them.  For a node at x, each
+ *                   attached segment interacts with itself and with the
+ *                   near-field segments, whose midpoint is within
+ *                   cutoff + half their length of x (found with the
+ *                   same cell binning as SegSegForceCellList()), or
+ *                   with all segments if cutoff <= 0.  The remote
+ *                   segments (exactly those of SegStressFarField() at
+ *                   x) and the applied stress enter through subStress:
+ *                   the Peach-Koehler force of the stress at a node on
+ *                   each of its segments is split evenly between the
+ *                   two ends, as for the applied stress in a full
+ *                   evaluation.  With cutoff <= 0 and subStress the
+ *                   applied stress the forces are those of
+ *                   SegSegForceAllPairs() plus the applied stress.
+ *
+ *      Arguments:
+ *         cutoff       near-field cutoff distance, <= 0 for all pairs
+ *         numSub       number of nodes in subNodes
+ *         subNodes     [numSub] indices (as in nodeIDs) of the nodes
+ *                      whose forces are returned (no duplicates)
+ *         subStress    [numSub][6] stress (xx, yy, zz, xy, yz, xz) at
+ *                      each listed node from everything outside the
+ *                      near field, e.g. the applied stress plus
+ *                      SegStressFarField().  May be NULL.
+ *         subForces    [numSub][3] returned nodal forces
+ *         (others)     same as SegSegForceCellList()
+ *
+ *      Returns:  number of segment pairs evaluated.
+ *
+ *************************************************************************/
+int LocalNodeForces(int numNodes, int numSegs, int *nodeIDs,
+                    real8 *R1, real8 *R2, real8 *burgers,
+                    real8 *h, real8 *hinv, int *isPeriodic,
+                    real8 cutoff,
+                    real8 a, real8 MU, real8 NU,
+                    int Nint, real8 *quad_points, real8 *weights,
+                    int numSub, int *subNodes, real8 *subStress,
+                    real8 *subForces)
+{
+    int   i, k, e, n, r, numThreads, numPairs = 0, numArms;
+    int   nCells[3], *cellStart = NULL, *cellSegs = NULL, *segCell = NULL;
+    int   *nodeRank, *arms;
+    real8 maxLen, sigb[3], dr[3], *s, *b;
+    real8 *mid, *halfLen, *armForces, *threadSegForces;
+    SBN1Context_t *sbn1;
+
+    memset(subForces, 0, 3 * numSub * sizeof(real8));
+
+    if (numSub <= 0 || numSegs <= 0) return(0);
+
+    sbn1     = SegSegForceDriverContext(Nint, quad_points, weights, a, MU, NU);
+    nodeRank = (int *)malloc(numNodes * sizeof(int));
+    arms     = (int *)malloc(2 * numSegs * sizeof(int));
+    if (nodeRank == NULL || arms == NULL) {
+        SBN1ContextFree(sbn1);
+        free(nodeRank);
+        free(arms);
+        ErrorRaise("LocalNodeForces: out of memory");
+    }
+
+    for (n = 0; n < numNodes; n++) nodeRank[n] = -1;
+    for (i = 0; i < numSub; i++) {
+        if (subNodes[i] < 0 || subNodes[i] >= numNodes ||
+            nodeRank[subNodes[i]] >= 0) {
+            SBN1ContextFree(sbn1);
+            free(nodeRank);
+            free(arms);
+            ErrorRaise("LocalNodeForces: invalid or duplicate "
+                    "node index %d", subNodes[i]);
+        }
+        nodeRank[subNodes[i]] = i;
+    }
+
+/*
+ *  An arm is a segment end (2*segment + end) at one of the listed nodes
+ */
+    numArms = 0;
+    for (i = 0; i < numSegs; i++) {
+        for (e = 0; e < 2; e++) {
+            if (nodeRank[nodeIDs[2*i+e]] >= 0) arms[numArms++] = 2*i + e;
+        }
+    }
+
+    mid       = (real8 *)malloc(3 * numSegs * sizeof(real8));
+    halfLen   = (real8 *)malloc(numSegs * sizeof(real8));
+    armForces = (real8 *)calloc(3 * (numArms + 1), sizeof(real8));
+    threadSegForces = AllocThreadSegForces(numSegs, &numThreads);
+    if (mid == NULL || halfLen == NULL || armForces == NULL ||
+        threadSegForces == NULL) {
+        SBN1ContextFree(sbn1);
+        free(nodeRank);
+        free(arms);
+        free(mid);
+        free(halfLen);
+        free(armForces);
+        free(threadSegForces);
+        ErrorRaise("LocalNodeForces: out of memory");
+    }
+
+/*
+ *  A near-field segment j of a node of segment i has
+ *  |mid_j - mid_i| <= cutoff + halfLen_j + halfLen_i <= cutoff + maxLen,
+ *  so it is in a neighboring cell of segment i.
+ */
+    if (cutoff > 0.0) {
+        maxLen = SegMidpoints(numSegs, R1, R2, h, hinv, isPeriodic,
+                              mid, halfLen);
+        BinSegmentsInCells(numSegs, mid, hinv, isPeriodic,
+                           cutoff + maxLen, nCells,
+                           &cellStart, &cellSegs, &segCell);
+    }
+
+/*
+ *  Only the forces of a row on its own segment are used, they live in
+ *  the slot of the segment in the thread buffer.  The slot is cleared
+ *  before the row since earlier rows of the thread may have added to
+ *  it as a partner segment.
+ */
+#pragma omp parallel num_threads(numThreads) reduction(+:numPairs)
+    {
+        int   i, j, k, m, d, e, arm, threadID;
+        int   cell[3], nbr[3][3], numNbr[3], ix, iy, iz, c, numJ;
+        int   *jList;
+        real8 dr[3], midj[3], rmax;
+        real8 *x, *fseg;
+
+#ifdef _OPENMP
+        threadID = omp_get_thread_num();
+#else
+        threadID = 0;
+#endif
+        fseg = &threadSegForces[(size_t)threadID * 6 * numSegs];
+        jList = (int *)malloc(numSegs * sizeof(int));
+
+#pragma omp for schedule(dynamic, 1)
+        for (arm = 0; arm < numArms; arm++) {
+
+            i = arms[arm] / 2;
+            e = arms[arm] % 2;
+            x = (e == 0) ? &R1[3*i] : &R2[3*i];
+
+            numJ = 0;
+            jList[numJ++] = i;
+
+            if (cutoff > 0.0) {
+                c = segCell[i];
+                cell[0] = c / (nCells[1]*nCells[2]);
+                cell[1] = (c / nCells[2]) % nCells[1];
+                cell[2] = c % nCells[2];
+
+                for (d = 0; d < 3; d++) {
+                    CellNeighborIndices(cell[d], nCells[d],
+                                        isPeriodic != NULL && isPeriodic[d],
+                                        nbr[d], &numNbr[d]);
+                }
+
+                for (ix = 0; ix < numNbr[0]; ix++) {
+                    for (iy = 0; iy < numNbr[1]; iy++) {
+                        for (iz = 0; iz < numNbr[2]; iz++) {
+                            c = (nbr[0][ix]*nCells[1] + nbr[1][iy])*nCells[2] + nbr[2][iz];
+                            for (m = cellStart[c]; m < cellStart[c+1]; m++) {
+                                j = cellSegs[m];
+                                if (j == i || halfLen[j] == 0.0) continue;
+                                PBCClosestImage(h, hinv, isPeriodic, x,
+                                                &mid[3*j], midj);
+                                for (k = 0; k < 3; k++) dr[k] = midj[k] - x[k];
+                                rmax = cutoff + halfLen[j];
+                                if (dr[0]*dr[0]+dr[1]*dr[1]+dr[2]*dr[2] > rmax*rmax) {
+                                    continue;
+                                }
+                                jList[numJ++] = j;
+                            }
+                        }
+                    }
+                }
+            } else {
+                for (j = 0; j < numSegs; j++) {
+                    if (j != i) jList[numJ++] = j;
+                }
+            }
+
+            numPairs += numJ;
+
+            memset(&fseg[6*i], 0, 6 * sizeof(real8));
+
+            SegSegForceRow(i, numJ, jList, R1, R2, burgers,
+                           h, hinv, isPeriodic, a, MU, NU,
+                           sbn1, NULL, fseg);
+
+            for (k = 0; k < 3; k++) armForces[3*arm+k] = fseg[6*i+3*e+k];
+        }
+
+        free(jList);
+    }
+
+/*
+ *  Assemble the forces on the listed nodes, adding half the
+ *  Peach-Koehler force of the node stress on each arm.
+ */
+    for (k = 0; k < numArms; k++) {
+        i = arms[k] / 2;
+        e = arms[k] % 2;
+        r = nodeRank[nodeIDs[2*i+e]];
+
+        subForces[3*r]   += armForces[3*k];
+        subForces[3*r+1] += armForces[3*k+1];
+        subForces[3*r+2] += armForces[3*k+2];
+
+        if (subStress == NULL) continue;
+
+        b = &burgers[3*i];
+        for (n = 0; n < 3; n++) dr[n] = R2[3*i+n] - R1[3*i+n];
+
+        s = &subStress[6*r];
+        sigb[0] = s[0]*b[0] + s[3]*b[1] + s[5]*b[2];
+        sigb[1] = s[3]*b[0] + s[1]*b[1] + s[4]*b[2];
+        sigb[2] = s[5]*b[0] + s[4]*b[1] + s[2]*b[2];
+
+        subForces[3*r]   += 0.5 * (sigb[1]*dr[2] - sigb[2]*dr[1]);
+        subForces[3*r+1] += 0.5 * (sigb[2]*dr[0] - sigb[0]*dr[2]);
+        subForces[3*r+2] += 0.5 * (sigb[0]*dr[1] - sigb[1]*dr[0]);
+    }
+
+    free(threadSegForces);
+    SBN1ContextFree(sbn1);
+    free(cellStart);
+    free(cellSegs);
+    free(segCell);
+    free(armForces);
+    free(mid);
+    free(halfLen);
+    free(arms);
+    free(nodeRank);
+
+    return(numPairs);
+}
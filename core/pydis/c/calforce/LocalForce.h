@@ -0,0 +1,17 @@
+#include <math.h>
+#define real8 double
+
+void SegStressFarField(int numPoints, real8 *points,
+                       int numSegs, real8 *R1, real8 *R2, real8 *burgers,
+                       real8 *h, real8 *hinv, int *isPeriodic,
+                       real8 cutoff, real8 a, real8 MU, real8 NU,
+                       real8 *stress);
+
+int  LocalNodeForces(int numNodes, int numSegs, int *nodeIDs,
+                     real8 *R1, real8 *R2, real8 *burgers,
+                     real8 *h, real8 *hinv, int *isPeriodic,
+                     real8 cutoff,
+                     real8 a, real8 MU, real8 NU,
+                     int Nint, real8 *quad_points, real8 *weights,
+                     int numSub, int *subNodes, real8 *subStress,
+                     real8 *subForces);
@@ -0,0 +1,257 @@
+#include "NodeStep.h"
+#include "LineTensionForce.h"
+#include "PlasticStrain.h"
+#include "SegSegForceDriver.h"
+#include "../include/Profile.h"
+#include "../include/Error.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:    NodeStep
+ *      Description: Forward Euler step of NodeStepEulerForward(), with
+ *                   the plastic strain increment of the step computed
+ *                   from the segment end points gathered for the forces
+ *                   if dStrain is not NULL (NodeStepEulerForwardStrain).
+ *
+ *------------------------------------------------------------------------*/
+static void NodeStep(int numNodes, int numSegs, int *nodeIDs,
+                     real8 *R, int *constraints, real8 *burgers,
+                     real8 *h, real8 *hinv, int *isPeriodic,
+                     real8 *sigext, int forceMode,
+                     real8 a, real8 MU, real8 NU, real8 Ec,
+                     int Nint, real8 *quad_points, real8 *weights,
+                     int mobilityMode, real8 dt,
+                     real8 *segForces, real8 *nodeForces,
+                     real8 *nodeVels,
+                     real8 *planes, real8 volume, int numSystems,
+                     real8 *sysBurgers, real8 *sysPlanes,
+                     real8 *dStrain, real8 *dSpin, real8 *length,
+                     real8 *sysLength, real8 *sysShear)
+{
+    int         i;
+    real8       *R1, *R2, *pkSegForces;
+    ErrorTrap_t trap;
+
+    if (forceMode != NODE_STEP_FORCE_LINE_TENSION &&
+        forceMode != NODE_STEP_FORCE_ELASTICITY) {
+        ErrorRaise("NodeStepEulerForward: unknown force mode %d",
+                forceMode);
+    }
+
+    if (mobilityMode != NODE_STEP_MOBILITY_RELAX) {
+        ErrorRaise("NodeStepEulerForward: unknown mobility mode %d",
+                mobilityMode);
+    }
+
+    R1 = (real8 *)malloc(3 * (numSegs > 0 ? numSegs : 1) * sizeof(real8));
+    R2 = (real8 *)malloc(3 * (numSegs > 0 ? numSegs : 1) * sizeof(real8));
+    pkSegForces = (real8 *)malloc(6 * (numSegs > 0 ? numSegs : 1) *
+                                  sizeof(real8));
+
+    if (R1 == NULL || R2 == NULL || pkSegForces == NULL) {
+        free(R1);
+        free(R2);
+        free(pkSegForces);
+        ErrorRaise("NodeStepEulerForward: out of memory");
+    }
+
+    ProfileStart(PROFILE_INTEGRATE);
+    ProfileCount(PROFILE_NODES, numNodes);
+
+/*
+ *  An error raised by the force routines unwinds to here, where the
+ *  buffers are released and the phase closed before it is passed on
+ *  to the caller's trap.
+ */
+    ErrorTrapPush(&trap);
+    if (setjmp(trap.env) != 0) {
+        free(R1);
+        free(R2);
+        free(pkSegForces);
+        ProfileStop(PROFILE_INTEGRATE);
+        ErrorPropagate();
+    }
+
+#pragma omp parallel for schedule(static)
+    for (i = 0; i < numSegs; i++) {
+        int k;
+        for (k = 0; k < 3; k++) {
+            R1[3*i+k] = R[3*nodeIDs[2*i]+k];
+        }
+        PBCClosestImage(h, hinv, isPeriodic, &R1[3*i],
+                        &R[3*nodeIDs[2*i+1]], &R2[3*i]);
+    }
+
+/*
+ *  Forces.  LineTensionForce() with Ec = 0 leaves the PK force only,
+ *  which is added to the elastic segment forces.
+ */
+    if (forceMode == NODE_STEP_FORCE_LINE_TENSION) {
+        LineTensionForce(numNodes, numSegs, nodeIDs, R1, R2, burgers,
+                         sigext, NU, Ec, 1.0e-6,
+                         segForces, nodeForces);
+    } else {
+        SegSegForceAllPairs(numNodes, numSegs, nodeIDs, R1, R2, burgers,
+                            h, hinv, isPeriodic, a, MU, NU,
+                            Nint, quad_points, weights, NULL,
+                            segForces, nodeForces);
+        LineTensionForce(numNodes, numSegs, nodeIDs, R1, R2, burgers,
+                         sigext, NU, 0.0, 1.0e-6,
+                         pkSegForces, nodeForces);
+
+#pragma omp parallel for schedule(static)
+        for (i = 0; i < 6*numSegs; i++) {
+            segForces[i] += pkSegForces[i];
+        }
+
+        AssembleNodeForces(numNodes, numSegs, nodeIDs, segForces, nodeForces);
+    }
+
+    ErrorTrapPop(&trap);
+
+/*
+ *  Mobility and position update
+ */
+#pragma omp parallel for schedule(static)
+    for (i = 0; i < numNodes; i++) {
+        int k;
+        for (k = 0; k < 3; k++) {
+            if (constraints[i] == NODE_STEP_PINNED_NODE) {
+                nodeVels[3*i+k] = 0.0;
+            } else {
+                nodeVels[3*i+k] = nodeForces[3*i+k];
+            }
+            R[3*i+k] += dt * nodeVels[3*i+k];
+        }
+    }
+
+/*
+ *  Swept areas of the segments, from their end points at the beginning
+ *  of the step and the node velocities
+ */
+    if (dStrain != (real8 *)NULL) {
+        PlasticStrainIncrement(numSegs, nodeIDs, R1, R2, nodeVels, dt,
+                               burgers, planes, volume, numSystems,
+                               sysBurgers, sysPlanes, dStrain, dSpin,
+                               length, sysLength, sysShear);
+    }
+
+    free(R1);
+    free(R2);
+    free(pkSegForces);
+
+    ProfileStop(PROFILE_INTEGRATE);
+
+    return;
+}
+
+
+/**************************************************************************
+ *
+ *      Function:    NodeStepEulerForward
+ *      Description: Take one forward Euler step of the whole network in
+ *                   a single call: nodal forces, nodal velocities from
+ *                   the mobility law and position update all work on the
+ *                   same contiguous node arrays, without going through
+ *                   per node containers on the python side.
+ *
+ *                   The segment end points are gathered from R with the
+ *                   second node mapped to the image closest to the first.
+ *                   With NODE_STEP_FORCE_LINE_TENSION the forces are those
+ *                   of LineTensionForce(); with NODE_STEP_FORCE_ELASTICITY
+ *                   the Peach-Koehler force is added to the elastic
+ *                   interaction of all segment pairs (SegSegForceAllPairs).
+ *                   NODE_STEP_MOBILITY_RELAX sets the velocity of every
+ *                   node but the pinned ones equal to its force.
+ *
+ *      Arguments:
+ *         numNodes     number of nodes
+ *         numSegs      number of segments
+ *         nodeIDs      [numSegs][2] indices of the two end nodes of
+ *                      each segment
+ *         R            [numNodes][3] node positions, updated in place to
+ *                      R + dt * nodeVels
+ *         constraints  [numNodes] node constraints
+ *         burgers      [numSegs][3] burgers vector of each segment
+ *                      (from node 1 to node 2)
+ *         h, hinv      3x3 cell matrix and its inverse (row-major)
+ *         isPeriodic   3 flags, non-zero for periodic directions
+ *         sigext       3x3 applied stress tensor (row-major)
+ *         forceMode    NODE_STEP_FORCE_*
+ *         a, MU, NU    core radius, shear modulus and poisson ratio
+ *         Ec           core energy parameter of the line tension
+ *         Nint         number of quadrature points of the SBN1 kernel,
+ *                      0 for SBA (elasticity only)
+ *         quad_points, weights
+ *                      [Nint] quadrature points and weights
+ *         mobilityMode NODE_STEP_MOBILITY_*
+ *         dt           timestep
+ *         segForces    [numSegs][6] returned forces on the two end
+ *                      nodes of each segment
+ *         nodeForces   [numNodes][3] returned nodal forces
+ *         nodeVels     [numNodes][3] returned nodal velocities
+ *
+ *************************************************************************/
+void NodeStepEulerForward(int numNodes, int numSegs, int *nodeIDs,
+                          real8 *R, int *constraints, real8 *burgers,
+                          real8 *h, real8 *hinv, int *isPeriodic,
+                          real8 *sigext, int forceMode,
+                          real8 a, real8 MU, real8 NU, real8 Ec,
+                          int Nint, real8 *quad_points, real8 *weights,
+                          int mobilityMode, real8 dt,
+                          real8 *segForces, real8 *nodeForces,
+                          real8 *nodeVels)
+{
+    NodeStep(numNodes, numSegs, nodeIDs, R, constraints, burgers,
+             h, hinv, isPeriodic, sigext, forceMode, a, MU, NU, Ec,
+             Nint, quad_points, weights, mobilityMode, dt,
+             segForces, nodeForces, nodeVels,
+             (real8 *)NULL, 0.0, 0, (real8 *)NULL, (real8 *)NULL,
+             (real8 *)NULL, (real8 *)NULL, (real8 *)NULL,
+             (real8 *)NULL, (real8 *)NULL);
+
+    return;
+}
+
+
+/**************************************************************************
+ *
+ *      Function:    NodeStepEulerForwardStrain
+ *      Description: NodeStepEulerForward() accumulating the plastic strain
+ *                   of the step on the fly: the swept areas are computed
+ *                   (PlasticStrainIncrement) from the segment end points
+ *                   gathered for the forces and the new velocities, in
+ *                   the same call and without copying the positions.
+ *
+ *      Arguments:
+ *         numNodes ... nodeVels
+ *                      as for NodeStepEulerForward()
+ *         planes ... sysShear
+ *                      as for PlasticStrainIncrement()
+ *
+ *************************************************************************/
+void NodeStepEulerForwardStrain(int numNodes, int numSegs, int *nodeIDs,
+                                real8 *R, int *constraints, real8 *burgers,
+                                real8 *h, real8 *hinv, int *isPeriodic,
+                                real8 *sigext, int forceMode,
+                                real8 a, real8 MU, real8 NU, real8 Ec,
+                                int Nint, real8 *quad_points, real8 *weights,
+                                int mobilityMode, real8 dt,
+                                real8 *segForces, real8 *nodeForces,
+                                real8 *nodeVels,
+                                real8 *planes, real8 volume, int numSystems,
+                                real8 *sysBurgers, real8 *sysPlanes,
+                                real8 *dStrain, real8 *dSpin, real8 *length,
+                                real8 *sysLength, real8 *sysShear)
+{
+    NodeStep(numNodes, numSegs, nodeIDs, R, constraints, burgers,
+             h, hinv, isPeriodic, sigext, forceMode, a, MU, NU, Ec,
+             Nint, quad_points, weights, mobilityMode, dt,
+             segForces, nodeForces, nodeVels,
+             planes, volume, numSystems, sysBurgers, sysPlanes,
+             dStrain, dSpin, length, sysLength, sysShear);
+
+    return;
+}
@@ -0,0 +1,44 @@
+#ifndef _NodeStep_h
+#define _NodeStep_h
+
+#include <math.h>
+#define real8 double
+
+/*
+ *      Force and mobility laws of the fused step (NodeStepEulerForward)
+ */
+#define NODE_STEP_FORCE_LINE_TENSION 0   /* PK and line tension forces  */
+#define NODE_STEP_FORCE_ELASTICITY   1   /* PK and all pairs elasticity */
+
+#define NODE_STEP_MOBILITY_RELAX     0   /* velocity equal to the force */
+
+/*
+ *      Node constraint of fixed nodes (DisNode.Constraints.PINNED_NODE)
+ */
+#define NODE_STEP_PINNED_NODE        7
+
+void NodeStepEulerForward(int numNodes, int numSegs, int *nodeIDs,
+                          real8 *R, int *constraints, real8 *burgers,
+                          real8 *h, real8 *hinv, int *isPeriodic,
+                          real8 *sigext, int forceMode,
+                          real8 a, real8 MU, real8 NU, real8 Ec,
+                          int Nint, real8 *quad_points, real8 *weights,
+                          int mobilityMode, real8 dt,
+                          real8 *segForces, real8 *nodeForces,
+                          real8 *nodeVels);
+
+void NodeStepEulerForwardStrain(int numNodes, int numSegs, int *nodeIDs,
+                                real8 *R, int *constraints, real8 *burgers,
+                                real8 *h, real8 *hinv, int *isPeriodic,
+                                real8 *sigext, int forceMode,
+                                real8 a, real8 MU, real8 NU, real8 Ec,
+                                int Nint, real8 *quad_points, real8 *weights,
+                                int mobilityMode, real8 dt,
+                                real8 *segForces, real8 *nodeForces,
+                                real8 *nodeVels,
+                                real8 *planes, real8 volume, int numSystems,
+                                real8 *sysBurgers, real8 *sysPlanes,
+                                real8 *dStrain, real8 *dSpin, real8 *length,
+                                real8 *sysLength, real8 *sysShear);
+
+#endif
@@ -0,0 +1,182 @@
+#include "PlasticStrain.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+ *      Minimum |cos| between the Burgers vectors and between the plane
+ *      normals of a segment and of the slip system it is assigned to
+ */
+#define PLASTIC_STRAIN_COS_TOL (1.0 - 1.0e-6)
+
+
+/**************************************************************************
+ *
+ *      Function:    PlasticStrainIncrement
+ *      Description: Plastic strain and spin increments, dislocation line
+ *                   length and their decomposition on slip systems, from
+ *                   the areas swept by the segments over one step, in a
+ *                   single pass over the segment arrays.
+ *
+ *                   A segment from R1 to R2 whose end nodes move by
+ *                   dt * nodeVels sweeps the quadrilateral R1, R2, R2',
+ *                   R1', of area vector A = 1/2 (R2' - R1) x (R1' - R2)
+ *                   (seg x dx for a translation dx).  The plastic
+ *                   distortion of the step is the sum of b (x) A over the
+ *                   segments divided by the volume, dStrain and dSpin
+ *                   are its symmetric and antisymmetric parts, so that
+ *                   sigma : dStrain is the work of the Peach-Koehler
+ *                   forces per unit volume.
+ *
+ *                   A segment is assigned to the first slip system whose
+ *                   Burgers vector and plane normal are parallel to its
+ *                   own (either sign).  The length of a system is that of
+ *                   its segments, its shear increment the sum of
+ *                   (b . bs) (A . ns) / volume, with bs and ns the unit
+ *                   Burgers vector and normal of the system.
+ *
+ *      Arguments:
+ *         numSegs      number of segments
+ *         nodeIDs      [numSegs][2] indices of the two end nodes of
+ *                      each segment
+ *         R1, R2       [numSegs][3] end points of the segments at the
+ *                      beginning of the step, R2 the image of the second
+ *                      node closest to R1
+ *         nodeVels     [numNodes][3] node velocities over the step (or
+ *                      node displacements with dt = 1)
+ *         dt           timestep
+ *         burgers      [numSegs][3] burgers vector of each segment
+ *                      (from node 1 to node 2)
+ *         planes       [numSegs][3] glide plane normals, may be NULL if
+ *                      numSystems is 0
+ *         volume       volume of the simulation cell
+ *         numSystems   number of slip systems
+ *         sysBurgers   [numSystems][3] Burgers vectors of the systems
+ *         sysPlanes    [numSystems][3] plane normals of the systems
+ *         dStrain      [6] returned plastic strain increment, in the
+ *                      order xx, yy, zz, yz, xz, xy
+ *         dSpin        [3] returned plastic spin increment, in the
+ *                      order yz, xz, xy
+ *         length       returned total line length at the end of the step
+ *         sysLength    [numSystems] returned line length of each system
+ *         sysShear     [numSystems] returned shear increment of each
+ *                      system
+ *
+ *************************************************************************/
+void PlasticStrainIncrement(int numSegs, int *nodeIDs, real8 *R1, real8 *R2,
+                            real8 *nodeVels, real8 dt,
+                            real8 *burgers, real8 *planes, real8 volume,
+                            int numSystems, real8 *sysBurgers,
+                            real8 *sysPlanes,
+                            real8 *dStrain, real8 *dSpin, real8 *length,
+                            real8 *sysLength, real8 *sysShear)
+{
+    int   i, s, numAcc;
+    real8 xx = 0.0, yy = 0.0, zz = 0.0, yz = 0.0, xz = 0.0, xy = 0.0;
+    real8 wyz = 0.0, wxz = 0.0, wxy = 0.0, len = 0.0;
+    real8 *sysUnit, *sysAcc;
+
+/*
+ *  Unit Burgers vectors and plane normals of the slip systems, and the
+ *  (length, shear) sums of the systems, which are never empty so that
+ *  they can be reduced as an array section
+ */
+    numAcc  = 2 * (numSystems > 0 ? numSystems : 1);
+    sysUnit = (real8 *)malloc(3 * numAcc * sizeof(real8));
+    sysAcc  = (real8 *)calloc(numAcc, sizeof(real8));
+
+    for (s = 0; s < numSystems; s++) {
+        int   k;
+        real8 bn, nn;
+        bn = sqrt(sysBurgers[3*s]*sysBurgers[3*s] +
+                  sysBurgers[3*s+1]*sysBurgers[3*s+1] +
+                  sysBurgers[3*s+2]*sysBurgers[3*s+2]);
+        nn = sqrt(sysPlanes[3*s]*sysPlanes[3*s] +
+                  sysPlanes[3*s+1]*sysPlanes[3*s+1] +
+                  sysPlanes[3*s+2]*sysPlanes[3*s+2]);
+        for (k = 0; k < 3; k++) {
+            sysUnit[6*s+k]   = (bn > 0.0) ? sysBurgers[3*s+k] / bn : 0.0;
+            sysUnit[6*s+3+k] = (nn > 0.0) ? sysPlanes[3*s+k] / nn : 0.0;
+        }
+    }
+
+#pragma omp parallel for schedule(static) \
+        reduction(+:xx,yy,zz,yz,xz,xy,wyz,wxz,wxy,len) \
+        reduction(+:sysAcc[:numAcc])
+    for (i = 0; i < numSegs; i++) {
+        int   k, sys;
+        real8 bLen, nLen, cosb, cosn, bdot;
+        real8 p1[3], p2[3], d1[3], d2[3], A[3], seg[3];
+        real8 *b = &burgers[3*i], *n;
+        real8 *v1 = &nodeVels[3*nodeIDs[2*i]];
+        real8 *v2 = &nodeVels[3*nodeIDs[2*i+1]];
+
+        for (k = 0; k < 3; k++) {
+            p1[k]  = R1[3*i+k] + dt * v1[k];
+            p2[k]  = R2[3*i+k] + dt * v2[k];
+            d1[k]  = p2[k] - R1[3*i+k];
+            d2[k]  = p1[k] - R2[3*i+k];
+            seg[k] = p2[k] - p1[k];
+        }
+
+        A[0] = 0.5 * (d1[1]*d2[2] - d1[2]*d2[1]);
+        A[1] = 0.5 * (d1[2]*d2[0] - d1[0]*d2[2]);
+        A[2] = 0.5 * (d1[0]*d2[1] - d1[1]*d2[0]);
+
+        xx += b[0]*A[0];
+        yy += b[1]*A[1];
+        zz += b[2]*A[2];
+        yz += 0.5 * (b[1]*A[2] + b[2]*A[1]);
+        xz += 0.5 * (b[0]*A[2] + b[2]*A[0]);
+        xy += 0.5 * (b[0]*A[1] + b[1]*A[0]);
+        wyz += 0.5 * (b[1]*A[2] - b[2]*A[1]);
+        wxz += 0.5 * (b[0]*A[2] - b[2]*A[0]);
+        wxy += 0.5 * (b[0]*A[1] - b[1]*A[0]);
+
+        len += sqrt(seg[0]*seg[0] + seg[1]*seg[1] + seg[2]*seg[2]);
+
+        if (numSystems == 0) continue;
+
+        n    = &planes[3*i];
+        bLen = sqrt(b[0]*b[0] + b[1]*b[1] + b[2]*b[2]);
+        nLen = sqrt(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+        if ((bLen <= 0.0) || (nLen <= 0.0)) continue;
+
+        for (sys = 0; sys < numSystems; sys++) {
+            real8 *bs = &sysUnit[6*sys], *ns = &sysUnit[6*sys+3];
+            bdot = b[0]*bs[0] + b[1]*bs[1] + b[2]*bs[2];
+            cosb = bdot / bLen;
+            cosn = (n[0]*ns[0] + n[1]*ns[1] + n[2]*ns[2]) / nLen;
+            if ((fabs(cosb) < PLASTIC_STRAIN_COS_TOL) ||
+                (fabs(cosn) < PLASTIC_STRAIN_COS_TOL)) continue;
+
+            sysAcc[2*sys]   += sqrt(seg[0]*seg[0] + seg[1]*seg[1] +
+                                    seg[2]*seg[2]);
+            sysAcc[2*sys+1] += bdot * (A[0]*ns[0] + A[1]*ns[1] +
+                                       A[2]*ns[2]) / volume;
+            break;
+        }
+    }
+
+    for (s = 0; s < numSystems; s++) {
+        sysLength[s] = sysAcc[2*s];
+        sysShear[s]  = sysAcc[2*s+1];
+    }
+
+    free(sysUnit);
+    free(sysAcc);
+
+    dStrain[0] = xx / volume;
+    dStrain[1] = yy / volume;
+    dStrain[2] = zz / volume;
+    dStrain[3] = yz / volume;
+    dStrain[4] = xz / volume;
+    dStrain[5] = xy / volume;
+
+    dSpin[0] = wyz / volume;
+    dSpin[1] = wxz / volume;
+    dSpin[2] = wxy / volume;
+
+    *length = len;
+
+    return;
+}
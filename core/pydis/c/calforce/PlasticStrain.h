@@ -0,0 +1,15 @@
+#ifndef _PlasticStrain_h
+#define _PlasticStrain_h
+
+#include <math.h>
+#define real8 double
+
+void PlasticStrainIncrement(int numSegs, int *nodeIDs, real8 *R1, real8 *R2,
+                            real8 *nodeVels, real8 dt,
+                            real8 *burgers, real8 *planes, real8 volume,
+                            int numSystems, real8 *sysBurgers,
+                            real8 *sysPlanes,
+                            real8 *dStrain, real8 *dSpin, real8 *length,
+                            real8 *sysLength, real8 *sysShear);
+
+#endif
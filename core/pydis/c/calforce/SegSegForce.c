@@ -1,12 +1,74 @@
 #include "SegSegForce.h"
 
-void SpecialSegSegForceHalf(real8 p1x, real8 p1y, real8 p1z,
+/*
+ *      Device callable as well, see SegSegForceDevice.c.
+ */
+#ifdef _OPENMP
+#pragma omp declare target
+#endif
+
+/*
+ *      Pair independent constants of the near-parallel segment force,
+ *      set once per SpecialSegSegForce() call and shared by both halves.
+ */
+typedef struct {
+        real8 cotanthetac, a2, m4p, m8p, m4pn, a2m4pn, a2m8p;
+} SpecialConsts_t;
+
+
+static void SpecialSetConsts(real8 a, real8 MU, real8 NU, real8 ecrit,
+                             SpecialConsts_t *k)
+{
+        real8 pivalue=3.141592653589793;
+
+        k->cotanthetac = sqrt((1 - ecrit*1.01) / (ecrit*1.01));
+
+        k->a2     = a*a;
+        k->m4p    = 0.25 * MU / pivalue;
+        k->m8p    = 0.5 * k->m4p;
+        k->m4pn   = k->m4p / ( 1 - NU );
+        k->a2m4pn = k->a2 * k->m4pn;
+        k->a2m8p  = k->a2 * k->m8p;
+}
+
+
+/*
+ *      Unit direction and inverse length of the segment x3->x4.  Each
+ *      segment is the reference direction of the other segment's half.
+ */
+static void SpecialSegDirection(real8 p3x, real8 p3y, real8 p3z,
+                                real8 p4x, real8 p4y, real8 p4z,
+                                real8 t[3], real8 *oneoverL)
+{
+        real8 vec1[3], temp1;
+
+        vec1[0] = p4x - p3x;
+        vec1[1] = p4y - p3y;
+        vec1[2] = p4z - p3z;
+
+        temp1 = vec1[0]*vec1[0] + vec1[1]*vec1[1] + vec1[2]*vec1[2];
+
+        *oneoverL = 1/sqrt(temp1);
+
+        t[0] = vec1[0] * *oneoverL;
+        t[1] = vec1[1] * *oneoverL;
+        t[2] = vec1[2] * *oneoverL;
+}
+
+
+/*
+ *      Body of SpecialSegSegForceHalf() with the constants and the
+ *      direction t of segment p3->p4 supplied by the caller.
+ */
+static void SpecialSegSegForceHalfCore(real8 p1x, real8 p1y, real8 p1z,
                             real8 p2x, real8 p2y, real8 p2z,
                             real8 p3x, real8 p3y, real8 p3z,
                             real8 p4x, real8 p4y, real8 p4z,
                             real8 bpx, real8 bpy, real8 bpz,
                             real8 bx, real8 by, real8 bz,
-                            real8 a, real8 MU, real8 NU, real8 ecrit,
+                            real8 a, real8 MU, real8 NU,
+                            SpecialConsts_t *k, real8 t34[3],
+                            real8 oneoverL34,
                             real8 *fp3x, real8 *fp3y, real8 *fp3z,
                             real8 *fp4x, real8 *fp4y, real8 *fp4z)
 {
@@ -15,7 +77,6 @@ void SpecialSegSegForceHalf(real8 p1x, real8 p1y, real8 p1z,
         real8 x1[3], x2[3], x3[3], x4[3], b[3], bp[3];
         real8 f3[3], f4[3];
         real8 vec1[3], vec2[3], t[3], nd[3];
-        real8 temp1;
         real8 R[3], Rdt, x1mod[3], x2mod[3];
         real8 oneoverL;
         real8 y[2], z[2], yv[4], zv[4], ypz[4], ymz[4];
@@ -37,18 +98,17 @@ void SpecialSegSegForceHalf(real8 p1x, real8 p1y, real8 p1z,
         real8 tdb, tdbp, nddb, bpctdb, bpctdnd;
         real8 bct[3], bpct[3], ndct[3], bpctct[3];
         real8 cotanthetac;
-        real8 pivalue=3.141592653589793;
 
 
-        cotanthetac = sqrt((1 - ecrit*1.01) / (ecrit*1.01));
+        cotanthetac = k->cotanthetac;
 
         eps    = 1e-12;
-        a2     = a*a;
-        m4p    = 0.25 * MU / pivalue;
-        m8p    = 0.5 * m4p;
-        m4pn   = m4p / ( 1 - NU );
-        a2m4pn = a2 * m4pn;
-        a2m8p  = a2 * m8p;
+        a2     = k->a2;
+        m4p    = k->m4p;
+        m8p    = k->m8p;
+        m4pn   = k->m4pn;
+        a2m4pn = k->a2m4pn;
+        a2m8p  = k->a2m8p;
 
         *fp3x = 0.0;
         *fp3y = 0.0;
@@ -79,20 +139,13 @@ void SpecialSegSegForceHalf(real8 p1x, real8 p1y, real8 p1z,
         bp[2]=bpz;
 
         for(i=0;i<3;i++) {
-            vec1[i]=x4[i]-x3[i];
             vec2[i]=x2[i]-x1[i];
         }
 
-        temp1=0.0e0;
+        oneoverL = oneoverL34;
 
         for(i=0;i<3;i++) {
-            temp1+=vec1[i]*vec1[i];
-        }
-
-        oneoverL =1/sqrt(temp1);
-
-        for(i=0;i<3;i++) {
-            t[i]=vec1[i]*oneoverL;
+            t[i]=t34[i];
         }
 
         c=0.0e0;
@@ -385,6 +438,76 @@ void SpecialSegSegForceHalf(real8 p1x, real8 p1y, real8 p1z,
 
 
 
+void SpecialSegSegForceHalf(real8 p1x, real8 p1y, real8 p1z,
+                            real8 p2x, real8 p2y, real8 p2z,
+                            real8 p3x, real8 p3y, real8 p3z,
+                            real8 p4x, real8 p4y, real8 p4z,
+                            real8 bpx, real8 bpy, real8 bpz,
+                            real8 bx, real8 by, real8 bz,
+                            real8 a, real8 MU, real8 NU, real8 ecrit,
+                            real8 *fp3x, real8 *fp3y, real8 *fp3z,
+                            real8 *fp4x, real8 *fp4y, real8 *fp4z)
+{
+        real8 t[3], oneoverL;
+        SpecialConsts_t k;
+
+        SpecialSetConsts(a, MU, NU, ecrit, &k);
+        SpecialSegDirection(p3x, p3y, p3z, p4x, p4y, p4z, t, &oneoverL);
+
+        SpecialSegSegForceHalfCore(p1x, p1y, p1z, p2x, p2y, p2z,
+                                   p3x, p3y, p3z, p4x, p4y, p4z,
+                                   bpx, bpy, bpz, bx, by, bz,
+                                   a, MU, NU, &k, t, oneoverL,
+                                   fp3x, fp3y, fp3z, fp4x, fp4y, fp4z);
+        return;
+}
+
+
+/*
+ *      Both halves of SpecialSegSegForce() in one call.  The constants
+ *      are set once and the unit directions t12, t34 and inverse
+ *      lengths of the segments come from the caller, which normally
+ *      has them already (see SegSegForceIsotropic()).
+ */
+static void SpecialSegSegForceShared(real8 p1x, real8 p1y, real8 p1z,
+                        real8 p2x, real8 p2y, real8 p2z,
+                        real8 p3x, real8 p3y, real8 p3z,
+                        real8 p4x, real8 p4y, real8 p4z,
+                        real8 bpx, real8 bpy, real8 bpz,
+                        real8 bx, real8 by, real8 bz,
+                        real8 a, real8 MU, real8 NU, real8 ecrit,
+                        real8 t12[3], real8 oneoverL12,
+                        real8 t34[3], real8 oneoverL34,
+                        int seg12Local, int seg34Local,
+                        real8 *fp1x, real8 *fp1y, real8 *fp1z,
+                        real8 *fp2x, real8 *fp2y, real8 *fp2z,
+                        real8 *fp3x, real8 *fp3y, real8 *fp3z,
+                        real8 *fp4x, real8 *fp4y, real8 *fp4z)
+{
+        SpecialConsts_t k;
+
+        SpecialSetConsts(a, MU, NU, ecrit, &k);
+
+        if (seg34Local) {
+            SpecialSegSegForceHalfCore(p1x, p1y, p1z, p2x, p2y, p2z,
+                                       p3x, p3y, p3z, p4x, p4y, p4z,
+                                       bpx, bpy, bpz, bx, by, bz,
+                                       a, MU, NU, &k, t34, oneoverL34,
+                                       fp3x, fp3y, fp3z, fp4x, fp4y, fp4z);
+        }
+
+        if (seg12Local) {
+            SpecialSegSegForceHalfCore(p3x, p3y, p3z, p4x, p4y, p4z,
+                                       p1x, p1y, p1z, p2x, p2y, p2z,
+                                       bx, by, bz, bpx, bpy, bpz,
+                                       a, MU, NU, &k, t12, oneoverL12,
+                                       fp1x, fp1y, fp1z, fp2x, fp2y, fp2z);
+        }
+
+        return;
+}
+
+
 /*-------------------------------------------------------------------------
  *
  *      Function:     SpecialSegSegForce
@@ -423,22 +546,18 @@ void SpecialSegSegForce(real8 p1x, real8 p1y, real8 p1z,
                         real8 *fp3x, real8 *fp3y, real8 *fp3z,
                         real8 *fp4x, real8 *fp4y, real8 *fp4z)
 {
-        if (seg34Local) {
-            SpecialSegSegForceHalf(p1x, p1y, p1z, p2x, p2y, p2z,
-                                   p3x, p3y, p3z, p4x, p4y, p4z,
-                                   bpx, bpy, bpz, bx, by, bz,
-                                   a, MU, NU, ecrit,
-                                   fp3x, fp3y, fp3z, fp4x, fp4y, fp4z);
-        }
-
-        if (seg12Local) {
-            SpecialSegSegForceHalf(p3x, p3y, p3z, p4x, p4y, p4z,
-                                   p1x, p1y, p1z, p2x, p2y, p2z,
-                                   bx, by, bz, bpx, bpy, bpz,
-                                   a, MU, NU, ecrit,
-                                   fp1x, fp1y, fp1z, fp2x, fp2y, fp2z);
-        }
-
+        real8 t12[3], t34[3], oneoverL12, oneoverL34;
+
+        SpecialSegDirection(p1x, p1y, p1z, p2x, p2y, p2z, t12, &oneoverL12);
+        SpecialSegDirection(p3x, p3y, p3z, p4x, p4y, p4z, t34, &oneoverL34);
+
+        SpecialSegSegForceShared(p1x, p1y, p1z, p2x, p2y, p2z,
+                                 p3x, p3y, p3z, p4x, p4y, p4z,
+                                 bpx, bpy, bpz, bx, by, bz, a, MU, NU, ecrit,
+                                 t12, oneoverL12, t34, oneoverL34,
+                                 seg12Local, seg34Local,
+                                 fp1x, fp1y, fp1z, fp2x, fp2y, fp2z,
+                                 fp3x, fp3y, fp3z, fp4x, fp4y, fp4z);
         return;
 }
 
@@ -1066,12 +1185,13 @@ void SegSegForceIsotropic(real8 p1x, real8 p1y, real8 p1z,
  *          The two lines are parallel, so we have to use a special
  *          lower dimensional function
  */
-            SpecialSegSegForce(p1x, p1y, p1z, p2x, p2y, p2z,
-                               p3x, p3y, p3z, p4x, p4y, p4z,
-                               bpx, bpy, bpz, bx, by, bz, a, MU, NU,
-                               eps, seg12Local, seg34Local,
-                               fp1x, fp1y, fp1z, fp2x, fp2y, fp2z,
-                               fp3x, fp3y, fp3z, fp4x, fp4y, fp4z);
+            SpecialSegSegForceShared(p1x, p1y, p1z, p2x, p2y, p2z,
+                                     p3x, p3y, p3z, p4x, p4y, p4z,
+                                     bpx, bpy, bpz, bx, by, bz, a, MU, NU,
+                                     eps, tp, oneoverLp, t, oneoverL,
+                                     seg12Local, seg34Local,
+                                     fp1x, fp1y, fp1z, fp2x, fp2y, fp2z,
+                                     fp3x, fp3y, fp3z, fp4x, fp4y, fp4z);
        }
 
        return;
@@ -1122,4 +1242,8 @@ void SegSegForce(real8 p1x, real8 p1y, real8 p1z,
                              fp1x, fp1y, fp1z, fp2x, fp2y, fp2z,
                              fp3x, fp3y, fp3z, fp4x, fp4y, fp4z);
         return;
-}
\ No newline at end of file
+}
+
+#ifdef _OPENMP
+#pragma omp end declare target
+#endif
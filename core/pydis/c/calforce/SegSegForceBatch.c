@@ -0,0 +1,162 @@
+#include "SegSegForceBatch.h"
+#include "SegSegForce.h"
+#include "SegSegForceSIMD.h"
+#include "SegSegForce_SBN1.h"
+#include "SegSegForce_SBN1_SBA.h"
+
+/**************************************************************************
+ *
+ *      Function:    SegSegForceBatch
+ *      Description: Compute the forces on the end nodes of numPairs
+ *                   segment pairs with a single call.  Pair <i>
+ *                   consists of segment p1[i]->p2[i] with burgers
+ *                   vector b12[i] and segment p3[i]->p4[i] with burgers
+ *                   vector b34[i].  This avoids the per-pair marshalling
+ *                   of the scalar SegSegForce() interface when called
+ *                   from python.  The pairs are evaluated with the
+ *                   vectorized kernel SegSegForceIsotropicSIMD().
+ *
+ *      Arguments:
+ *         numPairs       number of segment pairs
+ *         p1,p2,p3,p4    [numPairs][3] arrays of node positions
+ *         b12, b34       [numPairs][3] arrays of burgers vectors
+ *         a              core value
+ *         MU             shear modulus
+ *         NU             poisson ratio
+ *         seg12Local     1 if forces on p1/p2 are needed, 0 otherwise
+ *         seg34Local     1 if forces on p3/p4 are needed, 0 otherwise
+ *         f1,f2,f3,f4    [numPairs][3] arrays in which to return the
+ *                        forces at p1..p4.  Forces which are not
+ *                        requested are returned as zero.
+ *
+ *************************************************************************/
+void SegSegForceBatch(int numPairs,
+                      real8 *p1, real8 *p2, real8 *p3, real8 *p4,
+                      real8 *b12, real8 *b34,
+                      real8 a, real8 MU, real8 NU,
+                      int seg12Local, int seg34Local,
+                      real8 *f1, real8 *f2, real8 *f3, real8 *f4)
+{
+    SegSegForceIsotropicSIMD(numPairs, p1, p2, p3, p4, b12, b34,
+                             a, MU, NU, seg12Local, seg34Local,
+                             f1, f2, f3, f4);
+}
+
+
+/**************************************************************************
+ *
+ *      Function:    SegSegForce_SBN1_BatchCtx
+ *      Description: Batched version of SegSegForce_SBN1_Ctx().  Arguments
+ *                   are as for SegSegForceBatch() plus the SBN1 context
+ *                   holding the quadrature rule used along each segment.
+ *
+ *************************************************************************/
+void SegSegForce_SBN1_BatchCtx(int numPairs,
+                               real8 *p1, real8 *p2, real8 *p3, real8 *p4,
+                               real8 *b12, real8 *b34,
+                               real8 a, real8 MU, real8 NU,
+                               SBN1Context_t *ctx,
+                               int seg12Local, int seg34Local,
+                               real8 *f1, real8 *f2, real8 *f3, real8 *f4)
+{
+    int i, j, k;
+
+    for (i = 0; i < numPairs; i++) {
+        k = 3*i;
+/*
+ *      Forces of non-local segments are left untouched, so clear them
+ *      here.
+ */
+        for (j = 0; j < 3; j++) {
+            f1[k+j] = 0.0; f2[k+j] = 0.0; f3[k+j] = 0.0; f4[k+j] = 0.0;
+        }
+        SegSegForce_SBN1_Ctx(p1[k], p1[k+1], p1[k+2], p2[k], p2[k+1], p2[k+2],
+                             p3[k], p3[k+1], p3[k+2], p4[k], p4[k+1], p4[k+2],
+                             b12[k], b12[k+1], b12[k+2], b34[k], b34[k+1], b34[k+2],
+                             a, MU, NU, ctx, seg12Local, seg34Local,
+                             &f1[k], &f1[k+1], &f1[k+2], &f2[k], &f2[k+1], &f2[k+2],
+                             &f3[k], &f3[k+1], &f3[k+2], &f4[k], &f4[k+1], &f4[k+2]);
+    }
+}
+
+
+/**************************************************************************
+ *
+ *      Function:    SegSegForce_SBN1_SBA_BatchCtx
+ *      Description: Batched version of SegSegForce_SBN1_SBA_Ctx().
+ *
+ *************************************************************************/
+void SegSegForce_SBN1_SBA_BatchCtx(int numPairs,
+                                   real8 *p1, real8 *p2, real8 *p3, real8 *p4,
+                                   real8 *b12, real8 *b34,
+                                   real8 a, real8 MU, real8 NU,
+                                   SBN1Context_t *ctx,
+                                   int seg12Local, int seg34Local,
+                                   real8 *f1, real8 *f2, real8 *f3, real8 *f4)
+{
+    int i, j, k;
+
+    for (i = 0; i < numPairs; i++) {
+        k = 3*i;
+        for (j = 0; j < 3; j++) {
+            f1[k+j] = 0.0; f2[k+j] = 0.0; f3[k+j] = 0.0; f4[k+j] = 0.0;
+        }
+        SegSegForce_SBN1_SBA_Ctx(p1[k], p1[k+1], p1[k+2], p2[k], p2[k+1], p2[k+2],
+                                 p3[k], p3[k+1], p3[k+2], p4[k], p4[k+1], p4[k+2],
+                                 b12[k], b12[k+1], b12[k+2], b34[k], b34[k+1], b34[k+2],
+                                 a, MU, NU, ctx, seg12Local, seg34Local,
+                                 &f1[k], &f1[k+1], &f1[k+2], &f2[k], &f2[k+1], &f2[k+2],
+                                 &f3[k], &f3[k+1], &f3[k+2], &f4[k], &f4[k+1], &f4[k+2]);
+    }
+}
+
+
+/**************************************************************************
+ *
+ *      Function:    SegSegForce_SBN1_Batch
+ *      Description: Batched version of SegSegForce_SBN1().  Arguments
+ *                   are as for SegSegForceBatch() plus the Gauss
+ *                   quadrature points and weights used along each
+ *                   segment.
+ *
+ *************************************************************************/
+void SegSegForce_SBN1_Batch(int numPairs,
+                            real8 *p1, real8 *p2, real8 *p3, real8 *p4,
+                            real8 *b12, real8 *b34,
+                            real8 a, real8 MU, real8 NU,
+                            int Nint, real8 *quad_points, real8 *weights,
+                            int seg12Local, int seg34Local,
+                            real8 *f1, real8 *f2, real8 *f3, real8 *f4)
+{
+    SBN1Context_t *ctx;
+
+    ctx = SBN1ContextCreate(Nint, quad_points, weights);
+    SBN1ContextSetMaterial(ctx, a, MU, NU);
+    SegSegForce_SBN1_BatchCtx(numPairs, p1, p2, p3, p4, b12, b34, a, MU, NU,
+                              ctx, seg12Local, seg34Local, f1, f2, f3, f4);
+    SBN1ContextFree(ctx);
+}
+
+
+/**************************************************************************
+ *
+ *      Function:    SegSegForce_SBN1_SBA_Batch
+ *      Description: Batched version of SegSegForce_SBN1_SBA().
+ *
+ *************************************************************************/
+void SegSegForce_SBN1_SBA_Batch(int numPairs,
+                                real8 *p1, real8 *p2, real8 *p3, real8 *p4,
+                                real8 *b12, real8 *b34,
+                                real8 a, real8 MU, real8 NU,
+                                int Nint, real8 *quad_points, real8 *weights,
+                                int seg12Local, int seg34Local,
+                                real8 *f1, real8 *f2, real8 *f3, real8 *f4)
+{
+    SBN1Context_t *ctx;
+
+    ctx = SBN1ContextCreate(Nint, quad_points, weights);
+    SBN1ContextSetMaterial(ctx, a, MU, NU);
+    SegSegForce_SBN1_SBA_BatchCtx(numPairs, p1, p2, p3, p4, b12, b34, a, MU, NU,
+                                  ctx, seg12Local, seg34Local, f1, f2, f3, f4);
+    SBN1ContextFree(ctx);
+}
@@ -0,0 +1,53 @@
+#include <math.h>
+#include "SegSegForce_SBN1.h"
+#define real8 double
+
+/*
+ *      Batched versions of the segment/segment force functions.  All
+ *      position, burgers vector and force arrays are contiguous
+ *      [numPairs][3] arrays (row-major, i.e. a C-ordered numpy (N,3)
+ *      float64 array) holding one pair per row.  Forces are written
+ *      into caller-owned buffers.
+ */
+void SegSegForceBatch(int numPairs,
+                      real8 *p1, real8 *p2, real8 *p3, real8 *p4,
+                      real8 *b12, real8 *b34,
+                      real8 a, real8 MU, real8 NU,
+                      int seg12Local, int seg34Local,
+                      real8 *f1, real8 *f2, real8 *f3, real8 *f4);
+
+void SegSegForce_SBN1_Batch(int numPairs,
+                            real8 *p1, real8 *p2, real8 *p3, real8 *p4,
+                            real8 *b12, real8 *b34,
+                            real8 a, real8 MU, real8 NU,
+                            int Nint, real8 *quad_points, real8 *weights,
+                            int seg12Local, int seg34Local,
+                            real8 *f1, real8 *f2, real8 *f3, real8 *f4);
+
+void SegSegForce_SBN1_SBA_Batch(int numPairs,
+                                real8 *p1, real8 *p2, real8 *p3, real8 *p4,
+                                real8 *b12, real8 *b34,
+                                real8 a, real8 MU, real8 NU,
+                                int Nint, real8 *quad_points, real8 *weights,
+                                int seg12Local, int seg34Local,
+                                real8 *f1, real8 *f2, real8 *f3, real8 *f4);
+
+/*
+ *      Same as above with the quadrature rule from an SBN1 context, so
+ *      that repeated calls (e.g. chunks of a pair loop) share it.
+ */
+void SegSegForce_SBN1_BatchCtx(int numPairs,
+                               real8 *p1, real8 *p2, real8 *p3, real8 *p4,
+                               real8 *b12, real8 *b34,
+                               real8 a, real8 MU, real8 NU,
+                               SBN1Context_t *ctx,
+                               int seg12Local, int seg34Local,
+                               real8 *f1, real8 *f2, real8 *f3, real8 *f4);
+
+void SegSegForce_SBN1_SBA_BatchCtx(int numPairs,
+                                   real8 *p1, real8 *p2, real8 *p3, real8 *p4,
+                                   real8 *b12, real8 *b34,
+                                   real8 a, real8 MU, real8 NU,
+                                   SBN1Context_t *ctx,
+                                   int seg12Local, int seg34Local,
+                                   real8 *f1, real8 *f2, real8 *f3, real8 *f4);
@@ -0,0 +1,431 @@
+#include "SegSegForceDevice.h"
+#include "../include/Error.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/*
+ *      Functions called inside the target regions.  Their definitions
+ *      in SegSegForce.c, SegSegForce_SBN1*.c, StressDueToSeg.c and
+ *      SegSegForceDriver.c are marked the same way.
+ */
+#ifdef _OPENMP
+#pragma omp declare target
+#endif
+#include "SegSegForceDriver.h"
+#include "SegSegForce.h"
+#include "SegSegForce_SBN1_SBA.h"
+#include "StressDueToSeg.h"
+#ifdef _OPENMP
+#pragma omp end declare target
+#endif
+
+/*
+ *      Largest quadrature rule SegSegForce_SBN1_SBA() accepts.
+ */
+#define DEVICE_MAX_QUAD_POINTS 7
+
+
+static int HostDevice(void)
+{
+#ifdef _OPENMP
+    return(omp_get_initial_device());
+#else
+    return(0);
+#endif
+}
+
+
+static void *DeviceAlloc(size_t bytes, int device)
+{
+    void *ptr;
+
+    if (bytes == 0) bytes = sizeof(real8);
+#ifdef _OPENMP
+    ptr = omp_target_alloc(bytes, device);
+#else
+    ptr = malloc(bytes);
+#endif
+    if (ptr == NULL) {
+        ErrorRaise("SegSegForceDevice: cannot allocate %lu bytes "
+                "on device %d", (unsigned long)bytes, device);
+    }
+
+    return(ptr);
+}
+
+
+static void DeviceRelease(void *ptr, int device)
+{
+    if (ptr == NULL) return;
+#ifdef _OPENMP
+    omp_target_free(ptr, device);
+#else
+    free(ptr);
+#endif
+}
+
+
+static void CopyToDevice(void *dst, void *src, size_t bytes, int device)
+{
+    if (bytes == 0) return;
+#ifdef _OPENMP
+    omp_target_memcpy(dst, src, bytes, 0, 0, device, HostDevice());
+#else
+    memcpy(dst, src, bytes);
+#endif
+}
+
+
+static void CopyFromDevice(void *dst, void *src, size_t bytes, int device)
+{
+    if (bytes == 0) return;
+#ifdef _OPENMP
+    omp_target_memcpy(dst, src, bytes, 0, 0, HostDevice(), device);
+#else
+    memcpy(dst, src, bytes);
+#endif
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:       SegSegForceDeviceCreate
+ *      Description:    Create an (empty) device force backend on the
+ *                      given OpenMP device, or on the default device if
+ *                      device < 0.  The pair list defaults to all pairs.
+ *
+ *-----------------------------------------------------------------------*/
+SegSegForceDevice_t *SegSegForceDeviceCreate(int device)
+{
+    SegSegForceDevice_t *dev;
+
+    dev = (SegSegForceDevice_t *)calloc(1, sizeof(SegSegForceDevice_t));
+    if (dev == NULL) {
+        ErrorRaise("SegSegForceDeviceCreate: out of memory");
+    }
+
+#ifdef _OPENMP
+    dev->device = (device < 0) ? omp_get_default_device() : device;
+    if (dev->device > omp_get_num_devices()) {
+        free(dev);
+        ErrorRaise("SegSegForceDeviceCreate: no device %d", device);
+    }
+#else
+    dev->device = 0;
+#endif
+    dev->numPairs = -1;
+
+    return(dev);
+}
+
+
+void SegSegForceDeviceFree(SegSegForceDevice_t *dev)
+{
+    if (dev == NULL) return;
+
+    DeviceRelease(dev->R1, dev->device);
+    DeviceRelease(dev->R2, dev->device);
+    DeviceRelease(dev->burgers, dev->device);
+    DeviceRelease(dev->segForces, dev->device);
+    DeviceRelease(dev->pairs, dev->device);
+    free(dev);
+}
+
+
+/*
+ *      Returns 1 if the backend runs on an accelerator, 0 if its target
+ *      regions fall back to the host.
+ */
+int SegSegForceDeviceIsOffloaded(SegSegForceDevice_t *dev)
+{
+    return(dev->device != HostDevice());
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:       SegSegForceDeviceSetSegments
+ *      Description:    Upload the segment end points and burgers vectors
+ *                      ([numSegs][3] host arrays, R2 not yet mapped to
+ *                      the image closest to R1).  Device buffers are
+ *                      only reallocated when the number of segments
+ *                      grows beyond their capacity.
+ *
+ *-----------------------------------------------------------------------*/
+void SegSegForceDeviceSetSegments(SegSegForceDevice_t *dev, int numSegs,
+                                  real8 *R1, real8 *R2, real8 *burgers)
+{
+    size_t bytes = 3 * (size_t)numSegs * sizeof(real8);
+
+    if (numSegs > dev->maxSegs) {
+        size_t maxSegs = numSegs + numSegs / 4;
+        DeviceRelease(dev->R1, dev->device);
+        DeviceRelease(dev->R2, dev->device);
+        DeviceRelease(dev->burgers, dev->device);
+        DeviceRelease(dev->segForces, dev->device);
+/*
+ *      Clear the released buffers first so that the instance can still
+ *      be freed if one of the allocations fails
+ */
+        dev->R1        = NULL;
+        dev->R2        = NULL;
+        dev->burgers   = NULL;
+        dev->segForces = NULL;
+        dev->maxSegs   = 0;
+        dev->numSegs   = 0;
+        dev->R1        = DeviceAlloc(3 * maxSegs * sizeof(real8), dev->device);
+        dev->R2        = DeviceAlloc(3 * maxSegs * sizeof(real8), dev->device);
+        dev->burgers   = DeviceAlloc(3 * maxSegs * sizeof(real8), dev->device);
+        dev->segForces = DeviceAlloc(6 * maxSegs * sizeof(real8), dev->device);
+        dev->maxSegs   = (int)maxSegs;
+    }
+
+    CopyToDevice(dev->R1, R1, bytes, dev->device);
+    CopyToDevice(dev->R2, R2, bytes, dev->device);
+    CopyToDevice(dev->burgers, burgers, bytes, dev->device);
+    dev->numSegs = numSegs;
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:       SegSegForceDeviceSetPairs
+ *      Description:    Upload a [numPairs][2] list of segment pairs to
+ *                      be evaluated by SegSegForceDeviceCompute().  A
+ *                      pair (i,i) adds the self force of segment i, and
+ *                      each pair must appear only once.  numPairs < 0
+ *                      selects all pairs i <= j, which need no list.
+ *
+ *-----------------------------------------------------------------------*/
+void SegSegForceDeviceSetPairs(SegSegForceDevice_t *dev, int numPairs,
+                               int *pairs)
+{
+    if (numPairs < 0) {
+        dev->numPairs = -1;
+        return;
+    }
+
+    if (numPairs > dev->maxPairs) {
+        DeviceRelease(dev->pairs, dev->device);
+        dev->pairs    = NULL;
+        dev->maxPairs = 0;
+        dev->numPairs = -1;
+        dev->pairs    = DeviceAlloc(2 * (size_t)(numPairs + numPairs / 4) *
+                                    sizeof(int), dev->device);
+        dev->maxPairs = numPairs + numPairs / 4;
+    }
+
+    CopyToDevice(dev->pairs, pairs, 2 * (size_t)numPairs * sizeof(int), dev->device);
+    dev->numPairs = numPairs;
+}
+
+
+#ifdef _OPENMP
+#pragma omp declare target
+#endif
+/*
+ *      Force of pair (i,j) with segment i as p1->p2, using the same
+ *      periodic images and force function as SegSegForceRow().
+ */
+static void DevicePairForce(int i, int j, real8 *R1, real8 *R2,
+                            real8 *burgers, real8 *h, real8 *hinv,
+                            int *isPeriodic, real8 a, real8 MU, real8 NU,
+                            int Nint, real8 *quad_points, real8 *weights,
+                            real8 *fseg)
+{
+    int   k;
+    real8 p1[3], p2[3], p3[3], p4[3], *b12, *b34;
+    real8 f1[3], f2[3], f3[3], f4[3];
+
+    for (k = 0; k < 3; k++) p1[k] = R1[3*i+k];
+    PBCClosestImage(h, hinv, isPeriodic, p1, &R2[3*i], p2);
+    PBCClosestImage(h, hinv, isPeriodic, p1, &R1[3*j], p3);
+    PBCClosestImage(h, hinv, isPeriodic, p3, &R2[3*j], p4);
+
+    b12 = &burgers[3*i];
+    b34 = &burgers[3*j];
+
+    if (Nint > 0) {
+        SegSegForce_SBN1_SBA(p1[0], p1[1], p1[2], p2[0], p2[1], p2[2],
+                             p3[0], p3[1], p3[2], p4[0], p4[1], p4[2],
+                             b12[0], b12[1], b12[2], b34[0], b34[1], b34[2],
+                             a, MU, NU, Nint, quad_points, weights, 1, 1,
+                             &f1[0], &f1[1], &f1[2], &f2[0], &f2[1], &f2[2],
+                             &f3[0], &f3[1], &f3[2], &f4[0], &f4[1], &f4[2]);
+    } else {
+        SegSegForce(p1[0], p1[1], p1[2], p2[0], p2[1], p2[2],
+                    p3[0], p3[1], p3[2], p4[0], p4[1], p4[2],
+                    b12[0], b12[1], b12[2], b34[0], b34[1], b34[2],
+                    a, MU, NU, 1, 1,
+                    &f1[0], &f1[1], &f1[2], &f2[0], &f2[1], &f2[2],
+                    &f3[0], &f3[1], &f3[2], &f4[0], &f4[1], &f4[2]);
+    }
+
+    for (k = 0; k < 3; k++) {
+#pragma omp atomic update
+        fseg[6*i+k]   += f1[k];
+#pragma omp atomic update
+        fseg[6*i+3+k] += f2[k];
+    }
+
+    if (j == i) return;
+
+    for (k = 0; k < 3; k++) {
+#pragma omp atomic update
+        fseg[6*j+k]   += f3[k];
+#pragma omp atomic update
+        fseg[6*j+3+k] += f4[k];
+    }
+}
+#ifdef _OPENMP
+#pragma omp end declare target
+#endif
+
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:       SegSegForceDeviceCompute
+ *      Description:    Evaluate the pairs of the current pair list (all
+ *                      pairs by default) for the uploaded segments on
+ *                      the device, one pair per device thread, and
+ *                      return the segment forces and the nodal forces
+ *                      assembled from them.  Arguments are as for
+ *                      SegSegForceAllPairs(); Nint may not exceed
+ *                      DEVICE_MAX_QUAD_POINTS.
+ *
+ *-----------------------------------------------------------------------*/
+void SegSegForceDeviceCompute(SegSegForceDevice_t *dev,
+                              int numNodes, int *nodeIDs,
+                              real8 *h, real8 *hinv, int *isPeriodic,
+                              real8 a, real8 MU, real8 NU,
+                              int Nint, real8 *quad_points, real8 *weights,
+                              real8 *segForces, real8 *nodeForces)
+{
+    int   k, numSegs, numPairs, nq;
+    int   per[3];
+    real8 hh[9], hi[9], qp[DEVICE_MAX_QUAD_POINTS], w[DEVICE_MAX_QUAD_POINTS];
+    real8 *R1, *R2, *burgers, *fseg;
+    int   *pairs;
+
+    if (Nint > DEVICE_MAX_QUAD_POINTS) {
+        ErrorRaise("SegSegForceDeviceCompute: Nint = %d > %d",
+                Nint, DEVICE_MAX_QUAD_POINTS);
+    }
+
+    numSegs  = dev->numSegs;
+    numPairs = dev->numPairs;
+    R1       = dev->R1;
+    R2       = dev->R2;
+    burgers  = dev->burgers;
+    fseg     = dev->segForces;
+    pairs    = dev->pairs;
+
+    for (k = 0; k < 9; k++) {
+        hh[k] = h[k];
+        hi[k] = hinv[k];
+    }
+    for (k = 0; k < 3; k++) {
+        per[k] = (isPeriodic != NULL) ? isPeriodic[k] : 0;
+    }
+    nq = (Nint > 0) ? Nint : 1;
+    for (k = 0; k < nq; k++) {
+        qp[k] = (Nint > 0) ? quad_points[k] : 0.0;
+        w[k]  = (Nint > 0) ? weights[k] : 0.0;
+    }
+
+    if (numSegs > 0) {
+
+#pragma omp target teams distribute parallel for device(dev->device) \
+        is_device_ptr(fseg)
+        for (k = 0; k < 6*numSegs; k++) {
+            fseg[k] = 0.0;
+        }
+
+        if (numPairs < 0) {
+            int i, j;
+#pragma omp target teams distribute device(dev->device) \
+        is_device_ptr(R1, R2, burgers, fseg) \
+        map(to: hh[0:9], hi[0:9], per[0:3], qp[0:nq], w[0:nq])
+            for (i = 0; i < numSegs; i++) {
+#pragma omp parallel for
+                for (j = i; j < numSegs; j++) {
+                    DevicePairForce(i, j, R1, R2, burgers, hh, hi, per,
+                                    a, MU, NU, Nint, qp, w, fseg);
+                }
+            }
+        } else {
+            int p;
+#pragma omp target teams distribute parallel for device(dev->device) \
+        is_device_ptr(R1, R2, burgers, fseg, pairs) \
+        map(to: hh[0:9], hi[0:9], per[0:3], qp[0:nq], w[0:nq])
+            for (p = 0; p < numPairs; p++) {
+                DevicePairForce(pairs[2*p], pairs[2*p+1], R1, R2, burgers,
+                                hh, hi, per, a, MU, NU, Nint, qp, w, fseg);
+            }
+        }
+    }
+
+    CopyFromDevice(segForces, fseg, 6 * (size_t)numSegs * sizeof(real8),
+                   dev->device);
+
+    AssembleNodeForces(numNodes, numSegs, nodeIDs, segForces, nodeForces);
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:       SegStressDeviceAtPoints
+ *      Description:    Device version of SegStressAtPoints() with the
+ *                      coordinate independent stress: add the stress of
+ *                      the uploaded segments (R1 -> R2 as uploaded, no
+ *                      periodic images) at numPoints field points to the
+ *                      host array stress [numPoints][6] (xx, yy, zz, xy,
+ *                      yz, xz).  One device thread per field point.
+ *
+ *-----------------------------------------------------------------------*/
+void SegStressDeviceAtPoints(SegSegForceDevice_t *dev,
+                             int numPoints, real8 *points,
+                             real8 a, real8 MU, real8 NU, real8 *stress)
+{
+    int   k, numSegs;
+    real8 *R1, *R2, *burgers;
+
+    numSegs = dev->numSegs;
+    R1      = dev->R1;
+    R2      = dev->R2;
+    burgers = dev->burgers;
+
+    if (numPoints <= 0 || numSegs <= 0) return;
+
+#pragma omp target teams distribute parallel for device(dev->device) \
+        is_device_ptr(R1, R2, burgers) \
+        map(to: points[0:3*numPoints]) map(tofrom: stress[0:6*numPoints])
+    for (k = 0; k < numPoints; k++) {
+        int   j, m;
+        real8 s[6] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0}, sigma_vec[6];
+        real8 *p1, *p2, *b, dx, dy, dz;
+
+        for (j = 0; j < numSegs; j++) {
+            p1 = &R1[3*j];
+            p2 = &R2[3*j];
+            b  = &burgers[3*j];
+
+            dx = p2[0] - p1[0];
+            dy = p2[1] - p1[1];
+            dz = p2[2] - p1[2];
+            if (dx*dx + dy*dy + dz*dz == 0.0) continue;
+
+            StressDueToSeg(points[3*k], points[3*k+1], points[3*k+2],
+                           p1[0], p1[1], p1[2], p2[0], p2[1], p2[2],
+                           b[0], b[1], b[2], a, MU, NU, sigma_vec);
+            for (m = 0; m < 6; m++) s[m] += sigma_vec[m];
+        }
+
+        for (m = 0; m < 6; m++) stress[6*k+m] += s[m];
+    }
+}
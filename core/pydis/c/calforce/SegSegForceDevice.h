@@ -0,0 +1,48 @@
+#ifndef _SegSegForceDevice_h
+#define _SegSegForceDevice_h
+
+#include <math.h>
+#define real8 double
+
+/*
+ *      Segment and pair buffers of the device (GPU) force backend.
+ *      The buffers live in the memory of an OpenMP target device and
+ *      persist between calls, so that a pair list set once can be
+ *      reused over many timesteps while only the segment positions
+ *      are uploaded.  Without an offload capable build all target
+ *      regions run on the host.
+ */
+typedef struct _segsegforcedevice {
+        int   device;        /* OpenMP device number                    */
+        int   numSegs;       /* segments currently uploaded             */
+        int   maxSegs;       /* capacity of the segment buffers         */
+        int   numPairs;      /* pairs in the list, -1 for all pairs     */
+        int   maxPairs;      /* capacity of the pair buffer             */
+        real8 *R1, *R2;      /* [maxSegs][3] device segment end points  */
+        real8 *burgers;      /* [maxSegs][3] device burgers vectors     */
+        real8 *segForces;    /* [maxSegs][6] device segment forces      */
+        int   *pairs;        /* [maxPairs][2] device pair list          */
+} SegSegForceDevice_t;
+
+SegSegForceDevice_t *SegSegForceDeviceCreate(int device);
+void SegSegForceDeviceFree(SegSegForceDevice_t *dev);
+int  SegSegForceDeviceIsOffloaded(SegSegForceDevice_t *dev);
+
+void SegSegForceDeviceSetSegments(SegSegForceDevice_t *dev, int numSegs,
+                                  real8 *R1, real8 *R2, real8 *burgers);
+
+void SegSegForceDeviceSetPairs(SegSegForceDevice_t *dev, int numPairs,
+                               int *pairs);
+
+void SegSegForceDeviceCompute(SegSegForceDevice_t *dev,
+                              int numNodes, int *nodeIDs,
+                              real8 *h, real8 *hinv, int *isPeriodic,
+                              real8 a, real8 MU, real8 NU,
+                              int Nint, real8 *quad_points, real8 *weights,
+                              real8 *segForces, real8 *nodeForces);
+
+void SegStressDeviceAtPoints(SegSegForceDevice_t *dev,
+                             int numPoints, real8 *points,
+                             real8 a, real8 MU, real8 NU, real8 *stress);
+
+#endif  /* _SegSegForceDevice_h */
@@ -0,0 +1,1113 @@
+#include "SegSegForceDriver.h"
+#include "SegSegForceBatch.h"
+#include "SegSegForceSIMD.h"
+#include "../include/Profile.h"
+#include "../include/Error.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/**************************************************************************
+ *
+ *      Function:    PBCClosestImage
+ *      Description: Find the periodic image of R closest to Rref in a
+ *                   (possibly triclinic) simulation cell.  Same as
+ *                   Cell.closest_image() on the python side.
+ *
+ *      Arguments:
+ *         h            3x3 cell matrix (row-major, cell vectors are
+ *                      the columns)
+ *         hinv         inverse of h
+ *         isPeriodic   3 flags, non-zero for periodic directions.  May
+ *                      be NULL if no direction is periodic.
+ *         Rref         reference position
+ *         R            position to be mapped
+ *         Rimage       returned image of R; may be the same array as R
+ *
+ *************************************************************************/
+#ifdef _OPENMP
+#pragma omp declare target
+#endif
+void PBCClosestImage(real8 *h, real8 *hinv, int *isPeriodic,
+                     real8 *Rref, real8 *R, real8 *Rimage)
+{
+    int   i;
+    real8 dr[3], ds[3];
+
+    if (isPeriodic == NULL ||
+        (!isPeriodic[0] && !isPeriodic[1] && !isPeriodic[2])) {
+        if (Rimage != R) {
+            Rimage[0] = R[0]; Rimage[1] = R[1]; Rimage[2] = R[2];
+        }
+        return;
+    }
+
+    for (i = 0; i < 3; i++) {
+        dr[i] = R[i] - Rref[i];
+    }
+
+    for (i = 0; i < 3; i++) {
+        ds[i] = hinv[3*i]*dr[0] + hinv[3*i+1]*dr[1] + hinv[3*i+2]*dr[2];
+        if (isPeriodic[i]) ds[i] -= rint(ds[i]);
+    }
+
+    for (i = 0; i < 3; i++) {
+        Rimage[i] = h[3*i]*ds[0] + h[3*i+1]*ds[1] + h[3*i+2]*ds[2] + Rref[i];
+    }
+}
+#ifdef _OPENMP
+#pragma omp end declare target
+#endif
+
+
+/**************************************************************************
+ *
+ *      Function:    CellNeighborIndices
+ *      Description: Return the distinct cell indices along one cell
+ *                   direction within one cell of <c>, wrapping around for
+ *                   periodic directions.
+ *
+ *************************************************************************/
+void CellNeighborIndices(int c, int n, int periodic, int nbr[3], int *numNbr)
+{
+    int d, k, idx, dup;
+
+    *numNbr = 0;
+
+    for (d = -1; d <= 1; d++) {
+        idx = c + d;
+        if (periodic) {
+            idx = (idx + n) % n;
+        } else if (idx < 0 || idx >= n) {
+            continue;
+        }
+        dup = 0;
+        for (k = 0; k < *numNbr; k++) {
+            if (nbr[k] == idx) dup = 1;
+        }
+        if (!dup) nbr[(*numNbr)++] = idx;
+    }
+}
+
+
+/**************************************************************************
+ *
+ *      Function:    BinSegmentsInCells
+ *      Description: Assign segments to a regular grid of cells based on
+ *                   their midpoints and sort them by cell (counting sort).
+ *                   Cells are defined in the fractional coordinates of
+ *                   the simulation cell; along free directions the grid
+ *                   spans the extent of the midpoints.  The number of
+ *                   cells per direction is chosen such that cells are at
+ *                   least <cellMin> wide.
+ *
+ *      Arguments:
+ *         numSegs      number of segments
+ *         mid          [numSegs][3] segment midpoints
+ *         hinv         inverse of the cell matrix
+ *         isPeriodic   periodicity flags
+ *         cellMin      minimum cell width
+ *         nCells       returned number of cells in each direction
+ *         cellStart    returned [numCells+1] offsets into cellSegs
+ *         cellSegs     returned [numSegs] segment indices sorted by cell
+ *         segCell      returned [numSegs] cell index of each segment
+ *
+ *************************************************************************/
+void BinSegmentsInCells(int numSegs, real8 *mid,
+                        real8 *hinv, int *isPeriodic,
+                        real8 cellMin, int nCells[3],
+                        int **cellStart, int **cellSegs, int **segCell)
+{
+    int   i, d, c, idx[3], numCells, *start, *segs, *cellOf;
+    real8 *s, smin[3], smax[3], span, width;
+
+    s = (real8 *)malloc(3 * numSegs * sizeof(real8));
+
+    for (d = 0; d < 3; d++) {
+        smin[d] = 1.0e+30;
+        smax[d] = -1.0e+30;
+    }
+
+    for (i = 0; i < numSegs; i++) {
+        for (d = 0; d < 3; d++) {
+            s[3*i+d] = hinv[3*d]*mid[3*i] + hinv[3*d+1]*mid[3*i+1] +
+                       hinv[3*d+2]*mid[3*i+2];
+            if (isPeriodic != NULL && isPeriodic[d]) {
+                s[3*i+d] -= floor(s[3*i+d]);
+            }
+            if (s[3*i+d] < smin[d]) smin[d] = s[3*i+d];
+            if (s[3*i+d] > smax[d]) smax[d] = s[3*i+d];
+        }
+    }
+
+    for (d = 0; d < 3; d++) {
+        if (isPeriodic != NULL && isPeriodic[d]) {
+            smin[d] = 0.0;
+            smax[d] = 1.0;
+        }
+        span = smax[d] - smin[d];
+/*
+ *      Width of the grid normal to the planes s[d] = const
+ */
+        width = span / sqrt(hinv[3*d]*hinv[3*d] + hinv[3*d+1]*hinv[3*d+1] +
+                            hinv[3*d+2]*hinv[3*d+2]);
+        nCells[d] = (cellMin > 0.0) ? (int)floor(width / cellMin) : 1;
+        if (nCells[d] < 1) nCells[d] = 1;
+        if (nCells[d] > numSegs) nCells[d] = numSegs;
+        if (span <= 0.0) {
+            smax[d] = smin[d] + 1.0;
+            nCells[d] = 1;
+        }
+    }
+
+/*
+ *  Limit the number of (mostly empty) cells for sparse networks
+ */
+    while ((double)nCells[0] * nCells[1] * nCells[2] > 8.0 * numSegs + 27.0) {
+        d = (nCells[0] >= nCells[1]) ? 0 : 1;
+        if (nCells[2] > nCells[d]) d = 2;
+        nCells[d] = (nCells[d] + 1) / 2;
+    }
+
+    numCells = nCells[0] * nCells[1] * nCells[2];
+
+    start  = (int *)calloc(numCells + 1, sizeof(int));
+    segs   = (int *)malloc(numSegs * sizeof(int));
+    cellOf = (int *)malloc(numSegs * sizeof(int));
+
+    for (i = 0; i < numSegs; i++) {
+        for (d = 0; d < 3; d++) {
+            idx[d] = (int)((s[3*i+d] - smin[d]) / (smax[d] - smin[d]) * nCells[d]);
+            if (idx[d] < 0) idx[d] = 0;
+            if (idx[d] >= nCells[d]) idx[d] = nCells[d] - 1;
+        }
+        c = (idx[0]*nCells[1] + idx[1])*nCells[2] + idx[2];
+        cellOf[i] = c;
+        start[c+1]++;
+    }
+
+    for (c = 0; c < numCells; c++) {
+        start[c+1] += start[c];
+    }
+
+    for (i = 0; i < numSegs; i++) {
+        segs[start[cellOf[i]]++] = i;
+    }
+
+/*
+ *  The fill loop advanced each offset to the start of the next cell,
+ *  shift them back.
+ */
+    for (c = numCells; c > 0; c--) {
+        start[c] = start[c-1];
+    }
+    start[0] = 0;
+
+    free(s);
+
+    *cellStart = start;
+    *cellSegs  = segs;
+    *segCell   = cellOf;
+}
+
+
+/**************************************************************************
+ *
+ *      Function:    MixedPrecisionFar
+ *      Description: Whether the pair p1->p2, p3->p4 is evaluated in
+ *                   single precision under a policy with the given distance:
+ *                   the midpoints are farther apart than <distance> and
+ *                   than SEGSEG_FAR_RATIO times the longer segment.
+ *
+ *************************************************************************/
+static int MixedPrecisionFar(real8 distance,
+                             real8 *p1, real8 *p2, real8 *p3, real8 *p4)
+{
+    int   k;
+    real8 d, Rc2 = 0.0, L12 = 0.0, L34 = 0.0, L2;
+
+    for (k = 0; k < 3; k++) {
+        d = 0.5 * (p1[k] + p2[k] - p3[k] - p4[k]);
+        Rc2 += d*d;
+        d = p2[k] - p1[k];
+        L12 += d*d;
+        d = p4[k] - p3[k];
+        L34 += d*d;
+    }
+    L2 = (L12 > L34) ? L12 : L34;
+
+    return (Rc2 > distance*distance &&
+            Rc2 > SEGSEG_FAR_RATIO*SEGSEG_FAR_RATIO*L2);
+}
+
+
+/**************************************************************************
+ *
+ *      Function:    MixedPrecisionCheck
+ *      Description: Accumulate the differences between the single
+ *                   precision forces f1..f4 of numPairs pairs and the
+ *                   double precision SegSegForceIsotropicSIMD() ones into
+ *                   the statistics of the policy.
+ *
+ *************************************************************************/
+static void MixedPrecisionCheck(SegSegMixed_t *mixed, int numPairs,
+                                real8 *p1, real8 *p2, real8 *p3, real8 *p4,
+                                real8 *b12, real8 *b34,
+                                real8 a, real8 MU, real8 NU,
+                                real8 *f1, real8 *f2, real8 *f3, real8 *f4)
+{
+    int   k, m;
+    real8 d, err2 = 0.0, norm2 = 0.0, errMax = 0.0;
+    real8 g1[3*SEGSEG_DRIVER_CHUNK], g2[3*SEGSEG_DRIVER_CHUNK];
+    real8 g3[3*SEGSEG_DRIVER_CHUNK], g4[3*SEGSEG_DRIVER_CHUNK];
+    real8 *f[4] = {f1, f2, f3, f4}, *g[4] = {g1, g2, g3, g4};
+
+    SegSegForceIsotropicSIMD(numPairs, p1, p2, p3, p4, b12, b34,
+                             a, MU, NU, 1, 1, g1, g2, g3, g4);
+
+    for (m = 0; m < 4; m++) {
+        for (k = 0; k < 3*numPairs; k++) {
+            d = f[m][k] - g[m][k];
+            err2  += d*d;
+            norm2 += g[m][k]*g[m][k];
+            if (fabs(d) > errMax) errMax = fabs(d);
+        }
+    }
+
+#pragma omp critical (SegSegForceMixedStats)
+    {
+        mixed->stats[SEGSEG_MIXED_PAIRS]   += numPairs;
+        mixed->stats[SEGSEG_MIXED_CHECKED] += numPairs;
+        mixed->stats[SEGSEG_MIXED_ERR2]    += err2;
+        mixed->stats[SEGSEG_MIXED_NORM2]   += norm2;
+        if (errMax > mixed->stats[SEGSEG_MIXED_ERRMAX]) {
+            mixed->stats[SEGSEG_MIXED_ERRMAX] = errMax;
+        }
+    }
+}
+
+
+/**************************************************************************
+ *
+ *      Function:    SegSegForceRow
+ *      Description: Evaluate the interactions of segment i with the
+ *                   segments jList[0..numPairs-1] (or i, i+1, ... if
+ *                   jList is NULL) and accumulate the forces into the
+ *                   [numSegs][6] array fseg.  The pairs are gathered in
+ *                   chunks of SEGSEG_DRIVER_CHUNK for the batched
+ *                   kernels.  If j == i only the forces on segment i are
+ *                   accumulated (self force).  Pairs are evaluated with
+ *                   SegSegForce_SBN1_SBA() if an SBN1 context is given,
+ *                   analytically otherwise.
+ *
+ *                   If a mixed precision policy is given (mixed != NULL
+ *                   and mixed->distance > 0), the analytic pairs whose
+ *                   midpoints are farther apart than mixed->distance and
+ *                   than SEGSEG_FAR_RATIO times the longer segment are
+ *                   evaluated in single precision with
+ *                   SegSegForceIsotropicSIMDF(), all others (including
+ *                   the near-parallel SpecialSegSegForce() cases) in
+ *                   double precision.  The number of single precision
+ *                   pairs is added to mixed->stats; if mixed->check is
+ *                   set they are evaluated in double precision as well
+ *                   and the differences are accumulated (checked pairs,
+ *                   sums of the squared force differences and of the
+ *                   squared double precision forces, largest difference
+ *                   of a force component), for debug runs.  The policy
+ *                   belongs to the caller, concurrent driver calls with
+ *                   different policies do not interfere.
+ *
+ *************************************************************************/
+void SegSegForceRow(int i, int numPairs, int *jList,
+                    real8 *R1, real8 *R2, real8 *burgers,
+                    real8 *h, real8 *hinv, int *isPeriodic,
+                    real8 a, real8 MU, real8 NU,
+                    SBN1Context_t *sbn1, SegSegMixed_t *mixed,
+                    real8 *fseg)
+{
+    int   j, k, m, n, m0, s, numNear, numFar;
+    int   jIndex[SEGSEG_DRIVER_CHUNK];
+    real8 p1[3], p2[3], q3[3], q4[3];
+    real8 p3[3*SEGSEG_DRIVER_CHUNK], p4[3*SEGSEG_DRIVER_CHUNK];
+    real8 p1v[3*SEGSEG_DRIVER_CHUNK], p2v[3*SEGSEG_DRIVER_CHUNK];
+    real8 b12[3*SEGSEG_DRIVER_CHUNK], b34[3*SEGSEG_DRIVER_CHUNK];
+    real8 f1[3*SEGSEG_DRIVER_CHUNK], f2[3*SEGSEG_DRIVER_CHUNK];
+    real8 f3[3*SEGSEG_DRIVER_CHUNK], f4[3*SEGSEG_DRIVER_CHUNK];
+
+    for (k = 0; k < 3; k++) p1[k] = R1[3*i+k];
+    PBCClosestImage(h, hinv, isPeriodic, p1, &R2[3*i], p2);
+
+    for (m0 = 0; m0 < numPairs; m0 += SEGSEG_DRIVER_CHUNK) {
+
+        n = numPairs - m0;
+        if (n > SEGSEG_DRIVER_CHUNK) n = SEGSEG_DRIVER_CHUNK;
+
+/*
+ *      Gather the chunk with the pairs to evaluate in double precision
+ *      first and the single precision ones (if any) at the end.
+ */
+        numNear = 0;
+        numFar  = 0;
+
+        for (m = 0; m < n; m++) {
+            j = (jList == NULL) ? i + m0 + m : jList[m0+m];
+            PBCClosestImage(h, hinv, isPeriodic, p1, &R1[3*j], q3);
+            PBCClosestImage(h, hinv, isPeriodic, q3, &R2[3*j], q4);
+            if (sbn1 == NULL && mixed != NULL && mixed->distance > 0.0 &&
+                j != i && MixedPrecisionFar(mixed->distance, p1, p2, q3, q4)) {
+                s = n - 1 - numFar++;
+            } else {
+                s = numNear++;
+            }
+            jIndex[s] = j;
+            for (k = 0; k < 3; k++) {
+                p1v[3*s+k] = p1[k];
+                p2v[3*s+k] = p2[k];
+                p3[3*s+k]  = q3[k];
+                p4[3*s+k]  = q4[k];
+                b12[3*s+k] = burgers[3*i+k];
+                b34[3*s+k] = burgers[3*j+k];
+            }
+        }
+
+        if (sbn1 != NULL) {
+            SegSegForce_SBN1_SBA_BatchCtx(n, p1v, p2v, p3, p4, b12, b34,
+                                          a, MU, NU, sbn1, 1, 1,
+                                          f1, f2, f3, f4);
+        } else {
+            SegSegForceIsotropicSIMD(numNear, p1v, p2v, p3, p4, b12, b34,
+                                     a, MU, NU, 1, 1, f1, f2, f3, f4);
+        }
+
+        if (numFar > 0) {
+            k = 3*numNear;
+            SegSegForceIsotropicSIMDF(numFar, &p1v[k], &p2v[k], &p3[k], &p4[k],
+                                      &b12[k], &b34[k], a, MU, NU, 1, 1,
+                                      &f1[k], &f2[k], &f3[k], &f4[k]);
+            if (mixed->check) {
+                MixedPrecisionCheck(mixed, numFar,
+                                    &p1v[k], &p2v[k], &p3[k], &p4[k],
+                                    &b12[k], &b34[k], a, MU, NU,
+                                    &f1[k], &f2[k], &f3[k], &f4[k]);
+            } else {
+#pragma omp atomic update
+                mixed->stats[SEGSEG_MIXED_PAIRS] += numFar;
+            }
+        }
+
+        for (m = 0; m < n; m++) {
+            j = jIndex[m];
+            for (k = 0; k < 3; k++) {
+                fseg[6*i+k]   += f1[3*m+k];
+                fseg[6*i+3+k] += f2[3*m+k];
+            }
+            if (j == i) continue;
+            for (k = 0; k < 3; k++) {
+                fseg[6*j+k]   += f3[3*m+k];
+                fseg[6*j+3+k] += f4[3*m+k];
+            }
+        }
+    }
+}
+
+
+/**************************************************************************
+ *
+ *      Function:    AssembleNodeForces
+ *      Description: Sum the segment end forces into nodal forces.
+ *
+ *************************************************************************/
+void AssembleNodeForces(int numNodes, int numSegs, int *nodeIDs,
+                        real8 *segForces, real8 *nodeForces)
+{
+    int i, k, n;
+
+    memset(nodeForces, 0, 3 * numNodes * sizeof(real8));
+
+    for (i = 0; i < numSegs; i++) {
+        n = nodeIDs[2*i];
+        for (k = 0; k < 3; k++) nodeForces[3*n+k] += segForces[6*i+k];
+        n = nodeIDs[2*i+1];
+        for (k = 0; k < 3; k++) nodeForces[3*n+k] += segForces[6*i+3+k];
+    }
+}
+
+
+/**************************************************************************
+ *
+ *      Function:    AllocThreadSegForces
+ *      Description: Allocate one zeroed [numSegs][6] force buffer per
+ *                   OpenMP thread.  Returns NULL if out of memory, so
+ *                   that the caller can release its own buffers before
+ *                   raising the error.
+ *
+ *************************************************************************/
+real8 *AllocThreadSegForces(int numSegs, int *numThreads)
+{
+    real8 *buf;
+
+#ifdef _OPENMP
+    *numThreads = omp_get_max_threads();
+#else
+    *numThreads = 1;
+#endif
+
+    buf = (real8 *)calloc((size_t)(*numThreads) * 6 * numSegs, sizeof(real8));
+
+    return buf;
+}
+
+
+/**************************************************************************
+ *
+ *      Function:    SegSegForceDriverContext
+ *      Description: Create the SBN1 context shared by all pairs of a
+ *                   driver call, with the material constants of a, MU,
+ *                   NU derived once, or return NULL if Nint is zero
+ *                   (all pairs analytic).  May raise an error, the
+ *                   drivers create it before allocating their buffers.
+ *
+ *************************************************************************/
+SBN1Context_t *SegSegForceDriverContext(int Nint, real8 *quad_points,
+                                        real8 *weights,
+                                        real8 a, real8 MU, real8 NU)
+{
+    SBN1Context_t *sbn1;
+
+    if (Nint <= 0) return(NULL);
+
+    sbn1 = SBN1ContextCreate(Nint, quad_points, weights);
+    SBN1ContextSetMaterial(sbn1, a, MU, NU);
+
+    return(sbn1);
+}
+
+
+/**************************************************************************
+ *
+ *      Function:    SegSegForceAllPairs
+ *      Description: Compute the elastic interaction forces among all
+ *                   segments of a network (including the self force of
+ *                   each segment) in a single call.  Rows of the
+ *                   triangular pair loop are distributed over OpenMP
+ *                   threads; each thread accumulates its segment forces
+ *                   into a private buffer and the buffers are reduced
+ *                   once all pairs have been evaluated.  Pairs of a row
+ *                   are processed in chunks of SEGSEG_DRIVER_CHUNK with
+ *                   the batched kernels.
+ *
+ *      Arguments:
+ *         numNodes     number of nodes
+ *         numSegs      number of segments
+ *         nodeIDs      [numSegs][2] indices of the two end nodes of
+ *                      each segment
+ *         R1, R2       [numSegs][3] positions of the end nodes
+ *         burgers      [numSegs][3] burgers vector of each segment
+ *                      (from node 1 to node 2)
+ *         h, hinv      3x3 cell matrix and its inverse
+ *         isPeriodic   periodicity flags for the 3 cell directions
+ *         a            core value
+ *         MU           shear modulus
+ *         NU           poisson ratio
+ *         Nint         number of quadrature points.  If zero, all pairs
+ *                      are evaluated analytically (SBA), otherwise
+ *                      with SegSegForce_SBN1_SBA().
+ *         quad_points  Nint quadrature points (ignored if Nint == 0)
+ *         weights      Nint quadrature weights (ignored if Nint == 0)
+ *         mixed        mixed precision policy of the analytic pairs and
+ *                      its statistics (see SegSegForceRow()), or NULL
+ *                      to evaluate all pairs in double precision
+ *         segForces    [numSegs][6] returned forces on the two end
+ *                      nodes of each segment
+ *         nodeForces   [numNodes][3] returned nodal forces
+ *
+ *************************************************************************/
+void SegSegForceAllPairs(int numNodes, int numSegs, int *nodeIDs,
+                         real8 *R1, real8 *R2, real8 *burgers,
+                         real8 *h, real8 *hinv, int *isPeriodic,
+                         real8 a, real8 MU, real8 NU,
+                         int Nint, real8 *quad_points, real8 *weights,
+                         SegSegMixed_t *mixed,
+                         real8 *segForces, real8 *nodeForces)
+{
+    int   numThreads;
+    real8 *threadSegForces;
+    SBN1Context_t *sbn1;
+
+    memset(segForces, 0, 6 * numSegs * sizeof(real8));
+    memset(nodeForces, 0, 3 * numNodes * sizeof(real8));
+
+    if (numSegs <= 0) return;
+
+    sbn1 = SegSegForceDriverContext(Nint, quad_points, weights, a, MU, NU);
+    threadSegForces = AllocThreadSegForces(numSegs, &numThreads);
+    if (threadSegForces == NULL) {
+        SBN1ContextFree(sbn1);
+        ErrorRaise("SegSegForceAllPairs: out of memory");
+    }
+
+    ProfileStart(PROFILE_FORCE);
+
+#pragma omp parallel num_threads(numThreads)
+    {
+        int   i, k, m, threadID;
+        real8 *fseg;
+
+#ifdef _OPENMP
+        threadID = omp_get_thread_num();
+#else
+        threadID = 0;
+#endif
+        fseg = &threadSegForces[(size_t)threadID * 6 * numSegs];
+
+#pragma omp for schedule(dynamic, 1)
+        for (i = 0; i < numSegs; i++) {
+            SegSegForceRow(i, numSegs - i, NULL, R1, R2, burgers,
+                           h, hinv, isPeriodic, a, MU, NU,
+                           sbn1, mixed, fseg);
+        }
+
+/*
+ *      Reduce the thread-private segment forces.  The implicit barrier
+ *      at the end of the loop above guarantees all buffers are final.
+ */
+#pragma omp for schedule(static)
+        for (k = 0; k < 6*numSegs; k++) {
+            real8 sum = 0.0;
+            for (m = 0; m < numThreads; m++) {
+                sum += threadSegForces[(size_t)m * 6 * numSegs + k];
+            }
+            segForces[k] = sum;
+        }
+    }
+
+    free(threadSegForces);
+    SBN1ContextFree(sbn1);
+
+    AssembleNodeForces(numNodes, numSegs, nodeIDs, segForces, nodeForces);
+
+    ProfileCount(PROFILE_PAIRS, (long long)numSegs * (numSegs + 1) / 2);
+    ProfileStop(PROFILE_FORCE);
+}
+
+
+/**************************************************************************
+ *
+ *      Function:    SegSegForceAllPairsMulti
+ *      Description: Version of SegSegForceAllPairs() for several
+ *                   independent networks sharing the elastic constants,
+ *                   quadrature and cell, whose segments are stored one
+ *                   network after the other.  All pairs within each
+ *                   network are evaluated, none between networks, and
+ *                   the rows of all networks are distributed over the
+ *                   threads together, so that small networks still keep
+ *                   all threads busy.
+ *
+ *      Arguments:
+ *         numNodes     total number of nodes
+ *         numSegs      total number of segments
+ *         numNetworks  number of networks
+ *         segOffset    [numNetworks+1] index of the first segment of
+ *                      each network, segOffset[numNetworks] = numSegs
+ *         nodeIDs      [numSegs][2] indices of the end nodes of each
+ *                      segment in the nodes of all networks
+ *         (others)     same as SegSegForceAllPairs()
+ *
+ *************************************************************************/
+void SegSegForceAllPairsMulti(int numNodes, int numSegs,
+                              int numNetworks, int *segOffset, int *nodeIDs,
+                              real8 *R1, real8 *R2, real8 *burgers,
+                              real8 *h, real8 *hinv, int *isPeriodic,
+                              real8 a, real8 MU, real8 NU,
+                              int Nint, real8 *quad_points, real8 *weights,
+                              SegSegMixed_t *mixed,
+                              real8 *segForces, real8 *nodeForces)
+{
+    int       n, numThreads;
+    long long numPairs;
+    real8     *threadSegForces;
+    SBN1Context_t *sbn1;
+
+    if (numNetworks < 1 || segOffset[0] != 0 ||
+        segOffset[numNetworks] != numSegs) {
+        ErrorRaise("SegSegForceAllPairsMulti: segment offsets do not "
+                "span the %d segments", numSegs);
+    }
+
+    for (n = 0; n < numNetworks; n++) {
+        if (segOffset[n+1] < segOffset[n]) {
+            ErrorRaise("SegSegForceAllPairsMulti: decreasing segment "
+                    "offset of network %d", n+1);
+        }
+    }
+
+    memset(segForces, 0, 6 * numSegs * sizeof(real8));
+    memset(nodeForces, 0, 3 * numNodes * sizeof(real8));
+
+    if (numSegs <= 0) return;
+
+    sbn1 = SegSegForceDriverContext(Nint, quad_points, weights, a, MU, NU);
+    threadSegForces = AllocThreadSegForces(numSegs, &numThreads);
+    if (threadSegForces == NULL) {
+        SBN1ContextFree(sbn1);
+        ErrorRaise("SegSegForceAllPairsMulti: out of memory");
+    }
+
+    ProfileStart(PROFILE_FORCE);
+
+#pragma omp parallel num_threads(numThreads)
+    {
+        int   i, k, m, net, threadID;
+        real8 *fseg;
+
+#ifdef _OPENMP
+        threadID = omp_get_thread_num();
+#else
+        threadID = 0;
+#endif
+        fseg = &threadSegForces[(size_t)threadID * 6 * numSegs];
+
+/*
+ *      The row loops of the networks are not separated by barriers, a
+ *      thread done with its rows of one network moves on to the next.
+ */
+        for (net = 0; net < numNetworks; net++) {
+#pragma omp for schedule(dynamic, 1) nowait
+            for (i = segOffset[net]; i < segOffset[net+1]; i++) {
+                SegSegForceRow(i, segOffset[net+1] - i, NULL, R1, R2, burgers,
+                               h, hinv, isPeriodic, a, MU, NU,
+                               sbn1, mixed, fseg);
+            }
+        }
+
+#pragma omp barrier
+
+#pragma omp for schedule(static)
+        for (k = 0; k < 6*numSegs; k++) {
+            real8 sum = 0.0;
+            for (m = 0; m < numThreads; m++) {
+                sum += threadSegForces[(size_t)m * 6 * numSegs + k];
+            }
+            segForces[k] = sum;
+        }
+    }
+
+    free(threadSegForces);
+    SBN1ContextFree(sbn1);
+
+    AssembleNodeForces(numNodes, numSegs, nodeIDs, segForces, nodeForces);
+
+    numPairs = 0;
+    for (n = 0; n < numNetworks; n++) {
+        long long m = segOffset[n+1] - segOffset[n];
+        numPairs += m * (m + 1) / 2;
+    }
+
+    ProfileCount(PROFILE_PAIRS, numPairs);
+    ProfileStop(PROFILE_FORCE);
+}
+
+
+/**************************************************************************
+ *
+ *      Function:    SegSegForceCellList
+ *      Description: Near-field version of SegSegForceAllPairs().  The
+ *                   segments are binned by midpoint into a regular grid
+ *                   of cells (the same decomposition ParaDiS uses for
+ *                   its cell lists) whose widths are at least
+ *                   cutoff + the longest segment length.  Only pairs of
+ *                   segments in the same or neighboring cells whose
+ *                   midpoint distance minus their half lengths is at
+ *                   most cutoff are evaluated, which includes every
+ *                   pair whose closest approach is within cutoff.
+ *
+ *      Arguments:
+ *         cutoff       interaction cutoff distance
+ *         (others)     same as SegSegForceAllPairs()
+ *
+ *      Returns:  number of segment pairs evaluated (including the
+ *                numSegs self interactions).
+ *
+ *************************************************************************/
+int SegSegForceCellList(int numNodes, int numSegs, int *nodeIDs,
+                        real8 *R1, real8 *R2, real8 *burgers,
+                        real8 *h, real8 *hinv, int *isPeriodic,
+                        real8 cutoff,
+                        real8 a, real8 MU, real8 NU,
+                        int Nint, real8 *quad_points, real8 *weights,
+                        SegSegMixed_t *mixed,
+                        real8 *segForces, real8 *nodeForces)
+{
+    int   i, k, numThreads, numPairs = 0;
+    int   nCells[3], *cellStart, *cellSegs, *segCell;
+    real8 maxLen, cellMin;
+    real8 *mid, *halfLen, *threadSegForces;
+    SBN1Context_t *sbn1;
+
+    memset(segForces, 0, 6 * numSegs * sizeof(real8));
+    memset(nodeForces, 0, 3 * numNodes * sizeof(real8));
+
+    if (numSegs <= 0) return(0);
+
+    sbn1 = SegSegForceDriverContext(Nint, quad_points, weights, a, MU, NU);
+    mid     = (real8 *)malloc(3 * numSegs * sizeof(real8));
+    halfLen = (real8 *)malloc(numSegs * sizeof(real8));
+    threadSegForces = AllocThreadSegForces(numSegs, &numThreads);
+    if (mid == NULL || halfLen == NULL || threadSegForces == NULL) {
+        free(mid);
+        free(halfLen);
+        free(threadSegForces);
+        SBN1ContextFree(sbn1);
+        ErrorRaise("SegSegForceCellList: out of memory");
+    }
+
+    ProfileStart(PROFILE_FORCE);
+
+    maxLen = 0.0;
+
+    for (i = 0; i < numSegs; i++) {
+        real8 p2[3], dr[3];
+        PBCClosestImage(h, hinv, isPeriodic, &R1[3*i], &R2[3*i], p2);
+        for (k = 0; k < 3; k++) {
+            mid[3*i+k] = 0.5 * (R1[3*i+k] + p2[k]);
+            dr[k] = p2[k] - R1[3*i+k];
+        }
+        halfLen[i] = 0.5 * sqrt(dr[0]*dr[0] + dr[1]*dr[1] + dr[2]*dr[2]);
+        if (2.0*halfLen[i] > maxLen) maxLen = 2.0*halfLen[i];
+    }
+
+    cellMin = cutoff + maxLen;
+
+    BinSegmentsInCells(numSegs, mid, hinv, isPeriodic, cellMin,
+                       nCells, &cellStart, &cellSegs, &segCell);
+
+#pragma omp parallel num_threads(numThreads) reduction(+:numPairs)
+    {
+        int   i, j, k, m, n, d, threadID;
+        int   cell[3], nbr[3][3], numNbr[3], ix, iy, iz, c, numJ;
+        int   *jList;
+        real8 dr[3], midj[3], rmax;
+        real8 *fseg;
+
+#ifdef _OPENMP
+        threadID = omp_get_thread_num();
+#else
+        threadID = 0;
+#endif
+        fseg = &threadSegForces[(size_t)threadID * 6 * numSegs];
+        jList = (int *)malloc(numSegs * sizeof(int));
+
+#pragma omp for schedule(dynamic, 16)
+        for (i = 0; i < numSegs; i++) {
+
+            c = segCell[i];
+            cell[0] = c / (nCells[1]*nCells[2]);
+            cell[1] = (c / nCells[2]) % nCells[1];
+            cell[2] = c % nCells[2];
+
+            for (d = 0; d < 3; d++) {
+                CellNeighborIndices(cell[d], nCells[d],
+                                    isPeriodic != NULL && isPeriodic[d],
+                                    nbr[d], &numNbr[d]);
+            }
+
+            numJ = 0;
+
+            for (ix = 0; ix < numNbr[0]; ix++) {
+                for (iy = 0; iy < numNbr[1]; iy++) {
+                    for (iz = 0; iz < numNbr[2]; iz++) {
+                        c = (nbr[0][ix]*nCells[1] + nbr[1][iy])*nCells[2] + nbr[2][iz];
+                        for (m = cellStart[c]; m < cellStart[c+1]; m++) {
+                            j = cellSegs[m];
+                            if (j < i) continue;
+                            PBCClosestImage(h, hinv, isPeriodic, &mid[3*i],
+                                            &mid[3*j], midj);
+                            for (k = 0; k < 3; k++) dr[k] = midj[k] - mid[3*i+k];
+                            rmax = cutoff + halfLen[i] + halfLen[j];
+                            if (dr[0]*dr[0]+dr[1]*dr[1]+dr[2]*dr[2] > rmax*rmax) {
+                                continue;
+                            }
+                            jList[numJ++] = j;
+                        }
+                    }
+                }
+            }
+
+            numPairs += numJ;
+
+            SegSegForceRow(i, numJ, jList, R1, R2, burgers,
+                           h, hinv, isPeriodic, a, MU, NU,
+                           sbn1, mixed, fseg);
+        }
+
+        free(jList);
+
+#pragma omp for schedule(static)
+        for (k = 0; k < 6*numSegs; k++) {
+            real8 sum = 0.0;
+            for (n = 0; n < numThreads; n++) {
+                sum += threadSegForces[(size_t)n * 6 * numSegs + k];
+            }
+            segForces[k] = sum;
+        }
+    }
+
+    free(threadSegForces);
+    SBN1ContextFree(sbn1);
+    free(cellStart);
+    free(cellSegs);
+    free(segCell);
+    free(mid);
+    free(halfLen);
+
+    AssembleNodeForces(numNodes, numSegs, nodeIDs, segForces, nodeForces);
+
+    ProfileCount(PROFILE_PAIRS, numPairs);
+    ProfileStop(PROFILE_FORCE);
+
+    return(numPairs);
+}
+
+
+/**************************************************************************
+ *
+ *      Function:    SegSegForceSubset
+ *      Description: Evaluate only the segment pairs that involve at
+ *                   least one segment of subList (each such pair once,
+ *                   plus the self force of the listed segments), and
+ *                   return the resulting contributions to the forces on
+ *                   all segments.  This is the building block of
+ *                   incremental force updates: when only the segments in
+ *                   subList have changed, the forces on every other
+ *                   segment differ from a previous full evaluation by
+ *                   exactly these contributions, and the forces on the
+ *                   listed segments are exactly these contributions.
+ *
+ *      Arguments:
+ *         numSub       number of segments in subList
+ *         subList      [numSub] indices of the segments whose pairs are
+ *                      evaluated (no duplicates)
+ *         segForces    [numSegs][6] returned force contributions on the
+ *                      two end nodes of each segment
+ *         (others)     same as SegSegForceAllPairs()
+ *
+ *      Returns:  number of segment pairs evaluated.
+ *
+ *************************************************************************/
+int SegSegForceSubset(int numSegs, real8 *R1, real8 *R2, real8 *burgers,
+                      real8 *h, real8 *hinv, int *isPeriodic,
+                      int numSub, int *subList,
+                      real8 a, real8 MU, real8 NU,
+                      int Nint, real8 *quad_points, real8 *weights,
+                      SegSegMixed_t *mixed,
+                      real8 *segForces)
+{
+    int   i, numThreads, numPairs = 0;
+    int   *subRank;
+    real8 *threadSegForces;
+    SBN1Context_t *sbn1;
+
+    memset(segForces, 0, 6 * numSegs * sizeof(real8));
+
+    if (numSegs <= 0 || numSub <= 0) return(0);
+
+/*
+ *  subRank[j] is the position of segment j in subList, or -1.  A pair of
+ *  two listed segments is evaluated by the row of the earlier one only.
+ */
+    subRank = (int *)malloc(numSegs * sizeof(int));
+    if (subRank == NULL) {
+        ErrorRaise("SegSegForceSubset: out of memory");
+    }
+    for (i = 0; i < numSegs; i++) subRank[i] = -1;
+    for (i = 0; i < numSub; i++) {
+        if (subList[i] < 0 || subList[i] >= numSegs ||
+            subRank[subList[i]] >= 0) {
+            free(subRank);
+            ErrorRaise("SegSegForceSubset: invalid or duplicate "
+                    "segment index %d", subList[i]);
+        }
+        subRank[subList[i]] = i;
+    }
+
+    sbn1 = SegSegForceDriverContext(Nint, quad_points, weights, a, MU, NU);
+    threadSegForces = AllocThreadSegForces(numSegs, &numThreads);
+    if (threadSegForces == NULL) {
+        free(subRank);
+        SBN1ContextFree(sbn1);
+        ErrorRaise("SegSegForceSubset: out of memory");
+    }
+
+    ProfileStart(PROFILE_FORCE);
+
+#pragma omp parallel num_threads(numThreads) reduction(+:numPairs)
+    {
+        int   i, j, k, n, s, numJ, threadID;
+        int   *jList;
+        real8 *fseg;
+
+#ifdef _OPENMP
+        threadID = omp_get_thread_num();
+#else
+        threadID = 0;
+#endif
+        fseg = &threadSegForces[(size_t)threadID * 6 * numSegs];
+        jList = (int *)malloc(numSegs * sizeof(int));
+
+#pragma omp for schedule(dynamic, 1)
+        for (s = 0; s < numSub; s++) {
+            i = subList[s];
+            numJ = 0;
+            jList[numJ++] = i;
+            for (j = 0; j < numSegs; j++) {
+                if (j == i || (subRank[j] >= 0 && subRank[j] < s)) continue;
+                jList[numJ++] = j;
+            }
+
+            numPairs += numJ;
+
+            SegSegForceRow(i, numJ, jList, R1, R2, burgers,
+                           h, hinv, isPeriodic, a, MU, NU,
+                           sbn1, mixed, fseg);
+        }
+
+        free(jList);
+
+#pragma omp for schedule(static)
+        for (k = 0; k < 6*numSegs; k++) {
+            real8 sum = 0.0;
+            for (n = 0; n < numThreads; n++) {
+                sum += threadSegForces[(size_t)n * 6 * numSegs + k];
+            }
+            segForces[k] = sum;
+        }
+    }
+
+    free(threadSegForces);
+    SBN1ContextFree(sbn1);
+    free(subRank);
+
+    ProfileCount(PROFILE_PAIRS, numPairs);
+    ProfileStop(PROFILE_FORCE);
+
+    return(numPairs);
+}
+
+
+/**************************************************************************
+ *
+ *      Function:    SegSegForcePairList
+ *      Description: Version of SegSegForceAllPairs() that evaluates only
+ *                   the segment pairs of an explicit pair list (e.g. from
+ *                   a cell or Verlet list, see CellListPairs()), plus the
+ *                   self force of every segment.  The pairs are grouped
+ *                   by their first segment (counting sort) and each group
+ *                   is evaluated as one row.
+ *
+ *      Arguments:
+ *         numPairs     number of segment pairs
+ *         pairs        [numPairs][2] segment index pairs (i, j), i != j.
+ *                      Each pair must appear only once.
+ *         (others)     same as SegSegForceAllPairs()
+ *
+ *************************************************************************/
+void SegSegForcePairList(int numNodes, int numSegs, int *nodeIDs,
+                         real8 *R1, real8 *R2, real8 *burgers,
+                         real8 *h, real8 *hinv, int *isPeriodic,
+                         int numPairs, int *pairs,
+                         real8 a, real8 MU, real8 NU,
+                         int Nint, real8 *quad_points, real8 *weights,
+                         SegSegMixed_t *mixed,
+                         real8 *segForces, real8 *nodeForces)
+{
+    int   i, p, numThreads, *rowStart, *rowSegs;
+    real8 *threadSegForces;
+    SBN1Context_t *sbn1;
+
+    memset(segForces, 0, 6 * numSegs * sizeof(real8));
+    memset(nodeForces, 0, 3 * numNodes * sizeof(real8));
+
+    if (numSegs <= 0) return;
+
+    for (p = 0; p < numPairs; p++) {
+        if (pairs[2*p] < 0 || pairs[2*p] >= numSegs ||
+            pairs[2*p+1] < 0 || pairs[2*p+1] >= numSegs ||
+            pairs[2*p] == pairs[2*p+1]) {
+            ErrorRaise("SegSegForcePairList: invalid segment pair "
+                    "(%d, %d)", pairs[2*p], pairs[2*p+1]);
+        }
+    }
+
+    sbn1 = SegSegForceDriverContext(Nint, quad_points, weights, a, MU, NU);
+    rowStart = (int *)calloc(numSegs + 1, sizeof(int));
+    rowSegs  = (int *)malloc((numSegs + numPairs) * sizeof(int));
+    threadSegForces = AllocThreadSegForces(numSegs, &numThreads);
+    if (rowStart == NULL || rowSegs == NULL || threadSegForces == NULL) {
+        free(rowStart);
+        free(rowSegs);
+        free(threadSegForces);
+        SBN1ContextFree(sbn1);
+        ErrorRaise("SegSegForcePairList: out of memory");
+    }
+
+    ProfileStart(PROFILE_FORCE);
+
+/*
+ *  Row i holds the self interaction followed by the partners j of the
+ *  pairs (i, j).
+ */
+    for (i = 0; i < numSegs; i++) rowStart[i+1] = 1;
+    for (p = 0; p < numPairs; p++) rowStart[pairs[2*p]+1]++;
+    for (i = 0; i < numSegs; i++) rowStart[i+1] += rowStart[i];
+
+    for (i = 0; i < numSegs; i++) rowSegs[rowStart[i]++] = i;
+    for (p = 0; p < numPairs; p++) {
+        rowSegs[rowStart[pairs[2*p]]++] = pairs[2*p+1];
+    }
+    for (i = numSegs; i > 0; i--) rowStart[i] = rowStart[i-1];
+    rowStart[0] = 0;
+
+#pragma omp parallel num_threads(numThreads)
+    {
+        int   i, k, n, threadID;
+        real8 *fseg;
+
+#ifdef _OPENMP
+        threadID = omp_get_thread_num();
+#else
+        threadID = 0;
+#endif
+        fseg = &threadSegForces[(size_t)threadID * 6 * numSegs];
+
+#pragma omp for schedule(dynamic, 16)
+        for (i = 0; i < numSegs; i++) {
+            SegSegForceRow(i, rowStart[i+1] - rowStart[i],
+                           &rowSegs[rowStart[i]], R1, R2, burgers,
+                           h, hinv, isPeriodic, a, MU, NU,
+                           sbn1, mixed, fseg);
+        }
+
+#pragma omp for schedule(static)
+        for (k = 0; k < 6*numSegs; k++) {
+            real8 sum = 0.0;
+            for (n = 0; n < numThreads; n++) {
+                sum += threadSegForces[(size_t)n * 6 * numSegs + k];
+            }
+            segForces[k] = sum;
+        }
+    }
+
+    free(threadSegForces);
+    SBN1ContextFree(sbn1);
+    free(rowStart);
+    free(rowSegs);
+
+    AssembleNodeForces(numNodes, numSegs, nodeIDs, segForces, nodeForces);
+
+    ProfileCount(PROFILE_PAIRS, (long long)numPairs + numSegs);
+    ProfileStop(PROFILE_FORCE);
+}
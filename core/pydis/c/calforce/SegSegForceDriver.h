@@ -0,0 +1,100 @@
+#include <math.h>
+#include "SegSegForce_SBN1.h"
+#define real8 double
+
+/*
+ *      Number of pairs gathered per call to the batched force kernels
+ *      by the pair loop drivers.
+ */
+#define SEGSEG_DRIVER_CHUNK 256
+
+/*
+ *      Indices of the statistics of SegSegMixed_t
+ */
+#define SEGSEG_MIXED_PAIRS     0
+#define SEGSEG_MIXED_CHECKED   1
+#define SEGSEG_MIXED_ERR2      2
+#define SEGSEG_MIXED_NORM2     3
+#define SEGSEG_MIXED_ERRMAX    4
+#define SEGSEG_MIXED_NUM_STATS 5
+
+/*
+ *      Mixed precision policy of the analytic pair loops, passed to the
+ *      drivers by the caller (see SegSegForceRow()).  The statistics of
+ *      the single precision pairs are accumulated into stats over all
+ *      calls the policy is passed to, the caller resets them.
+ */
+typedef struct {
+        real8 distance;
+        int   check;
+        real8 stats[SEGSEG_MIXED_NUM_STATS];
+} SegSegMixed_t;
+
+void PBCClosestImage(real8 *h, real8 *hinv, int *isPeriodic,
+                     real8 *Rref, real8 *R, real8 *Rimage);
+
+void CellNeighborIndices(int c, int n, int periodic, int nbr[3], int *numNbr);
+
+void BinSegmentsInCells(int numSegs, real8 *mid,
+                        real8 *hinv, int *isPeriodic,
+                        real8 cellMin, int nCells[3],
+                        int **cellStart, int **cellSegs, int **segCell);
+
+void SegSegForceRow(int i, int numPairs, int *jList,
+                    real8 *R1, real8 *R2, real8 *burgers,
+                    real8 *h, real8 *hinv, int *isPeriodic,
+                    real8 a, real8 MU, real8 NU,
+                    SBN1Context_t *sbn1, SegSegMixed_t *mixed,
+                    real8 *fseg);
+
+SBN1Context_t *SegSegForceDriverContext(int Nint, real8 *quad_points,
+                                        real8 *weights,
+                                        real8 a, real8 MU, real8 NU);
+
+real8 *AllocThreadSegForces(int numSegs, int *numThreads);
+
+void AssembleNodeForces(int numNodes, int numSegs, int *nodeIDs,
+                        real8 *segForces, real8 *nodeForces);
+
+void SegSegForceAllPairs(int numNodes, int numSegs, int *nodeIDs,
+                         real8 *R1, real8 *R2, real8 *burgers,
+                         real8 *h, real8 *hinv, int *isPeriodic,
+                         real8 a, real8 MU, real8 NU,
+                         int Nint, real8 *quad_points, real8 *weights,
+                         SegSegMixed_t *mixed,
+                         real8 *segForces, real8 *nodeForces);
+
+void SegSegForceAllPairsMulti(int numNodes, int numSegs,
+                              int numNetworks, int *segOffset, int *nodeIDs,
+                              real8 *R1, real8 *R2, real8 *burgers,
+                              real8 *h, real8 *hinv, int *isPeriodic,
+                              real8 a, real8 MU, real8 NU,
+                              int Nint, real8 *quad_points, real8 *weights,
+                              SegSegMixed_t *mixed,
+                              real8 *segForces, real8 *nodeForces);
+
+int  SegSegForceCellList(int numNodes, int numSegs, int *nodeIDs,
+                         real8 *R1, real8 *R2, real8 *burgers,
+                         real8 *h, real8 *hinv, int *isPeriodic,
+                         real8 cutoff,
+                         real8 a, real8 MU, real8 NU,
+                         int Nint, real8 *quad_points, real8 *weights,
+                         SegSegMixed_t *mixed,
+                         real8 *segForces, real8 *nodeForces);
+
+int  SegSegForceSubset(int numSegs, real8 *R1, real8 *R2, real8 *burgers,
+                       real8 *h, real8 *hinv, int *isPeriodic,
+                       int numSub, int *subList,
+                       real8 a, real8 MU, real8 NU,
+                       int Nint, real8 *quad_points, real8 *weights,
+                       SegSegMixed_t *mixed,
+                       real8 *segForces);
+
+void SegSegForcePairList(int numNodes, int numSegs, int *nodeIDs,
+                         real8 *R1, real8 *R2, real8 *burgers,
+                         real8 *h, real8 *hinv, int *isPeriodic,
+                         int numPairs, int *pairs,
+                         real8 a, real8 MU, real8 NU,
+                         int Nint, real8 *quad_points, real8 *weights,
+                         SegSegMixed_t *mixed,
+                         real8 *segForces, real8 *nodeForces);
@@ -0,0 +1,1085 @@
+#include "SegSegForceFMM.h"
+#include "SegSegForceDriver.h"
+#include "../include/Profile.h"
+#include "../include/Error.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/*
+ *      The far field is computed from the 9 scalar potentials
+ *
+ *          U_mk(x) = sum_seg  b_m  Integral R_a(x - x') dx'_k
+ *
+ *      with R_a = sqrt(|x - x'|^2 + a^2).  The non-singular stress
+ *      (Cai et al., JMPS 54, 561 (2006)) is a linear combination of
+ *      their third derivatives
+ *
+ *      sigma_ab = MU/(8 pi) * (e_ima U_mb,ipp + e_imb U_ma,ipp)
+ *               + MU/(4 pi (1-NU)) * e_imk (U_mk,iab - d_ab U_mk,ipp)
+ *
+ *      so a cartesian fast multipole method for the kernel R_a with 9
+ *      components per cell is sufficient.  Expansion coefficients are
+ *      stored as [numTerms][9] arrays, the terms being the multi-indices
+ *      (i,j,k) sorted by increasing order i+j+k.
+ */
+
+#define FMM_NUM_TERMS(p) (((p)+1)*((p)+2)*((p)+3)/6)
+
+typedef struct {
+        int   maxOrder;  /* highest order of the multi-index tables      */
+        int   numTerms;  /* number of multi-indices up to maxOrder       */
+        int   *index;    /* [maxOrder+1]^3 position of multi-index i,j,k */
+        int   *pow;      /* [numTerms][3] exponents of each multi-index  */
+        real8 *binom;    /* [maxOrder+1]^2 binomial coefficients         */
+} FMMTables_t;
+
+#define FMM_INDEX(t,i,j,k) \
+        ((t)->index[((i)*((t)->maxOrder+1)+(j))*((t)->maxOrder+1)+(k)])
+#define FMM_BINOM(t,n,k) ((t)->binom[(n)*((t)->maxOrder+1)+(k)])
+
+
+static void FMMInitTables(FMMTables_t *t, int maxOrder)
+{
+    int i, j, k, n, deg, m = maxOrder + 1;
+
+    t->maxOrder = maxOrder;
+    t->numTerms = FMM_NUM_TERMS(maxOrder);
+    t->index    = (int *)malloc(m * m * m * sizeof(int));
+    t->pow      = (int *)malloc(3 * t->numTerms * sizeof(int));
+    t->binom    = (real8 *)calloc(m * m, sizeof(real8));
+
+    for (i = 0; i < m*m*m; i++) t->index[i] = -1;
+
+    n = 0;
+    for (deg = 0; deg <= maxOrder; deg++) {
+        for (i = deg; i >= 0; i--) {
+            for (j = deg - i; j >= 0; j--) {
+                k = deg - i - j;
+                FMM_INDEX(t, i, j, k) = n;
+                t->pow[3*n] = i; t->pow[3*n+1] = j; t->pow[3*n+2] = k;
+                n++;
+            }
+        }
+    }
+
+    for (i = 0; i < m; i++) {
+        FMM_BINOM(t, i, 0) = 1.0;
+        for (j = 1; j <= i; j++) {
+            FMM_BINOM(t, i, j) = FMM_BINOM(t, i-1, j-1) +
+                                 ((j < i) ? FMM_BINOM(t, i-1, j) : 0.0);
+        }
+    }
+}
+
+
+static void FMMFreeTables(FMMTables_t *t)
+{
+    free(t->index);
+    free(t->pow);
+    free(t->binom);
+}
+
+
+/*
+ *      mono[n] = x^n for all multi-indices n up to the given order
+ */
+static void FMMMonomials(FMMTables_t *t, int order, real8 x[3], real8 *mono)
+{
+    int   n, d, k, *p;
+    real8 pw[3][SEGSEG_FMM_MAX_ORDER+1];
+
+    for (d = 0; d < 3; d++) {
+        pw[d][0] = 1.0;
+        for (k = 1; k <= order; k++) pw[d][k] = pw[d][k-1] * x[d];
+    }
+
+    for (n = 0; n < FMM_NUM_TERMS(order); n++) {
+        p = &t->pow[3*n];
+        mono[n] = pw[0][p[0]] * pw[1][p[1]] * pw[2][p[2]];
+    }
+}
+
+
+/*
+ *      Taylor coefficients T[n] = D^n R_a(r) / n! of R_a around r,
+ *      from the recurrence
+ *
+ *          |n| (r^2 + a^2) T_n = (3 - 2|n|) sum_i r_i T_{n-e_i}
+ *                              + (3 - |n|)  sum_i T_{n-2e_i}
+ */
+static void FMMKernelTaylor(FMMTables_t *t, int order, real8 r[3], real8 a,
+                            real8 *T)
+{
+    int   n, d, deg, q[3], *p;
+    real8 rho, s1, s2;
+
+    rho  = r[0]*r[0] + r[1]*r[1] + r[2]*r[2] + a*a;
+    T[0] = sqrt(rho);
+
+    for (n = 1; n < FMM_NUM_TERMS(order); n++) {
+        p = &t->pow[3*n];
+        deg = p[0] + p[1] + p[2];
+        s1 = 0.0;
+        s2 = 0.0;
+        for (d = 0; d < 3; d++) {
+            q[0] = p[0]; q[1] = p[1]; q[2] = p[2];
+            if (p[d] >= 1) {
+                q[d] -= 1;
+                s1 += r[d] * T[FMM_INDEX(t, q[0], q[1], q[2])];
+            }
+            if (p[d] >= 2) {
+                q[d] -= 1;
+                s2 += T[FMM_INDEX(t, q[0], q[1], q[2])];
+            }
+        }
+        T[n] = ((3 - 2*deg) * s1 + (3 - deg) * s2) / (deg * rho);
+    }
+}
+
+
+/*
+ *      Add the multipole moments M_n = b_m Integral (-y)^n dx'_k of the
+ *      segment p1->p2 about the center c.  The integrand is a polynomial
+ *      of order mpOrder along the segment, so the gauss rule is exact.
+ */
+static void FMMSegMultipole(FMMTables_t *t, int mpOrder, real8 *p1, real8 *p2,
+                            real8 *b, real8 *c, int numGauss, real8 *u,
+                            real8 *w, real8 *mono, real8 *M)
+{
+    int   g, n, m, k;
+    real8 dR[3], y[3], bdR[9];
+
+    for (k = 0; k < 3; k++) dR[k] = p2[k] - p1[k];
+    for (m = 0; m < 3; m++) {
+        for (k = 0; k < 3; k++) bdR[3*m+k] = b[m] * dR[k];
+    }
+
+    for (g = 0; g < numGauss; g++) {
+        for (k = 0; k < 3; k++) y[k] = c[k] - (p1[k] + u[g]*dR[k]);
+        FMMMonomials(t, mpOrder, y, mono);
+        for (n = 0; n < FMM_NUM_TERMS(mpOrder); n++) {
+            for (k = 0; k < 9; k++) M[9*n+k] += w[g] * mono[n] * bdR[k];
+        }
+    }
+}
+
+
+/*
+ *      Shift the multipole expansion Mc of a child cell to the center
+ *      of its parent and add it to Mp.  s = child center - parent center.
+ */
+static void FMMShiftMultipole(FMMTables_t *t, int mpOrder, real8 s[3],
+                              real8 *Mc, real8 *Mp, real8 *mono)
+{
+    int   n, j, k, *pn, *pj;
+    real8 ms[3], c;
+
+    ms[0] = -s[0]; ms[1] = -s[1]; ms[2] = -s[2];
+    FMMMonomials(t, mpOrder, ms, mono);
+
+    for (n = 0; n < FMM_NUM_TERMS(mpOrder); n++) {
+        pn = &t->pow[3*n];
+        for (j = 0; j <= n; j++) {
+            pj = &t->pow[3*j];
+            if (pj[0] > pn[0] || pj[1] > pn[1] || pj[2] > pn[2]) continue;
+            c = FMM_BINOM(t, pn[0], pj[0]) * FMM_BINOM(t, pn[1], pj[1]) *
+                FMM_BINOM(t, pn[2], pj[2]) *
+                mono[FMM_INDEX(t, pn[0]-pj[0], pn[1]-pj[1], pn[2]-pj[2])];
+            for (k = 0; k < 9; k++) Mp[9*n+k] += c * Mc[9*j+k];
+        }
+    }
+}
+
+
+/*
+ *      Convert the multipole expansion M of a source cell into a local
+ *      expansion with the taylor coefficients T of the kernel and add
+ *      scale times the result to L.
+ */
+static void FMMMultipoleToLocalT(FMMTables_t *t, int mpOrder, int lOrder,
+                                 real8 *T, real8 scale, real8 *M, real8 *L)
+{
+    int   q, n, k, *pq, *pn;
+    real8 c, acc[9];
+
+    for (q = 0; q < FMM_NUM_TERMS(lOrder); q++) {
+        pq = &t->pow[3*q];
+        for (k = 0; k < 9; k++) acc[k] = 0.0;
+        for (n = 0; n < FMM_NUM_TERMS(mpOrder); n++) {
+            pn = &t->pow[3*n];
+            c = FMM_BINOM(t, pq[0]+pn[0], pq[0]) *
+                FMM_BINOM(t, pq[1]+pn[1], pq[1]) *
+                FMM_BINOM(t, pq[2]+pn[2], pq[2]) *
+                T[FMM_INDEX(t, pq[0]+pn[0], pq[1]+pn[1], pq[2]+pn[2])];
+            for (k = 0; k < 9; k++) acc[k] += c * M[9*n+k];
+        }
+        for (k = 0; k < 9; k++) L[9*q+k] += scale * acc[k];
+    }
+}
+
+
+/*
+ *      Convert the multipole expansion M of a source cell into a local
+ *      expansion about a target cell center and add scale times the
+ *      result to L.  D = target center - source center.
+ */
+static void FMMMultipoleToLocal(FMMTables_t *t, int mpOrder, int lOrder,
+                                real8 D[3], real8 a, real8 scale, real8 *M,
+                                real8 *L, real8 *T)
+{
+    FMMKernelTaylor(t, mpOrder + lOrder, D, a, T);
+    FMMMultipoleToLocalT(t, mpOrder, lOrder, T, scale, M, L);
+}
+
+
+/*
+ *      Shift the local expansion Lp of a parent cell to the center of
+ *      one of its children and add it to Lc.
+ *      s = child center - parent center.
+ */
+static void FMMShiftLocal(FMMTables_t *t, int lOrder, real8 s[3],
+                          real8 *Lp, real8 *Lc, real8 *mono)
+{
+    int   q, j, k, *pq, *pj;
+    real8 c;
+
+    FMMMonomials(t, lOrder, s, mono);
+
+    for (j = 0; j < FMM_NUM_TERMS(lOrder); j++) {
+        pj = &t->pow[3*j];
+        for (q = j; q < FMM_NUM_TERMS(lOrder); q++) {
+            pq = &t->pow[3*q];
+            if (pj[0] > pq[0] || pj[1] > pq[1] || pj[2] > pq[2]) continue;
+            c = FMM_BINOM(t, pq[0], pj[0]) * FMM_BINOM(t, pq[1], pj[1]) *
+                FMM_BINOM(t, pq[2], pj[2]) *
+                mono[FMM_INDEX(t, pq[0]-pj[0], pq[1]-pj[1], pq[2]-pj[2])];
+            for (k = 0; k < 9; k++) Lc[9*j+k] += c * Lp[9*q+k];
+        }
+    }
+}
+
+
+/*
+ *      Evaluate the stress at z (relative to the cell center) from the
+ *      local expansion L of the potentials U_mk.
+ */
+static void FMMLocalStress(FMMTables_t *t, int lOrder, real8 *L, real8 z[3],
+                           real8 MU, real8 NU, real8 *mono,
+                           real8 sigma[3][3])
+{
+    int   e, q, k, i, j, l, m, alpha, beta, *pe, *pq;
+    int   e3;
+    real8 c, F[10][9], d3[3][3][3][9], lap[3][9], s1, s2;
+    static const int eps[3][3][3] = {{{0, 0, 0}, {0, 0, 1}, {0,-1, 0}},
+                                     {{0, 0,-1}, {0, 0, 0}, {1, 0, 0}},
+                                     {{0, 1, 0}, {-1,0, 0}, {0, 0, 0}}};
+
+    FMMMonomials(t, lOrder - 3, z, mono);
+
+/*
+ *  Third derivatives of the potentials for the 10 multi-indices of
+ *  order 3, which follow the FMM_NUM_TERMS(2) terms of lower order.
+ */
+    for (e = 0; e < 10; e++) {
+        pe = &t->pow[3*(FMM_NUM_TERMS(2)+e)];
+        for (k = 0; k < 9; k++) F[e][k] = 0.0;
+        for (q = FMM_NUM_TERMS(2); q < FMM_NUM_TERMS(lOrder); q++) {
+            pq = &t->pow[3*q];
+            if (pq[0] < pe[0] || pq[1] < pe[1] || pq[2] < pe[2]) continue;
+            c = mono[FMM_INDEX(t, pq[0]-pe[0], pq[1]-pe[1], pq[2]-pe[2])];
+            for (i = 0; i < 3; i++) {
+                for (j = 0; j < pe[i]; j++) c *= (real8)(pq[i] - j);
+            }
+            for (k = 0; k < 9; k++) F[e][k] += c * L[9*q+k];
+        }
+    }
+
+    for (i = 0; i < 3; i++) {
+        for (j = 0; j < 3; j++) {
+            for (l = 0; l < 3; l++) {
+                int p[3] = {0, 0, 0};
+                p[i]++; p[j]++; p[l]++;
+                e3 = FMM_INDEX(t, p[0], p[1], p[2]) - FMM_NUM_TERMS(2);
+                for (k = 0; k < 9; k++) d3[i][j][l][k] = F[e3][k];
+            }
+        }
+    }
+
+    for (i = 0; i < 3; i++) {
+        for (k = 0; k < 9; k++) {
+            lap[i][k] = d3[i][0][0][k] + d3[i][1][1][k] + d3[i][2][2][k];
+        }
+    }
+
+    for (alpha = 0; alpha < 3; alpha++) {
+        for (beta = alpha; beta < 3; beta++) {
+            s1 = 0.0;
+            s2 = 0.0;
+            for (i = 0; i < 3; i++) {
+                for (m = 0; m < 3; m++) {
+                    s1 += eps[i][m][alpha] * lap[i][3*m+beta] +
+                          eps[i][m][beta]  * lap[i][3*m+alpha];
+                    for (k = 0; k < 3; k++) {
+                        if (eps[i][m][k] == 0) continue;
+                        s2 += eps[i][m][k] *
+                              (d3[i][alpha][beta][3*m+k] -
+                               ((alpha == beta) ? lap[i][3*m+k] : 0.0));
+                    }
+                }
+            }
+            sigma[alpha][beta] = MU / (8.0*M_PI) * s1 +
+                                 MU / (4.0*M_PI*(1.0-NU)) * s2;
+            sigma[beta][alpha] = sigma[alpha][beta];
+        }
+    }
+}
+
+
+/*
+ *      Gauss-Legendre points and weights on [0,1]
+ */
+static void FMMGaussPoints(int n, real8 *u, real8 *w)
+{
+    int   i, j, iter;
+    real8 x, p0, p1, p2, dp;
+
+    for (i = 0; i < n; i++) {
+        x = cos(M_PI * (i + 0.75) / (n + 0.5));
+        for (iter = 0; iter < 100; iter++) {
+            p0 = 1.0;
+            p1 = x;
+            for (j = 2; j <= n; j++) {
+                p2 = ((2*j-1) * x * p1 - (j-1) * p0) / j;
+                p0 = p1;
+                p1 = p2;
+            }
+            dp = n * (x * p1 - p0) / (x*x - 1.0);
+            if (fabs(p1 / dp) < 1.0e-15) break;
+            x -= p1 / dp;
+        }
+        u[i] = 0.5 * (1.0 - x);
+        w[i] = 1.0 / ((1.0 - x*x) * dp * dp);
+    }
+}
+
+
+/*
+ *      Center of cell (ix,iy,iz) of a layer with n cells per direction
+ */
+static void FMMCellCenter(real8 *h, real8 *smin, real8 *span, int n,
+                          int ix, int iy, int iz, real8 ctr[3])
+{
+    int   d;
+    real8 s[3];
+
+    s[0] = smin[0] + (ix + 0.5) * span[0] / n;
+    s[1] = smin[1] + (iy + 0.5) * span[1] / n;
+    s[2] = smin[2] + (iz + 0.5) * span[2] / n;
+
+    for (d = 0; d < 3; d++) {
+        ctr[d] = h[3*d]*s[0] + h[3*d+1]*s[1] + h[3*d+2]*s[2];
+    }
+}
+
+
+/**************************************************************************
+ *
+ *      Function:    SegSegForceFMM
+ *      Description: Compute the elastic interaction forces among all
+ *                   segments of a network with a fast multipole method.
+ *                   The cell (or, along free directions, the extent of
+ *                   the segment midpoints) is divided into numLayers
+ *                   layers of 1, 2^3, 4^3, ... cells.  Segments are
+ *                   assigned to the cells of the most refined layer by
+ *                   midpoint.  Pairs of segments in the same or
+ *                   neighboring cells of that layer are evaluated
+ *                   directly as in SegSegForceCellList(); all other
+ *                   interactions are obtained from multipole expansions
+ *                   of order mpOrder (upward pass), converted into
+ *                   taylor expansions of the stress of order taylorOrder
+ *                   at well separated cells and passed down to the most
+ *                   refined layer (downward pass).  Forces from the
+ *                   taylor expansions are integrated along each segment
+ *                   with numPoints gauss points.
+ *
+ *                   Cells of periodic directions interact with the
+ *                   closest image of each other cell only (both images
+ *                   with half weight for cells half a period away),
+ *                   consistent with SegSegForceAllPairs() up to the
+ *                   choice of image for segments about half a period
+ *                   apart.  For numLayers < 3 all
+ *                   cells are neighbors and the result equals
+ *                   SegSegForceAllPairs().
+ *
+ *                   The expansions converge only if segments are short
+ *                   compared to the cells of the most refined layer.
+ *
+ *                   With a correction table (see
+ *                   SegSegForceFMMCorrectionTable()), the periodic images
+ *                   beyond the closest ones are added to the taylor
+ *                   expansions of layer 2 from its multipole expansions,
+ *                   less their mean constant stress over the cell.
+ *
+ *      Arguments:
+ *         numLayers    number of FM layers
+ *         mpOrder      order of the multipole expansions
+ *         taylorOrder  order of the taylor expansions of the stress
+ *         numPoints    number of gauss points along each segment used
+ *                      to evaluate the remote forces
+ *         corrTable    periodic image correction table of the cell, a,
+ *                      mpOrder and taylorOrder, or NULL for the closest
+ *                      images only
+ *         (others)     same as SegSegForceAllPairs()
+ *
+ *************************************************************************/
+void SegSegForceFMM(int numNodes, int numSegs, int *nodeIDs,
+                    real8 *R1, real8 *R2, real8 *burgers,
+                    real8 *h, real8 *hinv, int *isPeriodic,
+                    real8 a, real8 MU, real8 NU,
+                    int numLayers, int mpOrder, int taylorOrder,
+                    int numPoints, real8 *corrTable,
+                    int Nint, real8 *quad_points, real8 *weights,
+                    real8 *segForces, real8 *nodeForces)
+{
+    int         i, d, k, l, c, numThreads, lOrder, numMP, numL, numGauss;
+    int         periodic[3], nFine, numFine, cellIdx[3];
+    int         *cellStart = NULL, *cellSegs = NULL, *segCell = NULL;
+    int         *cellCount[32];
+    real8       s, smin[3], smax[3], span[3];
+    real8       *P1, *P2, *sMid, *mp[32], *lc[32];
+    real8       *threadSegForces = NULL, *corrL = NULL;
+    real8       mpU[SEGSEG_FMM_MAX_ORDER], mpW[SEGSEG_FMM_MAX_ORDER];
+    real8       *evU = NULL, *evW = NULL;
+    FMMTables_t tab;
+    SBN1Context_t *sbn1;
+
+    lOrder = taylorOrder + 3;
+
+    if (numLayers < 1 || numLayers > 11 || mpOrder < 0 || taylorOrder < 0 ||
+        mpOrder + lOrder > SEGSEG_FMM_MAX_ORDER || numPoints < 1) {
+        ErrorRaise("SegSegForceFMM: invalid FM parameters "
+                "(numLayers %d, mpOrder %d, taylorOrder %d, numPoints %d)",
+                numLayers, mpOrder, taylorOrder, numPoints);
+    }
+
+    if (corrTable != NULL &&
+        (numLayers < 3 || isPeriodic == NULL ||
+         !isPeriodic[0] || !isPeriodic[1] || !isPeriodic[2])) {
+        ErrorRaise("SegSegForceFMM: the periodic image correction requires "
+                "numLayers >= 3 and a cell periodic in all directions");
+    }
+
+    memset(segForces, 0, 6 * numSegs * sizeof(real8));
+    memset(nodeForces, 0, 3 * numNodes * sizeof(real8));
+
+    if (numSegs <= 0) return;
+
+    sbn1 = SegSegForceDriverContext(Nint, quad_points, weights, a, MU, NU);
+    FMMInitTables(&tab, mpOrder + lOrder);
+
+    for (l = 0; l < numLayers; l++) {
+        cellCount[l] = NULL;
+        mp[l] = NULL;
+        lc[l] = NULL;
+    }
+
+    ProfileStart(PROFILE_FORCE);
+
+    for (d = 0; d < 3; d++) {
+        periodic[d] = (isPeriodic != NULL && isPeriodic[d]);
+    }
+
+/*
+ *  Fractional midpoint coordinates.  Along periodic directions the
+ *  segments are shifted into the primary cell.
+ */
+    P1   = (real8 *)malloc(3 * numSegs * sizeof(real8));
+    P2   = (real8 *)malloc(3 * numSegs * sizeof(real8));
+    sMid = (real8 *)malloc(3 * numSegs * sizeof(real8));
+    if (P1 == NULL || P2 == NULL || sMid == NULL) goto outOfMemory;
+
+    for (d = 0; d < 3; d++) {
+        smin[d] = 1.0e+30;
+        smax[d] = -1.0e+30;
+    }
+
+    for (i = 0; i < numSegs; i++) {
+        real8 mid[3], shift[3];
+
+        PBCClosestImage(h, hinv, isPeriodic, &R1[3*i], &R2[3*i], &P2[3*i]);
+        for (k = 0; k < 3; k++) {
+            P1[3*i+k] = R1[3*i+k];
+            mid[k] = 0.5 * (P1[3*i+k] + P2[3*i+k]);
+        }
+        for (d = 0; d < 3; d++) {
+            s = hinv[3*d]*mid[0] + hinv[3*d+1]*mid[1] + hinv[3*d+2]*mid[2];
+            shift[d] = periodic[d] ? -floor(s) : 0.0;
+            sMid[3*i+d] = s + shift[d];
+            if (sMid[3*i+d] < smin[d]) smin[d] = sMid[3*i+d];
+            if (sMid[3*i+d] > smax[d]) smax[d] = sMid[3*i+d];
+        }
+        for (k = 0; k < 3; k++) {
+            s = h[3*k]*shift[0] + h[3*k+1]*shift[1] + h[3*k+2]*shift[2];
+            P1[3*i+k] += s;
+            P2[3*i+k] += s;
+        }
+    }
+
+    for (d = 0; d < 3; d++) {
+        if (periodic[d]) {
+            smin[d] = 0.0;
+            smax[d] = 1.0;
+        }
+        span[d] = smax[d] - smin[d];
+        if (span[d] <= 0.0) span[d] = 1.0;
+    }
+
+/*
+ *  Sort the segments by cell of the most refined layer
+ */
+    nFine   = 1 << (numLayers - 1);
+    numFine = nFine * nFine * nFine;
+
+    cellStart = (int *)calloc(numFine + 1, sizeof(int));
+    cellSegs  = (int *)malloc(numSegs * sizeof(int));
+    segCell   = (int *)malloc(numSegs * sizeof(int));
+    if (cellStart == NULL || cellSegs == NULL || segCell == NULL) {
+        goto outOfMemory;
+    }
+
+    for (i = 0; i < numSegs; i++) {
+        for (d = 0; d < 3; d++) {
+            cellIdx[d] = (int)((sMid[3*i+d] - smin[d]) / span[d] * nFine);
+            if (cellIdx[d] < 0) cellIdx[d] = 0;
+            if (cellIdx[d] >= nFine) cellIdx[d] = nFine - 1;
+        }
+        c = (cellIdx[0]*nFine + cellIdx[1])*nFine + cellIdx[2];
+        segCell[i] = c;
+        cellStart[c+1]++;
+    }
+
+    for (c = 0; c < numFine; c++) cellStart[c+1] += cellStart[c];
+    for (i = 0; i < numSegs; i++) cellSegs[cellStart[segCell[i]]++] = i;
+    for (c = numFine; c > 0; c--) cellStart[c] = cellStart[c-1];
+    cellStart[0] = 0;
+
+/*
+ *  Expansion storage and number of segments in each cell of the layers
+ *  which take part in the far field calculation (layers 2 and up)
+ */
+    numMP = FMM_NUM_TERMS(mpOrder);
+    numL  = FMM_NUM_TERMS(lOrder);
+
+    if (numLayers > 2) {
+        for (l = numLayers - 1; l >= 2; l--) {
+            int n = 1 << l;
+            cellCount[l] = (int *)calloc(n*n*n, sizeof(int));
+            mp[l] = (real8 *)calloc((size_t)n*n*n * numMP * 9, sizeof(real8));
+            lc[l] = (real8 *)calloc((size_t)n*n*n * numL * 9, sizeof(real8));
+            if (cellCount[l] == NULL || mp[l] == NULL || lc[l] == NULL) {
+                goto outOfMemory;
+            }
+            for (c = 0; c < n*n*n; c++) {
+                if (l == numLayers - 1) {
+                    cellCount[l][c] = cellStart[c+1] - cellStart[c];
+                } else {
+                    int ix = c / (n*n), iy = (c / n) % n, iz = c % n, m;
+                    for (m = 0; m < 8; m++) {
+                        int cc = ((2*ix + (m>>2))*2*n + 2*iy + ((m>>1)&1))*2*n +
+                                 2*iz + (m&1);
+                        cellCount[l][c] += cellCount[l+1][cc];
+                    }
+                }
+            }
+        }
+    }
+
+    numGauss = mpOrder / 2 + 1;
+    FMMGaussPoints(numGauss, mpU, mpW);
+
+    evU = (real8 *)malloc(numPoints * sizeof(real8));
+    evW = (real8 *)malloc(numPoints * sizeof(real8));
+    if (evU == NULL || evW == NULL) goto outOfMemory;
+    FMMGaussPoints(numPoints, evU, evW);
+
+    if (corrTable != NULL) {
+        int nc = SEGSEG_FMM_CORR_CELLS;
+        corrL = (real8 *)calloc((size_t)nc*nc*nc * numL * 9, sizeof(real8));
+        if (corrL == NULL) goto outOfMemory;
+    }
+
+    threadSegForces = AllocThreadSegForces(numSegs, &numThreads);
+    if (threadSegForces == NULL) goto outOfMemory;
+
+#pragma omp parallel num_threads(numThreads)
+    {
+        int   i, j, k, m, d, c, l, n, threadID, numJ;
+        int   cell[3], nbr[3][3], numNbr[3], ix, iy, iz;
+        int   *jList;
+        real8 *fseg, *T, *mono;
+
+#ifdef _OPENMP
+        threadID = omp_get_thread_num();
+#else
+        threadID = 0;
+#endif
+        fseg  = &threadSegForces[(size_t)threadID * 6 * numSegs];
+        jList = (int *)malloc(numSegs * sizeof(int));
+        T     = (real8 *)malloc(tab.numTerms * sizeof(real8));
+        mono  = (real8 *)malloc(tab.numTerms * sizeof(real8));
+
+/*
+ *      Near field: all pairs in the same or neighboring cells
+ */
+#pragma omp for schedule(dynamic, 16)
+        for (i = 0; i < numSegs; i++) {
+
+            c = segCell[i];
+            cell[0] = c / (nFine*nFine);
+            cell[1] = (c / nFine) % nFine;
+            cell[2] = c % nFine;
+
+            for (d = 0; d < 3; d++) {
+                CellNeighborIndices(cell[d], nFine, periodic[d],
+                                    nbr[d], &numNbr[d]);
+            }
+
+            numJ = 0;
+
+            for (ix = 0; ix < numNbr[0]; ix++) {
+                for (iy = 0; iy < numNbr[1]; iy++) {
+                    for (iz = 0; iz < numNbr[2]; iz++) {
+                        c = (nbr[0][ix]*nFine + nbr[1][iy])*nFine + nbr[2][iz];
+                        for (m = cellStart[c]; m < cellStart[c+1]; m++) {
+                            j = cellSegs[m];
+                            if (j >= i) jList[numJ++] = j;
+                        }
+                    }
+                }
+            }
+
+            SegSegForceRow(i, numJ, jList, R1, R2, burgers,
+                           h, hinv, isPeriodic, a, MU, NU,
+                           sbn1, NULL, fseg);
+        }
+
+        if (numLayers > 2) {
+            int   fine = numLayers - 1;
+            real8 ctr[3], cctr[3], sft[3];
+
+/*
+ *          Multipole expansions of the most refined cells
+ */
+#pragma omp for schedule(dynamic, 8)
+            for (c = 0; c < numFine; c++) {
+                if (cellStart[c+1] == cellStart[c]) continue;
+                FMMCellCenter(h, smin, span, nFine, c / (nFine*nFine),
+                              (c / nFine) % nFine, c % nFine, ctr);
+                for (m = cellStart[c]; m < cellStart[c+1]; m++) {
+                    j = cellSegs[m];
+                    FMMSegMultipole(&tab, mpOrder, &P1[3*j], &P2[3*j],
+                                    &burgers[3*j], ctr, numGauss, mpU, mpW,
+                                    mono, &mp[fine][(size_t)c*numMP*9]);
+                }
+            }
+
+/*
+ *          Upward pass
+ */
+            for (l = fine - 1; l >= 2; l--) {
+                n = 1 << l;
+#pragma omp for schedule(dynamic, 8)
+                for (c = 0; c < n*n*n; c++) {
+                    if (cellCount[l][c] == 0) continue;
+                    cell[0] = c / (n*n); cell[1] = (c / n) % n; cell[2] = c % n;
+                    FMMCellCenter(h, smin, span, n, cell[0], cell[1], cell[2],
+                                  ctr);
+                    for (m = 0; m < 8; m++) {
+                        int cx = 2*cell[0] + (m>>2), cy = 2*cell[1] + ((m>>1)&1);
+                        int cz = 2*cell[2] + (m&1);
+                        int cc = (cx*2*n + cy)*2*n + cz;
+                        if (cellCount[l+1][cc] == 0) continue;
+                        FMMCellCenter(h, smin, span, 2*n, cx, cy, cz, cctr);
+                        for (d = 0; d < 3; d++) sft[d] = cctr[d] - ctr[d];
+                        FMMShiftMultipole(&tab, mpOrder, sft,
+                                          &mp[l+1][(size_t)cc*numMP*9],
+                                          &mp[l][(size_t)c*numMP*9], mono);
+                    }
+                }
+            }
+
+/*
+ *          Periodic images beyond the closest ones: local expansions of
+ *          the cells of layer 2 from the correction table, less their
+ *          mean constant stress (see SegSegForceFMMCorrectionTable())
+ */
+            if (corrTable != NULL) {
+                int nc = SEGSEG_FMM_CORR_CELLS, no = 2*nc - 1;
+#pragma omp for schedule(dynamic, 1)
+                for (c = 0; c < nc*nc*nc; c++) {
+                    int sc, off;
+                    cell[0] = c / (nc*nc); cell[1] = (c / nc) % nc; cell[2] = c % nc;
+                    for (sc = 0; sc < nc*nc*nc; sc++) {
+                        if (cellCount[2][sc] == 0) continue;
+                        off = ((sc / (nc*nc) - cell[0] + nc-1) * no +
+                               (sc / nc) % nc - cell[1] + nc-1) * no +
+                              sc % nc - cell[2] + nc-1;
+                        FMMMultipoleToLocalT(&tab, mpOrder, lOrder,
+                                &corrTable[(size_t)off*tab.numTerms], 1.0,
+                                &mp[2][(size_t)sc*numMP*9],
+                                &corrL[(size_t)c*numL*9]);
+                    }
+                }
+#pragma omp single
+                for (k = 9*FMM_NUM_TERMS(2); k < 9*FMM_NUM_TERMS(3); k++) {
+                    real8 mean = 0.0;
+                    for (c = 0; c < nc*nc*nc; c++) mean += corrL[(size_t)c*numL*9+k];
+                    mean /= nc*nc*nc;
+                    for (c = 0; c < nc*nc*nc; c++) corrL[(size_t)c*numL*9+k] -= mean;
+                }
+            }
+
+/*
+ *          Downward pass: taylor expansions from the parent cell plus
+ *          the contributions of the cells in the interaction list
+ *          (children of the neighbors of the parent which are not
+ *          neighbors of the cell itself)
+ */
+            for (l = 2; l <= fine; l++) {
+                n = 1 << l;
+#pragma omp for schedule(dynamic, 4)
+                for (c = 0; c < n*n*n; c++) {
+                    int   cand[3][6], numCand[3], diff[3], pn[3], numPn;
+                    int   jx, jy, jz, sc, img[3], numImg;
+                    real8 *L = &lc[l][(size_t)c*numL*9];
+                    real8 D[3], ds[3];
+
+                    if (cellCount[l][c] == 0) continue;
+
+                    cell[0] = c / (n*n); cell[1] = (c / n) % n; cell[2] = c % n;
+
+                    if (l > 2) {
+                        int pc = ((cell[0]>>1)*(n/2) + (cell[1]>>1))*(n/2) +
+                                 (cell[2]>>1);
+                        FMMCellCenter(h, smin, span, n/2, cell[0]>>1,
+                                      cell[1]>>1, cell[2]>>1, ctr);
+                        FMMCellCenter(h, smin, span, n, cell[0], cell[1],
+                                      cell[2], cctr);
+                        for (d = 0; d < 3; d++) sft[d] = cctr[d] - ctr[d];
+                        FMMShiftLocal(&tab, lOrder, sft,
+                                      &lc[l-1][(size_t)pc*numL*9], L, mono);
+                    }
+
+                    for (d = 0; d < 3; d++) {
+                        CellNeighborIndices(cell[d]>>1, n/2, periodic[d],
+                                            pn, &numPn);
+                        numCand[d] = 0;
+                        for (k = 0; k < numPn; k++) {
+                            cand[d][numCand[d]++] = 2*pn[k];
+                            cand[d][numCand[d]++] = 2*pn[k] + 1;
+                        }
+                    }
+
+                    for (jx = 0; jx < numCand[0]; jx++) {
+                      for (jy = 0; jy < numCand[1]; jy++) {
+                        for (jz = 0; jz < numCand[2]; jz++) {
+                            int src[3] = {cand[0][jx], cand[1][jy], cand[2][jz]};
+                            int isNbr = 1;
+                            for (d = 0; d < 3; d++) {
+                                diff[d] = src[d] - cell[d];
+                                if (periodic[d]) {
+                                    diff[d] = ((diff[d] + n/2) % n + n) % n - n/2;
+                                }
+                                if (diff[d] < -1 || diff[d] > 1) isNbr = 0;
+                            }
+                            if (isNbr) continue;
+                            sc = (src[0]*n + src[1])*n + src[2];
+                            if (cellCount[l][sc] == 0) continue;
+/*
+ *                          A cell half a period away along a periodic
+ *                          direction has two closest images.  Using both
+ *                          with half weight keeps the far field
+ *                          symmetric between the two cells.
+ */
+                            numImg = 1;
+                            for (d = 0; d < 3; d++) {
+                                img[d] = (periodic[d] && n > 2 &&
+                                          diff[d] == -n/2);
+                                numImg *= 1 + img[d];
+                            }
+                            for (m = 0; m < 8; m++) {
+                                if ((m & (img[0] | (img[1]<<1) | (img[2]<<2))) != m) {
+                                    continue;
+                                }
+                                for (d = 0; d < 3; d++) {
+                                    ds[d] = -(diff[d] + (((m>>d)&1) ? n : 0)) *
+                                            span[d] / n;
+                                }
+                                for (d = 0; d < 3; d++) {
+                                    D[d] = h[3*d]*ds[0] + h[3*d+1]*ds[1] +
+                                           h[3*d+2]*ds[2];
+                                }
+                                FMMMultipoleToLocal(&tab, mpOrder, lOrder, D, a,
+                                                    1.0 / numImg,
+                                                    &mp[l][(size_t)sc*numMP*9],
+                                                    L, T);
+                            }
+                        }
+                      }
+                    }
+
+                    if (l == 2 && corrTable != NULL) {
+                        for (k = 0; k < numL*9; k++) {
+                            L[k] += corrL[(size_t)c*numL*9+k];
+                        }
+                    }
+                }
+            }
+
+/*
+ *          Remote forces from the taylor expansions of the most
+ *          refined cells
+ */
+#pragma omp for schedule(static)
+            for (i = 0; i < numSegs; i++) {
+                int   g, alpha;
+                real8 dR[3], z[3], sigma[3][3], sb[3], fv[3];
+
+                c = segCell[i];
+                FMMCellCenter(h, smin, span, nFine, c / (nFine*nFine),
+                              (c / nFine) % nFine, c % nFine, ctr);
+                for (k = 0; k < 3; k++) dR[k] = P2[3*i+k] - P1[3*i+k];
+
+                for (g = 0; g < numPoints; g++) {
+                    for (k = 0; k < 3; k++) {
+                        z[k] = P1[3*i+k] + evU[g]*dR[k] - ctr[k];
+                    }
+                    FMMLocalStress(&tab, lOrder,
+                                   &lc[fine][(size_t)c*numL*9], z, MU, NU,
+                                   mono, sigma);
+                    for (alpha = 0; alpha < 3; alpha++) {
+                        sb[alpha] = sigma[alpha][0]*burgers[3*i] +
+                                    sigma[alpha][1]*burgers[3*i+1] +
+                                    sigma[alpha][2]*burgers[3*i+2];
+                    }
+                    fv[0] = sb[1]*dR[2] - sb[2]*dR[1];
+                    fv[1] = sb[2]*dR[0] - sb[0]*dR[2];
+                    fv[2] = sb[0]*dR[1] - sb[1]*dR[0];
+                    for (k = 0; k < 3; k++) {
+                        fseg[6*i+k]   += evW[g] * (1.0 - evU[g]) * fv[k];
+                        fseg[6*i+3+k] += evW[g] * evU[g] * fv[k];
+                    }
+                }
+            }
+        }
+
+        free(jList);
+        free(T);
+        free(mono);
+
+#pragma omp for schedule(static)
+        for (k = 0; k < 6*numSegs; k++) {
+            real8 sum = 0.0;
+            for (m = 0; m < numThreads; m++) {
+                sum += threadSegForces[(size_t)m * 6 * numSegs + k];
+            }
+            segForces[k] = sum;
+        }
+    }
+
+    free(threadSegForces);
+    free(corrL);
+    SBN1ContextFree(sbn1);
+    for (l = 0; l < numLayers; l++) {
+        free(cellCount[l]);
+        free(mp[l]);
+        free(lc[l]);
+    }
+    FMMFreeTables(&tab);
+    free(evU);
+    free(evW);
+    free(cellStart);
+    free(cellSegs);
+    free(segCell);
+    free(P1);
+    free(P2);
+    free(sMid);
+
+    AssembleNodeForces(numNodes, numSegs, nodeIDs, segForces, nodeForces);
+
+    ProfileStop(PROFILE_FORCE);
+    return;
+
+/*
+ *  Release the buffers and close the profile phase before the error
+ *  unwinds to the caller's trap.
+ */
+outOfMemory:
+    free(threadSegForces);
+    free(corrL);
+    SBN1ContextFree(sbn1);
+    for (l = 0; l < numLayers; l++) {
+        free(cellCount[l]);
+        free(mp[l]);
+        free(lc[l]);
+    }
+    FMMFreeTables(&tab);
+    free(evU);
+    free(evW);
+    free(cellStart);
+    free(cellSegs);
+    free(segCell);
+    free(P1);
+    free(P2);
+    free(sMid);
+
+    ProfileStop(PROFILE_FORCE);
+
+    ErrorRaise("SegSegForceFMM: out of memory");
+}
+
+
+/**************************************************************************
+ *
+ *      Function:    SegSegForceFMMCorrectionSize
+ *      Description: Number of values of the periodic image correction
+ *                   table of SegSegForceFMMCorrectionTable().
+ *
+ *************************************************************************/
+int SegSegForceFMMCorrectionSize(int mpOrder, int taylorOrder)
+{
+    int n = 2 * SEGSEG_FMM_CORR_CELLS - 1;
+
+    return(n * n * n * FMM_NUM_TERMS(mpOrder + taylorOrder + 3));
+}
+
+
+/**************************************************************************
+ *
+ *      Function:    SegSegForceFMMCorrectionTable
+ *      Description: Tabulate the far field of the periodic images that
+ *                   SegSegForceFMM() leaves out, for a cell periodic in
+ *                   all directions.  The FMM accounts for the closest
+ *                   image of every cell of layer 2 (4^3 cells); for each
+ *                   offset between a target and a source cell of that
+ *                   layer (-3..3 cells per direction) the table holds
+ *                   the taylor coefficients of the kernel summed over
+ *                   the images of the source cell shifted by up to
+ *                   numImages periods per direction, but the closest
+ *                   ones.  The multipole to local conversion being
+ *                   linear in these coefficients, one conversion per
+ *                   cell pair adds all these images.
+ *
+ *                   All source cells share the same shifts, so the
+ *                   images of a closed loop are summed as closed loops.
+ *                   The constant stress of the images converges only
+ *                   conditionally (it depends on the shape of the sum),
+ *                   SegSegForceFMM() subtracts its mean over the cell as
+ *                   the mean stress correction of ParaDiS does.  The
+ *                   coefficients of order below 3 do not enter the
+ *                   stress and are set to zero.
+ *
+ *                   The table depends only on h, a and the expansion
+ *                   orders: it is meant to be generated once per cell
+ *                   geometry and stored.
+ *
+ *      Arguments:
+ *         h, isPeriodic  cell matrix and periodic flags
+ *         a              core radius
+ *         mpOrder        order of the multipole expansions
+ *         taylorOrder    order of the taylor expansions of the stress
+ *         numImages      largest image shift, in periods
+ *         corrTable      [7^3][FMM_NUM_TERMS(mpOrder+taylorOrder+3)]
+ *                        returned table (SegSegForceFMMCorrectionSize()
+ *                        values), offsets ordered ((dx*7 + dy)*7 + dz)
+ *                        with dx = source - target cell index + 3
+ *
+ *************************************************************************/
+void SegSegForceFMMCorrectionTable(real8 *h, int *isPeriodic, real8 a,
+                                   int mpOrder, int taylorOrder,
+                                   int numImages, real8 *corrTable)
+{
+    int         n = SEGSEG_FMM_CORR_CELLS, no = 2*n - 1, numTerms, numOff;
+    FMMTables_t tab;
+
+    if (mpOrder < 0 || taylorOrder < 0 || numImages < 1 ||
+        mpOrder + taylorOrder + 3 > SEGSEG_FMM_MAX_ORDER) {
+        ErrorRaise("SegSegForceFMMCorrectionTable: invalid parameters "
+                "(mpOrder %d, taylorOrder %d, numImages %d)",
+                mpOrder, taylorOrder, numImages);
+    }
+
+    if (isPeriodic == NULL || !isPeriodic[0] || !isPeriodic[1] ||
+        !isPeriodic[2]) {
+        ErrorRaise("SegSegForceFMMCorrectionTable: the cell must be "
+                "periodic in all directions");
+    }
+
+    FMMInitTables(&tab, mpOrder + taylorOrder + 3);
+    numTerms = tab.numTerms;
+    numOff   = no * no * no;
+
+#pragma omp parallel
+    {
+        int   off, d, k, L[3], r[3], w[3], numImg, primary;
+        real8 ds[3], D[3], *T, *Tc;
+
+        T = (real8 *)malloc(numTerms * sizeof(real8));
+
+#pragma omp for schedule(dynamic, 1)
+        for (off = 0; off < numOff; off++) {
+
+            Tc = &corrTable[(size_t)off * numTerms];
+            for (k = 0; k < numTerms; k++) Tc[k] = 0.0;
+
+/*
+ *          Offset r of the source cell, and the offset w of its closest
+ *          image(s) as used by the FMM, in [-n/2, n/2)
+ */
+            r[0] = off / (no*no) - (n-1);
+            r[1] = (off / no) % no - (n-1);
+            r[2] = off % no - (n-1);
+            numImg = 1;
+            for (d = 0; d < 3; d++) {
+                w[d] = (r[d] + n/2 + n) % n - n/2;
+                if (w[d] == -n/2) numImg *= 2;
+            }
+
+            for (L[0] = -numImages; L[0] <= numImages; L[0]++) {
+              for (L[1] = -numImages; L[1] <= numImages; L[1]++) {
+                for (L[2] = -numImages; L[2] <= numImages; L[2]++) {
+                    real8 wgt = 1.0;
+
+                    primary = 1;
+                    for (d = 0; d < 3; d++) {
+                        ds[d] = -(real8)r[d] / n - L[d];
+                        if (n*L[d] != w[d] - r[d] &&
+                            !(w[d] == -n/2 && n*L[d] == n/2 - r[d])) {
+                            primary = 0;
+                        }
+                    }
+                    if (primary) wgt -= 1.0 / numImg;
+                    if (wgt < 1.0e-12) continue;
+
+                    for (d = 0; d < 3; d++) {
+                        D[d] = h[3*d]*ds[0] + h[3*d+1]*ds[1] + h[3*d+2]*ds[2];
+                    }
+                    FMMKernelTaylor(&tab, tab.maxOrder, D, a, T);
+                    for (k = FMM_NUM_TERMS(2); k < numTerms; k++) {
+                        Tc[k] += wgt * T[k];
+                    }
+                }
+              }
+            }
+        }
+
+        free(T);
+    }
+
+    FMMFreeTables(&tab);
+}
@@ -0,0 +1,30 @@
+#include <math.h>
+#define real8 double
+
+/*
+ *      Highest order of the derivatives of the kernel R_a needed by
+ *      the expansions (mpOrder + taylorOrder + 3) supported by
+ *      SegSegForceFMM().
+ */
+#define SEGSEG_FMM_MAX_ORDER 16
+
+/*
+ *      Number of cells per direction of the FM layer at which the
+ *      periodic image correction table is applied (layer 2).
+ */
+#define SEGSEG_FMM_CORR_CELLS 4
+
+void SegSegForceFMM(int numNodes, int numSegs, int *nodeIDs,
+                    real8 *R1, real8 *R2, real8 *burgers,
+                    real8 *h, real8 *hinv, int *isPeriodic,
+                    real8 a, real8 MU, real8 NU,
+                    int numLayers, int mpOrder, int taylorOrder,
+                    int numPoints, real8 *corrTable,
+                    int Nint, real8 *quad_points, real8 *weights,
+                    real8 *segForces, real8 *nodeForces);
+
+int  SegSegForceFMMCorrectionSize(int mpOrder, int taylorOrder);
+
+void SegSegForceFMMCorrectionTable(real8 *h, int *isPeriodic, real8 a,
+                                   int mpOrder, int taylorOrder,
+                                   int numImages, real8 *corrTable);
@@ -0,0 +1,892 @@
+#include "SegSegForceSIMD.h"
+#include "SegSegForce.h"
+
+#define W  SEGSEG_SIMD_WIDTH
+#define WF SEGSEG_SIMD_WIDTH_F
+
+/*
+ *      Let the vectorizer call the glibc libmvec versions of log() and
+ *      atan().  glibc only declares them when compiling with -ffast-math,
+ *      which we do not want for this kernel.
+ */
+#if defined(SEGSEG_SIMD_VECMATH) && defined(__GNUC__) && defined(__x86_64__)
+double log(double) __attribute__((__simd__("notinbranch")));
+double atan(double) __attribute__((__simd__("notinbranch")));
+#endif
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:       SegSegForceIsotropicBlock
+ *      Description:    Evaluate the analytic segment/segment forces for
+ *                      a block of W pairs stored in structure-of-arrays
+ *                      form (x1[i][lane] etc.).  This is the non-parallel
+ *                      branch of SegSegForceIsotropic() with the loops
+ *                      over pairs innermost so that the compiler can map
+ *                      the lanes onto vector registers.  The work is
+ *                      split into three lane loops so that the loops
+ *                      without transcendental calls vectorize even when
+ *                      no vector math library is available.
+ *
+ *                      Lanes whose segments are too close to parallel
+ *                      for the analytic expressions are flagged in
+ *                      <special> and evaluated with regularized input
+ *                      so that they cannot produce floating point
+ *                      exceptions; the caller must overwrite their
+ *                      forces with the SpecialSegSegForce() result.
+ *
+ *      Arguments:
+ *              x1..x4       endpoints of the segments p1->p2, p3->p4
+ *              bp, b        burgers vectors of p1->p2 and p3->p4
+ *              a, MU, NU    core parameter, shear modulus, poisson ratio
+ *              eps          threshold on 1-cos^2 for the special path
+ *              special      returned as 1 for near-parallel lanes
+ *              f1..f4       forces at x1..x4
+ *
+ *-----------------------------------------------------------------------*/
+static void SegSegForceIsotropicBlock(real8 x1[3][W], real8 x2[3][W],
+                                      real8 x3[3][W], real8 x4[3][W],
+                                      real8 bp[3][W], real8 b[3][W],
+                                      real8 a, real8 MU, real8 NU, real8 eps,
+                                      int special[W],
+                                      real8 f1[3][W], real8 f2[3][W],
+                                      real8 f3[3][W], real8 f4[3][W])
+{
+        int    l;
+        real8  t[3][W], tp[3][W], tctp[3][W];
+        real8  cv[W], onemc2invv[W], dv[W], a2_d2v[W], denomv[W];
+        real8  oneoverLv[W], oneoverLpv[W];
+        real8  yy[2][W], zz[2][W];
+        real8  Rav[4][W], Ra_Rdot_tpv[8][W], Ra_Rdot_tv[8][W], atanargv[8][W];
+        real8  log_Ra_Rdot_tpv[4][W], log_Ra_Rdot_tv[4][W], atansumv[4][W];
+        real8  vec1[3][W], vec2[3][W], R0[3][W], R1[3][W], tv[3][W], tpv[3][W];
+        real8  tctpv[3][W], bv[3][W], bpv[3][W], I_003[3][W], I_005[3][W];
+        real8  I_013[3][W], I_015[3][W], I_025[3][W], I_103[3][W], I_105[3][W];
+        real8  I_115[3][W], I_125[3][W], I_205[3][W], I_215[3][W], I00a[3][W];
+        real8  I01a[3][W], I10a[3][W], I00b[3][W], I01b[3][W], I10b[3][W];
+        real8  bctctp[3][W], bct[3][W], bpctpct[3][W], bpctp[3][W];
+        real8  tcbpct[3][W], tctpct[3][W], tpct[3][W], tpcbctp[3][W];
+        real8  tpctctp[3][W];
+        real8  yv[4][W], zv[4][W], y2[4][W], z2[4][W], Ra[4][W], Rainv[4][W];
+        real8  log_Ra_Rdot_tp[4][W], log_Ra_Rdot_t[4][W], Ra2_R_tpinv[4][W];
+        real8  Ra2_R_tinv[4][W], ylog_Ra_Rdot_tp[4][W], zlog_Ra_Rdot_t[4][W];
+        real8  yRa2_R_tpinv[4][W], zRa2_R_tinv[4][W], y2Ra2_R_tpinv[4][W];
+        real8  z2Ra2_R_tinv[4][W], adf_003[4][W], commonf223[4][W];
+        real8  commonf225[4][W], commonf025[4][W], commonf205[4][W];
+        real8  commonf305[4][W], commonf035[4][W], ycommonf025[4][W];
+        real8  zcommonf205[4][W], zcommonf305[4][W], tf_113[4][W];
+        real8  f_003v[4][W], f_103v[4][W], f_013v[4][W], f_113v[4][W];
+        real8  f_203v[4][W], f_023v[4][W], f_005v[4][W], f_105v[4][W];
+        real8  f_015v[4][W], f_115v[4][W], f_205v[4][W], f_025v[4][W];
+        real8  f_215v[4][W], f_125v[4][W], f_225v[4][W], f_305v[4][W];
+        real8  f_035v[4][W], f_315v[4][W], f_135v[4][W];
+        real8  y[2][W], z[2][W];
+        real8  tmp[10][W];
+        real8  pivalue=3.141592653589793;
+
+/*
+ *      Lane loop 1: geometry of the pair and the arguments of the
+ *      logarithms and arctangents.
+ */
+#pragma omp simd
+        for (l = 0; l < W; l++) {
+            int i, j, isSpecial;
+            real8 temp1, temp2, c, onemc2, onemc2inv, d;
+            real8 tempa0, tempa1, tempb0, tempb1;
+            real8 y0, y1, z0, z1, a2_d2, denom;
+
+            temp1 = 0.0;
+            temp2 = 0.0;
+            for (i = 0; i < 3; i++) {
+                vec1[i][l] = x4[i][l] - x3[i][l];
+                vec2[i][l] = x2[i][l] - x1[i][l];
+                temp1 += vec1[i][l]*vec1[i][l];
+                temp2 += vec2[i][l]*vec2[i][l];
+            }
+
+            oneoverLv[l]  = 1/sqrt(temp1);
+            oneoverLpv[l] = 1/sqrt(temp2);
+
+            c = 0.0;
+            for (i = 0; i < 3; i++) {
+                t[i][l]  = vec1[i][l]*oneoverLv[l];
+                tp[i][l] = vec2[i][l]*oneoverLpv[l];
+                c += t[i][l]*tp[i][l];
+            }
+
+            onemc2 = 1 - c*c;
+            isSpecial = !(onemc2 > eps);
+            special[l] = isSpecial;
+            onemc2 = isSpecial ? 1.0 : onemc2;
+
+            tctp[0][l] = t[1][l]*tp[2][l] - t[2][l]*tp[1][l];
+            tctp[1][l] = t[2][l]*tp[0][l] - t[0][l]*tp[2][l];
+            tctp[2][l] = t[0][l]*tp[1][l] - t[1][l]*tp[0][l];
+
+            onemc2inv = 1/onemc2;
+
+            d = 0.0;
+            tempa0 = 0.0; tempa1 = 0.0;
+            tempb0 = 0.0; tempb1 = 0.0;
+            for (i = 0; i < 3; i++) {
+                R0[i][l] = x3[i][l] - x1[i][l];
+                R1[i][l] = x4[i][l] - x2[i][l];
+                d += 0.5e0*((x4[i][l]+x3[i][l])-(x2[i][l]+x1[i][l]))*tctp[i][l];
+                tempa0 += R0[i][l]*t[i][l];
+                tempa1 += R1[i][l]*t[i][l];
+                tempb0 += R0[i][l]*tp[i][l];
+                tempb1 += R1[i][l]*tp[i][l];
+            }
+
+            d *= onemc2inv;
+
+            y0 = (tempa0-c*tempb0)*onemc2inv;
+            y1 = (tempa1-c*tempb1)*onemc2inv;
+            z0 = (tempb0-c*tempa0)*onemc2inv;
+            z1 = (tempb1-c*tempa1)*onemc2inv;
+
+            yv[0][l] = y0; yv[1][l] = y0; yv[2][l] = y1; yv[3][l] = y1;
+            zv[0][l] = z0; zv[1][l] = z1; zv[2][l] = z0; zv[3][l] = z1;
+
+            a2_d2 = a*a+d*d*onemc2;
+            denom = 1.0e0/sqrt(onemc2*a2_d2);
+            temp1 = denom*(1+c);
+
+            for (j = 0; j < 4; j++) {
+                real8 Ra;
+                Ra = sqrt(a2_d2 + yv[j][l]*yv[j][l] + zv[j][l]*zv[j][l] + 2.0e0*yv[j][l]*zv[j][l]*c);
+                Rav[j][l] = Ra;
+                Ra_Rdot_tpv[j][l]   = Ra+(zv[j][l]+yv[j][l]*c);
+                Ra_Rdot_tv[j][l]    = Ra+(yv[j][l]+zv[j][l]*c);
+                Ra_Rdot_tpv[j+4][l] = Ra-(zv[j][l]+yv[j][l]*c);
+                Ra_Rdot_tv[j+4][l]  = Ra-(yv[j][l]+zv[j][l]*c);
+                atanargv[j][l]   = temp1*(Ra+(yv[j][l]+zv[j][l]));
+                atanargv[j+4][l] = temp1*(Ra-(yv[j][l]+zv[j][l]));
+            }
+
+            cv[l] = c;
+            onemc2invv[l] = onemc2inv;
+            dv[l] = d;
+            a2_d2v[l] = a2_d2;
+            denomv[l] = denom;
+            yy[0][l] = y0; yy[1][l] = y1;
+            zz[0][l] = z0; zz[1][l] = z1;
+        }
+
+/*
+ *      Lane loop 2: transcendental functions.  This vectorizes only when
+ *      the compiler has vector variants of log() and atan() available
+ *      (see SEGSEG_SIMD_VECMATH).
+ */
+#pragma omp simd
+        for (l = 0; l < W; l++) {
+            int j;
+            for (j = 0; j < 4; j++) {
+                log_Ra_Rdot_tpv[j][l] = 0.5e0*(log(Ra_Rdot_tpv[j][l])-log(Ra_Rdot_tpv[j+4][l]));
+                log_Ra_Rdot_tv[j][l]  = 0.5e0*(log(Ra_Rdot_tv[j][l])-log(Ra_Rdot_tv[j+4][l]));
+                atansumv[j][l] = 0.5e0*(atan(atanargv[j][l])+atan(atanargv[j+4][l]));
+            }
+        }
+
+/*
+ *      Lane loop 3: definite integrals and the nodal forces.
+ */
+#pragma omp simd
+        for (l = 0; l < W; l++) {
+            int i, j;
+            real8 c, c2, onemc2inv, d, a2_d2, a2_d2inv, denom, oneoverL, oneoverLp;
+            real8 f_003, f_103, f_013, f_113, f_203, f_023, f_005, f_105;
+            real8 f_015, f_115, f_205, f_025, f_215, f_125, f_225, f_305;
+            real8 f_035, f_315, f_135;
+            real8 Fint_003, Fint_005, Fint_013, Fint_015, Fint_025, Fint_103;
+            real8 Fint_105, Fint_115, Fint_125, Fint_205, Fint_215;
+            real8 bctdbp, bpctpdb, tcbpdb, tcbpdtp, tpcbdbp;
+            real8 tctpcbpdb, tctpcbpdtp, tctpdb, tdb, tdbp;
+            real8 tpcbdt, tpctcbdbp, tpctcbdt, tpctdbp, tpdb, tpdbp;
+            real8 a2, m4p, m4pd, m8p, m8pd, m4pn, m4pnd, m4pnd2, m4pnd3;
+            real8 a2m4pnd, a2m8pd, a2m4pn, a2m8p;
+            real8 temp1, temp2, temp3;
+
+            c = cv[l];
+            c2 = c*c;
+            onemc2inv = onemc2invv[l];
+            d = dv[l];
+            a2_d2 = a2_d2v[l];
+            a2_d2inv = 1.0e0/a2_d2;
+            denom = denomv[l];
+            oneoverL = oneoverLv[l];
+            oneoverLp = oneoverLpv[l];
+
+            for (i = 0; i < 3; i++) {
+                tv[i][l] = t[i][l];
+                tpv[i][l] = tp[i][l];
+                tctpv[i][l] = tctp[i][l];
+                bv[i][l] = b[i][l];
+                bpv[i][l] = bp[i][l];
+            }
+
+            for (j = 0; j < 2; j++) {
+                y[j][l] = yy[j][l];
+                z[j][l] = zz[j][l];
+                yv[2*j][l] = y[j][l];
+                yv[2*j+1][l] = y[j][l];
+                zv[j][l] = z[j][l];
+                zv[j+2][l] = z[j][l];
+            }
+
+            for (j = 0; j < 4; j++) {
+                y2[j][l] = yv[j][l]*yv[j][l];
+                z2[j][l] = zv[j][l]*zv[j][l];
+                Ra[j][l] = Rav[j][l];
+                Rainv[j][l] = 1.0e0/Ra[j][l];
+                log_Ra_Rdot_tp[j][l] = log_Ra_Rdot_tpv[j][l];
+                log_Ra_Rdot_t[j][l] = log_Ra_Rdot_tv[j][l];
+                Ra2_R_tpinv[j][l] = 0.5e0*(Rainv[j][l]/Ra_Rdot_tpv[j][l]- Rainv[j][l]/Ra_Rdot_tpv[j+4][l]);
+                Ra2_R_tinv[j][l] =  0.5e0*(Rainv[j][l]/Ra_Rdot_tv[j][l]- Rainv[j][l]/Ra_Rdot_tv[j+4][l]);
+                ylog_Ra_Rdot_tp[j][l] = yv[j][l]*log_Ra_Rdot_tp[j][l];
+                yRa2_R_tpinv[j][l]    = yv[j][l]*   Ra2_R_tpinv[j][l];
+                zlog_Ra_Rdot_t[j][l]  = zv[j][l]*log_Ra_Rdot_t[j][l];
+                zRa2_R_tinv[j][l]     = zv[j][l]*   Ra2_R_tinv[j][l];
+                y2Ra2_R_tpinv[j][l] = yv[j][l]* yRa2_R_tpinv[j][l];
+                z2Ra2_R_tinv[j][l]  = zv[j][l]*  zRa2_R_tinv[j][l];
+                f_003v[j][l] = -2.0e0*denom*atansumv[j][l];
+                adf_003[j][l] = f_003v[j][l]*a2_d2;
+            }
+
+            for (j = 0; j < 4; j++) {
+                commonf223[j][l] = (c*Ra[j][l] - adf_003[j][l])*onemc2inv;
+                f_103v[j][l] = (c*log_Ra_Rdot_t[j][l]  - log_Ra_Rdot_tp[j][l])*onemc2inv;
+                f_013v[j][l] = (c*log_Ra_Rdot_tp[j][l] - log_Ra_Rdot_t[j][l])*onemc2inv;
+                f_113v[j][l] = (c*adf_003[j][l] - Ra[j][l])*onemc2inv;
+            }
+
+            for (j = 0; j < 4; j++) {
+                commonf225[j][l] = f_003v[j][l] - c*Rainv[j][l];
+                commonf025[j][l] = c*yRa2_R_tpinv[j][l] - Rainv[j][l];
+                commonf205[j][l] = c*zRa2_R_tinv[j][l]  - Rainv[j][l];
+                commonf305[j][l] = log_Ra_Rdot_t[j][l]  -(yv[j][l]-c*zv[j][l])*Rainv[j][l] - c2*z2Ra2_R_tinv[j][l];
+                commonf035[j][l] = log_Ra_Rdot_tp[j][l] -(zv[j][l]-c*yv[j][l])*Rainv[j][l] - c2*y2Ra2_R_tpinv[j][l];
+                f_203v[j][l] =  zlog_Ra_Rdot_t[j][l]  + commonf223[j][l];
+                f_023v[j][l] =  ylog_Ra_Rdot_tp[j][l] + commonf223[j][l];
+                f_005v[j][l] = f_003v[j][l] - yRa2_R_tpinv[j][l] - zRa2_R_tinv[j][l];
+                f_105v[j][l] = Ra2_R_tpinv[j][l] - c*Ra2_R_tinv[j][l];
+                f_015v[j][l] = Ra2_R_tinv[j][l]  - c*Ra2_R_tpinv[j][l];
+                f_115v[j][l] = Rainv[j][l] - c*(yRa2_R_tpinv[j][l] + zRa2_R_tinv[j][l] + f_003v[j][l]);
+            }
+
+            for (j = 0; j < 4; j++) {
+                ycommonf025[j][l] = yv[j][l]*commonf025[j][l];
+                zcommonf205[j][l] = zv[j][l]*commonf205[j][l];
+                zcommonf305[j][l] = zv[j][l]*commonf305[j][l];
+                tf_113[j][l]=2.0e0*f_113v[j][l];
+                f_205v[j][l] = yRa2_R_tpinv[j][l] + c2*zRa2_R_tinv[j][l]  + commonf225[j][l];
+                f_025v[j][l] = zRa2_R_tinv[j][l]  + c2*yRa2_R_tpinv[j][l] + commonf225[j][l];
+                f_305v[j][l] = y2Ra2_R_tpinv[j][l] + c*commonf305[j][l] + 2.0e0*f_103v[j][l];
+                f_035v[j][l] = z2Ra2_R_tinv[j][l]  + c*commonf035[j][l] + 2.0e0*f_013v[j][l];
+            }
+
+            for (j = 0; j < 4; j++) {
+                f_215v[j][l] = f_013v[j][l] - ycommonf025[j][l] + c*(zcommonf205[j][l]-f_103v[j][l]);
+                f_125v[j][l] = f_103v[j][l] - zcommonf205[j][l] + c*(ycommonf025[j][l] - f_013v[j][l]);
+                f_225v[j][l] = f_203v[j][l] - zcommonf305[j][l] + c*(y2[j][l]*commonf025[j][l] - tf_113[j][l]);
+                f_315v[j][l] = tf_113[j][l] - y2[j][l]*commonf025[j][l] + c*(zcommonf305[j][l] - f_203v[j][l]);
+                f_135v[j][l] = tf_113[j][l] - z2[j][l]*commonf205[j][l] + c*(yv[j][l]*commonf035[j][l]-f_023v[j][l]);
+            }
+
+            f_003= (f_003v[0][l]+f_003v[3][l])-(f_003v[1][l]+f_003v[2][l]);
+            f_013= (f_013v[0][l]+f_013v[3][l])-(f_013v[1][l]+f_013v[2][l]);
+            f_103= (f_103v[0][l]+f_103v[3][l])-(f_103v[1][l]+f_103v[2][l]);
+            f_113= (f_113v[0][l]+f_113v[3][l])-(f_113v[1][l]+f_113v[2][l]);
+            f_023= (f_023v[0][l]+f_023v[3][l])-(f_023v[1][l]+f_023v[2][l]);
+            f_203= (f_203v[0][l]+f_203v[3][l])-(f_203v[1][l]+f_203v[2][l]);
+            f_005= (f_005v[0][l]+f_005v[3][l])-(f_005v[1][l]+f_005v[2][l]);
+            f_015= (f_015v[0][l]+f_015v[3][l])-(f_015v[1][l]+f_015v[2][l]);
+            f_105= (f_105v[0][l]+f_105v[3][l])-(f_105v[1][l]+f_105v[2][l]);
+            f_115= (f_115v[0][l]+f_115v[3][l])-(f_115v[1][l]+f_115v[2][l]);
+            f_025= (f_025v[0][l]+f_025v[3][l])-(f_025v[1][l]+f_025v[2][l]);
+            f_205= (f_205v[0][l]+f_205v[3][l])-(f_205v[1][l]+f_205v[2][l]);
+            f_215= (f_215v[0][l]+f_215v[3][l])-(f_215v[1][l]+f_215v[2][l]);
+            f_125= (f_125v[0][l]+f_125v[3][l])-(f_125v[1][l]+f_125v[2][l]);
+            f_035= (f_035v[0][l]+f_035v[3][l])-(f_035v[1][l]+f_035v[2][l]);
+            f_305= (f_305v[0][l]+f_305v[3][l])-(f_305v[1][l]+f_305v[2][l]);
+            f_225= (f_225v[0][l]+f_225v[3][l])-(f_225v[1][l]+f_225v[2][l]);
+            f_135= (f_135v[0][l]+f_135v[3][l])-(f_135v[1][l]+f_135v[2][l]);
+            f_315= (f_315v[0][l]+f_315v[3][l])-(f_315v[1][l]+f_315v[2][l]);
+
+            f_005 *= a2_d2inv;
+            f_105 *= onemc2inv;
+            f_015 *= onemc2inv;
+            f_115 *= onemc2inv;
+            f_205 *= onemc2inv;
+            f_025 *= onemc2inv;
+            f_305 *= onemc2inv;
+            f_035 *= onemc2inv;
+            f_215 *= onemc2inv;
+            f_125 *= onemc2inv;
+            f_225 *= onemc2inv;
+            f_315 *= onemc2inv;
+            f_135 *= onemc2inv;
+
+/*
+ *          now construct the vector coefficients for the definite integrals
+ */
+            a2 = a*a;
+            m4p = 0.25 * MU / pivalue;
+            m4pd =  m4p * d;
+            m8p = 0.5 * m4p;
+            m8pd = m8p * d;
+            m4pn = m4p / ( 1 - NU );
+            m4pnd = m4pn * d;
+            m4pnd2 = m4pnd * d;
+            m4pnd3 = m4pnd2 * d;
+            a2m4pnd = a2 * m4pnd;
+            a2m8pd = a2 * m8pd;
+            a2m4pn = a2 * m4pn;
+            a2m8p = a2 * m8p;
+
+            bct[0][l] = bv[1][l]*tv[2][l]-bv[2][l]*tv[1][l];
+            bct[1][l] = bv[2][l]*tv[0][l]-bv[0][l]*tv[2][l];
+            bct[2][l] = bv[0][l]*tv[1][l]-bv[1][l]*tv[0][l];
+            bpctp[0][l] = bpv[1][l]*tpv[2][l]-bpv[2][l]*tpv[1][l];
+            bpctp[1][l] = bpv[2][l]*tpv[0][l]-bpv[0][l]*tpv[2][l];
+            bpctp[2][l] = bpv[0][l]*tpv[1][l]-bpv[1][l]*tpv[0][l];
+
+            tdb=0.0e0;
+            tdbp=0.0e0;
+            tpdb=0.0e0;
+            tpdbp=0.0e0;
+            tctpdb=0.0e0;
+            tpctdbp=0.0e0;
+            bpctpdb=0.0e0;
+            bctdbp=0.0e0;
+
+            for (i=0;i<3;i++) {
+                tpct[i][l]=-tctpv[i][l];
+                tdb    +=tv[i][l]*bv[i][l];
+                tdbp   +=tv[i][l]*bpv[i][l];
+                tpdb   +=tpv[i][l]*bv[i][l];
+                tpdbp  +=tpv[i][l]*bpv[i][l];
+                tctpdb +=tctpv[i][l]*bv[i][l];
+                tpctdbp+=tpct[i][l]*bpv[i][l];
+                bpctpdb+=bpctp[i][l]*bv[i][l];
+                bctdbp +=bct[i][l]*bpv[i][l];
+            }
+
+            for (i=0;i<3;i++) {
+                tctpct[i][l]    =        tpv[i][l] -     c*tv[i][l];
+                tpctctp[i][l]   =         tv[i][l] -    c*tpv[i][l];
+                tcbpct[i][l]    =        bpv[i][l] -  tdbp*tv[i][l];
+                tpcbctp[i][l]   =         bv[i][l] - tpdb*tpv[i][l];
+                bpctpct[i][l]   =   tdbp*tpv[i][l] -    c*bpv[i][l];
+                bctctp[i][l]    =    tpdb*tv[i][l] -     c*bv[i][l];
+            }
+
+            tctpcbpdtp = tdbp - tpdbp*c;
+            tpctcbdt = tpdb - tdb*c;
+            tctpcbpdb =  tdbp*tpdb - tpdbp*tdb;
+            tpctcbdbp = tctpcbpdb;
+            tcbpdtp = tpctdbp;
+            tpcbdt = tctpdb;
+            tcbpdb = bctdbp;
+            tpcbdbp = bpctpdb;
+
+/*
+ *          forces on segment p3->p4
+ */
+            temp1 = tdbp*tpdb + tctpcbpdb;
+
+            for (i=0;i<3;i++) {
+                I00a[i][l] = temp1 * tpct[i][l];
+                I00b[i][l] = tctpcbpdtp * bct[i][l];
+            }
+
+            temp1 = (m4pnd * tctpdb);
+            temp2 = (m4pnd * bpctpdb);
+            temp3 = (m4pnd3 * tctpcbpdtp*tctpdb);
+
+            for (i=0;i<3;i++) {
+                I_003[i][l] = m4pd*I00a[i][l] - m4pnd*I00b[i][l] + temp1*bpctpct[i][l] +
+                        temp2*tctpct[i][l];
+                I_005[i][l] = a2m8pd*I00a[i][l] - a2m4pnd*I00b[i][l] - temp3*tctpct[i][l];
+                I10a[i][l] = tcbpct[i][l]*tpdb - tctpv[i][l]*tcbpdb;
+                I10b[i][l] = bct[i][l] * tcbpdtp;
+            }
+
+            temp1 = (m4pn * tdb);
+            temp2 = m4pnd2 * (tcbpdtp*tctpdb + tctpcbpdtp*tdb);
+
+            for (i=0;i<3;i++) {
+                I_103[i][l] = temp1*bpctpct[i][l] + m4p*I10a[i][l] - m4pn*I10b[i][l];
+                I_105[i][l] = a2m8p*I10a[i][l] - a2m4pn*I10b[i][l] - temp2*tctpct[i][l];
+                I01a[i][l] = tctpv[i][l]*bpctpdb - bpctpct[i][l]*tpdb;
+            }
+
+            tmp[0][l] = (m4pn * tpdb);
+            tmp[1][l] = (m4pn * bpctpdb);
+            tmp[2][l] = (m4pnd2 * tctpcbpdtp * tpdb);
+            tmp[3][l] = (m4pnd2 * tctpcbpdtp * tctpdb);
+            tmp[4][l] = (m4pnd * tcbpdtp * tdb);
+            tmp[5][l] = (m4pnd * tctpcbpdtp * tpdb) ;
+            tmp[6][l] = (m4pnd * (tctpcbpdtp*tdb + tcbpdtp*tctpdb));
+            tmp[7][l] = (m4pnd * tcbpdtp * tpdb);
+            tmp[8][l] = (m4pn * tcbpdtp * tdb);
+            tmp[9][l] = (m4pn * tcbpdtp * tpdb);
+
+            for (i=0;i<3;i++) {
+                I_013[i][l] = m4p*I01a[i][l] + tmp[0][l]*bpctpct[i][l] - tmp[1][l]*tctpv[i][l];
+                I_015[i][l] = a2m8p*I01a[i][l] - tmp[2][l]*tctpct[i][l] + tmp[3][l]*tctpv[i][l];
+                I_205[i][l] = -tmp[4][l] * tctpct[i][l];
+                I_025[i][l] = tmp[5][l] * tctpv[i][l];
+                I_115[i][l] =  tmp[6][l]*tctpv[i][l] - tmp[7][l]*tctpct[i][l];
+                I_215[i][l] = tmp[8][l] * tctpv[i][l];
+                I_125[i][l] = tmp[9][l] * tctpv[i][l];
+            }
+
+            Fint_003 = f_103 - y[0][l]*f_003;
+            Fint_103 = f_203 - y[0][l]*f_103;
+            Fint_013 = f_113 - y[0][l]*f_013;
+            Fint_005 = f_105 - y[0][l]*f_005;
+            Fint_105 = f_205 - y[0][l]*f_105;
+            Fint_015 = f_115 - y[0][l]*f_015;
+            Fint_115 = f_215 - y[0][l]*f_115;
+            Fint_205 = f_305 - y[0][l]*f_205;
+            Fint_025 = f_125 - y[0][l]*f_025;
+            Fint_215 = f_315 - y[0][l]*f_215;
+            Fint_125 = f_225 - y[0][l]*f_125;
+
+            for (i=0;i<3;i++) {
+                f4[i][l]=(I_003[i][l]*Fint_003 + I_103[i][l]*Fint_103 + I_013[i][l]*Fint_013 +
+                          I_005[i][l]*Fint_005 + I_105[i][l]*Fint_105 + I_015[i][l]*Fint_015 +
+                          I_115[i][l]*Fint_115 + I_205[i][l]*Fint_205 + I_025[i][l]*Fint_025 +
+                          I_215[i][l]*Fint_215 + I_125[i][l]*Fint_125) * oneoverL;
+            }
+
+            Fint_003 = y[1][l]*f_003 - f_103;
+            Fint_103 = y[1][l]*f_103 - f_203;
+            Fint_013 = y[1][l]*f_013 - f_113;
+            Fint_005 = y[1][l]*f_005 - f_105;
+            Fint_105 = y[1][l]*f_105 - f_205;
+            Fint_015 = y[1][l]*f_015 - f_115;
+            Fint_115 = y[1][l]*f_115 - f_215;
+            Fint_205 = y[1][l]*f_205 - f_305;
+            Fint_025 = y[1][l]*f_025 - f_125;
+            Fint_215 = y[1][l]*f_215 - f_315;
+            Fint_125 = y[1][l]*f_125 - f_225;
+
+            for (i=0;i<3;i++) {
+                f3[i][l]=(I_003[i][l]*Fint_003 + I_103[i][l]*Fint_103 + I_013[i][l]*Fint_013 +
+                          I_005[i][l]*Fint_005 + I_105[i][l]*Fint_105 + I_015[i][l]*Fint_015 +
+                          I_115[i][l]*Fint_115 + I_205[i][l]*Fint_205 + I_025[i][l]*Fint_025 +
+                          I_215[i][l]*Fint_215 + I_125[i][l]*Fint_125) * oneoverL;
+            }
+
+/*
+ *          forces on segment p1->p2
+ */
+            temp1 = tpdb*tdbp + tpctcbdbp;
+
+            for (i=0;i<3;i++) {
+                I00a[i][l] = temp1 * tctpv[i][l];
+                I00b[i][l] = bpctp[i][l] * tpctcbdt;
+            }
+
+            temp1 = m4pnd * tpctdbp;
+            temp2 = m4pnd * bctdbp;
+            temp3 = m4pnd3 * tpctcbdt * tpctdbp;
+
+            for (i=0;i<3;i++) {
+                I_003[i][l] = m4pd*I00a[i][l] - m4pnd*I00b[i][l] + temp1*bctctp[i][l] +
+                           temp2*tpctctp[i][l];
+                I_005[i][l] = a2m8pd*I00a[i][l] - a2m4pnd*I00b[i][l] - temp3*tpctctp[i][l];
+                I01a[i][l] = tpct[i][l]*tpcbdbp - tpcbctp[i][l]*tdbp;
+                I01b[i][l] = -bpctp[i][l] * tpcbdt;
+            }
+
+            temp1 = m4pn * tpdbp;
+            temp2 = m4pnd2 * (tpcbdt*tpctdbp + tpctcbdt*tpdbp);
+
+            for (i=0;i<3;i++) {
+                I_013[i][l] = -temp1 * bctctp[i][l] + m4p*I01a[i][l] - m4pn*I01b[i][l];
+                I_015[i][l] = a2m8p*I01a[i][l] - a2m4pn*I01b[i][l] + temp2*tpctctp[i][l];
+                I10a[i][l] = bctctp[i][l]*tdbp - tpct[i][l]*bctdbp;
+            }
+
+            tmp[0][l] = m4pn * tdbp;
+            tmp[1][l] = m4pn * bctdbp;
+            tmp[2][l] = m4pnd2 * tpctcbdt * tdbp;
+            tmp[3][l] = m4pnd2 * tpctcbdt * tpctdbp;
+            tmp[4][l] = (m4pnd * tpcbdt * tpdbp);
+            tmp[5][l] = (m4pnd * tpctcbdt * tdbp);
+            tmp[6][l] = m4pnd * (tpctcbdt*tpdbp + tpcbdt*tpctdbp);
+            tmp[7][l] = m4pnd * tpcbdt * tdbp;
+            tmp[8][l] = (m4pn * tpcbdt * tpdbp);
+            tmp[9][l] = (m4pn * tpcbdt * tdbp);
+
+            for (i=0;i<3;i++) {
+                I_103[i][l] = m4p*I10a[i][l] - tmp[0][l]*bctctp[i][l] + tmp[1][l]*tpct[i][l];
+                I_105[i][l] = a2m8p*I10a[i][l] + tmp[2][l]*tpctctp[i][l] - tmp[3][l]*tpct[i][l];
+                I_025[i][l] = -tmp[4][l] * tpctctp[i][l];
+                I_205[i][l] = tmp[5][l] * tpct[i][l];
+                I_115[i][l] = tmp[6][l]*tpct[i][l] - tmp[7][l]*tpctctp[i][l];
+                I_125[i][l] = -tmp[8][l] * tpct[i][l];
+                I_215[i][l] = -tmp[9][l] * tpct[i][l];
+            }
+
+            Fint_003 = f_013 - z[1][l]*f_003;
+            Fint_103 = f_113 - z[1][l]*f_103;
+            Fint_013 = f_023 - z[1][l]*f_013;
+            Fint_005 = f_015 - z[1][l]*f_005;
+            Fint_105 = f_115 - z[1][l]*f_105;
+            Fint_015 = f_025 - z[1][l]*f_015;
+            Fint_115 = f_125 - z[1][l]*f_115;
+            Fint_205 = f_215 - z[1][l]*f_205;
+            Fint_025 = f_035 - z[1][l]*f_025;
+            Fint_215 = f_225 - z[1][l]*f_215;
+            Fint_125 = f_135 - z[1][l]*f_125;
+
+            for (i=0;i<3;i++) {
+                f1[i][l]=(I_003[i][l]*Fint_003 + I_103[i][l]*Fint_103 + I_013[i][l]*Fint_013 +
+                          I_005[i][l]*Fint_005 + I_105[i][l]*Fint_105 + I_015[i][l]*Fint_015 +
+                          I_115[i][l]*Fint_115 + I_205[i][l]*Fint_205 + I_025[i][l]*Fint_025 +
+                          I_215[i][l]*Fint_215 + I_125[i][l]*Fint_125) * oneoverLp;
+            }
+
+            Fint_003 = z[0][l]*f_003 - f_013;
+            Fint_103 = z[0][l]*f_103 - f_113;
+            Fint_013 = z[0][l]*f_013 - f_023;
+            Fint_005 = z[0][l]*f_005 - f_015;
+            Fint_105 = z[0][l]*f_105 - f_115;
+            Fint_015 = z[0][l]*f_015 - f_025;
+            Fint_115 = z[0][l]*f_115 - f_125;
+            Fint_205 = z[0][l]*f_205 - f_215;
+            Fint_025 = z[0][l]*f_025 - f_035;
+            Fint_215 = z[0][l]*f_215 - f_225;
+            Fint_125 = z[0][l]*f_125 - f_135;
+
+            for (i=0;i<3;i++) {
+                f2[i][l]=(I_003[i][l]*Fint_003 + I_103[i][l]*Fint_103 + I_013[i][l]*Fint_013 +
+                          I_005[i][l]*Fint_005 + I_105[i][l]*Fint_105 + I_015[i][l]*Fint_015 +
+                          I_115[i][l]*Fint_115 + I_205[i][l]*Fint_205 + I_025[i][l]*Fint_025 +
+                          I_215[i][l]*Fint_215 + I_125[i][l]*Fint_125) * oneoverLp;
+            }
+        }
+
+        return;
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:       SegSegForceIsotropicSIMD
+ *      Description:    Vectorized equivalent of SegSegForceIsotropic()
+ *                      for a batch of segment pairs.  Pairs are gathered
+ *                      into blocks of SEGSEG_SIMD_WIDTH and evaluated
+ *                      lane-parallel; near-parallel pairs (1-c^2 below
+ *                      the same threshold the scalar kernel uses) are
+ *                      masked out and recomputed with the scalar
+ *                      SpecialSegSegForce().  Results agree with the
+ *                      scalar kernel to within SEGSEG_SIMD_RTOL.
+ *
+ *      Arguments:
+ *              numPairs     number of segment pairs
+ *              p1..p4       [numPairs][3] segment endpoints
+ *              b12, b34     [numPairs][3] burgers vectors
+ *              a, MU, NU    core parameter, shear modulus, poisson ratio
+ *              seg12Local   1 if forces on p1/p2 are needed
+ *              seg34Local   1 if forces on p3/p4 are needed
+ *              f1..f4       [numPairs][3] arrays in which to return the
+ *                           forces.  Forces not requested are zero.
+ *
+ *-----------------------------------------------------------------------*/
+void SegSegForceIsotropicSIMD(int numPairs,
+                              real8 *p1, real8 *p2, real8 *p3, real8 *p4,
+                              real8 *b12, real8 *b34,
+                              real8 a, real8 MU, real8 NU,
+                              int seg12Local, int seg34Local,
+                              real8 *f1, real8 *f2, real8 *f3, real8 *f4)
+{
+        int   i, k, l, n, m, nLanes, special[W];
+        real8 x1[3][W], x2[3][W], x3[3][W], x4[3][W], bp[3][W], b[3][W];
+        real8 g1[3][W], g2[3][W], g3[3][W], g4[3][W];
+        real8 eps = 1e-4;
+
+        for (n = 0; n < numPairs; n += W) {
+
+            nLanes = (numPairs - n < W) ? numPairs - n : W;
+
+/*
+ *          Gather the block into SoA form.  Unused lanes in a partial
+ *          block are padded with a copy of the first pair.
+ */
+            for (l = 0; l < W; l++) {
+                m = (l < nLanes) ? n + l : n;
+                for (i = 0; i < 3; i++) {
+                    k = 3*m + i;
+                    x1[i][l] = p1[k];
+                    x2[i][l] = p2[k];
+                    x3[i][l] = p3[k];
+                    x4[i][l] = p4[k];
+                    bp[i][l] = b12[k];
+                    b[i][l]  = b34[k];
+                }
+            }
+
+            SegSegForceIsotropicBlock(x1, x2, x3, x4, bp, b,
+                                      a, MU, NU, eps, special,
+                                      g1, g2, g3, g4);
+
+            for (l = 0; l < nLanes; l++) {
+                k = 3*(n + l);
+                if (special[l]) {
+                    f1[k] = 0.0; f1[k+1] = 0.0; f1[k+2] = 0.0;
+                    f2[k] = 0.0; f2[k+1] = 0.0; f2[k+2] = 0.0;
+                    f3[k] = 0.0; f3[k+1] = 0.0; f3[k+2] = 0.0;
+                    f4[k] = 0.0; f4[k+1] = 0.0; f4[k+2] = 0.0;
+                    SpecialSegSegForce(p1[k], p1[k+1], p1[k+2],
+                                       p2[k], p2[k+1], p2[k+2],
+                                       p3[k], p3[k+1], p3[k+2],
+                                       p4[k], p4[k+1], p4[k+2],
+                                       b12[k], b12[k+1], b12[k+2],
+                                       b34[k], b34[k+1], b34[k+2],
+                                       a, MU, NU, eps, seg12Local, seg34Local,
+                                       &f1[k], &f1[k+1], &f1[k+2],
+                                       &f2[k], &f2[k+1], &f2[k+2],
+                                       &f3[k], &f3[k+1], &f3[k+2],
+                                       &f4[k], &f4[k+1], &f4[k+2]);
+                    continue;
+                }
+                for (i = 0; i < 3; i++) {
+                    f1[k+i] = seg12Local ? g1[i][l] : 0.0;
+                    f2[k+i] = seg12Local ? g2[i][l] : 0.0;
+                    f3[k+i] = seg34Local ? g3[i][l] : 0.0;
+                    f4[k+i] = seg34Local ? g4[i][l] : 0.0;
+                }
+            }
+        }
+
+        return;
+}
+
+
+/*
+ *      Gauss-Legendre points and weights on [0,1] of the far-pair kernel
+ */
+static const float farPoints[SEGSEG_FAR_NQ]  = {0.11270167f, 0.5f, 0.88729833f};
+static const float farWeights[SEGSEG_FAR_NQ] = {0.27777778f, 0.44444444f, 0.27777778f};
+
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:       SegSegForceFarBlockF
+ *      Description:    Single precision forces of a block of WF well
+ *                      separated pairs (structure-of-arrays form, p1 at
+ *                      the origin).  Both line integrals are evaluated
+ *                      with SEGSEG_FAR_NQ point Gauss quadrature of the
+ *                      non-singular stress of a dislocation element
+ *                      (Cai et al., JMPS 54 (2006), eq. A.1) with
+ *                      R_a = sqrt(R.R + a^2):
+ *
+ *                        sigma.b = mu/(4 pi (1-nu)) [(c.R)(G - 1/R_a^3) b
+ *                                  - ((R.b) c + (c.b) R)/R_a^3
+ *                                  + 3 (R.b)(c.R) R/R_a^5]
+ *                                - mu/(8 pi) G [(R x b').b t' + (t'.b) (R x b')]
+ *
+ *                      with G = (2 R_a^2 + 3 a^2)/R_a^5, c = b' x t',
+ *                      R from the source element t' (burgers vector b')
+ *                      to the field point.  The quadrature has no
+ *                      cancellation between large terms, unlike the
+ *                      closed-form integrals of SegSegForceIsotropic(),
+ *                      which lose about (r/L)^2 digits for segments of
+ *                      length L a distance r apart and are therefore
+ *                      only usable in double precision.  Each quadrature
+ *                      pair gives the forces on both segments (R changes
+ *                      sign).
+ *
+ *      Arguments:
+ *              x2, x3, x4   endpoints of the segments 0->x2, x3->x4
+ *              bp, b        burgers vectors of 0->x2 and x3->x4
+ *              a, MU, NU    core parameter, shear modulus, poisson ratio
+ *              f1..f4       forces at 0, x2, x3, x4
+ *
+ *-----------------------------------------------------------------------*/
+static void SegSegForceFarBlockF(float x2[3][WF], float x3[3][WF],
+                                 float x4[3][WF],
+                                 float bp[3][WF], float b[3][WF],
+                                 float a, float MU, float NU,
+                                 float f1[3][WF], float f2[3][WF],
+                                 float f3[3][WF], float f4[3][WF])
+{
+        int   l, q, r;
+        float m8p, m4pn, a2;
+        float t12[3][WF], t34[3][WF], c12[3][WF], c34[3][WF], bcbp[3][WF];
+        float t34db12[WF], t12db34[WF], c34db12[WF], c12db34[WF];
+
+        m8p  = MU / (8.0f * 3.14159265f);
+        m4pn = MU / (4.0f * 3.14159265f * (1.0f - NU));
+        a2   = a*a;
+
+#pragma omp simd
+        for (l = 0; l < WF; l++) {
+            int i;
+            for (i = 0; i < 3; i++) {
+                t12[i][l] = x2[i][l];
+                t34[i][l] = x4[i][l] - x3[i][l];
+                f1[i][l] = 0.0f; f2[i][l] = 0.0f;
+                f3[i][l] = 0.0f; f4[i][l] = 0.0f;
+            }
+            c12[0][l] = bp[1][l]*t12[2][l] - bp[2][l]*t12[1][l];
+            c12[1][l] = bp[2][l]*t12[0][l] - bp[0][l]*t12[2][l];
+            c12[2][l] = bp[0][l]*t12[1][l] - bp[1][l]*t12[0][l];
+            c34[0][l] = b[1][l]*t34[2][l] - b[2][l]*t34[1][l];
+            c34[1][l] = b[2][l]*t34[0][l] - b[0][l]*t34[2][l];
+            c34[2][l] = b[0][l]*t34[1][l] - b[1][l]*t34[0][l];
+            bcbp[0][l] = b[1][l]*bp[2][l] - b[2][l]*bp[1][l];
+            bcbp[1][l] = b[2][l]*bp[0][l] - b[0][l]*bp[2][l];
+            bcbp[2][l] = b[0][l]*bp[1][l] - b[1][l]*bp[0][l];
+            t34db12[l] = t34[0][l]*bp[0][l] + t34[1][l]*bp[1][l] + t34[2][l]*bp[2][l];
+            t12db34[l] = t12[0][l]*b[0][l]  + t12[1][l]*b[1][l]  + t12[2][l]*b[2][l];
+            c34db12[l] = c34[0][l]*bp[0][l] + c34[1][l]*bp[1][l] + c34[2][l]*bp[2][l];
+            c12db34[l] = c12[0][l]*b[0][l]  + c12[1][l]*b[1][l]  + c12[2][l]*b[2][l];
+        }
+
+/*
+ *      The quadrature loops are outside the lane loop so that the lane
+ *      loop body is straight-line code the compiler can vectorize.
+ */
+        for (q = 0; q < SEGSEG_FAR_NQ; q++) {
+            for (r = 0; r < SEGSEG_FAR_NQ; r++) {
+                float s = farPoints[q], u = farPoints[r];
+                float w = farWeights[q]*farWeights[r];
+
+#pragma omp simd
+                for (l = 0; l < WF; l++) {
+                    int   i;
+                    float R[3], Ra2, Rainv, Rainv3, Rainv5, G;
+                    float Rdbp, Rdb, cR34, cR12, Rcbdbp;
+                    float Rcb[3], Rcbp[3], s12[3], s34[3], fd[3];
+
+                    for (i = 0; i < 3; i++) {
+                        R[i] = s*t12[i][l] - x3[i][l] - u*t34[i][l];
+                    }
+                    Ra2    = R[0]*R[0] + R[1]*R[1] + R[2]*R[2] + a2;
+                    Rainv  = 1.0f / sqrtf(Ra2);
+                    Rainv3 = Rainv*Rainv*Rainv;
+                    Rainv5 = Rainv3*Rainv*Rainv;
+                    G = (2.0f*Ra2 + 3.0f*a2) * Rainv5;
+
+                    Rdbp   = R[0]*bp[0][l] + R[1]*bp[1][l] + R[2]*bp[2][l];
+                    Rdb    = R[0]*b[0][l]  + R[1]*b[1][l]  + R[2]*b[2][l];
+                    cR34   = c34[0][l]*R[0] + c34[1][l]*R[1] + c34[2][l]*R[2];
+                    cR12   = c12[0][l]*R[0] + c12[1][l]*R[1] + c12[2][l]*R[2];
+                    Rcbdbp = R[0]*bcbp[0][l] + R[1]*bcbp[1][l] + R[2]*bcbp[2][l];
+                    Rcb[0]  = R[1]*b[2][l]  - R[2]*b[1][l];
+                    Rcb[1]  = R[2]*b[0][l]  - R[0]*b[2][l];
+                    Rcb[2]  = R[0]*b[1][l]  - R[1]*b[0][l];
+                    Rcbp[0] = R[1]*bp[2][l] - R[2]*bp[1][l];
+                    Rcbp[1] = R[2]*bp[0][l] - R[0]*bp[2][l];
+                    Rcbp[2] = R[0]*bp[1][l] - R[1]*bp[0][l];
+
+/*
+ *                  stress of the 3->4 element at the 1->2 point dotted
+ *                  with b12, and of the 1->2 element at the 3->4 point
+ *                  (R -> -R) dotted with b34
+ */
+                    for (i = 0; i < 3; i++) {
+                        s12[i] = m4pn*(cR34*(G - Rainv3)*bp[i][l]
+                                       - (c34[i][l]*Rdbp + R[i]*c34db12[l])*Rainv3
+                                       + 3.0f*R[i]*Rdbp*cR34*Rainv5)
+                               - m8p*G*(Rcb[i]*t34db12[l] + t34[i][l]*Rcbdbp);
+                        s34[i] = -m4pn*(cR12*(G - Rainv3)*b[i][l]
+                                        - (c12[i][l]*Rdb + R[i]*c12db34[l])*Rainv3
+                                        + 3.0f*R[i]*Rdb*cR12*Rainv5)
+                               - m8p*G*(t12[i][l]*Rcbdbp - Rcbp[i]*t12db34[l]);
+                    }
+
+                    fd[0] = s12[1]*t12[2][l] - s12[2]*t12[1][l];
+                    fd[1] = s12[2]*t12[0][l] - s12[0]*t12[2][l];
+                    fd[2] = s12[0]*t12[1][l] - s12[1]*t12[0][l];
+                    for (i = 0; i < 3; i++) {
+                        f1[i][l] += w*(1.0f - s)*fd[i];
+                        f2[i][l] += w*s*fd[i];
+                    }
+
+                    fd[0] = s34[1]*t34[2][l] - s34[2]*t34[1][l];
+                    fd[1] = s34[2]*t34[0][l] - s34[0]*t34[2][l];
+                    fd[2] = s34[0]*t34[1][l] - s34[1]*t34[0][l];
+                    for (i = 0; i < 3; i++) {
+                        f3[i][l] += w*(1.0f - u)*fd[i];
+                        f4[i][l] += w*u*fd[i];
+                    }
+                }
+            }
+        }
+
+        return;
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:       SegSegForceIsotropicSIMDF
+ *      Description:    Single precision forces of a batch of well
+ *                      separated segment pairs, for the mixed precision
+ *                      policy of the pair loop drivers (see
+ *                      SegSegForceRow()).  Each pair is
+ *                      shifted in double precision so that p1 is at the
+ *                      origin before it is rounded to float, blocks of
+ *                      SEGSEG_SIMD_WIDTH_F pairs are evaluated with
+ *                      SegSegForceFarBlockF(), and the forces are
+ *                      returned in double so that callers accumulate in
+ *                      double precision.
+ *
+ *                      Only valid for pairs whose midpoints are at least
+ *                      SEGSEG_FAR_RATIO times the length of the longer
+ *                      segment apart; closer pairs need the analytic
+ *                      SegSegForceIsotropicSIMD().
+ *
+ *      Arguments:      as for SegSegForceIsotropicSIMD()
+ *
+ *-----------------------------------------------------------------------*/
+void SegSegForceIsotropicSIMDF(int numPairs,
+                               real8 *p1, real8 *p2, real8 *p3, real8 *p4,
+                               real8 *b12, real8 *b34,
+                               real8 a, real8 MU, real8 NU,
+                               int seg12Local, int seg34Local,
+                               real8 *f1, real8 *f2, real8 *f3, real8 *f4)
+{
+        int   i, k, l, n, m, nLanes;
+        float x2[3][WF], x3[3][WF], x4[3][WF], bp[3][WF], b[3][WF];
+        float g1[3][WF], g2[3][WF], g3[3][WF], g4[3][WF];
+
+        for (n = 0; n < numPairs; n += WF) {
+
+            nLanes = (numPairs - n < WF) ? numPairs - n : WF;
+
+            for (l = 0; l < WF; l++) {
+                m = (l < nLanes) ? n + l : n;
+                for (i = 0; i < 3; i++) {
+                    k = 3*m + i;
+                    x2[i][l] = (float)(p2[k] - p1[k]);
+                    x3[i][l] = (float)(p3[k] - p1[k]);
+                    x4[i][l] = (float)(p4[k] - p1[k]);
+                    bp[i][l] = (float)b12[k];
+                    b[i][l]  = (float)b34[k];
+                }
+            }
+
+            SegSegForceFarBlockF(x2, x3, x4, bp, b,
+                                 (float)a, (float)MU, (float)NU,
+                                 g1, g2, g3, g4);
+
+            for (l = 0; l < nLanes; l++) {
+                k = 3*(n + l);
+                for (i = 0; i < 3; i++) {
+                    f1[k+i] = seg12Local ? (real8)g1[i][l] : 0.0;
+                    f2[k+i] = seg12Local ? (real8)g2[i][l] : 0.0;
+                    f3[k+i] = seg34Local ? (real8)g3[i][l] : 0.0;
+                    f4[k+i] = seg34Local ? (real8)g4[i][l] : 0.0;
+                }
+            }
+        }
+
+        return;
+}
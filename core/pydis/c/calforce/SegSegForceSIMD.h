@@ -0,0 +1,50 @@
+#include <math.h>
+#define real8 double
+
+/*
+ *      Number of segment pairs processed together by the vectorized
+ *      kernel.  8 doubles fill an AVX-512 register, 4 an AVX2 register.
+ */
+#ifndef SEGSEG_SIMD_WIDTH
+#define SEGSEG_SIMD_WIDTH 8
+#endif
+
+/*
+ *      Single precision far-pair kernel SegSegForceIsotropicSIMDF():
+ *      lane count (twice as many floats as doubles fit a register),
+ *      Gauss points per segment, and the minimum midpoint distance, in
+ *      units of the longer segment, of the pairs it may be used for.
+ *      Relative to a converged quadrature the force errors of such pairs
+ *      are below ~3e-5 rms (single precision round-off farther out).
+ */
+#ifndef SEGSEG_SIMD_WIDTH_F
+#define SEGSEG_SIMD_WIDTH_F (2*SEGSEG_SIMD_WIDTH)
+#endif
+#define SEGSEG_FAR_NQ     3
+#define SEGSEG_FAR_RATIO  4.0
+
+/*
+ *      Maximum difference between the vectorized and the scalar
+ *      SegSegForceIsotropic() kernel, relative to the largest force
+ *      component in the batch.  Both kernels evaluate the same
+ *      expressions in the same order, so without FMA contraction the
+ *      results are bitwise identical.  With FMA (-march=native) or the
+ *      libmvec log/atan (SEGSEG_SIMD_VECMATH) the differences are
+ *      rounding errors amplified by 1/(1-c^2) for pairs close to the
+ *      parallel threshold and stay below ~1e-9.
+ */
+#define SEGSEG_SIMD_RTOL 1.0e-8
+
+void SegSegForceIsotropicSIMD(int numPairs,
+                              real8 *p1, real8 *p2, real8 *p3, real8 *p4,
+                              real8 *b12, real8 *b34,
+                              real8 a, real8 MU, real8 NU,
+                              int seg12Local, int seg34Local,
+                              real8 *f1, real8 *f2, real8 *f3, real8 *f4);
+
+void SegSegForceIsotropicSIMDF(int numPairs,
+                               real8 *p1, real8 *p2, real8 *p3, real8 *p4,
+                               real8 *b12, real8 *b34,
+                               real8 a, real8 MU, real8 NU,
+                               int seg12Local, int seg34Local,
+                               real8 *f1, real8 *f2, real8 *f3, real8 *f4);
@@ -1,6 +1,7 @@
 #include "SegSegForce_SBN1.h"
 #include "SegmentStress.h"
 #include "StressDueToSeg.h"
+#include "../include/Error.h"
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -10,6 +11,23 @@
 
 #define MAX_QUAD_POINTS 7
 
+/*
+ *      The fixed-Nint kernels rely on their bodies being inlined with a
+ *      constant number of points.
+ */
+#if defined(__GNUC__)
+#define SBN1_INLINE static inline __attribute__((always_inline))
+#else
+#define SBN1_INLINE static inline
+#endif
+
+/*
+ *      Device callable as well, see SegSegForceDevice.c.
+ */
+#ifdef _OPENMP
+#pragma omp declare target
+#endif
+
 real8 Shape_Func_N1(real8 x)
 {
     return 0.5 * (1.0 - x);
@@ -20,6 +38,509 @@ real8 Shape_Func_N2(real8 x)
     return 0.5 * (1.0 + x);
 }
 
+
+static void SBN1SetConsts(real8 a, real8 MU, real8 NU, SBN1Consts_t *k)
+{
+        k->a2    = a * a;
+        k->m4p   = 0.25 * MU / M_PI;
+        k->m8p   = 0.5 * k->m4p;
+        k->m4pn  = k->m4p / (1 - NU);
+        k->mn4pn = k->m4pn * NU;
+        k->a2m8p = k->a2 * k->m8p;
+}
+
+
+/*
+ *      Material constants for a, MU, NU: those of the context if they
+ *      were set for the same values, otherwise derived into *local.
+ */
+static SBN1Consts_t *SBN1ContextConsts(SBN1Context_t *ctx, real8 a,
+                                       real8 MU, real8 NU,
+                                       SBN1Consts_t *local)
+{
+        if (ctx->haveMaterial && (ctx->a == a) && (ctx->MU == MU) &&
+            (ctx->NU == NU)) {
+            return(&ctx->consts);
+        }
+
+        SBN1SetConsts(a, MU, NU, local);
+
+        return(local);
+}
+
+#ifdef _OPENMP
+#pragma omp end declare target
+#endif
+
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:       SBN1ContextCreate
+ *      Description:    Allocate the quadrature data of an Nint point rule
+ *                      for the SBN1 force functions.  The context does not
+ *                      depend on the segments and may be shared by any
+ *                      number of calls (and threads).
+ *
+ *      Arguments:
+ *              Nint         number of quadrature points
+ *              quad_points  [Nint] abscissae on [-1,1]
+ *              weights      [Nint] quadrature weights
+ *
+ *-----------------------------------------------------------------------*/
+SBN1Context_t *SBN1ContextCreate(int Nint, real8 *quad_points, real8 *weights)
+{
+    int i;
+    SBN1Context_t *ctx;
+
+    if (Nint < 1) {
+        ErrorRaise("SBN1ContextCreate: cannot create context for Nint = %d", Nint);
+    }
+
+    ctx = (SBN1Context_t *)malloc(sizeof(SBN1Context_t));
+    if (ctx != NULL) {
+        ctx->quad_points = (real8 *)malloc(4 * Nint * sizeof(real8));
+        if (ctx->quad_points == NULL) {
+            free(ctx);
+            ctx = NULL;
+        }
+    }
+    if (ctx == NULL) {
+        ErrorRaise("SBN1ContextCreate: out of memory");
+    }
+
+    ctx->Nint         = Nint;
+    ctx->haveMaterial = 0;
+    ctx->weights     = ctx->quad_points + Nint;
+    ctx->N1w         = ctx->quad_points + 2*Nint;
+    ctx->N2w         = ctx->quad_points + 3*Nint;
+
+    for(i = 0; i < Nint; i++)
+    {
+        ctx->quad_points[i] = quad_points[i];
+        ctx->weights[i]     = weights[i];
+        ctx->N1w[i]         = Shape_Func_N1(quad_points[i]) * weights[i];
+        ctx->N2w[i]         = Shape_Func_N2(quad_points[i]) * weights[i];
+    }
+
+    return ctx;
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:       SBN1ContextSetMaterial
+ *      Description:    Derive the material constants of the SBN1 stress
+ *                      once for all calls with the core radius a, shear
+ *                      modulus MU and poisson ratio NU, instead of per
+ *                      pair.  Call before the context is shared.
+ *
+ *-----------------------------------------------------------------------*/
+void SBN1ContextSetMaterial(SBN1Context_t *ctx, real8 a, real8 MU, real8 NU)
+{
+    ctx->a  = a;
+    ctx->MU = MU;
+    ctx->NU = NU;
+    SBN1SetConsts(a, MU, NU, &ctx->consts);
+    ctx->haveMaterial = 1;
+}
+
+
+void SBN1ContextFree(SBN1Context_t *ctx)
+{
+    if (ctx == NULL) return;
+    free(ctx->quad_points);
+    free(ctx);
+}
+
+
+#ifdef _OPENMP
+#pragma omp declare target
+#endif
+
+/*
+ *      Quantities of a source segment that do not depend on the field
+ *      point: the StressDueToSeg() terms built only from the segment
+ *      direction and burgers vector.  Both halves of a pair evaluation
+ *      and all quadrature points of a half reuse them.
+ */
+typedef struct {
+        real8 p1[3], p2[3];      /* segment endpoints                  */
+        real8 t[3], b[3], txb[3];
+        real8 tmt[6];            /* t (x) t in Voigt order             */
+        real8 tmtxb[6];          /* sym(t (x) (t x b)), Voigt order    */
+        real8 I_13[6];           /* -mn4pn * tmtxb                     */
+        real8 a2m8ptmtxb[6];     /* a2m8p * tmtxb                      */
+} SBN1Source_t;
+
+static void SBN1SetSource(real8 p1x, real8 p1y, real8 p1z,
+                          real8 p2x, real8 p2y, real8 p2z,
+                          real8 bx, real8 by, real8 bz,
+                          SBN1Consts_t *k, SBN1Source_t *s)
+{
+        int   i;
+        real8 vx, vy, vz, oneoverLp;
+        real8 *t = s->t, *txb = s->txb;
+
+        s->p1[0] = p1x; s->p1[1] = p1y; s->p1[2] = p1z;
+        s->p2[0] = p2x; s->p2[1] = p2y; s->p2[2] = p2z;
+        s->b[0]  = bx;  s->b[1]  = by;  s->b[2]  = bz;
+
+        vx = p2x - p1x;
+        vy = p2y - p1y;
+        vz = p2z - p1z;
+
+        oneoverLp = 1 / sqrt(vx*vx + vy*vy + vz*vz);
+
+        t[0] = vx * oneoverLp;
+        t[1] = vy * oneoverLp;
+        t[2] = vz * oneoverLp;
+
+        txb[0] = t[1]*bz - t[2]*by;
+        txb[1] = t[2]*bx - t[0]*bz;
+        txb[2] = t[0]*by - t[1]*bx;
+
+        s->tmt[0] = t[0] * t[0];
+        s->tmt[1] = t[1] * t[1];
+        s->tmt[2] = t[2] * t[2];
+        s->tmt[3] = t[0] * t[1];
+        s->tmt[4] = t[1] * t[2];
+        s->tmt[5] = t[0] * t[2];
+
+        s->tmtxb[0] = 2 * t[0] * txb[0];
+        s->tmtxb[1] = 2 * t[1] * txb[1];
+        s->tmtxb[2] = 2 * t[2] * txb[2];
+        s->tmtxb[3] = t[0]*txb[1] + t[1]*txb[0];
+        s->tmtxb[4] = t[1]*txb[2] + t[2]*txb[1];
+        s->tmtxb[5] = t[0]*txb[2] + t[2]*txb[0];
+
+        for (i = 0; i < 6; i++) {
+            s->I_13[i]       = -k->mn4pn * s->tmtxb[i];
+            s->a2m8ptmtxb[i] = k->a2m8p * s->tmtxb[i];
+        }
+}
+
+
+/*
+ *      Stress at (px,py,pz) of a source segment, identical in value to
+ *      StressDueToSeg() but without the per-point segment setup.
+ */
+SBN1_INLINE void SBN1SourceStress(SBN1Source_t *s, SBN1Consts_t *k,
+                                  real8 px, real8 py, real8 pz, real8 *stress)
+{
+        real8 *t = s->t, *b = s->b, *txb = s->txb;
+        real8 Rx, Ry, Rz, Rdt, ndx, ndy, ndz, d2, s1, s2;
+        real8 a2_d2, a2d2inv, Ra, Rainv, Ra3inv, sRa3inv;
+        real8 s_03a, s_13a, s_05a, s_15a, s_25a;
+        real8 s_03b, s_13b, s_05b, s_15b, s_25b;
+        real8 s_03, s_13, s_05, s_15, s_25;
+        real8 dxbx, dxby, dxbz, dxbdt, common;
+        real8 dmd[6], tmd[6], dmtxb[6], tmdxb[6];
+        real8 I_03, I_05, I_15, I_25;
+        int   i;
+
+        Rx = px - s->p1[0];
+        Ry = py - s->p1[1];
+        Rz = pz - s->p1[2];
+
+        Rdt = Rx*t[0] + Ry*t[1] + Rz*t[2];
+
+        ndx = Rx - Rdt*t[0];
+        ndy = Ry - Rdt*t[1];
+        ndz = Rz - Rdt*t[2];
+
+        d2 = ndx*ndx + ndy*ndy + ndz*ndz;
+
+        s1 = -Rdt;
+        s2 = -((px-s->p2[0])*t[0] + (py-s->p2[1])*t[1] + (pz-s->p2[2])*t[2]);
+        a2_d2 = k->a2 + d2;
+        a2d2inv = 1 / a2_d2;
+
+        Ra = sqrt(a2_d2 + s1*s1);
+        Rainv = 1 / Ra;
+        Ra3inv = Rainv * Rainv * Rainv;
+        sRa3inv = s1 * Ra3inv;
+
+        s_03a = s1 * Rainv * a2d2inv;
+        s_13a = -Rainv;
+        s_05a = (2*s_03a + sRa3inv) * a2d2inv;
+        s_15a = -Ra3inv;
+        s_25a = s_03a - sRa3inv;
+
+        Ra = sqrt(a2_d2 + s2*s2);
+        Rainv = 1 / Ra;
+        Ra3inv = Rainv * Rainv * Rainv;
+        sRa3inv = s2 * Ra3inv;
+
+        s_03b = s2 * Rainv * a2d2inv;
+        s_13b = -Rainv;
+        s_05b = (2*s_03b + sRa3inv) * a2d2inv;
+        s_15b = -Ra3inv;
+        s_25b = s_03b - sRa3inv;
+
+        s_03 = s_03b - s_03a;
+        s_13 = s_13b - s_13a;
+        s_05 = s_05b - s_05a;
+        s_15 = s_15b - s_15a;
+        s_25 = s_25b - s_25a;
+
+        dxbx = ndy*b[2] - ndz*b[1];
+        dxby = ndz*b[0] - ndx*b[2];
+        dxbz = ndx*b[1] - ndy*b[0];
+
+        dxbdt = dxbx*t[0] + dxby*t[1] + dxbz*t[2];
+
+        dmd[0] = ndx * ndx;
+        dmd[1] = ndy * ndy;
+        dmd[2] = ndz * ndz;
+        dmd[3] = ndx * ndy;
+        dmd[4] = ndy * ndz;
+        dmd[5] = ndx * ndz;
+
+        tmd[0] = 2 * t[0] * ndx;
+        tmd[1] = 2 * t[1] * ndy;
+        tmd[2] = 2 * t[2] * ndz;
+        tmd[3] = t[0]*ndy + t[1]*ndx;
+        tmd[4] = t[1]*ndz + t[2]*ndy;
+        tmd[5] = t[0]*ndz + t[2]*ndx;
+
+        dmtxb[0] = 2 * ndx * txb[0];
+        dmtxb[1] = 2 * ndy * txb[1];
+        dmtxb[2] = 2 * ndz * txb[2];
+        dmtxb[3] = ndx*txb[1] + ndy*txb[0];
+        dmtxb[4] = ndy*txb[2] + ndz*txb[1];
+        dmtxb[5] = ndx*txb[2] + ndz*txb[0];
+
+        tmdxb[0] = 2 * t[0] * dxbx;
+        tmdxb[1] = 2 * t[1] * dxby;
+        tmdxb[2] = 2 * t[2] * dxbz;
+        tmdxb[3] = t[0]*dxby + t[1]*dxbx;
+        tmdxb[4] = t[1]*dxbz + t[2]*dxby;
+        tmdxb[5] = t[0]*dxbz + t[2]*dxbx;
+
+        common = k->m4pn * dxbdt;
+
+        for (i = 0; i < 6; i++) {
+            if (i < 3) {
+                I_03 = common + k->m4pn*dmtxb[i] - k->m4p*tmdxb[i];
+                I_05 = common*(k->a2+dmd[i]) - k->a2m8p*tmdxb[i];
+            } else {
+                I_03 = k->m4pn*dmtxb[i] - k->m4p*tmdxb[i];
+                I_05 = common*dmd[i] - k->a2m8p*tmdxb[i];
+            }
+            I_15 = s->a2m8ptmtxb[i] - common*tmd[i];
+            I_25 = common * s->tmt[i];
+
+            stress[i] = I_03*s_03 + s->I_13[i]*s_13 + I_05*s_05 +
+                        I_15*s_15 + I_25*s_25;
+        }
+}
+
+
+/*
+ *      Stress of a source segment at the n points x[0..2][q] into
+ *      sigma[0..5][q].  With a constant n the loop over the points is
+ *      unrolled, and vectorized where the compiler honors omp simd.
+ */
+SBN1_INLINE void SBN1SourceStressPoints(SBN1Source_t *s, SBN1Consts_t *k, int n,
+                                        real8 x[3][SBN1_MAX_FIXED_NINT],
+                                        real8 sigma[6][SBN1_MAX_FIXED_NINT])
+{
+        int q;
+
+#pragma omp simd
+        for (q = 0; q < n; q++) {
+            int   i;
+            real8 sigma_vec[6];
+
+            SBN1SourceStress(s, k, x[0][q], x[1][q], x[2][q], sigma_vec);
+
+            for (i = 0; i < 6; i++) {
+                sigma[i][q] = sigma_vec[i];
+            }
+        }
+}
+
+
+/*
+ *      Accumulate into f3 and f4 the force on the segment x3->x4 at
+ *      abscissa xi from the stress of the source segment.
+ */
+static inline void SBN1PointForce(SBN1Source_t *src, SBN1Consts_t *k,
+                                  real8 mid[3], real8 half[3],
+                                  real8 bx, real8 by, real8 bz,
+                                  real8 xi, real8 n1w, real8 n2w,
+                                  real8 f3[3], real8 f4[3])
+{
+        real8 sigma_vec[6], sigb[3], fx, fy, fz;
+
+        SBN1SourceStress(src, k, mid[0] + half[0] * xi,
+                         mid[1] + half[1] * xi, mid[2] + half[2] * xi,
+                         sigma_vec);
+
+        sigb[0] = sigma_vec[0] * bx + sigma_vec[3] * by + sigma_vec[5] * bz;
+        sigb[1] = sigma_vec[3] * bx + sigma_vec[1] * by + sigma_vec[4] * bz;
+        sigb[2] = sigma_vec[5] * bx + sigma_vec[4] * by + sigma_vec[2] * bz;
+
+        fx = sigb[1]*half[2] - sigb[2]*half[1];
+        fy = sigb[2]*half[0] - sigb[0]*half[2];
+        fz = sigb[0]*half[1] - sigb[1]*half[0];
+
+        f3[0] += fx * n1w; f3[1] += fy * n1w; f3[2] += fz * n1w;
+        f4[0] += fx * n2w; f4[1] += fy * n2w; f4[2] += fz * n2w;
+}
+
+
+/*
+ *      Same as n calls of SBN1PointForce() for the abscissae
+ *      quad_points[0..n-1], with the stress of all points evaluated
+ *      first.  Inlined with a constant n by SBN1SegForce().
+ */
+SBN1_INLINE void SBN1FixedForce(SBN1Source_t *src, SBN1Consts_t *k, int n,
+                                real8 *quad_points, real8 *N1w, real8 *N2w,
+                                real8 mid[3], real8 half[3],
+                                real8 bx, real8 by, real8 bz,
+                                real8 f3[3], real8 f4[3])
+{
+        int   q, i;
+        real8 x[3][SBN1_MAX_FIXED_NINT], sigma[6][SBN1_MAX_FIXED_NINT];
+        real8 sigb[3], fx, fy, fz;
+
+        for (q = 0; q < n; q++) {
+            for (i = 0; i < 3; i++) {
+                x[i][q] = mid[i] + half[i] * quad_points[q];
+            }
+        }
+
+        SBN1SourceStressPoints(src, k, n, x, sigma);
+
+        for (q = 0; q < n; q++) {
+            sigb[0] = sigma[0][q] * bx + sigma[3][q] * by + sigma[5][q] * bz;
+            sigb[1] = sigma[3][q] * bx + sigma[1][q] * by + sigma[4][q] * bz;
+            sigb[2] = sigma[5][q] * bx + sigma[4][q] * by + sigma[2][q] * bz;
+
+            fx = sigb[1]*half[2] - sigb[2]*half[1];
+            fy = sigb[2]*half[0] - sigb[0]*half[2];
+            fz = sigb[0]*half[1] - sigb[1]*half[0];
+
+            f3[0] += fx * N1w[q]; f3[1] += fy * N1w[q]; f3[2] += fz * N1w[q];
+            f4[0] += fx * N2w[q]; f4[1] += fy * N2w[q]; f4[2] += fz * N2w[q];
+        }
+}
+
+
+/*
+ *      Accumulate into f3 and f4 the forces on the segment with midpoint
+ *      mid, half vector half and burgers vector b from the stress of the
+ *      source segment, integrated with the Nint point rule.  Rules of up
+ *      to SBN1_MAX_FIXED_NINT points are dispatched to an instance of
+ *      SBN1FixedForce() for their number of points.
+ */
+static void SBN1SegForce(SBN1Source_t *src, SBN1Consts_t *k, int Nint,
+                         real8 *quad_points, real8 *N1w, real8 *N2w,
+                         real8 mid[3], real8 half[3],
+                         real8 bx, real8 by, real8 bz,
+                         real8 f3[3], real8 f4[3])
+{
+    int i;
+
+#if SBN1_MAX_FIXED_NINT < 7
+#error "SBN1SegForce instantiates SBN1FixedForce for up to 7 points"
+#endif
+
+    switch (Nint) {
+        case 1: SBN1FixedForce(src, k, 1, quad_points, N1w, N2w, mid, half, bx, by, bz, f3, f4); return;
+        case 2: SBN1FixedForce(src, k, 2, quad_points, N1w, N2w, mid, half, bx, by, bz, f3, f4); return;
+        case 3: SBN1FixedForce(src, k, 3, quad_points, N1w, N2w, mid, half, bx, by, bz, f3, f4); return;
+        case 4: SBN1FixedForce(src, k, 4, quad_points, N1w, N2w, mid, half, bx, by, bz, f3, f4); return;
+        case 5: SBN1FixedForce(src, k, 5, quad_points, N1w, N2w, mid, half, bx, by, bz, f3, f4); return;
+        case 6: SBN1FixedForce(src, k, 6, quad_points, N1w, N2w, mid, half, bx, by, bz, f3, f4); return;
+        case 7: SBN1FixedForce(src, k, 7, quad_points, N1w, N2w, mid, half, bx, by, bz, f3, f4); return;
+    }
+
+    for(i = 0; i < Nint; i++)
+    {
+        SBN1PointForce(src, k, mid, half, bx, by, bz,
+                       quad_points[i], N1w[i], N2w[i], f3, f4);
+    }
+}
+
+
+/*
+ *      Forces on p3 and p4 from the stress of segment p1->p2 integrated
+ *      with the abscissae quad_points and the weighted shape functions
+ *      N1w, N2w.
+ */
+static void SBN1HalfForce(real8 p1x, real8 p1y, real8 p1z,
+                          real8 p2x, real8 p2y, real8 p2z,
+                          real8 p3x, real8 p3y, real8 p3z,
+                          real8 p4x, real8 p4y, real8 p4z,
+                          real8 bpx, real8 bpy, real8 bpz,
+                          real8 bx, real8 by, real8 bz,
+                          SBN1Consts_t *k,
+                          int Nint, real8 *quad_points,
+                          real8 *N1w, real8 *N2w,
+                          real8 *fp3x, real8 *fp3y, real8 *fp3z,
+                          real8 *fp4x, real8 *fp4y, real8 *fp4z)
+{
+    real8 mid[3], half[3], f3[3] = {0.0, 0.0, 0.0}, f4[3] = {0.0, 0.0, 0.0};
+    SBN1Source_t src;
+
+    SBN1SetSource(p1x, p1y, p1z, p2x, p2y, p2z, bpx, bpy, bpz, k, &src);
+
+    half[0] = 0.5*(p4x-p3x); half[1] = 0.5*(p4y-p3y); half[2] = 0.5*(p4z-p3z);
+    mid[0]  = 0.5*(p4x+p3x); mid[1]  = 0.5*(p4y+p3y); mid[2]  = 0.5*(p4z+p3z);
+
+    SBN1SegForce(&src, k, Nint, quad_points, N1w, N2w, mid, half,
+                 bx, by, bz, f3, f4);
+
+    *fp3x = f3[0]; *fp3y = f3[1]; *fp3z = f3[2];
+    *fp4x = f4[0]; *fp4y = f4[1]; *fp4z = f4[2];
+}
+
+
+/*
+ *      Both halves of a pair in one pass: the source data of each
+ *      segment and the quadrature geometry of each segment are set up
+ *      once and used as both source and target.
+ */
+static void SBN1BothHalves(real8 p1x, real8 p1y, real8 p1z,
+                           real8 p2x, real8 p2y, real8 p2z,
+                           real8 p3x, real8 p3y, real8 p3z,
+                           real8 p4x, real8 p4y, real8 p4z,
+                           real8 bpx, real8 bpy, real8 bpz,
+                           real8 bx, real8 by, real8 bz,
+                           SBN1Consts_t *k,
+                           int Nint, real8 *quad_points,
+                           real8 *N1w, real8 *N2w,
+                           real8 *fp1x, real8 *fp1y, real8 *fp1z,
+                           real8 *fp2x, real8 *fp2y, real8 *fp2z,
+                           real8 *fp3x, real8 *fp3y, real8 *fp3z,
+                           real8 *fp4x, real8 *fp4y, real8 *fp4z)
+{
+    real8 mid12[3], half12[3], mid34[3], half34[3];
+    real8 f1[3] = {0.0, 0.0, 0.0}, f2[3] = {0.0, 0.0, 0.0};
+    real8 f3[3] = {0.0, 0.0, 0.0}, f4[3] = {0.0, 0.0, 0.0};
+    SBN1Source_t src12, src34;
+
+    SBN1SetSource(p1x, p1y, p1z, p2x, p2y, p2z, bpx, bpy, bpz, k, &src12);
+    SBN1SetSource(p3x, p3y, p3z, p4x, p4y, p4z, bx, by, bz, k, &src34);
+
+    half12[0] = 0.5*(p2x-p1x); half12[1] = 0.5*(p2y-p1y); half12[2] = 0.5*(p2z-p1z);
+    mid12[0]  = 0.5*(p2x+p1x); mid12[1]  = 0.5*(p2y+p1y); mid12[2]  = 0.5*(p2z+p1z);
+    half34[0] = 0.5*(p4x-p3x); half34[1] = 0.5*(p4y-p3y); half34[2] = 0.5*(p4z-p3z);
+    mid34[0]  = 0.5*(p4x+p3x); mid34[1]  = 0.5*(p4y+p3y); mid34[2]  = 0.5*(p4z+p3z);
+
+    SBN1SegForce(&src12, k, Nint, quad_points, N1w, N2w, mid34, half34,
+                 bx, by, bz, f3, f4);
+    SBN1SegForce(&src34, k, Nint, quad_points, N1w, N2w, mid12, half12,
+                 bpx, bpy, bpz, f1, f2);
+
+    *fp1x = f1[0]; *fp1y = f1[1]; *fp1z = f1[2];
+    *fp2x = f2[0]; *fp2y = f2[1]; *fp2z = f2[2];
+    *fp3x = f3[0]; *fp3y = f3[1]; *fp3z = f3[2];
+    *fp4x = f4[0]; *fp4y = f4[1]; *fp4z = f4[2];
+}
+
 void SegSegForceHalf_SBN1(real8 p1x, real8 p1y, real8 p1z,
                             real8 p2x, real8 p2y, real8 p2z,
                             real8 p3x, real8 p3y, real8 p3z,
@@ -32,56 +553,25 @@ void SegSegForceHalf_SBN1(real8 p1x, real8 p1y, real8 p1z,
                             real8 *fp4x, real8 *fp4y, real8 *fp4z)
 {
     int i; 
-    real8 N1_quad_points[MAX_QUAD_POINTS], N2_quad_points[MAX_QUAD_POINTS];
-    real8 p34_half_x, p34_half_y, p34_half_z, p34_mid_x, p34_mid_y, p34_mid_z;
-    real8 px, py, pz, sigma[3][3], sigb[3], sigma_vec[6];
+    real8 N1w[MAX_QUAD_POINTS], N2w[MAX_QUAD_POINTS];
+    SBN1Consts_t k;
 
     if (Nint > MAX_QUAD_POINTS) {
-        fprintf(stderr, "Nint > %d\n", MAX_QUAD_POINTS);
-        exit(1);
+        ErrorRaise("SegSegForceHalf_SBN1: Nint > %d, use SegSegForce_SBN1_Ctx",
+                   MAX_QUAD_POINTS);
     }
-    p34_half_x = 0.5*(p4x-p3x); p34_half_y = 0.5*(p4y-p3y); p34_half_z = 0.5*(p4z-p3z);
-    p34_mid_x  = 0.5*(p4x+p3x); p34_mid_y  = 0.5*(p4y+p3y); p34_mid_z  = 0.5*(p4z+p3z);
 
     for(i = 0; i < Nint; i++)
     {
-        N1_quad_points[i] = Shape_Func_N1(quad_points[i]);
-        N2_quad_points[i] = Shape_Func_N2(quad_points[i]);
+        N1w[i] = Shape_Func_N1(quad_points[i]) * weights[i];
+        N2w[i] = Shape_Func_N2(quad_points[i]) * weights[i];
     }
-    *fp3x = 0.0; *fp3y = 0.0; *fp3z = 0.0;
-    for(i = 0; i < Nint; i++)
-    {
-        px = p34_mid_x + p34_half_x * quad_points[i];
-        py = p34_mid_y + p34_half_y * quad_points[i];
-        pz = p34_mid_z + p34_half_z * quad_points[i];
-
-#if 0
-        /* coordinate dependent form */
-        SegmentStress(MU, NU, bpx, bpy, bpz, p1x, p1y, p1z, p2x, p2y, p2z, px, py, pz, a, sigma);
-#else
-        /* coordinate independent form */
-        StressDueToSeg(px, py, pz, p1x, p1y, p1z, p2x, p2y, p2z, bpx, bpy, bpz, a, MU, NU, sigma_vec);
-        sigma[0][0] = sigma_vec[0]; sigma[0][1] = sigma_vec[3]; sigma[0][2] = sigma_vec[5];
-        sigma[1][0] = sigma_vec[3]; sigma[1][1] = sigma_vec[1]; sigma[1][2] = sigma_vec[4];
-        sigma[2][0] = sigma_vec[5]; sigma[2][1] = sigma_vec[4]; sigma[2][2] = sigma_vec[2];
-
-        //sigb[0] = sigma_vec[0] * bx + sigma_vec[3] * by + sigma_vec[5] * bz;
-        //sigb[1] = sigma_vec[3] * bx + sigma_vec[1] * by + sigma_vec[4] * bz;
-        //sigb[2] = sigma_vec[5] * bx + sigma_vec[4] * by + sigma_vec[2] * bz;
-#endif
 
-        sigb[0] = sigma[0][0] * bx + sigma[0][1] * by + sigma[0][2] * bz;
-        sigb[1] = sigma[1][0] * bx + sigma[1][1] * by + sigma[1][2] * bz;
-        sigb[2] = sigma[2][0] * bx + sigma[2][1] * by + sigma[2][2] * bz;
-
-        *fp3x += (sigb[1]*p34_half_z - sigb[2]*p34_half_y) * N1_quad_points[i] * weights[i];
-        *fp3y += (sigb[2]*p34_half_x - sigb[0]*p34_half_z) * N1_quad_points[i] * weights[i];
-        *fp3z += (sigb[0]*p34_half_y - sigb[1]*p34_half_x) * N1_quad_points[i] * weights[i];
-
-        *fp4x += (sigb[1]*p34_half_z - sigb[2]*p34_half_y) * N2_quad_points[i] * weights[i];
-        *fp4y += (sigb[2]*p34_half_x - sigb[0]*p34_half_z) * N2_quad_points[i] * weights[i];
-        *fp4z += (sigb[0]*p34_half_y - sigb[1]*p34_half_x) * N2_quad_points[i] * weights[i];
-    }
+    SBN1SetConsts(a, MU, NU, &k);
+    SBN1HalfForce(p1x, p1y, p1z, p2x, p2y, p2z, p3x, p3y, p3z, p4x, p4y, p4z,
+                  bpx, bpy, bpz, bx, by, bz, &k,
+                  Nint, quad_points, N1w, N2w,
+                  fp3x, fp3y, fp3z, fp4x, fp4y, fp4z);
 }
 
 /*-------------------------------------------------------------------------
@@ -124,6 +614,36 @@ void SegSegForce_SBN1(real8 p1x, real8 p1y, real8 p1z,
                           real8 *fp3x, real8 *fp3y, real8 *fp3z,
                           real8 *fp4x, real8 *fp4y, real8 *fp4z)
 {
+            int   i;
+            real8 N1w[MAX_QUAD_POINTS], N2w[MAX_QUAD_POINTS];
+            SBN1Consts_t k;
+
+/*
+ *          Both segments local: evaluate the two halves in one pass.
+ */
+            if (seg12Local && seg34Local) {
+
+                if (Nint > MAX_QUAD_POINTS) {
+                    ErrorRaise("SegSegForce_SBN1: Nint > %d, use "
+                               "SegSegForce_SBN1_Ctx", MAX_QUAD_POINTS);
+                }
+
+                for(i = 0; i < Nint; i++)
+                {
+                    N1w[i] = Shape_Func_N1(quad_points[i]) * weights[i];
+                    N2w[i] = Shape_Func_N2(quad_points[i]) * weights[i];
+                }
+
+                SBN1SetConsts(a, MU, NU, &k);
+                SBN1BothHalves(p1x, p1y, p1z, p2x, p2y, p2z,
+                               p3x, p3y, p3z, p4x, p4y, p4z,
+                               bpx, bpy, bpz, bx, by, bz, &k,
+                               Nint, quad_points, N1w, N2w,
+                               fp1x, fp1y, fp1z, fp2x, fp2y, fp2z,
+                               fp3x, fp3y, fp3z, fp4x, fp4y, fp4z);
+                return;
+            }
+
 /*
  *          Only calculate the forces for segment p3->p4 if at least one
  *          of the segment's nodes is local to the current domain.
@@ -150,4 +670,65 @@ void SegSegForce_SBN1(real8 p1x, real8 p1y, real8 p1z,
             } /* if segment p1->p2 is "local" */
 
        return;
-}
\ No newline at end of file
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:       SegSegForce_SBN1_Ctx
+ *      Description:    Same as SegSegForce_SBN1() with the quadrature
+ *                      rule taken from a context created by
+ *                      SBN1ContextCreate().  There is no limit on the
+ *                      number of quadrature points.
+ *
+ *-----------------------------------------------------------------------*/
+void SegSegForce_SBN1_Ctx(real8 p1x, real8 p1y, real8 p1z,
+                          real8 p2x, real8 p2y, real8 p2z,
+                          real8 p3x, real8 p3y, real8 p3z,
+                          real8 p4x, real8 p4y, real8 p4z,
+                          real8 bpx, real8 bpy, real8 bpz,
+                          real8 bx, real8 by, real8 bz,
+                          real8 a, real8 MU, real8 NU,
+                          SBN1Context_t *ctx,
+                          int seg12Local, int seg34Local,
+                          real8 *fp1x, real8 *fp1y, real8 *fp1z,
+                          real8 *fp2x, real8 *fp2y, real8 *fp2z,
+                          real8 *fp3x, real8 *fp3y, real8 *fp3z,
+                          real8 *fp4x, real8 *fp4y, real8 *fp4z)
+{
+            SBN1Consts_t local, *k;
+
+            k = SBN1ContextConsts(ctx, a, MU, NU, &local);
+
+            if (seg12Local && seg34Local) {
+                SBN1BothHalves(p1x, p1y, p1z, p2x, p2y, p2z,
+                               p3x, p3y, p3z, p4x, p4y, p4z,
+                               bpx, bpy, bpz, bx, by, bz, k,
+                               ctx->Nint, ctx->quad_points, ctx->N1w, ctx->N2w,
+                               fp1x, fp1y, fp1z, fp2x, fp2y, fp2z,
+                               fp3x, fp3y, fp3z, fp4x, fp4y, fp4z);
+                return;
+            }
+
+            if (seg34Local) {
+                SBN1HalfForce(p1x, p1y, p1z, p2x, p2y, p2z,
+                              p3x, p3y, p3z, p4x, p4y, p4z,
+                              bpx, bpy, bpz, bx, by, bz, k,
+                              ctx->Nint, ctx->quad_points, ctx->N1w, ctx->N2w,
+                              fp3x, fp3y, fp3z, fp4x, fp4y, fp4z);
+            }
+
+            if (seg12Local) {
+                SBN1HalfForce(p3x, p3y, p3z, p4x, p4y, p4z,
+                              p1x, p1y, p1z, p2x, p2y, p2z,
+                              bx, by, bz, bpx, bpy, bpz, k,
+                              ctx->Nint, ctx->quad_points, ctx->N1w, ctx->N2w,
+                              fp1x, fp1y, fp1z, fp2x, fp2y, fp2z);
+            }
+
+       return;
+}
+
+#ifdef _OPENMP
+#pragma omp end declare target
+#endif
@@ -1,6 +1,48 @@
+#ifndef _SegSegForce_SBN1_h
+#define _SegSegForce_SBN1_h
+
 #include <math.h>
 #define real8 double
 
+/*
+ *      Quadrature rules with up to SBN1_MAX_FIXED_NINT points are
+ *      evaluated by kernels instantiated for their number of points,
+ *      so that the loops over the points are unrolled and vectorized.
+ *      Larger rules use the generic kernel.
+ */
+#define SBN1_MAX_FIXED_NINT 7
+
+/*
+ *      Material constants of the SBN1 stress evaluations
+ */
+typedef struct {
+        real8 a2, m4p, m8p, m4pn, mn4pn, a2m8p;
+} SBN1Consts_t;
+
+/*
+ *      Quadrature data shared by all SBN1 force evaluations with the
+ *      same rule: the abscissae and weights on [-1,1] and the products
+ *      of the weights with the linear shape functions at the abscissae.
+ *      Create it once per rule with SBN1ContextCreate() and pass it to
+ *      the *_Ctx functions.  SBN1ContextSetMaterial() derives the
+ *      material constants once for all calls with the same a, MU, NU
+ *      (other values are still accepted and derived per call).
+ */
+typedef struct _sbn1context {
+        int   Nint;          /* number of quadrature points        */
+        real8 *quad_points;  /* [Nint] abscissae                   */
+        real8 *weights;      /* [Nint] weights                     */
+        real8 *N1w;          /* [Nint] Shape_Func_N1(x_i) * w_i     */
+        real8 *N2w;          /* [Nint] Shape_Func_N2(x_i) * w_i     */
+        int   haveMaterial;  /* consts below are set               */
+        real8 a, MU, NU;
+        SBN1Consts_t consts;
+} SBN1Context_t;
+
+SBN1Context_t *SBN1ContextCreate(int Nint, real8 *quad_points, real8 *weights);
+void SBN1ContextSetMaterial(SBN1Context_t *ctx, real8 a, real8 MU, real8 NU);
+void SBN1ContextFree(SBN1Context_t *ctx);
+
 void SegSegForce_SBN1(real8 p1x, real8 p1y, real8 p1z,
                  real8 p2x, real8 p2y, real8 p2z,
                  real8 p3x, real8 p3y, real8 p3z,
@@ -13,4 +55,20 @@ void SegSegForce_SBN1(real8 p1x, real8 p1y, real8 p1z,
                  real8 *fp1x, real8 *fp1y, real8 *fp1z,
                  real8 *fp2x, real8 *fp2y, real8 *fp2z,
                  real8 *fp3x, real8 *fp3y, real8 *fp3z,
-                 real8 *fp4x, real8 *fp4y, real8 *fp4z);
\ No newline at end of file
+                 real8 *fp4x, real8 *fp4y, real8 *fp4z);
+
+void SegSegForce_SBN1_Ctx(real8 p1x, real8 p1y, real8 p1z,
+                 real8 p2x, real8 p2y, real8 p2z,
+                 real8 p3x, real8 p3y, real8 p3z,
+                 real8 p4x, real8 p4y, real8 p4z,
+                 real8 bpx, real8 bpy, real8 bpz,
+                 real8 bx, real8 by, real8 bz,
+                 real8 a, real8 MU, real8 NU,
+                 SBN1Context_t *ctx,
+                 int seg12Local, int seg34Local,
+                 real8 *fp1x, real8 *fp1y, real8 *fp1z,
+                 real8 *fp2x, real8 *fp2y, real8 *fp2z,
+                 real8 *fp3x, real8 *fp3y, real8 *fp3z,
+                 real8 *fp4x, real8 *fp4y, real8 *fp4z);
+
+#endif  /* _SegSegForce_SBN1_h */
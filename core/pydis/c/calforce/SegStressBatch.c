@@ -0,0 +1,111 @@
+#include "SegStressBatch.h"
+#include "SegmentStress.h"
+#include "StressDueToSeg.h"
+#include <string.h>
+
+/**************************************************************************
+ *
+ *      Function:    SegStressAtPoints
+ *      Description: Add the stress of a set of straight segments to the
+ *                   stress at a set of field points.  Tiles of
+ *                   SEGSTRESS_POINT_TILE points are distributed over
+ *                   OpenMP threads; each tile sums over the segments in
+ *                   tiles of SEGSTRESS_SEG_TILE so that the segment data
+ *                   stays in cache while it is used for all points of
+ *                   the tile.  Every point is owned by one thread, so
+ *                   no reduction is needed.  Zero length segments are
+ *                   skipped.
+ *
+ *      Arguments:
+ *         numPoints    number of field points
+ *         points       [numPoints][3] field point coordinates
+ *         numSegs      number of segments
+ *         R1, R2       [numSegs][3] start and end points of the segments
+ *         burgers      [numSegs][3] burgers vector of each segment
+ *                      (from R1 to R2)
+ *         a            core value
+ *         MU           shear modulus
+ *         NU           poisson ratio
+ *         coordDep     0 to use StressDueToSeg() (coordinate independent
+ *                      form), 1 to use SegmentStress() (coordinate
+ *                      dependent form)
+ *         stress       [numPoints][6] stress at each point, in the order
+ *                      xx, yy, zz, xy, yz, xz.  The segment stresses are
+ *                      added to the values on entry.
+ *
+ *************************************************************************/
+void SegStressAtPoints(int numPoints, real8 *points,
+                       int numSegs, real8 *R1, real8 *R2, real8 *burgers,
+                       real8 a, real8 MU, real8 NU, int coordDep,
+                       real8 *stress)
+{
+    int numTiles, tile;
+
+    if (numPoints <= 0 || numSegs <= 0) return;
+
+    numTiles = (numPoints + SEGSTRESS_POINT_TILE - 1) / SEGSTRESS_POINT_TILE;
+
+#pragma omp parallel for schedule(dynamic, 1)
+    for (tile = 0; tile < numTiles; tile++) {
+        int   k, kBeg, kEnd, m, j, jBeg, jEnd;
+        real8 tileStress[SEGSTRESS_POINT_TILE][6];
+        real8 sigma_vec[6], sigma[3][3], dx, dy, dz;
+        real8 *x, *p1, *p2, *b, *s;
+
+        kBeg = tile * SEGSTRESS_POINT_TILE;
+        kEnd = kBeg + SEGSTRESS_POINT_TILE;
+        if (kEnd > numPoints) kEnd = numPoints;
+
+        memset(tileStress, 0, sizeof(tileStress));
+
+        for (jBeg = 0; jBeg < numSegs; jBeg += SEGSTRESS_SEG_TILE) {
+
+            jEnd = jBeg + SEGSTRESS_SEG_TILE;
+            if (jEnd > numSegs) jEnd = numSegs;
+
+            for (k = kBeg; k < kEnd; k++) {
+                x = &points[3*k];
+                s = tileStress[k-kBeg];
+
+                for (j = jBeg; j < jEnd; j++) {
+                    p1 = &R1[3*j];
+                    p2 = &R2[3*j];
+                    b  = &burgers[3*j];
+
+                    dx = p2[0] - p1[0];
+                    dy = p2[1] - p1[1];
+                    dz = p2[2] - p1[2];
+                    if (dx*dx + dy*dy + dz*dz == 0.0) continue;
+
+                    if (coordDep) {
+                        SegmentStress(MU, NU, b[0], b[1], b[2],
+                                      p1[0], p1[1], p1[2],
+                                      p2[0], p2[1], p2[2],
+                                      x[0], x[1], x[2], a, sigma);
+                        s[0] += sigma[0][0];
+                        s[1] += sigma[1][1];
+                        s[2] += sigma[2][2];
+                        s[3] += sigma[0][1];
+                        s[4] += sigma[1][2];
+                        s[5] += sigma[0][2];
+                    } else {
+                        StressDueToSeg(x[0], x[1], x[2],
+                                       p1[0], p1[1], p1[2],
+                                       p2[0], p2[1], p2[2],
+                                       b[0], b[1], b[2],
+                                       a, MU, NU, sigma_vec);
+                        for (m = 0; m < 6; m++) s[m] += sigma_vec[m];
+                    }
+                }
+            }
+        }
+
+        for (k = kBeg; k < kEnd; k++) {
+            for (m = 0; m < 6; m++) {
+                stress[6*k+m] += tileStress[k-kBeg][m];
+            }
+        }
+    }
+
+    return;
+}
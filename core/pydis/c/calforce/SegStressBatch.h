@@ -0,0 +1,15 @@
+#include <math.h>
+#define real8 double
+
+/*
+ *      Tile sizes of the field point / segment loops of
+ *      SegStressAtPoints().  A tile of segments is reused for all
+ *      points of a point tile before moving on to the next one.
+ */
+#define SEGSTRESS_POINT_TILE 64
+#define SEGSTRESS_SEG_TILE   256
+
+void SegStressAtPoints(int numPoints, real8 *points,
+                       int numSegs, real8 *R1, real8 *R2, real8 *burgers,
+                       real8 a, real8 MU, real8 NU, int coordDep,
+                       real8 *stress);
@@ -1,4 +1,11 @@
 #include "StressDueToSeg.h"
+/*
+ *      Device callable as well, see SegSegForceDevice.c.
+ */
+#ifdef _OPENMP
+#pragma omp declare target
+#endif
+
 /**************************************************************************
  *
  *      Function:    StressDueToSeg
@@ -231,3 +238,7 @@ void StressDueToSeg(real8 px, real8 py, real8 pz,
 
         return;
 }
+
+#ifdef _OPENMP
+#pragma omp end declare target
+#endif
@@ -0,0 +1,119 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "CollisionSelect.h"
+#include "../include/Profile.h"
+#include "../include/Error.h"
+
+typedef struct {
+        int   hit, i, j;
+        real8 tau, dist2;
+} CollisionKey_t;
+
+
+/*---------------------------------------------------------------------------
+ *
+ *      Function:       CompareCollisionKeys
+ *      Description:    Commit priority of two collisions: earliest
+ *                      collision time first, then closest distance, then
+ *                      segment indices, so the order does not depend on
+ *                      the order in which the collisions were detected.
+ *
+ *-------------------------------------------------------------------------*/
+static int CompareCollisionKeys(const void *a, const void *b)
+{
+        const CollisionKey_t *ka = (const CollisionKey_t *)a;
+        const CollisionKey_t *kb = (const CollisionKey_t *)b;
+
+        if (ka->tau   != kb->tau)   return((ka->tau   < kb->tau)   ? -1 : 1);
+        if (ka->dist2 != kb->dist2) return((ka->dist2 < kb->dist2) ? -1 : 1);
+        if (ka->i     != kb->i)     return((ka->i     < kb->i)     ? -1 : 1);
+        if (ka->j     != kb->j)     return((ka->j     < kb->j)     ? -1 : 1);
+        return(0);
+}
+
+
+/*---------------------------------------------------------------------------
+ *
+ *      Function:       SelectCollisions
+ *      Description:    Second phase of the collision handling: choose a
+ *                      set of detected collisions that can be committed
+ *                      independently of each other.  Two collisions
+ *                      conflict if their segments share a node, since
+ *                      splitting a segment or merging a node changes the
+ *                      segments attached to it.  The collisions are
+ *                      visited in priority order (CompareCollisionKeys)
+ *                      and greedily accepted unless they conflict with an
+ *                      already accepted one, which yields a maximal
+ *                      independent set of the conflict graph that is the
+ *                      same for every run.
+ *
+ *      Arguments:
+ *          numHits     Number of detected collisions
+ *          hitPairs    [numHits][2] segment indices of each collision
+ *          tau         [numHits] normalized collision times.  May be NULL
+ *                      if all collisions are at the same time.
+ *          dist2       [numHits] squared distances of the collisions
+ *          numNodes    Number of nodes
+ *          nodeIDs     [numSegs][2] end node indices of the segments
+ *          commitList  [numHits] returned indices of the accepted
+ *                      collisions, in priority order
+ *
+ *      Returns:  the number of accepted collisions
+ *
+ *-------------------------------------------------------------------------*/
+int SelectCollisions(int numHits, int *hitPairs, real8 *tau, real8 *dist2,
+                     int numNodes, int *nodeIDs, int *commitList)
+{
+        int            n, k, numCommit, nodes[4];
+        char           *used;
+        CollisionKey_t *keys;
+
+        if (numHits <= 0) return(0);
+
+        keys = (CollisionKey_t *)malloc(numHits * sizeof(CollisionKey_t));
+        used = (char *)calloc(numNodes, sizeof(char));
+
+        if (keys == NULL || used == NULL) {
+            free(keys);
+            free(used);
+            ErrorRaise("SelectCollisions: out of memory");
+        }
+
+        for (n = 0; n < numHits; n++) {
+            keys[n].hit   = n;
+            keys[n].i     = hitPairs[2*n];
+            keys[n].j     = hitPairs[2*n+1];
+            keys[n].tau   = (tau != NULL) ? tau[n] : 0.0;
+            keys[n].dist2 = dist2[n];
+        }
+
+        qsort(keys, numHits, sizeof(CollisionKey_t), CompareCollisionKeys);
+
+        numCommit = 0;
+
+        for (n = 0; n < numHits; n++) {
+
+            nodes[0] = nodeIDs[2*keys[n].i];
+            nodes[1] = nodeIDs[2*keys[n].i+1];
+            nodes[2] = nodeIDs[2*keys[n].j];
+            nodes[3] = nodeIDs[2*keys[n].j+1];
+
+            for (k = 0; k < 4; k++) {
+                if (used[nodes[k]]) break;
+            }
+            if (k < 4) continue;
+
+            for (k = 0; k < 4; k++) {
+                used[nodes[k]] = 1;
+            }
+
+            commitList[numCommit++] = keys[n].hit;
+        }
+
+        free(keys);
+        free(used);
+
+        ProfileCount(PROFILE_COLLISIONS, numCommit);
+
+        return(numCommit);
+}
@@ -0,0 +1,5 @@
+#include <math.h>
+#define real8 double
+
+int  SelectCollisions(int numHits, int *hitPairs, real8 *tau, real8 *dist2,
+                      int numNodes, int *nodeIDs, int *commitList);
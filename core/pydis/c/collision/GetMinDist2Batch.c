@@ -0,0 +1,84 @@
+#include <stdlib.h>
+#include "GetMinDist2Batch.h"
+#include "../include/Profile.h"
+
+/*---------------------------------------------------------------------------
+ *
+ *      Function:       GetMinDist2Batch
+ *      Description:    Evaluate GetMinDist2() for a list of candidate
+ *                      segment pairs p1->p2 and p3->p4 in a single call
+ *                      and collect the pairs that are closer than the
+ *                      collision distance.
+ *
+ *      Arguments:
+ *          numPairs   Number of candidate segment pairs
+ *          p1..p4     Arrays [numPairs][3] of the endpoint coordinates of
+ *                     segment 1 (p1, p2) and segment 2 (p3, p4) of each
+ *                     pair.  Periodic images must already be resolved.
+ *          v1..v4     Arrays [numPairs][3] of the corresponding node
+ *                     velocities.  Any of them may be NULL, in which
+ *                     case the velocities are taken to be zero.
+ *          mindist2   Square of the collision distance
+ *          dist2      Array [numPairs] in which to return the square of
+ *                     the minimum distance of each pair
+ *          ddist2dt   Array [numPairs] in which to return the time rate
+ *                     of change of dist2.  May be NULL.
+ *          L1, L2     Arrays [numPairs] in which to return the normalized
+ *                     positions of the closest points on seg 1 and seg 2
+ *          hitList    Array [numPairs] in which to return, in increasing
+ *                     order, the indices of the pairs with
+ *                     dist2 < mindist2.  May be NULL.
+ *
+ *      Returns:  the number of pairs with dist2 < mindist2
+ *
+ *-------------------------------------------------------------------------*/
+int GetMinDist2Batch(int numPairs,
+                     real8 *p1, real8 *v1, real8 *p2, real8 *v2,
+                     real8 *p3, real8 *v3, real8 *p4, real8 *v4,
+                     real8 mindist2,
+                     real8 *dist2, real8 *ddist2dt, real8 *L1, real8 *L2,
+                     int *hitList)
+{
+        int   n, numHits;
+        real8 zero[3] = {0.0, 0.0, 0.0};
+
+        ProfileStart(PROFILE_COLLISION);
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+        for (n = 0; n < numPairs; n++) {
+            real8 *x1 = &p1[3*n], *x2 = &p2[3*n];
+            real8 *x3 = &p3[3*n], *x4 = &p4[3*n];
+            real8 *u1 = (v1 != NULL) ? &v1[3*n] : zero;
+            real8 *u2 = (v2 != NULL) ? &v2[3*n] : zero;
+            real8 *u3 = (v3 != NULL) ? &v3[3*n] : zero;
+            real8 *u4 = (v4 != NULL) ? &v4[3*n] : zero;
+            real8 ddt;
+
+            GetMinDist2(x1[0], x1[1], x1[2], u1[0], u1[1], u1[2],
+                        x2[0], x2[1], x2[2], u2[0], u2[1], u2[2],
+                        x3[0], x3[1], x3[2], u3[0], u3[1], u3[2],
+                        x4[0], x4[1], x4[2], u4[0], u4[1], u4[2],
+                        &dist2[n], &ddt, &L1[n], &L2[n]);
+
+            if (ddist2dt != NULL) {
+                ddist2dt[n] = ddt;
+            }
+        }
+
+        numHits = 0;
+
+        for (n = 0; n < numPairs; n++) {
+            if (dist2[n] < mindist2) {
+                if (hitList != NULL) {
+                    hitList[numHits] = n;
+                }
+                numHits++;
+            }
+        }
+
+        ProfileStop(PROFILE_COLLISION);
+
+        return(numHits);
+}
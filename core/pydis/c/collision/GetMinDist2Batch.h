@@ -0,0 +1,19 @@
+#include <math.h>
+#define real8 double
+
+void GetMinDist2(real8 p1x, real8 p1y, real8 p1z,
+                real8 v1x, real8 v1y, real8 v1z,
+                real8 p2x, real8 p2y, real8 p2z,
+                real8 v2x, real8 v2y, real8 v2z,
+                real8 p3x, real8 p3y, real8 p3z,
+                real8 v3x, real8 v3y, real8 v3z,
+                real8 p4x, real8 p4y, real8 p4z,
+                real8 v4x, real8 v4y, real8 v4z,
+                real8 *dist2, real8 *ddist2dt, real8 *L1, real8 *L2);
+
+int  GetMinDist2Batch(int numPairs,
+                      real8 *p1, real8 *v1, real8 *p2, real8 *v2,
+                      real8 *p3, real8 *v3, real8 *p4, real8 *v4,
+                      real8 mindist2,
+                      real8 *dist2, real8 *ddist2dt, real8 *L1, real8 *L2,
+                      int *hitList);
@@ -0,0 +1,452 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "RetroCollision.h"
+#include "GetMinDist2Batch.h"
+#include "../calforce/SegSegForceDriver.h"
+#include "../include/Profile.h"
+#include "../include/Error.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/*
+ *      Number of bisection steps used to locate the closest approach
+ *      and the first crossing of the collision distance within one
+ *      sampled sub-interval of the timestep.
+ */
+#define RETRO_BISECT_ITERATIONS 32
+
+typedef struct {
+        int   i, j;
+        real8 tau, dist2, L1, L2;
+} RetroHit_t;
+
+
+/*---------------------------------------------------------------------------
+ *
+ *      Function:       SweptDist2AtTime
+ *      Description:    Minimum distance between two segments whose end
+ *                      nodes move linearly from xold to x, at the
+ *                      normalized time t in [0,1] of the timestep.
+ *
+ *-------------------------------------------------------------------------*/
+static void SweptDist2AtTime(real8 *xold[4], real8 *x[4], real8 t,
+                             real8 *dist2, real8 *ddist2dt,
+                             real8 *L1, real8 *L2)
+{
+        int   k, m;
+        real8 p[4][3], v[4][3];
+
+        for (k = 0; k < 4; k++) {
+            for (m = 0; m < 3; m++) {
+                v[k][m] = x[k][m] - xold[k][m];
+                p[k][m] = xold[k][m] + t * v[k][m];
+            }
+        }
+
+        GetMinDist2(p[0][0], p[0][1], p[0][2], v[0][0], v[0][1], v[0][2],
+                    p[1][0], p[1][1], p[1][2], v[1][0], v[1][1], v[1][2],
+                    p[2][0], p[2][1], p[2][2], v[2][0], v[2][1], v[2][2],
+                    p[3][0], p[3][1], p[3][2], v[3][0], v[3][1], v[3][2],
+                    dist2, ddist2dt, L1, L2);
+}
+
+
+/*---------------------------------------------------------------------------
+ *
+ *      Function:       SweptMinDist2
+ *      Description:    Retroactive collision test of the segments
+ *                      x1->x2 and x3->x4 whose nodes moved linearly from
+ *                      the old positions during the timestep.  The
+ *                      timestep is sampled at RETRO_COLLISION_SUBSTEPS
+ *                      sub-intervals; a sub-interval in which the
+ *                      distance drops below the collision distance, or
+ *                      which brackets a local minimum of the distance
+ *                      (sign change of ddist2dt), is refined by
+ *                      bisection.  The earliest time at which the
+ *                      segments come closer than the collision distance
+ *                      is returned.
+ *
+ *      Arguments:
+ *          x1old..x4old  Node positions at the beginning of the timestep
+ *          x1..x4        Node positions at the end of the timestep
+ *          mindist2      Square of the collision distance
+ *          tau           Returned normalized time in [0,1] of the
+ *                        collision, or of the closest sampled approach
+ *                        if there is no collision
+ *          dist2         Returned square of the distance at tau
+ *          L1, L2        Returned normalized positions of the closest
+ *                        points on seg 1 and seg 2 at tau
+ *
+ *      Returns:  1 if the segments collide during the timestep, 0 if not
+ *
+ *-------------------------------------------------------------------------*/
+int SweptMinDist2(real8 *x1old, real8 *x2old, real8 *x3old, real8 *x4old,
+                  real8 *x1, real8 *x2, real8 *x3, real8 *x4,
+                  real8 mindist2,
+                  real8 *tau, real8 *dist2, real8 *L1, real8 *L2)
+{
+        int   k, it;
+        real8 *xold[4], *x[4];
+        real8 t[RETRO_COLLISION_SUBSTEPS+1], d[RETRO_COLLISION_SUBSTEPS+1];
+        real8 dd[RETRO_COLLISION_SUBSTEPS+1];
+        real8 l1[RETRO_COLLISION_SUBSTEPS+1], l2[RETRO_COLLISION_SUBSTEPS+1];
+        real8 ta, tb, tm, dm, ddm, l1m, l2m;
+
+        xold[0] = x1old; xold[1] = x2old; xold[2] = x3old; xold[3] = x4old;
+        x[0] = x1; x[1] = x2; x[2] = x3; x[3] = x4;
+
+        for (k = 0; k <= RETRO_COLLISION_SUBSTEPS; k++) {
+            t[k] = (real8)k / RETRO_COLLISION_SUBSTEPS;
+            SweptDist2AtTime(xold, x, t[k], &d[k], &dd[k], &l1[k], &l2[k]);
+        }
+
+        if (d[0] < mindist2) {
+            *tau = 0.0; *dist2 = d[0]; *L1 = l1[0]; *L2 = l2[0];
+            return(1);
+        }
+
+        for (k = 1; k <= RETRO_COLLISION_SUBSTEPS; k++) {
+
+            ta = t[k-1];
+
+            if (d[k] < mindist2) {
+                tb = t[k];
+                *dist2 = d[k]; *L1 = l1[k]; *L2 = l2[k];
+            } else if (dd[k-1] < 0.0 && dd[k] > 0.0) {
+/*
+ *              The distance has a local minimum inside this
+ *              sub-interval, locate it.
+ */
+                real8 lo = t[k-1], hi = t[k];
+
+                for (it = 0; it < RETRO_BISECT_ITERATIONS; it++) {
+                    tm = 0.5 * (lo + hi);
+                    SweptDist2AtTime(xold, x, tm, &dm, &ddm, &l1m, &l2m);
+                    if (ddm < 0.0) lo = tm;
+                    else           hi = tm;
+                }
+
+                tm = 0.5 * (lo + hi);
+                SweptDist2AtTime(xold, x, tm, &dm, &ddm, &l1m, &l2m);
+
+                if (dm >= mindist2) continue;
+
+                tb = tm;
+                *dist2 = dm; *L1 = l1m; *L2 = l2m;
+            } else {
+                continue;
+            }
+
+/*
+ *          The distance is above the collision distance at ta and
+ *          below it at tb, find the first crossing.
+ */
+            for (it = 0; it < RETRO_BISECT_ITERATIONS; it++) {
+                tm = 0.5 * (ta + tb);
+                SweptDist2AtTime(xold, x, tm, &dm, &ddm, &l1m, &l2m);
+                if (dm < mindist2) {
+                    tb = tm;
+                    *dist2 = dm; *L1 = l1m; *L2 = l2m;
+                } else {
+                    ta = tm;
+                }
+            }
+
+            *tau = tb;
+            return(1);
+        }
+
+/*
+ *      No collision, return the closest sampled approach
+ */
+        it = 0;
+        for (k = 1; k <= RETRO_COLLISION_SUBSTEPS; k++) {
+            if (d[k] < d[it]) it = k;
+        }
+
+        *tau = t[it]; *dist2 = d[it]; *L1 = l1[it]; *L2 = l2[it];
+
+        return(0);
+}
+
+
+static int CompareRetroHits(const void *a, const void *b)
+{
+        const RetroHit_t *ha = (const RetroHit_t *)a;
+        const RetroHit_t *hb = (const RetroHit_t *)b;
+
+        if (ha->i != hb->i) return((ha->i < hb->i) ? -1 : 1);
+        if (ha->j != hb->j) return((ha->j < hb->j) ? -1 : 1);
+        return(0);
+}
+
+
+/*---------------------------------------------------------------------------
+ *
+ *      Function:       RetroCollisionPairs
+ *      Description:    Retroactive (swept volume) collision detection.
+ *                      Each segment sweeps the bounding box of its end
+ *                      nodes at the beginning and the end of the
+ *                      timestep, padded by half the collision distance.
+ *                      The boxes are binned by center into a uniform
+ *                      grid (BinSegmentsInCells) with cells at least as
+ *                      wide as the largest box diagonal, so overlapping
+ *                      boxes are always in the same or neighboring
+ *                      cells.  SweptMinDist2() is only evaluated for
+ *                      pairs of segments whose boxes overlap and that
+ *                      do not share a node.
+ *
+ *      Arguments:
+ *          numSegs       Number of segments
+ *          nodeIDs       [numSegs][2] indices of the end nodes of each
+ *                        segment, used to skip pairs sharing a node
+ *          skipSeg       [numSegs] non-zero for segments that must not
+ *                        collide.  May be NULL.
+ *          R1old, R2old  [numSegs][3] end node positions at the
+ *                        beginning of the timestep.  If both are NULL
+ *                        the nodes are taken not to move and only the
+ *                        current distances are tested (proximity
+ *                        criterion, tau = 1).
+ *          R1, R2        [numSegs][3] end node positions at the end of
+ *                        the timestep
+ *          h, hinv       cell matrix and inverse
+ *          isPeriodic    periodicity flags.  May be NULL.
+ *          mindist2      Square of the collision distance
+ *          maxHits       Size of the hit arrays
+ *          hitPairs      [maxHits][2] returned segment indices (i < j) of
+ *                        the colliding pairs, sorted by i then j
+ *          tau, dist2,   [maxHits] returned results of SweptMinDist2()
+ *          L1, L2        for each colliding pair.  The positions on the
+ *                        segments refer to the images of R1old, R2old,
+ *                        R2 closest to R1 of the same segment.
+ *          numCandidates Returned number of overlapping box pairs
+ *                        tested.  May be NULL.
+ *
+ *      Returns:  the number of colliding pairs.  Only the first maxHits
+ *                are returned if this is larger than maxHits.
+ *
+ *-------------------------------------------------------------------------*/
+int RetroCollisionPairs(int numSegs, int *nodeIDs, int *skipSeg,
+                        real8 *R1old, real8 *R2old, real8 *R1, real8 *R2,
+                        real8 *h, real8 *hinv, int *isPeriodic,
+                        real8 mindist2, int maxHits, int *hitPairs,
+                        real8 *tau, real8 *dist2, real8 *L1, real8 *L2,
+                        int *numCandidates)
+{
+        int        i, k, m, numHits, maxAlloc, numTested, moving;
+        int        outOfMemory = 0;
+        int        nCells[3], *cellStart, *cellSegs, *segCell;
+        real8      pad, diag, cellMin;
+        real8      *X, *center, *halfExt;
+        RetroHit_t *hits;
+
+        if (numCandidates != NULL) *numCandidates = 0;
+        if (numSegs <= 0) return(0);
+
+        moving = (R1old != NULL || R2old != NULL);
+        if (R1old == NULL) R1old = R1;
+        if (R2old == NULL) R2old = R2;
+
+        X       = (real8 *)malloc(12 * numSegs * sizeof(real8));
+        center  = (real8 *)malloc(3 * numSegs * sizeof(real8));
+        halfExt = (real8 *)malloc(3 * numSegs * sizeof(real8));
+
+        if (X == NULL || center == NULL || halfExt == NULL) {
+            free(X);
+            free(center);
+            free(halfExt);
+            ErrorRaise("RetroCollisionPairs: out of memory");
+        }
+
+        ProfileStart(PROFILE_COLLISION);
+
+        pad = 0.5 * sqrt(mindist2);
+        cellMin = 0.0;
+
+/*
+ *      Node positions of each segment (old 1, old 2, new 1, new 2)
+ *      in a consistent periodic image, and their swept boxes.
+ */
+        for (i = 0; i < numSegs; i++) {
+            real8 *x = &X[12*i], bmin[3], bmax[3];
+
+            memcpy(&x[6], &R1[3*i], 3 * sizeof(real8));
+            PBCClosestImage(h, hinv, isPeriodic, &x[6], &R2[3*i], &x[9]);
+            if (moving) {
+                PBCClosestImage(h, hinv, isPeriodic, &x[6], &R1old[3*i], &x[0]);
+                PBCClosestImage(h, hinv, isPeriodic, &x[9], &R2old[3*i], &x[3]);
+            } else {
+                memcpy(&x[0], &x[6], 6 * sizeof(real8));
+            }
+
+            for (k = 0; k < 3; k++) {
+                bmin[k] = x[k];
+                bmax[k] = x[k];
+                for (m = 1; m < 4; m++) {
+                    if (x[3*m+k] < bmin[k]) bmin[k] = x[3*m+k];
+                    if (x[3*m+k] > bmax[k]) bmax[k] = x[3*m+k];
+                }
+                center[3*i+k]  = 0.5 * (bmin[k] + bmax[k]);
+                halfExt[3*i+k] = 0.5 * (bmax[k] - bmin[k]) + pad;
+            }
+
+            diag = 2.0 * sqrt(halfExt[3*i]*halfExt[3*i] +
+                              halfExt[3*i+1]*halfExt[3*i+1] +
+                              halfExt[3*i+2]*halfExt[3*i+2]);
+            if (diag > cellMin) cellMin = diag;
+        }
+
+        BinSegmentsInCells(numSegs, center, hinv, isPeriodic, cellMin,
+                           nCells, &cellStart, &cellSegs, &segCell);
+
+        numHits = 0;
+        maxAlloc = 64;
+        hits = (RetroHit_t *)malloc(maxAlloc * sizeof(RetroHit_t));
+        numTested = 0;
+        if (hits == NULL) {
+            outOfMemory = 1;
+            maxAlloc = 0;
+        }
+
+#pragma omp parallel reduction(+:numTested)
+        {
+            int   i, j, k, m, d, c, ix, iy, iz;
+            int   cell[3], nbr[3][3], numNbr[3];
+            real8 cj[3], shift[3], xj[12];
+            RetroHit_t hit;
+
+#pragma omp for schedule(dynamic, 16)
+            for (i = 0; i < numSegs; i++) {
+
+                if (skipSeg != NULL && skipSeg[i]) continue;
+
+                c = segCell[i];
+                cell[0] = c / (nCells[1]*nCells[2]);
+                cell[1] = (c / nCells[2]) % nCells[1];
+                cell[2] = c % nCells[2];
+
+                for (d = 0; d < 3; d++) {
+                    CellNeighborIndices(cell[d], nCells[d],
+                                        isPeriodic != NULL && isPeriodic[d],
+                                        nbr[d], &numNbr[d]);
+                }
+
+                for (ix = 0; ix < numNbr[0]; ix++) {
+                  for (iy = 0; iy < numNbr[1]; iy++) {
+                    for (iz = 0; iz < numNbr[2]; iz++) {
+                      c = (nbr[0][ix]*nCells[1] + nbr[1][iy])*nCells[2] + nbr[2][iz];
+                      for (m = cellStart[c]; m < cellStart[c+1]; m++) {
+
+                        j = cellSegs[m];
+                        if (j <= i) continue;
+                        if (skipSeg != NULL && skipSeg[j]) continue;
+                        if (nodeIDs[2*i]   == nodeIDs[2*j] ||
+                            nodeIDs[2*i]   == nodeIDs[2*j+1] ||
+                            nodeIDs[2*i+1] == nodeIDs[2*j] ||
+                            nodeIDs[2*i+1] == nodeIDs[2*j+1]) continue;
+
+                        PBCClosestImage(h, hinv, isPeriodic, &center[3*i],
+                                        &center[3*j], cj);
+
+                        for (k = 0; k < 3; k++) {
+                            if (fabs(cj[k] - center[3*i+k]) >
+                                halfExt[3*i+k] + halfExt[3*j+k]) break;
+                        }
+                        if (k < 3) continue;
+
+                        numTested++;
+
+                        for (k = 0; k < 3; k++) {
+                            shift[k] = cj[k] - center[3*j+k];
+                        }
+                        for (k = 0; k < 12; k++) {
+                            xj[k] = X[12*j+k] + shift[k%3];
+                        }
+
+                        if (moving) {
+                            if (!SweptMinDist2(&X[12*i], &X[12*i+3], &xj[0], &xj[3],
+                                               &X[12*i+6], &X[12*i+9], &xj[6], &xj[9],
+                                               mindist2, &hit.tau, &hit.dist2,
+                                               &hit.L1, &hit.L2)) continue;
+                        } else {
+                            real8 ddt, *x1 = &X[12*i+6], *x2 = &X[12*i+9];
+                            GetMinDist2(x1[0], x1[1], x1[2], 0.0, 0.0, 0.0,
+                                        x2[0], x2[1], x2[2], 0.0, 0.0, 0.0,
+                                        xj[6], xj[7], xj[8], 0.0, 0.0, 0.0,
+                                        xj[9], xj[10], xj[11], 0.0, 0.0, 0.0,
+                                        &hit.dist2, &ddt, &hit.L1, &hit.L2);
+                            if (hit.dist2 >= mindist2) continue;
+                            hit.tau = 1.0;
+                        }
+
+                        hit.i = i;
+                        hit.j = j;
+/*
+ *                      An allocation failure is raised after the parallel
+ *                      region, which a longjmp cannot leave.
+ */
+#pragma omp critical (RetroCollisionHits)
+                        {
+                            if (numHits == maxAlloc && !outOfMemory) {
+                                RetroHit_t *grown;
+                                grown = (RetroHit_t *)realloc(hits, 2 * maxAlloc * sizeof(RetroHit_t));
+                                if (grown == NULL) {
+                                    outOfMemory = 1;
+                                } else {
+                                    hits = grown;
+                                    maxAlloc *= 2;
+                                }
+                            }
+                            if (numHits < maxAlloc) hits[numHits++] = hit;
+                        }
+                      }
+                    }
+                  }
+                }
+            }
+        }
+
+        if (outOfMemory) {
+            free(hits);
+            free(cellStart);
+            free(cellSegs);
+            free(segCell);
+            free(X);
+            free(center);
+            free(halfExt);
+            ProfileStop(PROFILE_COLLISION);
+            ErrorRaise("RetroCollisionPairs: out of memory");
+        }
+
+/*
+ *      Threads find the hits in arbitrary order, sort them so the
+ *      caller processes collisions reproducibly.
+ */
+        qsort(hits, numHits, sizeof(RetroHit_t), CompareRetroHits);
+
+        for (k = 0; k < numHits && k < maxHits; k++) {
+            hitPairs[2*k]   = hits[k].i;
+            hitPairs[2*k+1] = hits[k].j;
+            tau[k]   = hits[k].tau;
+            dist2[k] = hits[k].dist2;
+            L1[k]    = hits[k].L1;
+            L2[k]    = hits[k].L2;
+        }
+
+        if (numCandidates != NULL) *numCandidates = numTested;
+
+        free(hits);
+        free(cellStart);
+        free(cellSegs);
+        free(segCell);
+        free(X);
+        free(center);
+        free(halfExt);
+
+        ProfileStop(PROFILE_COLLISION);
+
+        return(numHits);
+}
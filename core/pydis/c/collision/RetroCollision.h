@@ -0,0 +1,21 @@
+#include <math.h>
+#define real8 double
+
+/*
+ *      Number of sub-intervals of the timestep sampled by
+ *      SweptMinDist2() to bracket the closest approach of two moving
+ *      segments before it is refined by bisection.
+ */
+#define RETRO_COLLISION_SUBSTEPS 8
+
+int  SweptMinDist2(real8 *x1old, real8 *x2old, real8 *x3old, real8 *x4old,
+                   real8 *x1, real8 *x2, real8 *x3, real8 *x4,
+                   real8 mindist2,
+                   real8 *tau, real8 *dist2, real8 *L1, real8 *L2);
+
+int  RetroCollisionPairs(int numSegs, int *nodeIDs, int *skipSeg,
+                         real8 *R1old, real8 *R2old, real8 *R1, real8 *R2,
+                         real8 *h, real8 *hinv, int *isPeriodic,
+                         real8 mindist2, int maxHits, int *hitPairs,
+                         real8 *tau, real8 *dist2, real8 *L1, real8 *L2,
+                         int *numCandidates);
@@ -0,0 +1,817 @@
+/**************************************************************************
+ *
+ *      Module:       pydis_run.c
+ *      Description:  Standalone simulation driver built from the pydis
+ *                    sources, for batch runs without the python
+ *                    interpreter.  A ParaDiS control file and nodal data
+ *                    file are read into a home structure, which holds
+ *                    the network, and every step runs natively in the
+ *                    order of SimulateNetwork.step:
+ *
+ *                      force      NodeStepEulerForward() (line tension or
+ *                                 all pairs elasticity, elasticinteraction)
+ *                      mobility   Relax or SimpleGlide (mobilityLaw)
+ *                      integrate  forward Euler with deltaTT, the
+ *                                 plastic strain and density of the step
+ *                                 (PlasticStrainIncrement) accumulated in
+ *                                 delpStrain/totpStn, delpSpin/totpSpn
+ *                                 and disloDensity of param
+ *                      collision  retroactive (RetroCollisionPairs,
+ *                                 SelectCollisions, SplitNode, MergeNode)
+ *                      remesh     Remesh() with remeshRule
+ *
+ *                    Every savecnfreq steps the network is written to
+ *                    <dirname>/disnet_<cycle>.ckpt in the checkpoint
+ *                    format of python/framework/checkpoint.py, so the
+ *                    output can be opened with DisNetManager.read_checkpoint.
+ *
+ *      Usage:  pydis_run [-d <dataFile>] [-n <maxstep>] <ctrlFile>
+ *
+ *                    The data file defaults to the control file name
+ *                    with the suffix .ctrl replaced by .data.
+ *
+ *************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include "Home.h"
+#include "Init.h"
+#include "Parse.h"
+#include "Util.h"
+#include "Topology.h"
+#include "DataFile.h"
+#include "Checkpoint.h"
+#include "Error.h"
+#include "../calforce/NodeStep.h"
+#include "../calforce/PlasticStrain.h"
+#include "../calforce/SegSegForceDriver.h"
+#include "../mobility/MobilityGlide.h"
+#include "../collision/RetroCollision.h"
+#include "../collision/CollisionSelect.h"
+
+/*
+ *      Velocity cap of the SimpleGlide mobility (the default vmax of
+ *      MobilityLaw)
+ */
+#define PYDIS_RUN_VMAX 1.0e9
+
+/*
+ *      Flat arrays of the network exported from home at the beginning
+ *      of each step, with the per step force, velocity and arm data
+ */
+typedef struct {
+        int   numNodes, numSegs;
+        int   maxNodes, maxSegs;
+        int   *tags, *constraints, *segNodes, *segTags1, *segTags2;
+        int   *armStart, *armNbr;
+        real8 *R, *Rold, *burgers, *planes, *armPlanes;
+        real8 *segForces, *nodeForces, *nodeVels;
+        real8 *R1, *R2, *R1old, *R2old;
+} Network_t;
+
+/*
+ *      Cell of home in the form of the array modules
+ */
+typedef struct {
+        real8 h[9], hinv[9], origin[3];
+        int   isPeriodic[3];
+} DriverCell_t;
+
+
+static real8 WallTime(void)
+{
+        struct timespec ts;
+
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+
+        return((real8)ts.tv_sec + 1.0e-9 * (real8)ts.tv_nsec);
+}
+
+
+static void *Alloc(void *ptr, size_t n, size_t size)
+{
+        ptr = realloc(ptr, (n > 0 ? n : 1) * size);
+        if (ptr == NULL) Fatal("pydis_run: out of memory");
+        return(ptr);
+}
+
+
+/*---------------------------------------------------------------------------
+ *
+ *      Function:       ExportNetwork
+ *      Description:    Export the nodes of home to the arrays of net
+ *                      (HomeExportArrays), growing them as needed.
+ *
+ *-------------------------------------------------------------------------*/
+static void ExportNetwork(Home_t *home, Network_t *net)
+{
+        int numNodes, numSegs;
+
+        numNodes = HomeExportArrays(home, net->maxNodes, net->tags, net->R,
+                                    net->constraints, net->maxSegs, &numSegs,
+                                    net->segNodes, net->burgers, net->planes);
+        if (numNodes < 0) Fatal("%s", ErrorMessage());
+
+        if (numNodes > net->maxNodes || numSegs > net->maxSegs) {
+
+            net->maxNodes = 2 * numNodes;
+            net->maxSegs  = 2 * numSegs;
+
+            net->tags        = Alloc(net->tags, 2*net->maxNodes, sizeof(int));
+            net->constraints = Alloc(net->constraints, net->maxNodes, sizeof(int));
+            net->R           = Alloc(net->R, 3*net->maxNodes, sizeof(real8));
+            net->Rold        = Alloc(net->Rold, 3*net->maxNodes, sizeof(real8));
+            net->nodeForces  = Alloc(net->nodeForces, 3*net->maxNodes, sizeof(real8));
+            net->nodeVels    = Alloc(net->nodeVels, 3*net->maxNodes, sizeof(real8));
+            net->armStart    = Alloc(net->armStart, net->maxNodes+1, sizeof(int));
+
+            net->segNodes  = Alloc(net->segNodes, 2*net->maxSegs, sizeof(int));
+            net->segTags1  = Alloc(net->segTags1, 2*net->maxSegs, sizeof(int));
+            net->segTags2  = Alloc(net->segTags2, 2*net->maxSegs, sizeof(int));
+            net->burgers   = Alloc(net->burgers, 3*net->maxSegs, sizeof(real8));
+            net->planes    = Alloc(net->planes, 3*net->maxSegs, sizeof(real8));
+            net->segForces = Alloc(net->segForces, 6*net->maxSegs, sizeof(real8));
+            net->armNbr    = Alloc(net->armNbr, 2*net->maxSegs, sizeof(int));
+            net->armPlanes = Alloc(net->armPlanes, 6*net->maxSegs, sizeof(real8));
+            net->R1        = Alloc(net->R1, 3*net->maxSegs, sizeof(real8));
+            net->R2        = Alloc(net->R2, 3*net->maxSegs, sizeof(real8));
+            net->R1old     = Alloc(net->R1old, 3*net->maxSegs, sizeof(real8));
+            net->R2old     = Alloc(net->R2old, 3*net->maxSegs, sizeof(real8));
+
+            numNodes = HomeExportArrays(home, net->maxNodes, net->tags,
+                                        net->R, net->constraints,
+                                        net->maxSegs, &numSegs,
+                                        net->segNodes, net->burgers,
+                                        net->planes);
+            if (numNodes < 0) Fatal("%s", ErrorMessage());
+        }
+
+        net->numNodes = numNodes;
+        net->numSegs  = numSegs;
+
+        return;
+}
+
+
+static void FreeNetwork(Network_t *net)
+{
+        free(net->tags);       free(net->constraints); free(net->R);
+        free(net->Rold);       free(net->nodeForces);  free(net->nodeVels);
+        free(net->armStart);   free(net->segNodes);    free(net->segTags1);
+        free(net->segTags2);   free(net->burgers);     free(net->planes);
+        free(net->segForces);  free(net->armNbr);      free(net->armPlanes);
+        free(net->R1);         free(net->R2);          free(net->R1old);
+        free(net->R2old);
+
+        return;
+}
+
+
+/*---------------------------------------------------------------------------
+ *
+ *      Function:       GetDriverCell
+ *      Description:    Cell matrix, inverse, origin and periodicity of
+ *                      the (orthorhombic) box of param.
+ *
+ *-------------------------------------------------------------------------*/
+static void GetDriverCell(Param_t *param, DriverCell_t *cell)
+{
+        memset(cell, 0, sizeof(DriverCell_t));
+
+        cell->h[0] = param->Lx;
+        cell->h[4] = param->Ly;
+        cell->h[8] = param->Lz;
+        cell->hinv[0] = param->invLx;
+        cell->hinv[4] = param->invLy;
+        cell->hinv[8] = param->invLz;
+
+        cell->origin[0] = param->minSideX;
+        cell->origin[1] = param->minSideY;
+        cell->origin[2] = param->minSideZ;
+
+        cell->isPeriodic[0] = (param->xBoundType == Periodic);
+        cell->isPeriodic[1] = (param->yBoundType == Periodic);
+        cell->isPeriodic[2] = (param->zBoundType == Periodic);
+
+        return;
+}
+
+
+/*---------------------------------------------------------------------------
+ *
+ *      Function:       LoadDataFile
+ *      Description:    Read the nodes of a ParaDiS nodal data file into
+ *                      home, with the box set to the min/maxCoordinates
+ *                      of the file and the cells built for it.
+ *
+ *-------------------------------------------------------------------------*/
+static void LoadDataFile(Home_t *home, char *dataFile)
+{
+        int        numNodes, numSegs, maxSegs, *tags, *constraints, *segNodes;
+        real8      *R, *burgers, *planes;
+        Param_t    *param;
+        DataFile_t *df;
+
+        param = home->param;
+
+        df = DataFileOpen(dataFile);
+        if (df == (DataFile_t *)NULL) {
+            Fatal("pydis_run: %s", ErrorMessage());
+        }
+
+        numNodes = df->numNodes;
+        maxSegs  = df->numArms / 2;
+
+        tags        = Alloc(NULL, 2*numNodes, sizeof(int));
+        constraints = Alloc(NULL, numNodes, sizeof(int));
+        R           = Alloc(NULL, 3*numNodes, sizeof(real8));
+        segNodes    = Alloc(NULL, 2*maxSegs, sizeof(int));
+        burgers     = Alloc(NULL, 3*maxSegs, sizeof(real8));
+        planes      = Alloc(NULL, 3*maxSegs, sizeof(real8));
+
+        numSegs = DataFileReadNodes(df, tags, R, constraints, maxSegs,
+                                    segNodes, burgers, planes);
+
+        param->minSideX = param->minCoordinates[X] = df->minCoordinates[X];
+        param->minSideY = param->minCoordinates[Y] = df->minCoordinates[Y];
+        param->minSideZ = param->minCoordinates[Z] = df->minCoordinates[Z];
+        param->maxSideX = param->maxCoordinates[X] = df->maxCoordinates[X];
+        param->maxSideY = param->maxCoordinates[Y] = df->maxCoordinates[Y];
+        param->maxSideZ = param->maxCoordinates[Z] = df->maxCoordinates[Z];
+
+        DataFileClose(df);
+
+        if (numSegs < 0) {
+            Fatal("pydis_run: %s", ErrorMessage());
+        }
+
+/*
+ *      A single domain spans the whole box
+ */
+        home->domXmin = param->minSideX;
+        home->domYmin = param->minSideY;
+        home->domZmin = param->minSideZ;
+        home->domXmax = param->maxSideX;
+        home->domYmax = param->maxSideY;
+        home->domZmax = param->maxSideZ;
+
+        SetBoxSize(param);
+        InitCellNatives(home);
+        InitCellNeighbors(home);
+
+        if (HomeImportArrays(home, numNodes, tags, R, constraints, numSegs,
+                             segNodes, burgers, planes) < 0) {
+            Fatal("%s", ErrorMessage());
+        }
+
+        printf("pydis_run: read %d nodes and %d segments from %s\n",
+               numNodes, numSegs, dataFile);
+
+        free(tags);
+        free(constraints);
+        free(R);
+        free(segNodes);
+        free(burgers);
+        free(planes);
+
+        return;
+}
+
+
+/*---------------------------------------------------------------------------
+ *
+ *      Function:       NodeArms
+ *      Description:    Arms of every node in compressed sparse row form
+ *                      for MobilitySimpleGlide() (node_arms_csr of
+ *                      mobility_paradis.py).
+ *
+ *-------------------------------------------------------------------------*/
+static void NodeArms(Network_t *net)
+{
+        int i, k, n, arm, *fill;
+
+        fill = Alloc(NULL, net->numNodes, sizeof(int));
+
+        memset(net->armStart, 0, (net->numNodes + 1) * sizeof(int));
+        for (i = 0; i < 2*net->numSegs; i++) {
+            net->armStart[net->segNodes[i] + 1]++;
+        }
+        for (i = 0; i < net->numNodes; i++) {
+            net->armStart[i+1] += net->armStart[i];
+            fill[i] = net->armStart[i];
+        }
+
+        for (i = 0; i < net->numSegs; i++) {
+            for (n = 0; n < 2; n++) {
+                arm = fill[net->segNodes[2*i+n]]++;
+                net->armNbr[arm] = net->segNodes[2*i+1-n];
+                for (k = 0; k < 3; k++) {
+                    net->armPlanes[3*arm+k] = net->planes[3*i+k];
+                }
+            }
+        }
+
+        free(fill);
+
+        return;
+}
+
+
+/*---------------------------------------------------------------------------
+ *
+ *      Function:       StepNodes
+ *      Description:    Nodal forces, velocities and forward Euler update
+ *                      of the exported network.  The new positions,
+ *                      velocities and segment forces are copied into
+ *                      home, the positions at the beginning of the step
+ *                      are kept in net->Rold.
+ *
+ *-------------------------------------------------------------------------*/
+static void StepNodes(Home_t *home, Network_t *net, DriverCell_t *cell,
+                      real8 dt)
+{
+        int     i, k, forceMode;
+        real8   sigext[9];
+        Node_t  *node;
+        Param_t *param;
+
+        param = home->param;
+
+/*
+ *      appliedStress is [xx yy zz yz xz xy] as the voigt vectors of
+ *      the python modules
+ */
+        sigext[0] = param->appliedStress[0];
+        sigext[4] = param->appliedStress[1];
+        sigext[8] = param->appliedStress[2];
+        sigext[5] = sigext[7] = param->appliedStress[3];
+        sigext[2] = sigext[6] = param->appliedStress[4];
+        sigext[1] = sigext[3] = param->appliedStress[5];
+
+        forceMode = param->elasticinteraction ? NODE_STEP_FORCE_ELASTICITY :
+                                                NODE_STEP_FORCE_LINE_TENSION;
+
+        memcpy(net->Rold, net->R, 3 * net->numNodes * sizeof(real8));
+
+/*
+ *      Forces (and the Relax velocities) without moving the nodes
+ */
+        NodeStepEulerForward(net->numNodes, net->numSegs, net->segNodes,
+                             net->R, net->constraints, net->burgers,
+                             cell->h, cell->hinv, cell->isPeriodic,
+                             sigext, forceMode, param->rc,
+                             param->shearModulus, param->pois, param->Ecore,
+                             0, NULL, NULL, NODE_STEP_MOBILITY_RELAX, 0.0,
+                             net->segForces, net->nodeForces, net->nodeVels);
+
+        if (strcmp(param->mobilityLaw, "SimpleGlide") == 0) {
+            NodeArms(net);
+            MobilitySimpleGlide(net->numNodes, net->R, net->constraints,
+                                net->nodeForces, net->armStart, net->armNbr,
+                                net->armPlanes, cell->h, cell->hinv,
+                                cell->isPeriodic, param->MobScrew,
+                                PYDIS_RUN_VMAX, 1.0e-10, net->nodeVels);
+        } else if (strcmp(param->mobilityLaw, "Relax") != 0) {
+            Fatal("pydis_run: mobility law %s is not supported natively "
+                  "(use Relax or SimpleGlide)", param->mobilityLaw);
+        }
+
+        for (i = 0; i < 3*net->numNodes; i++) {
+            net->R[i] += dt * net->nodeVels[i];
+        }
+
+        for (i = 0; i < net->numSegs; i++) {
+            for (k = 0; k < 2; k++) {
+                net->segTags1[2*i+k] = net->tags[2*net->segNodes[2*i]+k];
+                net->segTags2[2*i+k] = net->tags[2*net->segNodes[2*i+1]+k];
+            }
+        }
+
+        HomeSetPositions(home, net->numNodes, net->tags, net->R);
+        HomeSetVelocities(home, net->numNodes, net->tags, net->nodeVels);
+        HomeSetSegForces(home, net->numSegs, net->segTags1, net->segTags2,
+                         net->segForces);
+
+/*
+ *      The forces of all nodes are current again
+ */
+        for (i = 0; i < home->newNodeKeyPtr; i++) {
+            if ((node = home->nodeKeys[i]) == (Node_t *)NULL) continue;
+            node->flags &= ~NODE_RESET_FORCES;
+        }
+
+        return;
+}
+
+
+/*---------------------------------------------------------------------------
+ *
+ *      Function:       StepPlasticStrain
+ *      Description:    Plastic strain and spin increments and dislocation
+ *                      density of the step just taken by StepNodes(),
+ *                      from the areas swept by the segments between
+ *                      net->Rold and net->R.  The increments are stored
+ *                      in param->delpStrain and delpSpin and added to
+ *                      totpStn and totpSpn (spin components 3-5, yz, xz,
+ *                      xy), the density in param->disloDensity.
+ *
+ *-------------------------------------------------------------------------*/
+static void StepPlasticStrain(Home_t *home, Network_t *net,
+                              DriverCell_t *cell, real8 dt)
+{
+        int     i, k;
+        real8   volume, length, dSpin[3];
+        Param_t *param;
+
+        param  = home->param;
+        volume = param->Lx * param->Ly * param->Lz;
+
+/*
+ *      R1old/R2old are scratch here, StepCollisions() gathers them again
+ */
+        for (i = 0; i < net->numSegs; i++) {
+            for (k = 0; k < 3; k++) {
+                net->R1old[3*i+k] = net->Rold[3*net->segNodes[2*i]+k];
+            }
+            PBCClosestImage(cell->h, cell->hinv, cell->isPeriodic,
+                            &net->R1old[3*i],
+                            &net->Rold[3*net->segNodes[2*i+1]],
+                            &net->R2old[3*i]);
+        }
+
+        PlasticStrainIncrement(net->numSegs, net->segNodes, net->R1old,
+                               net->R2old, net->nodeVels, dt, net->burgers,
+                               NULL, volume, 0, NULL, NULL,
+                               param->delpStrain, dSpin, &length,
+                               NULL, NULL);
+
+        for (k = 0; k < 6; k++) param->totpStn[k] += param->delpStrain[k];
+
+        for (k = 0; k < 3; k++) {
+            param->delpSpin[3+k]  = dSpin[k];
+            param->totpSpn[3+k]  += dSpin[k];
+        }
+
+        param->disloDensity = length / (volume * param->burgMag *
+                                        param->burgMag);
+
+        return;
+}
+
+
+/*---------------------------------------------------------------------------
+ *
+ *      Function:       CollisionNode
+ *      Description:    Node of home at which segment seg collides: one
+ *                      of its end nodes if the collision point L is
+ *                      within the collision distance of it, otherwise a
+ *                      new node inserted on the segment at L (as
+ *                      Collision.MergeSegments).
+ *
+ *      Arguments:
+ *          p1, p2   end points of the segment, p2 the image closest
+ *                   to p1
+ *          pos      returned position of the collision node
+ *
+ *-------------------------------------------------------------------------*/
+static Node_t *CollisionNode(Home_t *home, Network_t *net, int seg,
+                             real8 *p1, real8 *p2, real8 L, real8 mindist2,
+                             real8 *pos)
+{
+        int    k, armID;
+        real8  len2, pos1[3], vel1[3], vel[3];
+        Tag_t  tag1, tag2;
+        Node_t *node1, *node2, *splitNode1, *splitNode2;
+
+        tag1.domainID = net->tags[2*net->segNodes[2*seg]];
+        tag1.index    = net->tags[2*net->segNodes[2*seg]+1];
+        tag2.domainID = net->tags[2*net->segNodes[2*seg+1]];
+        tag2.index    = net->tags[2*net->segNodes[2*seg+1]+1];
+
+        node1 = GetNodeFromTag(home, tag1);
+        node2 = GetNodeFromTag(home, tag2);
+        if (node1 == (Node_t *)NULL || node2 == (Node_t *)NULL) {
+            return((Node_t *)NULL);
+        }
+
+        len2 = 0.0;
+        for (k = 0; k < 3; k++) {
+            len2 += (p2[k] - p1[k]) * (p2[k] - p1[k]);
+        }
+
+        if (len2 * L * L < mindist2) {
+            for (k = 0; k < 3; k++) pos[k] = p1[k];
+            return(node1);
+        }
+
+        if (len2 * (1.0 - L) * (1.0 - L) < mindist2) {
+            for (k = 0; k < 3; k++) pos[k] = p2[k];
+            return(node2);
+        }
+
+        armID = GetArmID(home, node1, node2);
+        if (armID < 0) return((Node_t *)NULL);
+
+        pos1[X] = node1->x;  vel1[X] = node1->vX;
+        pos1[Y] = node1->y;  vel1[Y] = node1->vY;
+        pos1[Z] = node1->z;  vel1[Z] = node1->vZ;
+
+        vel[X] = (1.0 - L) * node1->vX + L * node2->vX;
+        vel[Y] = (1.0 - L) * node1->vY + L * node2->vY;
+        vel[Z] = (1.0 - L) * node1->vZ + L * node2->vZ;
+
+        for (k = 0; k < 3; k++) {
+            pos[k] = (1.0 - L) * p1[k] + L * p2[k];
+        }
+        FoldBox(home->param, &pos[X], &pos[Y], &pos[Z]);
+
+        if (SplitNode(home, OPCLASS_COLLISION, node1, pos1, pos, vel1, vel,
+                      1, &armID, 0, &splitNode1, &splitNode2, 0) !=
+            SPLIT_SUCCESS) {
+            return((Node_t *)NULL);
+        }
+
+        MarkNodeForceObsolete(home, splitNode1);
+        MarkNodeForceObsolete(home, splitNode2);
+        MarkNodeForceObsolete(home, node2);
+
+/*
+ *      Back to the image of p1 for the merge position
+ */
+        PBCPOSITION(home->param, p1[X], p1[Y], p1[Z],
+                    &pos[X], &pos[Y], &pos[Z]);
+
+        return(splitNode2);
+}
+
+
+/*---------------------------------------------------------------------------
+ *
+ *      Function:       StepCollisions
+ *      Description:    Retroactive collisions of the step, as
+ *                      Collision.HandleCol_TwoPhase: the collisions
+ *                      between the positions at the beginning (Rold)
+ *                      and the end (R) of the step are detected at once,
+ *                      a set of collisions without shared nodes is
+ *                      selected, and each of those merges the closest
+ *                      points of its two segments.
+ *
+ *      Returns:  the number of collisions committed
+ *
+ *-------------------------------------------------------------------------*/
+static int StepCollisions(Home_t *home, Network_t *net, DriverCell_t *cell)
+{
+        int     i, k, n, s1, s2, numHits, maxHits, numCommit, status;
+        int     *hitPairs, *commitList;
+        real8   mindist2, *tau, *dist2, *L1, *L2;
+        real8   p1[3], p2[3], p3[3], p4[3], pos1[3], pos2[3], pos[3];
+        Node_t  *node1, *node2, *mergedNode;
+        Param_t *param;
+
+        param = home->param;
+        mindist2 = param->rann * param->rann;
+
+        for (i = 0; i < net->numSegs; i++) {
+            for (k = 0; k < 3; k++) {
+                net->R1[3*i+k]    = net->R[3*net->segNodes[2*i]+k];
+                net->R2[3*i+k]    = net->R[3*net->segNodes[2*i+1]+k];
+                net->R1old[3*i+k] = net->Rold[3*net->segNodes[2*i]+k];
+                net->R2old[3*i+k] = net->Rold[3*net->segNodes[2*i+1]+k];
+            }
+        }
+
+        maxHits = 0;
+        hitPairs = NULL;
+        tau = dist2 = L1 = L2 = NULL;
+
+        while (1) {
+            numHits = RetroCollisionPairs(net->numSegs, net->segNodes, NULL,
+                                          net->R1old, net->R2old,
+                                          net->R1, net->R2, cell->h,
+                                          cell->hinv, cell->isPeriodic,
+                                          mindist2, maxHits, hitPairs,
+                                          tau, dist2, L1, L2, NULL);
+            if (numHits <= maxHits) break;
+
+            maxHits  = numHits;
+            hitPairs = Alloc(hitPairs, 2*maxHits, sizeof(int));
+            tau      = Alloc(tau, maxHits, sizeof(real8));
+            dist2    = Alloc(dist2, maxHits, sizeof(real8));
+            L1       = Alloc(L1, maxHits, sizeof(real8));
+            L2       = Alloc(L2, maxHits, sizeof(real8));
+        }
+
+        commitList = Alloc(NULL, numHits, sizeof(int));
+        numCommit = SelectCollisions(numHits, hitPairs, tau, dist2,
+                                     net->numNodes, net->segNodes,
+                                     commitList);
+
+        for (i = 0; i < numCommit; i++) {
+
+            n  = commitList[i];
+            s1 = hitPairs[2*n];
+            s2 = hitPairs[2*n+1];
+
+            for (k = 0; k < 3; k++) {
+                p1[k] = net->R1[3*s1+k];
+                p2[k] = net->R2[3*s1+k];
+                p3[k] = net->R1[3*s2+k];
+                p4[k] = net->R2[3*s2+k];
+            }
+            PBCPOSITION(param, p1[X], p1[Y], p1[Z], &p2[X], &p2[Y], &p2[Z]);
+            PBCPOSITION(param, p1[X], p1[Y], p1[Z], &p3[X], &p3[Y], &p3[Z]);
+            PBCPOSITION(param, p3[X], p3[Y], p3[Z], &p4[X], &p4[Y], &p4[Z]);
+
+            node1 = CollisionNode(home, net, s1, p1, p2, L1[n], mindist2, pos1);
+            node2 = CollisionNode(home, net, s2, p3, p4, L2[n], mindist2, pos2);
+            if (node1 == (Node_t *)NULL || node2 == (Node_t *)NULL) continue;
+
+            PBCPOSITION(param, pos1[X], pos1[Y], pos1[Z],
+                        &pos2[X], &pos2[Y], &pos2[Z]);
+            for (k = 0; k < 3; k++) {
+                pos[k] = 0.5 * (pos1[k] + pos2[k]);
+            }
+            FoldBox(param, &pos[X], &pos[Y], &pos[Z]);
+
+            MergeNode(home, OPCLASS_COLLISION, node1, node2, pos,
+                      &mergedNode, &status, 0);
+        }
+
+        free(commitList);
+        free(hitPairs);
+        free(tau);
+        free(dist2);
+        free(L1);
+        free(L2);
+
+        return(numCommit);
+}
+
+
+/*---------------------------------------------------------------------------
+ *
+ *      Function:       WriteNetworkCheckpoint
+ *      Description:    Write the network of home to
+ *                      <dirname>/disnet_<cycle>.ckpt
+ *
+ *-------------------------------------------------------------------------*/
+static void WriteNetworkCheckpoint(Home_t *home, Network_t *net, int cycle)
+{
+        char         fileName[MAX_STRING_LEN + 32];
+        DriverCell_t cell;
+
+        ExportNetwork(home, net);
+        GetDriverCell(home->param, &cell);
+
+        snprintf(fileName, sizeof(fileName), "%s/disnet_%d.ckpt",
+                 home->param->dirname, cycle);
+
+        WriteCheckpointFile(fileName, net->numNodes, net->tags, net->R,
+                            net->constraints, net->numSegs, net->segNodes,
+                            net->burgers, net->planes, cell.h, cell.origin,
+                            cell.isPeriodic, 0, NULL, 0, NULL);
+
+        return;
+}
+
+
+static void Usage(char *prog)
+{
+        fprintf(stderr, "Usage: %s [-d <dataFile>] [-n <maxstep>] "
+                "<ctrlFile>\n", prog);
+        exit(1);
+}
+
+
+int main(int argc, char *argv[])
+{
+        int          i, len, tstep, cycle, maxstep, numCollisions;
+        char         *ctrlFile, *dataFile, *defaultDataFile;
+        real8        dt, t0, elapsed;
+        Home_t       *home;
+        Param_t      *param;
+        Network_t    net;
+        DriverCell_t cell;
+        ErrorTrap_t  trap;
+
+        ctrlFile = NULL;
+        dataFile = NULL;
+        maxstep  = -1;
+
+        for (i = 1; i < argc; i++) {
+            if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
+                dataFile = argv[++i];
+            } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+                maxstep = atoi(argv[++i]);
+            } else if (argv[i][0] == '-' || ctrlFile != NULL) {
+                Usage(argv[0]);
+            } else {
+                ctrlFile = argv[i];
+            }
+        }
+        if (ctrlFile == NULL) Usage(argv[0]);
+
+        defaultDataFile = NULL;
+        if (dataFile == NULL) {
+            len = strlen(ctrlFile);
+            defaultDataFile = Alloc(NULL, len + 6, sizeof(char));
+            strcpy(defaultDataFile, ctrlFile);
+            if (len > 5 && strcmp(ctrlFile + len - 5, ".ctrl") == 0) {
+                defaultDataFile[len-5] = 0;
+            }
+            strcat(defaultDataFile, ".data");
+            dataFile = defaultDataFile;
+        }
+
+        if (ParadisInit_lean(&home) < 0) {
+            fprintf(stderr, "pydis_run: %s\n", ErrorMessage());
+            return(1);
+        }
+
+        memset(&net, 0, sizeof(net));
+
+        ErrorTrapPush(&trap);
+        if (setjmp(trap.env) != 0) {
+            fprintf(stderr, "pydis_run: %s\n", ErrorMessage());
+            return(1);
+        }
+
+        param = home->param;
+
+/*
+ *      The cells built by ParadisInit_lean() for the default grid are
+ *      built again by LoadDataFile() for the numX/Y/Zcells of the
+ *      control file and the box of the data file
+ */
+        HomeFreeCells(home);
+        ReadControlFile(home, ctrlFile);
+        LoadDataFile(home, dataFile);
+        SetRemainingDefaults(home);
+
+        if (maxstep >= 0) param->maxstep = maxstep;
+        dt = param->deltaTT;
+
+        if (param->savecn && param->savecnfreq > 0) {
+            if (mkdir(param->dirname, 0755) != 0 && errno != EEXIST) {
+                Fatal("pydis_run: cannot create directory %s",
+                      param->dirname);
+            }
+        }
+
+        printf("pydis_run: %d steps of dt = %e, mobility %s, %s forces\n",
+               param->maxstep, dt, param->mobilityLaw,
+               param->elasticinteraction ? "elastic" : "line tension");
+
+        GetDriverCell(param, &cell);
+        numCollisions = 0;
+        t0 = WallTime();
+
+        for (tstep = 0; tstep < param->maxstep; tstep++) {
+
+            cycle = param->cycleStart + tstep;
+            home->cycle = cycle;
+
+            ExportNetwork(home, &net);
+            StepNodes(home, &net, &cell, dt);
+            StepPlasticStrain(home, &net, &cell, dt);
+
+            if (param->collisionMethod > 0) {
+                numCollisions += StepCollisions(home, &net, &cell);
+            }
+
+            if (Remesh(home) < 0) Fatal("%s", ErrorMessage());
+
+            param->timeNow += dt;
+
+            if (param->savecn && param->savecnfreq > 0 &&
+                tstep % param->savecnfreq == 0) {
+                WriteNetworkCheckpoint(home, &net, cycle);
+                printf("step = %d dt = %e nodes = %d segments = %d "
+                       "density = %e\n", cycle, dt, net.numNodes,
+                       net.numSegs, param->disloDensity);
+            }
+        }
+
+        elapsed = WallTime() - t0;
+
+        ExportNetwork(home, &net);
+        printf("pydis_run: %d steps in %g s, %d collisions, "
+               "%d nodes and %d segments\n", param->maxstep, elapsed,
+               numCollisions, net.numNodes, net.numSegs);
+        printf("pydis_run: plastic strain [xx yy zz yz xz xy] = "
+               "[%e %e %e %e %e %e]\n", param->totpStn[0], param->totpStn[1],
+               param->totpStn[2], param->totpStn[3], param->totpStn[4],
+               param->totpStn[5]);
+
+        ErrorTrapPop(&trap);
+
+        FreeNetwork(&net);
+        free(defaultDataFile);
+        HomeFree(home);
+
+        return(0);
+}
@@ -0,0 +1,44 @@
+/*************************************************************************
+ *
+ *  Checkpoint.h - native writer of binary network checkpoint files
+ *
+ ************************************************************************/
+
+#ifndef _Checkpoint_h
+#define _Checkpoint_h
+
+#include "Typedefs.h"
+
+/*
+ *      File layout of python/framework/checkpoint.py: magic, header
+ *      length (little-endian uint64), JSON header padded with spaces
+ *      and the raw arrays, each starting on CHECKPOINT_ALIGN bytes.
+ */
+#define CHECKPOINT_MAGIC          "DISNETCK"
+#define CHECKPOINT_FORMAT_VERSION 1
+#define CHECKPOINT_ALIGN          64
+
+/*
+ *      A scalar value stored in the "attrs" of the header and an
+ *      additional [rows][cols] float64 array stored by name
+ */
+typedef struct {
+        const char *name;
+        real8      value;
+} CheckpointAttr_t;
+
+typedef struct {
+        const char *name;
+        int        rows;
+        int        cols;
+        real8      *data;
+} CheckpointArray_t;
+
+void WriteCheckpointFile(char *fileName, int numNodes, int *tags, real8 *R,
+                         int *constraints, int numSegs, int *segNodes,
+                         real8 *burgers, real8 *planes, real8 *h,
+                         real8 *origin, int *isPeriodic,
+                         int numAttrs, CheckpointAttr_t *attrs,
+                         int numArrays, CheckpointArray_t *arrays);
+
+#endif
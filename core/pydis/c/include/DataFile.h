@@ -0,0 +1,37 @@
+/*************************************************************************
+ *
+ *  DataFile.h - native reader of ParaDiS nodal data (restart) files
+ *
+ ************************************************************************/
+
+#ifndef _DataFile_h
+#define _DataFile_h
+
+#include <stddef.h>
+#include "Typedefs.h"
+
+/*
+ *      An opened data file: the memory-mapped file and the index of its
+ *      node records built by DataFileOpen()
+ */
+typedef struct _datafile {
+        char   *data;                /* memory-mapped file contents */
+        size_t size;                 /* file size in bytes */
+        int    dataFileVersion;
+        int    numNodes;             /* number of node records */
+        int    numArms;              /* total number of arm records */
+        real8  minCoordinates[3];    /* simulation cell bounds */
+        real8  maxCoordinates[3];
+        size_t *nodeOffset;          /* [numNodes] file offset of each */
+                                     /* node record */
+        int    *armStart;            /* [numNodes+1] arms of node i are */
+                                     /* armStart[i] to armStart[i+1]-1 */
+} DataFile_t;
+
+DataFile_t *DataFileOpen(char *fileName);
+int  DataFileReadNodes(DataFile_t *df, int *tags, real8 *R, int *constraints,
+                       int maxSegs, int *nodeids, real8 *burgers,
+                       real8 *planes);
+void DataFileClose(DataFile_t *df);
+
+#endif
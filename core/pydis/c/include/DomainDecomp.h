@@ -0,0 +1,66 @@
+/*************************************************************************
+ *
+ *  DomainDecomp.h - spatial domain decomposition of the segment force
+ *                   calculation over MPI ranks
+ *
+ *  The simulation cell is split into nXdoms x nYdoms x nZdoms domains by
+ *  recursive sectioning (RSDecomp_t of Decomp.h) in fractional cell
+ *  coordinates.  A segment is native to the domain containing its
+ *  midpoint and a node to the domain containing its position.  Each
+ *  rank passes only its native segments; the segments of other ranks
+ *  within the force cutoff of its domain are received as ghosts and
+ *  the rank computes the forces on its natives (owner computes).
+ *
+ *  The domains are recursive sectioning (decomposition type 1) or
+ *  recursive bisection (type 2, RBDecomp_t) boundaries, balanced for the
+ *  segment count or for the load measured by the force calculation
+ *  (DomainDecompRebalance, with the DLB_USE_* criteria of Decomp.h).
+ *
+ *  Without PARALLEL there is a single domain and no communication.
+ *
+ ************************************************************************/
+
+#ifndef _DomainDecomp_h
+#define _DomainDecomp_h
+
+#include "Typedefs.h"
+
+typedef struct _domaindecomp DomainDecomp_t;
+
+int  DomainDecompInit(int *myDomain, int *numDomains);
+void DomainDecompFinalize(void);
+
+DomainDecomp_t *DomainDecompCreate(int nXdoms, int nYdoms, int nZdoms,
+                                   real8 *h, real8 *origin, int *isPeriodic);
+void DomainDecompFree(DomainDecomp_t *dd);
+
+int  DomainDecompSetType(DomainDecomp_t *dd, int decompType);
+int  DomainDecompBalance(DomainDecomp_t *dd, int numSegs,
+                         real8 *R1, real8 *R2);
+int  DomainDecompBalanceLoad(DomainDecomp_t *dd, int numSegs,
+                             real8 *R1, real8 *R2, real8 *load);
+int  DomainDecompGetSegLoad(DomainDecomp_t *dd, int criteria, real8 *load);
+int  DomainDecompRebalance(DomainDecomp_t *dd, int numSegs,
+                           real8 *R1, real8 *R2, int criteria);
+void DomainDecompGetBounds(DomainDecomp_t *dd, int domain,
+                           real8 *sMin, real8 *sMax);
+int  DomainDecompOwner(DomainDecomp_t *dd, real8 *x);
+void DomainDecompSegOwners(DomainDecomp_t *dd, int numSegs,
+                           real8 *R1, real8 *R2, int *owners);
+
+int  DomainDecompMigrate(DomainDecomp_t *dd, int numSegs, int *segNodes,
+                         real8 *R1, real8 *R2, real8 *burgers);
+void DomainDecompGetSegments(DomainDecomp_t *dd, int *segNodes,
+                             real8 *R1, real8 *R2, real8 *burgers);
+
+int  DomainDecompSegForces(DomainDecomp_t *dd, int numSegs,
+                           real8 *R1, real8 *R2, real8 *burgers,
+                           real8 cutoff, real8 a, real8 MU, real8 NU,
+                           int Nint, real8 *quad_points, real8 *weights,
+                           real8 *segForces);
+int  DomainDecompNodeForces(DomainDecomp_t *dd, int numSegs, int *segNodes,
+                            real8 *segForces, int numNodes, int *nodeTags,
+                            real8 *nodePos, real8 *nodeForces);
+int  DomainDecompSum(DomainDecomp_t *dd, int n, real8 *values);
+
+#endif
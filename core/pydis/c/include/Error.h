@@ -0,0 +1,76 @@
+/*************************************************************************
+ *
+ *  Error.h - error reporting of the native library
+ *
+ *  Errors are raised with ErrorRaise() (through Fatal() in the ParaDiS
+ *  modules).  A library entry point that can fail sets an error trap;
+ *  an error raised while the trap is set unwinds to it and the entry
+ *  point returns an error code instead of exiting the process.  Outside
+ *  any trap an error prints its message and exits, as before.
+ *
+ *      int Entry(Home_t *home)
+ *      {
+ *          ErrorTrap_t trap;
+ *
+ *          ErrorTrapPush(&trap);
+ *          if (setjmp(trap.env) != 0) return(-1);
+ *          ...
+ *          ErrorTrapPop(&trap);
+ *          return(0);
+ *      }
+ *
+ *  A routine that holds buffers or an open profile phase across calls
+ *  that can fail sets its own trap the same way, releases them when an
+ *  error returns to it and passes the error on with ErrorPropagate().
+ *
+ *  The traps and the last error message belong to the calling thread,
+ *  so independent instances can run (and fail) in concurrent threads.
+ *  ErrorRaise() must not be called inside an OpenMP parallel region.
+ *  An instance whose call failed may be left inconsistent and should
+ *  only be freed.  This header is self-contained (no real8) so that it
+ *  can be included by the calforce, collision and mobility modules.
+ *
+ ************************************************************************/
+
+#ifndef _Error_h
+#define _Error_h
+
+#include <setjmp.h>
+
+/*
+ *      Storage class of the per-thread library state
+ */
+#if defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 201112L) && \
+    !defined(__STDC_NO_THREADS__)
+#define THREAD_LOCAL _Thread_local
+#else
+#define THREAD_LOCAL __thread
+#endif
+
+#define ERROR_MSG_LEN 512
+
+typedef struct _errortrap ErrorTrap_t;
+
+struct _errortrap {
+        jmp_buf     env;
+        ErrorTrap_t *prev;
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void        ErrorTrapPush(ErrorTrap_t *trap);
+void        ErrorTrapPop(ErrorTrap_t *trap);
+int         ErrorTrapped(void);
+void        ErrorRaise(const char *format, ...);
+void        ErrorPropagate(void);
+const char *ErrorMessage(void);
+int         ErrorCount(void);
+void        ErrorClear(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -221,10 +221,29 @@ struct _home {
         int       newNodeKeyPtr;
         int       newNodeKeyMax;
 
+/*
+ *      activeNodes lists the nodes in nodeKeys densely (in no particular
+ *      order) so that loops over all nodes do not have to skip the holes
+ *      of nodeKeys.  Each node stores its position in node->activeIdx.
+ */
+        Node_t    **activeNodes;
+        int       numActiveNodes;
+        int       activeNodesMax;
+
         int       *recycledNodeHeap;
         int       recycledNodeHeapSize;
         int       recycledNodeHeapEnts;
 
+/*
+ *      Tags of the native nodes freed since the last HomeClearChanges().
+ *      Together with the NODE_TOPO_CHANGED flag of the nodes this lets
+ *      the changes of a topological operation be exported without
+ *      exporting the whole network (HomeExportChanges()).
+ */
+        Tag_t     *removedTags;
+        int       numRemovedTags;
+        int       removedTagsMax;
+
 /*
  *      cellList keeps a list of all base cells of interest to this domain,
  *      whether native, ghost, or the base cell of a periodic ghost cell.
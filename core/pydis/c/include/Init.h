@@ -16,6 +16,8 @@ void   InitCellDomains(Home_t *home);
 void   InitCellNatives(Home_t *home);
 void   InitCellNeighbors(Home_t *home);
 Home_t *InitHome(void);
+void   HomeFree(Home_t *home);
+void   HomeFreeCells(Home_t *home);
 void   Initialize(Home_t *home,int argc, char *argv[]);
 int    OpenDir(Home_t *home);
 void   ParadisInit(int argc, char *argv[], Home_t **homeptr);
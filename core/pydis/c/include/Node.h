@@ -15,6 +15,16 @@
 #include "Tag.h"
 #include "ParadisThread.h"
 
+/*
+ *      All arm arrays of a node share one block of memory (see
+ *      ReallocNodeArms()) holding NODE_ARM_REALS real8 per arm: the
+ *      neighbor tag, burgers vector, arm force, glide plane and the
+ *      two sig.b vectors.  Nodes with up to NODE_INLINE_ARMS arms
+ *      use the armInline buffer inside the node structure itself.
+ */
+#define NODE_INLINE_ARMS    4
+#define NODE_ARM_REALS      16
+
 /*
  *      Define the various node 'constraints' available.  Note: these
  *      constraints are mutually exclusive.
@@ -34,6 +44,8 @@
 #define NO_COLLISIONS        0x04
 #define NO_MESH_COARSEN      0x08
 #define NODE_CHK_DBL_LINK    0x10
+#define NODE_TOPO_CHANGED    0x20  /* position or arms changed since the */
+                                   /* last HomeClearChanges()           */
 
 /*
  *      Used as bit flags to indicate the type of nodal data items
@@ -86,6 +98,12 @@ struct _node {
  */
 	int	numNbrs;
 	Tag_t	*nbrTag;
+
+	int	armCapacity;		/* number of arms the arm arrays */
+					/* can hold without reallocation */
+	real8	*armStore;		/* memory of the arm arrays, either */
+					/* armInline or a heap block        */
+	real8	armInline[NODE_INLINE_ARMS*NODE_ARM_REALS];
 #ifdef _GPU_SUBCYCLE
 	int     *armid;
 	int     *armInt;
@@ -118,6 +136,7 @@ struct _node {
 				/* constraint = 20 : cross slip(default)*/
 				/*                   2-nodes non-deletable*/
 
+	int	activeIdx;	/* position in home->activeNodes */
 	int	cellIdx;	/* cell node is currently sorted into */
 	int	cell2Idx;	/* cell2 node is currently sorted into */
 	int	cell2QentIdx;	/* Index of this node's entry in the */
@@ -132,7 +132,7 @@ void FreeAllNodes(Home_t *home);
 void RecycleAllNodes(Home_t *home);
 void ReadDataFile(Home_t *home, char *dataFile);
 void RemapArmTag(Home_t *home, Tag_t *oldTag, Tag_t *newTag);
-void Remesh(Home_t *home);
+int  Remesh(Home_t *home);
 void RemeshRule_2(Home_t *home);
 void RemeshRule_3(Home_t *home);
 void ResetGlidePlanes(Home_t *home);
@@ -172,9 +172,25 @@ void RestoreCrossSlipForce(Node_t *node, Node_t *nbr1, Node_t *nbr2,
 
 Node_t *RequestNewNativeNodeTag(Home_t *home, Tag_t *tag);
 void AddNodesFromArray(Home_t *home, real8 *buf);
+int  HomeImportArrays(Home_t *home, int numNodes, int *tags, real8 *R,
+        int *constraints, int numSegs, int *segNodes,
+        real8 *burgers, real8 *planes);
+int  HomeExportArrays(Home_t *home, int maxNodes, int *tags, real8 *R,
+        int *constraints, int maxSegs, int *numSegs,
+        int *segNodes, real8 *burgers, real8 *planes);
+int  HomeSetPositions(Home_t *home, int numNodes, int *tags, real8 *R);
+int  HomeGetPositions(Home_t *home, int numNodes, int *tags, real8 *R);
+int  HomeSetVelocities(Home_t *home, int numNodes, int *tags, real8 *V);
+int  HomeSetSegForces(Home_t *home, int numSegs, int *tags1, int *tags2,
+        real8 *fseg);
+int  HomeExportChanges(Home_t *home, int maxNodes, int *tags, real8 *R,
+        real8 *V, int *constraints, int maxSegs, int *numSegs,
+        int *segTags, real8 *burgers, real8 *planes,
+        int maxRemoved, int *numRemoved, int *removedTags);
+void HomeClearChanges(Home_t *home);
 void ReleaseMemory(Home_t *home);
 
-void ParadisInit_lean(Home_t **homeptr);
+int  ParadisInit_lean(Home_t **homeptr);
 void Initialize_lean(Home_t *home);
 #ifdef _GPU_SUBCYCLE
 #ifdef __cplusplus
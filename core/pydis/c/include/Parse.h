@@ -46,6 +46,7 @@ extern "C" int  GetParamVals(FILE *fp, int valType, int valsExpected,
                     void *valList);
 extern "C" int  LookupParam(ParamList_t *list, char *token);
 extern "C" void WriteParam(ParamList_t *list, int index, FILE *fp);
+extern "C" void ReadControlFile(Home_t *home, char *ctrlFileName);
 #else
 void BindVar(ParamList_t *list, const char *name, void *addr, int type,
          int cnt, int flags);
@@ -57,6 +58,7 @@ int  LookupParam(ParamList_t *list, char *token);
 void MarkParamDisabled(ParamList_t *CPList, char *name);
 void MarkParamEnabled(ParamList_t *CPList, char *name);
 void WriteParam(ParamList_t *list, int index, FILE *fp);
+void ReadControlFile(Home_t *home, char *ctrlFileName);
 #endif
 
 #endif  /* _PARSE_H */
@@ -0,0 +1,62 @@
+/*************************************************************************
+ *
+ *  Profile.h - per-phase wall time and event counters of the native
+ *              kernels called from the python driver
+ *
+ *  Unlike the Timer_t timers of Home_t, the profile is not kept in an
+ *  instance, so the flat-array kernels (which have no Home_t) can record
+ *  into it.  It belongs to the calling thread (THREAD_LOCAL of Error.h)
+ *  and start/stop and count calls are only made outside parallel regions.
+ *  This header is self-contained (no real8) so that it can be included
+ *  by the calforce, collision and mobility modules.
+ *
+ *  Built with PROFILE_HW_PERF (Linux perf events) or PROFILE_HW_PAPI
+ *  (see the PYDIS_HWCOUNTERS cmake option), every phase also records
+ *  the hardware counters below of the thread that starts it.
+ *
+ ************************************************************************/
+
+#ifndef _Profile_h
+#define _Profile_h
+
+enum {
+    PROFILE_FORCE = 0,
+    PROFILE_MOBILITY,
+    PROFILE_INTEGRATE,
+    PROFILE_TOPOLOGY,
+    PROFILE_COLLISION,
+    PROFILE_REMESH,
+    PROFILE_CROSS_SLIP,
+    PROFILE_NUM_PHASES  /* MUST BE LAST IN THE LIST */
+};
+
+enum {
+    PROFILE_PAIRS = 0,      /* segment pairs evaluated */
+    PROFILE_COLLISIONS,     /* collisions found */
+    PROFILE_REMESH_OPS,     /* remesh refine/coarsen operations */
+    PROFILE_NODES,          /* nodes processed */
+    PROFILE_CROSS_SLIPS,    /* segments cross-slipped */
+    PROFILE_NUM_COUNTERS    /* MUST BE LAST IN THE LIST */
+};
+
+enum {
+    PROFILE_HW_CYCLES = 0,      /* core cycles */
+    PROFILE_HW_INSTRUCTIONS,    /* instructions retired */
+    PROFILE_HW_LLC_MISSES,      /* last level cache misses */
+    PROFILE_HW_DP_OPS,          /* double precision flops */
+    PROFILE_HW_DP_VEC_OPS,      /* double precision flops in vector instructions */
+    PROFILE_NUM_HW_COUNTERS     /* MUST BE LAST IN THE LIST */
+};
+
+double ProfileWallTime(void);
+void   ProfileEnable(int enable);
+void   ProfileReset(void);
+void   ProfileStart(int phase);
+void   ProfileStop(int phase);
+void   ProfileCount(int counter, long long n);
+int    ProfileGet(double *time, int *calls, long long *counts);
+int    ProfileGetHW(long long *values);
+const char *ProfilePhaseName(int phase);
+const char *ProfileHWCounterName(int counter);
+
+#endif
@@ -102,6 +102,12 @@ int    GetFreeNodeTag(Home_t *home);
 int    GetRecycledNodeTag(Home_t *home);
 void   RecycleNodeTag(Home_t *home, int tagIdx);
 
+/*
+ *      Node key (tag index) handling functions
+ */
+void   ExtendNodeKeys(Home_t *home, int newLength);
+void   RemoveNodeKey(Home_t *home, Node_t *node);
+
 
 /*
  *      PBC Image reconciliation functions
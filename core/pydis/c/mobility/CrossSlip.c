@@ -0,0 +1,228 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "CrossSlip.h"
+#include "../calforce/SegSegForceDriver.h"
+#include "../include/Profile.h"
+
+/*
+ *      Minimum norm of a plane normal and maximum |cos| between a slip
+ *      plane normal and the Burgers vector of a plane containing it
+ */
+#define CROSSSLIP_EPS_NORMAL 1.0e-10
+#define CROSSSLIP_EPS_PLANE  1.0e-6
+
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:    CrossSlipRandom
+ *      Description: Uniform random number in [0,1) of segment seg at
+ *                   step, from a counter based generator (splitmix64
+ *                   of the seed, step and segment index).  The draws do
+ *                   not depend on the order in which the segments are
+ *                   processed, the results are the same for any number
+ *                   of threads.
+ *
+ *------------------------------------------------------------------------*/
+static real8 CrossSlipRandom(unsigned long long seed, int step, int seg)
+{
+    unsigned long long x;
+
+    x = seed ^ ((unsigned long long)(unsigned int)step << 32) ^
+        (unsigned long long)(unsigned int)seg;
+
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+
+    return((x >> 11) * (1.0 / 9007199254740992.0));
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:    GlideForce
+ *      Description: Magnitude of the glide component, in the plane with
+ *                   unit normal n, of the Peach-Koehler force fpk on a
+ *                   segment with unit line direction xi.
+ *
+ *------------------------------------------------------------------------*/
+static real8 GlideForce(real8 fpk[3], real8 xi[3], real8 n[3])
+{
+    real8 g[3];
+
+    g[0] = n[1]*xi[2] - n[2]*xi[1];
+    g[1] = n[2]*xi[0] - n[0]*xi[2];
+    g[2] = n[0]*xi[1] - n[1]*xi[0];
+
+    return(fabs(fpk[0]*g[0] + fpk[1]*g[1] + fpk[2]*g[2]));
+}
+
+
+/**************************************************************************
+ *
+ *      Function:    CrossSlipScrewSegments
+ *      Description: Cross-slip of the screw segments of a network in one
+ *                   pass over the segment arrays.  A segment is screw if
+ *                   the sine of the angle between its line direction
+ *                   and its Burgers vector is below screwSin.  For every
+ *                   screw segment the glide force of the Peach-Koehler
+ *                   force (sigma.b) x xi is resolved on its current
+ *                   plane and on the slip planes that contain b.  If the
+ *                   largest glide force on another plane exceeds
+ *                   forceRatio times the one on the current plane the
+ *                   segment moves to that plane with the given
+ *                   probability, drawn from the per segment stream of
+ *                   CrossSlipRandom().  Segments with two pinned end
+ *                   nodes do not cross-slip.  The end nodes are left in
+ *                   place: they lie on the screw line, which is common
+ *                   to both planes.  Segments are processed in parallel,
+ *                   each only writes its own entries of newPlanes and
+ *                   crossSlipped.
+ *
+ *      Arguments:
+ *         numSegs        number of segments
+ *         segNodes       [numSegs][2] indices of the end nodes
+ *         R              [numNodes][3] node positions
+ *         constraints    [numNodes] node constraints
+ *         burgers        [numSegs][3] Burgers vectors
+ *         planes         [numSegs][3] glide plane normals
+ *         segStress      [numSegs][6] stress at the segment midpoints in
+ *                        the order xx, yy, zz, xy, yz, xz
+ *         numSlipPlanes  number of slip plane normals of the crystal
+ *         slipPlanes     [numSlipPlanes][3] slip plane normals
+ *         h, hinv        3x3 cell matrix and its inverse (row-major)
+ *         isPeriodic     3 flags, non-zero for periodic directions
+ *         screwSin       screw tolerance, sine of the maximum angle
+ *                        between line direction and Burgers vector
+ *         forceRatio     ratio of the glide forces on the cross-slip and
+ *                        current planes above which a segment may
+ *                        cross-slip
+ *         probability    probability of cross-slip of a segment meeting
+ *                        the force criterion
+ *         seed, step     random stream of the call
+ *         newPlanes      [numSegs][3] returned glide plane normals, the
+ *                        plane unchanged unless the segment cross-slips
+ *         crossSlipped   [numSegs] returned 1 if the segment cross-slips
+ *
+ *      Returns:  the number of segments that cross-slip
+ *
+ *************************************************************************/
+int CrossSlipScrewSegments(int numSegs, int *segNodes, real8 *R,
+                           int *constraints, real8 *burgers, real8 *planes,
+                           real8 *segStress,
+                           int numSlipPlanes, real8 *slipPlanes,
+                           real8 *h, real8 *hinv, int *isPeriodic,
+                           real8 screwSin, real8 forceRatio,
+                           real8 probability,
+                           unsigned long long seed, int step,
+                           real8 *newPlanes, int *crossSlipped)
+{
+    int i, numCrossSlips = 0;
+
+    ProfileStart(PROFILE_CROSS_SLIP);
+
+#pragma omp parallel for schedule(static) reduction(+:numCrossSlips)
+    for (i = 0; i < numSegs; i++) {
+        int   j, k, n1, n2, best;
+        real8 bLen, len, nLen, pLen, crossSin2, fCur, fBest, fPlane;
+        real8 *s = &segStress[6*i];
+        real8 R2[3], dR[3], b[3], xi[3], n[3], p[3], sb[3], fpk[3];
+
+        n1 = segNodes[2*i];
+        n2 = segNodes[2*i+1];
+
+        for (k = 0; k < 3; k++) newPlanes[3*i+k] = planes[3*i+k];
+        crossSlipped[i] = 0;
+
+        if ((constraints[n1] == CROSSSLIP_PINNED_NODE) &&
+            (constraints[n2] == CROSSSLIP_PINNED_NODE)) continue;
+
+        PBCClosestImage(h, hinv, isPeriodic, &R[3*n1], &R[3*n2], R2);
+        for (k = 0; k < 3; k++) dR[k] = R2[k] - R[3*n1+k];
+
+        len  = sqrt(dR[0]*dR[0] + dR[1]*dR[1] + dR[2]*dR[2]);
+        bLen = sqrt(burgers[3*i]*burgers[3*i] +
+                    burgers[3*i+1]*burgers[3*i+1] +
+                    burgers[3*i+2]*burgers[3*i+2]);
+        nLen = sqrt(planes[3*i]*planes[3*i] + planes[3*i+1]*planes[3*i+1] +
+                    planes[3*i+2]*planes[3*i+2]);
+
+        if ((len <= 0.0) || (bLen <= 0.0) || (nLen < CROSSSLIP_EPS_NORMAL)) {
+            continue;
+        }
+
+        for (k = 0; k < 3; k++) {
+            xi[k] = dR[k] / len;
+            b[k]  = burgers[3*i+k] / bLen;
+            n[k]  = planes[3*i+k] / nLen;
+        }
+
+/*
+ *      Screw test: |b x xi| is the sine of the character angle
+ */
+        crossSin2 = (b[1]*xi[2] - b[2]*xi[1]) * (b[1]*xi[2] - b[2]*xi[1]) +
+                    (b[2]*xi[0] - b[0]*xi[2]) * (b[2]*xi[0] - b[0]*xi[2]) +
+                    (b[0]*xi[1] - b[1]*xi[0]) * (b[0]*xi[1] - b[1]*xi[0]);
+
+        if (crossSin2 > screwSin * screwSin) continue;
+
+/*
+ *      Peach-Koehler force per unit length, (sigma.b) x xi
+ */
+        sb[0] = s[0]*burgers[3*i] + s[3]*burgers[3*i+1] + s[5]*burgers[3*i+2];
+        sb[1] = s[3]*burgers[3*i] + s[1]*burgers[3*i+1] + s[4]*burgers[3*i+2];
+        sb[2] = s[5]*burgers[3*i] + s[4]*burgers[3*i+1] + s[2]*burgers[3*i+2];
+
+        fpk[0] = sb[1]*xi[2] - sb[2]*xi[1];
+        fpk[1] = sb[2]*xi[0] - sb[0]*xi[2];
+        fpk[2] = sb[0]*xi[1] - sb[1]*xi[0];
+
+        fCur = GlideForce(fpk, xi, n);
+
+        best  = -1;
+        fBest = 0.0;
+
+        for (j = 0; j < numSlipPlanes; j++) {
+            pLen = sqrt(slipPlanes[3*j]*slipPlanes[3*j] +
+                        slipPlanes[3*j+1]*slipPlanes[3*j+1] +
+                        slipPlanes[3*j+2]*slipPlanes[3*j+2]);
+            if (pLen < CROSSSLIP_EPS_NORMAL) continue;
+            for (k = 0; k < 3; k++) p[k] = slipPlanes[3*j+k] / pLen;
+
+/*
+ *          The plane must contain b and differ from the current plane
+ */
+            if (fabs(p[0]*b[0] + p[1]*b[1] + p[2]*b[2]) > CROSSSLIP_EPS_PLANE) {
+                continue;
+            }
+            if (fabs(fabs(p[0]*n[0] + p[1]*n[1] + p[2]*n[2]) - 1.0) <
+                CROSSSLIP_EPS_PLANE) {
+                continue;
+            }
+
+            fPlane = GlideForce(fpk, xi, p);
+            if (fPlane > fBest) {
+                fBest = fPlane;
+                best  = j;
+            }
+        }
+
+        if ((best < 0) || (fBest <= forceRatio * fCur)) continue;
+        if (CrossSlipRandom(seed, step, i) >= probability) continue;
+
+        pLen = sqrt(slipPlanes[3*best]*slipPlanes[3*best] +
+                    slipPlanes[3*best+1]*slipPlanes[3*best+1] +
+                    slipPlanes[3*best+2]*slipPlanes[3*best+2]);
+        for (k = 0; k < 3; k++) {
+            newPlanes[3*i+k] = slipPlanes[3*best+k] / pLen;
+        }
+        crossSlipped[i] = 1;
+        numCrossSlips++;
+    }
+
+    ProfileCount(PROFILE_CROSS_SLIPS, numCrossSlips);
+    ProfileStop(PROFILE_CROSS_SLIP);
+
+    return(numCrossSlips);
+}
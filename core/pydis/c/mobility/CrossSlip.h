@@ -0,0 +1,17 @@
+#include <math.h>
+#define real8 double
+
+/*
+ *      Node constraint of fixed nodes (DisNode.Constraints.PINNED_NODE)
+ */
+#define CROSSSLIP_PINNED_NODE 7
+
+int CrossSlipScrewSegments(int numSegs, int *segNodes, real8 *R,
+                           int *constraints, real8 *burgers, real8 *planes,
+                           real8 *segStress,
+                           int numSlipPlanes, real8 *slipPlanes,
+                           real8 *h, real8 *hinv, int *isPeriodic,
+                           real8 screwSin, real8 forceRatio,
+                           real8 probability,
+                           unsigned long long seed, int step,
+                           real8 *newPlanes, int *crossSlipped);
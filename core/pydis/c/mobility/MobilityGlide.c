@@ -0,0 +1,108 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "MobilityGlide.h"
+#include "../calforce/SegSegForceDriver.h"
+#include "../include/Profile.h"
+
+/**************************************************************************
+ *
+ *      Function:    MobilitySimpleGlide
+ *      Description: Velocities of all nodes for the SimpleGlide mobility
+ *                   law, same as MobilityLaw.NodeMobility_SimpleGlide()
+ *                   on the python side.  The velocity of a node is its
+ *                   force divided by half the total length of its arms,
+ *                   times mob, with the components normal to the glide
+ *                   planes of its arms removed and its magnitude capped
+ *                   at vmax.  The plane normals are orthonormalized in
+ *                   turn (Gram-Schmidt), normals within epsNormal of the
+ *                   span of the previous ones are dropped.  Pinned nodes
+ *                   and nodes without arms get a zero velocity.  Nodes
+ *                   are processed in parallel.
+ *
+ *      Arguments:
+ *         numNodes     number of nodes
+ *         R            [numNodes][3] node positions
+ *         constraints  [numNodes] node constraints
+ *         nodeForces   [numNodes][3] nodal forces
+ *         armStart     [numNodes+1] the arms of node i are armStart[i]
+ *                      to armStart[i+1]-1
+ *         armNbr       [numArms] index of the neighbor node of each arm
+ *         armPlanes    [numArms][3] glide plane normal of each arm
+ *         h, hinv      3x3 cell matrix and its inverse (row-major)
+ *         isPeriodic   3 flags, non-zero for periodic directions
+ *         mob          mobility
+ *         vmax         maximum velocity magnitude
+ *         epsNormal    minimum norm of an orthogonalized plane normal
+ *         nodeVels     [numNodes][3] returned nodal velocities
+ *
+ *************************************************************************/
+void MobilitySimpleGlide(int numNodes, real8 *R, int *constraints,
+                         real8 *nodeForces, int *armStart, int *armNbr,
+                         real8 *armPlanes,
+                         real8 *h, real8 *hinv, int *isPeriodic,
+                         real8 mob, real8 vmax, real8 epsNormal,
+                         real8 *nodeVels)
+{
+    int i;
+
+    ProfileStart(PROFILE_MOBILITY);
+    ProfileCount(PROFILE_NODES, numNodes);
+
+#pragma omp parallel for schedule(static)
+    for (i = 0; i < numNodes; i++) {
+        int   j, k, m, numNormals;
+        real8 Lsum, len, dot, vnorm;
+        real8 R2[3], dR[3], n[3], normals[3][3];
+        real8 *v = &nodeVels[3*i];
+
+        v[0] = v[1] = v[2] = 0.0;
+
+        if (constraints[i] == MOBILITY_PINNED_NODE) continue;
+
+        Lsum = 0.0;
+        for (j = armStart[i]; j < armStart[i+1]; j++) {
+            PBCClosestImage(h, hinv, isPeriodic, &R[3*i],
+                            &R[3*armNbr[j]], R2);
+            for (k = 0; k < 3; k++) dR[k] = R2[k] - R[3*i+k];
+            Lsum += sqrt(dR[0]*dR[0] + dR[1]*dR[1] + dR[2]*dR[2]);
+        }
+
+        if (Lsum <= 0.0) continue;
+
+        for (k = 0; k < 3; k++) {
+            v[k] = nodeForces[3*i+k] / (0.5 * Lsum) * mob;
+        }
+
+/*
+ *      Orthonormal basis of the glide plane normals; at most three
+ *      of them can be independent.
+ */
+        numNormals = 0;
+        for (j = armStart[i]; j < armStart[i+1] && numNormals < 3; j++) {
+            for (k = 0; k < 3; k++) n[k] = armPlanes[3*j+k];
+            for (m = 0; m < numNormals; m++) {
+                dot = n[0]*normals[m][0] + n[1]*normals[m][1] +
+                      n[2]*normals[m][2];
+                for (k = 0; k < 3; k++) n[k] -= dot * normals[m][k];
+            }
+            len = sqrt(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+            if (len < epsNormal) continue;
+            for (k = 0; k < 3; k++) normals[numNormals][k] = n[k] / len;
+            numNormals++;
+        }
+
+        for (m = 0; m < numNormals; m++) {
+            dot = v[0]*normals[m][0] + v[1]*normals[m][1] + v[2]*normals[m][2];
+            for (k = 0; k < 3; k++) v[k] -= dot * normals[m][k];
+        }
+
+        vnorm = sqrt(v[0]*v[0] + v[1]*v[1] + v[2]*v[2]);
+        if (vnorm > vmax) {
+            for (k = 0; k < 3; k++) v[k] *= vmax / vnorm;
+        }
+    }
+
+    ProfileStop(PROFILE_MOBILITY);
+
+    return;
+}
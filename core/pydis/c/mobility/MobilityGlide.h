@@ -0,0 +1,14 @@
+#include <math.h>
+#define real8 double
+
+/*
+ *      Node constraint of fixed nodes (DisNode.Constraints.PINNED_NODE)
+ */
+#define MOBILITY_PINNED_NODE 7
+
+void MobilitySimpleGlide(int numNodes, real8 *R, int *constraints,
+                         real8 *nodeForces, int *armStart, int *armNbr,
+                         real8 *armPlanes,
+                         real8 *h, real8 *hinv, int *isPeriodic,
+                         real8 mob, real8 vmax, real8 epsNormal,
+                         real8 *nodeVels);
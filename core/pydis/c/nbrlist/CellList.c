@@ -0,0 +1,363 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "CellList.h"
+#include "../calforce/SegSegForceDriver.h"
+#include "../include/Error.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/**************************************************************************
+ *
+ *      Function:    FractionalCoords
+ *      Description: Fractional coordinates s = hinv * (R - center) of
+ *                   the points, wrapped into [-0.5, 0.5) along periodic
+ *                   directions, and the range [smin, smax] spanned by
+ *                   the grid in each direction (the extent of the
+ *                   points along free directions).
+ *
+ *************************************************************************/
+static void FractionalCoords(int numPoints, real8 *R, real8 *hinv,
+                             int *isPeriodic, real8 *center,
+                             real8 *s, real8 smin[3], real8 smax[3])
+{
+    int   i, d, periodic[3];
+    real8 dr[3];
+
+    for (d = 0; d < 3; d++) {
+        periodic[d] = (isPeriodic != NULL && isPeriodic[d]);
+        smin[d] = -0.5;
+        smax[d] =  0.5;
+    }
+
+    for (i = 0; i < numPoints; i++) {
+        for (d = 0; d < 3; d++) {
+            dr[d] = R[3*i+d] - center[d];
+        }
+        for (d = 0; d < 3; d++) {
+            s[3*i+d] = hinv[3*d]*dr[0] + hinv[3*d+1]*dr[1] + hinv[3*d+2]*dr[2];
+            if (periodic[d]) s[3*i+d] -= rint(s[3*i+d]);
+        }
+    }
+
+    for (d = 0; d < 3; d++) {
+        if (periodic[d] || numPoints <= 0) continue;
+        smin[d] = smax[d] = s[d];
+        for (i = 1; i < numPoints; i++) {
+            if (s[3*i+d] < smin[d]) smin[d] = s[3*i+d];
+            if (s[3*i+d] > smax[d]) smax[d] = s[3*i+d];
+        }
+    }
+}
+
+
+/**************************************************************************
+ *
+ *      Function:    CellListBin
+ *      Description: Sort points into a regular grid of nCells[0] x
+ *                   nCells[1] x nCells[2] cells (counting sort) and
+ *                   return the cell list in compressed form: the points
+ *                   of cell c are cellPoints[cellStart[c]] ...
+ *                   cellPoints[cellStart[c+1]-1], in increasing order.
+ *                   Cells are defined in the fractional coordinates of
+ *                   the simulation cell relative to its center.  Along
+ *                   periodic directions the points are wrapped into the
+ *                   cell, along free directions the grid spans the
+ *                   extent of the points.  Cell c has the indices
+ *                   (c / (nCells[1]*nCells[2]), (c / nCells[2]) %
+ *                   nCells[1], c % nCells[2]).
+ *
+ *      Arguments:
+ *         numPoints    number of points
+ *         R            [numPoints][3] point positions
+ *         hinv         inverse of the cell matrix
+ *         isPeriodic   periodicity flags.  May be NULL.
+ *         center       center of the simulation cell
+ *         nCells       number of cells in each direction
+ *         cellStart    returned [numCells+1] offsets into cellPoints
+ *         cellPoints   returned [numPoints] point indices sorted by cell
+ *         pointCell    returned [numPoints] cell index of each point
+ *
+ *************************************************************************/
+void CellListBin(int numPoints, real8 *R,
+                 real8 *hinv, int *isPeriodic, real8 *center,
+                 int nCells[3], int *cellStart, int *cellPoints,
+                 int *pointCell)
+{
+    int   i, d, c, idx[3], numCells;
+    real8 *s, smin[3], smax[3];
+
+    numCells = nCells[0] * nCells[1] * nCells[2];
+    memset(cellStart, 0, (numCells + 1) * sizeof(int));
+
+    if (numPoints <= 0) return;
+
+    s = (real8 *)malloc(3 * numPoints * sizeof(real8));
+    if (s == NULL) {
+        ErrorRaise("CellListBin: out of memory");
+    }
+
+    FractionalCoords(numPoints, R, hinv, isPeriodic, center, s, smin, smax);
+
+    for (i = 0; i < numPoints; i++) {
+        for (d = 0; d < 3; d++) {
+            if (smax[d] > smin[d]) {
+                idx[d] = (int)floor((s[3*i+d] - smin[d]) / (smax[d] - smin[d]) * nCells[d]);
+            } else {
+                idx[d] = 0;
+            }
+            if (idx[d] < 0) idx[d] = 0;
+            if (idx[d] >= nCells[d]) idx[d] = nCells[d] - 1;
+        }
+        c = (idx[0]*nCells[1] + idx[1])*nCells[2] + idx[2];
+        pointCell[i] = c;
+        cellStart[c+1]++;
+    }
+
+    for (c = 0; c < numCells; c++) {
+        cellStart[c+1] += cellStart[c];
+    }
+
+    for (i = 0; i < numPoints; i++) {
+        cellPoints[cellStart[pointCell[i]]++] = i;
+    }
+
+/*
+ *  The fill loop advanced each offset to the start of the next cell,
+ *  shift them back.
+ */
+    for (c = numCells; c > 0; c--) {
+        cellStart[c] = cellStart[c-1];
+    }
+    cellStart[0] = 0;
+
+    free(s);
+}
+
+
+/**************************************************************************
+ *
+ *      Function:    CellListNbrs
+ *      Description: Collect (or only count if jList is NULL) the points
+ *                   j > i in the cell of point i and its neighboring
+ *                   cells.
+ *
+ *************************************************************************/
+static int CellListNbrs(int i, int nCells[3], int *isPeriodic,
+                        int *cellStart, int *cellPoints, int *pointCell,
+                        int *jList)
+{
+    int c, d, m, ix, iy, iz, numJ;
+    int cell[3], nbr[3][3], numNbr[3];
+
+    c = pointCell[i];
+    cell[0] = c / (nCells[1]*nCells[2]);
+    cell[1] = (c / nCells[2]) % nCells[1];
+    cell[2] = c % nCells[2];
+
+    for (d = 0; d < 3; d++) {
+        CellNeighborIndices(cell[d], nCells[d],
+                            isPeriodic != NULL && isPeriodic[d],
+                            nbr[d], &numNbr[d]);
+    }
+
+    numJ = 0;
+
+    for (ix = 0; ix < numNbr[0]; ix++) {
+        for (iy = 0; iy < numNbr[1]; iy++) {
+            for (iz = 0; iz < numNbr[2]; iz++) {
+                c = (nbr[0][ix]*nCells[1] + nbr[1][iy])*nCells[2] + nbr[2][iz];
+                for (m = cellStart[c]; m < cellStart[c+1]; m++) {
+                    if (cellPoints[m] <= i) continue;
+                    if (jList != NULL) jList[numJ] = cellPoints[m];
+                    numJ++;
+                }
+            }
+        }
+    }
+
+    return(numJ);
+}
+
+
+/**************************************************************************
+ *
+ *      Function:    CellListPairs
+ *      Description: Return all pairs (i, j), i < j, of points in the
+ *                   same or neighboring cells of a cell list built by
+ *                   CellListBin().  The pairs are ordered by i, so the
+ *                   list is the same for any number of threads.
+ *
+ *      Arguments:
+ *         maxPairs     size of the pairs array
+ *         pairs        returned [maxPairs][2] point index pairs.  Not
+ *                      filled if the number of pairs exceeds maxPairs.
+ *         (others)     as returned by CellListBin()
+ *
+ *      Returns:  the number of pairs
+ *
+ *************************************************************************/
+int CellListPairs(int numPoints, int nCells[3], int *isPeriodic,
+                  int *cellStart, int *cellPoints, int *pointCell,
+                  int maxPairs, int *pairs)
+{
+    int i, numPairs, *offset;
+
+    if (numPoints <= 0) return(0);
+
+    offset = (int *)malloc((numPoints + 1) * sizeof(int));
+    if (offset == NULL) {
+        ErrorRaise("CellListPairs: out of memory");
+    }
+
+    offset[0] = 0;
+
+#pragma omp parallel for schedule(dynamic, 64)
+    for (i = 0; i < numPoints; i++) {
+        offset[i+1] = CellListNbrs(i, nCells, isPeriodic, cellStart,
+                                   cellPoints, pointCell, NULL);
+    }
+
+    for (i = 0; i < numPoints; i++) {
+        offset[i+1] += offset[i];
+    }
+
+    numPairs = offset[numPoints];
+
+    if (numPairs <= maxPairs) {
+#pragma omp parallel
+        {
+            int i, m, numJ, *jList;
+
+            jList = (int *)malloc(numPoints * sizeof(int));
+
+#pragma omp for schedule(dynamic, 64)
+            for (i = 0; i < numPoints; i++) {
+                numJ = CellListNbrs(i, nCells, isPeriodic, cellStart,
+                                    cellPoints, pointCell, jList);
+                for (m = 0; m < numJ; m++) {
+                    pairs[2*(offset[i]+m)]   = i;
+                    pairs[2*(offset[i]+m)+1] = jList[m];
+                }
+            }
+
+            free(jList);
+        }
+    }
+
+    free(offset);
+
+    return(numPairs);
+}
+
+
+
+/**************************************************************************
+ *
+ *      Function:    MortonSpread
+ *      Description: Spread the low MORTON_ORDER_BITS bits of x so that
+ *                   there are two zero bits between consecutive bits.
+ *
+ *************************************************************************/
+static unsigned long long MortonSpread(unsigned long long x)
+{
+    x &= 0x1fffffULL;
+    x = (x | (x << 32)) & 0x1f00000000ffffULL;
+    x = (x | (x << 16)) & 0x1f0000ff0000ffULL;
+    x = (x | (x <<  8)) & 0x100f00f00f00f00fULL;
+    x = (x | (x <<  4)) & 0x10c30c30c30c30c3ULL;
+    x = (x | (x <<  2)) & 0x1249249249249249ULL;
+    return(x);
+}
+
+
+typedef struct {
+    unsigned long long key;
+    int                index;
+} MortonKey_t;
+
+
+static int MortonKeyCmp(const void *a, const void *b)
+{
+    const MortonKey_t *ka = (const MortonKey_t *)a;
+    const MortonKey_t *kb = (const MortonKey_t *)b;
+
+    if (ka->key < kb->key) return(-1);
+    if (ka->key > kb->key) return(1);
+    return(ka->index - kb->index);
+}
+
+
+/**************************************************************************
+ *
+ *      Function:    MortonOrder
+ *      Description: Return the permutation that sorts points along a
+ *                   Morton (Z-order) space-filling curve.  Each
+ *                   fractional coordinate (see CellListBin()) is
+ *                   quantized to MORTON_ORDER_BITS bits and the bits of
+ *                   the three directions are interleaved into a 64-bit
+ *                   key.  Points with equal keys keep their original
+ *                   order, so the permutation is deterministic.
+ *
+ *      Arguments:
+ *         numPoints    number of points
+ *         R            [numPoints][3] point positions
+ *         hinv         inverse of the cell matrix
+ *         isPeriodic   periodicity flags.  May be NULL.
+ *         center       center of the simulation cell
+ *         order        returned [numPoints] point indices in Morton
+ *                      order
+ *
+ *************************************************************************/
+void MortonOrder(int numPoints, real8 *R,
+                 real8 *hinv, int *isPeriodic, real8 *center,
+                 int *order)
+{
+    int         i;
+    real8       *s, smin[3], smax[3];
+    MortonKey_t *keys;
+
+    if (numPoints <= 0) return;
+
+    s = (real8 *)malloc(3 * numPoints * sizeof(real8));
+    keys = (MortonKey_t *)malloc(numPoints * sizeof(MortonKey_t));
+    if (s == NULL || keys == NULL) {
+        free(s);
+        free(keys);
+        ErrorRaise("MortonOrder: out of memory");
+    }
+
+    FractionalCoords(numPoints, R, hinv, isPeriodic, center, s, smin, smax);
+
+#pragma omp parallel for
+    for (i = 0; i < numPoints; i++) {
+        int   d;
+        long  q;
+        real8 maxQ = (real8)((1L << MORTON_ORDER_BITS) - 1);
+        unsigned long long key = 0;
+
+        for (d = 0; d < 3; d++) {
+            q = 0;
+            if (smax[d] > smin[d]) {
+                q = (long)floor((s[3*i+d] - smin[d]) / (smax[d] - smin[d]) * maxQ);
+            }
+            if (q < 0) q = 0;
+            if (q > (long)maxQ) q = (long)maxQ;
+            key |= MortonSpread((unsigned long long)q) << d;
+        }
+
+        keys[i].key = key;
+        keys[i].index = i;
+    }
+
+    qsort(keys, numPoints, sizeof(MortonKey_t), MortonKeyCmp);
+
+    for (i = 0; i < numPoints; i++) {
+        order[i] = keys[i].index;
+    }
+
+    free(keys);
+    free(s);
+}
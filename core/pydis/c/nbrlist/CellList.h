@@ -0,0 +1,21 @@
+#include <math.h>
+#define real8 double
+
+/*
+ *      Number of bits per direction of the Morton keys computed by
+ *      MortonOrder(), 3 x 21 bits fit in a 64-bit key.
+ */
+#define MORTON_ORDER_BITS 21
+
+void CellListBin(int numPoints, real8 *R,
+                 real8 *hinv, int *isPeriodic, real8 *center,
+                 int nCells[3], int *cellStart, int *cellPoints,
+                 int *pointCell);
+
+int  CellListPairs(int numPoints, int nCells[3], int *isPeriodic,
+                   int *cellStart, int *cellPoints, int *pointCell,
+                   int maxPairs, int *pairs);
+
+void MortonOrder(int numPoints, real8 *R,
+                 real8 *hinv, int *isPeriodic, real8 *center,
+                 int *order);
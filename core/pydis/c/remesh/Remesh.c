@@ -7,10 +7,16 @@
  *                      proper remesh version.
  *
  *      Included functions:
+ *              AddSegCoreForce()
+ *              AddSegPairForce()
  *              CutSurfaceSegments()
  *              EstCoarsenForces()
  *              EstRefinementForces()
+ *              FindFSegComb()
+ *              FindSubFSeg()
  *              Remesh()
+ *              SegCoreDeltasOK()
+ *              SegForceDeltasOK()
  *
  *****************************************************************************/
 #include <stdio.h>
@@ -20,11 +26,298 @@
 #include "Home.h"
 #include "Comm.h"
 #include "Topology.h"
+#include "Profile.h"
+#include "Error.h"
 
 #ifdef PARALLEL
 #include "mpi.h"
 #endif
 
+/*-------------------------------------------------------------------------
+ *
+ *      Function:       SegForceDeltasOK
+ *      Description:    The cached arm forces are reused by the force
+ *                      estimates of remesh, with only the contribution of
+ *                      the segments being modified re-evaluated.  That
+ *                      contribution is the elastic interaction, so it is
+ *                      only corrected for if the interaction is enabled
+ *                      and a core radius is set.
+ *
+ *-------------------------------------------------------------------------*/
+static int SegForceDeltasOK(Param_t *param)
+{
+        return(param->elasticinteraction && (param->rc > 0.0));
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:       SegCoreDeltasOK
+ *      Description:    Without the elastic interaction the cached arm
+ *                      forces are line tension forces (LineTensionForce()
+ *                      with Ec = param->Ecore).  Their core term does not
+ *                      scale with the segment length, so it is taken out
+ *                      of the cached forces of the segments being modified
+ *                      and added back for the new segments as well.  With
+ *                      the elastic interaction the forces have no core
+ *                      term (NodeStep.c).
+ *
+ *-------------------------------------------------------------------------*/
+static int SegCoreDeltasOK(Param_t *param)
+{
+        return(!param->elasticinteraction && (param->Ecore != 0.0));
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:       AddSegCoreForce
+ *      Description:    Add <sign> times the core (line tension) force of
+ *                      the segment p1-->p2 to the forces at its end points:
+ *                          fs2 = 2 NU/(1-NU) Ec bs be - (bs^2 + be^2/(1-NU)) Ec t
+ *                      at p2 and -fs2 at p1, as in LineTensionForce().
+ *                      Segments shorter than 1.0e-6 have no core force.
+ *
+ *      Arguments
+ *          p1, p2   end points of the segment (periodic image of p2
+ *                   already resolved)
+ *          b12      burgers vector of the segment
+ *          f1, f2   forces at p1, p2 to which the core force is added
+ *
+ *-------------------------------------------------------------------------*/
+static void AddSegCoreForce(Param_t *param, real8 sign,
+                            real8 p1[3], real8 p2[3], real8 b12[3],
+                            real8 f1[3], real8 f2[3])
+{
+        int   i;
+        real8 L, bs, be2, omninv, Score, LTcore;
+        real8 t[3], bev[3], fs;
+
+        for (i = 0; i < 3; i++) {
+            t[i] = p2[i] - p1[i];
+        }
+
+        L = sqrt(DotProduct(t, t));
+
+        if (L < 1.0e-6) {
+            return;
+        }
+
+        for (i = 0; i < 3; i++) {
+            t[i] /= L;
+        }
+
+        bs = DotProduct(b12, t);
+
+        for (i = 0; i < 3; i++) {
+            bev[i] = b12[i] - bs * t[i];
+        }
+
+        be2 = DotProduct(bev, bev);
+        omninv = 1.0 / (1.0 - param->pois);
+        Score  = 2.0 * param->pois * omninv * param->Ecore * bs;
+        LTcore = (bs * bs + be2 * omninv) * param->Ecore;
+
+        for (i = 0; i < 3; i++) {
+            fs = Score * bev[i] - LTcore * t[i];
+            f1[i] -= sign * fs;
+            f2[i] += sign * fs;
+        }
+
+        return;
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:       AddSegPairForce
+ *      Description:    Add <sign> times the elastic interaction of the
+ *                      segments p1-->p2 and p3-->p4 to the forces at
+ *                      their end points.  With p3-->p4 the same segment
+ *                      as p1-->p2, this is the segment's self force and
+ *                      f3, f4 are not used.
+ *
+ *      Arguments
+ *          p1, p2   end points of the first segment
+ *          b12      burgers vector of the first segment
+ *          p3, p4   end points of the second segment (periodic images
+ *                   already resolved)
+ *          b34      burgers vector of the second segment
+ *          f1..f4   forces at p1..p4 to which the interaction is added.
+ *                   f3, f4 may be NULL for a self force.
+ *
+ *-------------------------------------------------------------------------*/
+static void AddSegPairForce(Param_t *param, real8 sign,
+                            real8 p1[3], real8 p2[3], real8 b12[3],
+                            real8 p3[3], real8 p4[3], real8 b34[3],
+                            real8 f1[3], real8 f2[3], real8 *f3, real8 *f4)
+{
+        int   i;
+        real8 fp1[3], fp2[3], fp3[3], fp4[3];
+
+        SegSegForce(p1[X], p1[Y], p1[Z], p2[X], p2[Y], p2[Z],
+                    p3[X], p3[Y], p3[Z], p4[X], p4[Y], p4[Z],
+                    b12[X], b12[Y], b12[Z], b34[X], b34[Y], b34[Z],
+                    param->rc, param->shearModulus, param->pois, 1, 1,
+                    &fp1[X], &fp1[Y], &fp1[Z], &fp2[X], &fp2[Y], &fp2[Z],
+                    &fp3[X], &fp3[Y], &fp3[Z], &fp4[X], &fp4[Y], &fp4[Z]);
+
+        for (i = 0; i < 3; i++) {
+            f1[i] += sign * fp1[i];
+            f2[i] += sign * fp2[i];
+            if (f3 != (real8 *)NULL) f3[i] += sign * fp3[i];
+            if (f4 != (real8 *)NULL) f4[i] += sign * fp4[i];
+        }
+
+        return;
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:       FindSubFSeg
+ *      Description:    Given a segment p1-->p2 and the force at each endpoint
+ *                      of the segment, estimate the resulting forces on the
+ *                      segment pair created by bisecting p1-->p2 at newpos.
+ *
+ *                      The force per unit length is taken to vary linearly
+ *                      along the segment, with the end values for which
+ *                      the linear shape functions give back oldfp1 and
+ *                      oldfp2.  The four sub-segment forces add up to
+ *                      oldfp1 + oldfp2.
+ *
+ *      Arguments
+ *          p1       Coordinates of point 1
+ *          p2       Coordinates of point 2 (corresponding to the periodic
+ *                   image of p2 closest to point p1)
+ *          burg     burgers vector from p1 to p2
+ *          oldfp1   force of segment p1-->p2 at point p1
+ *          oldfp2   force of segment p1-->p2 at point p2
+ *          newpos   coordinates of position along the p1-->p2
+ *                   segment at which a new node is to be added.
+ *          f0seg1   Resulting forces at p1 on the p1-->newpos segment
+ *          f1seg1   Resulting forces at newpos on the p1-->newpos segment
+ *          f0seg2   Resulting forces at newpos on the newpos-->p2 segment
+ *          f1seg2   Resulting forces at p2 on the newpos-->p2 segment
+ *
+ *-------------------------------------------------------------------------*/
+void FindSubFSeg(Home_t *home, real8 p1[3], real8 p2[3], real8 burg[3],
+                 real8 oldfp1[3], real8 oldfp2[3], real8 newpos[3],
+                 real8 f0seg1[3], real8 f1seg1[3], real8 f0seg2[3],
+                 real8 f1seg2[3])
+{
+        int   i;
+        real8 t, len2, g0, g1, gt, h0, h1;
+        real8 seg[3], dpos[3];
+
+/*
+ *      The burgers vector is kept for the ParaDiS interface, the force
+ *      distribution along the segment does not depend on it.
+ */
+        (void)burg;
+
+        for (i = 0; i < 3; i++) {
+            seg[i]  = p2[i] - p1[i];
+            dpos[i] = newpos[i] - p1[i];
+        }
+
+        ZImage(home->param, &dpos[X], &dpos[Y], &dpos[Z]);
+
+        len2 = DotProduct(seg, seg);
+        t = (len2 > 0.0) ? DotProduct(dpos, seg) / len2 : 0.5;
+        t = MIN(MAX(t, 0.0), 1.0);
+
+/*
+ *      g0, g1 are the end values of the force per unit of the segment
+ *      parameter: oldfp1 = g0/3 + g1/6 and oldfp2 = g0/6 + g1/3.  Each
+ *      sub-segment sees a linear distribution (h0, h1) scaled by its
+ *      share of the segment.
+ */
+        for (i = 0; i < 3; i++) {
+            g0 = 4.0 * oldfp1[i] - 2.0 * oldfp2[i];
+            g1 = 4.0 * oldfp2[i] - 2.0 * oldfp1[i];
+            gt = g0 + t * (g1 - g0);
+
+            h0 = t * g0;
+            h1 = t * gt;
+            f0seg1[i] = h0 / 3.0 + h1 / 6.0;
+            f1seg1[i] = h0 / 6.0 + h1 / 3.0;
+
+            h0 = (1.0 - t) * gt;
+            h1 = (1.0 - t) * g1;
+            f0seg2[i] = h0 / 3.0 + h1 / 6.0;
+            f1seg2[i] = h0 / 6.0 + h1 / 3.0;
+        }
+
+        return;
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:       FindFSegComb
+ *      Description:    Estimate the forces at the ends of the segment
+ *                      p0-->p2 that replaces the segments p0-->p1 and
+ *                      p1-->p2 when the node at p1 is removed.
+ *
+ *                      The force distribution of the two segments is
+ *                      kept and integrated against the shape functions
+ *                      of the combined segment, parametrized by the
+ *                      length along the two segments: the forces at p1
+ *                      are shared between p0 and p2 in proportion to
+ *                      the distance of p1 from the other end.  The
+ *                      burgers vectors are not needed for this.
+ *
+ *      Arguments
+ *          p0       Coordinates of point 0
+ *          p1       Coordinates of point 1 (corresponding to the periodic
+ *                   image of p1 closest to point p0)
+ *          p2       Coordinates of point 2 (corresponding to the periodic
+ *                   image of p2 closest to point p1)
+ *          burg1    burgers vector from p0 to p1
+ *          burg2    burgers vector from p1 to p2
+ *          fp0seg1  force of segment p0-->p1 at point p0
+ *          fp1seg1  force of segment p0-->p1 at point p1
+ *          fp1seg2  force of segment p1-->p2 at point p1
+ *          fp2seg2  force of segment p1-->p2 at point p2
+ *          f0new    resulting force at p0 from the segment p0-->p2
+ *          f1new    resulting force at p2 from the segment p0-->p2
+ *
+ *-------------------------------------------------------------------------*/
+void FindFSegComb(Home_t *home, real8 p0[3], real8 p1[3], real8 p2[3],
+                  real8 burg1[3], real8 burg2[3], real8 fp0seg1[3],
+                  real8 fp1seg1[3], real8 fp1seg2[3], real8 fp2seg2[3],
+                  real8 f0new[3], real8 f1new[3])
+{
+        int   i;
+        real8 len1, len2, w1;
+        real8 v1[3], v2[3];
+
+/*
+ *      <home> and the burgers vectors are kept for the ParaDiS interface.
+ */
+        (void)home;
+        (void)burg1;
+        (void)burg2;
+
+        for (i = 0; i < 3; i++) {
+            v1[i] = p1[i] - p0[i];
+            v2[i] = p2[i] - p1[i];
+        }
+
+        len1 = sqrt(DotProduct(v1, v1));
+        len2 = sqrt(DotProduct(v2, v2));
+        w1 = (len1 + len2 > 0.0) ? len1 / (len1 + len2) : 0.5;
+
+        for (i = 0; i < 3; i++) {
+            f0new[i] = fp0seg1[i] + (1.0 - w1) * (fp1seg1[i] + fp1seg2[i]);
+            f1new[i] = fp2seg2[i] + w1 * (fp1seg1[i] + fp1seg2[i]);
+        }
+
+        return;
+}
+
+
 /*-------------------------------------------------------------------------
  *
  *      Function:    EstRefineMentForces
@@ -32,6 +325,16 @@
  *                   when an existing segment is split during
  *                   mesh refinement.
  *
+ *                   The arm forces of the last force pass are reused:
+ *                   the self force of the original segment is taken out
+ *                   of them before they are distributed over the two
+ *                   new segments, and the self forces of the new
+ *                   segments and their mutual interaction are added
+ *                   back.  The interactions with all other segments
+ *                   are not re-evaluated.  Likewise the line tension
+ *                   core force is replaced by that of the new segments
+ *                   (see SegCoreDeltasOK()).
+ *
  *      Arguments:
  *          node1    pointer to first endpoint of the original segment
  *          node2    pointer to second endpoint of the original segment
@@ -57,8 +360,8 @@ void EstRefinementForces(Home_t *home, Node_t *node1, Node_t *node2,
                          real8 f0Seg1[3], real8 f1Seg1[3],
                          real8 f0Seg2[3], real8 f1Seg2[3])
 {
-        int     arm12, arm21;
-        real8   p1[3], p2[3], oldfp1[3], oldfp2[3], burg[3];
+        int     arm12, arm21, deltas, core;
+        real8   p1[3], p2[3], pm[3], oldfp1[3], oldfp2[3], burg[3];
 
         arm12 = GetArmID(home, node1, node2);
         arm21 = GetArmID(home, node2, node1);
@@ -83,9 +386,43 @@ void EstRefinementForces(Home_t *home, Node_t *node1, Node_t *node2,
         p2[Y] = p1[Y] + vec[Y];
         p2[Z] = p1[Z] + vec[Z];
 
+        deltas = SegForceDeltasOK(home->param);
+        core = SegCoreDeltasOK(home->param);
+
+        if (deltas) {
+            AddSegPairForce(home->param, -1.0, p1, p2, burg, p1, p2, burg,
+                            oldfp1, oldfp2, (real8 *)NULL, (real8 *)NULL);
+        }
+
+        if (core) {
+            AddSegCoreForce(home->param, -1.0, p1, p2, burg, oldfp1, oldfp2);
+        }
+
         FindSubFSeg(home, p1, p2, burg, oldfp1, oldfp2, newPos, f0Seg1,
                     f1Seg1, f0Seg2, f1Seg2);
 
+        pm[X] = newPos[X] - p1[X];
+        pm[Y] = newPos[Y] - p1[Y];
+        pm[Z] = newPos[Z] - p1[Z];
+        ZImage(home->param, &pm[X], &pm[Y], &pm[Z]);
+        pm[X] += p1[X];
+        pm[Y] += p1[Y];
+        pm[Z] += p1[Z];
+
+        if (core) {
+            AddSegCoreForce(home->param, 1.0, p1, pm, burg, f0Seg1, f1Seg1);
+            AddSegCoreForce(home->param, 1.0, pm, p2, burg, f0Seg2, f1Seg2);
+        }
+
+        if (deltas) {
+            AddSegPairForce(home->param, 1.0, p1, pm, burg, p1, pm, burg,
+                            f0Seg1, f1Seg1, (real8 *)NULL, (real8 *)NULL);
+            AddSegPairForce(home->param, 1.0, pm, p2, burg, pm, p2, burg,
+                            f0Seg2, f1Seg2, (real8 *)NULL, (real8 *)NULL);
+            AddSegPairForce(home->param, 1.0, p1, pm, burg, pm, p2, burg,
+                            f0Seg1, f1Seg1, f0Seg2, f1Seg2);
+        }
+
         return;
 }
 
@@ -97,6 +434,13 @@ void EstRefinementForces(Home_t *home, Node_t *node1, Node_t *node2,
  *                   when an existing discretization node is removed
  *                   during mesh coarsening.
  *
+ *                   As for EstRefinementForces(), the cached arm forces
+ *                   are reused: the self forces of the two removed
+ *                   segments and their mutual interaction are taken out
+ *                   before the forces are combined, and the self force
+ *                   of the new segment is added back.  The line tension
+ *                   core forces are replaced in the same way.
+ *
  *      Arguments:
  *          node1    pointer to first neighbor of node to be coarsened
  *          node2    pointer to node to be coarsened out
@@ -110,7 +454,7 @@ void EstRefinementForces(Home_t *home, Node_t *node1, Node_t *node2,
 void EstCoarsenForces(Home_t *home, Node_t *node1, Node_t *node2,
                       Node_t *node3, real8 f0Seg[3], real8 f1Seg[3])
 {
-        int     i, arm21, arm23, arm12, arm32;
+        int     i, arm21, arm23, arm12, arm32, deltas, core;
         real8   burg1[3], burg2[3];
         real8   p1[3], p2[3], p3[3];
         real8   fp0[3], fp1[3], fp2[3], fp3[3];
@@ -194,8 +538,34 @@ void EstCoarsenForces(Home_t *home, Node_t *node1, Node_t *node2,
             f1Seg[Y] = node2->armfy[arm21];
             f1Seg[Z] = node2->armfz[arm21];
         } else {
+            deltas = SegForceDeltasOK(param);
+            core = SegCoreDeltasOK(param);
+
+            if (deltas) {
+                AddSegPairForce(param, -1.0, p1, p2, burg1, p1, p2, burg1,
+                                fp0, fp1, (real8 *)NULL, (real8 *)NULL);
+                AddSegPairForce(param, -1.0, p2, p3, burg2, p2, p3, burg2,
+                                fp2, fp3, (real8 *)NULL, (real8 *)NULL);
+                AddSegPairForce(param, -1.0, p1, p2, burg1, p2, p3, burg2,
+                                fp0, fp1, fp2, fp3);
+            }
+
+            if (core) {
+                AddSegCoreForce(param, -1.0, p1, p2, burg1, fp0, fp1);
+                AddSegCoreForce(param, -1.0, p2, p3, burg2, fp2, fp3);
+            }
+
             FindFSegComb(home, p1, p2, p3, burg1, burg2,
                          fp0, fp1, fp2, fp3, f0Seg, f1Seg);
+
+            if (deltas) {
+                AddSegPairForce(param, 1.0, p1, p3, burg1, p1, p3, burg1,
+                                f0Seg, f1Seg, (real8 *)NULL, (real8 *)NULL);
+            }
+
+            if (core) {
+                AddSegCoreForce(param, 1.0, p1, p3, burg1, f0Seg, f1Seg);
+            }
         }
 
         return;
@@ -291,7 +661,6 @@ static void CutSurfaceSegments(Home_t *home)
 }
 #endif
 
-#if 0
 /*-------------------------------------------------------------------------
  *
  *      Function:       Remesh
@@ -299,16 +668,27 @@ static void CutSurfaceSegments(Home_t *home)
  *                      for a remesh operation then select and execute
  *                      the proper remesh function.
  *
+ *      Returns:  0 on success, -1 on error (see ErrorMessage()), after
+ *                which home is left inconsistent and should be freed
+ *
  *-----------------------------------------------------------------------*/
-void Remesh(Home_t *home)
+int Remesh(Home_t *home)
 {
-        int     i;
-        Node_t  *node;
-        Param_t *param;
+        int         i;
+        Node_t      *node;
+        Param_t     *param;
+        ErrorTrap_t trap;
 
         param = home->param;
 
-        if (param->remeshRule < 0) return;
+        if (param->remeshRule < 0) return(0);
+
+        ErrorTrapPush(&trap);
+        if (setjmp(trap.env) != 0) {
+            ProfileStop(PROFILE_REMESH);
+            home->timers[REMESH].started = 0;
+            return(-1);
+        }
 
 #ifdef PARALLEL
 #ifdef SYNC_TIMERS
@@ -319,6 +699,7 @@ void Remesh(Home_t *home)
 #endif
 
         TimerStart(home, REMESH);
+        ProfileStart(PROFILE_REMESH);
         ClearOpList(home);
         InitTopologyExemptions(home);
 
@@ -326,13 +707,11 @@ void Remesh(Home_t *home)
         case 2:
             RemeshRule_2(home);
             break;
-        case 3:
-            RemeshRule_3(home);
-            break;
         default:
             Fatal("Remesh: undefined remesh rule %d", param->remeshRule);
             break;
         }
+        ProfileStop(PROFILE_REMESH);
         TimerStop(home, REMESH);
 
 #ifdef _FEM
@@ -353,6 +732,7 @@ void Remesh(Home_t *home)
  *      etc) that may affect nodes in remote domains, and process
  *      the remesh operations from the neighboring domains
  */
+#ifdef PARALLEL
         TimerStart(home, SEND_REMESH);
         CommSendRemesh(home);
         TimerStop(home, SEND_REMESH);
@@ -360,6 +740,7 @@ void Remesh(Home_t *home)
         TimerStart(home, FIX_REMESH);
         FixRemesh(home);
         TimerStop(home, FIX_REMESH);
+#endif
 
 /*
  *      Under certain circumstances, parallel topological changes
@@ -403,6 +784,7 @@ void Remesh(Home_t *home)
         ParadisMemCheck();
 #endif
 
-        return;
+        ErrorTrapPop(&trap);
+
+        return(0);
 }
-#endif
@@ -0,0 +1,29 @@
+#include <stdlib.h>
+#include "RemeshParallel.h"
+
+/*---------------------------------------------------------------------------
+ *
+ *      Function:       RemeshParallelFor
+ *      Description:    Call workFunc(context, item) for every item in
+ *                      [0, numItems), distributed over the OpenMP
+ *                      threads.  The items of a round are independent,
+ *                      so the order in which they run does not matter.
+ *
+ *      Arguments:
+ *          numItems   Number of work items
+ *          workFunc   Function processing one item
+ *          context    Caller data passed to workFunc
+ *
+ *-------------------------------------------------------------------------*/
+void RemeshParallelFor(int numItems, RemeshWorkFunc_t workFunc,
+                       void *context)
+{
+        int item;
+
+#pragma omp parallel for schedule(dynamic, 16) if (numItems > 32)
+        for (item = 0; item < numItems; item++) {
+            workFunc(context, item);
+        }
+
+        return;
+}
@@ -0,0 +1,9 @@
+/*
+ *      Parallel loop over the work items of one remesh round.  Kept out
+ *      of the Home.h sources: it is the only remesh source built with
+ *      OpenMP, and the work functions it calls must be thread safe.
+ */
+typedef void (*RemeshWorkFunc_t)(void *context, int item);
+
+void RemeshParallelFor(int numItems, RemeshWorkFunc_t workFunc,
+                       void *context);
@@ -4,6 +4,13 @@
  *      Description:    This module contains functions to coarsen
  *                      or refine the mesh topology.
  *                      
+ *                      Candidates are handled in rounds: the nodes
+ *                      selected in a round have disjoint neighborhoods,
+ *                      the force estimates of a round are computed in
+ *                      parallel and the topology changes are then
+ *                      committed serially in node index order, so the
+ *                      result does not depend on the number of threads.
+ *
  *      Included functions:
  *              MeshCoarsen()
  *              MeshRefine()
@@ -18,21 +25,190 @@
 #include "Util.h"
 #include "QueueOps.h"
 #include "Mobility.h"
+#include "RemeshParallel.h"
+#include "Profile.h"
+
+/*
+ *      Domain whose topology changes are traced (all if negative)
+ */
+#ifdef DEBUG_TOPOLOGY_DOMAIN
+#define dbgDom DEBUG_TOPOLOGY_DOMAIN
+#else
+#define dbgDom (-1)
+#endif
+
 
-static int dbgDom;
+/*
+ *      Scheduling state of one MeshCoarsen() or MeshRefine() call,
+ *      indexed by node tag index: the round in which the node was claimed
+ *      by a candidate, whether the node has already been evaluated, and
+ *      whether its forces were only estimated (flagged NODE_RESET_FORCES
+ *      when the call started, or created during the call).
+ */
+typedef struct {
+        int *claim;
+        int *done;
+        int *stale;
+        int size;
+        int round;
+} RemeshSchedule_t;
+
+/*
+ *      Work items of a round, filled in serially at selection and
+ *      completed by the parallel force estimates.
+ */
+typedef struct {
+        Node_t *node, *nbr1, *nbr2;
+        real8  f0seg1[3], f1seg1[3];
+} CoarsenItem_t;
+
+typedef struct {
+        Node_t *node, *nbr;
+        real8  vec[3], newPos[3];
+        real8  f0seg1[3], f1seg1[3], f0seg2[3], f1seg2[3];
+} RefineItem_t;
+
+typedef struct {
+        Home_t *home;
+        void   *items;
+} RemeshRound_t;
 
 
 /*-------------------------------------------------------------------------
  *
- *      Function:    MeshCoarsen
- *      Description: 
+ *      Function:    ScheduleUpdate
+ *      Description: Extend the schedule arrays to all current node tag
+ *                   indices.  New entries are unclaimed and not done.
  *
  *------------------------------------------------------------------------*/
-static void MeshCoarsen(Home_t *home)
+static void ScheduleUpdate(Home_t *home, RemeshSchedule_t *sched)
+{
+        int i, newSize;
+
+        newSize = home->newNodeKeyPtr;
+        if (newSize <= sched->size) return;
+
+        sched->claim = (int *)realloc(sched->claim, newSize * sizeof(int));
+        sched->done  = (int *)realloc(sched->done,  newSize * sizeof(int));
+        sched->stale = (int *)realloc(sched->stale, newSize * sizeof(int));
+
+        if ((sched->claim == (int *)NULL) || (sched->done == (int *)NULL) ||
+            (sched->stale == (int *)NULL)) {
+            Fatal("ScheduleUpdate: out of memory (%d nodes)", newSize);
+        }
+
+        for (i = sched->size; i < newSize; i++) {
+            sched->claim[i] = 0;
+            sched->done[i]  = 0;
+            sched->stale[i] = (home->nodeKeys[i] == (Node_t *)NULL) ||
+                              ((home->nodeKeys[i]->flags &
+                                NODE_RESET_FORCES) != 0);
+        }
+
+        sched->size = newSize;
+
+        return;
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:    NeighborhoodClaimed
+ *      Description: Check whether a node or any of its local neighbors
+ *                   has been claimed in the current round.
+ *
+ *------------------------------------------------------------------------*/
+static int NeighborhoodClaimed(Home_t *home, RemeshSchedule_t *sched,
+                               Node_t *node)
+{
+        int arm, index;
+
+        if (sched->claim[node->myTag.index] == sched->round) return(1);
+
+        for (arm = 0; arm < node->numNbrs; arm++) {
+            if (node->nbrTag[arm].domainID != home->myDomain) continue;
+            index = node->nbrTag[arm].index;
+            if ((index < sched->size) && (sched->claim[index] == sched->round)) {
+                return(1);
+            }
+        }
+
+        return(0);
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:    ForcesStale
+ *      Description: Check whether the forces of a node are estimates:
+ *                   the node was flagged NODE_RESET_FORCES when the
+ *                   current pass started or was created during it.  The
+ *                   flags set by the bisections of earlier rounds are
+ *                   not used, as these leave the forces of the other
+ *                   segments of the nodes unchanged.
+ *
+ *------------------------------------------------------------------------*/
+static int ForcesStale(Home_t *home, RemeshSchedule_t *sched, Node_t *node)
+{
+        if ((node->myTag.domainID != home->myDomain) ||
+            (node->myTag.index >= sched->size)) {
+            return((node->flags & NODE_RESET_FORCES) != 0);
+        }
+
+        return(sched->stale[node->myTag.index]);
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:    ClaimNeighborhoods
+ *      Description: Claim the listed nodes and all their local neighbors
+ *                   for the current round, unless any of them has
+ *                   already been claimed.
+ *
+ *      Returns:  1 if the nodes were claimed, 0 if not
+ *
+ *------------------------------------------------------------------------*/
+static int ClaimNeighborhoods(Home_t *home, RemeshSchedule_t *sched,
+                              Node_t **nodes, int numNodes)
+{
+        int i, arm, index;
+
+        for (i = 0; i < numNodes; i++) {
+            if (NeighborhoodClaimed(home, sched, nodes[i])) return(0);
+        }
+
+        for (i = 0; i < numNodes; i++) {
+            sched->claim[nodes[i]->myTag.index] = sched->round;
+            for (arm = 0; arm < nodes[i]->numNbrs; arm++) {
+                if (nodes[i]->nbrTag[arm].domainID != home->myDomain) continue;
+                index = nodes[i]->nbrTag[arm].index;
+                if (index < sched->size) sched->claim[index] = sched->round;
+            }
+        }
+
+        return(1);
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:    CoarsenCandidate
+ *      Description: Determine whether a node should be coarsened out.
+ *
+ *      Arguments:
+ *          node      node to evaluate
+ *          nbr1Ptr,
+ *          nbr2Ptr   locations in which to return the two neighbors
+ *                    of <node> if it should be coarsened out
+ *
+ *      Returns:  1 if the node should be removed, 0 if not
+ *
+ *------------------------------------------------------------------------*/
+static int CoarsenCandidate(Home_t *home, Node_t *node, Node_t **nbr1Ptr,
+                            Node_t **nbr2Ptr)
 {
-        int     i, q, thisDomain, mergeDone, mergeStatus, globalOp;
-        int     localCoarsenCnt, globalCoarsenCnt, hasRemoteNbr;
-        real8   tmpMag2;
+        int     thisDomain, hasRemoteNbr;
         real8   cellLength, cutoffLength1, cutoffLength2;
         real8   vec1x, vec1y, vec1z;
         real8   vec2x, vec2y, vec2z;
@@ -43,10 +219,8 @@ static void MeshCoarsen(Home_t *home)
         real8   dvec2xdt, dvec2ydt, dvec2zdt;
         real8   dvec3xdt, dvec3ydt, dvec3zdt;
         real8   dr1dt, dr2dt, dr3dt, dsdt, darea2dt;
-        real8   newPos[3], f0seg1[3], f1seg1[3];
         real8   gp0[3], gp1[3], tmp3[3];
-        Tag_t   nbr1Tag, nbr2Tag, oldTag1, oldTag2, oldTag3;
-        Node_t  *node, *nbr, *nbr1, *nbr2, *mergedNode;
+        Node_t  *nbr1, *nbr2;
         Param_t *param;
 
         thisDomain = home->myDomain;
@@ -63,50 +237,39 @@ static void MeshCoarsen(Home_t *home)
         areaMin2   = areaMin * areaMin;
         delta      = 1.0e-16;
 
-        localCoarsenCnt = 0;
-        globalCoarsenCnt = 0;
-/*
- *      Loop through all the nodes native to this domain looking for
- *      nodes that should be coarsened out.
- */
-        for (i = 0; i < home->newNodeKeyPtr; i++) {
-        
-            node = home->nodeKeys[i];
-            if (node == (Node_t *)NULL) continue;
-        
 /*
- *          Check for various conditions that will exempt a node from removal:
+ *      Check for various conditions that will exempt a node from removal:
  *
- *          1) does not have exactly 2 arms
- *          2) node is a 'fixed' node
- *          3) node is flagged as exempt from coarsen operations
- *          4) current domain does not 'own' at least one of the  segments
- *          5) If the node's arms are on different glide planes we might
- *             not allow the node to be removed.
+ *      1) does not have exactly 2 arms
+ *      2) node is a 'fixed' node
+ *      3) node is flagged as exempt from coarsen operations
+ *      4) current domain does not 'own' at least one of the  segments
+ *      5) If the node's arms are on different glide planes we might
+ *         not allow the node to be removed.
  */
-            if (node->numNbrs != 2) continue;
-            if (node->constraint == PINNED_NODE) continue;
-        
-            nbr1 = GetNeighborNode(home, node, 0);
-            nbr2 = GetNeighborNode(home, node, 1);
-        
-            if ((nbr1 == (Node_t *)NULL) || (nbr2 == (Node_t *)NULL)) {
-                printf("WARNING: Neighbor not found at %s line %d\n",
-                       __FILE__, __LINE__);
-                continue;
-            }
+        if (node->numNbrs != 2) return(0);
+        if (node->constraint == PINNED_NODE) return(0);
+    
+        nbr1 = GetNeighborNode(home, node, 0);
+        nbr2 = GetNeighborNode(home, node, 1);
+    
+        if ((nbr1 == (Node_t *)NULL) || (nbr2 == (Node_t *)NULL)) {
+            printf("WARNING: Neighbor not found at %s line %d\n",
+                   __FILE__, __LINE__);
+            return(0);
+        }
 
-            if (node->flags & NO_MESH_COARSEN) {
-                continue;
-            }
-        
-            if (!DomainOwnsSeg(home, OPCLASS_REMESH, thisDomain, &nbr1->myTag) &&
-                !DomainOwnsSeg(home, OPCLASS_REMESH, thisDomain, &nbr2->myTag)) {
-                continue;
-            }
+        if (node->flags & NO_MESH_COARSEN) {
+            return(0);
+        }
+    
+        if (!DomainOwnsSeg(home, OPCLASS_REMESH, thisDomain, &nbr1->myTag) &&
+            !DomainOwnsSeg(home, OPCLASS_REMESH, thisDomain, &nbr2->myTag)) {
+            return(0);
+        }
 
-            hasRemoteNbr  = (node->myTag.domainID != nbr1->myTag.domainID);
-            hasRemoteNbr |= (node->myTag.domainID != nbr2->myTag.domainID);
+        hasRemoteNbr  = (node->myTag.domainID != nbr1->myTag.domainID);
+        hasRemoteNbr |= (node->myTag.domainID != nbr2->myTag.domainID);
 /*
  *          Calculate the lengths of the node's 2 arms plus
  *          the distance between the two neighbor nodes.
@@ -115,26 +278,26 @@ static void MeshCoarsen(Home_t *home)
  *          be on opposite side of the problem space, so adjust
  *          the lengths/distances accordingly.
  */
-            vec1x = nbr1->x - node->x;
-            vec1y = nbr1->y - node->y;
-            vec1z = nbr1->z - node->z;
-              
-            vec2x = nbr2->x - node->x;
-            vec2y = nbr2->y - node->y;
-            vec2z = nbr2->z - node->z;
-        
-            vec3x = vec2x - vec1x;
-            vec3y = vec2y - vec1y;
-            vec3z = vec2z - vec1z;
-              
-            ZImage(param, &vec1x, &vec1y, &vec1z);
-            ZImage(param, &vec2x, &vec2y, &vec2z);
-            ZImage(param, &vec3x, &vec3y, &vec3z);
-        
-            r1 = sqrt(vec1x*vec1x + vec1y*vec1y + vec1z*vec1z);
-            r2 = sqrt(vec2x*vec2x + vec2y*vec2y + vec2z*vec2z);
-            r3 = sqrt(vec3x*vec3x + vec3y*vec3y + vec3z*vec3z);
-        
+        vec1x = nbr1->x - node->x;
+        vec1y = nbr1->y - node->y;
+        vec1z = nbr1->z - node->z;
+          
+        vec2x = nbr2->x - node->x;
+        vec2y = nbr2->y - node->y;
+        vec2z = nbr2->z - node->z;
+    
+        vec3x = vec2x - vec1x;
+        vec3y = vec2y - vec1y;
+        vec3z = vec2z - vec1z;
+          
+        ZImage(param, &vec1x, &vec1y, &vec1z);
+        ZImage(param, &vec2x, &vec2y, &vec2z);
+        ZImage(param, &vec3x, &vec3y, &vec3z);
+    
+        r1 = sqrt(vec1x*vec1x + vec1y*vec1y + vec1z*vec1z);
+        r2 = sqrt(vec2x*vec2x + vec2y*vec2y + vec2z*vec2z);
+        r3 = sqrt(vec3x*vec3x + vec3y*vec3y + vec3z*vec3z);
+    
 /*
  *          If we are enforcing the use of segment glide planes, we do not
  *          want to coarsen out a node whose arms are on different glide planes.
@@ -152,25 +315,25 @@ static void MeshCoarsen(Home_t *home)
  *          3) If the glide planes are allowed to be 'fuzzy' add
  *             a few extra exceptions (see below)
  */
-            if (param->enforceGlidePlanes) {
-                int   connectionID, violateGlidePlanesOK = 0;
+        if (param->enforceGlidePlanes) {
+            int   connectionID, violateGlidePlanesOK = 0;
 
-                if ((r1 < 1.0) ||
-                    (r2 < 1.0) ||
-                    ((MAX(r1, r2) < MAX(1.0, 0.20 * param->minSeg) &&
-                     (Connected(nbr1, nbr2, &connectionID))))) {
+            if ((r1 < 1.0) ||
+                (r2 < 1.0) ||
+                ((MAX(r1, r2) < MAX(1.0, 0.20 * param->minSeg) &&
+                 (Connected(nbr1, nbr2, &connectionID))))) {
 #ifndef _SUBCYCLING
-                    violateGlidePlanesOK = 1;
+                violateGlidePlanesOK = 1;
 #endif
-                }
+            }
 
-                gp0[0] = node->nx[0];
-                gp0[1] = node->ny[0];
-                gp0[2] = node->nz[0];
+            gp0[0] = node->nx[0];
+            gp0[1] = node->ny[0];
+            gp0[2] = node->nz[0];
 
-                gp1[0] = node->nx[1];
-                gp1[1] = node->ny[1];
-                gp1[2] = node->nz[1];
+            gp1[0] = node->nx[1];
+            gp1[1] = node->ny[1];
+            gp1[2] = node->nz[1];
 
 /*
  *              Glide planes are being used, but if we are allowing
@@ -186,57 +349,57 @@ static void MeshCoarsen(Home_t *home)
  *                    precise glide plane, if the two precise planes are
  *                    the same
  */
-                if (param->allowFuzzyGlidePlanes) {
+            if (param->allowFuzzyGlidePlanes) {
 
-                    if (fabs(DotProduct(gp0, gp1)) > 0.9555) {
-                        violateGlidePlanesOK = 1;
-                    } else if ((r1 < param->rann) || (r2 <  param->rann)) {
-                        violateGlidePlanesOK = 1;
-                    } else {
-                        real8 burg1[3], burg2[3];
-                        real8 lineDir1[3], lineDir2[3];
-                        real8 testPlane1[3], testPlane2[3];
-
-                        burg1[X] = node->burgX[0];
-                        burg1[Y] = node->burgY[0];
-                        burg1[Z] = node->burgZ[0];
-
-                        burg2[X] = node->burgX[1];
-                        burg2[Y] = node->burgY[1];
-                        burg2[Z] = node->burgZ[1];
-                        lineDir1[X] = vec1x;
-                        lineDir1[Y] = vec1y;
-                        lineDir1[Z] = vec1z;
-
-                        lineDir2[X] = vec2x;
-                        lineDir2[Y] = vec2y;
-                        lineDir2[Z] = vec2z;
+                if (fabs(DotProduct(gp0, gp1)) > 0.9555) {
+                    violateGlidePlanesOK = 1;
+                } else if ((r1 < param->rann) || (r2 <  param->rann)) {
+                    violateGlidePlanesOK = 1;
+                } else {
+                    real8 burg1[3], burg2[3];
+                    real8 lineDir1[3], lineDir2[3];
+                    real8 testPlane1[3], testPlane2[3];
+
+                    burg1[X] = node->burgX[0];
+                    burg1[Y] = node->burgY[0];
+                    burg1[Z] = node->burgZ[0];
+
+                    burg2[X] = node->burgX[1];
+                    burg2[Y] = node->burgY[1];
+                    burg2[Z] = node->burgZ[1];
+                    lineDir1[X] = vec1x;
+                    lineDir1[Y] = vec1y;
+                    lineDir1[Z] = vec1z;
+
+                    lineDir2[X] = vec2x;
+                    lineDir2[Y] = vec2y;
+                    lineDir2[Z] = vec2z;
 
 /*
  *                      FindPreciseGlidePlanes() just uses l cross b if fuzzy
  *                      planes are allowed, so we temporarily reset the value
  *                      as a quick kludge to find the closest precise plane.
  */
-                        param->allowFuzzyGlidePlanes = 0;
-                        FindPreciseGlidePlane(home, burg1, lineDir1, testPlane1);
-                        FindPreciseGlidePlane(home, burg2, lineDir2, testPlane2);
-                        param->allowFuzzyGlidePlanes = 1;
-
-                        if (fabs(DotProduct(testPlane1, testPlane2)) > 0.99) {
-                            violateGlidePlanesOK = 1;
-                        }
+                    param->allowFuzzyGlidePlanes = 0;
+                    FindPreciseGlidePlane(home, burg1, lineDir1, testPlane1);
+                    FindPreciseGlidePlane(home, burg2, lineDir2, testPlane2);
+                    param->allowFuzzyGlidePlanes = 1;
+
+                    if (fabs(DotProduct(testPlane1, testPlane2)) > 0.99) {
+                        violateGlidePlanesOK = 1;
                     }
                 }
+            }
 
-                if (!violateGlidePlanesOK) {
+            if (!violateGlidePlanesOK) {
 
-                    cross(gp0, gp1, tmp3);
+                cross(gp0, gp1, tmp3);
 
-                    if (fabs(DotProduct(tmp3, tmp3)) > 1.0e-3) {
-                        continue;
-                    }
+                if (fabs(DotProduct(tmp3, tmp3)) > 1.0e-3) {
+                    return(0);
                 }
             }
+        }
 
 /*
  *          If coarsening out a node would leave a segment longer
@@ -251,10 +414,10 @@ static void MeshCoarsen(Home_t *home)
  *          be repositioned resulting in a segment that spanned
  *          more than 2 cells... this is a bad thing.
  */
-            if (((hasRemoteNbr == 0) && (r3 > cutoffLength1)) ||
-                ((hasRemoteNbr == 1) && (r3 > cutoffLength2))) {
-                continue;
-            }
+        if (((hasRemoteNbr == 0) && (r3 > cutoffLength1)) ||
+            ((hasRemoteNbr == 1) && (r3 > cutoffLength2))) {
+            return(0);
+        }
 
 /*
  *          Check if the area of the triangle defined by node
@@ -262,54 +425,104 @@ static void MeshCoarsen(Home_t *home)
  *          is increasing or decreasing.
  */
 
-            s = 0.5 * (r1 + r2 + r3);
-            area2 = (s * (s-r1) * (s-r2) * (s-r3));
-        
-            dvec1xdt = nbr1->vX - node->vX;
-            dvec1ydt = nbr1->vY - node->vY;
-            dvec1zdt = nbr1->vZ - node->vZ;
-              
-            dvec2xdt = nbr2->vX - node->vX;
-            dvec2ydt = nbr2->vY - node->vY;
-            dvec2zdt = nbr2->vZ - node->vZ;
-              
-            dvec3xdt = dvec2xdt - dvec1xdt;
-            dvec3ydt = dvec2ydt - dvec1ydt;
-            dvec3zdt = dvec2zdt - dvec1zdt;
-              
-            dr1dt = ((vec1x * dvec1xdt) + (vec1y * dvec1ydt) +
-                     (vec1z * dvec1zdt)) / (r1 + delta);
-        
-            dr2dt = ((vec2x * dvec2xdt) + (vec2y * dvec2ydt) +
-                     (vec2z * dvec2zdt)) / (r2 + delta);
-        
-            dr3dt = ((vec3x * dvec3xdt) + (vec3y * dvec3ydt) +
-                     (vec3z * dvec3zdt)) / (r3 + delta);
-        
-        
-            dsdt = 0.5 * (dr1dt + dr2dt + dr3dt);
-        
-            darea2dt = (dsdt * (s-r1) * (s-r2) * (s-r3));
-            darea2dt += s * (dsdt-dr1dt) * (s-r2) * (s-r3);
-            darea2dt += s * (s-r1) * (dsdt-dr2dt) * (s-r3);
-            darea2dt += s * (s-r1) * (s-r2) * (dsdt-dr3dt);
-        
+        s = 0.5 * (r1 + r2 + r3);
+        area2 = (s * (s-r1) * (s-r2) * (s-r3));
+    
+        dvec1xdt = nbr1->vX - node->vX;
+        dvec1ydt = nbr1->vY - node->vY;
+        dvec1zdt = nbr1->vZ - node->vZ;
+          
+        dvec2xdt = nbr2->vX - node->vX;
+        dvec2ydt = nbr2->vY - node->vY;
+        dvec2zdt = nbr2->vZ - node->vZ;
+          
+        dvec3xdt = dvec2xdt - dvec1xdt;
+        dvec3ydt = dvec2ydt - dvec1ydt;
+        dvec3zdt = dvec2zdt - dvec1zdt;
+          
+        dr1dt = ((vec1x * dvec1xdt) + (vec1y * dvec1ydt) +
+                 (vec1z * dvec1zdt)) / (r1 + delta);
+    
+        dr2dt = ((vec2x * dvec2xdt) + (vec2y * dvec2ydt) +
+                 (vec2z * dvec2zdt)) / (r2 + delta);
+    
+        dr3dt = ((vec3x * dvec3xdt) + (vec3y * dvec3ydt) +
+                 (vec3z * dvec3zdt)) / (r3 + delta);
+    
+    
+        dsdt = 0.5 * (dr1dt + dr2dt + dr3dt);
+    
+        darea2dt = (dsdt * (s-r1) * (s-r2) * (s-r3));
+        darea2dt += s * (dsdt-dr1dt) * (s-r2) * (s-r3);
+        darea2dt += s * (s-r1) * (dsdt-dr2dt) * (s-r3);
+        darea2dt += s * (s-r1) * (s-r2) * (dsdt-dr3dt);
+
 /*
- *          If the area is less than the specified minimum and shrinking,
- *          or one of the arms is less than the minimum segment length, the
- *          node should be removed.
+ *      If the area is less than the specified minimum and shrinking,
+ *      or one of the arms is less than the minimum segment length, the
+ *      node should be removed.
  */
+        *nbr1Ptr = nbr1;
+        *nbr2Ptr = nbr2;
 
-            if (((area2 < areaMin2) && (darea2dt < 0.0)) ||
-                ((r1 < param->minSeg) || (r2 < param->minSeg))) {
-        
-                EstCoarsenForces(home, nbr1, node, nbr2, f0seg1, f1seg1);
-        
-                mergeDone = 0;
+        return(((area2 < areaMin2) && (darea2dt < 0.0)) ||
+               ((r1 < param->minSeg) || (r2 < param->minSeg)));
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:    CoarsenEstimate
+ *      Description: Estimate the force on the segment left by coarsening
+ *                   out the node of one work item.  Only reads the
+ *                   network, and may be called concurrently for the
+ *                   items of a round.
+ *
+ *------------------------------------------------------------------------*/
+static void CoarsenEstimate(void *context, int item)
+{
+        RemeshRound_t *round = (RemeshRound_t *)context;
+        CoarsenItem_t *c = (CoarsenItem_t *)round->items + item;
+
+        EstCoarsenForces(round->home, c->nbr1, c->node, c->nbr2,
+                         c->f0seg1, c->f1seg1);
+
+        return;
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:    CoarsenNode
+ *      Description: Coarsen out the node of a work item by merging it
+ *                   into one of its neighbors, and apply the estimated
+ *                   force to the resulting segment.
+ *
+ *      Returns:  1 if the node was removed, 0 if not
+ *
+ *------------------------------------------------------------------------*/
+static int CoarsenNode(Home_t *home, CoarsenItem_t *item)
+{
+        int     q, thisDomain, mergeDone, mergeStatus, globalOp;
+        real8   newPos[3], *f0seg1, *f1seg1;
+        Tag_t   nbr1Tag, nbr2Tag, oldTag1, oldTag2, oldTag3;
+        Node_t  *node, *nbr, *nbr1, *nbr2, *mergedNode;
+        Param_t *param;
+
+        thisDomain = home->myDomain;
+        param      = home->param;
+
+        node   = item->node;
+        nbr1   = item->nbr1;
+        nbr2   = item->nbr2;
+        f0seg1 = item->f0seg1;
+        f1seg1 = item->f1seg1;
+
+        mergeDone = 0;
+
+        nbr1Tag = nbr1->myTag;
+        nbr2Tag = nbr2->myTag;
 
-                nbr1Tag = nbr1->myTag;
-                nbr2Tag = nbr2->myTag;
-        
 /*
  *              If either of the neighbor nodes (or any of their neighbors)
  *              is in a remote domain, the operation must be treated as global.
@@ -325,78 +538,76 @@ static void MeshCoarsen(Home_t *home)
  *                     are done after Remesh() but before the ghost node
  *                     are redistributed.
  */
-                globalOp = ((nbr1->myTag.domainID != thisDomain) ||
-                            (nbr2->myTag.domainID != thisDomain));
+        globalOp = ((nbr1->myTag.domainID != thisDomain) ||
+                    (nbr2->myTag.domainID != thisDomain));
+
+        for (q = 0; q < nbr1->numNbrs; q++) {
+            globalOp |= (nbr1->nbrTag[q].domainID != thisDomain);
+        }
+
+        for (q = 0; q < nbr2->numNbrs; q++) {
+            globalOp |= (nbr2->nbrTag[q].domainID != thisDomain);
+        }
 
-                for (q = 0; q < nbr1->numNbrs; q++) {
-                    globalOp |= (nbr1->nbrTag[q].domainID != thisDomain);
-                }
-        
-                for (q = 0; q < nbr2->numNbrs; q++) {
-                    globalOp |= (nbr2->nbrTag[q].domainID != thisDomain);
-                }
-        
 #ifdef _OP_REC
 				if (globalOp == 0) globalOp = 2;
 #endif
 
-                oldTag1 = nbr1->myTag;
-                oldTag2 = node->myTag;
-                oldTag3 = nbr2->myTag;
+        oldTag1 = nbr1->myTag;
+        oldTag2 = node->myTag;
+        oldTag3 = nbr2->myTag;
 /*
  *              If the first neighbor is not exempt from a coarsen
  *              operation, attempt to merge the nodes.
  */
-                if ((nbr1->flags & NO_MESH_COARSEN) == 0) {
-        
-                    newPos[X] = nbr1->x;
-                    newPos[Y] = nbr1->y;
-                    newPos[Z] = nbr1->z;
-        
-                    MergeNode(home, OPCLASS_REMESH, node, nbr1, newPos,
-                              &mergedNode, &mergeStatus, globalOp);
-        
-                    mergeDone = mergeStatus & MERGE_SUCCESS;
-                }
+        if ((nbr1->flags & NO_MESH_COARSEN) == 0) {
+
+            newPos[X] = nbr1->x;
+            newPos[Y] = nbr1->y;
+            newPos[Z] = nbr1->z;
+
+            MergeNode(home, OPCLASS_REMESH, node, nbr1, newPos,
+                      &mergedNode, &mergeStatus, globalOp);
+
+            mergeDone = mergeStatus & MERGE_SUCCESS;
+        }
 /*
  *              If the merge could not be done, try using
  *              the other neighbor.
  */
-                if (mergeDone == 0) {
-                    if ((nbr2->flags & NO_MESH_COARSEN) == 0) {
-                        newPos[X] = nbr2->x;
-                        newPos[Y] = nbr2->y;
-                        newPos[Z] = nbr2->z;
-        
-                        MergeNode(home, OPCLASS_REMESH, node, nbr2, newPos,
-                                  &mergedNode, &mergeStatus, globalOp);
-        
-                        mergeDone = mergeStatus & MERGE_SUCCESS;
-                    }
-                }
+        if (mergeDone == 0) {
+            if ((nbr2->flags & NO_MESH_COARSEN) == 0) {
+                newPos[X] = nbr2->x;
+                newPos[Y] = nbr2->y;
+                newPos[Z] = nbr2->z;
+
+                MergeNode(home, OPCLASS_REMESH, node, nbr2, newPos,
+                          &mergedNode, &mergeStatus, globalOp);
+
+                mergeDone = mergeStatus & MERGE_SUCCESS;
+            }
+        }
 /*
  *              If the merge was successful, update the forces
  *              on the remaining nodes.   Otherwise go back and
  *              continue looking for more nodes to coarsen out.
  */
-                if (mergeDone == 0) continue;
-        
-                localCoarsenCnt++;
+        if (mergeDone == 0) return(0);
 
 #ifdef DEBUG_TOPOLOGY_CHANGES
-                if ((dbgDom < 0) || (dbgDom == home->myDomain)) {
-                    printf("Coarsen: (%d,%d)--(%d,%d)--(%d,%d)\n",
-                           oldTag1.domainID, oldTag1.index,
-                           oldTag2.domainID, oldTag2.index,
-                           oldTag3.domainID, oldTag3.index);
-                }
+        if ((dbgDom < 0) || (dbgDom == home->myDomain)) {
+            printf("Coarsen: (%d,%d)--(%d,%d)--(%d,%d)\n",
+                   oldTag1.domainID, oldTag1.index,
+                   oldTag2.domainID, oldTag2.index,
+                   oldTag3.domainID, oldTag3.index);
+        }
 #endif
-                nbr1 = GetNodeFromTag(home, nbr1Tag);
-                nbr2 = GetNodeFromTag(home, nbr2Tag);
-        
-                if ((nbr1 == (Node_t *)NULL) && (nbr2 == (Node_t *)NULL)) {
-                    continue;
-                }
+        nbr1 = GetNodeFromTag(home, nbr1Tag);
+        nbr2 = GetNodeFromTag(home, nbr2Tag);
+
+        if ((nbr1 == (Node_t *)NULL) && (nbr2 == (Node_t *)NULL)) {
+            return(1);
+        }
 
 /*
  *              The merge will have placed the resultant node at the
@@ -408,11 +619,11 @@ static void MeshCoarsen(Home_t *home)
  *              not exist anymore, <mergedNode> (if it exists) should
  *              be the node that replaced the nbr.
  */
-                if (nbr1 == (Node_t *)NULL) {
-                    nbr1 = mergedNode;
-                } else if (nbr2 == (Node_t *)NULL) {
-                    nbr2 = mergedNode;
-                }
+        if (nbr1 == (Node_t *)NULL) {
+            nbr1 = mergedNode;
+        } else if (nbr2 == (Node_t *)NULL) {
+            nbr2 = mergedNode;
+        }
 
 /*
  *              At this point, if we don't have a node at the location
@@ -420,11 +631,11 @@ static void MeshCoarsen(Home_t *home)
  *              some nodes were orphaned and deleted, so the force
  *              estimates we made are not applicable.
  */
-                if ((nbr1 == (Node_t *)NULL) || (nbr2 == (Node_t *)NULL)) {
-                    continue;
-                }
-        
-                mergedNode->flags |= NO_MESH_COARSEN;
+        if ((nbr1 == (Node_t *)NULL) || (nbr2 == (Node_t *)NULL)) {
+            return(1);
+        }
+
+        mergedNode->flags |= NO_MESH_COARSEN;
 /*
  *              Reset force/velocity for the two remaining nodes
  *              and mark the forces for those nodes and all their
@@ -434,11 +645,11 @@ static void MeshCoarsen(Home_t *home)
  *              recalculate more exact forces for these nodes
  *              before (or at the beginning of) the next timestep.
  */
-                ResetSegForces(home, nbr1, &nbr2->myTag, f0seg1[X],
-                               f0seg1[Y], f0seg1[Z], 1);
+        ResetSegForces(home, nbr1, &nbr2->myTag, f0seg1[X],
+                       f0seg1[Y], f0seg1[Z], 1);
 
-                ResetSegForces(home, nbr2, &nbr1->myTag, f1seg1[X],
-                               f1seg1[Y], f1seg1[Z], 1);
+        ResetSegForces(home, nbr2, &nbr1->myTag, f1seg1[X],
+                       f1seg1[Y], f1seg1[Z], 1);
 
 /*
  *              Originally, we were resetting the velocity of the
@@ -446,259 +657,206 @@ static void MeshCoarsen(Home_t *home)
  *              better off NOT doing that, so we've dropped that.
  *              for now...
  */
-                MarkNodeForceObsolete(home, nbr1);
-                MarkNodeForceObsolete(home, nbr2);
-        
-                for (q = 0; q < nbr1->numNbrs; q++) {
-                    nbr = GetNodeFromTag(home, nbr1->nbrTag[q]);
-                    if (nbr == (Node_t *)NULL) continue;
-                    MarkNodeForceObsolete(home, nbr);
-                }
-        
-                for (q = 0; q < nbr2->numNbrs; q++) {
-                    nbr = GetNodeFromTag(home, nbr2->nbrTag[q]);
-                    if (nbr == (Node_t *)NULL) continue;
-                    MarkNodeForceObsolete(home, nbr);
-                }
+        MarkNodeForceObsolete(home, nbr1);
+        MarkNodeForceObsolete(home, nbr2);
+
+        for (q = 0; q < nbr1->numNbrs; q++) {
+            nbr = GetNodeFromTag(home, nbr1->nbrTag[q]);
+            if (nbr == (Node_t *)NULL) continue;
+            MarkNodeForceObsolete(home, nbr);
+        }
+
+        for (q = 0; q < nbr2->numNbrs; q++) {
+            nbr = GetNodeFromTag(home, nbr2->nbrTag[q]);
+            if (nbr == (Node_t *)NULL) continue;
+            MarkNodeForceObsolete(home, nbr);
+        }
 
 /*
  *              If we are enforcing glide planes but allowing them to be
  *              slightly fuzzy, we need to recalculate the glide plane for
  *              the new segment.
  */
-                if (param->enforceGlidePlanes &&
-                    param->allowFuzzyGlidePlanes) {
+        if (param->enforceGlidePlanes &&
+            param->allowFuzzyGlidePlanes) {
 
-                    RecalcSegGlidePlane(home, nbr1, nbr2, 1);
-                }
-            }
-        }
-        
-#ifdef DEBUG_LOG_MESH_COARSEN
-#ifdef PARALLEL
-        MPI_Reduce(&localCoarsenCnt, &globalCoarsenCnt, 1, MPI_INT, MPI_SUM,
-                   0, MPI_COMM_WORLD);
-#else
-        globalCoarsenCnt = localCoarsenCnt;
-#endif
-        if (home->myDomain == 0) {
-            printf("  Remesh: coarsen count = %d\n", globalCoarsenCnt);
+            RecalcSegGlidePlane(home, nbr1, nbr2, 1);
         }
-#endif
-        return;
+
+        return(1);
 }
 
 
 /*-------------------------------------------------------------------------
  *
- *      Function:    TrySegBisect
- *      Description: Attempt to bisect a discretization segment during
- *                   mesh refinement by splitting the specified node.
- *                   Some restrictions apply and if any of the criteria
- *                   are not met, the segment will not be bisected.
- *
- *      Arguments:
- *          origNode  Pointer to location containing the pointer to
- *                    the node that we are considering splitting.  
- *                    On return to the caller this will contain a 
- *                    pointer to the node left at the position
- *                    <origNode> was in on entry to this function.
- *          nbr       Pointer to node at the end of the segment to
- *                    be bisected.
- *          armID     Index of the segment in <origNode>'s arm list
- *          segLen    Length (in units of b) of the segment to be
- *                    bisected.
- *          vec       Vector from <origNode> to <nbr>
- *          area2     area (squared) enclosed by <origNode>, <nbr> and
- *                    the other neighbor of <origNode> which is not 
- *                    provided to this function.
- *          areaMax2  Maximum area (squared) needed before the segment
- *                    may be bisected (unless segLen has exceeded the
- *                    maximum permitted segment length).
- *          darea2dt  Indicates if the area indicated by <area2> is
- *                    increasing or decreasing in size.
- *          splitIsOK Additional flag indicating if the segment is
- *                    permitted to be bisected.  (Caller may have 
- *                    determined the bisection should not occur).
- *                    0 == not permitted, 1 == permitted.
- *          didBisect Flag indicating if the other segment attached
- *                    to <origNode> was bisected this cycle.  Mostly for
- *                    possible future use...  0 == not bisected,
- *                    1 == bisected.
+ *      Function:    MeshCoarsen
+ *      Description: Coarsen out the discretization nodes that are too
+ *                   close to their neighbors or that enclose too small
+ *                   an area with them.
  *
- *      Returns:  1 if the segment was bisected, 0 if not
- *          
  *------------------------------------------------------------------------*/
-static int TrySegBisect(Home_t *home, Node_t **origNode, Node_t *nbr,
-                        int armID, real8 segLen, real8 vec[3], real8 area2,
-                        real8 areaMax2, real8 darea2dt, int splitIsOK,
-                        int didBisect)
+static void MeshCoarsen(Home_t *home)
 {
-        int     splitStatus, thisDomain, globalOp;
-        int     *armList, armCount;
-        real8   newVel[3], newPos[3], nodeVel[3], nodePos[3];
-        real8   f0seg1[3], f0seg2[3], f1seg1[3], f1seg2[3];
-        Tag_t   oldTag1, oldTag2;
-        Node_t  *node, *splitNode1, *splitNode2;
-        Param_t *param;
+        int              i, numItems, maxItems;
+        int              localCoarsenCnt, globalCoarsenCnt;
+        Node_t           *node, *nbrs[3];
+        CoarsenItem_t    *items;
+        RemeshSchedule_t sched;
+        RemeshRound_t    round;
 
-        thisDomain = home->myDomain;
-        param = home->param;
-        armList = &armID;
-        armCount = 1;
-        didBisect = 0;
-        node = *origNode;
+        localCoarsenCnt = 0;
+        globalCoarsenCnt = 0;
 
-#if 0
-/*
- *      The idea here was that if we already bisected 1 segment of
- *      the 2-node, we'd only bisect the second segment this cycle
- *      if the second segment exceeded the max seg length. I'm not
- *      sure yet if that is the best thing to do, so for now we
- *      won't prevent the second segment from being bisected because
- *      the first was.
- */
-        if (!splitIsOK || (didBisect && (segLen < param->maxSeg))) {
-            return(0);
-        }
-#else
-        if (!splitIsOK) {
-            return(0);
-        }
-#endif
+        sched.claim = (int *)NULL;
+        sched.done  = (int *)NULL;
+        sched.stale = (int *)NULL;
+        sched.size  = 0;
+        sched.round = 0;
+        ScheduleUpdate(home, &sched);
+
+        maxItems = 0;
+        items = (CoarsenItem_t *)NULL;
 
 /*
- *      If the segment is over the max segment length, or the area
- *      of the triangle defined by the node and its two neighbors
- *      is above the limit AND the area is increasing in size AND
- *      the segment is not too small to bisect, we cut it.
- */
-        if ((segLen > param->maxSeg) ||
-            ((area2 > areaMax2) &&
-             (segLen >= param->minSeg * 2.0) &&
-             (darea2dt >= 0.0))) {
-/*
- *          When bisecting a segment, we always move exactly one arm
- *          from the original node to the node being created... in this
- *          case, the arm with index <armID>
+ *      Loop through all the nodes native to this domain looking for
+ *      nodes that should be coarsened out.  A node whose neighborhood
+ *      overlaps that of a node selected earlier in the round is left for
+ *      the next round, evaluated on the network the earlier merges leave.
  */
-            newVel[X] = (node->vX + nbr->vX) * 0.5;
-            newVel[Y] = (node->vY + nbr->vY) * 0.5;
-            newVel[Z] = (node->vZ + nbr->vZ) * 0.5;
+        do {
+            sched.round++;
+            numItems = 0;
 
-            newPos[X] = node->x + (vec[X] * 0.5);
-            newPos[Y] = node->y + (vec[Y] * 0.5);
-            newPos[Z] = node->z + (vec[Z] * 0.5);
+            for (i = 0; i < home->newNodeKeyPtr; i++) {
 
-            EstRefinementForces(home, node, nbr, newPos, vec,
-                                f0seg1, f1seg1, f0seg2, f1seg2);
+                node = home->nodeKeys[i];
+                if ((node == (Node_t *)NULL) || sched.done[i]) continue;
 
-            FoldBox(param, &newPos[X], &newPos[Y], &newPos[Z]);
+                if (NeighborhoodClaimed(home, &sched, node)) continue;
 
-/*
- *          This should be a global operation distributed
- *          out to remote domains only if the neighbor node
- *          is in another domain.
- */
-            globalOp = (nbr->myTag.domainID != node->myTag.domainID);
-#ifdef _OP_REC
-			if (globalOp == 0) globalOp = 2;
-#endif
-
-            nodePos[X] = node->x;
-            nodePos[Y] = node->y;
-            nodePos[Z] = node->z;
+                if (!CoarsenCandidate(home, node, &nbrs[1], &nbrs[2])) {
+                    sched.done[i] = 1;
+                    continue;
+                }
 
-            nodeVel[X] = node->vX;
-            nodeVel[Y] = node->vY;
-            nodeVel[Z] = node->vZ;
+                nbrs[0] = node;
+                if (!ClaimNeighborhoods(home, &sched, nbrs, 3)) continue;
 
-            oldTag1 = node->myTag;
-            oldTag2 = nbr->myTag;
+                sched.done[i] = 1;
 
-            splitStatus = SplitNode(home, OPCLASS_REMESH,
-                                    node, nodePos, newPos,
-                                    nodeVel, newVel,
-                                    armCount, armList,
-                                    globalOp, &splitNode1,
-                                    &splitNode2, 0);
+                if (numItems == maxItems) {
+                    maxItems = (maxItems > 0) ? 2 * maxItems : 64;
+                    items = (CoarsenItem_t *)realloc(items,
+                            maxItems * sizeof(CoarsenItem_t));
+                    if (items == (CoarsenItem_t *)NULL) {
+                        Fatal("MeshCoarsen: out of memory (%d items)",
+                              maxItems);
+                    }
+                }
 
-            if (splitStatus == SPLIT_SUCCESS) {
+                items[numItems].node = node;
+                items[numItems].nbr1 = nbrs[1];
+                items[numItems].nbr2 = nbrs[2];
+                numItems++;
+            }
 
-                didBisect = 1;
-                *origNode = splitNode1;
-/*
- *              The force estimates above are good enough for the
- *              remainder of this timestep, but mark the force and
- *              velocity data for some nodes as obsolete so that
- *              more accurate forces will be recalculated either at
- *              the end of this timestep, or the beginning of the next.
- */
-                MarkNodeForceObsolete(home, splitNode1);
-                MarkNodeForceObsolete(home, splitNode2);
-                MarkNodeForceObsolete(home, nbr);
+            round.home  = home;
+            round.items = items;
+            RemeshParallelFor(numItems, CoarsenEstimate, &round);
 
-/*
- *              Reset nodal forces on all nodes involved
- *              in the split.
- */
-                ResetSegForces(home, splitNode1, &splitNode2->myTag,
-                               f0seg1[X], f0seg1[Y], f0seg1[Z], 1);
+            for (i = 0; i < numItems; i++) {
+                localCoarsenCnt += CoarsenNode(home, &items[i]);
+            }
 
-                ResetSegForces(home, splitNode2, &splitNode1->myTag,
-                               f1seg1[X], f1seg1[Y], f1seg1[Z], 1);
+        } while (numItems > 0);
 
-                ResetSegForces(home, splitNode2, &nbr->myTag,
-                               f0seg2[X], f0seg2[Y], f0seg2[Z], 1);
+        free(items);
+        free(sched.claim);
+        free(sched.done);
+        free(sched.stale);
 
-                ResetSegForces(home, nbr, &splitNode2->myTag,
-                               f1seg2[X], f1seg2[Y], f1seg2[Z], 1);
+        ProfileCount(PROFILE_REMESH_OPS, localCoarsenCnt);
+        
+#ifdef DEBUG_LOG_MESH_COARSEN
+#ifdef PARALLEL
+        MPI_Reduce(&localCoarsenCnt, &globalCoarsenCnt, 1, MPI_INT, MPI_SUM,
+                   0, MPI_COMM_WORLD);
+#else
+        globalCoarsenCnt = localCoarsenCnt;
+#endif
+        if (home->myDomain == 0) {
+            printf("  Remesh: coarsen count = %d\n", globalCoarsenCnt);
+        }
+#endif
+        return;
+}
 
-                (void)EvaluateMobility(home, splitNode1);
-                (void)EvaluateMobility(home, splitNode2);
-                (void)EvaluateMobility(home, nbr);
 
-/*
- *              When debugging, dump some info on
- *              topological changes taking place and
- *              the nodes involved
- */
-#ifdef DEBUG_TOPOLOGY_CHANGES
-                if ((dbgDom < 0) || (dbgDom == thisDomain)) {
-                    printf("Remesh/refine1:  (%d,%d)--(%d,%d) ==> "
-                           "(%d,%d)--(%d,%d)--(%d,%d)\n",
-                           oldTag1.domainID, oldTag1.index,
-                           oldTag2.domainID, oldTag2.index,
-                           splitNode1->myTag.domainID,
-                           splitNode1->myTag.index,
-                           splitNode2->myTag.domainID,
-                           splitNode2->myTag.index,
-                           nbr->myTag.domainID,
-                           nbr->myTag.index);
-                    PrintNode(splitNode1);
-                    PrintNode(splitNode2);
-                    PrintNode(nbr);
-                }
-#endif
-            }  /* if (splitStatus == SPLIT_SUCCESS) */
+/*-------------------------------------------------------------------------
+ *
+ *      Function:    AddRefineItem
+ *      Description: Append the bisection of the segment from <node> to
+ *                   <nbr> at its midpoint to the work items of a round.
+ *
+ *------------------------------------------------------------------------*/
+static void AddRefineItem(RefineItem_t **items, int *numItems, int *maxItems,
+                          Node_t *node, Node_t *nbr, real8 vec[3])
+{
+        RefineItem_t *r;
+
+        if (*numItems == *maxItems) {
+            *maxItems = (*maxItems > 0) ? 2 * *maxItems : 64;
+            *items = (RefineItem_t *)realloc(*items,
+                     *maxItems * sizeof(RefineItem_t));
+            if (*items == (RefineItem_t *)NULL) {
+                Fatal("MeshRefine: out of memory (%d items)", *maxItems);
+            }
         }
 
-        return(didBisect);
+        r = *items + (*numItems)++;
+
+        r->node = node;
+        r->nbr  = nbr;
+
+        r->vec[X] = vec[X];
+        r->vec[Y] = vec[Y];
+        r->vec[Z] = vec[Z];
+
+        r->newPos[X] = node->x + (vec[X] * 0.5);
+        r->newPos[Y] = node->y + (vec[Y] * 0.5);
+        r->newPos[Z] = node->z + (vec[Z] * 0.5);
+
+        return;
 }
 
 
 /*-------------------------------------------------------------------------
  *
- *      Function:    MeshRefine
- *      Description: 
+ *      Function:    RefineCandidate
+ *      Description: Select the segments of a node that should be
+ *                   bisected and append them to the work items.
+ *
+ *                   If the node has exactly two arms, both arm lengths
+ *                   and the area of the triangle defined by the node and
+ *                   its neighbors are used, the longest segment first.
+ *                   A segment is bisected if it is over the maximum
+ *                   segment length, or if the area is above the limit
+ *                   AND increasing in size AND the segment is not too
+ *                   small to bisect.
+ *
+ *                   For nodes with other than exactly two arms, we
+ *                   just bisect any arm exceeding the max allowable
+ *                   segment length, but only do the bisection from the
+ *                   domain "owning" the segment.
+ *
+ *      Returns:  the number of segments selected
  *
  *------------------------------------------------------------------------*/
-static void MeshRefine(Home_t *home)
+static int RefineCandidate(Home_t *home, RemeshSchedule_t *sched,
+                           Node_t *node, RefineItem_t **items,
+                           int *numItems, int *maxItems)
 {
-        int     i, thisDomain, didBisect, seg, splitIsOK;
-        int     splitStatus, armIndex, armCount = 1, globalOp;
-        int     armID, *armList;
-        int     localRefineCnt, globalRefineCnt;
+        int     seg, thisDomain, armIndex, numSelected;
         int     splitOK[2], splitSegList[2];
         real8   areaMax, areaMax2, maxSeg2;
         real8   delta, r1, r2, r3, s, area2, segLen;
@@ -707,15 +865,9 @@ static void MeshRefine(Home_t *home)
         real8   dvec3xdt, dvec3ydt, dvec3zdt;
         real8   dr1dt, dr2dt, dr3dt, dsdt, darea2dt;
         real8   *vec, vec1[3], vec2[3], vec3[3];
-        real8   nodePos[3], nodeVel[3], newVel[3], newPos[3];
-        real8   f0seg1[3], f1seg1[3], f0seg2[3], f1seg2[3];
-        Tag_t   oldTag1, oldTag2;
-        Node_t  *node, *nbr, *nbr1, *nbr2, *splitNode1, *splitNode2;
+        Node_t  *nbr, *nbr1, *nbr2;
         Param_t *param;
 
-/*
- *      Initialize some of the constants we'll need during this call.
- */
         thisDomain = home->myDomain;
         param      = home->param;
 
@@ -724,315 +876,420 @@ static void MeshRefine(Home_t *home)
         maxSeg2  = param->maxSeg * param->maxSeg;
         delta    = 1.0e-16;
 
-        localRefineCnt = 0;
-        globalRefineCnt = 0;
-        
-/*
- *      Loop through all the  native nodes looking for segments
- *      that need to be refined.
- */
-        armList = &armID;
-        
-        for (i = 0; i < home->newNodeKeyPtr; i++) {
-        
-            node = home->nodeKeys[i];
-            if (node == (Node_t *)NULL) continue;
-        
-/*
- *          If the node has only two arms, use both arm lengths and
- *          the area in the triangle defined by the node and its 
- *          neighbors to decide whether the node should be split or not.
- */
-            if (node->numNbrs == 2) {
-        
+        numSelected = 0;
+
+        if (node->numNbrs == 2) {
+
 /*
- *              Calculate the lengths of the node's 2 arms plus
- *              the distance between the two neighbor nodes.
+ *          Calculate the lengths of the node's 2 arms plus
+ *          the distance between the two neighbor nodes.
  */
-                nbr1 = GetNeighborNode(home, node, 0);
-                nbr2 = GetNeighborNode(home, node, 1);
-        
-                if ((nbr1 == (Node_t *)NULL) || (nbr2 == (Node_t *)NULL)) {
-                    printf("WARNING: Neighbor not found at %s line %d\n",
-                           __FILE__, __LINE__);
-                    continue;
-                }
+            nbr1 = GetNeighborNode(home, node, 0);
+            nbr2 = GetNeighborNode(home, node, 1);
+
+            if ((nbr1 == (Node_t *)NULL) || (nbr2 == (Node_t *)NULL)) {
+                printf("WARNING: Neighbor not found at %s line %d\n",
+                       __FILE__, __LINE__);
+                return(0);
+            }
+
+            vec1[X] = nbr1->x - node->x;
+            vec1[Y] = nbr1->y - node->y;
+            vec1[Z] = nbr1->z - node->z;
+      
+            vec2[X] = nbr2->x - node->x;
+            vec2[Y] = nbr2->y - node->y;
+            vec2[Z] = nbr2->z - node->z;
+
+            vec3[X] = vec2[X] - vec1[X];
+            vec3[Y] = vec2[Y] - vec1[Y];
+            vec3[Z] = vec2[Z] - vec1[Z];
+
+            ZImage(param, &vec1[X], &vec1[Y], &vec1[Z]);
+            ZImage(param, &vec2[X], &vec2[Y], &vec2[Z]);
+            ZImage(param, &vec3[X], &vec3[Y], &vec3[Z]);
+
+            r1 = sqrt(vec1[X]*vec1[X] + vec1[Y]*vec1[Y] + vec1[Z]*vec1[Z]);
+            r2 = sqrt(vec2[X]*vec2[X] + vec2[Y]*vec2[Y] + vec2[Z]*vec2[Z]);
+            r3 = sqrt(vec3[X]*vec3[X] + vec3[Y]*vec3[Y] + vec3[Z]*vec3[Z]);
+
+            s = 0.5 * (r1 + r2 + r3);
+            area2 = (s * (s - r1) * (s - r2) * (s - r3));
 
-                vec1[X] = nbr1->x - node->x;
-                vec1[Y] = nbr1->y - node->y;
-                vec1[Z] = nbr1->z - node->z;
-              
-                vec2[X] = nbr2->x - node->x;
-                vec2[Y] = nbr2->y - node->y;
-                vec2[Z] = nbr2->z - node->z;
-        
-                vec3[X] = vec2[X] - vec1[X];
-                vec3[Y] = vec2[Y] - vec1[Y];
-                vec3[Z] = vec2[Z] - vec1[Z];
-        
-                ZImage(param, &vec1[X], &vec1[Y], &vec1[Z]);
-                ZImage(param, &vec2[X], &vec2[Y], &vec2[Z]);
-                ZImage(param, &vec3[X], &vec3[Y], &vec3[Z]);
-        
-                r1 = sqrt(vec1[X]*vec1[X] + vec1[Y]*vec1[Y] + vec1[Z]*vec1[Z]);
-                r2 = sqrt(vec2[X]*vec2[X] + vec2[Y]*vec2[Y] + vec2[Z]*vec2[Z]);
-                r3 = sqrt(vec3[X]*vec3[X] + vec3[Y]*vec3[Y] + vec3[Z]*vec3[Z]);
-        
-                s = 0.5 * (r1 + r2 + r3);
-                area2 = (s * (s - r1) * (s - r2) * (s - r3));
-        
 /*
  *              Determine if the area of the triangle defined by the node
  *              and its two neighbors is increasing or decreasing.
  */
-                dvec1xdt = nbr1->vX - node->vX;
-                dvec1ydt = nbr1->vY - node->vY;
-                dvec1zdt = nbr1->vZ - node->vZ;
+            dvec1xdt = nbr1->vX - node->vX;
+            dvec1ydt = nbr1->vY - node->vY;
+            dvec1zdt = nbr1->vZ - node->vZ;
 
-                dvec2xdt = nbr2->vX - node->vX;
-                dvec2ydt = nbr2->vY - node->vY;
-                dvec2zdt = nbr2->vZ - node->vZ;
+            dvec2xdt = nbr2->vX - node->vX;
+            dvec2ydt = nbr2->vY - node->vY;
+            dvec2zdt = nbr2->vZ - node->vZ;
 
-                dvec3xdt = dvec2xdt - dvec1xdt;
-                dvec3ydt = dvec2ydt - dvec1ydt;
-                dvec3zdt = dvec2zdt - dvec1zdt;
+            dvec3xdt = dvec2xdt - dvec1xdt;
+            dvec3ydt = dvec2ydt - dvec1ydt;
+            dvec3zdt = dvec2zdt - dvec1zdt;
 
-                dr1dt = ((vec1[X] * dvec1xdt) + (vec1[Y] * dvec1ydt) +
-                         (vec1[Z] * dvec1zdt)) / (r1 + delta);
+            dr1dt = ((vec1[X] * dvec1xdt) + (vec1[Y] * dvec1ydt) +
+                     (vec1[Z] * dvec1zdt)) / (r1 + delta);
 
-                dr2dt = ((vec2[X] * dvec2xdt) + (vec2[Y] * dvec2ydt) +
-                         (vec2[Z] * dvec2zdt)) / (r2 + delta);
+            dr2dt = ((vec2[X] * dvec2xdt) + (vec2[Y] * dvec2ydt) +
+                     (vec2[Z] * dvec2zdt)) / (r2 + delta);
 
-                dr3dt = ((vec3[X] * dvec3xdt) + (vec3[Y] * dvec3ydt) +
-                         (vec3[Z] * dvec3zdt)) / (r3 + delta);
+            dr3dt = ((vec3[X] * dvec3xdt) + (vec3[Y] * dvec3ydt) +
+                     (vec3[Z] * dvec3zdt)) / (r3 + delta);
 
-                dsdt = 0.5 * (dr1dt + dr2dt + dr3dt);
+            dsdt = 0.5 * (dr1dt + dr2dt + dr3dt);
 
-                darea2dt = (dsdt * (s-r1) * (s-r2) * (s-r3));
-                darea2dt += s * (dsdt-dr1dt) * (s-r2) * (s-r3);
-                darea2dt += s * (s-r1) * (dsdt-dr2dt) * (s-r3);
-                darea2dt += s * (s-r1) * (s-r2) * (dsdt-dr3dt);
+            darea2dt = (dsdt * (s-r1) * (s-r2) * (s-r3));
+            darea2dt += s * (dsdt-dr1dt) * (s-r2) * (s-r3);
+            darea2dt += s * (s-r1) * (dsdt-dr2dt) * (s-r3);
+            darea2dt += s * (s-r1) * (s-r2) * (dsdt-dr3dt);
 
 /*
  *              Check if the current domain owns the segments.
  *              It may only split a segment it owns...
  */
-                splitOK[0] = DomainOwnsSeg(home, OPCLASS_REMESH,
-                                           thisDomain, &nbr1->myTag);
+            splitOK[0] = DomainOwnsSeg(home, OPCLASS_REMESH,
+                                       thisDomain, &nbr1->myTag);
 
-                splitOK[1] = DomainOwnsSeg(home, OPCLASS_REMESH,
-                                           thisDomain, &nbr2->myTag);
+            splitOK[1] = DomainOwnsSeg(home, OPCLASS_REMESH,
+                                       thisDomain, &nbr2->myTag);
 /*
  *              If both nodes of the segment are flagged to have forces
  *              updated, forces and velocities on the node may not be
  *              good enough to accurately position the new node, so
  *              don't split this segment this cycle.
  */
-                if (((node->flags & NODE_RESET_FORCES) != 0) &&
-                    ((nbr1->flags & NODE_RESET_FORCES) != 0)) {
-                    splitOK[0] = 0;
+            if (ForcesStale(home, sched, node) &&
+                ForcesStale(home, sched, nbr1)) {
+                splitOK[0] = 0;
+            }
+
+            if (ForcesStale(home, sched, node) &&
+                ForcesStale(home, sched, nbr2)) {
+                splitOK[1] = 0;
+            }
+
+            if (r1 > r2) {
+                splitSegList[0] = 1;
+                splitSegList[1] = 2;
+            } else {
+                splitSegList[0] = 2;
+                splitSegList[1] = 1;
+            }
+
+            for (seg = 0; seg < 2; seg++) {
+                if (splitSegList[seg] == 1) {
+                    nbr = nbr1;
+                    vec = vec1;
+                    segLen = r1;
+                    if (!splitOK[0]) continue;
+                } else {
+                    nbr = nbr2;
+                    vec = vec2;
+                    segLen = r2;
+                    if (!splitOK[1]) continue;
                 }
 
-                if (((node->flags & NODE_RESET_FORCES) != 0) &&
-                    ((nbr2->flags & NODE_RESET_FORCES) != 0)) {
-                    splitOK[1] = 0;
+                if ((segLen > param->maxSeg) ||
+                    ((area2 > areaMax2) &&
+                     (segLen >= param->minSeg * 2.0) &&
+                     (darea2dt >= 0.0))) {
+                    AddRefineItem(items, numItems, maxItems, node, nbr, vec);
+                    numSelected++;
                 }
+            }
 
-/*
- *              It would be preferable to bisect the longest segment
- *              first, so check the segment lengths and set the
- *              preferred order.
- */
-                if (r1 > r2) {
-                    splitSegList[0] = 1;
-                    splitSegList[1] = 2;
-                } else {
-                    splitSegList[0] = 2;
-                    splitSegList[1] = 1;
+        } else {
+
+            for (armIndex = 0; armIndex < node->numNbrs; armIndex++) {
+
+                nbr1 = GetNeighborNode(home, node, armIndex);
+
+                if (nbr1 == (Node_t *)NULL) {
+                    printf("WARNING: Neighbor not found at %s line %d\n",
+                           __FILE__, __LINE__);
+                    continue;
                 }
-/*
- *              Loop over both segments in the preferred order and try to 
- *              bisect them.
- *
- *              Note: If we bisect a segment on the first loop iteration,
- *              the following segment will only be bisected if it exceeds
- *              the maximum seg length.
- */
-                didBisect = 0;
-
-                for (seg = 0; seg < 2; seg++) {
-                    if (splitSegList[seg] == 1) {
-                        nbr = nbr1;
-                        vec = vec1;
-                        segLen = r1;
-                        splitIsOK = splitOK[0];
-                    } else {
-                        nbr = nbr2;
-                        vec = vec2;
-                        segLen = r2;
-                        splitIsOK = splitOK[1];
-                    }
 
-                    armID = GetArmID(home, node, nbr);
+                if (!DomainOwnsSeg(home, OPCLASS_REMESH,
+                                   thisDomain, &nbr1->myTag)) {
+                    continue;
+                }
 
-                    didBisect = TrySegBisect(home, &node, nbr, armID, segLen,
-                                             vec, area2, areaMax2, darea2dt,
-                                             splitIsOK, didBisect);
+                vec1[X] = nbr1->x - node->x;
+                vec1[Y] = nbr1->y - node->y;
+                vec1[Z] = nbr1->z - node->z;
 
-                    localRefineCnt += didBisect;
+                ZImage(param, &vec1[X], &vec1[Y], &vec1[Z]);
 
-                }  /* for (seg = 0; seg < 2; ...) */
+                r1 = vec1[X]*vec1[X] + vec1[Y]*vec1[Y] + vec1[Z]*vec1[Z];
 
-            } else {
-/*
- *              For nodes with other than exactly two arms, we
- *              just bisect any arm exceeding the max allowable
- *              segment length, but only do the bisection from the
- *              domain "owning" the segment.
+                if (r1 > maxSeg2) {
+                    AddRefineItem(items, numItems, maxItems, node, nbr1, vec1);
+                    numSelected++;
+                }
+            }
+        }
+
+        return(numSelected);
+}
+
+
+/*-------------------------------------------------------------------------
  *
- *              A "split" is only considered a global operation
- *              to be sent to remote domains if the segment being
- *              split spans domains.
- */
-                for (armIndex = 0; armIndex < node->numNbrs; ) {
-        
-                    nbr1 = GetNeighborNode(home, node, armIndex);
-        
-                    if (nbr1 == (Node_t *)NULL) {
-                        printf("WARNING: Neighbor not found at %s line %d\n",
-                               __FILE__, __LINE__);
-                        continue;
-                    }
+ *      Function:    RefineEstimate
+ *      Description: Estimate the forces on the two segments created by
+ *                   the bisection of one work item.  Only reads the
+ *                   network, and may be called concurrently for the
+ *                   items of a round.
+ *
+ *------------------------------------------------------------------------*/
+static void RefineEstimate(void *context, int item)
+{
+        RemeshRound_t *round = (RemeshRound_t *)context;
+        RefineItem_t  *r = (RefineItem_t *)round->items + item;
 
-                    if (!DomainOwnsSeg(home, OPCLASS_REMESH,
-                                       thisDomain, &nbr1->myTag)) {
-                        armIndex++;
-                        continue;
-                    }
-        
-                    vec1[X] = nbr1->x - node->x;
-                    vec1[Y] = nbr1->y - node->y;
-                    vec1[Z] = nbr1->z - node->z;
-        
-                    ZImage(param, &vec1[X], &vec1[Y], &vec1[Z]);
-        
-                    r1 = vec1[X]*vec1[X] + vec1[Y]*vec1[Y] + vec1[Z]*vec1[Z];
-        
-                    if (r1 > maxSeg2) {
-        
-                        newPos[X] = node->x + (vec1[X] * 0.5);
-                        newPos[Y] = node->y + (vec1[Y] * 0.5);
-                        newPos[Z] = node->z + (vec1[Z] * 0.5);
-        
-                        newVel[X] = (node->vX + nbr1->vX) * 0.5;
-                        newVel[Y] = (node->vY + nbr1->vY) * 0.5;
-                        newVel[Z] = (node->vZ + nbr1->vZ) * 0.5;
-        
-                        EstRefinementForces(home, node, nbr1, newPos, vec1,
-                                            f0seg1, f1seg1, f0seg2, f1seg2);
+        EstRefinementForces(round->home, r->node, r->nbr, r->newPos, r->vec,
+                            r->f0seg1, r->f1seg1, r->f0seg2, r->f1seg2);
+
+        return;
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:    BisectSegment
+ *      Description: Bisect the segment of a work item by splitting its
+ *                   node, moving the arm to the neighbor onto the new
+ *                   node, and apply the estimated forces to the two
+ *                   resulting segments.
+ *
+ *      Returns:  pointer to the new node, or NULL if the segment was
+ *                not bisected
+ *
+ *------------------------------------------------------------------------*/
+static Node_t *BisectSegment(Home_t *home, RefineItem_t *item)
+{
+        int     splitStatus, thisDomain, globalOp;
+        int     armID, *armList, armCount;
+        real8   newVel[3], newPos[3], nodeVel[3], nodePos[3], *vec;
+        real8   *f0seg1, *f0seg2, *f1seg1, *f1seg2;
+        Tag_t   oldTag1, oldTag2;
+        Node_t  *node, *nbr, *splitNode1, *splitNode2;
+        Param_t *param;
+
+        thisDomain = home->myDomain;
+        param = home->param;
 
-                        FoldBox(param, &newPos[X], &newPos[Y], &newPos[Z]);
+        node = item->node;
+        nbr  = item->nbr;
+        vec  = item->vec;
+
+        f0seg1 = item->f0seg1;
+        f1seg1 = item->f1seg1;
+        f0seg2 = item->f0seg2;
+        f1seg2 = item->f1seg2;
 
 /*
- *                      When bisecting a segment, we always move
- *                      exactly one arm from the original node
- *                      to the node being created...
+ *      When bisecting a segment, we always move exactly one arm
+ *      from the original node to the node being created... in this
+ *      case, the arm to <nbr>
  */
-                        *armList = armIndex;
-        
+        armID = GetArmID(home, node, nbr);
+        if (armID < 0) return((Node_t *)NULL);
+
+        armList = &armID;
+        armCount = 1;
+        splitNode2 = (Node_t *)NULL;
+
+        newVel[X] = (node->vX + nbr->vX) * 0.5;
+        newVel[Y] = (node->vY + nbr->vY) * 0.5;
+        newVel[Z] = (node->vZ + nbr->vZ) * 0.5;
+
+        newPos[X] = node->x + (vec[X] * 0.5);
+        newPos[Y] = node->y + (vec[Y] * 0.5);
+        newPos[Z] = node->z + (vec[Z] * 0.5);
+
+        FoldBox(param, &newPos[X], &newPos[Y], &newPos[Z]);
+
 /*
- *                      This should be a global operation
- *                      distributed out to remote domains only
- *                      if the segment spans domains.
+ *          This should be a global operation distributed
+ *          out to remote domains only if the neighbor node
+ *          is in another domain.
  */
-                        globalOp = (nbr1->myTag.domainID !=
-                                    node->myTag.domainID);
+        globalOp = (nbr->myTag.domainID != node->myTag.domainID);
 #ifdef _OP_REC
-						if (globalOp == 0) globalOp = 2;
+			if (globalOp == 0) globalOp = 2;
 #endif
-        
-                        nodePos[X] = node->x;
-                        nodePos[Y] = node->y;
-                        nodePos[Z] = node->z;
-        
-                        nodeVel[X] = node->vX;
-                        nodeVel[Y] = node->vY;
-                        nodeVel[Z] = node->vZ;
-        
-                        oldTag1 = node->myTag;
-                        oldTag2 = nbr1->myTag;
-
-                        splitStatus = SplitNode(home, OPCLASS_REMESH,
-                                                node, nodePos, newPos,
-                                                nodeVel, newVel,
-                                                armCount, armList,
-                                                globalOp, &splitNode1,
-                                                &splitNode2, 0);
-        
-                        if (splitStatus == SPLIT_SUCCESS) {
 
-                            localRefineCnt++;
+        nodePos[X] = node->x;
+        nodePos[Y] = node->y;
+        nodePos[Z] = node->z;
+
+        nodeVel[X] = node->vX;
+        nodeVel[Y] = node->vY;
+        nodeVel[Z] = node->vZ;
+
+        oldTag1 = node->myTag;
+        oldTag2 = nbr->myTag;
+
+        splitStatus = SplitNode(home, OPCLASS_REMESH,
+                                node, nodePos, newPos,
+                                nodeVel, newVel,
+                                armCount, armList,
+                                globalOp, &splitNode1,
+                                &splitNode2, 0);
+
+        if (splitStatus == SPLIT_SUCCESS) {
 
-                            node = splitNode1;
 /*
- *                          The force estimates above are good enough for
- *                          the remainder of this timestep, but mark the
- *                          force and velocity data for some nodes as
- *                          obsolete so that more accurate forces will be
- *                          recalculated either at the end of this timestep,
- *                          or the beginning of the next.
+ *              The force estimates above are good enough for the
+ *              remainder of this timestep, but mark the force and
+ *              velocity data for some nodes as obsolete so that
+ *              more accurate forces will be recalculated either at
+ *              the end of this timestep, or the beginning of the next.
  */
-                            MarkNodeForceObsolete(home, splitNode1);
-                            MarkNodeForceObsolete(home, splitNode1);
-                            MarkNodeForceObsolete(home, nbr1);
-        
+            MarkNodeForceObsolete(home, splitNode1);
+            MarkNodeForceObsolete(home, splitNode2);
+            MarkNodeForceObsolete(home, nbr);
+
 /*
- *                          Reset nodal forces on all nodes involved
- *                          in the split.
+ *              Reset nodal forces on all nodes involved
+ *              in the split.
  */
-                            ResetSegForces(home, splitNode1, &splitNode2->myTag,
-                                           f0seg1[X], f0seg1[Y], f0seg1[Z], 1);
-        
-                            ResetSegForces(home, splitNode2, &splitNode1->myTag,
-                                           f1seg1[X], f1seg1[Y], f1seg1[Z], 1);
-        
-                            ResetSegForces(home, splitNode2, &nbr1->myTag,
-                                           f0seg2[X], f0seg2[Y], f0seg2[Z], 1);
-        
-                            ResetSegForces(home, nbr1, &splitNode2->myTag,
-                                           f1seg2[X], f1seg2[Y], f1seg2[Z], 1);
-        
-                            (void)EvaluateMobility(home, splitNode1);
-                            (void)EvaluateMobility(home, splitNode2);
-                            (void)EvaluateMobility(home, nbr1);
-        
+            ResetSegForces(home, splitNode1, &splitNode2->myTag,
+                           f0seg1[X], f0seg1[Y], f0seg1[Z], 1);
+
+            ResetSegForces(home, splitNode2, &splitNode1->myTag,
+                           f1seg1[X], f1seg1[Y], f1seg1[Z], 1);
+
+            ResetSegForces(home, splitNode2, &nbr->myTag,
+                           f0seg2[X], f0seg2[Y], f0seg2[Z], 1);
+
+            ResetSegForces(home, nbr, &splitNode2->myTag,
+                           f1seg2[X], f1seg2[Y], f1seg2[Z], 1);
+
+            (void)EvaluateMobility(home, splitNode1);
+            (void)EvaluateMobility(home, splitNode2);
+            (void)EvaluateMobility(home, nbr);
+
 /*
- *                          When debugging, dump some info on
- *                          topological changes taking place and
- *                          the nodes involved
+ *              When debugging, dump some info on
+ *              topological changes taking place and
+ *              the nodes involved
  */
 #ifdef DEBUG_TOPOLOGY_CHANGES
-                            if ((dbgDom < 0) || (dbgDom == home->myDomain)) {
-                                printf("Remesh/refine3:  (%d,%d)--(%d,%d) ==> "
-                                       "(%d,%d)--(%d,%d)--(%d,%d)\n",
-                                       oldTag1.domainID, oldTag1.index,
-                                       oldTag2.domainID, oldTag2.index,
-                                       splitNode1->myTag.domainID,
-                                       splitNode1->myTag.index,
-                                       splitNode2->myTag.domainID,
-                                       splitNode2->myTag.index,
-                                       nbr1->myTag.domainID,
-                                       nbr1->myTag.index);
-                                PrintNode(splitNode1);
-                                PrintNode(splitNode2);
-                                PrintNode(nbr1);
-                            }
+            if ((dbgDom < 0) || (dbgDom == thisDomain)) {
+                printf("Remesh/refine1:  (%d,%d)--(%d,%d) ==> "
+                       "(%d,%d)--(%d,%d)--(%d,%d)\n",
+                       oldTag1.domainID, oldTag1.index,
+                       oldTag2.domainID, oldTag2.index,
+                       splitNode1->myTag.domainID,
+                       splitNode1->myTag.index,
+                       splitNode2->myTag.domainID,
+                       splitNode2->myTag.index,
+                       nbr->myTag.domainID,
+                       nbr->myTag.index);
+                PrintNode(splitNode1);
+                PrintNode(splitNode2);
+                PrintNode(nbr);
+            }
 #endif
-                        }
-                    } else armIndex++;
+        }  /* if (splitStatus == SPLIT_SUCCESS) */
+
+        return((splitStatus == SPLIT_SUCCESS) ? splitNode2 : (Node_t *)NULL);
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:    MeshRefine
+ *      Description: Bisect the discretization segments that are too
+ *                   long or that enclose too large an area with their
+ *                   neighbors.
+ *
+ *------------------------------------------------------------------------*/
+static void MeshRefine(Home_t *home)
+{
+        int              i, numNodes, numItems, maxItems;
+        int              localRefineCnt, globalRefineCnt;
+        Node_t           *node, *newNode;
+        RefineItem_t     *items;
+        RemeshSchedule_t sched;
+        RemeshRound_t    round;
+
+        localRefineCnt = 0;
+        globalRefineCnt = 0;
+
+        sched.claim = (int *)NULL;
+        sched.done  = (int *)NULL;
+        sched.stale = (int *)NULL;
+        sched.size  = 0;
+        sched.round = 0;
+
+        maxItems = 0;
+        items = (RefineItem_t *)NULL;
+
+/*
+ *      Loop through all the  native nodes looking for segments
+ *      that need to be refined.  Nodes created by a bisection are
+ *      evaluated in a later round, as are multi-arm nodes that were
+ *      split (their new arm may still be too long).
+ */
+        do {
+            ScheduleUpdate(home, &sched);
+            sched.round++;
+            numItems = 0;
+            numNodes = home->newNodeKeyPtr;
+
+            for (i = 0; i < numNodes; i++) {
+
+                node = home->nodeKeys[i];
+                if ((node == (Node_t *)NULL) || sched.done[i]) continue;
+
+                if (NeighborhoodClaimed(home, &sched, node)) continue;
+
+                sched.done[i] = 1;
+
+                if (RefineCandidate(home, &sched, node, &items, &numItems,
+                                    &maxItems) > 0) {
+                    (void)ClaimNeighborhoods(home, &sched, &node, 1);
                 }
             }
-        }
+
+            round.home  = home;
+            round.items = items;
+            RemeshParallelFor(numItems, RefineEstimate, &round);
+
+            for (i = 0; i < numItems; i++) {
+
+                newNode = BisectSegment(home, &items[i]);
+                if (newNode == (Node_t *)NULL) continue;
+
+                localRefineCnt++;
+
+                ScheduleUpdate(home, &sched);
+                sched.done[newNode->myTag.index] = 0;
+                sched.stale[newNode->myTag.index] = 1;
+                sched.claim[newNode->myTag.index] = sched.round;
+
+                if (items[i].node->numNbrs != 2) {
+                    sched.done[items[i].node->myTag.index] = 0;
+                }
+            }
+
+        } while (numItems > 0);
+
+        free(items);
+        free(sched.claim);
+        free(sched.done);
+        free(sched.stale);
+
+        ProfileCount(PROFILE_REMESH_OPS, localRefineCnt);
         
 #ifdef DEBUG_LOG_MESH_REFINE
 #ifdef PARALLEL
@@ -1059,13 +1316,6 @@ static void MeshRefine(Home_t *home)
  *------------------------------------------------------------------------*/
 void RemeshRule_2(Home_t *home)
 {
-
-#ifdef DEBUG_TOPOLOGY_DOMAIN
-        dbgDom = DEBUG_TOPOLOGY_DOMAIN;
-#else
-        dbgDom = -1;
-#endif
-
         MeshCoarsen(home);
         MeshRefine(home);
 
@@ -0,0 +1,603 @@
+/*****************************************************************************
+ *
+ *      Module:         Topology.c
+ *      Description:    This module contains the generic functions used
+ *                      by the remesh (and other topological) operations
+ *                      to split and merge nodes.  Only native nodes of
+ *                      a single domain are handled; operations on
+ *                      remote nodes are refused.
+ *
+ *      Included functions:
+ *              EvaluateMobility()
+ *              InitTopologyExemptions()
+ *              MergeNode()
+ *              RemoveDoubleLinks()
+ *              RemoveOrphanedNodes()
+ *              SplitNode()
+ *
+ *****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "Home.h"
+#include "Util.h"
+#include "Topology.h"
+
+/*
+ *      Burgers vectors with a squared magnitude below this are zero
+ */
+#define BURG_EPS2 1.0e-12
+
+
+/*---------------------------------------------------------------------------
+ *
+ *      Function:       EvaluateMobility
+ *      Description:    This function provides a way to invoke the proper
+ *                      mobility functions for specific nodes rather than
+ *                      looping through all the nodes native to the current
+ *                      domain.  If no mobility function has been set
+ *                      (param->mobilityFunc), the velocity assigned to
+ *                      the node by the caller is kept.
+ *
+ *      Arguments:
+ *              nodeA   Pointer to the node to evaluate
+ *
+ *      Returns:
+ *              0 if there were no errors
+ *              1 if the mobility function failed
+ *
+ *-------------------------------------------------------------------------*/
+int EvaluateMobility(Home_t *home, Node_t *nodeA)
+{
+        if (nodeA->constraint == PINNED_NODE) {
+            nodeA->vX = 0.0;
+            nodeA->vY = 0.0;
+            nodeA->vZ = 0.0;
+            return(0);
+        }
+
+        if (home->param->mobilityFunc == NULL) {
+            return(0);
+        }
+
+        return(home->param->mobilityFunc(home, nodeA) != 0);
+}
+
+
+/*---------------------------------------------------------------------------
+ *
+ *      Function:       InitTopologyExemptions
+ *      Description:    Clear the flags that exempt native nodes from
+ *                      collisions and mesh coarsening.  Called at the
+ *                      start of each set of topological operations.
+ *
+ *      Returns:        the number of native nodes
+ *
+ *-------------------------------------------------------------------------*/
+int InitTopologyExemptions(Home_t *home)
+{
+        int i;
+
+        for (i = 0; i < home->numActiveNodes; i++) {
+            home->activeNodes[i]->flags &= ~(NO_COLLISIONS | NO_MESH_COARSEN);
+        }
+
+        return(home->numActiveNodes);
+}
+
+
+/*---------------------------------------------------------------------------
+ *
+ *      Function:       RemoveDoubleLinks
+ *      Description:    Combine multiple arms between <node> and the same
+ *                      neighbor into a single arm carrying the sum of
+ *                      their burgers vectors, or remove them all if the
+ *                      sum vanishes.  The neighbor's arms are updated
+ *                      to match.  Nodes left without arms are not
+ *                      removed here (see RemoveOrphanedNodes()).
+ *
+ *      Arguments:
+ *              node            node to check
+ *              globalOp        set to 1 if the changes must be passed on
+ *                              to remote domains
+ *
+ *      Returns:        1 if any double link was found, 0 otherwise
+ *
+ *-------------------------------------------------------------------------*/
+int RemoveDoubleLinks(Home_t *home, Node_t *node, int globalOp)
+{
+        int    i, j, found;
+        real8  bx, by, bz, nx, ny, nz;
+        Tag_t  nbrTag;
+        Node_t *nbr;
+
+        found = 0;
+        i = 0;
+
+        while (i < node->numNbrs) {
+
+            nbrTag = node->nbrTag[i];
+
+            for (j = i + 1; j < node->numNbrs; j++) {
+                if ((node->nbrTag[j].domainID == nbrTag.domainID) &&
+                    (node->nbrTag[j].index == nbrTag.index)) {
+                    break;
+                }
+            }
+
+            if (j >= node->numNbrs) {
+                i++;
+                continue;
+            }
+
+            found = 1;
+
+            bx = node->burgX[i] + node->burgX[j];
+            by = node->burgY[i] + node->burgY[j];
+            bz = node->burgZ[i] + node->burgZ[j];
+            nx = node->nx[i];
+            ny = node->ny[i];
+            nz = node->nz[i];
+
+            if (bx*bx + by*by + bz*bz < BURG_EPS2) {
+                bx = 0.0;
+                by = 0.0;
+                bz = 0.0;
+            }
+
+/*
+ *          Drop both links (ChangeArmBurg removes the first arm found)
+ *          and put back the combined one if it does not vanish.
+ */
+            nbr = GetNodeFromTag(home, nbrTag);
+
+            ChangeArmBurg(home, node, &nbrTag, 0.0, 0.0, 0.0,
+                          0.0, 0.0, 0.0, globalOp, DEL_SEG_NONE);
+            ChangeArmBurg(home, node, &nbrTag, 0.0, 0.0, 0.0,
+                          0.0, 0.0, 0.0, globalOp, DEL_SEG_NONE);
+
+            if (nbr != (Node_t *)NULL) {
+                ChangeArmBurg(home, nbr, &node->myTag, 0.0, 0.0, 0.0,
+                              0.0, 0.0, 0.0, globalOp, DEL_SEG_NONE);
+                ChangeArmBurg(home, nbr, &node->myTag, 0.0, 0.0, 0.0,
+                              0.0, 0.0, 0.0, globalOp, DEL_SEG_NONE);
+            }
+
+            if ((bx != 0.0) || (by != 0.0) || (bz != 0.0)) {
+                InsertArm(home, node, &nbrTag, bx, by, bz,
+                          nx, ny, nz, globalOp);
+                if (nbr != (Node_t *)NULL) {
+                    InsertArm(home, nbr, &node->myTag, -bx, -by, -bz,
+                              nx, ny, nz, globalOp);
+                }
+            }
+
+            MarkNodeForceObsolete(home, node);
+            if (nbr != (Node_t *)NULL) MarkNodeForceObsolete(home, nbr);
+
+/*
+ *          The arms before <i> are unchanged, so the scan continues
+ *          at <i> with the arms shifted into its place.
+ */
+        }
+
+        return(found);
+}
+
+
+/*---------------------------------------------------------------------------
+ *
+ *      Function:       RemoveOrphanedNodes
+ *      Description:    Remove all native nodes that have no arms left.
+ *
+ *-------------------------------------------------------------------------*/
+void RemoveOrphanedNodes(Home_t *home)
+{
+        int    i;
+        Node_t *node;
+
+        i = 0;
+
+        while (i < home->numActiveNodes) {
+            node = home->activeNodes[i];
+            if (node->numNbrs == 0) {
+/*
+ *              RemoveNode() moves the last active node into slot i
+ */
+                RemoveNode(home, node, 1);
+                continue;
+            }
+            i++;
+        }
+
+        return;
+}
+
+
+/*---------------------------------------------------------------------------
+ *
+ *      Function:       MergeNode
+ *      Description:    This function 'merges' two nodes by moving all
+ *                      arms of <deadNode> to <targetNode>, and then
+ *                      completely removing <deadNode>.  If the merge
+ *                      resulted in self-links from <targetNode> back
+ *                      to itself, or multiple links from <targetNode>
+ *                      to any other single node, these redundant links
+ *                      will be dealt with before returning to the caller.
+ *
+ *                      <node2> is kept as the target node unless only
+ *                      <node1> is pinned.  A pinned target node is not
+ *                      repositioned.
+ *
+ *      Arguments:
+ *              opClass         Flag indicating the class of topological
+ *                              operation invoking this function.
+ *                              Valid types are:
+ *
+ *                                  OPCLASS_SEPARATION
+ *                                  OPCLASS_COLLISION
+ *                                  OPCLASS_REMESH
+ *
+ *              node1           pointer to first node to be merged
+ *              node2           pointer to second node to be merged
+ *              position        coordinates (x,y,z) at which final merged
+ *                              node is to be placed.
+ *              mergedNode      pointer to location in which to return
+ *                              pointer to the node resulting from the merge.
+ *                              A NULL pointer will be returned if the
+ *                              the merge fails or the merged node was
+ *                              left without arms and removed.
+ *              status          pointer to location in which to return
+ *                              a completion status to the caller.  Valid
+ *                              statuses are the following, where all statuses
+ *                              indicating success may be logically OR'ed
+ *
+ *                                  MERGE_SUCCESS
+ *                                  MERGE_NO_REPOSITION
+ *                                  MERGE_NODE_ORPHANED
+ *                                  MERGE_NOT_PERMITTED
+ *                                  MERGE_DOUBLE_LINK
+ *
+ *              globalOp        Flag indicating if this is a global operation
+ *                              that should be added to the list of ops
+ *                              distributed to neighboring domains.
+ *
+ *-------------------------------------------------------------------------*/
+void MergeNode(Home_t *home, int opClass, Node_t *node1, Node_t *node2,
+               real8 *position, Node_t **mergedNode, int *status, int globalOp)
+{
+        int    arm;
+        real8  bx, by, bz, nx, ny, nz;
+        Tag_t  deadTag, targetTag, nbrTag;
+        Node_t *targetNode, *deadNode, *nbr;
+
+/*
+ *      The operation class does not change the merge itself, it is kept
+ *      for the ParaDiS interface.
+ */
+        (void)opClass;
+
+        *mergedNode = (Node_t *)NULL;
+        *status = 0;
+
+        if ((node1 == (Node_t *)NULL) || (node2 == (Node_t *)NULL) ||
+            (node1 == node2)) {
+            *status = MERGE_NOT_PERMITTED;
+            return;
+        }
+
+        if ((node1->myTag.domainID != home->myDomain) ||
+            (node2->myTag.domainID != home->myDomain)) {
+            *status = MERGE_NOT_PERMITTED;
+            return;
+        }
+
+        if ((node1->constraint == PINNED_NODE) &&
+            (node2->constraint == PINNED_NODE)) {
+            *status = MERGE_NOT_PERMITTED;
+            return;
+        }
+
+        if (node1->constraint == PINNED_NODE) {
+            targetNode = node1;
+            deadNode   = node2;
+        } else {
+            targetNode = node2;
+            deadNode   = node1;
+        }
+
+        targetTag = targetNode->myTag;
+        deadTag   = deadNode->myTag;
+
+/*
+ *      Move the arms of the dead node to the target node.  Arms
+ *      between the two nodes become self-links and are dropped.
+ */
+        for (arm = 0; arm < deadNode->numNbrs; arm++) {
+
+            nbrTag = deadNode->nbrTag[arm];
+
+            if ((nbrTag.domainID == targetTag.domainID) &&
+                (nbrTag.index == targetTag.index)) {
+                continue;
+            }
+
+            bx = deadNode->burgX[arm];
+            by = deadNode->burgY[arm];
+            bz = deadNode->burgZ[arm];
+            nx = deadNode->nx[arm];
+            ny = deadNode->ny[arm];
+            nz = deadNode->nz[arm];
+
+            InsertArm(home, targetNode, &nbrTag, bx, by, bz,
+                      nx, ny, nz, globalOp);
+
+            nbr = GetNodeFromTag(home, nbrTag);
+            if (nbr != (Node_t *)NULL) {
+                ChangeConnection(home, nbr, &deadTag, &targetTag, globalOp);
+                MarkNodeForceObsolete(home, nbr);
+            }
+        }
+
+        while (GetArmID(home, targetNode, deadNode) >= 0) {
+            ChangeArmBurg(home, targetNode, &deadTag, 0.0, 0.0, 0.0,
+                          0.0, 0.0, 0.0, globalOp, DEL_SEG_NONE);
+        }
+
+        deadNode->numNbrs = 0;
+        RemoveNode(home, deadNode, globalOp);
+
+/*
+ *      Place the merged node, unless it is pinned.
+ */
+        if (targetNode->constraint == PINNED_NODE) {
+            if ((position[X] != targetNode->x) ||
+                (position[Y] != targetNode->y) ||
+                (position[Z] != targetNode->z)) {
+                *status |= MERGE_NO_REPOSITION;
+            }
+        } else {
+            RepositionNode(home, position, &targetTag, globalOp);
+        }
+
+        (void)RemoveDoubleLinks(home, targetNode, globalOp);
+
+        MarkNodeForceObsolete(home, targetNode);
+        *status |= MERGE_SUCCESS;
+
+        if (targetNode->numNbrs == 0) {
+            RemoveNode(home, targetNode, globalOp);
+            return;
+        }
+
+        *mergedNode = targetNode;
+
+        return;
+}
+
+
+/*---------------------------------------------------------------------------
+ *
+ *      Function:       SplitNode
+ *      Description:    Create a new node and transfer the specified set of
+ *                      connections from an existing to to the new node.  If
+ *                      necessary, a new link will also be created between the
+ *                      existing node and the new node.
+ *
+ *      Arguments:
+ *              node            Pointer to the node to be split
+ *              pos1            coordinates at which splitNode1 will be
+ *                              left after the split
+ *              pos2            coordinates at which splitNode2 will be
+ *                              left after the split
+ *              vel1            velocity assigned to splitNode1 after the split
+ *              vel2            velocity assigned to splitNode2 after the split
+ *              armCount        number of arms of the original node selected
+ *                              to be split off.
+ *              armList         pointer to array of integers indicating the
+ *                              arms of existing node that are to be split off
+ *              globalOp        Flag indicating if this is a global operation
+ *                              that should be added to the list of ops
+ *                              distributed to neighboring domains.
+ *              splitNode1      ptr to ptr to node to which all unselected arms
+ *                              of the original node will be attached after the
+ *                              split.  Returned to caller.
+ *              splitNode2      ptr to ptr to node to which all selected arms
+ *                              of the original node will be attached after the
+ *                              after the split.  Returned to caller.
+ *              flags           Bit field with additional processing flags
+ *
+ *      Returns:                SPLIT_SUCCESS if the split was successful
+ *                              SPLIT_FAILED in all other cases
+ *
+ *-------------------------------------------------------------------------*/
+int SplitNode(Home_t *home, int opClass, Node_t *node, real8 *pos1,
+              real8 *pos2, real8 *vel1, real8 *vel2, int armCount,
+              int *armList, int globalOp, Node_t **splitNode1,
+              Node_t **splitNode2, int flags)
+{
+        int    i, j, arm, *moved;
+        real8  bx, by, bz, nx, ny, nz, len2;
+        real8  plane[3], burg[3], dir[3], nvec[3];
+        Tag_t  newTag, nbrTag, *movedTags;
+        Node_t *newNode, *nbr;
+
+/*
+ *      The operation class does not change the split itself, it is kept
+ *      for the ParaDiS interface.
+ */
+        (void)opClass;
+
+        *splitNode1 = (Node_t *)NULL;
+        *splitNode2 = (Node_t *)NULL;
+
+        if ((node->myTag.domainID != home->myDomain) ||
+            (armCount <= 0) || (armCount > node->numNbrs)) {
+            return(SPLIT_FAILED);
+        }
+
+        for (i = 0; i < armCount; i++) {
+            if ((armList[i] < 0) || (armList[i] >= node->numNbrs)) {
+                return(SPLIT_FAILED);
+            }
+        }
+
+        moved = (int *)calloc(node->numNbrs, sizeof(int));
+        movedTags = (Tag_t *)malloc(armCount * sizeof(Tag_t));
+        if ((moved == (int *)NULL) || (movedTags == (Tag_t *)NULL)) {
+            Fatal("SplitNode: out of memory (%d arms)", node->numNbrs);
+        }
+
+        newTag.domainID = home->myDomain;
+        newTag.index    = GetFreeNodeTag(home);
+        newNode = RequestNewNativeNodeTag(home, &newTag);
+        newTag  = newNode->myTag;
+
+        if (globalOp) {
+            AddOp(home, SPLIT_NODE,
+                node->myTag.domainID,
+                node->myTag.index,
+                newTag.domainID,
+                newTag.index,
+                -1, -1,
+                0.0, 0.0, 0.0,  /* bx, by, bz */
+                pos2[X], pos2[Y], pos2[Z],
+                vel2[X], vel2[Y], vel2[Z]);
+        }
+
+        newNode->x = pos2[X];
+        newNode->y = pos2[Y];
+        newNode->z = pos2[Z];
+
+        newNode->oldx = pos2[X];
+        newNode->oldy = pos2[Y];
+        newNode->oldz = pos2[Z];
+
+        newNode->vX = vel2[X];
+        newNode->vY = vel2[Y];
+        newNode->vZ = vel2[Z];
+
+        newNode->oldvX = vel2[X];
+        newNode->oldvY = vel2[Y];
+        newNode->oldvZ = vel2[Z];
+
+        newNode->constraint = 0;
+        newNode->native = 1;
+        newNode->numNbrs = 0;
+
+        if ((flags & SPLIT_DUP_SURFACE_PROP) &&
+            (node->constraint == SURFACE_NODE)) {
+            newNode->constraint = SURFACE_NODE;
+        }
+
+        newNode->flags |= NODE_TOPO_CHANGED;
+
+        node->x = pos1[X];
+        node->y = pos1[Y];
+        node->z = pos1[Z];
+
+        node->vX = vel1[X];
+        node->vY = vel1[Y];
+        node->vZ = vel1[Z];
+
+        node->flags |= NODE_TOPO_CHANGED;
+
+/*
+ *      Copy the selected arms to the new node and point their far
+ *      ends at it.  The arms are deleted from the original node
+ *      afterwards, so the indices in armList stay valid meanwhile.
+ */
+        burg[X] = 0.0;
+        burg[Y] = 0.0;
+        burg[Z] = 0.0;
+
+        plane[X] = 0.0;
+        plane[Y] = 0.0;
+        plane[Z] = 0.0;
+
+        j = 0;
+
+        for (i = 0; i < armCount; i++) {
+
+            arm = armList[i];
+            if (moved[arm]) continue;
+            moved[arm] = 1;
+
+            nbrTag = node->nbrTag[arm];
+            movedTags[j++] = nbrTag;
+
+            bx = node->burgX[arm];
+            by = node->burgY[arm];
+            bz = node->burgZ[arm];
+            nx = node->nx[arm];
+            ny = node->ny[arm];
+            nz = node->nz[arm];
+
+            burg[X] += bx;
+            burg[Y] += by;
+            burg[Z] += bz;
+
+            if (i == 0) {
+                plane[X] = nx;
+                plane[Y] = ny;
+                plane[Z] = nz;
+            }
+
+            InsertArm(home, newNode, &nbrTag, bx, by, bz, nx, ny, nz,
+                      globalOp);
+
+            newNode->armfx[newNode->numNbrs-1] = node->armfx[arm];
+            newNode->armfy[newNode->numNbrs-1] = node->armfy[arm];
+            newNode->armfz[newNode->numNbrs-1] = node->armfz[arm];
+
+            nbr = GetNodeFromTag(home, nbrTag);
+            if (nbr != (Node_t *)NULL) {
+                ChangeConnection(home, nbr, &node->myTag, &newTag, globalOp);
+            }
+        }
+
+        for (i = 0; i < j; i++) {
+            ChangeArmBurg(home, node, &movedTags[i], 0.0, 0.0, 0.0,
+                          0.0, 0.0, 0.0, globalOp, DEL_SEG_NONE);
+        }
+
+/*
+ *      If the moved arms carry a net burgers vector, connect the
+ *      two nodes with a segment that conserves it.  Its glide plane
+ *      is b x l unless the segment is screw, in which case the plane
+ *      of the first moved arm is kept.
+ */
+        if (burg[X]*burg[X] + burg[Y]*burg[Y] + burg[Z]*burg[Z] >= BURG_EPS2) {
+
+            dir[X] = pos2[X] - pos1[X];
+            dir[Y] = pos2[Y] - pos1[Y];
+            dir[Z] = pos2[Z] - pos1[Z];
+            ZImage(home->param, &dir[X], &dir[Y], &dir[Z]);
+
+            len2 = DotProduct(dir, dir);
+            cross(burg, dir, nvec);
+
+            if (DotProduct(nvec, nvec) > 1.0e-6 * DotProduct(burg, burg) * len2) {
+                NormalizeVec(nvec);
+                plane[X] = nvec[X];
+                plane[Y] = nvec[Y];
+                plane[Z] = nvec[Z];
+            }
+
+            InsertArm(home, node, &newTag, burg[X], burg[Y], burg[Z],
+                      plane[X], plane[Y], plane[Z], globalOp);
+            InsertArm(home, newNode, &node->myTag, -burg[X], -burg[Y],
+                      -burg[Z], plane[X], plane[Y], plane[Z], globalOp);
+        }
+
+        free(movedTags);
+        free(moved);
+
+        MarkNodeForceObsolete(home, node);
+        MarkNodeForceObsolete(home, newNode);
+
+        *splitNode1 = node;
+        *splitNode2 = newNode;
+
+        return(SPLIT_SUCCESS);
+}
@@ -0,0 +1,414 @@
+/*
+ *      Microbenchmark of the core force, stress and distance kernels
+ *
+ *      The segment pairs of the test1_node_force reference data
+ *      (segsep_min_2.5_max_32.5_iso_randombvecs_a0.010.dat) are cycled
+ *      through each kernel, split over 1, 2, 4, ... threads up to the
+ *      maximum, and the time per pair and the pair rate are reported.
+ *      The forces of SegSegForce are checked against the reference
+ *      forces of the data file before timing.
+ *
+ *      Built with hardware counters (PYDIS_HWCOUNTERS) a single thread
+ *      run of each kernel is also counted, and the flops, last level
+ *      cache traffic and arithmetic intensity per pair are reported.
+ *
+ *      Usage:  bench_kernels [-n pairs] [-t maxThreads] [-r repeats]
+ *                            [dataFile]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../calforce/SegSegForce.h"
+#include "../calforce/SegSegForce_SBN1.h"
+#include "../calforce/StressDueToSeg.h"
+#include "../calforce/SegmentStress.h"
+#include "../collision/GetMinDist2Batch.h"
+#include "../include/Profile.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#ifndef BENCH_SOURCE_ROOT
+#define BENCH_SOURCE_ROOT ../../../..
+#endif
+
+#define XSTRING(s) STRING(s)
+#define STRING(s) #s
+
+#define BENCH_DATA_FILE "tests/test1_node_force/segsep_min_2.5_max_32.5_iso_randombvecs_a0.010.dat"
+#define BENCH_MAX_PAIRS 10000
+#define BENCH_MU        50.0
+#define BENCH_NU        0.3
+#define BENCH_A         0.01
+
+/*
+ *      Pair data: p1, p2, p3, p4, b12, b34 and the reference forces on
+ *      the four points
+ */
+typedef struct {
+        real8 p[4][3];
+        real8 b12[3], b34[3];
+        real8 fref[4][3];
+} BenchPair_t;
+
+typedef real8 (*BenchKernel_t)(BenchPair_t *pair, void *context);
+
+static int ReadPairs(const char *fileName, BenchPair_t *pairs, int maxPairs)
+{
+        int   numPairs, k, n;
+        real8 v[30];
+        char  line[4096], *p, *q;
+        FILE  *fp;
+
+        if ((fp = fopen(fileName, "r")) == (FILE *)NULL) {
+            fprintf(stderr, "bench_kernels: cannot open %s\n", fileName);
+            exit(1);
+        }
+
+        numPairs = 0;
+        while (numPairs < maxPairs && fgets(line, sizeof(line), fp) != NULL) {
+            if (line[0] == '#') continue;
+            p = line;
+            for (n = 0; n < 30; n++) {
+                v[n] = strtod(p, &q);
+                if (q == p) break;
+                p = q;
+            }
+            if (n < 30) continue;
+            for (k = 0; k < 12; k++) pairs[numPairs].p[k/3][k%3] = v[k];
+            for (k = 0; k < 3; k++) {
+                pairs[numPairs].b12[k] = v[12+k];
+                pairs[numPairs].b34[k] = v[15+k];
+            }
+            for (k = 0; k < 12; k++) pairs[numPairs].fref[k/3][k%3] = v[18+k];
+            numPairs++;
+        }
+
+        fclose(fp);
+
+        return(numPairs);
+}
+
+
+static real8 WallTime(void)
+{
+        struct timespec ts;
+
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+
+        return((real8)ts.tv_sec + 1.0e-9 * (real8)ts.tv_nsec);
+}
+
+
+/*
+ *      The kernels, each returning a sum of its results so that the
+ *      calls cannot be optimized away
+ */
+static real8 KernelSegSegForce(BenchPair_t *q, void *context)
+{
+        real8 f[12];
+
+        SegSegForce(q->p[0][0], q->p[0][1], q->p[0][2],
+                    q->p[1][0], q->p[1][1], q->p[1][2],
+                    q->p[2][0], q->p[2][1], q->p[2][2],
+                    q->p[3][0], q->p[3][1], q->p[3][2],
+                    q->b12[0], q->b12[1], q->b12[2],
+                    q->b34[0], q->b34[1], q->b34[2],
+                    BENCH_A, BENCH_MU, BENCH_NU, 1, 1,
+                    &f[0], &f[1], &f[2], &f[3], &f[4], &f[5],
+                    &f[6], &f[7], &f[8], &f[9], &f[10], &f[11]);
+
+        return(f[0] + f[4] + f[8] + f[11]);
+}
+
+
+static real8 KernelSpecialSegSegForce(BenchPair_t *q, void *context)
+{
+        real8 f[12];
+
+        SpecialSegSegForce(q->p[0][0], q->p[0][1], q->p[0][2],
+                           q->p[1][0], q->p[1][1], q->p[1][2],
+                           q->p[2][0], q->p[2][1], q->p[2][2],
+                           q->p[3][0], q->p[3][1], q->p[3][2],
+                           q->b12[0], q->b12[1], q->b12[2],
+                           q->b34[0], q->b34[1], q->b34[2],
+                           BENCH_A, BENCH_MU, BENCH_NU, 1.0e-4, 1, 1,
+                           &f[0], &f[1], &f[2], &f[3], &f[4], &f[5],
+                           &f[6], &f[7], &f[8], &f[9], &f[10], &f[11]);
+
+        return(f[0] + f[4] + f[8] + f[11]);
+}
+
+
+static real8 KernelSegSegForceSBN1(BenchPair_t *q, void *context)
+{
+        real8 f[12];
+
+        SegSegForce_SBN1_Ctx(q->p[0][0], q->p[0][1], q->p[0][2],
+                             q->p[1][0], q->p[1][1], q->p[1][2],
+                             q->p[2][0], q->p[2][1], q->p[2][2],
+                             q->p[3][0], q->p[3][1], q->p[3][2],
+                             q->b12[0], q->b12[1], q->b12[2],
+                             q->b34[0], q->b34[1], q->b34[2],
+                             BENCH_A, BENCH_MU, BENCH_NU,
+                             (SBN1Context_t *)context, 1, 1,
+                             &f[0], &f[1], &f[2], &f[3], &f[4], &f[5],
+                             &f[6], &f[7], &f[8], &f[9], &f[10], &f[11]);
+
+        return(f[0] + f[4] + f[8] + f[11]);
+}
+
+
+/*
+ *      Stress of segment p1-p2 at the midpoint of p3-p4
+ */
+static real8 KernelStressDueToSeg(BenchPair_t *q, void *context)
+{
+        real8 s[6];
+
+        StressDueToSeg(0.5 * (q->p[2][0] + q->p[3][0]),
+                       0.5 * (q->p[2][1] + q->p[3][1]),
+                       0.5 * (q->p[2][2] + q->p[3][2]),
+                       q->p[0][0], q->p[0][1], q->p[0][2],
+                       q->p[1][0], q->p[1][1], q->p[1][2],
+                       q->b12[0], q->b12[1], q->b12[2],
+                       BENCH_A, BENCH_MU, BENCH_NU, s);
+
+        return(s[0] + s[3] + s[5]);
+}
+
+
+static real8 KernelSegmentStress(BenchPair_t *q, void *context)
+{
+        real8 s[3][3];
+
+        SegmentStress(BENCH_MU, BENCH_NU, q->b12[0], q->b12[1], q->b12[2],
+                      q->p[0][0], q->p[0][1], q->p[0][2],
+                      q->p[1][0], q->p[1][1], q->p[1][2],
+                      0.5 * (q->p[2][0] + q->p[3][0]),
+                      0.5 * (q->p[2][1] + q->p[3][1]),
+                      0.5 * (q->p[2][2] + q->p[3][2]),
+                      BENCH_A, s);
+
+        return(s[0][0] + s[1][1] + s[0][2]);
+}
+
+
+/*
+ *      Closest approach of the two segments, moving with velocities
+ *      along their Burgers vectors
+ */
+static real8 KernelGetMinDist2(BenchPair_t *q, void *context)
+{
+        real8 dist2, ddist2dt, L1, L2;
+
+        GetMinDist2(q->p[0][0], q->p[0][1], q->p[0][2],
+                    q->b12[0], q->b12[1], q->b12[2],
+                    q->p[1][0], q->p[1][1], q->p[1][2],
+                    q->b12[0], q->b12[1], q->b12[2],
+                    q->p[2][0], q->p[2][1], q->p[2][2],
+                    q->b34[0], q->b34[1], q->b34[2],
+                    q->p[3][0], q->p[3][1], q->p[3][2],
+                    q->b34[0], q->b34[1], q->b34[2],
+                    &dist2, &ddist2dt, &L1, &L2);
+
+        return(dist2 + ddist2dt + L1 + L2);
+}
+
+
+/*
+ *      Time numCalls kernel calls cycling through the pairs on
+ *      numThreads threads; returns the best of the repeats in seconds
+ */
+static real8 TimeKernel(BenchKernel_t kernel, void *context,
+                        BenchPair_t *pairs, int numPairs, long numCalls,
+                        int numThreads, int numRepeats, real8 *checksum)
+{
+        int   r;
+        long  n;
+        real8 t0, elapsed, best, sum;
+
+        best = -1.0;
+
+        for (r = 0; r < numRepeats; r++) {
+            sum = 0.0;
+            t0 = WallTime();
+#pragma omp parallel for schedule(static) num_threads(numThreads) reduction(+:sum)
+            for (n = 0; n < numCalls; n++) {
+                sum += kernel(&pairs[n % numPairs], context);
+            }
+            elapsed = WallTime() - t0;
+            if (best < 0.0 || elapsed < best) best = elapsed;
+            *checksum = sum;
+        }
+
+        return(best);
+}
+
+
+int main(int argc, char **argv)
+{
+        int           i, j, k, numPairs, maxThreads, numThreads, numRepeats;
+        long          numCalls;
+        long long     hw[PROFILE_NUM_PHASES*PROFILE_NUM_HW_COUNTERS];
+        real8         f[4][3], err, maxErr, elapsed, checksum;
+        real8         flops, vecFlops, bytes, cycles, instr;
+        real8         quadPoints[3] = {-0.774596669241483, 0.0,
+                                       0.774596669241483};
+        real8         weights[3] = {0.555555555555556, 0.888888888888889,
+                                    0.555555555555556};
+        char          defaultFile[1024], *dataFile;
+        BenchPair_t   *pairs;
+        SBN1Context_t *sbn1;
+        struct {
+            const char    *name;
+            BenchKernel_t kernel;
+        } kernels[] = {
+            {"SegSegForce",        KernelSegSegForce},
+            {"SpecialSegSegForce", KernelSpecialSegSegForce},
+            {"SegSegForce_SBN1",   KernelSegSegForceSBN1},
+            {"StressDueToSeg",     KernelStressDueToSeg},
+            {"SegmentStress",      KernelSegmentStress},
+            {"GetMinDist2",        KernelGetMinDist2},
+        };
+
+        numCalls = 2000000;
+        numRepeats = 3;
+#ifdef _OPENMP
+        maxThreads = omp_get_max_threads();
+#else
+        maxThreads = 1;
+#endif
+        snprintf(defaultFile, sizeof(defaultFile), "%s/%s",
+                 XSTRING(BENCH_SOURCE_ROOT), BENCH_DATA_FILE);
+        dataFile = defaultFile;
+
+        for (i = 1; i < argc; i++) {
+            if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+                numCalls = atol(argv[++i]);
+            } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+                maxThreads = atoi(argv[++i]);
+            } else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+                numRepeats = atoi(argv[++i]);
+            } else if (argv[i][0] == '-') {
+                fprintf(stderr, "usage: %s [-n pairs] [-t maxThreads] "
+                        "[-r repeats] [dataFile]\n", argv[0]);
+                exit(1);
+            } else {
+                dataFile = argv[i];
+            }
+        }
+
+        if (numCalls < 1) numCalls = 1;
+        if (maxThreads < 1) maxThreads = 1;
+        if (numRepeats < 1) numRepeats = 1;
+
+        pairs = (BenchPair_t *)malloc(BENCH_MAX_PAIRS * sizeof(BenchPair_t));
+        numPairs = ReadPairs(dataFile, pairs, BENCH_MAX_PAIRS);
+        if (numPairs == 0) {
+            fprintf(stderr, "bench_kernels: no segment pairs in %s\n", dataFile);
+            exit(1);
+        }
+
+/*
+ *      Check SegSegForce against the reference forces
+ */
+        maxErr = 0.0;
+        for (i = 0; i < numPairs; i++) {
+            BenchPair_t *q = &pairs[i];
+            SegSegForce(q->p[0][0], q->p[0][1], q->p[0][2],
+                        q->p[1][0], q->p[1][1], q->p[1][2],
+                        q->p[2][0], q->p[2][1], q->p[2][2],
+                        q->p[3][0], q->p[3][1], q->p[3][2],
+                        q->b12[0], q->b12[1], q->b12[2],
+                        q->b34[0], q->b34[1], q->b34[2],
+                        BENCH_A, BENCH_MU, BENCH_NU, 1, 1,
+                        &f[0][0], &f[0][1], &f[0][2], &f[1][0], &f[1][1],
+                        &f[1][2], &f[2][0], &f[2][1], &f[2][2],
+                        &f[3][0], &f[3][1], &f[3][2]);
+            for (j = 0; j < 4; j++) {
+                for (k = 0; k < 3; k++) {
+                    err = fabs(f[j][k] - q->fref[j][k]);
+                    if (err > maxErr) maxErr = err;
+                }
+            }
+        }
+
+        printf("data file:   %s\n", dataFile);
+        printf("pairs:       %d distinct, %ld per run, best of %d runs\n",
+               numPairs, numCalls, numRepeats);
+        printf("SegSegForce max error vs reference: %.3e\n\n", maxErr);
+        if (maxErr > 1.0e-9) {
+            fprintf(stderr, "bench_kernels: SegSegForce does not match the "
+                    "reference forces\n");
+            exit(1);
+        }
+
+        sbn1 = SBN1ContextCreate(3, quadPoints, weights);
+        SBN1ContextSetMaterial(sbn1, BENCH_A, BENCH_MU, BENCH_NU);
+
+        printf("%-20s %8s %12s %14s %14s\n", "kernel", "threads",
+               "ns/pair", "pairs/s", "checksum");
+
+        for (i = 0; i < (int)(sizeof(kernels) / sizeof(kernels[0])); i++) {
+            for (numThreads = 1; ; numThreads *= 2) {
+                if (numThreads > maxThreads) numThreads = maxThreads;
+                elapsed = TimeKernel(kernels[i].kernel, sbn1, pairs, numPairs,
+                                     numCalls, numThreads, numRepeats,
+                                     &checksum);
+                printf("%-20s %8d %12.2f %14.4e %14.6e\n", kernels[i].name,
+                       numThreads, 1.0e9 * elapsed / numCalls,
+                       numCalls / elapsed, checksum);
+                if (numThreads == maxThreads) break;
+            }
+        }
+
+/*
+ *      Roofline summary from the hardware counters of one single
+ *      thread run per kernel.  Memory traffic is estimated as one
+ *      64 byte line per last level cache miss.
+ */
+        ProfileEnable(1);
+        if (ProfileGetHW(hw) == 0) {
+            printf("\nhardware counters: not available\n");
+        } else {
+            printf("\n%-20s %10s %10s %10s %10s %8s %6s\n", "kernel",
+                   "flops/pair", "GFLOP/s", "bytes/pair", "flops/byte",
+                   "vector%", "IPC");
+            for (i = 0; i < (int)(sizeof(kernels) / sizeof(kernels[0])); i++) {
+                ProfileReset();
+                ProfileStart(PROFILE_FORCE);
+                elapsed = TimeKernel(kernels[i].kernel, sbn1, pairs, numPairs,
+                                     numCalls, 1, 1, &checksum);
+                ProfileStop(PROFILE_FORCE);
+                ProfileGetHW(hw);
+                flops = (real8)hw[PROFILE_FORCE*PROFILE_NUM_HW_COUNTERS+PROFILE_HW_DP_OPS];
+                vecFlops = (real8)hw[PROFILE_FORCE*PROFILE_NUM_HW_COUNTERS+PROFILE_HW_DP_VEC_OPS];
+                bytes = 64.0 * (real8)hw[PROFILE_FORCE*PROFILE_NUM_HW_COUNTERS+PROFILE_HW_LLC_MISSES];
+                cycles = (real8)hw[PROFILE_FORCE*PROFILE_NUM_HW_COUNTERS+PROFILE_HW_CYCLES];
+                instr = (real8)hw[PROFILE_FORCE*PROFILE_NUM_HW_COUNTERS+PROFILE_HW_INSTRUCTIONS];
+                printf("%-20s", kernels[i].name);
+                if (flops >= 0.0) {
+                    printf(" %10.1f %10.3f", flops / numCalls,
+                           1.0e-9 * flops / elapsed);
+                } else {
+                    printf(" %10s %10s", "-", "-");
+                }
+                if (bytes >= 0.0) printf(" %10.2f", bytes / numCalls);
+                else printf(" %10s", "-");
+                if (flops >= 0.0 && bytes > 0.0) printf(" %10.1f", flops / bytes);
+                else printf(" %10s", "-");
+                if (flops > 0.0) printf(" %8.1f", 100.0 * vecFlops / flops);
+                else printf(" %8s", "-");
+                if (cycles > 0.0 && instr >= 0.0) printf(" %6.2f\n", instr / cycles);
+                else printf(" %6s\n", "-");
+            }
+        }
+
+        SBN1ContextFree(sbn1);
+        free(pairs);
+
+        return(0);
+}
@@ -0,0 +1,701 @@
+/*
+ *      Consistency tests of the native force kernels and drivers
+ *
+ *      Each test compares a fast path of the force calculation against
+ *      the reference evaluation it replaces on generated segment
+ *      configurations and fails if the difference exceeds the tolerance
+ *      stated with the test.  Differences are measured relative to the
+ *      largest force component of the compared set.
+ *
+ *      Usage:  test_kernels [test ...]
+ *
+ *              Runs the named tests (all if none are given) and exits
+ *              with a non-zero status if any of them fails.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "../calforce/SegSegForce.h"
+#include "../calforce/SegSegForceSIMD.h"
+#include "../calforce/SegSegForceDriver.h"
+
+#define TEST_MU  50.0
+#define TEST_NU  0.3
+#define TEST_A   0.01
+
+/*
+ *      SIMD kernel vs SegSegForce(): SEGSEG_SIMD_RTOL (see
+ *      SegSegForceSIMD.h), for random, near-parallel and antiparallel
+ *      pairs.
+ */
+#define TEST_SIMD_PAIRS 1000
+
+/*
+ *      Cell list and pair list drivers vs SegSegForceAllPairs(): the
+ *      drivers evaluate the same pairs in a different order, so the
+ *      forces agree to summation round-off.
+ */
+#define TEST_DRIVER_RTOL 1.0e-10
+#define TEST_NUM_SEGS    400
+#define TEST_BOX         60.0
+
+/*
+ *      Incremental vs full evaluation: the forces of the unchanged pairs
+ *      are kept and those of the pairs of changed segments subtracted and
+ *      added again.  SegSegForceSubset() evaluates these pairs from the
+ *      side of the changed segment, and the analytic kernel is symmetric
+ *      in the pair order only to round-off amplified for near-parallel
+ *      pairs (as for SEGSEG_SIMD_RTOL), which dominates the error.
+ */
+#define TEST_INCREMENTAL_RTOL 1.0e-8
+#define TEST_NUM_CHANGED      25
+
+/*
+ *      Mixed precision vs double precision pair loops: the single
+ *      precision far pairs have force errors below ~3e-5 rms of their
+ *      own forces (TEST_MIXED_RMS, see SegSegForceSIMD.h); summed into
+ *      the segment forces they stay below TEST_MIXED_RTOL of the
+ *      largest component.
+ */
+#define TEST_MIXED_RTOL     1.0e-5
+#define TEST_MIXED_RMS      3.0e-5
+#define TEST_MIXED_DISTANCE 20.0
+#define TEST_MIXED_BOX      200.0
+
+typedef int (*TestFunc_t)(void);
+
+/*
+ *      Deterministic uniform random numbers on [0,1) so that the
+ *      configurations do not depend on the C library
+ */
+static unsigned long long testSeed = 12345ULL;
+
+static real8 TestRandom(void)
+{
+        testSeed = testSeed * 6364136223846793005ULL + 1442695040888963407ULL;
+
+        return((real8)(testSeed >> 11) * (1.0 / 9007199254740992.0));
+}
+
+
+static void RandomUnitVector(real8 v[3])
+{
+        int   k;
+        real8 n;
+
+        do {
+            for (k = 0; k < 3; k++) v[k] = 2.0 * TestRandom() - 1.0;
+            n = v[0]*v[0] + v[1]*v[1] + v[2]*v[2];
+        } while (n < 1.0e-2 || n > 1.0);
+
+        n = sqrt(n);
+        for (k = 0; k < 3; k++) v[k] /= n;
+}
+
+
+/*
+ *      Largest difference between the force arrays f and g of n values,
+ *      relative to the largest component of g
+ */
+static real8 RelativeDifference(int n, real8 *f, real8 *g)
+{
+        int   i;
+        real8 err = 0.0, norm = 0.0;
+
+        for (i = 0; i < n; i++) {
+            if (fabs(f[i] - g[i]) > err) err = fabs(f[i] - g[i]);
+            if (fabs(g[i]) > norm) norm = fabs(g[i]);
+        }
+
+        return((norm > 0.0) ? err / norm : err);
+}
+
+
+static int CheckTolerance(const char *test, const char *what, real8 err,
+                          real8 tol)
+{
+        printf("%-12s %-36s %12.3e (tolerance %.1e)\n", test, what, err, tol);
+
+        return(err <= tol);
+}
+
+
+/*
+ *      Test network: numSegs segments of random orientation, length and
+ *      Burgers vector in a periodic cube of side box, each segment with
+ *      its own two end nodes
+ */
+typedef struct {
+        int   numNodes, numSegs;
+        int   *nodeIDs;
+        real8 *R1, *R2, *burgers;
+        real8 h[9], hinv[9];
+        int   isPeriodic[3];
+} TestNetwork_t;
+
+static void RandomNetwork(int numSegs, real8 box, TestNetwork_t *net)
+{
+        int   i, k;
+        real8 t[3], L;
+
+        net->numSegs  = numSegs;
+        net->numNodes = 2 * numSegs;
+        net->nodeIDs  = (int *)malloc(2 * numSegs * sizeof(int));
+        net->R1       = (real8 *)malloc(9 * numSegs * sizeof(real8));
+        net->R2       = net->R1 + 3 * numSegs;
+        net->burgers  = net->R2 + 3 * numSegs;
+
+        for (k = 0; k < 9; k++) {
+            net->h[k]    = (k % 4 == 0) ? box : 0.0;
+            net->hinv[k] = (k % 4 == 0) ? 1.0 / box : 0.0;
+        }
+        for (k = 0; k < 3; k++) net->isPeriodic[k] = 1;
+
+        for (i = 0; i < numSegs; i++) {
+            net->nodeIDs[2*i]   = 2*i;
+            net->nodeIDs[2*i+1] = 2*i+1;
+            RandomUnitVector(t);
+            L = 1.0 + 5.0 * TestRandom();
+            for (k = 0; k < 3; k++) {
+                net->R1[3*i+k] = box * (TestRandom() - 0.5);
+                net->R2[3*i+k] = net->R1[3*i+k] + L * t[k];
+            }
+            RandomUnitVector(&net->burgers[3*i]);
+        }
+}
+
+
+static void FreeNetwork(TestNetwork_t *net)
+{
+        free(net->nodeIDs);
+        free(net->R1);
+}
+
+
+/*
+ *      Pair p1->p2, p3->p4 with p3->p4 rotated by angle from the direction
+ *      of p1->p2 (and reversed if antiparallel), offset from it by a
+ *      random distance of a few segment lengths
+ */
+static void NearParallelPair(real8 angle, int antiparallel,
+                             real8 *p1, real8 *p2, real8 *p3, real8 *p4)
+{
+        int   k;
+        real8 t[3], n[3], off[3], dir[3], c, L12, L34, d;
+
+        RandomUnitVector(t);
+        RandomUnitVector(off);
+
+/*
+ *      n: unit vector normal to t, the rotation direction
+ */
+        c = off[0]*t[0] + off[1]*t[1] + off[2]*t[2];
+        for (k = 0; k < 3; k++) n[k] = off[k] - c*t[k];
+        c = sqrt(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+        for (k = 0; k < 3; k++) n[k] /= c;
+
+        L12 = 1.0 + 4.0 * TestRandom();
+        L34 = 1.0 + 4.0 * TestRandom();
+        d   = 0.5 + 4.0 * TestRandom();
+
+        for (k = 0; k < 3; k++) {
+            dir[k] = cos(angle) * t[k] + sin(angle) * n[k];
+            if (antiparallel) dir[k] = -dir[k];
+            p1[k] = 10.0 * TestRandom();
+            p2[k] = p1[k] + L12 * t[k];
+            p3[k] = p1[k] + d * n[k] + (TestRandom() - 0.5) * L12 * t[k];
+            p4[k] = p3[k] + L34 * dir[k];
+        }
+}
+
+
+/*
+ *      Forces of SegSegForceIsotropicSIMD() and of SegSegForce() for each
+ *      pair of the batch, compared over the batch
+ */
+static real8 CompareSIMD(int numPairs, real8 *p1, real8 *p2, real8 *p3,
+                         real8 *p4, real8 *b12, real8 *b34)
+{
+        int   i;
+        real8 *f, *g, err;
+
+        f = (real8 *)malloc(2 * 12 * numPairs * sizeof(real8));
+        g = f + 12 * numPairs;
+
+        SegSegForceIsotropicSIMD(numPairs, p1, p2, p3, p4, b12, b34,
+                                 TEST_A, TEST_MU, TEST_NU, 1, 1,
+                                 &f[0], &f[3*numPairs], &f[6*numPairs],
+                                 &f[9*numPairs]);
+
+        for (i = 0; i < numPairs; i++) {
+            real8 *g1 = &g[3*i], *g2 = &g[3*(numPairs+i)];
+            real8 *g3 = &g[3*(2*numPairs+i)], *g4 = &g[3*(3*numPairs+i)];
+            SegSegForce(p1[3*i], p1[3*i+1], p1[3*i+2],
+                        p2[3*i], p2[3*i+1], p2[3*i+2],
+                        p3[3*i], p3[3*i+1], p3[3*i+2],
+                        p4[3*i], p4[3*i+1], p4[3*i+2],
+                        b12[3*i], b12[3*i+1], b12[3*i+2],
+                        b34[3*i], b34[3*i+1], b34[3*i+2],
+                        TEST_A, TEST_MU, TEST_NU, 1, 1,
+                        &g1[0], &g1[1], &g1[2], &g2[0], &g2[1], &g2[2],
+                        &g3[0], &g3[1], &g3[2], &g4[0], &g4[1], &g4[2]);
+        }
+
+        err = RelativeDifference(12 * numPairs, f, g);
+        free(f);
+
+        return(err);
+}
+
+
+/*
+ *      simd: SegSegForceIsotropicSIMD() against SegSegForce() for random
+ *      pairs and for near-parallel and antiparallel pairs on both sides
+ *      of the parallel threshold of the scalar kernel
+ */
+static int TestSIMD(void)
+{
+        int   i, k, g, pass = 1;
+        real8 *p1, *p2, *p3, *p4, *b12, *b34, err;
+        char  what[64];
+        real8 angles[] = {1.0e-1, 1.0e-3, 1.0e-4, 1.0e-5, 1.0e-6, 1.0e-8, 0.0};
+        int   numAngles = sizeof(angles) / sizeof(angles[0]);
+
+        p1  = (real8 *)malloc(6 * 3 * TEST_SIMD_PAIRS * sizeof(real8));
+        p2  = p1  + 3 * TEST_SIMD_PAIRS;
+        p3  = p2  + 3 * TEST_SIMD_PAIRS;
+        p4  = p3  + 3 * TEST_SIMD_PAIRS;
+        b12 = p4  + 3 * TEST_SIMD_PAIRS;
+        b34 = b12 + 3 * TEST_SIMD_PAIRS;
+
+        for (i = 0; i < TEST_SIMD_PAIRS; i++) {
+            for (k = 0; k < 3; k++) {
+                p1[3*i+k] = 20.0 * TestRandom();
+                p2[3*i+k] = p1[3*i+k] + 4.0 * (TestRandom() - 0.5);
+                p3[3*i+k] = 20.0 * TestRandom();
+                p4[3*i+k] = p3[3*i+k] + 4.0 * (TestRandom() - 0.5);
+            }
+            RandomUnitVector(&b12[3*i]);
+            RandomUnitVector(&b34[3*i]);
+        }
+
+        err = CompareSIMD(TEST_SIMD_PAIRS, p1, p2, p3, p4, b12, b34);
+        pass &= CheckTolerance("simd", "random pairs", err, SEGSEG_SIMD_RTOL);
+
+/*
+ *      Batches mixing all angles, so that lanes on both sides of the
+ *      parallel threshold share a vector
+ */
+        for (g = 0; g < 2; g++) {
+            for (i = 0; i < TEST_SIMD_PAIRS; i++) {
+                NearParallelPair(angles[i % numAngles], g,
+                                 &p1[3*i], &p2[3*i], &p3[3*i], &p4[3*i]);
+            }
+            err = CompareSIMD(TEST_SIMD_PAIRS, p1, p2, p3, p4, b12, b34);
+            sprintf(what, "%s pairs", g ? "antiparallel" : "near-parallel");
+            pass &= CheckTolerance("simd", what, err, SEGSEG_SIMD_RTOL);
+        }
+
+        free(p1);
+
+        return(pass);
+}
+
+
+/*
+ *      drivers: SegSegForceCellList() and SegSegForcePairList() against
+ *      SegSegForceAllPairs(), analytic and with a 3 point quadrature.
+ *      The pair list is either all pairs or the pairs the cell list
+ *      selects (closest image midpoint distance at most the cutoff plus
+ *      the half lengths), found by brute force; a cell list with a
+ *      cutoff spanning the box evaluates all pairs.  The network is also
+ *      split into networks evaluated together by
+ *      SegSegForceAllPairsMulti() and each on its own by
+ *      SegSegForceAllPairs().
+ */
+static int TestDrivers(void)
+{
+        int           i, j, k, q, numPairs, numCell, pass = 1;
+        int           *pairs;
+        real8         quadPoints[3] = {-0.774596669241483, 0.0, 0.774596669241483};
+        real8         weights[3] = {5.0/9.0, 8.0/9.0, 5.0/9.0};
+        real8         cutoff = 8.0, err, p2[3], mid[3], midj[3], dr[3];
+        real8         *segRef, *nodeRef, *seg, *node, *halfLen, *mids;
+        char          what[64];
+        TestNetwork_t net;
+
+        RandomNetwork(TEST_NUM_SEGS, TEST_BOX, &net);
+
+        segRef  = (real8 *)malloc(2 * (6 * net.numSegs + 3 * net.numNodes) *
+                                  sizeof(real8));
+        nodeRef = segRef  + 6 * net.numSegs;
+        seg     = nodeRef + 3 * net.numNodes;
+        node    = seg     + 6 * net.numSegs;
+        pairs   = (int *)malloc(net.numSegs * (net.numSegs - 1) * sizeof(int));
+        mids    = (real8 *)malloc(4 * net.numSegs * sizeof(real8));
+        halfLen = mids + 3 * net.numSegs;
+
+        for (i = 0; i < net.numSegs; i++) {
+            PBCClosestImage(net.h, net.hinv, net.isPeriodic, &net.R1[3*i],
+                            &net.R2[3*i], p2);
+            for (k = 0; k < 3; k++) {
+                mids[3*i+k] = 0.5 * (net.R1[3*i+k] + p2[k]);
+                dr[k] = p2[k] - net.R1[3*i+k];
+            }
+            halfLen[i] = 0.5 * sqrt(dr[0]*dr[0] + dr[1]*dr[1] + dr[2]*dr[2]);
+        }
+
+        for (q = 0; q < 2; q++) {
+            int Nint = (q == 0) ? 0 : 3;
+            const char *rule = (q == 0) ? "analytic" : "Nint = 3";
+
+            SegSegForceAllPairs(net.numNodes, net.numSegs, net.nodeIDs,
+                                net.R1, net.R2, net.burgers,
+                                net.h, net.hinv, net.isPeriodic,
+                                TEST_A, TEST_MU, TEST_NU,
+                                Nint, quadPoints, weights, NULL,
+                                segRef, nodeRef);
+
+            numPairs = 0;
+            for (i = 0; i < net.numSegs; i++) {
+                for (j = i+1; j < net.numSegs; j++) {
+                    pairs[2*numPairs]   = i;
+                    pairs[2*numPairs+1] = j;
+                    numPairs++;
+                }
+            }
+            SegSegForcePairList(net.numNodes, net.numSegs, net.nodeIDs,
+                                net.R1, net.R2, net.burgers,
+                                net.h, net.hinv, net.isPeriodic,
+                                numPairs, pairs,
+                                TEST_A, TEST_MU, TEST_NU,
+                                Nint, quadPoints, weights, NULL,
+                                seg, node);
+            err = RelativeDifference(6 * net.numSegs, seg, segRef);
+            sprintf(what, "pair list, all pairs, %s", rule);
+            pass &= CheckTolerance("drivers", what, err, TEST_DRIVER_RTOL);
+            err = RelativeDifference(3 * net.numNodes, node, nodeRef);
+            sprintf(what, "  node forces");
+            pass &= CheckTolerance("drivers", what, err, TEST_DRIVER_RTOL);
+
+            numCell = SegSegForceCellList(net.numNodes, net.numSegs,
+                                          net.nodeIDs, net.R1, net.R2,
+                                          net.burgers, net.h, net.hinv,
+                                          net.isPeriodic, TEST_BOX,
+                                          TEST_A, TEST_MU, TEST_NU,
+                                          Nint, quadPoints, weights, NULL,
+                                          seg, node);
+            err = RelativeDifference(6 * net.numSegs, seg, segRef);
+            sprintf(what, "cell list, cutoff = box, %s", rule);
+            pass &= CheckTolerance("drivers", what, err, TEST_DRIVER_RTOL);
+            if (numCell != numPairs + net.numSegs) {
+                printf("%-12s cell list evaluated %d pairs, expected %d\n",
+                       "drivers", numCell, numPairs + net.numSegs);
+                pass = 0;
+            }
+
+/*
+ *          Near-field pairs of the cell list criterion
+ */
+            numPairs = 0;
+            for (i = 0; i < net.numSegs; i++) {
+                for (k = 0; k < 3; k++) mid[k] = mids[3*i+k];
+                for (j = i+1; j < net.numSegs; j++) {
+                    real8 rmax = cutoff + halfLen[i] + halfLen[j];
+                    PBCClosestImage(net.h, net.hinv, net.isPeriodic, mid,
+                                    &mids[3*j], midj);
+                    for (k = 0; k < 3; k++) dr[k] = midj[k] - mid[k];
+                    if (dr[0]*dr[0] + dr[1]*dr[1] + dr[2]*dr[2] > rmax*rmax) {
+                        continue;
+                    }
+                    pairs[2*numPairs]   = i;
+                    pairs[2*numPairs+1] = j;
+                    numPairs++;
+                }
+            }
+            SegSegForcePairList(net.numNodes, net.numSegs, net.nodeIDs,
+                                net.R1, net.R2, net.burgers,
+                                net.h, net.hinv, net.isPeriodic,
+                                numPairs, pairs,
+                                TEST_A, TEST_MU, TEST_NU,
+                                Nint, quadPoints, weights, NULL,
+                                segRef, nodeRef);
+            numCell = SegSegForceCellList(net.numNodes, net.numSegs,
+                                          net.nodeIDs, net.R1, net.R2,
+                                          net.burgers, net.h, net.hinv,
+                                          net.isPeriodic, cutoff,
+                                          TEST_A, TEST_MU, TEST_NU,
+                                          Nint, quadPoints, weights, NULL,
+                                          seg, node);
+            err = RelativeDifference(6 * net.numSegs, seg, segRef);
+            sprintf(what, "cell list vs %d near pairs, %s", numPairs, rule);
+            pass &= CheckTolerance("drivers", what, err, TEST_DRIVER_RTOL);
+            err = RelativeDifference(3 * net.numNodes, node, nodeRef);
+            sprintf(what, "  node forces");
+            pass &= CheckTolerance("drivers", what, err, TEST_DRIVER_RTOL);
+            if (numCell != numPairs + net.numSegs) {
+                printf("%-12s cell list evaluated %d pairs, expected %d\n",
+                       "drivers", numCell, numPairs + net.numSegs);
+                pass = 0;
+            }
+        }
+
+/*
+ *      Networks of the segments segOffset[n]:segOffset[n+1], whose nodes
+ *      are numbered from 2*segOffset[n] in the full network
+ */
+        {
+            int segOffset[4] = {0, 1, 150, 0};
+            int n, m;
+
+            segOffset[3] = net.numSegs;
+
+            SegSegForceAllPairsMulti(net.numNodes, net.numSegs, 3, segOffset,
+                                     net.nodeIDs, net.R1, net.R2, net.burgers,
+                                     net.h, net.hinv, net.isPeriodic,
+                                     TEST_A, TEST_MU, TEST_NU,
+                                     0, NULL, NULL, NULL, seg, node);
+
+            for (n = 0; n < 3; n++) {
+                int s0 = segOffset[n], ns = segOffset[n+1] - segOffset[n];
+                int *ids = &pairs[0];
+                for (m = 0; m < 2*ns; m++) ids[m] = m;
+                SegSegForceAllPairs(2*ns, ns, ids, &net.R1[3*s0],
+                                    &net.R2[3*s0], &net.burgers[3*s0],
+                                    net.h, net.hinv, net.isPeriodic,
+                                    TEST_A, TEST_MU, TEST_NU,
+                                    0, NULL, NULL, NULL,
+                                    &segRef[6*s0], &nodeRef[6*s0]);
+            }
+            err = RelativeDifference(6 * net.numSegs, seg, segRef);
+            pass &= CheckTolerance("drivers", "all pairs of 3 networks", err,
+                                   TEST_DRIVER_RTOL);
+            err = RelativeDifference(3 * net.numNodes, node, nodeRef);
+            pass &= CheckTolerance("drivers", "  node forces", err,
+                                   TEST_DRIVER_RTOL);
+        }
+
+        free(mids);
+        free(pairs);
+        free(segRef);
+        FreeNetwork(&net);
+
+        return(pass);
+}
+
+
+/*
+ *      incremental: the update of the segment forces after some segments
+ *      moved or changed Burgers vector, as done by
+ *      ElasticSegForces_Incremental() on the python side, against a full
+ *      evaluation of the changed network.  The forces of the previous
+ *      network are updated by subtracting the pairs of the changed
+ *      segments evaluated on the previous network and adding them
+ *      evaluated on the current one (SegSegForceSubset()).
+ */
+static int TestIncremental(void)
+{
+        int           i, k, numSub, *subList, *changed, pass = 1;
+        real8         *segOld, *segNew, *segFull, *nodeFull, *fsub;
+        real8         *R1, *R2, *burgers;
+        TestNetwork_t net;
+
+        RandomNetwork(TEST_NUM_SEGS, TEST_BOX, &net);
+
+        segOld   = (real8 *)malloc((4 * 6 * net.numSegs + 3 * net.numNodes) *
+                                   sizeof(real8));
+        segNew   = segOld  + 6 * net.numSegs;
+        segFull  = segNew  + 6 * net.numSegs;
+        fsub     = segFull + 6 * net.numSegs;
+        nodeFull = fsub    + 6 * net.numSegs;
+        subList  = (int *)malloc(net.numSegs * sizeof(int));
+        changed  = (int *)calloc(net.numSegs, sizeof(int));
+        R1       = (real8 *)malloc(9 * net.numSegs * sizeof(real8));
+        R2       = R1 + 3 * net.numSegs;
+        burgers  = R2 + 3 * net.numSegs;
+
+        for (i = 0; i < net.numSegs; i++) subList[i] = i;
+        SegSegForceSubset(net.numSegs, net.R1, net.R2, net.burgers,
+                          net.h, net.hinv, net.isPeriodic,
+                          net.numSegs, subList, TEST_A, TEST_MU, TEST_NU,
+                          0, NULL, NULL, NULL, segOld);
+        SegSegForceAllPairs(net.numNodes, net.numSegs, net.nodeIDs,
+                            net.R1, net.R2, net.burgers,
+                            net.h, net.hinv, net.isPeriodic,
+                            TEST_A, TEST_MU, TEST_NU, 0, NULL, NULL, NULL,
+                            segFull, nodeFull);
+        pass &= CheckTolerance("incremental", "subset of all segments",
+                               RelativeDifference(6 * net.numSegs, segOld,
+                                                  segFull),
+                               TEST_DRIVER_RTOL);
+
+/*
+ *      Changed network: segments moved by a fraction of their length,
+ *      every fifth of them with a new Burgers vector as well
+ */
+        memcpy(R1, net.R1, 9 * net.numSegs * sizeof(real8));
+        numSub = 0;
+        while (numSub < TEST_NUM_CHANGED) {
+            i = (int)(TestRandom() * net.numSegs);
+            if (changed[i]) continue;
+            changed[i] = 1;
+            subList[numSub] = i;
+            for (k = 0; k < 3; k++) {
+                R1[3*i+k] += 0.2 * (TestRandom() - 0.5);
+                R2[3*i+k] += 0.2 * (TestRandom() - 0.5);
+            }
+            if (numSub % 5 == 0) RandomUnitVector(&burgers[3*i]);
+            numSub++;
+        }
+
+        memcpy(segNew, segOld, 6 * net.numSegs * sizeof(real8));
+        SegSegForceSubset(net.numSegs, net.R1, net.R2, net.burgers,
+                          net.h, net.hinv, net.isPeriodic,
+                          numSub, subList, TEST_A, TEST_MU, TEST_NU,
+                          0, NULL, NULL, NULL, fsub);
+        for (k = 0; k < 6*net.numSegs; k++) segNew[k] -= fsub[k];
+        SegSegForceSubset(net.numSegs, R1, R2, burgers,
+                          net.h, net.hinv, net.isPeriodic,
+                          numSub, subList, TEST_A, TEST_MU, TEST_NU,
+                          0, NULL, NULL, NULL, fsub);
+        for (k = 0; k < 6*net.numSegs; k++) segNew[k] += fsub[k];
+
+        SegSegForceAllPairs(net.numNodes, net.numSegs, net.nodeIDs,
+                            R1, R2, burgers, net.h, net.hinv, net.isPeriodic,
+                            TEST_A, TEST_MU, TEST_NU, 0, NULL, NULL, NULL,
+                            segFull, nodeFull);
+        pass &= CheckTolerance("incremental", "changed segments updated",
+                               RelativeDifference(6 * net.numSegs, segNew,
+                                                  segFull),
+                               TEST_INCREMENTAL_RTOL);
+
+        free(R1);
+        free(changed);
+        free(subList);
+        free(segOld);
+        FreeNetwork(&net);
+
+        return(pass);
+}
+
+
+/*
+ *      mixed: SegSegForceAllPairs() and SegSegForceCellList() with a
+ *      mixed precision policy against the double precision forces.  The
+ *      statistics of the policy must count the single precision pairs
+ *      and, with the check enabled, report their rms error within the
+ *      kernel accuracy.
+ */
+static int TestMixed(void)
+{
+        int           pass = 1;
+        real8         *segRef, *nodeRef, *seg, *node, rms;
+        SegSegMixed_t mixed;
+        TestNetwork_t net;
+
+        RandomNetwork(TEST_NUM_SEGS, TEST_MIXED_BOX, &net);
+
+        segRef  = (real8 *)malloc(2 * (6 * net.numSegs + 3 * net.numNodes) *
+                                  sizeof(real8));
+        nodeRef = segRef  + 6 * net.numSegs;
+        seg     = nodeRef + 3 * net.numNodes;
+        node    = seg     + 6 * net.numSegs;
+
+        memset(&mixed, 0, sizeof(mixed));
+        mixed.distance = TEST_MIXED_DISTANCE;
+        mixed.check    = 1;
+
+        SegSegForceAllPairs(net.numNodes, net.numSegs, net.nodeIDs,
+                            net.R1, net.R2, net.burgers,
+                            net.h, net.hinv, net.isPeriodic,
+                            TEST_A, TEST_MU, TEST_NU, 0, NULL, NULL, NULL,
+                            segRef, nodeRef);
+        SegSegForceAllPairs(net.numNodes, net.numSegs, net.nodeIDs,
+                            net.R1, net.R2, net.burgers,
+                            net.h, net.hinv, net.isPeriodic,
+                            TEST_A, TEST_MU, TEST_NU, 0, NULL, NULL, &mixed,
+                            seg, node);
+        pass &= CheckTolerance("mixed", "all pairs",
+                               RelativeDifference(6 * net.numSegs, seg,
+                                                  segRef),
+                               TEST_MIXED_RTOL);
+        pass &= CheckTolerance("mixed", "  node forces",
+                               RelativeDifference(3 * net.numNodes, node,
+                                                  nodeRef),
+                               TEST_MIXED_RTOL);
+
+        SegSegForceCellList(net.numNodes, net.numSegs, net.nodeIDs,
+                            net.R1, net.R2, net.burgers,
+                            net.h, net.hinv, net.isPeriodic, TEST_MIXED_BOX,
+                            TEST_A, TEST_MU, TEST_NU, 0, NULL, NULL, &mixed,
+                            seg, node);
+        pass &= CheckTolerance("mixed", "cell list, cutoff = box",
+                               RelativeDifference(6 * net.numSegs, seg,
+                                                  segRef),
+                               TEST_MIXED_RTOL);
+
+        rms = (mixed.stats[SEGSEG_MIXED_NORM2] > 0.0) ?
+              sqrt(mixed.stats[SEGSEG_MIXED_ERR2] /
+                   mixed.stats[SEGSEG_MIXED_NORM2]) : 0.0;
+        printf("%-12s %.0f single precision pairs, %.0f checked\n", "mixed",
+               mixed.stats[SEGSEG_MIXED_PAIRS],
+               mixed.stats[SEGSEG_MIXED_CHECKED]);
+        pass &= CheckTolerance("mixed", "rms error of the checked pairs",
+                               rms, TEST_MIXED_RMS);
+        if (mixed.stats[SEGSEG_MIXED_PAIRS] <= 0.0 ||
+            mixed.stats[SEGSEG_MIXED_CHECKED] !=
+            mixed.stats[SEGSEG_MIXED_PAIRS]) {
+            printf("%-12s expected checked single precision pairs\n",
+                   "mixed");
+            pass = 0;
+        }
+
+        free(segRef);
+        FreeNetwork(&net);
+
+        return(pass);
+}
+
+
+static struct {
+        const char *name;
+        TestFunc_t test;
+} tests[] = {
+        {"simd",        TestSIMD},
+        {"drivers",     TestDrivers},
+        {"incremental", TestIncremental},
+        {"mixed",       TestMixed},
+};
+
+
+int main(int argc, char *argv[])
+{
+        int i, n, found, numTests, failed = 0;
+
+        numTests = sizeof(tests) / sizeof(tests[0]);
+
+        for (n = 0; n < numTests; n++) {
+            found = (argc < 2);
+            for (i = 1; i < argc; i++) {
+                if (strcmp(argv[i], tests[n].name) == 0) found = 1;
+            }
+            if (found && !tests[n].test()) {
+                printf("%-12s FAILED\n", tests[n].name);
+                failed++;
+            }
+        }
+
+        for (i = 1; i < argc; i++) {
+            found = 0;
+            for (n = 0; n < numTests; n++) {
+                if (strcmp(argv[i], tests[n].name) == 0) found = 1;
+            }
+            if (!found) {
+                fprintf(stderr, "test_kernels: unknown test %s\n", argv[i]);
+                failed++;
+            }
+        }
+
+        return(failed > 0);
+}
@@ -0,0 +1,359 @@
+/*
+ *      Consistency tests of the remesh force estimates
+ *
+ *      EstRefinementForces() and EstCoarsenForces() estimate the arm
+ *      forces of the segments created by a bisection or a node removal
+ *      from the cached arm forces.  Each test bisects a segment (or
+ *      removes the bisection node again), compares the estimate against
+ *      a full recomputation of the forces of the new network, and fails
+ *      if the difference exceeds the tolerance stated with the test.
+ *      Differences are measured relative to the largest force component
+ *      of the recomputed segments.
+ *
+ *      The networks are chosen such that the estimates are exact: the
+ *      Peach-Koehler force is uniform along the bisected segment, the
+ *      line tension core force does not depend on the segment length,
+ *      and the only elastic interactions are those re-evaluated by the
+ *      estimates (a network of the bisected segment alone).
+ *
+ *      libpydis is linked by file name as for pydis_run.
+ *
+ *      Usage:  test_remesh [test ...]
+ *
+ *              Runs the named tests (all if none are given) and exits
+ *              with a non-zero status if any of them fails.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "Home.h"
+#include "Error.h"
+#include "../calforce/NodeStep.h"
+
+#define TEST_MU  50.0
+#define TEST_NU  0.3
+#define TEST_A   0.01
+#define TEST_BOX 100.0
+
+/*
+ *      Estimates vs recomputed forces: the estimates are exact for the
+ *      test networks, up to round-off of the force kernels.
+ */
+#define TEST_REMESH_RTOL 1.0e-10
+
+/*
+ *      Fraction of the bisected segment at which the new node is placed
+ */
+#define TEST_SPLIT 0.35
+
+typedef int (*TestFunc_t)(void);
+
+/*
+ *      Test network: node positions, end nodes and Burgers vectors of
+ *      the segments, and the segment forces [numSegs][6]
+ */
+#define TEST_MAX_NODES 8
+
+typedef struct {
+        int   numNodes, numSegs;
+        real8 R[3*TEST_MAX_NODES];
+        int   segNodes[2*TEST_MAX_NODES];
+        real8 burgers[3*TEST_MAX_NODES];
+        real8 segForces[6*TEST_MAX_NODES];
+} TestNetwork_t;
+
+static const real8 testSigext[9] = {
+        0.0,  0.02, 0.0,
+        0.02, 0.0,  0.01,
+        0.0,  0.01, 0.0
+};
+
+
+static void TestAddNode(TestNetwork_t *net, real8 x, real8 y, real8 z)
+{
+        net->R[3*net->numNodes]   = x;
+        net->R[3*net->numNodes+1] = y;
+        net->R[3*net->numNodes+2] = z;
+        net->numNodes++;
+}
+
+
+static void TestAddSegment(TestNetwork_t *net, int n1, int n2, real8 b[3])
+{
+        int k;
+
+        net->segNodes[2*net->numSegs]   = n1;
+        net->segNodes[2*net->numSegs+1] = n2;
+        for (k = 0; k < 3; k++) net->burgers[3*net->numSegs+k] = b[k];
+        net->numSegs++;
+}
+
+
+/*
+ *      Segment forces of the network by NodeStepEulerForward() without
+ *      moving the nodes (as pydis_run): the line tension forces with Ec,
+ *      or with elastic set the Peach-Koehler force and the elastic
+ *      interaction of all pairs
+ */
+static void NetworkForces(TestNetwork_t *net, int elastic, real8 Ec)
+{
+        int   k, constraints[TEST_MAX_NODES], isPeriodic[3] = {0, 0, 0};
+        real8 nodeForces[3*TEST_MAX_NODES], nodeVels[3*TEST_MAX_NODES];
+        real8 h[9], hinv[9];
+
+        for (k = 0; k < 9; k++) {
+            h[k]    = (k % 4 == 0) ? TEST_BOX : 0.0;
+            hinv[k] = (k % 4 == 0) ? 1.0 / TEST_BOX : 0.0;
+        }
+
+        memset(constraints, 0, sizeof(constraints));
+
+        NodeStepEulerForward(net->numNodes, net->numSegs, net->segNodes,
+                             net->R, constraints, net->burgers,
+                             h, hinv, isPeriodic, (real8 *)testSigext,
+                             elastic ? NODE_STEP_FORCE_ELASTICITY :
+                                       NODE_STEP_FORCE_LINE_TENSION,
+                             TEST_A, TEST_MU, TEST_NU, Ec, 0, NULL, NULL,
+                             NODE_STEP_MOBILITY_RELAX, 0.0,
+                             net->segForces, nodeForces, nodeVels);
+}
+
+
+/*
+ *      Replace the nodes of home with the network and its segment forces
+ *      as the cached arm forces.  The node tags are (0, node index).
+ */
+static void ImportNetwork(Home_t *home, TestNetwork_t *net)
+{
+        int   i, tags[2*TEST_MAX_NODES], constraints[TEST_MAX_NODES];
+        int   tags1[2*TEST_MAX_NODES], tags2[2*TEST_MAX_NODES];
+        real8 planes[3*TEST_MAX_NODES];
+
+        for (i = 0; i < net->numNodes; i++) {
+            tags[2*i]      = 0;
+            tags[2*i+1]    = i;
+            constraints[i] = 0;
+        }
+
+        for (i = 0; i < net->numSegs; i++) {
+            tags1[2*i]      = 0;
+            tags1[2*i+1]    = net->segNodes[2*i];
+            tags2[2*i]      = 0;
+            tags2[2*i+1]    = net->segNodes[2*i+1];
+            planes[3*i]     = 0.0;
+            planes[3*i+1]   = 0.0;
+            planes[3*i+2]   = 1.0;
+        }
+
+        FreeAllNodes(home);
+
+        if (HomeImportArrays(home, net->numNodes, tags, net->R, constraints,
+                             net->numSegs, net->segNodes, net->burgers,
+                             planes) < 0) {
+            Fatal("test_remesh: %s", ErrorMessage());
+        }
+
+        if (HomeSetSegForces(home, net->numSegs, tags1, tags2,
+                             net->segForces) != 0) {
+            Fatal("test_remesh: segment forces not set");
+        }
+}
+
+
+static Node_t *TestNode(Home_t *home, int index)
+{
+        Tag_t tag;
+
+        tag.domainID = 0;
+        tag.index    = index;
+
+        return(GetNodeFromTag(home, tag));
+}
+
+
+/*
+ *      Largest difference between the force arrays f and g of n values,
+ *      relative to the largest component of g
+ */
+static real8 RelativeDifference(int n, real8 *f, real8 *g)
+{
+        int   i;
+        real8 err = 0.0, norm = 0.0;
+
+        for (i = 0; i < n; i++) {
+            if (fabs(f[i] - g[i]) > err) err = fabs(f[i] - g[i]);
+            if (fabs(g[i]) > norm) norm = fabs(g[i]);
+        }
+
+        return((norm > 0.0) ? err / norm : err);
+}
+
+
+static int CheckTolerance(const char *test, const char *what, real8 err,
+                          real8 tol)
+{
+        printf("%-14s %-34s %12.3e (tolerance %.1e)\n", test, what, err, tol);
+
+        return(err <= tol);
+}
+
+
+/*
+ *      Bisect the segment 0->1 of net at TEST_SPLIT and compare the
+ *      estimates of EstRefinementForces() against the forces of the
+ *      bisected network, then remove the new node again and compare
+ *      the estimate of EstCoarsenForces() against the forces of net.
+ */
+static int TestBisection(const char *test, TestNetwork_t *net, int elastic,
+                         real8 Ec)
+{
+        int           i, k, pass = 1;
+        real8         newPos[3], vec[3], est[12], ref[12];
+        TestNetwork_t split;
+        Home_t        *home;
+        Param_t       *param;
+
+        if (ParadisInit_lean(&home) < 0) {
+            Fatal("test_remesh: %s", ErrorMessage());
+        }
+
+        param = home->param;
+        param->minSideX = param->minSideY = param->minSideZ = -0.5 * TEST_BOX;
+        param->maxSideX = param->maxSideY = param->maxSideZ =  0.5 * TEST_BOX;
+        param->xBoundType = param->yBoundType = param->zBoundType = Free;
+        SetBoxSize(param);
+
+        param->elasticinteraction = elastic;
+        param->shearModulus = TEST_MU;
+        param->pois  = TEST_NU;
+        param->rc    = TEST_A;
+        param->Ecore = Ec;
+
+/*
+ *      The bisected network: the new node is appended and takes the
+ *      place of node 1 as the end of segment 0
+ */
+        NetworkForces(net, elastic, Ec);
+
+        split = *net;
+        for (k = 0; k < 3; k++) {
+            vec[k]    = net->R[3+k] - net->R[k];
+            newPos[k] = net->R[k] + TEST_SPLIT * vec[k];
+        }
+        TestAddNode(&split, newPos[0], newPos[1], newPos[2]);
+        split.segNodes[1] = split.numNodes - 1;
+        TestAddSegment(&split, split.numNodes - 1, 1, net->burgers);
+        NetworkForces(&split, elastic, Ec);
+
+        ImportNetwork(home, net);
+        EstRefinementForces(home, TestNode(home, 0), TestNode(home, 1),
+                            newPos, vec, &est[0], &est[3], &est[6],
+                            &est[9]);
+
+        for (k = 0; k < 6; k++) {
+            ref[k]   = split.segForces[k];
+            ref[6+k] = split.segForces[6*(split.numSegs-1)+k];
+        }
+        pass &= CheckTolerance(test, "refinement estimate",
+                               RelativeDifference(12, est, ref),
+                               TEST_REMESH_RTOL);
+
+        ImportNetwork(home, &split);
+        EstCoarsenForces(home, TestNode(home, 0),
+                         TestNode(home, split.numNodes - 1),
+                         TestNode(home, 1), &est[0], &est[3]);
+
+        for (i = 0; i < 6; i++) ref[i] = net->segForces[i];
+        pass &= CheckTolerance(test, "coarsen estimate",
+                               RelativeDifference(6, est, ref),
+                               TEST_REMESH_RTOL);
+
+        HomeFree(home);
+
+        return(pass);
+}
+
+
+/*
+ *      Line tension forces: a bent line of three segments, bisecting the
+ *      first one
+ */
+static int TestLineTension(void)
+{
+        real8         b[3] = {0.57735026919, 0.57735026919, 0.57735026919};
+        real8         Ec;
+        TestNetwork_t net;
+
+        memset(&net, 0, sizeof(net));
+        TestAddNode(&net, -10.0, -2.0,  1.0);
+        TestAddNode(&net,  -1.0,  3.0, -1.0);
+        TestAddNode(&net,   6.0, -2.0,  4.0);
+        TestAddNode(&net,  12.0,  1.0,  2.0);
+        TestAddSegment(&net, 0, 1, b);
+        TestAddSegment(&net, 1, 2, b);
+        TestAddSegment(&net, 2, 3, b);
+
+        Ec = TEST_MU / 4.0 / M_PI * log(TEST_A / 0.1);
+
+        return(TestBisection("line_tension", &net, 0, Ec));
+}
+
+
+/*
+ *      Elastic forces: a single segment, whose self force and the
+ *      interaction of its two halves are re-evaluated by the estimates
+ */
+static int TestElastic(void)
+{
+        real8         b[3] = {0.70710678119, 0.70710678119, 0.0};
+        TestNetwork_t net;
+
+        memset(&net, 0, sizeof(net));
+        TestAddNode(&net, -4.0, -1.0,  0.5);
+        TestAddNode(&net,  5.0,  2.0, -1.0);
+        TestAddSegment(&net, 0, 1, b);
+
+        return(TestBisection("elastic", &net, 1, 0.0));
+}
+
+
+static struct {
+        const char *name;
+        TestFunc_t test;
+} tests[] = {
+        {"line_tension", TestLineTension},
+        {"elastic",      TestElastic},
+};
+
+
+int main(int argc, char *argv[])
+{
+        int i, n, found, numTests, failed = 0;
+
+        numTests = sizeof(tests) / sizeof(tests[0]);
+
+        for (n = 0; n < numTests; n++) {
+            found = (argc < 2);
+            for (i = 1; i < argc; i++) {
+                if (strcmp(argv[i], tests[n].name) == 0) found = 1;
+            }
+            if (found && !tests[n].test()) {
+                printf("%-14s FAILED\n", tests[n].name);
+                failed++;
+            }
+        }
+
+        for (i = 1; i < argc; i++) {
+            found = 0;
+            for (n = 0; n < numTests; n++) {
+                if (strcmp(argv[i], tests[n].name) == 0) found = 1;
+            }
+            if (!found) {
+                fprintf(stderr, "test_remesh: unknown test %s\n", argv[i]);
+                failed++;
+            }
+        }
+
+        return(failed > 0);
+}
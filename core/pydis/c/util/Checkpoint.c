@@ -0,0 +1,313 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include "Checkpoint.h"
+#include "Error.h"
+
+/*
+ *      Native writer of the binary checkpoint files read by
+ *      python/framework/checkpoint.py (open_checkpoint).  The "nodes"
+ *      and "segs" arrays are the (N,6) and (M,8) float64 tables of
+ *      NODES_ATTR and SEGS_ATTR, built from the flat arrays of
+ *      HomeExportArrays(), followed by any additional arrays.  The
+ *      arrays are written in the byte order of the host, which must be
+ *      little-endian as the header declares them "<f8".
+ */
+
+#define NUM_NODE_ATTR 6
+#define NUM_SEG_ATTR  8
+
+typedef struct {
+        char   *text;
+        size_t len;
+        size_t size;
+} JSONBuf_t;
+
+
+/*---------------------------------------------------------------------------
+ *
+ *      Function:       JSONAppend
+ *      Description:    Append printf formatted text to the header buffer
+ *
+ *-------------------------------------------------------------------------*/
+static void JSONAppend(JSONBuf_t *buf, const char *format, ...)
+{
+        int     n;
+        va_list args;
+
+        while (1) {
+            va_start(args, format);
+            n = vsnprintf(buf->text + buf->len, buf->size - buf->len,
+                          format, args);
+            va_end(args);
+
+            if (n < 0) ErrorRaise("WriteCheckpointFile: format error");
+            if (buf->len + n < buf->size) break;
+
+            buf->size = 2 * (buf->len + n + 1);
+            buf->text = (char *)realloc(buf->text, buf->size);
+            if (buf->text == (char *)NULL) {
+                ErrorRaise("WriteCheckpointFile: out of memory");
+            }
+        }
+
+        buf->len += n;
+
+        return;
+}
+
+
+/*---------------------------------------------------------------------------
+ *
+ *      Function:       JSONAppendReal
+ *      Description:    Append a double in full precision, always with a
+ *                      fraction or exponent so that it reads back as a
+ *                      float (json.dumps writes 1000.0, not 1000).
+ *
+ *-------------------------------------------------------------------------*/
+static void JSONAppendReal(JSONBuf_t *buf, real8 value)
+{
+        char text[32];
+
+        snprintf(text, sizeof(text), "%.17g", value);
+
+        if (strpbrk(text, ".eEn") == (char *)NULL) {
+            strcat(text, ".0");
+        }
+
+        JSONAppend(buf, "%s", text);
+
+        return;
+}
+
+
+static size_t Aligned(size_t n)
+{
+        return((n + CHECKPOINT_ALIGN - 1) / CHECKPOINT_ALIGN * CHECKPOINT_ALIGN);
+}
+
+
+/*---------------------------------------------------------------------------
+ *
+ *      Function:       JSONHeader
+ *      Description:    Build the JSON header with the arrays laid out
+ *                      from offset headerSpace, in the key order of
+ *                      write_checkpoint_file().
+ *
+ *      Returns:  the file size implied by the array offsets
+ *
+ *-------------------------------------------------------------------------*/
+static size_t JSONHeader(JSONBuf_t *buf, size_t headerSpace,
+                         int numArrays, const char **names,
+                         int *rows, int *cols,
+                         real8 *h, real8 *origin, int *isPeriodic,
+                         int numAttrs, CheckpointAttr_t *attrs)
+{
+        int    i, j;
+        size_t offset;
+
+        buf->len = 0;
+        buf->text[0] = 0;
+
+        JSONAppend(buf, "{\"format\": \"disnet-checkpoint\", "
+                   "\"format_version\": %d, \"version\": \"1.0\", "
+                   "\"nodes_attr\": [\"domain\", \"index\", \"x\", \"y\", "
+                   "\"z\", \"constraint\"], "
+                   "\"segs_attr\": [\"node1\", \"node2\", \"bx\", \"by\", "
+                   "\"bz\", \"nx\", \"ny\", \"nz\"], \"cell\": {\"h\": [",
+                   CHECKPOINT_FORMAT_VERSION);
+
+        for (i = 0; i < 3; i++) {
+            JSONAppend(buf, (i > 0) ? ", [" : "[");
+            for (j = 0; j < 3; j++) {
+                if (j > 0) JSONAppend(buf, ", ");
+                JSONAppendReal(buf, h[3*i+j]);
+            }
+            JSONAppend(buf, "]");
+        }
+
+        JSONAppend(buf, "], \"origin\": [");
+        for (i = 0; i < 3; i++) {
+            if (i > 0) JSONAppend(buf, ", ");
+            JSONAppendReal(buf, origin[i]);
+        }
+
+        JSONAppend(buf, "], \"is_periodic\": [");
+        for (i = 0; i < 3; i++) {
+            JSONAppend(buf, "%s%s", (i > 0) ? ", " : "",
+                       isPeriodic[i] ? "true" : "false");
+        }
+
+        JSONAppend(buf, "]}, \"attrs\": {");
+        for (i = 0; i < numAttrs; i++) {
+            JSONAppend(buf, "%s\"%s\": ", (i > 0) ? ", " : "",
+                       attrs[i].name);
+            JSONAppendReal(buf, attrs[i].value);
+        }
+
+        JSONAppend(buf, "}, \"arrays\": [");
+        offset = headerSpace;
+        for (i = 0; i < numArrays; i++) {
+            JSONAppend(buf, "%s{\"name\": \"%s\", \"dtype\": \"<f8\", "
+                       "\"shape\": [%d, %d], \"offset\": %zu}",
+                       (i > 0) ? ", " : "", names[i], rows[i], cols[i],
+                       offset);
+            offset = Aligned(offset + (size_t)rows[i] * cols[i] *
+                             sizeof(real8));
+        }
+        JSONAppend(buf, "]}");
+
+        return(offset);
+}
+
+
+/*---------------------------------------------------------------------------
+ *
+ *      Function:       WriteCheckpointFile
+ *      Description:    Write a network as a checkpoint file in the
+ *                      format of write_checkpoint_file().
+ *
+ *      Arguments:
+ *          fileName     name of the checkpoint file
+ *          numNodes     number of nodes
+ *          tags         [numNodes][2] node tags (domain, index)
+ *          R            [numNodes][3] node positions
+ *          constraints  [numNodes] node constraints
+ *          numSegs      number of segments
+ *          segNodes     [numSegs][2] indices of the end nodes
+ *          burgers      [numSegs][3] Burgers vectors
+ *          planes       [numSegs][3] glide plane normals
+ *          h, origin    3x3 cell matrix (row-major) and cell origin
+ *          isPeriodic   3 flags, non-zero for periodic directions
+ *          numAttrs     number of scalar values stored in "attrs"
+ *          attrs        [numAttrs] name and value of each
+ *          numArrays    number of additional arrays
+ *          arrays       [numArrays] name, shape and data of each
+ *
+ *-------------------------------------------------------------------------*/
+void WriteCheckpointFile(char *fileName, int numNodes, int *tags, real8 *R,
+                         int *constraints, int numSegs, int *segNodes,
+                         real8 *burgers, real8 *planes, real8 *h,
+                         real8 *origin, int *isPeriodic,
+                         int numAttrs, CheckpointAttr_t *attrs,
+                         int numArrays, CheckpointArray_t *arrays)
+{
+        int         i, k, numTables, *rows, *cols;
+        size_t      headerSpace, fileSize, pos, nbytes;
+        uint64_t    length;
+        uint16_t    byteOrder = 1;
+        const char  **names;
+        real8       **data, *nodeTable, *segTable;
+        JSONBuf_t   buf;
+        FILE        *fp;
+
+        if (*(unsigned char *)&byteOrder != 1) {
+            ErrorRaise("WriteCheckpointFile: big-endian hosts are not "
+                       "supported");
+        }
+
+        numTables = 2 + numArrays;
+
+        names = (const char **)malloc(numTables * sizeof(char *));
+        data  = (real8 **)malloc(numTables * sizeof(real8 *));
+        rows  = (int *)malloc(numTables * sizeof(int));
+        cols  = (int *)malloc(numTables * sizeof(int));
+        nodeTable = (real8 *)malloc((numNodes > 0 ? numNodes : 1) *
+                                    NUM_NODE_ATTR * sizeof(real8));
+        segTable  = (real8 *)malloc((numSegs > 0 ? numSegs : 1) *
+                                    NUM_SEG_ATTR * sizeof(real8));
+        buf.size = 4096;
+        buf.len  = 0;
+        buf.text = (char *)malloc(buf.size);
+
+        if (names == NULL || data == NULL || rows == NULL || cols == NULL ||
+            nodeTable == NULL || segTable == NULL || buf.text == NULL) {
+            ErrorRaise("WriteCheckpointFile: out of memory");
+        }
+
+        for (i = 0; i < numNodes; i++) {
+            nodeTable[NUM_NODE_ATTR*i]   = tags[2*i];
+            nodeTable[NUM_NODE_ATTR*i+1] = tags[2*i+1];
+            for (k = 0; k < 3; k++) {
+                nodeTable[NUM_NODE_ATTR*i+2+k] = R[3*i+k];
+            }
+            nodeTable[NUM_NODE_ATTR*i+5] = constraints[i];
+        }
+
+        for (i = 0; i < numSegs; i++) {
+            segTable[NUM_SEG_ATTR*i]   = segNodes[2*i];
+            segTable[NUM_SEG_ATTR*i+1] = segNodes[2*i+1];
+            for (k = 0; k < 3; k++) {
+                segTable[NUM_SEG_ATTR*i+2+k] = burgers[3*i+k];
+                segTable[NUM_SEG_ATTR*i+5+k] = planes[3*i+k];
+            }
+        }
+
+        names[0] = "nodes";
+        data[0]  = nodeTable;
+        rows[0]  = numNodes;
+        cols[0]  = NUM_NODE_ATTR;
+        names[1] = "segs";
+        data[1]  = segTable;
+        rows[1]  = numSegs;
+        cols[1]  = NUM_SEG_ATTR;
+
+        for (i = 0; i < numArrays; i++) {
+            names[2+i] = arrays[i].name;
+            data[2+i]  = arrays[i].data;
+            rows[2+i]  = arrays[i].rows;
+            cols[2+i]  = arrays[i].cols;
+        }
+
+/*
+ *      The offsets depend on the header length, which depends on the
+ *      offsets: lay the arrays out after a header estimate and grow it
+ *      until the header fits.
+ */
+        headerSpace = CHECKPOINT_ALIGN;
+        while (1) {
+            fileSize = JSONHeader(&buf, headerSpace, numTables, names,
+                                  rows, cols, h, origin, isPeriodic,
+                                  numAttrs, attrs);
+            if (16 + buf.len <= headerSpace) break;
+            headerSpace = Aligned(16 + buf.len);
+        }
+        if (fileSize < headerSpace) fileSize = headerSpace;
+
+        fp = fopen(fileName, "wb");
+        if (fp == (FILE *)NULL) {
+            ErrorRaise("WriteCheckpointFile: cannot open %s", fileName);
+        }
+
+        length = buf.len;
+        fwrite(CHECKPOINT_MAGIC, 1, 8, fp);
+        fwrite(&length, sizeof(length), 1, fp);
+        fwrite(buf.text, 1, buf.len, fp);
+        for (pos = 16 + buf.len; pos < headerSpace; pos++) fputc(' ', fp);
+
+        for (i = 0; i < numTables; i++) {
+            nbytes = (size_t)rows[i] * cols[i] * sizeof(real8);
+            if (nbytes > 0) fwrite(data[i], 1, nbytes, fp);
+            pos += nbytes;
+            for (; pos < Aligned(pos) && pos < fileSize; pos++) {
+                fputc(0, fp);
+            }
+        }
+
+        k = ferror(fp);
+        if (fclose(fp) != 0 || k) {
+            ErrorRaise("WriteCheckpointFile: error writing %s", fileName);
+        }
+
+        free(names);
+        free(data);
+        free(rows);
+        free(cols);
+        free(nodeTable);
+        free(segTable);
+        free(buf.text);
+
+        return;
+}
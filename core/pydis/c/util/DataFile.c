@@ -0,0 +1,750 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "DataFile.h"
+#include "Error.h"
+
+/*
+ *      Native reader of ParaDiS nodal data files (dataFileVersion 4 and
+ *      later, single file segment).  The file is memory-mapped and the
+ *      node records after "nodalData =" are parsed in place:
+ *
+ *          domain,index  x y z  numArms  constraint
+ *              nbrDomain,nbrIndex  bx by bz
+ *                  nx ny nz
+ *              ...
+ *
+ *      DataFileOpen() indexes the node records, scanning the file in
+ *      parallel chunks, and DataFileReadNodes() then parses the records
+ *      in parallel straight into the flat arrays used for DisNet and
+ *      HomeImportArrays().  Nothing in here uses Home_t, so this file
+ *      can be built with OpenMP.  Errors are raised with ErrorRaise()
+ *      outside the parallel regions and return to the trap of the entry
+ *      point, which releases the buffers and returns an error code.
+ */
+
+#define DATAFILE_CHUNK_SIZE (1 << 20)
+#define DATAFILE_MAX_TOKEN  64
+
+typedef struct {
+        int domainID;
+        int index;
+        int node;
+} DataFileTag_t;
+
+static const real8 pow10Table[23] = {
+        1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+        1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+        1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+
+static int IsBlank(char c)
+{
+        return(c == ' ' || c == '\t' || c == '\r');
+}
+
+
+static int IsDigit(char c)
+{
+        return(c >= '0' && c <= '9');
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:     SkipSpace
+ *      Description:  Skip white space, line ends and '#' comments.
+ *
+ *------------------------------------------------------------------------*/
+static const char *SkipSpace(const char *p, const char *end)
+{
+        while (p < end) {
+            if (IsBlank(*p) || *p == '\n') {
+                p++;
+            } else if (*p == '#') {
+                while (p < end && *p != '\n') p++;
+            } else {
+                break;
+            }
+        }
+
+        return(p);
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:     ParseReal
+ *      Description:  Parse the number at *pp (after any white space) and
+ *                    advance *pp past it.  Numbers with at most 15
+ *                    significant digits and a small decimal exponent,
+ *                    as written by ParaDiS, are converted exactly with a
+ *                    single multiplication or division; any other number
+ *                    is handed to strtod().
+ *
+ *      Returns:  1 on success, 0 if there is no number at *pp
+ *
+ *------------------------------------------------------------------------*/
+static int ParseReal(const char **pp, const char *end, real8 *val)
+{
+        int                negative, numDigits, anyDigit, exp10, e, eNeg;
+        unsigned long long mantissa;
+        const char         *p, *start;
+        char               buf[DATAFILE_MAX_TOKEN];
+
+        p = SkipSpace(*pp, end);
+        start = p;
+        negative = 0;
+        numDigits = 0;
+        anyDigit = 0;
+        exp10 = 0;
+        mantissa = 0;
+
+        if (p < end && (*p == '+' || *p == '-')) {
+            negative = (*p == '-');
+            p++;
+        }
+
+        for (; p < end && IsDigit(*p); p++) {
+            anyDigit = 1;
+            if (mantissa == 0 && *p == '0') continue;
+            if (numDigits < 19) {
+                mantissa = 10 * mantissa + (*p - '0');
+            } else {
+                exp10++;
+            }
+            numDigits++;
+        }
+
+        if (p < end && *p == '.') {
+            for (p++; p < end && IsDigit(*p); p++) {
+                anyDigit = 1;
+                if (mantissa == 0 && *p == '0') {
+                    exp10--;
+                    continue;
+                }
+                if (numDigits < 19) {
+                    mantissa = 10 * mantissa + (*p - '0');
+                    exp10--;
+                }
+                numDigits++;
+            }
+        }
+
+        if (!anyDigit) return(0);
+
+        if (p < end && (*p == 'e' || *p == 'E')) {
+            p++;
+            eNeg = 0;
+            if (p < end && (*p == '+' || *p == '-')) {
+                eNeg = (*p == '-');
+                p++;
+            }
+            if (p >= end || !IsDigit(*p)) return(0);
+            for (e = 0; p < end && IsDigit(*p); p++) {
+                if (e < 100000) e = 10 * e + (*p - '0');
+            }
+            exp10 += eNeg ? -e : e;
+        }
+
+        if (p < end && !IsBlank(*p) && *p != '\n' && *p != ']') return(0);
+
+        if (mantissa == 0) {
+            *val = negative ? -0.0 : 0.0;
+        } else if (numDigits <= 15 && exp10 >= -22 && exp10 <= 22) {
+            *val = (exp10 >= 0) ? (real8)mantissa * pow10Table[exp10] :
+                                  (real8)mantissa / pow10Table[-exp10];
+            if (negative) *val = -*val;
+        } else {
+            if (p - start >= DATAFILE_MAX_TOKEN) return(0);
+            memcpy(buf, start, p - start);
+            buf[p - start] = 0;
+            *val = strtod(buf, (char **)NULL);
+        }
+
+        *pp = p;
+
+        return(1);
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:     ParseInt
+ *      Description:  Parse the integer at *pp (after any white space)
+ *                    and advance *pp past it.
+ *
+ *      Returns:  1 on success, 0 if there is no integer at *pp
+ *
+ *------------------------------------------------------------------------*/
+static int ParseInt(const char **pp, const char *end, int *val)
+{
+        int        negative;
+        long long  n;
+        const char *p;
+
+        p = SkipSpace(*pp, end);
+        negative = 0;
+
+        if (p < end && (*p == '+' || *p == '-')) {
+            negative = (*p == '-');
+            p++;
+        }
+
+        if (p >= end || !IsDigit(*p)) return(0);
+
+        for (n = 0; p < end && IsDigit(*p); p++) {
+            if (n < 0x7fffffffLL) n = 10 * n + (*p - '0');
+        }
+
+        if (n > 0x7fffffffLL) return(0);
+
+        *val = (int)(negative ? -n : n);
+        *pp = p;
+
+        return(1);
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:     ParseTag
+ *      Description:  Parse a "domainID,index" node tag, blanks around
+ *                    the comma allowed, and advance *pp past it.
+ *
+ *      Returns:  1 on success, 0 if there is no tag at *pp
+ *
+ *------------------------------------------------------------------------*/
+static int ParseTag(const char **pp, const char *end, int tag[2])
+{
+        const char *p = *pp;
+
+        if (!ParseInt(&p, end, &tag[0])) return(0);
+        while (p < end && IsBlank(*p)) p++;
+        if (p >= end || *p != ',') return(0);
+        p++;
+        while (p < end && IsBlank(*p)) p++;
+        if (!ParseInt(&p, end, &tag[1])) return(0);
+
+        *pp = p;
+
+        return(1);
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:     NodeRecordLine
+ *      Description:  Check whether the line starting at p is the first
+ *                    line of a node record: a tag followed by five more
+ *                    words (arm lines have a tag and three words, the
+ *                    plane lines no tag).
+ *
+ *      Returns:  1 for a node record line, 0 otherwise
+ *
+ *------------------------------------------------------------------------*/
+static int NodeRecordLine(const char *p, const char *end)
+{
+        int tag[2], numWords;
+
+        while (p < end && IsBlank(*p)) p++;
+        if (p >= end || *p == '#' || *p == '\n') return(0);
+        if (!ParseTag(&p, end, tag)) return(0);
+
+        numWords = 0;
+        while (p < end && *p != '\n' && *p != '#') {
+            if (IsBlank(*p)) {
+                p++;
+                continue;
+            }
+            numWords++;
+            while (p < end && !IsBlank(*p) && *p != '\n') p++;
+        }
+
+        return(numWords == 5);
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:     ScanChunk
+ *      Description:  Visit the node record lines starting in the byte
+ *                    range [begin,chunkEnd) of the nodal data; with
+ *                    offsets and armCounts set, store the offset and the
+ *                    number of arms of each of them.
+ *
+ *      Returns:  number of node records found
+ *
+ *------------------------------------------------------------------------*/
+static int ScanChunk(const char *data, size_t sectionStart, size_t begin,
+                     size_t chunkEnd, size_t size, size_t *offsets,
+                     int *armCounts)
+{
+        int        count, tag[2], numArms;
+        const char *p, *end;
+        real8      x;
+
+        end = data + size;
+        p = data + begin;
+
+/*
+ *      Start on the first line beginning in the chunk
+ */
+        if (begin > sectionStart && data[begin-1] != '\n') {
+            while (p < end && *p != '\n') p++;
+            if (p < end) p++;
+        }
+
+        count = 0;
+
+        while (p < data + chunkEnd) {
+            if (NodeRecordLine(p, end)) {
+                if (offsets != (size_t *)NULL) {
+                    const char *q = p;
+                    numArms = -1;
+                    if (ParseTag(&q, end, tag) && ParseReal(&q, end, &x) &&
+                        ParseReal(&q, end, &x) && ParseReal(&q, end, &x)) {
+                        ParseInt(&q, end, &numArms);
+                    }
+                    offsets[count] = p - data;
+                    armCounts[count] = numArms;
+                }
+                count++;
+            }
+            while (p < end && *p != '\n') p++;
+            if (p < end) p++;
+        }
+
+        return(count);
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:     ParseHeader
+ *      Description:  Read the data file parameters preceding the nodal
+ *                    data and locate the start of the node records.
+ *                    Raises an error if the file is not supported.
+ *
+ *      Returns:  offset of the node records
+ *
+ *------------------------------------------------------------------------*/
+static size_t ParseHeader(DataFile_t *df, const char *fileName)
+{
+        int        i, numFileSegments, nameLen;
+        const char *p, *end, *name;
+        real8      *coords;
+
+        p = df->data;
+        end = df->data + df->size;
+        numFileSegments = 1;
+        df->dataFileVersion = 0;
+
+        while ((p = SkipSpace(p, end)) < end) {
+            name = p;
+            while (p < end && !IsBlank(*p) && *p != '\n' && *p != '=') p++;
+            nameLen = p - name;
+            while (p < end && IsBlank(*p)) p++;
+
+            if (p >= end || *p != '=') {
+                while (p < end && *p != '\n') p++;
+                continue;
+            }
+            p++;
+
+            if (nameLen == 9 && strncmp(name, "nodalData", 9) == 0) {
+                if (df->dataFileVersion < 4) {
+                    ErrorRaise("DataFileOpen: %s: dataFileVersion %d "
+                               "not supported", fileName,
+                               df->dataFileVersion);
+                }
+                if (numFileSegments != 1) {
+                    ErrorRaise("DataFileOpen: %s: data files split in "
+                               "%d segments not supported", fileName,
+                               numFileSegments);
+                }
+                return(p - df->data);
+            }
+
+            if (nameLen == 15 && strncmp(name, "dataFileVersion", 15) == 0) {
+                ParseInt(&p, end, &df->dataFileVersion);
+            } else if (nameLen == 15 &&
+                       strncmp(name, "numFileSegments", 15) == 0) {
+                ParseInt(&p, end, &numFileSegments);
+            } else if (nameLen == 14 &&
+                       (strncmp(name, "minCoordinates", 14) == 0 ||
+                        strncmp(name, "maxCoordinates", 14) == 0)) {
+                coords = (name[1] == 'i') ? df->minCoordinates :
+                                            df->maxCoordinates;
+                p = SkipSpace(p, end);
+                if (p < end && *p == '[') p++;
+                for (i = 0; i < 3; i++) {
+                    if (!ParseReal(&p, end, &coords[i])) {
+                        ErrorRaise("DataFileOpen: %s: bad %.*s",
+                                   fileName, nameLen, name);
+                    }
+                }
+            }
+
+/*
+ *          Skip the rest of the value, bracketed lists included, but
+ *          not the next line
+ */
+            while (p < end && IsBlank(*p)) p++;
+            if (p < end && *p == '[') {
+                while (p < end && *p != ']') p++;
+                if (p < end) p++;
+            }
+            while (p < end && *p != '\n') p++;
+        }
+
+        ErrorRaise("DataFileOpen: %s: no nodalData found", fileName);
+
+        return(0);
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:     DataFileOpen
+ *      Description:  Memory-map a ParaDiS data file, read its parameters
+ *                    and index its node records.  The nodal data is
+ *                    scanned in DATAFILE_CHUNK_SIZE chunks in parallel,
+ *                    once to count the records of every chunk and once
+ *                    to store their offsets.
+ *
+ *      Returns:  the opened data file, to be released with
+ *                DataFileClose(), or NULL on error (see ErrorMessage())
+ *
+ *------------------------------------------------------------------------*/
+DataFile_t *DataFileOpen(char *fileName)
+{
+        int         fd, c, i, numChunks, bad;
+        int         *chunkStart;
+        size_t      sectionStart;
+        struct stat st;
+        DataFile_t  *volatile df;
+        ErrorTrap_t trap;
+
+        df = (DataFile_t *)NULL;
+
+        ErrorTrapPush(&trap);
+        if (setjmp(trap.env) != 0) {
+            DataFileClose(df);
+            return((DataFile_t *)NULL);
+        }
+
+        fd = open(fileName, O_RDONLY);
+        if (fd < 0) {
+            ErrorRaise("DataFileOpen: cannot open %s", fileName);
+        }
+
+        if (fstat(fd, &st) != 0 || st.st_size == 0) {
+            close(fd);
+            ErrorRaise("DataFileOpen: %s is empty", fileName);
+        }
+
+        df = (DataFile_t *)calloc(1, sizeof(DataFile_t));
+        if (df == (DataFile_t *)NULL) {
+            close(fd);
+            ErrorRaise("DataFileOpen: out of memory");
+        }
+        df->size = (size_t)st.st_size;
+        df->data = (char *)mmap(NULL, df->size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+
+        if (df->data == (char *)MAP_FAILED) {
+            ErrorRaise("DataFileOpen: cannot map %s", fileName);
+        }
+
+        madvise(df->data, df->size, MADV_WILLNEED);
+
+        sectionStart = ParseHeader(df, fileName);
+
+        numChunks = (int)((df->size - sectionStart) / DATAFILE_CHUNK_SIZE) + 1;
+        chunkStart = (int *)calloc(numChunks + 1, sizeof(int));
+        if (chunkStart == (int *)NULL) {
+            ErrorRaise("DataFileOpen: out of memory (%d chunks)", numChunks);
+        }
+
+#pragma omp parallel for schedule(dynamic, 1)
+        for (c = 0; c < numChunks; c++) {
+            size_t begin = sectionStart + (size_t)c * DATAFILE_CHUNK_SIZE;
+            size_t chunkEnd = begin + DATAFILE_CHUNK_SIZE;
+            if (chunkEnd > df->size) chunkEnd = df->size;
+            chunkStart[c+1] = ScanChunk(df->data, sectionStart, begin,
+                                        chunkEnd, df->size, (size_t *)NULL,
+                                        (int *)NULL);
+        }
+
+        for (c = 0; c < numChunks; c++) chunkStart[c+1] += chunkStart[c];
+
+        df->numNodes = chunkStart[numChunks];
+        df->nodeOffset = (size_t *)malloc((df->numNodes + 1) * sizeof(size_t));
+        df->armStart = (int *)malloc((df->numNodes + 1) * sizeof(int));
+        if (df->nodeOffset == (size_t *)NULL || df->armStart == (int *)NULL) {
+            free(chunkStart);
+            ErrorRaise("DataFileOpen: out of memory (%d nodes)", df->numNodes);
+        }
+
+#pragma omp parallel for schedule(dynamic, 1)
+        for (c = 0; c < numChunks; c++) {
+            size_t begin = sectionStart + (size_t)c * DATAFILE_CHUNK_SIZE;
+            size_t chunkEnd = begin + DATAFILE_CHUNK_SIZE;
+            if (chunkEnd > df->size) chunkEnd = df->size;
+            ScanChunk(df->data, sectionStart, begin, chunkEnd, df->size,
+                      &df->nodeOffset[chunkStart[c]],
+                      &df->armStart[chunkStart[c]+1]);
+        }
+
+        free(chunkStart);
+
+        df->armStart[0] = 0;
+        bad = -1;
+        for (i = 0; i < df->numNodes; i++) {
+            if (df->armStart[i+1] < 0) {
+                bad = i;
+                break;
+            }
+            df->armStart[i+1] += df->armStart[i];
+        }
+
+        if (bad >= 0) {
+            ErrorRaise("DataFileOpen: %s: bad arm count in node record %d",
+                       fileName, bad);
+        }
+
+        df->numArms = df->armStart[df->numNodes];
+
+        ErrorTrapPop(&trap);
+
+        return(df);
+}
+
+
+static int CompareTags(const void *a, const void *b)
+{
+        const DataFileTag_t *t1 = (const DataFileTag_t *)a;
+        const DataFileTag_t *t2 = (const DataFileTag_t *)b;
+
+        if (t1->domainID != t2->domainID) {
+            return((t1->domainID < t2->domainID) ? -1 : 1);
+        }
+        if (t1->index != t2->index) return((t1->index < t2->index) ? -1 : 1);
+
+        return(0);
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:     DataFileReadNodes
+ *      Description:  Parse the node records indexed by DataFileOpen()
+ *                    into flat arrays, nodes in file order.  Every
+ *                    segment is listed by both of its end nodes in the
+ *                    file and is returned once, from the node with the
+ *                    smaller tag, with the Burgers vector of that node's
+ *                    arm.  Nodes and their arms are parsed in parallel.
+ *
+ *      Arguments:
+ *          df           data file opened by DataFileOpen()
+ *          tags         [numNodes][2] returned node tags
+ *          R            [numNodes][3] returned node positions
+ *          constraints  [numNodes] returned node constraints
+ *          maxSegs      size of the segment arrays, numArms/2 for a
+ *                       consistent file
+ *          nodeids      [maxSegs][2] returned end node indices
+ *          burgers      [maxSegs][3] returned Burgers vectors
+ *          planes       [maxSegs][3] returned glide plane normals
+ *
+ *      Returns:  number of segments, or -1 on error (see ErrorMessage())
+ *
+ *------------------------------------------------------------------------*/
+int DataFileReadNodes(DataFile_t *df, int *tags, real8 *R, int *constraints,
+                      int maxSegs, int *nodeids, real8 *burgers,
+                      real8 *planes)
+{
+        int           i, numNodes, numArms, numSegs, badNode, badArm;
+        int           *armTags, *armNbr, *segStart;
+        real8         *armVals;
+        DataFileTag_t *sorted;
+        ErrorTrap_t   trap;
+
+        numNodes = df->numNodes;
+        numArms = df->numArms;
+
+        armTags = (int *)malloc((2 * numArms + 1) * sizeof(int));
+        armNbr = (int *)malloc((numArms + 1) * sizeof(int));
+        armVals = (real8 *)malloc((6 * numArms + 1) * sizeof(real8));
+        segStart = (int *)malloc((numNodes + 1) * sizeof(int));
+        sorted = (DataFileTag_t *)malloc((numNodes + 1) * sizeof(DataFileTag_t));
+
+        ErrorTrapPush(&trap);
+        if (setjmp(trap.env) != 0) {
+            free(armTags);
+            free(armNbr);
+            free(armVals);
+            free(segStart);
+            free(sorted);
+            return(-1);
+        }
+
+        if (armTags == (int *)NULL || armNbr == (int *)NULL ||
+            armVals == (real8 *)NULL || segStart == (int *)NULL ||
+            sorted == (DataFileTag_t *)NULL) {
+            ErrorRaise("DataFileReadNodes: out of memory (%d nodes, %d arms)",
+                       numNodes, numArms);
+        }
+
+/*
+ *      Parse the records
+ */
+        badNode = numNodes;
+
+#pragma omp parallel for schedule(static) reduction(min:badNode)
+        for (i = 0; i < numNodes; i++) {
+            int        j, k, n, ok;
+            const char *p = df->data + df->nodeOffset[i];
+            const char *end = df->data + df->size;
+
+            ok = ParseTag(&p, end, &tags[2*i]);
+            for (k = 0; k < 3 && ok; k++) ok = ParseReal(&p, end, &R[3*i+k]);
+            ok = ok && ParseInt(&p, end, &n) &&
+                 ParseInt(&p, end, &constraints[i]) &&
+                 n == df->armStart[i+1] - df->armStart[i];
+
+            for (j = df->armStart[i]; j < df->armStart[i+1] && ok; j++) {
+                ok = ParseTag(&p, end, &armTags[2*j]);
+                for (k = 0; k < 6 && ok; k++) {
+                    ok = ParseReal(&p, end, &armVals[6*j+k]);
+                }
+            }
+
+            if (!ok && i < badNode) badNode = i;
+
+            sorted[i].domainID = tags[2*i];
+            sorted[i].index = tags[2*i+1];
+            sorted[i].node = i;
+        }
+
+        if (badNode < numNodes) {
+            ErrorRaise("DataFileReadNodes: malformed record of node %d",
+                       badNode);
+        }
+
+/*
+ *      Look up the neighbor node of every arm
+ */
+        qsort(sorted, numNodes, sizeof(DataFileTag_t), CompareTags);
+
+        for (i = 1; i < numNodes; i++) {
+            if (CompareTags(&sorted[i-1], &sorted[i]) == 0) {
+                ErrorRaise("DataFileReadNodes: duplicate node tag (%d,%d)",
+                           sorted[i].domainID, sorted[i].index);
+            }
+        }
+
+        badArm = numArms;
+
+#pragma omp parallel for schedule(static) reduction(min:badArm)
+        for (i = 0; i < numNodes; i++) {
+            int           j, count = 0;
+            DataFileTag_t key, *nbr;
+
+            for (j = df->armStart[i]; j < df->armStart[i+1]; j++) {
+                key.domainID = armTags[2*j];
+                key.index = armTags[2*j+1];
+                nbr = (DataFileTag_t *)bsearch(&key, sorted, numNodes,
+                                               sizeof(DataFileTag_t),
+                                               CompareTags);
+                if (nbr == (DataFileTag_t *)NULL || nbr->node == i) {
+                    if (j < badArm) badArm = j;
+                    armNbr[j] = -1;
+                    continue;
+                }
+                armNbr[j] = nbr->node;
+                if (tags[2*i] < key.domainID ||
+                    (tags[2*i] == key.domainID && tags[2*i+1] < key.index)) {
+                    count++;
+                }
+            }
+            segStart[i+1] = count;
+        }
+
+        if (badArm < numArms) {
+            ErrorRaise("DataFileReadNodes: arm %d has an unknown or self "
+                       "neighbor (%d,%d)", badArm, armTags[2*badArm],
+                       armTags[2*badArm+1]);
+        }
+
+        segStart[0] = 0;
+        for (i = 0; i < numNodes; i++) segStart[i+1] += segStart[i];
+
+        if (segStart[numNodes] > maxSegs) {
+            ErrorRaise("DataFileReadNodes: %d segments exceed maxSegs %d, "
+                       "arms are not listed by both end nodes",
+                       segStart[numNodes], maxSegs);
+        }
+
+/*
+ *      Segments from the nodes with the smaller tag
+ */
+#pragma omp parallel for schedule(static)
+        for (i = 0; i < numNodes; i++) {
+            int j, k, m, s = segStart[i];
+
+            for (j = df->armStart[i]; j < df->armStart[i+1]; j++) {
+                m = armNbr[j];
+                if (tags[2*i] > tags[2*m] ||
+                    (tags[2*i] == tags[2*m] && tags[2*i+1] > tags[2*m+1])) {
+                    continue;
+                }
+                nodeids[2*s] = i;
+                nodeids[2*s+1] = m;
+                for (k = 0; k < 3; k++) {
+                    burgers[3*s+k] = armVals[6*j+k];
+                    planes[3*s+k] = armVals[6*j+3+k];
+                }
+                s++;
+            }
+        }
+
+        numSegs = segStart[numNodes];
+
+        ErrorTrapPop(&trap);
+
+        free(armTags);
+        free(armNbr);
+        free(armVals);
+        free(segStart);
+        free(sorted);
+
+        return(numSegs);
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:     DataFileClose
+ *      Description:  Unmap the data file and free its index.
+ *
+ *------------------------------------------------------------------------*/
+void DataFileClose(DataFile_t *df)
+{
+        if (df == (DataFile_t *)NULL) return;
+
+        if (df->data != (char *)NULL && df->data != (char *)MAP_FAILED) {
+            munmap(df->data, df->size);
+        }
+
+        free(df->nodeOffset);
+        free(df->armStart);
+        free(df);
+
+        return;
+}
@@ -0,0 +1,1808 @@
+/***************************************************************************
+ *
+ *      Module:      DomainDecomp.c
+ *      Description: Spatial domain decomposition of the segment force
+ *                   calculation over MPI ranks (see DomainDecomp.h).
+ *
+ *                   The domain boundaries are a recursive sectioning
+ *                   decomposition (RSDecomp_t) in fractional cell
+ *                   coordinates: nXdoms slabs along the first cell
+ *                   vector, each split into nYdoms columns, each split
+ *                   into nZdoms domains, with the boundaries placed so
+ *                   that every domain holds about the same number of
+ *                   segment midpoints.  Domain (i,j,k) has the index
+ *                   (i*nYdoms + j)*nZdoms + k, which is also its rank.
+ *
+ *                   With decomposition type 2 the domains are a
+ *                   recursive bisection tree (RBDecomp_t) instead: the
+ *                   cell is cut along each direction with more than one
+ *                   domain into two parts holding the load of
+ *                   floor(n/2) and ceil(n/2) domains, and each part is
+ *                   cut again until it holds a single domain.  Domains
+ *                   are numbered by a depth-first walk of the tree.
+ *
+ *                   Both decompositions balance the load of the segment
+ *                   midpoints: one per segment, or the load measured by
+ *                   the last DomainDecompSegForces() (pair count or
+ *                   wall clock time) for DomainDecompRebalance().
+ *
+ *                   Ghost segments of a domain are the segments of the
+ *                   other domains whose midpoint lies within
+ *                   cutoff + the longest segment length of the domain,
+ *                   which includes every segment within cutoff of a
+ *                   native segment for the pair criterion of
+ *                   SegSegForceCellList().  Without a cutoff all
+ *                   segments are ghosts of every domain.  The ghost
+ *                   messages are non-blocking: the interior pairs of
+ *                   two native segments are evaluated while they are
+ *                   in flight, the boundary pairs with a ghost segment
+ *                   once they have arrived.
+ *
+ *      Included functions:
+ *
+ *          DomainDecompInit
+ *          DomainDecompFinalize
+ *          DomainDecompCreate
+ *          DomainDecompFree
+ *          DomainDecompSetType
+ *          DomainDecompBalance
+ *          DomainDecompBalanceLoad
+ *          DomainDecompGetSegLoad
+ *          DomainDecompRebalance
+ *          DomainDecompGetBounds
+ *          DomainDecompOwner
+ *          DomainDecompSegOwners
+ *          DomainDecompMigrate
+ *          DomainDecompGetSegments
+ *          DomainDecompSegForces
+ *          DomainDecompNodeForces
+ *          DomainDecompSum
+ *
+ **************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#ifdef PARALLEL
+#include <mpi.h>
+#endif
+
+#include "DomainDecomp.h"
+#include "Decomp.h"
+#include "Comm.h"
+#include "Profile.h"
+#include "../calforce/SegSegForceDriver.h"
+
+/*
+ *      Values per segment in the ghost and migration messages
+ */
+#define FLTS_PER_DECOMP_GHOST  9
+#define FLTS_PER_DECOMP_SEG    11
+#define FLTS_PER_DECOMP_FORCE  4
+
+struct _domaindecomp {
+        int        myDomain;
+        int        numDomains;
+        int        nDoms[3];
+        real8      h[9], hinv[9], origin[3];
+        int        isPeriodic[3];
+        int        decompType;
+        RSDecomp_t decomp;
+        RBDecomp_t *rbDecomp;
+        RBDecomp_t **rbLeaf;
+
+/*
+ *      Load of the native segments of the last DomainDecompSegForces():
+ *      the share of each segment in the pairs evaluated, and the pair
+ *      count and wall clock time of the force calculation
+ */
+        int        numLoad;
+        real8      *loadShare;
+        real8      forcePairs, forceTime;
+
+/*
+ *      Segments received by the last DomainDecompMigrate()
+ */
+        int        numSegs;
+        int        *segNodes;
+        real8      *R1, *R2, *burgers;
+#ifdef PARALLEL
+        MPI_Comm   comm;
+#endif
+};
+
+typedef struct {
+        real8 s[3];
+        real8 w;
+} DecompPoint_t;
+
+typedef struct {
+        int tag;
+        int index;
+} DecompTag_t;
+
+#ifdef PARALLEL
+static int mpiInitializedHere = 0;
+#endif
+
+
+static int ComparePointX(const void *a, const void *b)
+{
+        real8 d = ((const DecompPoint_t *)a)->s[0] - ((const DecompPoint_t *)b)->s[0];
+        return((d > 0.0) - (d < 0.0));
+}
+
+static int ComparePointY(const void *a, const void *b)
+{
+        real8 d = ((const DecompPoint_t *)a)->s[1] - ((const DecompPoint_t *)b)->s[1];
+        return((d > 0.0) - (d < 0.0));
+}
+
+static int ComparePointZ(const void *a, const void *b)
+{
+        real8 d = ((const DecompPoint_t *)a)->s[2] - ((const DecompPoint_t *)b)->s[2];
+        return((d > 0.0) - (d < 0.0));
+}
+
+static int (*ComparePoint[3])(const void *, const void *) = {
+        ComparePointX, ComparePointY, ComparePointZ
+};
+
+static int CompareTag(const void *a, const void *b)
+{
+        int ta = ((const DecompTag_t *)a)->tag, tb = ((const DecompTag_t *)b)->tag;
+        return((ta > tb) - (ta < tb));
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:    Invert33
+ *      Description: Inverse of a row-major 3x3 matrix.  Returns 0 if
+ *                   the matrix is singular.
+ *
+ *------------------------------------------------------------------------*/
+static int Invert33(real8 *m, real8 *inv)
+{
+        int   i;
+        real8 det;
+
+        inv[0] = m[4]*m[8] - m[5]*m[7];
+        inv[1] = m[2]*m[7] - m[1]*m[8];
+        inv[2] = m[1]*m[5] - m[2]*m[4];
+        inv[3] = m[5]*m[6] - m[3]*m[8];
+        inv[4] = m[0]*m[8] - m[2]*m[6];
+        inv[5] = m[2]*m[3] - m[0]*m[5];
+        inv[6] = m[3]*m[7] - m[4]*m[6];
+        inv[7] = m[1]*m[6] - m[0]*m[7];
+        inv[8] = m[0]*m[4] - m[1]*m[3];
+
+        det = m[0]*inv[0] + m[1]*inv[3] + m[2]*inv[6];
+        if (det == 0.0) return(0);
+
+        for (i = 0; i < 9; i++) inv[i] /= det;
+
+        return(1);
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:    FracCoords
+ *      Description: Fractional cell coordinates of x, wrapped into
+ *                   [0,1) in the periodic directions
+ *
+ *------------------------------------------------------------------------*/
+static void FracCoords(DomainDecomp_t *dd, real8 *x, real8 *s)
+{
+        int   i;
+        real8 dx[3];
+
+        for (i = 0; i < 3; i++) dx[i] = x[i] - dd->origin[i];
+
+        for (i = 0; i < 3; i++) {
+            s[i] = dd->hinv[3*i]*dx[0] + dd->hinv[3*i+1]*dx[1] +
+                   dd->hinv[3*i+2]*dx[2];
+            if (dd->isPeriodic[i]) s[i] -= floor(s[i]);
+        }
+
+        return;
+}
+
+
+/*
+ *      Fractional coordinates of the midpoint of segment i
+ */
+static void SegMidFrac(DomainDecomp_t *dd, real8 *R1, real8 *R2, int i,
+                       real8 *s)
+{
+        int   k;
+        real8 p2[3], mid[3];
+
+        PBCClosestImage(dd->h, dd->hinv, dd->isPeriodic, &R1[3*i], &R2[3*i], p2);
+        for (k = 0; k < 3; k++) mid[k] = 0.5 * (R1[3*i+k] + p2[k]);
+
+        FracCoords(dd, mid, s);
+
+        return;
+}
+
+
+/*
+ *      Index i of the interval bounds[i] <= s < bounds[i+1], clamped to
+ *      0..n-1
+ */
+static int FindInterval(real8 *bounds, int n, real8 s)
+{
+        int i;
+
+        for (i = 0; i < n - 1; i++) {
+            if (s < bounds[i+1]) break;
+        }
+
+        return(i);
+}
+
+
+static void DomainIndices(DomainDecomp_t *dd, int domain, int *i, int *j, int *k)
+{
+        *k = domain % dd->nDoms[2];
+        *j = (domain / dd->nDoms[2]) % dd->nDoms[1];
+        *i = domain / (dd->nDoms[1] * dd->nDoms[2]);
+
+        return;
+}
+
+
+#ifdef PARALLEL
+/*
+ *      Distance from s to the interval [lo,hi] in fractional
+ *      coordinates, across the periodic boundary if periodic
+ */
+static real8 IntervalDistance(real8 s, real8 lo, real8 hi, int periodic)
+{
+        real8 t;
+
+        if (periodic) {
+            t = s - lo;
+            t -= floor(t);
+            if (t <= hi - lo) return(0.0);
+            t -= hi - lo;
+            return((t < 1.0 - (hi - lo) - t) ? t : 1.0 - (hi - lo) - t);
+        }
+
+        if (s < lo) return(lo - s);
+        if (s > hi) return(s - hi);
+
+        return(0.0);
+}
+#endif
+
+
+/*
+ *      Number m of the sorted points [0..n-1] holding the load target:
+ *      the points before m carry at most target of the load
+ */
+static int WeightedSplit(DecompPoint_t *pts, int n, real8 target)
+{
+        int   m;
+        real8 sum = 0.0;
+
+        for (m = 0; m < n; m++) {
+            if (sum + pts[m].w > target) break;
+            sum += pts[m].w;
+        }
+
+        return(m);
+}
+
+
+/*
+ *      Split position between the sorted points [0..m-1] and [m..n-1]
+ *      along dim, halfway between the neighboring points; frac of the
+ *      way from lo to hi if all points are on one side
+ */
+static real8 SplitValue(DecompPoint_t *pts, int n, int m, int dim,
+                        real8 lo, real8 hi, real8 frac)
+{
+        if (m <= 0 || m >= n) return(lo + (hi - lo) * frac);
+
+        return(0.5 * (pts[m-1].s[dim] + pts[m].s[dim]));
+}
+
+
+static real8 TotalLoad(DecompPoint_t *pts, int n)
+{
+        int   i;
+        real8 sum = 0.0;
+
+        for (i = 0; i < n; i++) sum += pts[i].w;
+
+        return(sum);
+}
+
+
+/*
+ *      Section the sorted points [0..n-1] along dim into nParts of equal
+ *      load; returns the boundaries [nParts+1] and the first point of
+ *      each part in first[nParts+1]
+ */
+static void SectionBounds(DecompPoint_t *pts, int n, int nParts, int dim,
+                          real8 *bounds, int *first)
+{
+        int   i;
+        real8 load;
+
+        load = TotalLoad(pts, n);
+
+        bounds[0] = 0.0;
+        bounds[nParts] = 1.0;
+        first[0] = 0;
+        first[nParts] = n;
+
+        for (i = 1; i < nParts; i++) {
+            first[i] = WeightedSplit(pts, n, load * i / nParts);
+            if (first[i] < first[i-1]) first[i] = first[i-1];
+            bounds[i] = SplitValue(pts, n, first[i], dim, 0.0, 1.0,
+                                   (real8)i / nParts);
+            if (bounds[i] < bounds[i-1]) bounds[i] = bounds[i-1];
+            if (bounds[i] > 1.0) bounds[i] = 1.0;
+        }
+
+        return;
+}
+
+
+/*
+ *      Free a recursive bisection (sub)tree
+ */
+static void FreeRBDecomp(RBDecomp_t *node)
+{
+        int i;
+
+        if (node == (RBDecomp_t *)NULL) return;
+
+        for (i = 0; i < 8; i++) FreeRBDecomp(node->subDecomp[i]);
+        free(node);
+
+        return;
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:    BuildRBDecomp
+ *      Description: Build the recursive bisection subtree of the box
+ *                   cMin..cMax holding numDoms domains for the points
+ *                   [0..n-1] (reordered in place).  The box is cut in
+ *                   two along x, each half along y and each quarter
+ *                   along z (skipping directions with a single domain),
+ *                   giving up to 8 octants; the octant index has bit d
+ *                   set for the upper part along direction d.
+ *
+ *      Arguments:
+ *          level     depth of the node, its octant path is
+ *                    decompID[0..level-1]
+ *          nextID    next domain ID to assign to a leaf
+ *
+ *------------------------------------------------------------------------*/
+static RBDecomp_t *BuildRBDecomp(DomainDecomp_t *dd, DecompPoint_t *pts,
+                                 int n, int *numDoms, real8 *cMin,
+                                 real8 *cMax, int level, char *decompID,
+                                 int *nextID)
+{
+        int        d, k, p, m, numParts, nLo;
+        int        start[8], count[8], octant[8], nd[8][3];
+        real8      cut, pMin[8][3], pMax[8][3];
+        RBDecomp_t *node;
+
+        node = (RBDecomp_t *)calloc(1, sizeof(RBDecomp_t));
+        memcpy(node->numDoms, numDoms, 3 * sizeof(int));
+        memcpy(node->cMin, cMin, 3 * sizeof(real8));
+        memcpy(node->cMax, cMax, 3 * sizeof(real8));
+        memcpy(node->decompID, decompID, MAX_DECOMP_LVLS);
+        node->totLoad = TotalLoad(pts, n);
+
+        if (numDoms[0] * numDoms[1] * numDoms[2] == 1) {
+            node->domID = (*nextID)++;
+            dd->rbLeaf[node->domID] = node;
+            return(node);
+        }
+
+        node->domID = -1;
+
+        numParts = 1;
+        start[0] = 0;
+        count[0] = n;
+        octant[0] = 0;
+        memcpy(nd[0], numDoms, 3 * sizeof(int));
+        memcpy(pMin[0], cMin, 3 * sizeof(real8));
+        memcpy(pMax[0], cMax, 3 * sizeof(real8));
+
+        for (d = 0; d < 3; d++) {
+            if (numDoms[d] < 2) continue;
+
+            for (p = numParts - 1; p >= 0; p--) {
+                DecompPoint_t *q = &pts[start[p]];
+
+                nLo = nd[p][d] / 2;
+                qsort(q, count[p], sizeof(DecompPoint_t), ComparePoint[d]);
+                m = WeightedSplit(q, count[p],
+                                  TotalLoad(q, count[p]) * nLo / nd[p][d]);
+                cut = SplitValue(q, count[p], m, d, pMin[p][d], pMax[p][d],
+                                 (real8)nLo / nd[p][d]);
+                if (cut < pMin[p][d]) cut = pMin[p][d];
+                if (cut > pMax[p][d]) cut = pMax[p][d];
+
+/*
+ *              Part p keeps the lower half, the upper half is added at
+ *              the end of the part list
+ */
+                k = numParts++;
+                start[k] = start[p] + m;
+                count[k] = count[p] - m;
+                octant[k] = octant[p] | (1 << d);
+                memcpy(nd[k], nd[p], 3 * sizeof(int));
+                memcpy(pMin[k], pMin[p], 3 * sizeof(real8));
+                memcpy(pMax[k], pMax[p], 3 * sizeof(real8));
+                nd[k][d] = nd[p][d] - nLo;
+                pMin[k][d] = cut;
+
+                count[p] = m;
+                nd[p][d] = nLo;
+                pMax[p][d] = cut;
+            }
+        }
+
+/*
+ *      Recurse in octant order so the domain IDs follow the tree
+ */
+        for (k = 0; k < 8; k++) {
+            for (p = 0; p < numParts; p++) {
+                if (octant[p] != k) continue;
+                if (level < MAX_DECOMP_LVLS) decompID[level] = (char)k;
+                node->subDecomp[k] = BuildRBDecomp(dd, &pts[start[p]], count[p],
+                                                   nd[p], pMin[p], pMax[p],
+                                                   level + 1, decompID, nextID);
+                if (level < MAX_DECOMP_LVLS) decompID[level] = 0;
+            }
+        }
+
+        return(node);
+}
+
+
+/*
+ *      Rebuild the recursive bisection tree for the points [0..n-1]
+ */
+static void RBDecompose(DomainDecomp_t *dd, DecompPoint_t *pts, int n)
+{
+        int   nextID = 0;
+        real8 cMin[3] = {0.0, 0.0, 0.0}, cMax[3] = {1.0, 1.0, 1.0};
+        char  decompID[MAX_DECOMP_LVLS];
+
+        memset(decompID, 0, MAX_DECOMP_LVLS);
+        FreeRBDecomp(dd->rbDecomp);
+        dd->rbDecomp = BuildRBDecomp(dd, pts, n, dd->nDoms, cMin, cMax, 0,
+                                     decompID, &nextID);
+
+        return;
+}
+
+
+/*
+ *      Recursive sectioning boundaries for the points [0..n-1]
+ */
+static void RSDecompose(DomainDecomp_t *dd, DecompPoint_t *pts, int n)
+{
+        int i, j, nX, nY, nZ, iLo, iHi, jLo, jHi, *xFirst, *yFirst, *zFirst;
+
+        nX = dd->nDoms[0];
+        nY = dd->nDoms[1];
+        nZ = dd->nDoms[2];
+
+        xFirst = (int *)malloc((nX + nY + nZ + 3) * sizeof(int));
+        yFirst = xFirst + nX + 1;
+        zFirst = yFirst + nY + 1;
+
+/*
+ *      Section along x, then each slab along y, then each column
+ *      along z
+ */
+        qsort(pts, n, sizeof(DecompPoint_t), ComparePointX);
+        SectionBounds(pts, n, nX, 0, dd->decomp.domBoundX, xFirst);
+
+        for (i = 0; i < nX; i++) {
+            iLo = xFirst[i];
+            iHi = xFirst[i+1];
+            qsort(&pts[iLo], iHi - iLo, sizeof(DecompPoint_t), ComparePointY);
+            SectionBounds(&pts[iLo], iHi - iLo, nY, 1, dd->decomp.domBoundY[i],
+                          yFirst);
+
+            for (j = 0; j < nY; j++) {
+                jLo = iLo + yFirst[j];
+                jHi = iLo + yFirst[j+1];
+                qsort(&pts[jLo], jHi - jLo, sizeof(DecompPoint_t), ComparePointZ);
+                SectionBounds(&pts[jLo], jHi - jLo, nZ, 2,
+                              dd->decomp.domBoundZ[i][j], zFirst);
+            }
+        }
+
+        free(xFirst);
+
+        return;
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:    DomainDecompInit
+ *      Description: Initialize MPI if nobody did yet and return the
+ *                   rank and number of ranks (0 and 1 without PARALLEL)
+ *
+ *      Returns:  0 on success, -1 on error
+ *
+ *------------------------------------------------------------------------*/
+int DomainDecompInit(int *myDomain, int *numDomains)
+{
+#ifdef PARALLEL
+        int initialized;
+
+        MPI_Initialized(&initialized);
+        if (!initialized) {
+            if (MPI_Init((int *)NULL, (char ***)NULL) != MPI_SUCCESS) {
+                fprintf(stderr, "DomainDecompInit: MPI_Init failed\n");
+                return(-1);
+            }
+            mpiInitializedHere = 1;
+        }
+
+        MPI_Comm_rank(MPI_COMM_WORLD, myDomain);
+        MPI_Comm_size(MPI_COMM_WORLD, numDomains);
+#else
+        *myDomain = 0;
+        *numDomains = 1;
+#endif
+
+        return(0);
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:    DomainDecompFinalize
+ *      Description: Finalize MPI if DomainDecompInit() initialized it
+ *
+ *------------------------------------------------------------------------*/
+void DomainDecompFinalize(void)
+{
+#ifdef PARALLEL
+        int finalized;
+
+        if (mpiInitializedHere) {
+            MPI_Finalized(&finalized);
+            if (!finalized) MPI_Finalize();
+            mpiInitializedHere = 0;
+        }
+#endif
+
+        return;
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:    DomainDecompCreate
+ *      Description: Create a uniform decomposition of the cell into
+ *                   nXdoms x nYdoms x nZdoms domains, one per rank
+ *
+ *      Arguments:
+ *          h            3x3 cell matrix (row-major, cell vectors are
+ *                       the columns)
+ *          origin       lower corner of the cell
+ *          isPeriodic   3 flags, non-zero for periodic directions
+ *
+ *      Returns:  the decomposition, NULL if the number of domains does
+ *                not match the number of ranks or h is singular
+ *
+ *------------------------------------------------------------------------*/
+DomainDecomp_t *DomainDecompCreate(int nXdoms, int nYdoms, int nZdoms,
+                                   real8 *h, real8 *origin, int *isPeriodic)
+{
+        int            i, j, k, myDomain, numDomains;
+        DomainDecomp_t *dd;
+
+        if (DomainDecompInit(&myDomain, &numDomains) != 0)
+            return((DomainDecomp_t *)NULL);
+
+        if (nXdoms < 1 || nYdoms < 1 || nZdoms < 1 ||
+            nXdoms * nYdoms * nZdoms != numDomains) {
+            fprintf(stderr, "DomainDecompCreate: %d x %d x %d domains "
+                    "for %d ranks\n", nXdoms, nYdoms, nZdoms, numDomains);
+            return((DomainDecomp_t *)NULL);
+        }
+
+        dd = (DomainDecomp_t *)calloc(1, sizeof(DomainDecomp_t));
+        dd->myDomain = myDomain;
+        dd->numDomains = numDomains;
+        dd->nDoms[0] = nXdoms;
+        dd->nDoms[1] = nYdoms;
+        dd->nDoms[2] = nZdoms;
+        dd->decompType = 1;
+        dd->rbLeaf = (RBDecomp_t **)calloc(numDomains, sizeof(RBDecomp_t *));
+        memcpy(dd->h, h, 9 * sizeof(real8));
+        memcpy(dd->origin, origin, 3 * sizeof(real8));
+        for (i = 0; i < 3; i++) dd->isPeriodic[i] = (isPeriodic != NULL && isPeriodic[i]);
+#ifdef PARALLEL
+        MPI_Comm_dup(MPI_COMM_WORLD, &dd->comm);
+#endif
+
+        if (!Invert33(dd->h, dd->hinv)) {
+            fprintf(stderr, "DomainDecompCreate: singular cell matrix\n");
+            DomainDecompFree(dd);
+            return((DomainDecomp_t *)NULL);
+        }
+
+        dd->decomp.domBoundX = (real8 *)malloc((nXdoms + 1) * sizeof(real8));
+        dd->decomp.domBoundY = (real8 **)malloc(nXdoms * sizeof(real8 *));
+        dd->decomp.domBoundZ = (real8 ***)malloc(nXdoms * sizeof(real8 **));
+
+        for (i = 0; i <= nXdoms; i++)
+            dd->decomp.domBoundX[i] = (real8)i / nXdoms;
+
+        for (i = 0; i < nXdoms; i++) {
+            dd->decomp.domBoundY[i] = (real8 *)malloc((nYdoms + 1) * sizeof(real8));
+            dd->decomp.domBoundZ[i] = (real8 **)malloc(nYdoms * sizeof(real8 *));
+            for (j = 0; j <= nYdoms; j++)
+                dd->decomp.domBoundY[i][j] = (real8)j / nYdoms;
+            for (j = 0; j < nYdoms; j++) {
+                dd->decomp.domBoundZ[i][j] = (real8 *)malloc((nZdoms + 1) * sizeof(real8));
+                for (k = 0; k <= nZdoms; k++)
+                    dd->decomp.domBoundZ[i][j][k] = (real8)k / nZdoms;
+            }
+        }
+
+        return(dd);
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:    DomainDecompFree
+ *
+ *------------------------------------------------------------------------*/
+void DomainDecompFree(DomainDecomp_t *dd)
+{
+        int i, j;
+
+        if (dd == (DomainDecomp_t *)NULL) return;
+
+        if (dd->decomp.domBoundZ != NULL) {
+            for (i = 0; i < dd->nDoms[0]; i++) {
+                for (j = 0; j < dd->nDoms[1]; j++) free(dd->decomp.domBoundZ[i][j]);
+                free(dd->decomp.domBoundZ[i]);
+                free(dd->decomp.domBoundY[i]);
+            }
+        }
+        free(dd->decomp.domBoundX);
+        free(dd->decomp.domBoundY);
+        free(dd->decomp.domBoundZ);
+
+        FreeRBDecomp(dd->rbDecomp);
+        free(dd->rbLeaf);
+        free(dd->loadShare);
+
+        free(dd->segNodes);
+        free(dd->R1);
+        free(dd->R2);
+        free(dd->burgers);
+
+#ifdef PARALLEL
+        MPI_Comm_free(&dd->comm);
+#endif
+        free(dd);
+
+        return;
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:    DomainDecompSetType
+ *      Description: Select the decomposition type as the decompType
+ *                   control parameter does: 1 for recursive sectioning,
+ *                   2 for recursive bisection.  The domains are reset to
+ *                   a uniform decomposition of the new type.
+ *
+ *      Returns:  0 on success, -1 for an unknown type
+ *
+ *------------------------------------------------------------------------*/
+int DomainDecompSetType(DomainDecomp_t *dd, int decompType)
+{
+        if (decompType != 1 && decompType != 2) {
+            fprintf(stderr, "DomainDecompSetType: unknown decomposition "
+                    "type %d\n", decompType);
+            return(-1);
+        }
+
+        dd->decompType = decompType;
+
+        if (decompType == 2) {
+            RBDecompose(dd, (DecompPoint_t *)NULL, 0);
+        } else {
+            RSDecompose(dd, (DecompPoint_t *)NULL, 0);
+        }
+
+        return(0);
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:    DomainDecompBalance
+ *      Description: Place the domain boundaries so that each domain
+ *                   holds about the same number of segment midpoints.
+ *                   Collective: every rank passes its own segments and
+ *                   all ranks compute the same boundaries.
+ *
+ *      Returns:  total number of segments over all ranks
+ *
+ *------------------------------------------------------------------------*/
+int DomainDecompBalance(DomainDecomp_t *dd, int numSegs, real8 *R1, real8 *R2)
+{
+        return(DomainDecompBalanceLoad(dd, numSegs, R1, R2, (real8 *)NULL));
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:    DomainDecompBalanceLoad
+ *      Description: Place the domain boundaries so that each domain
+ *                   holds about the same load, each segment carrying
+ *                   load[i] at its midpoint (1 if load is NULL).
+ *                   Collective, like DomainDecompBalance().
+ *
+ *      Returns:  total number of segments over all ranks
+ *
+ *------------------------------------------------------------------------*/
+int DomainDecompBalanceLoad(DomainDecomp_t *dd, int numSegs, real8 *R1,
+                            real8 *R2, real8 *load)
+{
+        int           i, totSegs;
+        DecompPoint_t *pts, *allPts;
+
+        pts = (DecompPoint_t *)malloc((numSegs + 1) * sizeof(DecompPoint_t));
+        for (i = 0; i < numSegs; i++) {
+            SegMidFrac(dd, R1, R2, i, pts[i].s);
+            pts[i].w = (load != (real8 *)NULL) ? load[i] : 1.0;
+        }
+
+#ifdef PARALLEL
+        {
+            int n, *counts, *displs;
+
+            counts = (int *)malloc(dd->numDomains * sizeof(int));
+            displs = (int *)malloc(dd->numDomains * sizeof(int));
+            n = 4 * numSegs;
+            MPI_Allgather(&n, 1, MPI_INT, counts, 1, MPI_INT, dd->comm);
+            totSegs = 0;
+            for (i = 0; i < dd->numDomains; i++) {
+                displs[i] = 4 * totSegs;
+                totSegs += counts[i] / 4;
+            }
+            allPts = (DecompPoint_t *)malloc((totSegs + 1) * sizeof(DecompPoint_t));
+            MPI_Allgatherv(pts, n, MPI_DOUBLE, allPts, counts, displs,
+                           MPI_DOUBLE, dd->comm);
+            free(counts);
+            free(displs);
+            free(pts);
+        }
+#else
+        allPts = pts;
+        totSegs = numSegs;
+#endif
+
+        if (dd->decompType == 2) {
+            RBDecompose(dd, allPts, totSegs);
+        } else {
+            RSDecompose(dd, allPts, totSegs);
+        }
+
+        free(allPts);
+
+        return(totSegs);
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:    DomainDecompGetSegLoad
+ *      Description: Measured load of each native segment of the last
+ *                   DomainDecompSegForces(): the pairs it evaluated
+ *                   (criteria DLB_USE_FORCECALC_COUNT) or the force
+ *                   calculation wall clock time of the domain
+ *                   (DLB_USE_WALLCLK_TIME) split over the segments in
+ *                   proportion to their pairs.  load is sized by the
+ *                   return value.
+ *
+ *      Returns:  number of native segments of the last force call
+ *
+ *------------------------------------------------------------------------*/
+int DomainDecompGetSegLoad(DomainDecomp_t *dd, int criteria, real8 *load)
+{
+        int   i;
+        real8 total;
+
+        total = (criteria == DLB_USE_WALLCLK_TIME) ? dd->forceTime : dd->forcePairs;
+
+        for (i = 0; i < dd->numLoad; i++) load[i] = total * dd->loadShare[i];
+
+        return(dd->numLoad);
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:    DomainDecompRebalance
+ *      Description: Dynamic load balancing: place the domain boundaries
+ *                   for the load measured by the last
+ *                   DomainDecompSegForces() (see DomainDecompGetSegLoad),
+ *                   as Rebalance() does every DLBfreq steps.
+ *                   Collective.  Every rank passes the native segments
+ *                   of that call; if a rank's segment count differs
+ *                   from it (or nothing was measured yet) all segments
+ *                   get unit load.  Follow with DomainDecompMigrate()
+ *                   to move the segments to their new domains.
+ *
+ *      Returns:  total number of segments over all ranks
+ *
+ *------------------------------------------------------------------------*/
+int DomainDecompRebalance(DomainDecomp_t *dd, int numSegs, real8 *R1,
+                          real8 *R2, int criteria)
+{
+        int   i, measured, totSegs;
+        real8 *load;
+
+        measured = (numSegs == dd->numLoad && dd->loadShare != (real8 *)NULL);
+#ifdef PARALLEL
+        MPI_Allreduce(MPI_IN_PLACE, &measured, 1, MPI_INT, MPI_MIN, dd->comm);
+#endif
+
+        load = (real8 *)malloc((numSegs + 1) * sizeof(real8));
+
+        if (measured) {
+            DomainDecompGetSegLoad(dd, criteria, load);
+        } else {
+            for (i = 0; i < numSegs; i++) load[i] = 1.0;
+        }
+
+        totSegs = DomainDecompBalanceLoad(dd, numSegs, R1, R2, load);
+        free(load);
+
+        return(totSegs);
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:    DomainDecompGetBounds
+ *      Description: Fractional coordinate bounds of a domain
+ *
+ *------------------------------------------------------------------------*/
+void DomainDecompGetBounds(DomainDecomp_t *dd, int domain,
+                           real8 *sMin, real8 *sMax)
+{
+        int i, j, k;
+
+        if (dd->decompType == 2) {
+            memcpy(sMin, dd->rbLeaf[domain]->cMin, 3 * sizeof(real8));
+            memcpy(sMax, dd->rbLeaf[domain]->cMax, 3 * sizeof(real8));
+            return;
+        }
+
+        DomainIndices(dd, domain, &i, &j, &k);
+
+        sMin[0] = dd->decomp.domBoundX[i];
+        sMax[0] = dd->decomp.domBoundX[i+1];
+        sMin[1] = dd->decomp.domBoundY[i][j];
+        sMax[1] = dd->decomp.domBoundY[i][j+1];
+        sMin[2] = dd->decomp.domBoundZ[i][j][k];
+        sMax[2] = dd->decomp.domBoundZ[i][j][k+1];
+
+        return;
+}
+
+
+/*
+ *      Leaf of the recursive bisection tree containing s: along each
+ *      split direction the lower octant ends at the cut
+ */
+static int OwnerRB(DomainDecomp_t *dd, real8 *s)
+{
+        int        d, octant;
+        RBDecomp_t *node;
+
+        node = dd->rbDecomp;
+
+        while (node->domID < 0) {
+            octant = 0;
+            for (d = 0; d < 3; d++) {
+                if (node->numDoms[d] < 2) continue;
+                if (s[d] >= node->subDecomp[octant]->cMax[d]) octant |= (1 << d);
+            }
+            node = node->subDecomp[octant];
+        }
+
+        return(node->domID);
+}
+
+
+static int OwnerFrac(DomainDecomp_t *dd, real8 *s)
+{
+        int i, j, k;
+
+        if (dd->decompType == 2) return(OwnerRB(dd, s));
+
+        i = FindInterval(dd->decomp.domBoundX, dd->nDoms[0], s[0]);
+        j = FindInterval(dd->decomp.domBoundY[i], dd->nDoms[1], s[1]);
+        k = FindInterval(dd->decomp.domBoundZ[i][j], dd->nDoms[2], s[2]);
+
+        return((i * dd->nDoms[1] + j) * dd->nDoms[2] + k);
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:    DomainDecompOwner
+ *      Description: Domain containing the position x, as
+ *                   FindCoordDomain() does for the Home_t decomposition
+ *
+ *------------------------------------------------------------------------*/
+int DomainDecompOwner(DomainDecomp_t *dd, real8 *x)
+{
+        real8 s[3];
+
+        FracCoords(dd, x, s);
+
+        return(OwnerFrac(dd, s));
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:    DomainDecompSegOwners
+ *      Description: Domain of each segment (the domain of its midpoint)
+ *
+ *------------------------------------------------------------------------*/
+void DomainDecompSegOwners(DomainDecomp_t *dd, int numSegs,
+                           real8 *R1, real8 *R2, int *owners)
+{
+        int   i;
+        real8 s[3];
+
+        for (i = 0; i < numSegs; i++) {
+            SegMidFrac(dd, R1, R2, i, s);
+            owners[i] = OwnerFrac(dd, s);
+        }
+
+        return;
+}
+
+
+#ifdef PARALLEL
+/*
+ *      Exchange blocks of count[d]*width doubles with every domain d;
+ *      returns the received buffer and the receive counts in recvCounts
+ */
+static real8 *ExchangeBlocks(DomainDecomp_t *dd, int width, int *sendCounts,
+                             real8 *sendBuf, int *recvCounts, int *numRecv)
+{
+        int   d, *sdispls, *rdispls, *scounts, *rcounts;
+        real8 *recvBuf;
+
+        sdispls = (int *)malloc(4 * dd->numDomains * sizeof(int));
+        rdispls = sdispls + dd->numDomains;
+        scounts = rdispls + dd->numDomains;
+        rcounts = scounts + dd->numDomains;
+
+        MPI_Alltoall(sendCounts, 1, MPI_INT, recvCounts, 1, MPI_INT, dd->comm);
+
+        *numRecv = 0;
+        for (d = 0; d < dd->numDomains; d++) {
+            scounts[d] = width * sendCounts[d];
+            rcounts[d] = width * recvCounts[d];
+            sdispls[d] = (d == 0) ? 0 : sdispls[d-1] + scounts[d-1];
+            rdispls[d] = (d == 0) ? 0 : rdispls[d-1] + rcounts[d-1];
+            *numRecv += recvCounts[d];
+        }
+
+        recvBuf = (real8 *)malloc((width * (*numRecv) + 1) * sizeof(real8));
+        MPI_Alltoallv(sendBuf, scounts, sdispls, MPI_DOUBLE,
+                      recvBuf, rcounts, rdispls, MPI_DOUBLE, dd->comm);
+
+        free(sdispls);
+
+        return(recvBuf);
+}
+#endif
+
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:    DomainDecompMigrate
+ *      Description: Send every segment to the domain of its midpoint.
+ *                   Collective.  The segments received are kept in dd
+ *                   and copied out with DomainDecompGetSegments().
+ *
+ *      Arguments:
+ *          segNodes     [numSegs][2] global tags of the end nodes
+ *          R1, R2       [numSegs][3] end node positions
+ *          burgers      [numSegs][3] Burgers vectors
+ *
+ *      Returns:  number of segments now native to this domain
+ *
+ *------------------------------------------------------------------------*/
+int DomainDecompMigrate(DomainDecomp_t *dd, int numSegs, int *segNodes,
+                        real8 *R1, real8 *R2, real8 *burgers)
+{
+        int   i, k, n, *owners, *counts, *offset;
+        real8 *sendBuf, *recvBuf, *q;
+
+        owners = (int *)malloc((numSegs + 1) * sizeof(int));
+        counts = (int *)calloc(2 * dd->numDomains, sizeof(int));
+        offset = counts + dd->numDomains;
+
+        DomainDecompSegOwners(dd, numSegs, R1, R2, owners);
+        for (i = 0; i < numSegs; i++) counts[owners[i]]++;
+        for (i = 1; i < dd->numDomains; i++) offset[i] = offset[i-1] + counts[i-1];
+
+        sendBuf = (real8 *)malloc((FLTS_PER_DECOMP_SEG * numSegs + 1) * sizeof(real8));
+        for (i = 0; i < numSegs; i++) {
+            q = &sendBuf[FLTS_PER_DECOMP_SEG * offset[owners[i]]++];
+            q[0] = (real8)segNodes[2*i];
+            q[1] = (real8)segNodes[2*i+1];
+            for (k = 0; k < 3; k++) {
+                q[2+k] = R1[3*i+k];
+                q[5+k] = R2[3*i+k];
+                q[8+k] = burgers[3*i+k];
+            }
+        }
+
+#ifdef PARALLEL
+        {
+            int *recvCounts = (int *)malloc(dd->numDomains * sizeof(int));
+            recvBuf = ExchangeBlocks(dd, FLTS_PER_DECOMP_SEG, counts, sendBuf,
+                                     recvCounts, &n);
+            free(recvCounts);
+            free(sendBuf);
+        }
+#else
+        recvBuf = sendBuf;
+        n = numSegs;
+#endif
+
+        free(dd->segNodes);
+        free(dd->R1);
+        free(dd->R2);
+        free(dd->burgers);
+        dd->numSegs = n;
+        dd->segNodes = (int *)malloc((2 * n + 1) * sizeof(int));
+        dd->R1 = (real8 *)malloc((3 * n + 1) * sizeof(real8));
+        dd->R2 = (real8 *)malloc((3 * n + 1) * sizeof(real8));
+        dd->burgers = (real8 *)malloc((3 * n + 1) * sizeof(real8));
+
+        for (i = 0; i < n; i++) {
+            q = &recvBuf[FLTS_PER_DECOMP_SEG * i];
+            dd->segNodes[2*i]   = (int)q[0];
+            dd->segNodes[2*i+1] = (int)q[1];
+            for (k = 0; k < 3; k++) {
+                dd->R1[3*i+k]      = q[2+k];
+                dd->R2[3*i+k]      = q[5+k];
+                dd->burgers[3*i+k] = q[8+k];
+            }
+        }
+
+        free(recvBuf);
+        free(owners);
+        free(counts);
+
+        return(n);
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:    DomainDecompGetSegments
+ *      Description: Copy out the segments of the last
+ *                   DomainDecompMigrate(); the arrays are sized by its
+ *                   return value
+ *
+ *------------------------------------------------------------------------*/
+void DomainDecompGetSegments(DomainDecomp_t *dd, int *segNodes,
+                             real8 *R1, real8 *R2, real8 *burgers)
+{
+        memcpy(segNodes, dd->segNodes, 2 * dd->numSegs * sizeof(int));
+        memcpy(R1, dd->R1, 3 * dd->numSegs * sizeof(real8));
+        memcpy(R2, dd->R2, 3 * dd->numSegs * sizeof(real8));
+        memcpy(burgers, dd->burgers, 3 * dd->numSegs * sizeof(real8));
+
+        return;
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:    MeasureSegLoad
+ *      Description: Share of each of the numSegs native segments (the
+ *                   first of the numLocal local segments) in the force
+ *                   cost of the domain.  With a cutoff the cost of a
+ *                   segment is the number of local segments in its own
+ *                   and the neighboring cells of the cell list that
+ *                   SegSegForceCellList() uses; without a cutoff every
+ *                   native segment interacts with all segments.
+ *
+ *------------------------------------------------------------------------*/
+static void MeasureSegLoad(DomainDecomp_t *dd, int numSegs, int numLocal,
+                           real8 *R1, real8 *R2, real8 cutoff)
+{
+        int   i, k, d, c, ix, iy, iz, nCells[3], cell[3], nbr[3][3], numNbr[3];
+        int   *cellStart, *cellSegs, *segCell;
+        real8 len, maxLen, total, p2[3], *mid;
+
+        free(dd->loadShare);
+        dd->numLoad = numSegs;
+        dd->loadShare = (real8 *)malloc((numSegs + 1) * sizeof(real8));
+
+        if (cutoff <= 0.0 || numSegs == 0) {
+            for (i = 0; i < numSegs; i++) dd->loadShare[i] = 1.0 / numSegs;
+            return;
+        }
+
+        mid = (real8 *)malloc((3 * numLocal + 1) * sizeof(real8));
+        maxLen = 0.0;
+
+        for (i = 0; i < numLocal; i++) {
+            PBCClosestImage(dd->h, dd->hinv, dd->isPeriodic, &R1[3*i], &R2[3*i], p2);
+            for (k = 0; k < 3; k++) mid[3*i+k] = 0.5 * (R1[3*i+k] + p2[k]);
+            len = sqrt((p2[0]-R1[3*i])*(p2[0]-R1[3*i]) +
+                       (p2[1]-R1[3*i+1])*(p2[1]-R1[3*i+1]) +
+                       (p2[2]-R1[3*i+2])*(p2[2]-R1[3*i+2]));
+            if (len > maxLen) maxLen = len;
+        }
+
+        BinSegmentsInCells(numLocal, mid, dd->hinv, dd->isPeriodic,
+                           cutoff + maxLen, nCells, &cellStart, &cellSegs,
+                           &segCell);
+
+        total = 0.0;
+
+        for (i = 0; i < numSegs; i++) {
+            c = segCell[i];
+            cell[0] = c / (nCells[1]*nCells[2]);
+            cell[1] = (c / nCells[2]) % nCells[1];
+            cell[2] = c % nCells[2];
+            for (d = 0; d < 3; d++) {
+                CellNeighborIndices(cell[d], nCells[d], dd->isPeriodic[d],
+                                    nbr[d], &numNbr[d]);
+            }
+
+            dd->loadShare[i] = 0.0;
+            for (ix = 0; ix < numNbr[0]; ix++) {
+                for (iy = 0; iy < numNbr[1]; iy++) {
+                    for (iz = 0; iz < numNbr[2]; iz++) {
+                        c = (nbr[0][ix]*nCells[1] + nbr[1][iy])*nCells[2] + nbr[2][iz];
+                        dd->loadShare[i] += cellStart[c+1] - cellStart[c];
+                    }
+                }
+            }
+            total += dd->loadShare[i];
+        }
+
+        for (i = 0; i < numSegs; i++) dd->loadShare[i] /= total;
+
+        free(mid);
+        free(cellStart);
+        free(cellSegs);
+        free(segCell);
+
+        return;
+}
+
+
+#ifdef PARALLEL
+/*
+ *      State of a ghost exchange in flight
+ */
+typedef struct {
+        int         numReqs;
+        MPI_Request *reqs;
+        int         *counts, *recvCounts;
+        real8       *sendBuf, *recvBuf;
+        int         numGhosts;
+} GhostExchange_t;
+
+
+/*
+ *      Non-zero if the fractional position s is within the margins of
+ *      the given domain
+ */
+static int InGhostRegion(DomainDecomp_t *dd, int domain, real8 *s, real8 *margin)
+{
+        int   k;
+        real8 sMin[3], sMax[3];
+
+        DomainDecompGetBounds(dd, domain, sMin, sMax);
+
+        for (k = 0; k < 3; k++) {
+            if (IntervalDistance(s[k], sMin[k], sMax[k], dd->isPeriodic[k]) > margin[k])
+                return(0);
+        }
+
+        return(1);
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:    StartGhostExchange
+ *      Description: Pack the native segments near other domains and
+ *                   start sending them as ghosts.  The message lengths
+ *                   are exchanged first (MSG_GHOST_LEN), then the
+ *                   ghost messages (FLTS_PER_DECOMP_GHOST values per
+ *                   segment, MSG_GHOST) are posted as non-blocking
+ *                   sends and receives that complete in
+ *                   FinishGhostExchange().
+ *
+ *------------------------------------------------------------------------*/
+static void StartGhostExchange(DomainDecomp_t *dd, int numSegs,
+                               real8 *R1, real8 *R2, real8 *burgers,
+                               real8 cutoff, GhostExchange_t *ge)
+{
+        int   i, d, k, n, *offset;
+        real8 len, maxLen, width, margin[3], p2[3], s[3], *q;
+        char  *send;
+
+/*
+ *      Ghost margins: distance cutoff + longest segment, converted to
+ *      fractional coordinates along each cell plane normal
+ */
+        maxLen = 0.0;
+        for (i = 0; i < numSegs; i++) {
+            PBCClosestImage(dd->h, dd->hinv, dd->isPeriodic, &R1[3*i], &R2[3*i], p2);
+            len = sqrt((p2[0]-R1[3*i])*(p2[0]-R1[3*i]) +
+                       (p2[1]-R1[3*i+1])*(p2[1]-R1[3*i+1]) +
+                       (p2[2]-R1[3*i+2])*(p2[2]-R1[3*i+2]));
+            if (len > maxLen) maxLen = len;
+        }
+        MPI_Allreduce(MPI_IN_PLACE, &maxLen, 1, MPI_DOUBLE, MPI_MAX, dd->comm);
+
+        width = cutoff + maxLen;
+        for (k = 0; k < 3; k++) {
+            margin[k] = width * sqrt(dd->hinv[3*k]*dd->hinv[3*k] +
+                                     dd->hinv[3*k+1]*dd->hinv[3*k+1] +
+                                     dd->hinv[3*k+2]*dd->hinv[3*k+2]);
+        }
+
+        ge->counts = (int *)calloc(3 * dd->numDomains, sizeof(int));
+        ge->recvCounts = ge->counts + dd->numDomains;
+        offset = ge->recvCounts + dd->numDomains;
+        send = (char *)calloc((size_t)numSegs * dd->numDomains + 1, 1);
+
+        for (i = 0; i < numSegs; i++) {
+            SegMidFrac(dd, R1, R2, i, s);
+            for (d = 0; d < dd->numDomains; d++) {
+                if (d == dd->myDomain) continue;
+                if (cutoff <= 0.0 || InGhostRegion(dd, d, s, margin)) {
+                    send[(size_t)i * dd->numDomains + d] = 1;
+                    ge->counts[d]++;
+                }
+            }
+        }
+
+        k = 0;
+        for (d = 0; d < dd->numDomains; d++) {
+            offset[d] = k;
+            k += ge->counts[d];
+        }
+        ge->sendBuf = (real8 *)malloc((FLTS_PER_DECOMP_GHOST * (size_t)k + 1) * sizeof(real8));
+
+        for (i = 0; i < numSegs; i++) {
+            for (d = 0; d < dd->numDomains; d++) {
+                if (!send[(size_t)i * dd->numDomains + d]) continue;
+                q = &ge->sendBuf[FLTS_PER_DECOMP_GHOST * offset[d]++];
+                memcpy(&q[0], &R1[3*i], 3 * sizeof(real8));
+                memcpy(&q[3], &R2[3*i], 3 * sizeof(real8));
+                memcpy(&q[6], &burgers[3*i], 3 * sizeof(real8));
+            }
+        }
+        free(send);
+
+/*
+ *      Message lengths
+ */
+        ge->reqs = (MPI_Request *)malloc((2 * dd->numDomains + 1) * sizeof(MPI_Request));
+        n = 0;
+        for (d = 0; d < dd->numDomains; d++) {
+            if (d == dd->myDomain) continue;
+            MPI_Irecv(&ge->recvCounts[d], 1, MPI_INT, d, MSG_GHOST_LEN,
+                      dd->comm, &ge->reqs[n++]);
+        }
+        for (d = 0; d < dd->numDomains; d++) {
+            if (d == dd->myDomain) continue;
+            MPI_Isend(&ge->counts[d], 1, MPI_INT, d, MSG_GHOST_LEN,
+                      dd->comm, &ge->reqs[n++]);
+        }
+        MPI_Waitall(n, ge->reqs, MPI_STATUSES_IGNORE);
+
+/*
+ *      Ghost messages, left in flight
+ */
+        ge->numGhosts = 0;
+        for (d = 0; d < dd->numDomains; d++) ge->numGhosts += ge->recvCounts[d];
+        ge->recvBuf = (real8 *)malloc((FLTS_PER_DECOMP_GHOST * (size_t)ge->numGhosts + 1) *
+                                      sizeof(real8));
+
+        n = 0;
+        k = 0;
+        for (d = 0; d < dd->numDomains; d++) {
+            if (ge->recvCounts[d] > 0) {
+                MPI_Irecv(&ge->recvBuf[FLTS_PER_DECOMP_GHOST * k],
+                          FLTS_PER_DECOMP_GHOST * ge->recvCounts[d], MPI_DOUBLE,
+                          d, MSG_GHOST, dd->comm, &ge->reqs[n++]);
+            }
+            k += ge->recvCounts[d];
+        }
+        k = 0;
+        for (d = 0; d < dd->numDomains; d++) {
+            if (ge->counts[d] > 0) {
+                MPI_Isend(&ge->sendBuf[FLTS_PER_DECOMP_GHOST * k],
+                          FLTS_PER_DECOMP_GHOST * ge->counts[d], MPI_DOUBLE,
+                          d, MSG_GHOST, dd->comm, &ge->reqs[n++]);
+            }
+            k += ge->counts[d];
+        }
+        ge->numReqs = n;
+
+        return;
+}
+
+
+/*
+ *      Wait for the ghost messages; the received ghosts stay in
+ *      ge->recvBuf until the caller frees it
+ */
+static void FinishGhostExchange(GhostExchange_t *ge)
+{
+        MPI_Waitall(ge->numReqs, ge->reqs, MPI_STATUSES_IGNORE);
+
+        free(ge->reqs);
+        free(ge->sendBuf);
+        free(ge->counts);
+
+        return;
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:    BoundaryForces
+ *      Description: Accumulate into lForces the forces on the numSegs
+ *                   native segments from the numLocal - numSegs ghost
+ *                   segments that follow them in the local arrays: with
+ *                   a cutoff the pairs SegSegForceCellList() would
+ *                   select, all pairs otherwise.
+ *
+ *      Returns:  number of segment pairs evaluated
+ *
+ *------------------------------------------------------------------------*/
+static int BoundaryForces(DomainDecomp_t *dd, int numSegs, int numLocal,
+                          real8 *R1, real8 *R2, real8 *burgers,
+                          real8 cutoff, real8 a, real8 MU, real8 NU,
+                          int Nint, real8 *quad_points, real8 *weights,
+                          real8 *lForces)
+{
+        int           i, j, k, m, d, c, ix, iy, iz, numJ, numPairs;
+        int           nCells[3], cell[3], nbr[3][3], numNbr[3];
+        int           *jList, *cellStart, *cellSegs, *segCell;
+        real8         len, maxLen, rmax, dr[3], midj[3], p2[3], *mid, *halfLen;
+        SBN1Context_t *sbn1;
+
+        numPairs = 0;
+        if (numSegs == 0 || numLocal == numSegs) return(0);
+
+        ProfileStart(PROFILE_FORCE);
+
+        sbn1 = SegSegForceDriverContext(Nint, quad_points, weights, a, MU, NU);
+        jList = (int *)malloc((numLocal + 1) * sizeof(int));
+
+        if (cutoff <= 0.0) {
+            numJ = numLocal - numSegs;
+            for (j = 0; j < numJ; j++) jList[j] = numSegs + j;
+            for (i = 0; i < numSegs; i++) {
+                SegSegForceRow(i, numJ, jList, R1, R2, burgers,
+                               dd->h, dd->hinv, dd->isPeriodic, a, MU, NU,
+                               sbn1, NULL, lForces);
+                numPairs += numJ;
+            }
+        } else {
+            mid = (real8 *)malloc((3 * numLocal + 1) * sizeof(real8));
+            halfLen = (real8 *)malloc((numLocal + 1) * sizeof(real8));
+            maxLen = 0.0;
+
+            for (i = 0; i < numLocal; i++) {
+                PBCClosestImage(dd->h, dd->hinv, dd->isPeriodic, &R1[3*i], &R2[3*i], p2);
+                for (k = 0; k < 3; k++) mid[3*i+k] = 0.5 * (R1[3*i+k] + p2[k]);
+                len = sqrt((p2[0]-R1[3*i])*(p2[0]-R1[3*i]) +
+                           (p2[1]-R1[3*i+1])*(p2[1]-R1[3*i+1]) +
+                           (p2[2]-R1[3*i+2])*(p2[2]-R1[3*i+2]));
+                halfLen[i] = 0.5 * len;
+                if (len > maxLen) maxLen = len;
+            }
+
+            BinSegmentsInCells(numLocal, mid, dd->hinv, dd->isPeriodic,
+                               cutoff + maxLen, nCells, &cellStart, &cellSegs,
+                               &segCell);
+
+            for (i = 0; i < numSegs; i++) {
+                c = segCell[i];
+                cell[0] = c / (nCells[1]*nCells[2]);
+                cell[1] = (c / nCells[2]) % nCells[1];
+                cell[2] = c % nCells[2];
+                for (d = 0; d < 3; d++) {
+                    CellNeighborIndices(cell[d], nCells[d], dd->isPeriodic[d],
+                                        nbr[d], &numNbr[d]);
+                }
+
+                numJ = 0;
+                for (ix = 0; ix < numNbr[0]; ix++) {
+                    for (iy = 0; iy < numNbr[1]; iy++) {
+                        for (iz = 0; iz < numNbr[2]; iz++) {
+                            c = (nbr[0][ix]*nCells[1] + nbr[1][iy])*nCells[2] + nbr[2][iz];
+                            for (m = cellStart[c]; m < cellStart[c+1]; m++) {
+                                j = cellSegs[m];
+                                if (j < numSegs) continue;
+                                PBCClosestImage(dd->h, dd->hinv, dd->isPeriodic,
+                                                &mid[3*i], &mid[3*j], midj);
+                                for (k = 0; k < 3; k++) dr[k] = midj[k] - mid[3*i+k];
+                                rmax = cutoff + halfLen[i] + halfLen[j];
+                                if (dr[0]*dr[0]+dr[1]*dr[1]+dr[2]*dr[2] > rmax*rmax) {
+                                    continue;
+                                }
+                                jList[numJ++] = j;
+                            }
+                        }
+                    }
+                }
+
+                SegSegForceRow(i, numJ, jList, R1, R2, burgers,
+                               dd->h, dd->hinv, dd->isPeriodic, a, MU, NU,
+                               sbn1, NULL, lForces);
+                numPairs += numJ;
+            }
+
+            free(mid);
+            free(halfLen);
+            free(cellStart);
+            free(cellSegs);
+            free(segCell);
+        }
+
+        free(jList);
+        SBN1ContextFree(sbn1);
+
+        ProfileCount(PROFILE_PAIRS, numPairs);
+        ProfileStop(PROFILE_FORCE);
+
+        return(numPairs);
+}
+#endif
+
+
+/*
+ *      Forces among the native segments only (the interior pairs)
+ */
+static int InteriorForces(DomainDecomp_t *dd, int numSegs,
+                          real8 *R1, real8 *R2, real8 *burgers,
+                          real8 cutoff, real8 a, real8 MU, real8 NU,
+                          int Nint, real8 *quad_points, real8 *weights,
+                          real8 *segForces)
+{
+        int   i, numPairs, *subList, *nodeIDs;
+        real8 *nodeForces;
+
+        if (cutoff > 0.0) {
+            nodeIDs = (int *)malloc((2 * numSegs + 1) * sizeof(int));
+            nodeForces = (real8 *)malloc((6 * numSegs + 1) * sizeof(real8));
+            for (i = 0; i < 2 * numSegs; i++) nodeIDs[i] = i;
+            numPairs = SegSegForceCellList(2 * numSegs, numSegs, nodeIDs,
+                                           R1, R2, burgers,
+                                           dd->h, dd->hinv, dd->isPeriodic,
+                                           cutoff, a, MU, NU, Nint,
+                                           quad_points, weights, NULL,
+                                           segForces, nodeForces);
+            free(nodeIDs);
+            free(nodeForces);
+        } else {
+            subList = (int *)malloc((numSegs + 1) * sizeof(int));
+            for (i = 0; i < numSegs; i++) subList[i] = i;
+            numPairs = SegSegForceSubset(numSegs, R1, R2, burgers,
+                                         dd->h, dd->hinv, dd->isPeriodic,
+                                         numSegs, subList, a, MU, NU,
+                                         Nint, quad_points, weights, NULL,
+                                         segForces);
+            free(subList);
+        }
+
+        return(numPairs);
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:    DomainDecompSegForces
+ *      Description: Elastic forces on the native segments of this
+ *                   domain.  Collective: the native segments near other
+ *                   domains are sent to them as ghosts with non-blocking
+ *                   messages, and while the ghosts are in flight the
+ *                   interior pairs (both segments native) are evaluated
+ *                   with SegSegForceCellList() if cutoff > 0, or with
+ *                   SegSegForceSubset() otherwise.  The boundary pairs
+ *                   of a native and a ghost segment follow once the
+ *                   ghosts have arrived; they are evaluated on both
+ *                   domains, each keeping the forces on its own segment.
+ *
+ *      Arguments:
+ *          numSegs      number of native segments
+ *          R1, R2       [numSegs][3] end node positions
+ *          burgers      [numSegs][3] Burgers vectors
+ *          cutoff       interaction cutoff, <= 0 for all pairs
+ *          segForces    [numSegs][6] returned forces on the two end
+ *                       nodes of each native segment
+ *          (others)     same as SegSegForceAllPairs()
+ *
+ *      Returns:  number of ghost segments received
+ *
+ *------------------------------------------------------------------------*/
+int DomainDecompSegForces(DomainDecomp_t *dd, int numSegs,
+                          real8 *R1, real8 *R2, real8 *burgers,
+                          real8 cutoff, real8 a, real8 MU, real8 NU,
+                          int Nint, real8 *quad_points, real8 *weights,
+                          real8 *segForces)
+{
+        int   numGhosts, numLocal, numPairs;
+        real8 t0, *lR1, *lR2, *lB;
+#ifdef PARALLEL
+        GhostExchange_t ge;
+
+        StartGhostExchange(dd, numSegs, R1, R2, burgers, cutoff, &ge);
+#endif
+
+        t0 = ProfileWallTime();
+        numPairs = InteriorForces(dd, numSegs, R1, R2, burgers, cutoff,
+                                  a, MU, NU, Nint, quad_points, weights,
+                                  segForces);
+        dd->forceTime = ProfileWallTime() - t0;
+
+        numGhosts = 0;
+        lR1 = R1;
+        lR2 = R2;
+        lB  = burgers;
+
+#ifdef PARALLEL
+        {
+            int   i;
+            real8 *lForces, *q;
+
+            FinishGhostExchange(&ge);
+            numGhosts = ge.numGhosts;
+
+/*
+ *          Natives first, then the ghosts
+ */
+            numLocal = numSegs + numGhosts;
+            lR1 = (real8 *)malloc((3 * numLocal + 1) * sizeof(real8));
+            lR2 = (real8 *)malloc((3 * numLocal + 1) * sizeof(real8));
+            lB  = (real8 *)malloc((3 * numLocal + 1) * sizeof(real8));
+            memcpy(lR1, R1, 3 * numSegs * sizeof(real8));
+            memcpy(lR2, R2, 3 * numSegs * sizeof(real8));
+            memcpy(lB, burgers, 3 * numSegs * sizeof(real8));
+            for (i = 0; i < numGhosts; i++) {
+                q = &ge.recvBuf[FLTS_PER_DECOMP_GHOST * i];
+                memcpy(&lR1[3*(numSegs+i)], &q[0], 3 * sizeof(real8));
+                memcpy(&lR2[3*(numSegs+i)], &q[3], 3 * sizeof(real8));
+                memcpy(&lB[3*(numSegs+i)], &q[6], 3 * sizeof(real8));
+            }
+            free(ge.recvBuf);
+
+            t0 = ProfileWallTime();
+            lForces = (real8 *)malloc((6 * numLocal + 1) * sizeof(real8));
+            memcpy(lForces, segForces, 6 * numSegs * sizeof(real8));
+            memset(&lForces[6*numSegs], 0, 6 * numGhosts * sizeof(real8));
+            numPairs += BoundaryForces(dd, numSegs, numLocal, lR1, lR2, lB,
+                                       cutoff, a, MU, NU, Nint, quad_points,
+                                       weights, lForces);
+            memcpy(segForces, lForces, 6 * numSegs * sizeof(real8));
+            free(lForces);
+            dd->forceTime += ProfileWallTime() - t0;
+        }
+#endif
+
+        numLocal = numSegs + numGhosts;
+        dd->forcePairs = (real8)numPairs;
+        MeasureSegLoad(dd, numSegs, numLocal, lR1, lR2, cutoff);
+
+        if (lR1 != R1) {
+            free(lR1);
+            free(lR2);
+            free(lB);
+        }
+
+        return(numGhosts);
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:    DomainDecompNodeForces
+ *      Description: Total forces on a set of nodes from the segment
+ *                   forces of all domains.  Collective.  Each domain
+ *                   sums the forces of its segments into their end
+ *                   nodes and sends the partial sums to the domain of
+ *                   each node position, which returns the totals to
+ *                   all domains that asked for the node.
+ *
+ *      Arguments:
+ *          numSegs      number of native segments
+ *          segNodes     [numSegs][2] global tags of the end nodes
+ *          segForces    [numSegs][6] segment forces
+ *                       (DomainDecompSegForces)
+ *          numNodes     number of nodes whose forces are returned; must
+ *                       include all end nodes of the native segments
+ *          nodeTags     [numNodes] global node tags
+ *          nodePos      [numNodes][3] node positions
+ *          nodeForces   [numNodes][3] returned total nodal forces
+ *
+ *      Returns:  0 on success, -1 if a segment end node is not in
+ *                nodeTags
+ *
+ *------------------------------------------------------------------------*/
+int DomainDecompNodeForces(DomainDecomp_t *dd, int numSegs, int *segNodes,
+                           real8 *segForces, int numNodes, int *nodeTags,
+                           real8 *nodePos, real8 *nodeForces)
+{
+        int         i, k, end, status;
+        DecompTag_t *sorted, key, *found;
+
+        sorted = (DecompTag_t *)malloc((numNodes + 1) * sizeof(DecompTag_t));
+        for (i = 0; i < numNodes; i++) {
+            sorted[i].tag = nodeTags[i];
+            sorted[i].index = i;
+        }
+        qsort(sorted, numNodes, sizeof(DecompTag_t), CompareTag);
+
+        memset(nodeForces, 0, 3 * numNodes * sizeof(real8));
+        status = 0;
+
+        for (i = 0; i < numSegs; i++) {
+            for (end = 0; end < 2; end++) {
+                key.tag = segNodes[2*i+end];
+                found = (DecompTag_t *)bsearch(&key, sorted, numNodes,
+                                               sizeof(DecompTag_t), CompareTag);
+                if (found == (DecompTag_t *)NULL) {
+                    fprintf(stderr, "DomainDecompNodeForces: node %d of "
+                            "segment %d not in the node list\n", key.tag, i);
+                    status = -1;
+                    continue;
+                }
+                for (k = 0; k < 3; k++)
+                    nodeForces[3*found->index+k] += segForces[6*i+3*end+k];
+            }
+        }
+        free(sorted);
+
+#ifdef PARALLEL
+        {
+            int         d, n, numRecv, m, *owners, *counts, *offset, *recvCounts, *sentNode;
+            real8       *sendBuf, *recvBuf, *q;
+            DecompTag_t *recvTags;
+
+            owners = (int *)malloc((numNodes + 1) * sizeof(int));
+            sentNode = (int *)malloc((numNodes + 1) * sizeof(int));
+            counts = (int *)calloc(3 * dd->numDomains, sizeof(int));
+            offset = counts + dd->numDomains;
+            recvCounts = offset + dd->numDomains;
+
+            for (i = 0; i < numNodes; i++) {
+                owners[i] = DomainDecompOwner(dd, &nodePos[3*i]);
+                counts[owners[i]]++;
+            }
+            for (d = 1; d < dd->numDomains; d++) offset[d] = offset[d-1] + counts[d-1];
+
+            sendBuf = (real8 *)malloc((FLTS_PER_DECOMP_FORCE * numNodes + 1) * sizeof(real8));
+            for (i = 0; i < numNodes; i++) {
+                n = offset[owners[i]]++;
+                sentNode[n] = i;
+                q = &sendBuf[FLTS_PER_DECOMP_FORCE * n];
+                q[0] = (real8)nodeTags[i];
+                for (k = 0; k < 3; k++) q[1+k] = nodeForces[3*i+k];
+            }
+
+            recvBuf = ExchangeBlocks(dd, FLTS_PER_DECOMP_FORCE, counts, sendBuf,
+                                     recvCounts, &numRecv);
+
+/*
+ *          Sum the partial forces of each node received and write the
+ *          totals back in place
+ */
+            recvTags = (DecompTag_t *)malloc((numRecv + 1) * sizeof(DecompTag_t));
+            for (i = 0; i < numRecv; i++) {
+                recvTags[i].tag = (int)recvBuf[FLTS_PER_DECOMP_FORCE*i];
+                recvTags[i].index = i;
+            }
+            qsort(recvTags, numRecv, sizeof(DecompTag_t), CompareTag);
+
+            for (i = 0; i < numRecv; i = m) {
+                real8 sum[3] = {0.0, 0.0, 0.0};
+                for (m = i; m < numRecv && recvTags[m].tag == recvTags[i].tag; m++) {
+                    q = &recvBuf[FLTS_PER_DECOMP_FORCE * recvTags[m].index];
+                    for (k = 0; k < 3; k++) sum[k] += q[1+k];
+                }
+                for (n = i; n < m; n++) {
+                    q = &recvBuf[FLTS_PER_DECOMP_FORCE * recvTags[n].index];
+                    for (k = 0; k < 3; k++) q[1+k] = sum[k];
+                }
+            }
+            free(recvTags);
+            free(sendBuf);
+
+/*
+ *          Return the totals along the reverse path
+ */
+            sendBuf = ExchangeBlocks(dd, FLTS_PER_DECOMP_FORCE, recvCounts, recvBuf,
+                                     counts, &n);
+            for (n = 0; n < numNodes; n++) {
+                q = &sendBuf[FLTS_PER_DECOMP_FORCE * n];
+                for (k = 0; k < 3; k++) nodeForces[3*sentNode[n]+k] = q[1+k];
+            }
+
+            free(sendBuf);
+            free(recvBuf);
+            free(owners);
+            free(sentNode);
+            free(counts);
+        }
+#else
+        (void)dd;
+        (void)nodePos;
+#endif
+
+        return(status);
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:    DomainDecompSum
+ *      Description: Sum values[0..n-1] over all domains, in place.
+ *                   Collective.
+ *
+ *      Returns:  0 on success, -1 on error
+ *
+ *------------------------------------------------------------------------*/
+int DomainDecompSum(DomainDecomp_t *dd, int n, real8 *values)
+{
+#ifdef PARALLEL
+        if (MPI_Allreduce(MPI_IN_PLACE, values, n, MPI_DOUBLE, MPI_SUM,
+                          dd->comm) != MPI_SUCCESS) {
+            return(-1);
+        }
+#else
+        (void)dd;
+        (void)n;
+        (void)values;
+#endif
+
+        return(0);
+}
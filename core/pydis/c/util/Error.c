@@ -0,0 +1,168 @@
+/***************************************************************************
+ *
+ *	Module:		Error.c
+ *	Description:	Per-thread error traps and error messages of the
+ *			native library (see Error.h).
+ *
+ *	Included functions:
+ *
+ *		ErrorTrapPush
+ *		ErrorTrapPop
+ *		ErrorTrapped
+ *		ErrorRaise
+ *		ErrorPropagate
+ *		ErrorMessage
+ *		ErrorCount
+ *		ErrorClear
+ *
+ **************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include "Error.h"
+
+static THREAD_LOCAL ErrorTrap_t *errorTrap = (ErrorTrap_t *)NULL;
+static THREAD_LOCAL char         errorMsg[ERROR_MSG_LEN];
+static THREAD_LOCAL int          errorCount = 0;
+
+
+/*-------------------------------------------------------------------------
+ *
+ *	Function:	ErrorTrapPush
+ *	Description:	Make trap the innermost error trap of the calling
+ *			thread.  The caller must setjmp(trap->env) right
+ *			after this call, in the frame that stays active
+ *			until ErrorTrapPop().
+ *
+ *------------------------------------------------------------------------*/
+void ErrorTrapPush(ErrorTrap_t *trap)
+{
+	trap->prev = errorTrap;
+	errorTrap = trap;
+
+	return;
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *	Function:	ErrorTrapPop
+ *	Description:	Remove trap (and any trap set inside it) from the
+ *			calling thread.  Not needed after an error returned
+ *			to the trap, which removes it.
+ *
+ *------------------------------------------------------------------------*/
+void ErrorTrapPop(ErrorTrap_t *trap)
+{
+	ErrorTrap_t *t;
+
+	for (t = errorTrap; t != (ErrorTrap_t *)NULL; t = t->prev) {
+		if (t == trap) {
+			errorTrap = trap->prev;
+			break;
+		}
+	}
+
+	return;
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *	Function:	ErrorTrapped
+ *	Description:	Non-zero if an error raised now would return to an
+ *			error trap instead of exiting
+ *
+ *------------------------------------------------------------------------*/
+int ErrorTrapped(void)
+{
+	return(errorTrap != (ErrorTrap_t *)NULL);
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *	Function:	ErrorRaise
+ *	Description:	Record an error message (printf style) for the
+ *			calling thread and return to its innermost error
+ *			trap, or print the message to stderr and exit if
+ *			there is none.  Does not return.
+ *
+ *------------------------------------------------------------------------*/
+void ErrorRaise(const char *format, ...)
+{
+	va_list     args;
+
+	va_start(args, format);
+	vsnprintf(errorMsg, ERROR_MSG_LEN, format, args);
+	va_end(args);
+	errorCount++;
+
+	ErrorPropagate();
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *	Function:	ErrorPropagate
+ *	Description:	Pass the last error of the calling thread on to
+ *			its innermost error trap (or print it and exit),
+ *			for a trap that caught the error only to release
+ *			its resources.  Does not return.
+ *
+ *------------------------------------------------------------------------*/
+void ErrorPropagate(void)
+{
+	ErrorTrap_t *trap;
+
+	trap = errorTrap;
+
+	if (trap == (ErrorTrap_t *)NULL) {
+		fprintf(stderr, "%s\n", errorMsg);
+		exit(1);
+	}
+
+	errorTrap = trap->prev;
+	longjmp(trap->env, 1);
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *	Function:	ErrorMessage
+ *	Description:	Message of the last error of the calling thread,
+ *			empty if there was none since ErrorClear()
+ *
+ *------------------------------------------------------------------------*/
+const char *ErrorMessage(void)
+{
+	return(errorMsg);
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *	Function:	ErrorCount
+ *	Description:	Number of errors of the calling thread since
+ *			ErrorClear()
+ *
+ *------------------------------------------------------------------------*/
+int ErrorCount(void)
+{
+	return(errorCount);
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *	Function:	ErrorClear
+ *
+ *------------------------------------------------------------------------*/
+void ErrorClear(void)
+{
+	errorMsg[0] = 0;
+	errorCount = 0;
+
+	return;
+}
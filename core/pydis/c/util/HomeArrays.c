@@ -0,0 +1,552 @@
+#include <stdlib.h>
+#include "Home.h"
+#include "QueueOps.h"
+#include "Error.h"
+
+/* Bulk transfer of the network between Home_t and flat arrays */
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:     LocalNode
+ *      Description:  Return the native node with the given tag, or
+ *                    NULL if there is none.
+ *
+ *------------------------------------------------------------------------*/
+static Node_t *LocalNode(Home_t *home, int domainID, int index)
+{
+        if (domainID != home->myDomain || index < 0 ||
+            index >= home->newNodeKeyPtr) {
+            return((Node_t *)NULL);
+        }
+
+        return(home->nodeKeys[index]);
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:     HomeImportArrays
+ *      Description:  Add a network given as flat arrays to the native
+ *                    nodes of home in a single pass: the number of arms
+ *                    of every node is counted first, so the node keys
+ *                    are extended once and each node's arm arrays are
+ *                    allocated once with their final size.  Replaces
+ *                    the per-node parsing of AddNodesFromArray().
+ *
+ *      Arguments:
+ *          numNodes     number of nodes
+ *          tags         [numNodes][2] node tags (domainID, index)
+ *          R            [numNodes][3] node positions
+ *          constraints  [numNodes] node constraints.  May be NULL.
+ *          numSegs      number of segments
+ *          segNodes     [numSegs][2] indices (into the node arrays)
+ *                       of the end nodes of each segment
+ *          burgers      [numSegs][3] Burgers vectors from the first
+ *                       end node
+ *          planes       [numSegs][3] glide plane normals.  May be NULL.
+ *
+ *      Returns:  0 on success, -1 on error (see ErrorMessage())
+ *
+ *------------------------------------------------------------------------*/
+int HomeImportArrays(Home_t *home, int numNodes, int *tags, real8 *R,
+                     int *constraints, int numSegs, int *segNodes,
+                     real8 *burgers, real8 *planes)
+{
+        int     i, k, n1, n2, arm, maxIndex, *numArms;
+        real8   sign;
+        Tag_t   tag;
+        Node_t  **nodes, *node;
+        ErrorTrap_t trap;
+
+        if (numNodes <= 0) return(0);
+
+        numArms = (int *)calloc(numNodes, sizeof(int));
+        nodes = (Node_t **)malloc(numNodes * sizeof(Node_t *));
+
+        ErrorTrapPush(&trap);
+        if (setjmp(trap.env) != 0) {
+            free(nodes);
+            free(numArms);
+            return(-1);
+        }
+
+        if (numArms == (int *)NULL || nodes == (Node_t **)NULL) {
+            Fatal("HomeImportArrays: out of memory (%d nodes)", numNodes);
+        }
+
+        for (k = 0; k < numSegs; k++) {
+            n1 = segNodes[2*k];
+            n2 = segNodes[2*k+1];
+            if (n1 < 0 || n1 >= numNodes || n2 < 0 || n2 >= numNodes) {
+                Fatal("HomeImportArrays: segment %d has invalid end nodes "
+                      "(%d,%d)", k, n1, n2);
+            }
+            numArms[n1]++;
+            numArms[n2]++;
+        }
+
+        maxIndex = home->newNodeKeyPtr - 1;
+        for (i = 0; i < numNodes; i++) {
+            if (tags[2*i+1] > maxIndex) maxIndex = tags[2*i+1];
+        }
+        ExtendNodeKeys(home, maxIndex + 1);
+
+        for (i = 0; i < numNodes; i++) {
+
+            tag.domainID = tags[2*i];
+            tag.index    = tags[2*i+1];
+
+            node = RequestNewNativeNodeTag(home, &tag);
+
+            node->x = R[3*i];
+            node->y = R[3*i+1];
+            node->z = R[3*i+2];
+
+            node->constraint = (constraints == (int *)NULL) ? 0 : constraints[i];
+
+            ReallocNodeArms(node, numArms[i]);
+            numArms[i] = 0;
+
+            nodes[i] = node;
+            PushNativeNodeQ(home, node);
+        }
+
+/*
+ *      Each segment becomes one arm on each of its end nodes, with
+ *      opposite Burgers vectors.
+ */
+        for (k = 0; k < numSegs; k++) {
+            for (i = 0; i < 2; i++) {
+                n1 = segNodes[2*k+i];
+                n2 = segNodes[2*k+1-i];
+                sign = (i == 0) ? 1.0 : -1.0;
+
+                node = nodes[n1];
+                arm = numArms[n1]++;
+
+                node->nbrTag[arm] = nodes[n2]->myTag;
+                node->burgX[arm] = sign * burgers[3*k];
+                node->burgY[arm] = sign * burgers[3*k+1];
+                node->burgZ[arm] = sign * burgers[3*k+2];
+
+                if (planes != (real8 *)NULL) {
+                    node->nx[arm] = planes[3*k];
+                    node->ny[arm] = planes[3*k+1];
+                    node->nz[arm] = planes[3*k+2];
+                }
+            }
+        }
+
+        SortNativeNodes(home);
+
+        ErrorTrapPop(&trap);
+
+        free(nodes);
+        free(numArms);
+
+        return(0);
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:     HomeExportArrays
+ *      Description:  Export the native nodes of home to flat arrays
+ *                    (the inverse of HomeImportArrays()).  Nodes are
+ *                    numbered in nodeKeys order, each segment is
+ *                    exported once from its end node with the lower
+ *                    number.  The arrays are only filled if they are
+ *                    large enough, so a first call with maxNodes =
+ *                    maxSegs = 0 returns the sizes.
+ *
+ *      Arguments:
+ *          maxNodes     size of the node arrays
+ *          tags         returned [maxNodes][2] node tags
+ *          R            returned [maxNodes][3] node positions
+ *          constraints  returned [maxNodes] node constraints
+ *          maxSegs      size of the segment arrays
+ *          numSegs      returned number of segments
+ *          segNodes     returned [maxSegs][2] end node numbers
+ *          burgers      returned [maxSegs][3] Burgers vectors from the
+ *                       first end node
+ *          planes       returned [maxSegs][3] glide plane normals
+ *
+ *      Returns:  the number of nodes, -1 on error (see ErrorMessage())
+ *
+ *------------------------------------------------------------------------*/
+int HomeExportArrays(Home_t *home, int maxNodes, int *tags, real8 *R,
+                     int *constraints, int maxSegs, int *numSegs,
+                     int *segNodes, real8 *burgers, real8 *planes)
+{
+        int     i, j, arm, nbrIdx, numNodes, nSegs, fill, *nodeIdx;
+        Tag_t   *nbrTag;
+        Node_t  *node;
+        ErrorTrap_t trap;
+
+        ErrorTrapPush(&trap);
+        if (setjmp(trap.env) != 0) return(-1);
+
+        nodeIdx = (int *)malloc((home->newNodeKeyPtr + 1) * sizeof(int));
+        if (nodeIdx == (int *)NULL) {
+            Fatal("HomeExportArrays: out of memory (%d node keys)",
+                  home->newNodeKeyPtr);
+        }
+
+        numNodes = 0;
+        for (i = 0; i < home->newNodeKeyPtr; i++) {
+            nodeIdx[i] = (home->nodeKeys[i] == (Node_t *)NULL) ? -1 : numNodes++;
+        }
+
+/*
+ *      Count the segments in a first pass and fill the arrays in a
+ *      second pass if they are large enough.
+ */
+        nSegs = 0;
+        for (fill = 0; fill < 2; fill++) {
+
+            if (fill && (numNodes > maxNodes || nSegs > maxSegs)) break;
+
+            j = 0;
+            for (i = 0; i < home->newNodeKeyPtr; i++) {
+
+                if ((node = home->nodeKeys[i]) == (Node_t *)NULL) continue;
+
+                if (fill) {
+                    tags[2*nodeIdx[i]]   = node->myTag.domainID;
+                    tags[2*nodeIdx[i]+1] = node->myTag.index;
+                    R[3*nodeIdx[i]]   = node->x;
+                    R[3*nodeIdx[i]+1] = node->y;
+                    R[3*nodeIdx[i]+2] = node->z;
+                    constraints[nodeIdx[i]] = node->constraint;
+                }
+
+                for (arm = 0; arm < node->numNbrs; arm++) {
+                    nbrTag = &node->nbrTag[arm];
+                    if (nbrTag->domainID != home->myDomain ||
+                        nbrTag->index < 0 ||
+                        nbrTag->index >= home->newNodeKeyPtr) continue;
+                    nbrIdx = nodeIdx[nbrTag->index];
+                    if (nbrIdx <= nodeIdx[i]) continue;
+
+                    if (fill) {
+                        segNodes[2*j]   = nodeIdx[i];
+                        segNodes[2*j+1] = nbrIdx;
+                        burgers[3*j]   = node->burgX[arm];
+                        burgers[3*j+1] = node->burgY[arm];
+                        burgers[3*j+2] = node->burgZ[arm];
+                        planes[3*j]   = node->nx[arm];
+                        planes[3*j+1] = node->ny[arm];
+                        planes[3*j+2] = node->nz[arm];
+                    }
+                    j++;
+                }
+            }
+
+            nSegs = j;
+        }
+
+        free(nodeIdx);
+
+        ErrorTrapPop(&trap);
+
+        *numSegs = nSegs;
+
+        return(numNodes);
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:     HomeSetPositions
+ *      Description:  Copy the positions of the listed nodes into home,
+ *                    for updates that do not change the topology.
+ *
+ *      Arguments:
+ *          numNodes     number of nodes
+ *          tags         [numNodes][2] node tags
+ *          R            [numNodes][3] node positions
+ *
+ *      Returns:  the number of tags not found in home
+ *
+ *------------------------------------------------------------------------*/
+int HomeSetPositions(Home_t *home, int numNodes, int *tags, real8 *R)
+{
+        int     i, numMissing;
+        Node_t  *node;
+
+        numMissing = 0;
+
+        for (i = 0; i < numNodes; i++) {
+            node = LocalNode(home, tags[2*i], tags[2*i+1]);
+            if (node == (Node_t *)NULL) {
+                numMissing++;
+                continue;
+            }
+            node->x = R[3*i];
+            node->y = R[3*i+1];
+            node->z = R[3*i+2];
+        }
+
+        return(numMissing);
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:     HomeGetPositions
+ *      Description:  Copy the positions of the listed nodes out of
+ *                    home (the inverse of HomeSetPositions()).
+ *
+ *      Returns:  the number of tags not found in home, their
+ *                positions are left unchanged
+ *
+ *------------------------------------------------------------------------*/
+int HomeGetPositions(Home_t *home, int numNodes, int *tags, real8 *R)
+{
+        int     i, numMissing;
+        Node_t  *node;
+
+        numMissing = 0;
+
+        for (i = 0; i < numNodes; i++) {
+            node = LocalNode(home, tags[2*i], tags[2*i+1]);
+            if (node == (Node_t *)NULL) {
+                numMissing++;
+                continue;
+            }
+            R[3*i]   = node->x;
+            R[3*i+1] = node->y;
+            R[3*i+2] = node->z;
+        }
+
+        return(numMissing);
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:     HomeSetVelocities
+ *      Description:  Copy the velocities of the listed nodes into home.
+ *
+ *      Returns:  the number of tags not found in home
+ *
+ *------------------------------------------------------------------------*/
+int HomeSetVelocities(Home_t *home, int numNodes, int *tags, real8 *V)
+{
+        int     i, numMissing;
+        Node_t  *node;
+
+        numMissing = 0;
+
+        for (i = 0; i < numNodes; i++) {
+            node = LocalNode(home, tags[2*i], tags[2*i+1]);
+            if (node == (Node_t *)NULL) {
+                numMissing++;
+                continue;
+            }
+            node->vX = V[3*i];
+            node->vY = V[3*i+1];
+            node->vZ = V[3*i+2];
+        }
+
+        return(numMissing);
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:     HomeSetSegForces
+ *      Description:  Set the arm forces of the listed segments on both
+ *                    end nodes and re-sum the nodal forces of those
+ *                    nodes.
+ *
+ *      Arguments:
+ *          numSegs   number of segments
+ *          tags1     [numSegs][2] tags of the first end nodes
+ *          tags2     [numSegs][2] tags of the second end nodes
+ *          fseg      [numSegs][6] forces of each segment at its first
+ *                    and at its second end node
+ *
+ *      Returns:  the number of segments not found in home
+ *
+ *------------------------------------------------------------------------*/
+int HomeSetSegForces(Home_t *home, int numSegs, int *tags1, int *tags2,
+                     real8 *fseg)
+{
+        int     i, k, arm, numMissing;
+        Node_t  *node1, *node2, *node;
+
+        numMissing = 0;
+
+        for (i = 0; i < numSegs; i++) {
+
+            node1 = LocalNode(home, tags1[2*i], tags1[2*i+1]);
+            node2 = LocalNode(home, tags2[2*i], tags2[2*i+1]);
+
+            if (node1 == (Node_t *)NULL || node2 == (Node_t *)NULL ||
+                (arm = GetArmID(home, node1, node2)) < 0) {
+                numMissing++;
+                continue;
+            }
+
+            node1->armfx[arm] = fseg[6*i];
+            node1->armfy[arm] = fseg[6*i+1];
+            node1->armfz[arm] = fseg[6*i+2];
+
+            arm = GetArmID(home, node2, node1);
+            node2->armfx[arm] = fseg[6*i+3];
+            node2->armfy[arm] = fseg[6*i+4];
+            node2->armfz[arm] = fseg[6*i+5];
+
+            for (k = 0; k < 2; k++) {
+                node = (k == 0) ? node1 : node2;
+                node->fX = 0.0;
+                node->fY = 0.0;
+                node->fZ = 0.0;
+                for (arm = 0; arm < node->numNbrs; arm++) {
+                    node->fX += node->armfx[arm];
+                    node->fY += node->armfy[arm];
+                    node->fZ += node->armfz[arm];
+                }
+            }
+        }
+
+        return(numMissing);
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:     HomeExportChanges
+ *      Description:  Export the changes made to the native nodes of
+ *                    home since the last HomeClearChanges(): the nodes
+ *                    flagged NODE_TOPO_CHANGED with all their segments,
+ *                    and the tags of the nodes freed.  A segment joining
+ *                    two changed nodes is exported once.  As for
+ *                    HomeExportArrays(), the arrays are only filled if
+ *                    they are large enough, so a first call with all
+ *                    sizes 0 returns the sizes.
+ *
+ *                    A tag may appear both as removed and as a changed
+ *                    node if it was reused: the removal is meant to be
+ *                    applied first.
+ *
+ *      Arguments:
+ *          maxNodes     size of the node arrays
+ *          tags         returned [maxNodes][2] tags of the changed nodes
+ *          R            returned [maxNodes][3] their positions
+ *          V            returned [maxNodes][3] their velocities
+ *          constraints  returned [maxNodes] their constraints
+ *          maxSegs      size of the segment arrays
+ *          numSegs      returned number of segments
+ *          segTags      returned [maxSegs][4] tags of the two end nodes
+ *          burgers      returned [maxSegs][3] Burgers vectors from the
+ *                       first end node
+ *          planes       returned [maxSegs][3] glide plane normals
+ *          maxRemoved   size of removedTags
+ *          numRemoved   returned number of removed tags
+ *          removedTags  returned [maxRemoved][2] tags of freed nodes
+ *
+ *      Returns:  the number of changed nodes
+ *
+ *------------------------------------------------------------------------*/
+int HomeExportChanges(Home_t *home, int maxNodes, int *tags, real8 *R,
+                      real8 *V, int *constraints, int maxSegs, int *numSegs,
+                      int *segTags, real8 *burgers, real8 *planes,
+                      int maxRemoved, int *numRemoved, int *removedTags)
+{
+        int     i, arm, numNodes, nSegs, fill;
+        Node_t  *node, *nbr;
+
+        numNodes = 0;
+        nSegs = 0;
+
+        for (i = 0; i < home->numActiveNodes; i++) {
+            node = home->activeNodes[i];
+            if ((node->flags & NODE_TOPO_CHANGED) == 0) continue;
+            numNodes++;
+            for (arm = 0; arm < node->numNbrs; arm++) {
+                nbr = LocalNode(home, node->nbrTag[arm].domainID,
+                                node->nbrTag[arm].index);
+                if (nbr != (Node_t *)NULL &&
+                    (nbr->flags & NODE_TOPO_CHANGED) &&
+                    nbr->myTag.index < node->myTag.index) continue;
+                nSegs++;
+            }
+        }
+
+        *numSegs = nSegs;
+        *numRemoved = home->numRemovedTags;
+
+        fill = (numNodes <= maxNodes && nSegs <= maxSegs &&
+                home->numRemovedTags <= maxRemoved);
+        if (!fill) return(numNodes);
+
+        numNodes = 0;
+        nSegs = 0;
+
+        for (i = 0; i < home->numActiveNodes; i++) {
+
+            node = home->activeNodes[i];
+            if ((node->flags & NODE_TOPO_CHANGED) == 0) continue;
+
+            tags[2*numNodes]   = node->myTag.domainID;
+            tags[2*numNodes+1] = node->myTag.index;
+            R[3*numNodes]   = node->x;
+            R[3*numNodes+1] = node->y;
+            R[3*numNodes+2] = node->z;
+            V[3*numNodes]   = node->vX;
+            V[3*numNodes+1] = node->vY;
+            V[3*numNodes+2] = node->vZ;
+            constraints[numNodes] = node->constraint;
+            numNodes++;
+
+            for (arm = 0; arm < node->numNbrs; arm++) {
+                nbr = LocalNode(home, node->nbrTag[arm].domainID,
+                                node->nbrTag[arm].index);
+                if (nbr != (Node_t *)NULL &&
+                    (nbr->flags & NODE_TOPO_CHANGED) &&
+                    nbr->myTag.index < node->myTag.index) continue;
+
+                segTags[4*nSegs]   = node->myTag.domainID;
+                segTags[4*nSegs+1] = node->myTag.index;
+                segTags[4*nSegs+2] = node->nbrTag[arm].domainID;
+                segTags[4*nSegs+3] = node->nbrTag[arm].index;
+                burgers[3*nSegs]   = node->burgX[arm];
+                burgers[3*nSegs+1] = node->burgY[arm];
+                burgers[3*nSegs+2] = node->burgZ[arm];
+                planes[3*nSegs]   = node->nx[arm];
+                planes[3*nSegs+1] = node->ny[arm];
+                planes[3*nSegs+2] = node->nz[arm];
+                nSegs++;
+            }
+        }
+
+        for (i = 0; i < home->numRemovedTags; i++) {
+            removedTags[2*i]   = home->removedTags[i].domainID;
+            removedTags[2*i+1] = home->removedTags[i].index;
+        }
+
+        return(numNodes);
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:     HomeClearChanges
+ *      Description:  Start recording changes from the current state of
+ *                    home (see HomeExportChanges()).
+ *
+ *------------------------------------------------------------------------*/
+void HomeClearChanges(Home_t *home)
+{
+        int i;
+
+        for (i = 0; i < home->numActiveNodes; i++) {
+            home->activeNodes[i]->flags &= ~NODE_TOPO_CHANGED;
+        }
+
+        home->numRemovedTags = 0;
+
+        return;
+}
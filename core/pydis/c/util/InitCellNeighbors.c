@@ -77,6 +77,16 @@ void InitCellNeighbors(Home_t *home)
  */
                         if (iNbr == iX && jNbr == jY && kNbr == kZ) continue;
 
+/*
+ *                      Skip neighbors outside the padded cell grid, which
+ *                      only native cells of a still empty box (before the
+ *                      box size is set) can have.  Their encoded indices
+ *                      would alias other cells or fall outside cellKeys.
+ */
+                        if (iNbr < 0 || iNbr > nXcells+1 ||
+                            jNbr < 0 || jNbr > nYcells+1 ||
+                            kNbr < 0 || kNbr > nZcells+1) continue;
+
 /*
  *                      If neighbor cell already allocated, just add its
  *                      index to the native cell's neighbor list
@@ -1,14 +1,29 @@
 /***************************************************************************
  *
- *	Function:	InitHome
- *	Description:	Allocate the Home_t struct for this processor, and
- *			perform any needed initializations
+ *	Module:		InitHome.c
+ *	Description:	Allocate and free the Home_t struct of one
+ *			independent instance of the library
+ *
+ *	Included functions:
+ *
+ *		InitHome
+ *		HomeFree
  *
  **************************************************************************/
 
+#include <stdlib.h>
 #include "Init.h"
 #include "Home.h"
 
+
+/***************************************************************************
+ *
+ *	Function:	InitHome
+ *	Description:	Allocate the Home_t struct for this processor, and
+ *			perform any needed initializations
+ *
+ **************************************************************************/
+
 Home_t *InitHome ()
 {
 	Home_t *home;
@@ -21,3 +36,116 @@ Home_t *InitHome ()
 
 	return(home);
 }
+
+
+/***************************************************************************
+ *
+ *	Function:	HomeFreeCells
+ *	Description:	Free the cells of home (InitCellNatives(),
+ *			InitCellNeighbors()), e.g. before they are built
+ *			again for a new cell grid.  Must be called while
+ *			param still holds the cell counts the cells were
+ *			built with.
+ *
+ **************************************************************************/
+void HomeFreeCells(Home_t *home)
+{
+	int		i, numCells;
+	Cell_t		*cell;
+	Param_t		*param;
+
+	param = home->param;
+
+/*
+ *	The periodic image cells are only reachable from cellKeys
+ */
+	if (home->cellKeys != (Cell_t **)NULL && param != (Param_t *)NULL) {
+		numCells = (param->nXcells+2) * (param->nYcells+2) *
+			   (param->nZcells+2);
+		for (i = 0; i < numCells; i++) {
+			if ((cell = home->cellKeys[i]) == (Cell_t *)NULL) continue;
+			free(cell->nbrList);
+			free(cell->domains);
+			free(cell);
+		}
+	}
+
+	free(home->cellKeys);
+	free(home->cellList);
+
+	home->cellKeys = (Cell_t **)NULL;
+	home->cellList = (int *)NULL;
+
+	return;
+}
+
+
+/***************************************************************************
+ *
+ *	Function:	HomeFree
+ *	Description:	Free a Home_t struct created by ParadisInit_lean()
+ *			with everything it owns (nodes and their arms,
+ *			cells, operation list, timers and parameters).
+ *			Also frees a partially initialized or failed
+ *			instance; the other instances are not affected.
+ *
+ **************************************************************************/
+void HomeFree(Home_t *home)
+{
+	int		i;
+	Node_t		*node;
+	Param_t		*param;
+	NodeBlock_t	*nodeBlock;
+
+	if (home == (Home_t *)NULL) return;
+
+	param = home->param;
+
+/*
+ *	Every node, in use or free, lives in one of the node blocks and
+ *	owns its arm storage unless the arms fit in the node itself.
+ */
+	while ((nodeBlock = home->nodeBlockQ) != (NodeBlock_t *)NULL) {
+		home->nodeBlockQ = nodeBlock->next;
+		if (nodeBlock->nodes != (Node_t *)NULL) {
+			for (i = 0; i < NODE_BLOCK_COUNT; i++) {
+				node = &nodeBlock->nodes[i];
+				if (node->armCapacity > 0 &&
+				    node->armStore != node->armInline) {
+					free(node->armStore);
+				}
+			}
+			free(nodeBlock->nodes);
+		}
+		free(nodeBlock);
+	}
+
+	HomeFreeCells(home);
+
+	free(home->nodeKeys);
+	free(home->activeNodes);
+	free(home->recycledNodeHeap);
+	free(home->removedTags);
+	free(home->tagMap);
+	free(home->opList);
+	free(home->timers);
+
+	if (home->ctrlParamList != (ParamList_t *)NULL) {
+		free(home->ctrlParamList->varList);
+		free(home->ctrlParamList);
+	}
+
+	if (home->dataParamList != (ParamList_t *)NULL) {
+		free(home->dataParamList->varList);
+		free(home->dataParamList);
+	}
+
+	if (param != (Param_t *)NULL) {
+		free(param->partialDisloDensity);
+		free(param);
+	}
+
+	free(home);
+
+	return;
+}
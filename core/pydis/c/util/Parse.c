@@ -12,6 +12,7 @@
  *          GetParamVals()
  *          LookupParam()
  *          WriteParam()
+ *          ReadControlFile()
  *
  *************************************************************************/
 #include <stdarg.h>
@@ -100,7 +101,6 @@ void WriteParam(ParamList_t *list, int index, FILE *fp)
 {
         int  i, j, minIndex, maxIndex, type, count;
         char *lineFeed, *lBracket, *rBracket;
-        char format[MAX_STRING_LEN];
 
 /*
  *      We'll be looping over all parameters to be printed.  If
@@ -680,3 +680,73 @@ int GetNextToken(FILE *fp, char *token, int maxTokenSize)
  */
         return(TOKEN_ERR);
 }
+
+
+/*---------------------------------------------------------------------------
+ *
+ *      Function:     ReadControlFile
+ *      Description:  Read the parameter/value pairs of a control file
+ *                    into the variables bound to home->ctrlParamList
+ *                    (see CtrlParamInit()).  Parameters not known to
+ *                    this build are reported and their values skipped,
+ *                    so control files written for ParaDiS can be used
+ *                    as they are.
+ *
+ *      Arguments:
+ *          ctrlFileName  name of the control file
+ *
+ *-------------------------------------------------------------------------*/
+void ReadControlFile(Home_t *home, char *ctrlFileName)
+{
+        int         tokenType, pIndex, valType, numVals;
+        char        token[256];
+        void        *valList;
+        FILE        *fpCtrl;
+        ParamList_t *list;
+
+        list = home->ctrlParamList;
+
+        fpCtrl = fopen(ctrlFileName, "r");
+        if (fpCtrl == (FILE *)NULL) {
+            Fatal("ReadControlFile: cannot open control file %s",
+                  ctrlFileName);
+        }
+
+        while (1) {
+
+            tokenType = GetNextToken(fpCtrl, token, sizeof(token));
+
+            if (tokenType == TOKEN_NULL) break;
+
+            if (tokenType != TOKEN_GENERIC) {
+                fclose(fpCtrl);
+                Fatal("ReadControlFile: syntax error in %s near '%s'",
+                      ctrlFileName, token);
+            }
+
+            pIndex = LookupParam(list, token);
+
+            if (pIndex < 0) {
+                printf("ReadControlFile: ignoring unknown parameter %s\n",
+                       token);
+                valType = V_NULL;
+                numVals = 0;
+                valList = (void *)NULL;
+            } else {
+                valType = list->varList[pIndex].valType;
+                numVals = list->varList[pIndex].valCnt;
+                valList = list->varList[pIndex].valList;
+                list->varList[pIndex].flags |= VFLAG_SET_BY_USER;
+            }
+
+            if (!GetParamVals(fpCtrl, valType, numVals, valList)) {
+                fclose(fpCtrl);
+                Fatal("ReadControlFile: error obtaining values for "
+                      "parameter %s in %s", token, ctrlFileName);
+            }
+        }
+
+        fclose(fpCtrl);
+
+        return;
+}
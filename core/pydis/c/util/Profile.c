@@ -0,0 +1,501 @@
+/***************************************************************************
+ *
+ *	Module:		Profile.c
+ *	Description:	Wall time and event counters of the native
+ *			kernels, read from python with ProfileGet().  The
+ *			profile belongs to the calling thread, so instances
+ *			driven from different threads do not mix records.
+ *			Phases nest: a phase started while another one runs
+ *			(e.g. the force evaluation of a fused step) is
+ *			counted in both.  Recording is off until
+ *			ProfileEnable() is called, then every call costs
+ *			one clock read.
+ *
+ *			With PROFILE_HW_PERF or PROFILE_HW_PAPI defined the
+ *			outermost start/stop of a phase also reads the
+ *			hardware counters (Profile.h) of the calling thread.
+ *			Counters the processor or the system does not
+ *			provide are reported as -1.  The perf backend
+ *			derives the flops from the Intel
+ *			FP_ARITH_INST_RETIRED events, which other vendors
+ *			do not have.
+ *
+ *	Included functions:
+ *
+ *		ProfileRegister
+ *		ProfileInit
+ *		ProfileWallTime
+ *		ProfileEnable
+ *		ProfileReset
+ *		ProfileStart
+ *		ProfileStop
+ *		ProfileCount
+ *		ProfileGet
+ *		ProfileGetHW
+ *		ProfilePhaseName
+ *		ProfileHWCounterName
+ *
+ **************************************************************************/
+
+#include <time.h>
+#include <string.h>
+#include "Profile.h"
+#include "Error.h"
+
+#ifdef PROFILE_HW_PERF
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+#endif
+
+#ifdef PROFILE_HW_PAPI
+#include <papi.h>
+#endif
+
+static THREAD_LOCAL int       profileEnabled = 0;
+static THREAD_LOCAL int       profileInitialized = 0;
+static THREAD_LOCAL double    phaseStart[PROFILE_NUM_PHASES];
+static THREAD_LOCAL int       phaseDepth[PROFILE_NUM_PHASES];
+static THREAD_LOCAL double    phaseTime[PROFILE_NUM_PHASES];
+static THREAD_LOCAL int       phaseCalls[PROFILE_NUM_PHASES];
+static THREAD_LOCAL long long counters[PROFILE_NUM_COUNTERS];
+
+static THREAD_LOCAL const char *phaseNames[PROFILE_NUM_PHASES];
+static THREAD_LOCAL const char *hwCounterNames[PROFILE_NUM_HW_COUNTERS];
+
+static THREAD_LOCAL int       hwAvailable[PROFILE_NUM_HW_COUNTERS];
+static THREAD_LOCAL long long hwStart[PROFILE_NUM_PHASES][PROFILE_NUM_HW_COUNTERS];
+static THREAD_LOCAL long long hwTotal[PROFILE_NUM_PHASES][PROFILE_NUM_HW_COUNTERS];
+
+#ifdef PROFILE_HW_PERF
+/*
+ *	FP_ARITH_INST_RETIRED umasks (event 0xc7) and the flops per
+ *	instruction: scalar, 128, 256 and 512 bit packed double.
+ */
+#define HW_NUM_FP_EVENTS 4
+static const unsigned long long hwFPConfig[HW_NUM_FP_EVENTS] =
+	{ 0x01c7, 0x04c7, 0x10c7, 0x40c7 };
+static const int hwFPOps[HW_NUM_FP_EVENTS] = { 1, 2, 4, 8 };
+
+#define HW_NUM_EVENTS (3 + HW_NUM_FP_EVENTS)
+static THREAD_LOCAL int hwFd[HW_NUM_EVENTS];
+#endif
+
+#ifdef PROFILE_HW_PAPI
+static THREAD_LOCAL int hwEventSet = PAPI_NULL;
+static THREAD_LOCAL int hwIndex[PROFILE_NUM_HW_COUNTERS];
+#endif
+
+
+/*-------------------------------------------------------------------------
+ *
+ *	Function:	ProfileRegister
+ *	Description:	Assign the name used in reports to a phase, in the
+ *			manner of TimerRegister() for the Home_t timers
+ *
+ *------------------------------------------------------------------------*/
+static void ProfileRegister(int phase, const char *label)
+{
+	if (phase < 0 || phase >= PROFILE_NUM_PHASES) return;
+
+	phaseNames[phase] = label;
+
+	return;
+}
+
+
+#ifdef PROFILE_HW_PERF
+static int PerfOpen(unsigned int type, unsigned long long config)
+{
+	struct perf_event_attr attr;
+
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = type;
+	attr.config = config;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED |
+	                   PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+	return((int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+}
+
+
+/*
+ *	Counter value scaled up for the time the event was multiplexed out
+ */
+static long long PerfRead(int fd)
+{
+	unsigned long long buf[3];
+
+	if (fd < 0 || read(fd, buf, sizeof(buf)) != (ssize_t)sizeof(buf))
+		return(0);
+
+	if (buf[2] == 0) return(0);
+	if (buf[2] == buf[1]) return((long long)buf[0]);
+
+	return((long long)((double)buf[0] * (double)buf[1] / (double)buf[2]));
+}
+
+
+static int IsIntel(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	unsigned int eax, ebx, ecx, edx;
+
+	if (!__get_cpuid(0, &eax, &ebx, &ecx, &edx)) return(0);
+
+	return(ebx == 0x756e6547 && edx == 0x49656e69 && ecx == 0x6c65746e);
+#else
+	return(0);
+#endif
+}
+#endif
+
+
+/*-------------------------------------------------------------------------
+ *
+ *	Function:	HWOpen
+ *	Description:	Open the hardware counters of the calling thread
+ *			and mark the available ones
+ *
+ *------------------------------------------------------------------------*/
+static void HWOpen(void)
+{
+#ifdef PROFILE_HW_PERF
+	int i, fpOk;
+
+	hwFd[0] = PerfOpen(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+	hwFd[1] = PerfOpen(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+	hwFd[2] = PerfOpen(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+
+	fpOk = IsIntel();
+	for (i = 0; i < HW_NUM_FP_EVENTS; i++) {
+		hwFd[3+i] = fpOk ? PerfOpen(PERF_TYPE_RAW, hwFPConfig[i]) : -1;
+		if (hwFd[3+i] < 0) fpOk = 0;
+	}
+
+	hwAvailable[PROFILE_HW_CYCLES]       = (hwFd[0] >= 0);
+	hwAvailable[PROFILE_HW_INSTRUCTIONS] = (hwFd[1] >= 0);
+	hwAvailable[PROFILE_HW_LLC_MISSES]   = (hwFd[2] >= 0);
+	hwAvailable[PROFILE_HW_DP_OPS]       = fpOk;
+	hwAvailable[PROFILE_HW_DP_VEC_OPS]   = fpOk;
+#endif
+
+#ifdef PROFILE_HW_PAPI
+	int i, n;
+	int codes[PROFILE_NUM_HW_COUNTERS] = {
+		PAPI_TOT_CYC, PAPI_TOT_INS, PAPI_L3_TCM, PAPI_DP_OPS, PAPI_VEC_DP
+	};
+
+	for (i = 0; i < PROFILE_NUM_HW_COUNTERS; i++) hwIndex[i] = -1;
+
+	if (PAPI_library_init(PAPI_VER_CURRENT) != PAPI_VER_CURRENT) return;
+	if (PAPI_create_eventset(&hwEventSet) != PAPI_OK) return;
+
+	n = 0;
+	for (i = 0; i < PROFILE_NUM_HW_COUNTERS; i++) {
+		if (PAPI_add_event(hwEventSet, codes[i]) == PAPI_OK)
+			hwIndex[i] = n++;
+	}
+
+	if (n == 0 || PAPI_start(hwEventSet) != PAPI_OK) return;
+
+	for (i = 0; i < PROFILE_NUM_HW_COUNTERS; i++)
+		hwAvailable[i] = (hwIndex[i] >= 0);
+#endif
+
+	return;
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *	Function:	HWRead
+ *	Description:	Current values of the hardware counters
+ *
+ *------------------------------------------------------------------------*/
+static void HWRead(long long *values)
+{
+#ifdef PROFILE_HW_PERF
+	int i;
+	long long ops;
+
+	values[PROFILE_HW_CYCLES]       = PerfRead(hwFd[0]);
+	values[PROFILE_HW_INSTRUCTIONS] = PerfRead(hwFd[1]);
+	values[PROFILE_HW_LLC_MISSES]   = PerfRead(hwFd[2]);
+
+	values[PROFILE_HW_DP_OPS] = 0;
+	values[PROFILE_HW_DP_VEC_OPS] = 0;
+	if (hwAvailable[PROFILE_HW_DP_OPS]) {
+		for (i = 0; i < HW_NUM_FP_EVENTS; i++) {
+			ops = hwFPOps[i] * PerfRead(hwFd[3+i]);
+			values[PROFILE_HW_DP_OPS] += ops;
+			if (hwFPOps[i] > 1) values[PROFILE_HW_DP_VEC_OPS] += ops;
+		}
+	}
+#endif
+
+#ifdef PROFILE_HW_PAPI
+	int i;
+	long long raw[PROFILE_NUM_HW_COUNTERS];
+
+	memset(raw, 0, sizeof(raw));
+	PAPI_read(hwEventSet, raw);
+
+	for (i = 0; i < PROFILE_NUM_HW_COUNTERS; i++)
+		values[i] = (hwIndex[i] >= 0) ? raw[hwIndex[i]] : 0;
+#endif
+
+	(void)values;
+
+	return;
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *	Function:	ProfileInit
+ *	Description:	Register the phase and counter names and open the
+ *			hardware counters, once
+ *
+ *------------------------------------------------------------------------*/
+static void ProfileInit(void)
+{
+	if (profileInitialized) return;
+	profileInitialized = 1;
+
+	ProfileRegister(PROFILE_FORCE,     "force");
+	ProfileRegister(PROFILE_MOBILITY,  "mobility");
+	ProfileRegister(PROFILE_INTEGRATE, "integrate");
+	ProfileRegister(PROFILE_TOPOLOGY,  "topology");
+	ProfileRegister(PROFILE_COLLISION, "collision");
+	ProfileRegister(PROFILE_REMESH,    "remesh");
+	ProfileRegister(PROFILE_CROSS_SLIP, "cross_slip");
+
+	hwCounterNames[PROFILE_HW_CYCLES]       = "cycles";
+	hwCounterNames[PROFILE_HW_INSTRUCTIONS] = "instructions";
+	hwCounterNames[PROFILE_HW_LLC_MISSES]   = "llc_misses";
+	hwCounterNames[PROFILE_HW_DP_OPS]       = "dp_ops";
+	hwCounterNames[PROFILE_HW_DP_VEC_OPS]   = "dp_vec_ops";
+
+	HWOpen();
+
+	return;
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *	Function:	ProfileWallTime
+ *	Description:	Monotonic wall clock time in seconds
+ *
+ *------------------------------------------------------------------------*/
+double ProfileWallTime(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return((double)ts.tv_sec + 1.0e-9 * (double)ts.tv_nsec);
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *	Function:	ProfileEnable
+ *	Description:	Turn recording on (enable != 0) or off
+ *
+ *------------------------------------------------------------------------*/
+void ProfileEnable(int enable)
+{
+	if (enable) ProfileInit();
+
+	profileEnabled = (enable != 0);
+
+	return;
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *	Function:	ProfileReset
+ *	Description:	Zero all phase times and counters
+ *
+ *------------------------------------------------------------------------*/
+void ProfileReset(void)
+{
+	memset(phaseStart, 0, sizeof(phaseStart));
+	memset(phaseDepth, 0, sizeof(phaseDepth));
+	memset(phaseTime, 0, sizeof(phaseTime));
+	memset(phaseCalls, 0, sizeof(phaseCalls));
+	memset(counters, 0, sizeof(counters));
+	memset(hwTotal, 0, sizeof(hwTotal));
+
+	return;
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *	Function:	ProfileStart
+ *	Description:	Start the wall time of a phase.  Recursive starts
+ *			of the same phase are counted once, by the
+ *			outermost start/stop pair.
+ *
+ *------------------------------------------------------------------------*/
+void ProfileStart(int phase)
+{
+	if (!profileEnabled || phase < 0 || phase >= PROFILE_NUM_PHASES)
+		return;
+
+	if (phaseDepth[phase]++ == 0) {
+		HWRead(hwStart[phase]);
+		phaseStart[phase] = ProfileWallTime();
+	}
+
+	return;
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *	Function:	ProfileStop
+ *	Description:	Stop the wall time of a phase and add it to the
+ *			phase total
+ *
+ *------------------------------------------------------------------------*/
+void ProfileStop(int phase)
+{
+	int       i;
+	long long now[PROFILE_NUM_HW_COUNTERS];
+
+	if (!profileEnabled || phase < 0 || phase >= PROFILE_NUM_PHASES)
+		return;
+
+/*
+ *	A stop without start happens if recording was enabled in between
+ */
+	if (phaseDepth[phase] == 0) return;
+
+	if (--phaseDepth[phase] == 0) {
+		phaseTime[phase] += ProfileWallTime() - phaseStart[phase];
+		phaseCalls[phase]++;
+		HWRead(now);
+		for (i = 0; i < PROFILE_NUM_HW_COUNTERS; i++)
+			hwTotal[phase][i] += now[i] - hwStart[phase][i];
+	}
+
+	return;
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *	Function:	ProfileCount
+ *	Description:	Add n to an event counter
+ *
+ *------------------------------------------------------------------------*/
+void ProfileCount(int counter, long long n)
+{
+	if (!profileEnabled || counter < 0 || counter >= PROFILE_NUM_COUNTERS)
+		return;
+
+	counters[counter] += n;
+
+	return;
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *	Function:	ProfileGet
+ *	Description:	Copy the phase totals and counters
+ *	Arguments:
+ *		time	[PROFILE_NUM_PHASES] returned wall time of each
+ *			phase in seconds.  May be NULL.
+ *		calls	[PROFILE_NUM_PHASES] returned number of completed
+ *			start/stop pairs of each phase.  May be NULL.
+ *		counts	[PROFILE_NUM_COUNTERS] returned counters.  May be
+ *			NULL.
+ *
+ *	Returns:  1 if recording is enabled, 0 otherwise
+ *
+ *------------------------------------------------------------------------*/
+int ProfileGet(double *time, int *calls, long long *counts)
+{
+	if (time != (double *)NULL) memcpy(time, phaseTime, sizeof(phaseTime));
+	if (calls != (int *)NULL) memcpy(calls, phaseCalls, sizeof(phaseCalls));
+	if (counts != (long long *)NULL) memcpy(counts, counters, sizeof(counters));
+
+	return(profileEnabled);
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *	Function:	ProfileGetHW
+ *	Description:	Copy the hardware counter totals of the phases
+ *	Arguments:
+ *		values	[PROFILE_NUM_PHASES*PROFILE_NUM_HW_COUNTERS]
+ *			returned counters, phase major.  Counters that
+ *			are not available are set to -1.
+ *
+ *	Returns:  number of available hardware counters, 0 when built
+ *		  without hardware counter support
+ *
+ *------------------------------------------------------------------------*/
+int ProfileGetHW(long long *values)
+{
+	int phase, i, n;
+
+	n = 0;
+	for (i = 0; i < PROFILE_NUM_HW_COUNTERS; i++) n += hwAvailable[i];
+
+	for (phase = 0; phase < PROFILE_NUM_PHASES; phase++) {
+		for (i = 0; i < PROFILE_NUM_HW_COUNTERS; i++) {
+			values[phase*PROFILE_NUM_HW_COUNTERS+i] =
+				hwAvailable[i] ? hwTotal[phase][i] : -1;
+		}
+	}
+
+	return(n);
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *	Function:	ProfilePhaseName
+ *	Description:	Registered name of a phase, NULL if invalid
+ *
+ *------------------------------------------------------------------------*/
+const char *ProfilePhaseName(int phase)
+{
+	ProfileInit();
+
+	if (phase < 0 || phase >= PROFILE_NUM_PHASES) return((const char *)NULL);
+
+	return(phaseNames[phase]);
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *	Function:	ProfileHWCounterName
+ *	Description:	Name of a hardware counter, NULL if invalid
+ *
+ *------------------------------------------------------------------------*/
+const char *ProfileHWCounterName(int counter)
+{
+	ProfileInit();
+
+	if (counter < 0 || counter >= PROFILE_NUM_HW_COUNTERS)
+		return((const char *)NULL);
+
+	return(hwCounterNames[counter]);
+}
@@ -67,6 +67,7 @@ Node_t *PopFreeNodeQ(Home_t *home)
  *-------------------------------------------------------------------------*/
 void PushFreeNodeQ(Home_t *home, Node_t *node)
 {
+	if (home->freeNodeQ == 0) home->lastFreeNode = node;
 	node->next = home->freeNodeQ;
 	home->freeNodeQ = node;
 
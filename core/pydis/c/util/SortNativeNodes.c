@@ -105,10 +105,9 @@ void SortNativeNodes (Home_t *home)
  * native cell
  */
 
-   for (i = 0 ; i < home->newNodeKeyPtr ; i++) {
+   for (i = 0 ; i < home->numActiveNodes ; i++) {
 
-      node = home->nodeKeys[i] ;
-      if (!node) continue ;
+      node = home->activeNodes[i] ;
 
       iCell = (int)((node->x - probXmin) / cellXsize) ;
       if (iCell < param->iCellNatMin) iCell = param->iCellNatMin ;
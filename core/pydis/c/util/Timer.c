@@ -19,6 +19,7 @@
 #include <time.h>
 #include "Home.h"
 #include "Util.h"
+#include "Profile.h"
 
 
 /*-------------------------------------------------------------------------
@@ -144,7 +145,7 @@ void TimerStart(Home_t *home, int index)
 #ifdef _OPENMP
 	home->timers[index].startTime = omp_get_wtime();
 #else
-	home->timers[index].startTime = (real8)clock() / CLOCKS_PER_SEC;
+	home->timers[index].startTime = ProfileWallTime();
 #endif
 #endif
 	home->timers[index].started = 1;
@@ -188,7 +189,7 @@ void TimerStop(Home_t *home, int index)
 #ifdef _OPENMP
 	now=omp_get_wtime();
 #else
-	now = (real8)clock() / CLOCKS_PER_SEC;
+	now = ProfileWallTime();
 #endif
 #endif
 	home->timers[index].incr += now - home->timers[index].startTime;
@@ -270,8 +271,7 @@ void TimerReinitialize(Home_t *home)
 #ifdef PARALLEL
                     home->timers[index].startTime = MPI_Wtime();
 #else
-                    home->timers[index].startTime = (real8)clock() /
-                                                    CLOCKS_PER_SEC;
+                    home->timers[index].startTime = ProfileWallTime();
 #endif
                 }
 	}
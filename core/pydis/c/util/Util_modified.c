@@ -1,5 +1,7 @@
 #include <stdlib.h>
 #include "Home.h"
+#include "Init.h"
+#include "Error.h"
 
 /* Functions modified from ParaDiS to be used by pydis */
 
@@ -11,14 +13,31 @@
  *
  *      Function:    ParadisInit - (modified to not use argc, argv)
  *      Description: Create the 'home' structure, setup timing categories
- *                   and initialize MPI.
+ *                   and initialize MPI.  Each call creates an independent
+ *                   instance, to be freed with HomeFree().
+ *
+ *      Returns:  0 on success, -1 on error (see ErrorMessage()), in
+ *                which case *homeptr is NULL
  *
  *------------------------------------------------------------------------*/
-void ParadisInit_lean(Home_t **homeptr)
+int ParadisInit_lean(Home_t **homeptr)
 {
        Home_t         *home;
+       ErrorTrap_t    trap;
+
+       *homeptr = (Home_t *)NULL;
+
+       ErrorTrapPush(&trap);
+       if (setjmp(trap.env) != 0) {
+           HomeFree(*homeptr);
+           *homeptr = (Home_t *)NULL;
+           return(-1);
+       }
 
        home = InitHome();
+       if (home == (Home_t *)NULL) {
+           Fatal("ParadisInit_lean: out of memory");
+       }
        *homeptr = home;
     
        TimerInit(home);
@@ -31,10 +50,12 @@ void ParadisInit_lean(Home_t **homeptr)
        TimerStart(home, INITIALIZE);
        Initialize_lean(home);  
        TimerStop(home, INITIALIZE);
+
+       ErrorTrapPop(&trap);
     
        if (home->myDomain == 0) printf("ParadisInit finished\n");
 
-       return;
+       return(0);
 }
 
 
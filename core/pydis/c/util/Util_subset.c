@@ -1,6 +1,7 @@
 #include <stdlib.h>
 #include "Home.h"
 #include "QueueOps.h"
+#include "Error.h"
 
 /* Functions from ParaDiS Util.c */
 
@@ -237,7 +238,10 @@ int DomainOwnsSeg(Home_t *home, int opClass, int thisDomain, Tag_t *endTag)
  *
  *      Function:     Fatal
  *      Description:  Prints a user specified message, aborts all
- *                    other parallel tasks (if any) and self-terminates
+ *                    other parallel tasks (if any) and self-terminates.
+ *                    Inside an error trap (see Error.h) the error is
+ *                    raised to the trap instead, where the library
+ *                    entry point returns an error code.
  *
  *      Arguments:    This function accepts a variable number of arguments
  *                    in the same fashion as printf(), with the first
@@ -255,6 +259,11 @@ void Fatal(char *format, ...)
         vsnprintf(msg, sizeof(msg)-1, format, args);
         msg[sizeof(msg)-1] = 0;
         va_end(args);
+
+        if (ErrorTrapped()) {
+            ErrorRaise("Fatal: %s", msg);
+        }
+
         printf("Fatal: %s\n", msg);
 
 #ifdef PARALLEL
@@ -354,22 +363,30 @@ int GetArmID (Home_t *home, Node_t *node1, Node_t *node2)
  *------------------------------------------------------------------------*/
 void FreeNodeArms(Node_t *node)
 {
-        if (node->numNbrs == 0) {
+        if (node->armCapacity == 0) {
+            node->numNbrs = 0;
             return;
         }
 
-        free(node->nbrTag);      node->nbrTag = (Tag_t *)NULL;
-        free(node->burgX);       node->burgX = (real8 *)NULL;
-        free(node->burgY);       node->burgY = (real8 *)NULL;
-        free(node->burgZ);       node->burgZ = (real8 *)NULL;
-        free(node->armfx);       node->armfx = (real8 *)NULL;
-        free(node->armfy);       node->armfy = (real8 *)NULL;
-        free(node->armfz);       node->armfz = (real8 *)NULL;
-        free(node->nx);          node->nx = (real8 *)NULL;
-        free(node->ny);          node->ny = (real8 *)NULL;
-        free(node->nz);          node->nz = (real8 *)NULL;
-        free(node->sigbLoc);     node->sigbLoc = (real8 *)NULL;
-        free(node->sigbRem);     node->sigbRem = (real8 *)NULL;
+        if (node->armStore != node->armInline) {
+            free(node->armStore);
+        }
+
+        node->armStore = (real8 *)NULL;
+        node->armCapacity = 0;
+
+        node->nbrTag = (Tag_t *)NULL;
+        node->burgX = (real8 *)NULL;
+        node->burgY = (real8 *)NULL;
+        node->burgZ = (real8 *)NULL;
+        node->armfx = (real8 *)NULL;
+        node->armfy = (real8 *)NULL;
+        node->armfz = (real8 *)NULL;
+        node->nx = (real8 *)NULL;
+        node->ny = (real8 *)NULL;
+        node->nz = (real8 *)NULL;
+        node->sigbLoc = (real8 *)NULL;
+        node->sigbRem = (real8 *)NULL;
 
         node->numNbrs = 0;
 
@@ -535,6 +552,35 @@ static void InitNodeArm(Node_t *node, int armID)
         return;
 }
 
+/*-------------------------------------------------------------------------
+ *
+ *      Function:     SetNodeArmPointers
+ *      Description:  Point the arm arrays of a node into a block of
+ *                    NODE_ARM_REALS*capacity real8 (one Tag_t takes
+ *                    the space of one real8).
+ *
+ *------------------------------------------------------------------------*/
+static void SetNodeArmPointers(Node_t *node, real8 *store, int capacity)
+{
+        node->armStore    = store;
+        node->armCapacity = capacity;
+
+        node->nbrTag  = (Tag_t *)store;
+        node->burgX   = store +  1*capacity;
+        node->burgY   = store +  2*capacity;
+        node->burgZ   = store +  3*capacity;
+        node->armfx   = store +  4*capacity;
+        node->armfy   = store +  5*capacity;
+        node->armfz   = store +  6*capacity;
+        node->nx      = store +  7*capacity;
+        node->ny      = store +  8*capacity;
+        node->nz      = store +  9*capacity;
+        node->sigbLoc = store + 10*capacity;
+        node->sigbRem = store + 13*capacity;
+
+        return;
+}
+
 /*-------------------------------------------------------------------------
  *
  *      Function:    ReallocNodeArms
@@ -542,30 +588,73 @@ static void InitNodeArm(Node_t *node, int armID)
  *                   node structure preserving any previously 
  *                   existing arm data.
  *
+ *                   All arm arrays live in one block: the inline
+ *                   buffer of the node for up to NODE_INLINE_ARMS
+ *                   arms, a heap block otherwise.  The capacity only
+ *                   grows (at least doubling), so nodes that gain and
+ *                   lose arms, and nodes recycled through the free
+ *                   node queue, do not reallocate.
+ *
  *      Arguments:
  *          node       Pointer to node for which to allocate arms
  *
  *------------------------------------------------------------------------*/
 void ReallocNodeArms(Node_t *node, int n)
 {
-        int i, origNbrCnt;
+        int    i, origNbrCnt, oldCap, newCap;
+        real8  *oldStore, *store;
+        Tag_t  *oldTag;
 
         origNbrCnt = node->numNbrs;
 
-        node->numNbrs = n;
+        if (origNbrCnt > node->armCapacity) {
+            Fatal("ReallocNodeArms: node (%d,%d) has %d arms but room "
+                  "for %d", node->myTag.domainID, node->myTag.index,
+                  origNbrCnt, node->armCapacity);
+        }
+
+        if (n > node->armCapacity) {
+
+            oldCap   = node->armCapacity;
+            oldStore = node->armStore;
+            oldTag   = node->nbrTag;
+
+            if (n <= NODE_INLINE_ARMS && oldCap == 0) {
+                newCap = NODE_INLINE_ARMS;
+                store = node->armInline;
+            } else {
+                newCap = (2*oldCap > n) ? 2*oldCap : n;
+                store = (real8 *)malloc(NODE_ARM_REALS * newCap *
+                                        sizeof(real8));
+                if (store == (real8 *)NULL) {
+                    Fatal("ReallocNodeArms: out of memory (%d arms)", n);
+                }
+            }
+
+/*
+ *          Copy the arrays of the existing arms one by one since
+ *          their offsets in the block depend on the capacity.
+ */
+            if (origNbrCnt > 0) {
+                memcpy(store, oldTag, origNbrCnt * sizeof(Tag_t));
+                for (i = 1; i < 10; i++) {
+                    memcpy(store + i*newCap, oldStore + i*oldCap,
+                           origNbrCnt * sizeof(real8));
+                }
+                memcpy(store + 10*newCap, oldStore + 10*oldCap,
+                       3 * origNbrCnt * sizeof(real8));
+                memcpy(store + 13*newCap, oldStore + 13*oldCap,
+                       3 * origNbrCnt * sizeof(real8));
+            }
+
+            if (oldCap > 0 && oldStore != node->armInline) {
+                free(oldStore);
+            }
+
+            SetNodeArmPointers(node, store, newCap);
+        }
 
-        node->nbrTag = (Tag_t *) realloc(node->nbrTag, sizeof(Tag_t)*n);
-        node->burgX = (real8 *) realloc(node->burgX, sizeof(real8  )*n);
-        node->burgY = (real8 *) realloc(node->burgY, sizeof(real8  )*n);
-        node->burgZ = (real8 *) realloc(node->burgZ, sizeof(real8  )*n);
-        node->armfx = (real8 *) realloc(node->armfx, sizeof(real8  )*n);
-        node->armfy = (real8 *) realloc(node->armfy, sizeof(real8  )*n);
-        node->armfz = (real8 *) realloc(node->armfz, sizeof(real8  )*n);
-        node->nx = (real8 *) realloc(node->nx, sizeof(real8  )*n);
-        node->ny = (real8 *) realloc(node->ny, sizeof(real8  )*n);
-        node->nz = (real8 *) realloc(node->nz, sizeof(real8  )*n);
-        node->sigbLoc  = (real8 *) realloc(node->sigbLoc, n*3*sizeof(real8));
-        node->sigbRem  = (real8 *) realloc(node->sigbRem, n*3*sizeof(real8));
+        node->numNbrs = n;
 
 /*
  *      And just initialize the newly allocated arms only, leaving
@@ -1095,40 +1184,94 @@ void InitOpList (Home_t *home)
  *------------------------------------------------------------------------*/
 int RequestNodeTag(Home_t *home, Tag_t *tag)
 {
-        if (tag->index >= home->newNodeKeyMax) {
 /*
- *          The node index is higher than the current size
- *          of the node list. Reallocate the node list with
- *          the new size to allow the node index to be requested.
+ *      If the node index is higher than the current size of the
+ *      node list, extend the node list to allow the node index to
+ *      be requested.
  */
-            int NUM_INC = ceil((tag->index-home->newNodeKeyMax-1)/NEW_NODEKEY_INC);
-
-            home->newNodeKeyMax += NUM_INC*NEW_NODEKEY_INC;
-            home->nodeKeys = (Node_t **) realloc(home->nodeKeys,
-            home->newNodeKeyMax * sizeof(Node_t *));
+        if (tag->index >= home->newNodeKeyMax) {
+            ExtendNodeKeys(home, tag->index+1);
+        }
 
-            home->newNodeKeyPtr = tag->index+1;
+/*
+ *      Check if the requested node index is already used. If not
+ *      make sure to update the newNodeKeyPtr variable if needed.
+ */
+        if (home->nodeKeys[tag->index] == (Node_t *)NULL) {
 
+            if (tag->index >= home->newNodeKeyPtr) {
+                home->newNodeKeyPtr = tag->index+1;
+            }
             return tag->index;
 
         } else {
-/*
- *          Check if the requested node index is already used. If not
- *          make sure to update the newNodeKeyPtr variable if needed.
- */
-            if (home->nodeKeys[tag->index] == (Node_t *)NULL) {
-
-                if (tag->index >= home->newNodeKeyPtr) {
-                    home->newNodeKeyPtr = tag->index+1;
-                }
-                return tag->index;
+            return -1;
+        }
+}
 
-            } else {
-                return -1;
+/*-------------------------------------------------------------------------
+ *
+ *      Function:     AddActiveNode
+ *      Description:  Append a node to the dense list of nodes in
+ *                    nodeKeys.
+ *
+ *------------------------------------------------------------------------*/
+static void AddActiveNode(Home_t *home, Node_t *node)
+{
+        if (home->numActiveNodes >= home->activeNodesMax) {
+            home->activeNodesMax = (home->activeNodesMax > 0) ?
+                                   2 * home->activeNodesMax : NEW_NODEKEY_INC;
+            home->activeNodes = (Node_t **)realloc(home->activeNodes,
+                                home->activeNodesMax * sizeof(Node_t *));
+            if (home->activeNodes == (Node_t **)NULL) {
+                Fatal("AddActiveNode: out of memory (%d nodes)",
+                      home->activeNodesMax);
             }
         }
+
+        node->activeIdx = home->numActiveNodes;
+        home->activeNodes[home->numActiveNodes++] = node;
+
+        return;
 }
 
+/*-------------------------------------------------------------------------
+ *
+ *      Function:     RemoveNodeKey
+ *      Description:  Take a native node out of nodeKeys and the list
+ *                    of active nodes.  The node's arms and the node
+ *                    itself are left for the caller to release.
+ *
+ *------------------------------------------------------------------------*/
+void RemoveNodeKey(Home_t *home, Node_t *node)
+{
+        int    idx;
+        Node_t *last;
+
+        idx = node->myTag.index;
+
+        if (node->myTag.domainID != home->myDomain || idx < 0 ||
+            idx >= home->newNodeKeyPtr || home->nodeKeys[idx] != node) {
+            Fatal("RemoveNodeKey: node (%d,%d) is not a native node",
+                  node->myTag.domainID, idx);
+        }
+
+        home->nodeKeys[idx] = (Node_t *)NULL;
+
+        while (home->newNodeKeyPtr > 0 &&
+               home->nodeKeys[home->newNodeKeyPtr-1] == (Node_t *)NULL) {
+            home->newNodeKeyPtr--;
+        }
+
+        last = home->activeNodes[--home->numActiveNodes];
+        home->activeNodes[node->activeIdx] = last;
+        last->activeIdx = node->activeIdx;
+        node->activeIdx = -1;
+
+        return;
+}
+
+
 /*-------------------------------------------------------------------------
  *
  *      Function:     RequestNewNativeNodeTag
@@ -1148,6 +1291,7 @@ Node_t *RequestNewNativeNodeTag(Home_t *home, Tag_t *tag)
         }
 
         home->nodeKeys[newIdx] = newNode;
+        AddActiveNode(home, newNode);
 
         newNode->myTag.domainID = home->myDomain;
         newNode->myTag.index    = newIdx;
@@ -1191,18 +1335,29 @@ Node_t *RequestNewNativeNodeTag(Home_t *home, Tag_t *tag)
 /*---------------------------------------------------------------------------
  *
  *      Function:     ExtendNodeKeys
- *      Description:  
+ *      Description:  Make sure the nodeKeys array has at least newLength
+ *                    entries.  The array grows at least geometrically
+ *                    (doubling), new entries are set to NULL.
  *
  *-------------------------------------------------------------------------*/
-static void ExtendNodeKeys(Home_t *home, int newLength)
+void ExtendNodeKeys(Home_t *home, int newLength)
 {
         int i, oldLength;
 
         oldLength = home->newNodeKeyMax;
-        home->newNodeKeyMax = newLength;
+
+        if (newLength <= oldLength) return;
+
+        if (newLength < 2 * oldLength) newLength = 2 * oldLength;
+        if (newLength < NEW_NODEKEY_INC) newLength = NEW_NODEKEY_INC;
 
         home->nodeKeys = (Node_t **)realloc(home->nodeKeys,
                                             newLength * sizeof(Node_t *));
+        if (home->nodeKeys == (Node_t **)NULL) {
+            Fatal("ExtendNodeKeys: out of memory (%d node keys)", newLength);
+        }
+
+        home->newNodeKeyMax = newLength;
 
         for (i = oldLength; i < newLength; i++) {
             home->nodeKeys[i] = (Node_t *)NULL;
@@ -1223,7 +1378,8 @@ void AddTagMapping(Home_t *home, Tag_t *oldTag, Tag_t *newTag)
         TagMap_t *mapping;
 
         if (home->tagMapEnts >= home->tagMapSize) {
-              home->tagMapSize += NEW_NODEKEY_INC;
+              home->tagMapSize = (home->tagMapSize > 0) ?
+                                 2 * home->tagMapSize : NEW_NODEKEY_INC;
               newSize = home->tagMapSize * sizeof(TagMap_t);
               home->tagMap = (TagMap_t *)realloc(home->tagMap, newSize);
         }
@@ -1350,7 +1506,7 @@ void AddNodesFromArray(Home_t *home, real8 *buf)
         printf("AddNodesFromArray: nodesInBuf = %d\n", nodesInBuf);
 
         printf("AddNodesFromArray: ExtendNodeKeys = %d, %d\n", home->newNodeKeyMax, NEW_NODEKEY_INC);
-        ExtendNodeKeys(home, home->newNodeKeyMax + NEW_NODEKEY_INC);
+        ExtendNodeKeys(home, home->newNodeKeyPtr + nodesInBuf);
 
         for (i = 0; i < nodesInBuf; i++) {
 
@@ -1389,6 +1545,415 @@ void AddNodesFromArray(Home_t *home, real8 *buf)
 }
 
 
+/*-------------------------------------------------------------------------
+ *
+ *      Function:     RecycleNodeTag
+ *      Description:  Add the index of a freed native tag to the heap
+ *                    of recycled tags, so that GetFreeNodeTag()
+ *                    reuses the lowest freed index first.
+ *
+ *------------------------------------------------------------------------*/
+void RecycleNodeTag(Home_t *home, int tagIdx)
+{
+        int i, parent, *heap;
+
+        if (home->recycledNodeHeapEnts >= home->recycledNodeHeapSize) {
+            home->recycledNodeHeapSize = (home->recycledNodeHeapSize > 0) ?
+                                         2 * home->recycledNodeHeapSize :
+                                         NEW_NODEKEY_INC;
+            home->recycledNodeHeap = (int *)realloc(home->recycledNodeHeap,
+                                     home->recycledNodeHeapSize * sizeof(int));
+            if (home->recycledNodeHeap == (int *)NULL) {
+                Fatal("RecycleNodeTag: out of memory (%d tags)",
+                      home->recycledNodeHeapSize);
+            }
+        }
+
+        heap = home->recycledNodeHeap;
+        i = home->recycledNodeHeapEnts++;
+
+        while (i > 0) {
+            parent = (i - 1) / 2;
+            if (heap[parent] <= tagIdx) break;
+            heap[i] = heap[parent];
+            i = parent;
+        }
+
+        heap[i] = tagIdx;
+
+        return;
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:     GetRecycledNodeTag
+ *      Description:  Remove the lowest index from the heap of recycled
+ *                    tags.
+ *
+ *      Returns:  the tag index, or -1 if the heap is empty
+ *
+ *------------------------------------------------------------------------*/
+int GetRecycledNodeTag(Home_t *home)
+{
+        int i, child, n, last, tagIdx, *heap;
+
+        if (home->recycledNodeHeapEnts <= 0) return(-1);
+
+        heap   = home->recycledNodeHeap;
+        tagIdx = heap[0];
+        n      = --home->recycledNodeHeapEnts;
+        last   = heap[n];
+
+        i = 0;
+        while ((child = 2*i + 1) < n) {
+            if (child + 1 < n && heap[child+1] < heap[child]) child++;
+            if (last <= heap[child]) break;
+            heap[i] = heap[child];
+            i = child;
+        }
+
+        if (n > 0) heap[i] = last;
+
+        return(tagIdx);
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:     GetFreeNodeTag
+ *      Description:  Return an unused native tag index: the lowest
+ *                    recycled index if there is one, the next index
+ *                    past the used ones otherwise.
+ *
+ *------------------------------------------------------------------------*/
+int GetFreeNodeTag(Home_t *home)
+{
+        int tagIdx;
+
+        while ((tagIdx = GetRecycledNodeTag(home)) >= 0) {
+            if (tagIdx >= home->newNodeKeyPtr ||
+                home->nodeKeys[tagIdx] == (Node_t *)NULL) {
+                return(tagIdx);
+            }
+        }
+
+        return(home->newNodeKeyPtr);
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:     FreeNode
+ *      Description:  Remove the native node with the given tag index
+ *                    from the cell queues and nodeKeys, recycle its tag
+ *                    and return the node to the free queue (keeping its
+ *                    arm storage).  The tag is recorded in
+ *                    home->removedTags for HomeExportChanges().
+ *
+ *------------------------------------------------------------------------*/
+void FreeNode(Home_t *home, int index)
+{
+        Node_t *node;
+
+        if (index < 0 || index >= home->newNodeKeyPtr ||
+            (node = home->nodeKeys[index]) == (Node_t *)NULL) {
+            Fatal("FreeNode: no native node with tag index %d", index);
+        }
+
+        if (home->numRemovedTags >= home->removedTagsMax) {
+            home->removedTagsMax = (home->removedTagsMax > 0) ?
+                                   2 * home->removedTagsMax : NEW_NODEKEY_INC;
+            home->removedTags = (Tag_t *)realloc(home->removedTags,
+                                home->removedTagsMax * sizeof(Tag_t));
+            if (home->removedTags == (Tag_t *)NULL) {
+                Fatal("FreeNode: out of memory (%d tags)",
+                      home->removedTagsMax);
+            }
+        }
+
+        home->removedTags[home->numRemovedTags++] = node->myTag;
+
+        RemoveNodeFromCellQ(home, node);
+        RemoveNodeFromCell2Q(home, node);
+        RemoveNodeKey(home, node);
+        RecycleNodeTag(home, index);
+
+        node->cellIdx = -1;
+        node->cell2Idx = -1;
+        node->cell2QentIdx = -1;
+        node->numNbrs = 0;
+        node->flags = 0;
+        PushFreeNodeQ(home, node);
+
+        return;
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:     RemoveNode
+ *      Description:  Delete a native node.  The node's arms are
+ *                    expected to have been removed (or relinked)
+ *                    by the caller.
+ *
+ *      Arguments:
+ *          node      pointer to the node to remove
+ *          globalOp  set to 1 if the operation must be passed on to
+ *                    remote domains
+ *
+ *------------------------------------------------------------------------*/
+void RemoveNode(Home_t *home, Node_t *node, int globalOp)
+{
+        if (globalOp) {
+            AddOp(home, REMOVE_NODE,
+                node->myTag.domainID,
+                node->myTag.index,
+                -1, -1,
+                -1, -1,
+                0.0, 0.0, 0.0,  /* bx, by, bz */
+                0.0, 0.0, 0.0,  /* x, y, z */
+                0.0, 0.0, 0.0); /* nx, ny, nz */
+        }
+
+        FreeNode(home, node->myTag.index);
+
+        return;
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:     CopyNodeArm
+ *      Description:  Copy all data of arm <from> of a node to arm <to>.
+ *
+ *------------------------------------------------------------------------*/
+static void CopyNodeArm(Node_t *node, int from, int to)
+{
+        int i;
+
+        node->nbrTag[to] = node->nbrTag[from];
+        node->burgX[to]  = node->burgX[from];
+        node->burgY[to]  = node->burgY[from];
+        node->burgZ[to]  = node->burgZ[from];
+        node->armfx[to]  = node->armfx[from];
+        node->armfy[to]  = node->armfy[from];
+        node->armfz[to]  = node->armfz[from];
+        node->nx[to]     = node->nx[from];
+        node->ny[to]     = node->ny[from];
+        node->nz[to]     = node->nz[from];
+
+        for (i = 0; i < 3; i++) {
+            node->sigbLoc[3*to+i] = node->sigbLoc[3*from+i];
+            node->sigbRem[3*to+i] = node->sigbRem[3*from+i];
+        }
+
+        return;
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:     InsertArm
+ *      Description:  Add an arm from nodeA to the node with tag
+ *                    nodeBtag.  The arm force is zeroed.
+ *
+ *      Arguments:
+ *          bx, by, bz  burgers vector of the arm (from nodeA)
+ *          nx, ny, nz  glide plane normal of the arm
+ *          globalOp    set to 1 if the operation must be passed on
+ *                      to remote domains
+ *
+ *------------------------------------------------------------------------*/
+void InsertArm(Home_t *home, Node_t *nodeA, Tag_t *nodeBtag,
+               real8 bx, real8 by, real8 bz,
+               real8 nx, real8 ny, real8 nz, int globalOp)
+{
+        int arm;
+
+        if (globalOp) {
+            AddOp(home, INSERT_ARM,
+                nodeA->myTag.domainID,
+                nodeA->myTag.index,
+                nodeBtag->domainID,
+                nodeBtag->index,
+                -1, -1,
+                bx, by, bz,
+                0.0, 0.0, 0.0,  /* x, y, z */
+                nx, ny, nz);
+        }
+
+        arm = nodeA->numNbrs;
+        ReallocNodeArms(nodeA, arm + 1);
+
+        nodeA->nbrTag[arm] = *nodeBtag;
+        nodeA->burgX[arm] = bx;
+        nodeA->burgY[arm] = by;
+        nodeA->burgZ[arm] = bz;
+        nodeA->nx[arm] = nx;
+        nodeA->ny[arm] = ny;
+        nodeA->nz[arm] = nz;
+
+        nodeA->flags |= NODE_TOPO_CHANGED;
+
+        return;
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:     ChangeArmBurg
+ *      Description:  Set the burgers vector and glide plane of the arm
+ *                    of node1 terminating at tag2.  A zero burgers
+ *                    vector deletes the arm (the remaining arms keep
+ *                    their order).
+ *
+ *      Arguments:
+ *          bx, by, bz      new burgers vector (from node1)
+ *          nx, ny, nz      new glide plane normal
+ *          globalOp        set to 1 if the operation must be passed on
+ *                          to remote domains
+ *          delSegFactor    portion of the length of a deleted segment
+ *                          added to param->delSegLength (DEL_SEG_NONE
+ *                          or DEL_SEG_HALF)
+ *
+ *------------------------------------------------------------------------*/
+void ChangeArmBurg(Home_t *home, Node_t *node1, Tag_t *tag2,
+                   real8 bx, real8 by, real8 bz, real8 nx,
+                   real8 ny, real8 nz, int globalOp, real8 delSegFactor)
+{
+        int    i, arm;
+        real8  dx, dy, dz;
+        Node_t *node2;
+
+        if (globalOp) {
+            AddOp(home, CHANGE_ARM_BURG,
+                node1->myTag.domainID,
+                node1->myTag.index,
+                tag2->domainID,
+                tag2->index,
+                -1, -1,
+                bx, by, bz,
+                0.0, 0.0, 0.0,  /* x, y, z */
+                nx, ny, nz);
+        }
+
+        for (arm = 0; arm < node1->numNbrs; arm++) {
+            if ((node1->nbrTag[arm].domainID == tag2->domainID) &&
+                (node1->nbrTag[arm].index == tag2->index)) {
+                break;
+            }
+        }
+
+        if (arm >= node1->numNbrs) return;
+
+        node1->flags |= NODE_TOPO_CHANGED;
+
+        if ((bx != 0.0) || (by != 0.0) || (bz != 0.0)) {
+            node1->burgX[arm] = bx;
+            node1->burgY[arm] = by;
+            node1->burgZ[arm] = bz;
+            node1->nx[arm] = nx;
+            node1->ny[arm] = ny;
+            node1->nz[arm] = nz;
+            return;
+        }
+
+        if (delSegFactor > 0.0) {
+            node2 = GetNodeFromTag(home, *tag2);
+            if (node2 != (Node_t *)NULL) {
+                dx = node2->x - node1->x;
+                dy = node2->y - node1->y;
+                dz = node2->z - node1->z;
+                ZImage(home->param, &dx, &dy, &dz);
+                home->param->delSegLength += delSegFactor *
+                                             sqrt(dx*dx + dy*dy + dz*dz);
+            }
+        }
+
+        for (i = arm; i < node1->numNbrs - 1; i++) {
+            CopyNodeArm(node1, i + 1, i);
+        }
+
+        node1->numNbrs--;
+
+        return;
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:     ChangeConnection
+ *      Description:  Redirect the arm of node1 terminating at tag2 to
+ *                    terminate at tag3 instead.
+ *
+ *      Returns:  0 on success, -1 if node1 has no arm to tag2
+ *
+ *------------------------------------------------------------------------*/
+int ChangeConnection(Home_t *home, Node_t *node1, Tag_t *tag2,
+                     Tag_t *tag3, int globalOp)
+{
+        int arm;
+
+        if (globalOp) {
+            AddOp(home, CHANGE_CONNECTION,
+                node1->myTag.domainID,
+                node1->myTag.index,
+                tag2->domainID,
+                tag2->index,
+                tag3->domainID,
+                tag3->index,
+                0.0, 0.0, 0.0,  /* bx, by, bz */
+                0.0, 0.0, 0.0,  /* x, y, z */
+                0.0, 0.0, 0.0); /* nx, ny, nz */
+        }
+
+        for (arm = 0; arm < node1->numNbrs; arm++) {
+            if ((node1->nbrTag[arm].domainID == tag2->domainID) &&
+                (node1->nbrTag[arm].index == tag2->index)) {
+                node1->nbrTag[arm] = *tag3;
+                node1->flags |= NODE_TOPO_CHANGED;
+                return(0);
+            }
+        }
+
+        return(-1);
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *      Function:     RepositionNode
+ *      Description:  Move the node with the given tag to newPos.
+ *
+ *------------------------------------------------------------------------*/
+void RepositionNode(Home_t *home, real8 newPos[3], Tag_t *tag, int globalOp)
+{
+        Node_t *node;
+
+        if (globalOp) {
+            AddOp(home, RESET_COORD,
+                tag->domainID,
+                tag->index,
+                -1, -1,
+                -1, -1,
+                0.0, 0.0, 0.0,  /* bx, by, bz */
+                newPos[X], newPos[Y], newPos[Z],
+                0.0, 0.0, 0.0); /* nx, ny, nz */
+        }
+
+        if ((node = GetNodeFromTag(home, *tag)) == (Node_t *)NULL) return;
+
+        node->x = newPos[X];
+        node->y = newPos[Y];
+        node->z = newPos[Z];
+
+        node->flags |= NODE_TOPO_CHANGED;
+
+        return;
+}
+
+
 /* From ReadRestart.c */
 void FreeAllNodes(Home_t *home)
 {
@@ -1397,12 +1962,17 @@ void FreeAllNodes(Home_t *home)
     for (i = 0; i < home->newNodeKeyPtr; i++) {
         if (home->nodeKeys[i] != (Node_t *)NULL) {
             node =  home->nodeKeys[i];
-            FreeNodeArms(node);
-            /* node memory managed by NodeQ, not sure if this is going to cause memory leak */
+            /* keep the arm storage, the node is reused from the free queue */
+            node->numNbrs = 0;
+            PushFreeNodeQ(home, node);
             home->nodeKeys[i] = NULL;
         }
     }
+    home->nativeNodeQ = (Node_t *)NULL;
     home->newNodeKeyPtr = 0;
+    home->numActiveNodes = 0;
+    home->recycledNodeHeapEnts = 0;
+    home->numRemovedTags = 0;
 }
 
 
@@ -8,6 +8,9 @@ from .timeint.timeint_disnet import TimeIntegration
 from .topology.topology_disnet import Topology
 from .collision.collision_disnet import Collision
 from .remesh.remesh_disnet import Remesh
+from .crossslip.crossslip_disnet import CrossSlip
 from .visualize.vis_disnet import VisualizeNetwork
+from .visualize.vis_lod import LODVisualizer
 from .simulate.sim_disnet import SimulateNetwork
-from .nbrlist.nbrlist import CellList
+from .simulate.ensemble import SimulateEnsemble
+from .nbrlist.nbrlist import CellList, VerletList, morton_order, morton_reorder
@@ -6,7 +6,7 @@ Provide force calculation functions given a DisNet object
 
 import numpy as np
 from typing import Tuple
-from ..disnet import DisNet, Tag
+from ..disnet import DisNet, DisNode, Tag
 from framework.disnet_manager import DisNetManager
 from framework.calforce_base import CalForce_Base
 
@@ -14,13 +14,24 @@ try:
     from .compute_stress_force_analytic_paradis import compute_segseg_force_vec, compute_segseg_force
     from .compute_stress_force_analytic_paradis import compute_segseg_force_SBN1_vec, compute_segseg_force_SBN1
     from .compute_stress_force_analytic_paradis import compute_segseg_force_SBN1_SBA
+    from .compute_stress_force_analytic_paradis import compute_segseg_force_all_pairs, compute_segseg_force_cell_list
+    from .compute_stress_force_analytic_paradis import compute_segseg_force_fmm, compute_segseg_force_subset
+    from .compute_stress_force_analytic_paradis import compute_segseg_force_pair_list
+    from .compute_stress_force_analytic_paradis import compute_local_node_forces, compute_far_field_stress
     from .compute_stress_analytic_paradis       import compute_seg_stress_coord_dep, compute_seg_stress_coord_indep
+    from .compute_stress_force_analytic_paradis import compute_line_tension_force
+    from .compute_stress_force_analytic_paradis import segseg_force_device_create, segseg_force_device_free, compute_segseg_force_device
+    from .compute_stress_force_analytic_paradis import mixed_precision_policy, mixed_precision_stats
+    from .fmm_correction import fmm_correction_table
+    found_pydis_lib = True
 except ImportError:
+    found_pydis_lib = False
     # use python version instead
     # To do: put import commands here
     print("pydis_lib not found, using python version for force calculation")
 
 from .compute_stress_force_analytic_python  import python_segseg_force_vec
+from ..nbrlist.nbrlist import VerletList
 
 def voigt_vector_to_tensor(voigt_vector):
     return np.array([[voigt_vector[0], voigt_vector[5], voigt_vector[4]],
@@ -70,21 +81,93 @@ class CalForce(CalForce_Base):
     """CalForce_DisNet: class for calculating forces on dislocation network
     """
     def __init__(self, state: dict={}, Ec: float=None,
-                 force_mode: str='Elasticity_SBA') -> None:
+                 force_mode: str='Elasticity_SBA', cutoff: float=None,
+                 fm_num_layers: int=None, fm_mp_order: int=2, fm_taylor_order: int=5,
+                 fm_pbc_images: int=None, fm_correction_dir: str=None,
+                 mixed_precision_dist: float=None, mixed_precision_check: bool=False,
+                 incremental: bool=False, frozen_tol: float=None,
+                 use_device: bool=False, device_id: int=-1,
+                 verlet_skin: float=None, local_cutoff: float=None, decomp=None) -> None:
         self.mu = state.get("mu", 1.0)
         self.nu = state.get("nu", 0.3)
         self.a =  state.get("a", 0.01)
         self.Ec = self.mu/4.0/np.pi*np.log(self.a/0.1) if Ec is None else Ec
         self.force_mode = force_mode
+        # interaction cutoff for the *_Cutoff force modes
+        self.cutoff = cutoff
+        if force_mode.endswith('_Cutoff') and cutoff is None:
+            raise ValueError("CalForce: force_mode %s requires a cutoff" % force_mode)
+        # if given, the *_Cutoff modes keep a Verlet list with this skin across
+        # steps instead of building a cell list at every evaluation
+        self.verlet_skin = verlet_skin
+        self._verlet = None
+        # near-field cutoff of LocalNodeForce, remote segments enter through
+        # a far-field stress cached by node position until the next NodeForce
+        self.local_cutoff = local_cutoff
+        self._far_stress = {}
+        # fast multipole parameters for the *_FMM force modes
+        self.fm_num_layers = fm_num_layers
+        self.fm_mp_order = fm_mp_order
+        self.fm_taylor_order = fm_taylor_order
+        if force_mode.endswith('_FMM') and fm_num_layers is None:
+            raise ValueError("CalForce: force_mode %s requires fm_num_layers" % force_mode)
+        # if fm_pbc_images is given, the periodic images up to that many
+        # periods away enter the FMM far field through a correction table,
+        # generated once per cell and cached in fm_correction_dir
+        # (see fmm_correction.fmm_correction_table)
+        self.fm_pbc_images = fm_pbc_images
+        self.fm_correction_dir = fm_correction_dir
+        self._fm_corr = None
+        # mixed precision: the pairs of the analytic (SBA) elasticity modes
+        # farther apart than mixed_precision_dist are evaluated in single
+        # precision; with mixed_precision_check their error against double
+        # precision is reported at every evaluation (debug runs)
+        self.mixed_precision_dist = mixed_precision_dist
+        self.mixed_precision_check = mixed_precision_check
+        self._mixed = None
+        # incremental mode: only recompute the segment pairs involving
+        # segments that changed, or whose nodes are marked NODE_RESET_FORCES,
+        # since the previous evaluation (all-pairs elasticity modes only)
+        self.incremental = incremental
+        self._elastic_cache = None
+        self._obsolete_tags = set()
+        # frozen pair cache: if frozen_tol is given, the pairs of segments
+        # whose nodes moved less than frozen_tol since they were cached
+        # (e.g. pinned ones) are reused (see ElasticSegForces_FrozenPairs)
+        self.frozen_tol = frozen_tol
+        self._pair_cache = None
+        self._pair_prev = None
+        # device (GPU) backend for the all-pairs elasticity modes; created on
+        # first use and kept for the lifetime of this object
+        self.use_device = use_device
+        self.device_id = device_id
+        self._device = None
+        # pydis.util.domain_decomp.DomainDecomposition distributing the
+        # elasticity modes (except FMM) over the MPI ranks
+        self.decomp = decomp
+        # pydis.simulate.ensemble.ForceBatcher evaluating the all-pairs
+        # elasticity forces of several networks in one native call
+        self.batcher = None
 
         self.NodeForce_Functions = {
             'LineTension': self.NodeForce_LineTension,
             'Elasticity_SBA': self.NodeForce_Elasticity_SBA,
-            'Elasticity_SBN1_SBA': self.NodeForce_Elasticity_SBN1_SBA }
+            'Elasticity_SBN1_SBA': self.NodeForce_Elasticity_SBN1_SBA,
+            'Elasticity_SBA_Cutoff': self.NodeForce_Elasticity_SBA_Cutoff,
+            'Elasticity_SBN1_SBA_Cutoff': self.NodeForce_Elasticity_SBN1_SBA_Cutoff,
+            'Elasticity_SBA_FMM': self.NodeForce_Elasticity_SBA_FMM }
         self.OneNodeForce_Functions = {
             'LineTension': self.OneNodeForce_LineTension,
             'Elasticity_SBA': self.OneNodeForce_Elasticity_SBA,
-            'Elasticity_SBN1_SBA': self.OneNodeForce_Elasticity_SBN1_SBA }
+            'Elasticity_SBN1_SBA': self.OneNodeForce_Elasticity_SBN1_SBA,
+            'Elasticity_SBA_Cutoff': self.OneNodeForce_Elasticity_SBA_Cutoff,
+            'Elasticity_SBN1_SBA_Cutoff': self.OneNodeForce_Elasticity_SBN1_SBA_Cutoff,
+            'Elasticity_SBA_FMM': self.OneNodeForce_Elasticity_SBA }
+
+    def __del__(self):
+        if getattr(self, "_device", None) is not None:
+            segseg_force_device_free(self._device)
+            self._device = None
 
     def NodeForce(self, DM: DisNetManager, state: dict, pre_compute: bool=True) -> dict:
         """NodeForce: return nodal forces in a dictionary
@@ -93,7 +176,18 @@ class CalForce(CalForce_Base):
         """
         applied_stress = state["applied_stress"]
         G = DM.get_disnet(DisNet)
+        self.CollectObsoleteNodes(state)
+        self._far_stress.clear()
+        # precision policy of this evaluation, passed to the pair drivers
+        self._mixed = None
+        if self.mixed_precision_dist is not None:
+            self._mixed = mixed_precision_policy(self.mixed_precision_dist, self.mixed_precision_check)
         nodeforce_dict, segforce_dict = self.NodeForce_Functions[self.force_mode](G, applied_stress)
+        if self._mixed is not None and self.mixed_precision_check:
+            stats = mixed_precision_stats(self._mixed)
+            state["mixed_precision_error"] = stats
+            print("CalForce: %d single precision pairs, rms rel error %e, max error %e" %
+                  (stats["num_checked"], stats["rms_rel_error"], stats["max_error"]))
         state["nodeforce_dict"] = nodeforce_dict
         state["segforce_dict"] = segforce_dict
 
@@ -115,23 +209,119 @@ class CalForce(CalForce_Base):
         """
         applied_stress = state["applied_stress"]
         G = DM.get_disnet(DisNet)
+        self.CollectObsoleteNodes(state)
         f = self.OneNodeForce_Functions[self.force_mode](G, applied_stress, tag)
         # update force dictionary if needed
         if update_state:
-            if "nodeforces" in state and "nodeforcetags" in state:
-                nodeforcetags = state["nodeforcetags"]
-                ind = np.where((nodeforcetags[:,0]==tag[0])&(nodeforcetags[:,1]==tag[1]))[0]
-                if ind.size == 1:
-                    state["nodeforces"][ind[0]] = f
-                else:
-                    state["nodeforces"] = np.vstack((state["nodeforces"], f))
-                    state["nodeforcetags"] = np.vstack((state["nodeforcetags"], tag))
-            else:
-                state["nodeforces"] = np.array([f])
-                state["nodeforcetags"] = np.array([tag])
+            CalForce.store_node_force(state, tag, f)
 
         return f
 
+    @staticmethod
+    def store_node_force(state: dict, tag: Tag, f: np.ndarray) -> None:
+        """store_node_force: set the force of one node in state["nodeforces"]
+        """
+        if "nodeforces" in state and "nodeforcetags" in state:
+            nodeforcetags = state["nodeforcetags"]
+            ind = np.where((nodeforcetags[:,0]==tag[0])&(nodeforcetags[:,1]==tag[1]))[0]
+            if ind.size == 1:
+                state["nodeforces"][ind[0]] = f
+            else:
+                state["nodeforces"] = np.vstack((state["nodeforces"], f))
+                state["nodeforcetags"] = np.vstack((state["nodeforcetags"], tag))
+        else:
+            state["nodeforces"] = np.array([f])
+            state["nodeforcetags"] = np.array([tag])
+
+    def LocalNodeForce(self, DM: DisNetManager, state: dict, tags: list, update_state: bool=False) -> dict:
+        """LocalNodeForce: return the forces on a few nodes in a dictionary
+
+        Shared evaluator for the local force updates of topology, remesh and
+        collision operations.  The elasticity modes are evaluated in one call
+        to libpydis (LocalNodeForces): the segments attached to the nodes
+        interact with the segments within self.local_cutoff of each node (all
+        segments if local_cutoff is None, within self.cutoff for the *_Cutoff
+        modes), and the remote segments enter through their stress at the node
+        position (SegStressFarField), cached until the next NodeForce.
+        """
+        G = DM.get_disnet(DisNet)
+        tags = [tuple(tag) for tag in tags]
+        if self.force_mode == 'LineTension' or not found_pydis_lib:
+            forces = [self.OneNodeForce(DM, state, tag, update_state=False) for tag in tags]
+        else:
+            forces = self.LocalNodeForces_Elasticity(G, state["applied_stress"], tags)
+        nodeforce_dict = dict(zip(tags, forces))
+        if update_state:
+            for tag, f in nodeforce_dict.items():
+                CalForce.store_node_force(state, tag, f)
+        return nodeforce_dict
+
+    def LocalNodeForces_Elasticity(self, G: DisNet, applied_stress: np.ndarray, tags: list) -> np.ndarray:
+        """LocalNodeForces_Elasticity: forces (len(tags),3) from external stress and elastic interactions
+        """
+        segs_data_with_positions = G.get_segs_data_with_positions(copy=False)
+        sub_nodes = G.nodes_index(tags)
+        positions = np.array([G.nodes(tag).R for tag in tags])
+
+        sigext = voigt_vector_to_tensor(applied_stress)
+        sub_stress = np.tile([sigext[0,0], sigext[1,1], sigext[2,2], sigext[0,1], sigext[1,2], sigext[0,2]],
+                             (len(tags), 1))
+        if self.force_mode.endswith('_Cutoff'):
+            cutoff = self.cutoff
+        elif self.local_cutoff is not None:
+            cutoff = self.local_cutoff
+            sub_stress += self.FarFieldStress(G, segs_data_with_positions, positions)
+        else:
+            cutoff = 0.0
+
+        if 'SBN1' in self.force_mode:
+            quad_points = np.array([-0.774596669241483, 0.0, 0.774596669241483])
+            weights = np.array([0.555555555555556, 0.888888888888889, 0.555555555555556])
+        else:
+            quad_points = weights = None
+
+        nodeforces, _ = compute_local_node_forces(
+            G.num_nodes(), segs_data_with_positions["nodeids"],
+            segs_data_with_positions["R1"], segs_data_with_positions["R2"],
+            segs_data_with_positions["burgers"], G.cell, cutoff, sub_nodes, sub_stress,
+            self.mu, self.nu, self.a, quad_points, weights)
+        return nodeforces
+
+    def FarFieldStress(self, G: DisNet, segs_data: dict, positions: np.ndarray) -> np.ndarray:
+        """FarFieldStress: stress (K,6) at the positions from the segments beyond self.local_cutoff
+
+        Positions already evaluated since the last NodeForce are taken from the cache,
+        the others are evaluated in one call
+        """
+        keys = [tuple(x) for x in positions]
+        missing = [i for i, key in enumerate(keys) if key not in self._far_stress]
+        if len(missing) > 0:
+            stress = compute_far_field_stress(
+                positions[missing], segs_data["R1"], segs_data["R2"], segs_data["burgers"],
+                G.cell, self.local_cutoff, self.mu, self.nu, self.a)
+            for i, sigma in zip(missing, stress):
+                self._far_stress[keys[i]] = sigma
+        return np.array([self._far_stress[key] for key in keys])
+
+    def MarkNodeForceObsolete(self, tags) -> None:
+        """MarkNodeForceObsolete: recompute the elastic forces of all segments
+        attached to the nodes in tags at the next incremental evaluation
+        """
+        self._obsolete_tags.update(tuple(tag) for tag in tags)
+
+    def CollectObsoleteNodes(self, state: dict) -> None:
+        """CollectObsoleteNodes: mark the nodes flagged NODE_RESET_FORCES in
+        state["nodeflag_dict"] (e.g. by remesh, collision or topology
+        operations) as obsolete and clear the flag
+        """
+        nodeflag_dict = state.get("nodeflag_dict")
+        if nodeflag_dict is None:
+            return
+        for tag, flag in nodeflag_dict.items():
+            if flag & DisNode.Flags.NODE_RESET_FORCES:
+                self._obsolete_tags.add(tuple(tag))
+                nodeflag_dict[tag] = flag & ~DisNode.Flags.NODE_RESET_FORCES
+
     def OneNodeForce_LineTension(self, G: DisNet, applied_stress: np.ndarray, tag) -> float:
         """OneNodeForce_LineTension: return force on one node from line tension
         """
@@ -190,14 +380,42 @@ class CalForce(CalForce_Base):
         return f
 
     def OneNodeForce_Elasticity_SBA(self, G: DisNet, applied_stress: np.ndarray, tag) -> float:
-        """OneNodeForce_Elasticity_SBA: return force on one node from line tension
+        """OneNodeForce_Elasticity_SBA: return force on one node from external stress and elastic interactions
+
+        Evaluated incrementally with respect to the previous force calculation,
+        or for the *_FMM modes as the local node force (see LocalNodeForces_Elasticity)
         """
-        raise NotImplementedError("OneNodeForce_Elasticity_SBA not implemented yet")
+        if self.force_mode.endswith('_FMM'):
+            return self.LocalNodeForces_Elasticity(G, applied_stress, [tuple(tag)])[0]
+        nodeforce_dict, _ = self.NodeForce_Elasticity_AllPairs(G, applied_stress, incremental=True)
+        return nodeforce_dict[tag]
 
     def OneNodeForce_Elasticity_SBN1_SBA(self, G: DisNet, applied_stress: np.ndarray, tag) -> float:
-        """OneNodeForce_Elasticity_SBN1_SBA: return force on one node from line tension
+        """OneNodeForce_Elasticity_SBN1_SBA: return force on one node from external stress and elastic interactions
+
+        Evaluated incrementally with respect to the previous force calculation,
+        or for the *_FMM modes as the local node force (see LocalNodeForces_Elasticity)
+        """
+        if self.force_mode.endswith('_FMM'):
+            return self.LocalNodeForces_Elasticity(G, applied_stress, [tuple(tag)])[0]
+        quad_points = np.array([-0.774596669241483, 0.0, 0.774596669241483])
+        weights = np.array([0.555555555555556, 0.888888888888889, 0.555555555555556])
+        nodeforce_dict, _ = self.NodeForce_Elasticity_AllPairs(G, applied_stress, quad_points, weights, incremental=True)
+        return nodeforce_dict[tag]
+
+    def OneNodeForce_Elasticity_SBA_Cutoff(self, G: DisNet, applied_stress: np.ndarray, tag) -> float:
+        """OneNodeForce_Elasticity_SBA_Cutoff: return force on one node from external stress and
+        elastic interactions of the segment pairs within self.cutoff (as NodeForce_Elasticity_SBA_Cutoff)
         """
-        raise NotImplementedError("OneNodeForce_Elasticity_SBN1_SBA not implemented yet")
+        nodeforce_dict, _ = self.NodeForce_Elasticity_SBA_Cutoff(G, applied_stress)
+        return nodeforce_dict[tag]
+
+    def OneNodeForce_Elasticity_SBN1_SBA_Cutoff(self, G: DisNet, applied_stress: np.ndarray, tag) -> float:
+        """OneNodeForce_Elasticity_SBN1_SBA_Cutoff: return force on one node from external stress and
+        elastic interactions of the segment pairs within self.cutoff (as NodeForce_Elasticity_SBN1_SBA_Cutoff)
+        """
+        nodeforce_dict, _ = self.NodeForce_Elasticity_SBN1_SBA_Cutoff(G, applied_stress)
+        return nodeforce_dict[tag]
 
     def NodeForce_LineTension(self, G: DisNet, applied_stress: np.ndarray) -> Tuple[dict, dict]:
         """NodeForce: return nodal forces from line tension in a dictionary
@@ -206,12 +424,25 @@ class CalForce(CalForce_Base):
         (from DDLab/src/segforcevec.m)
         Note: assuming G.seg_list already accounts for PBC
         """
-        segs_data_with_positions = G.get_segs_data_with_positions()
+        segs_data_with_positions = G.get_segs_data_with_positions(copy=False)
         Nseg = segs_data_with_positions["nodeids"].shape[0]
         source_tags = segs_data_with_positions["tag1"]
         target_tags = segs_data_with_positions["tag2"]
 
         sigext = voigt_vector_to_tensor(applied_stress)
+
+        if found_pydis_lib:
+            # segment and nodal forces in one call (LineTensionForce);
+            # nodeids index the nodes in the order of G.all_nodes_tags()
+            all_tags = list(G.all_nodes_tags())
+            fseg, fnode = compute_line_tension_force(
+                len(all_tags), segs_data_with_positions["nodeids"],
+                segs_data_with_positions["R1"], segs_data_with_positions["R2"],
+                segs_data_with_positions["burgers"], sigext, self.nu, self.Ec)
+            nodeforce_dict = dict(zip(all_tags, fnode))
+            segforce_dict = dict(zip(zip(map(tuple, source_tags), map(tuple, target_tags)), fseg))
+            return nodeforce_dict, segforce_dict
+
         fpk = pkforcevec(sigext, segs_data_with_positions)
         fs0, fs1 = selfforcevec_LineTension(self.mu, self.nu, self.Ec, segs_data_with_positions)
         fseg = np.hstack((fpk*0.5 + fs0, fpk*0.5 + fs1))
@@ -235,62 +466,7 @@ class CalForce(CalForce_Base):
         (from ParaDiS)
         Note: assuming G.get_segs_data_with_positions already accounts for PBC
         """
-        segs_data_with_positions = G.get_segs_data_with_positions()
-        Nseg = segs_data_with_positions["nodeids"].shape[0]
-        source_tags = segs_data_with_positions["tag1"]
-        target_tags = segs_data_with_positions["tag2"]
-        R1 = segs_data_with_positions["R1"]
-        R2 = segs_data_with_positions["R2"]
-        burg_vecs = segs_data_with_positions["burgers"]
-
-        sigext = voigt_vector_to_tensor(applied_stress)
-        fpk = pkforcevec(sigext, segs_data_with_positions)
-        fseg = np.hstack((fpk*0.5, fpk*0.5))
-
-        nodeforce_dict, segforce_dict = {}, {}
-        for tag in G.all_nodes_tags():
-            nodeforce_dict.update({tag: np.array([0.0,0.0,0.0])})
-        for i in range(Nseg):
-            tag1, tag2 = tuple(source_tags[i]), tuple(target_tags[i])
-            nodeforce_dict[tag1] += fseg[i, 0:3]
-            nodeforce_dict[tag2] += fseg[i, 3:6]
-
-        for i in range(Nseg):
-            for j in range(i, Nseg):
-                p1 = R1[i,:].copy()
-                p2 = R2[i,:].copy()
-                p3 = R1[j,:].copy()
-                p4 = R2[j,:].copy()
-                b12 = burg_vecs[i,:].copy()
-                b34 = burg_vecs[j,:].copy()
-
-                # apply PBC
-                p2 = G.cell.closest_image(Rref=p1, R=p2)
-                p3 = G.cell.closest_image(Rref=p1, R=p3)
-                p4 = G.cell.closest_image(Rref=p3, R=p4)
-                f1, f2, f3, f4 = compute_segseg_force(p1, p2, p3, p4, b12, b34, self.mu, self.nu, self.a)
-                tag1, tag2 = tuple(source_tags[i]), tuple(target_tags[i])
-                tag3, tag4 = tuple(source_tags[j]), tuple(target_tags[j])
-                if i == j:
-                    fseg[i, 0:3] += f1
-                    fseg[i, 3:6] += f2
-                    nodeforce_dict[tag1] += f1
-                    nodeforce_dict[tag2] += f2
-                else:
-                    fseg[i, 0:3] += f1
-                    fseg[i, 3:6] += f2
-                    fseg[j, 0:3] += f3
-                    fseg[j, 3:6] += f4
-                    nodeforce_dict[tag1] += f1
-                    nodeforce_dict[tag2] += f2
-                    nodeforce_dict[tag3] += f3
-                    nodeforce_dict[tag4] += f4
-
-        for i in range(Nseg):
-            tag1, tag2 = tuple(source_tags[i]), tuple(target_tags[i])
-            segforce_dict[(tag1, tag2)] = fseg[i, :]
-
-        return nodeforce_dict, segforce_dict
+        return self.NodeForce_Elasticity_AllPairs(G, applied_stress)
 
     def NodeForce_Elasticity_SBN1_SBA(self, G: DisNet, applied_stress: np.ndarray) -> Tuple[dict, dict]:
         """NodeForce: return nodal forces from external stress and elastic interactions
@@ -298,67 +474,291 @@ class CalForce(CalForce_Base):
         (from ParaDiS)
         Note: assuming G.seg_list already accounts for PBC
         """
-        segs_data_with_positions = G.get_segs_data_with_positions()
-        Nseg = segs_data_with_positions["nodeids"].shape[0]
-        source_tags = segs_data_with_positions["tag1"]
-        target_tags = segs_data_with_positions["tag2"]
-        R1 = segs_data_with_positions["R1"]
-        R2 = segs_data_with_positions["R2"]
-        burg_vecs = segs_data_with_positions["burgers"]
-
         # To do: need to run test case for this function
-        sigext = voigt_vector_to_tensor(applied_stress)
-        fpk = pkforcevec(sigext, segs_data_with_positions)
-        fseg = np.hstack((fpk*0.5, fpk*0.5))
+        """ hardcode force_nint = 3
+        """
+        quad_points = np.array([-0.774596669241483, 0.0, 0.774596669241483])
+        weights = np.array([0.555555555555556, 0.888888888888889, 0.555555555555556])
+        return self.NodeForce_Elasticity_AllPairs(G, applied_stress, quad_points, weights)
 
-        nodeforce_dict, segforce_dict = {}, {}
-        for tag in G.all_nodes_tags():
-            nodeforce_dict.update({tag: np.array([0.0,0.0,0.0])})
-        for i in range(Nseg):
-            tag1, tag2 = tuple(source_tags[i]), tuple(target_tags[i])
-            nodeforce_dict[tag1] += fseg[i, 0:3]
-            nodeforce_dict[tag2] += fseg[i, 3:6]
+    def NodeForce_Elasticity_SBA_Cutoff(self, G: DisNet, applied_stress: np.ndarray) -> Tuple[dict, dict]:
+        """NodeForce: same as NodeForce_Elasticity_SBA but only for segment pairs within self.cutoff
+        """
+        return self.NodeForce_Elasticity_AllPairs(G, applied_stress, cutoff=self.cutoff)
 
-        """ hardcode force_nint = 3
+    def NodeForce_Elasticity_SBN1_SBA_Cutoff(self, G: DisNet, applied_stress: np.ndarray) -> Tuple[dict, dict]:
+        """NodeForce: same as NodeForce_Elasticity_SBN1_SBA but only for segment pairs within self.cutoff
         """
         quad_points = np.array([-0.774596669241483, 0.0, 0.774596669241483])
         weights = np.array([0.555555555555556, 0.888888888888889, 0.555555555555556])
-        print('quad_points = ', quad_points)
-        print('weights = ', weights)
+        return self.NodeForce_Elasticity_AllPairs(G, applied_stress, quad_points, weights, cutoff=self.cutoff)
 
-        for i in range(Nseg):
-            for j in range(i, Nseg):
-                p1 = R1[i,:].copy()
-                p2 = R2[i,:].copy()
-                p3 = R1[j,:].copy()
-                p4 = R2[j,:].copy()
-                b12 = burg_vecs[i,:].copy()
-                b34 = burg_vecs[j,:].copy()
-
-                # apply PBC
-                p2 = G.cell.closest_image(Rref=p1, R=p2)
-                p3 = G.cell.closest_image(Rref=p1, R=p3)
-                p4 = G.cell.closest_image(Rref=p3, R=p4)
-                f1, f2, f3, f4 = compute_segseg_force_SBN1_SBA(p1, p2, p3, p4, b12, b34, self.mu, self.nu, self.a, quad_points, weights)
-                tag1, tag2 = tuple(source_tags[i]), tuple(target_tags[i])
-                tag3, tag4 = tuple(source_tags[j]), tuple(target_tags[j])
-                if i == j:
-                    fseg[i, 0:3] += f1
-                    fseg[i, 3:6] += f2
-                    nodeforce_dict[tag1] += f1
-                    nodeforce_dict[tag2] += f2
-                else:
-                    fseg[i, 0:3] += f1
-                    fseg[i, 3:6] += f2
-                    fseg[j, 0:3] += f3
-                    fseg[j, 3:6] += f4
-                    nodeforce_dict[tag1] += f1
-                    nodeforce_dict[tag2] += f2
-                    nodeforce_dict[tag3] += f3
-                    nodeforce_dict[tag4] += f4
+    def FMMCorrectionTable(self, cell) -> np.ndarray:
+        """FMMCorrectionTable: periodic image correction table of the FMM modes
 
-        for i in range(Nseg):
+        None unless fm_pbc_images is set; kept until the cell changes.
+        """
+        if self.fm_pbc_images is None:
+            return None
+        h = np.array(cell.h, dtype=np.float64)
+        if self._fm_corr is None or not np.array_equal(self._fm_corr[0], h):
+            table = fmm_correction_table(cell, self.a, self.fm_mp_order, self.fm_taylor_order,
+                                         self.fm_pbc_images, self.fm_correction_dir)
+            self._fm_corr = (h, table)
+        return self._fm_corr[1]
+
+    def NodeForce_Elasticity_SBA_FMM(self, G: DisNet, applied_stress: np.ndarray) -> Tuple[dict, dict]:
+        """NodeForce: same as NodeForce_Elasticity_SBA with remote interactions from the fast multipole method
+        """
+        return self.NodeForce_Elasticity_AllPairs(G, applied_stress, fmm=True)
+
+    def NodeForce_Elasticity_AllPairs(self, G: DisNet, applied_stress: np.ndarray,
+                                      quad_points: np.ndarray=None, weights: np.ndarray=None,
+                                      cutoff: float=None, fmm: bool=False,
+                                      incremental: bool=None) -> Tuple[dict, dict]:
+        """NodeForce_Elasticity_AllPairs: nodal forces from external stress and all segment pairs
+
+        The pair loop runs in libpydis (SegSegForceAllPairs, OpenMP parallel).
+        SBN1_SBA is used if quad_points and weights are given, SBA otherwise.
+        If cutoff is given, only segment pairs within cutoff are evaluated
+        using a cell list (SegSegForceCellList), or the pairs of a Verlet list
+        kept across steps if self.verlet_skin is set (SegSegForcePairList).
+        If fmm is set, remote interactions are computed with the fast
+        multipole method (SegSegForceFMM), with the periodic images beyond
+        the closest ones if self.fm_pbc_images is set.
+        If self.frozen_tol is set, incremental is not given and neither
+        cutoff nor fmm is, the pairs of frozen segments are reused from a
+        cache (see ElasticSegForces_FrozenPairs).
+        If incremental (default: self.incremental) is set and neither cutoff
+        nor fmm is given, the forces are updated from the previous evaluation
+        (see ElasticSegForces_Incremental).
+        Otherwise, if self.use_device is set, the pairs are evaluated on the
+        device backend (SegSegForceDevice), or if self.batcher is set,
+        together with the pairs of the other networks of the ensemble.
+        If self.decomp is set (and fmm is not), each MPI rank evaluates the
+        segments of its domain (DomainDecompSegForces) and the forces are
+        summed over the ranks.
+        """
+        segs_data_with_positions = G.get_segs_data_with_positions(copy=False)
+        source_tags = segs_data_with_positions["tag1"]
+        target_tags = segs_data_with_positions["tag2"]
+
+        sigext = voigt_vector_to_tensor(applied_stress)
+        fpk = pkforcevec(sigext, segs_data_with_positions)
+
+        # nodeids index the nodes in the order of G.all_nodes_tags()
+        all_tags = list(G.all_nodes_tags())
+        segs_args = (len(all_tags), segs_data_with_positions["nodeids"],
+                     segs_data_with_positions["R1"], segs_data_with_positions["R2"],
+                     segs_data_with_positions["burgers"], G.cell)
+        if fmm:
+            fseg_elastic, fnode_elastic = compute_segseg_force_fmm(
+                *segs_args, self.mu, self.nu, self.a,
+                self.fm_num_layers, self.fm_mp_order, self.fm_taylor_order,
+                quad_points=quad_points, weights=weights,
+                corr_table=self.FMMCorrectionTable(G.cell))
+        elif self.decomp is not None:
+            fseg_elastic, fnode_elastic = self.decomp.elastic_forces(
+                *segs_args, cutoff, self.mu, self.nu, self.a, quad_points, weights)
+        elif cutoff is None and self.frozen_tol is not None and incremental is None:
+            fseg_elastic = self.ElasticSegForces_FrozenPairs(
+                G, segs_data_with_positions, quad_points, weights)
+            nodeids = segs_data_with_positions["nodeids"]
+            fnode_elastic = np.zeros((len(all_tags), 3))
+            np.add.at(fnode_elastic, nodeids[:,0], fseg_elastic[:,0:3])
+            np.add.at(fnode_elastic, nodeids[:,1], fseg_elastic[:,3:6])
+        elif cutoff is None and (self.incremental if incremental is None else incremental):
+            fseg_elastic = self.ElasticSegForces_Incremental(
+                segs_data_with_positions, G.cell, quad_points, weights)
+            nodeids = segs_data_with_positions["nodeids"]
+            fnode_elastic = np.zeros((len(all_tags), 3))
+            np.add.at(fnode_elastic, nodeids[:,0], fseg_elastic[:,0:3])
+            np.add.at(fnode_elastic, nodeids[:,1], fseg_elastic[:,3:6])
+        elif cutoff is None and self.use_device:
+            if self._device is None:
+                self._device = segseg_force_device_create(self.device_id)
+            fseg_elastic, fnode_elastic = compute_segseg_force_device(
+                self._device, *segs_args, self.mu, self.nu, self.a, quad_points, weights)
+        elif cutoff is None and self.batcher is not None:
+            fseg_elastic, fnode_elastic = self.batcher.evaluate(
+                *segs_args, self.mu, self.nu, self.a, quad_points, weights)
+        elif cutoff is None:
+            fseg_elastic, fnode_elastic = compute_segseg_force_all_pairs(
+                *segs_args, self.mu, self.nu, self.a, quad_points, weights, mixed=self._mixed)
+        elif self.verlet_skin is not None:
+            if self._verlet is None:
+                self._verlet = VerletList(cell=G.cell, cutoff=cutoff, skin=self.verlet_skin)
+            self._verlet.cell = G.cell
+            pairs = self._verlet.get_segment_pairs(segs_data_with_positions, cutoff)
+            fseg_elastic, fnode_elastic = compute_segseg_force_pair_list(
+                *segs_args, pairs, self.mu, self.nu, self.a, quad_points, weights, mixed=self._mixed)
+        else:
+            fseg_elastic, fnode_elastic, _ = compute_segseg_force_cell_list(
+                *segs_args, cutoff, self.mu, self.nu, self.a, quad_points, weights, mixed=self._mixed)
+        fseg = np.hstack((fpk*0.5, fpk*0.5)) + fseg_elastic
+
+        nodeforce_dict, segforce_dict = {}, {}
+        for i, tag in enumerate(all_tags):
+            nodeforce_dict[tag] = fnode_elastic[i].copy()
+        for i in range(fseg.shape[0]):
             tag1, tag2 = tuple(source_tags[i]), tuple(target_tags[i])
+            nodeforce_dict[tag1] += fpk[i]*0.5
+            nodeforce_dict[tag2] += fpk[i]*0.5
             segforce_dict[(tag1, tag2)] = fseg[i, :]
 
         return nodeforce_dict, segforce_dict
+
+    def ElasticSegForces_Incremental(self, segs_data: dict, cell, quad_points: np.ndarray=None,
+                                     weights: np.ndarray=None, max_fraction: float=0.5) -> np.ndarray:
+        """ElasticSegForces_Incremental: elastic segment forces (Nseg,6) updated from the previous evaluation
+
+        A segment is obsolete if it is new, if its end positions or Burgers
+        vector changed, or if one of its nodes was marked obsolete
+        (MarkNodeForceObsolete / NODE_RESET_FORCES).  The contributions of
+        the pairs involving an obsolete segment of the previous network are
+        subtracted and those involving an obsolete segment of the current
+        network are added (SegSegForceSubset), so that only these pairs are
+        evaluated.  Falls back to a full evaluation if the obsolete segments
+        of both networks exceed max_fraction of the current segments.
+        """
+        tag1, tag2 = segs_data["tag1"], segs_data["tag2"]
+        R1, R2, burgers = segs_data["R1"], segs_data["R2"], segs_data["burgers"]
+        keys = [(tuple(t1), tuple(t2)) for t1, t2 in zip(tag1, tag2)]
+        nseg = len(keys)
+        Nint = 0 if quad_points is None else len(quad_points)
+        obsolete_tags, self._obsolete_tags = self._obsolete_tags, set()
+
+        cache = self._elastic_cache
+        fseg = None
+        if cache is not None and cache["Nint"] == Nint and nseg > 0:
+            old_idx = np.array([cache["index"].get(key, -1) for key in keys], dtype=int)
+            same = old_idx >= 0
+            j = old_idx[same]
+            same[same] = np.all((R1[same] == cache["R1"][j]) & (R2[same] == cache["R2"][j]) &
+                                (burgers[same] == cache["burgers"][j]), axis=1)
+            if obsolete_tags:
+                touched = np.array([key[0] in obsolete_tags or key[1] in obsolete_tags for key in keys])
+                same &= ~touched
+            new_changed = np.where(~same)[0]
+            old_keep = np.zeros(cache["R1"].shape[0], dtype=bool)
+            old_keep[old_idx[same]] = True
+            old_changed = np.where(~old_keep)[0]
+
+            if new_changed.size + old_changed.size <= max_fraction * nseg:
+                fseg = np.zeros((nseg, 6))
+                fseg[same] = cache["fseg"][old_idx[same]]
+                if old_changed.size > 0:
+                    fold, _ = compute_segseg_force_subset(
+                        cache["R1"], cache["R2"], cache["burgers"], cell, old_changed,
+                        self.mu, self.nu, self.a, quad_points, weights, mixed=self._mixed)
+                    fseg[same] -= fold[old_idx[same]]
+                if new_changed.size > 0:
+                    fnew, _ = compute_segseg_force_subset(
+                        R1, R2, burgers, cell, new_changed,
+                        self.mu, self.nu, self.a, quad_points, weights, mixed=self._mixed)
+                    fseg += fnew
+
+        if fseg is None:
+            fseg, _ = compute_segseg_force_subset(
+                R1, R2, burgers, cell, np.arange(nseg),
+                self.mu, self.nu, self.a, quad_points, weights, mixed=self._mixed)
+
+        self._elastic_cache = {
+            "Nint": Nint,
+            "index": {key: i for i, key in enumerate(keys)},
+            "R1": R1.copy(), "R2": R2.copy(), "burgers": burgers.copy(),
+            "fseg": fseg.copy()
+        }
+        return fseg
+
+    def ElasticSegForces_FrozenPairs(self, G: DisNet, segs_data: dict, quad_points: np.ndarray=None,
+                                     weights: np.ndarray=None, max_fraction: float=0.5) -> np.ndarray:
+        """ElasticSegForces_FrozenPairs: elastic segment forces (Nseg,6) reusing the pairs of frozen segments
+
+        A segment is frozen while its end nodes moved less than
+        self.frozen_tol since the pair cache was built, its Burgers vector
+        did not change and none of its nodes was marked obsolete
+        (MarkNodeForceObsolete / NODE_RESET_FORCES).  The contributions of
+        the pairs of two frozen segments are cached, summed per segment and
+        evaluated at the cached positions, and only the pairs involving an
+        active segment are evaluated (SegSegForceSubset).  When a segment
+        stops being frozen, its pairs with the other frozen segments are
+        subtracted from the cache.  The cache is rebuilt, freezing the
+        segments between two pinned nodes and those that moved less than
+        frozen_tol since the previous evaluation, when the active segments
+        exceed max_fraction of the current segments.
+        """
+        tag1, tag2 = segs_data["tag1"], segs_data["tag2"]
+        R1, R2, burgers = segs_data["R1"], segs_data["R2"], segs_data["burgers"]
+        keys = [(tuple(t1), tuple(t2)) for t1, t2 in zip(tag1, tag2)]
+        nseg = len(keys)
+        Nint = 0 if quad_points is None else len(quad_points)
+        tol = self.frozen_tol
+        obsolete_tags, self._obsolete_tags = self._obsolete_tags, set()
+        touched = np.zeros(nseg, dtype=bool)
+        if obsolete_tags:
+            touched[:] = [key[0] in obsolete_tags or key[1] in obsolete_tags for key in keys]
+
+        def unmoved(ref: dict) -> np.ndarray:
+            # segments matching a segment of ref with the same Burgers vector
+            # and end positions within tol, and their index in ref
+            idx = np.array([ref["index"].get(key, -1) for key in keys], dtype=int)
+            same = idx >= 0
+            j = idx[same]
+            same[same] = np.all(burgers[same] == ref["burgers"][j], axis=1) & \
+                (np.max(np.abs(R1[same] - ref["R1"][j]), axis=1) < tol) & \
+                (np.max(np.abs(R2[same] - ref["R2"][j]), axis=1) < tol)
+            return same & ~touched, idx
+
+        cache = self._pair_cache
+        fseg = None
+        if cache is not None and cache["Nint"] == Nint and nseg > 0:
+            frozen, old_idx = unmoved(cache)
+            frozen[frozen] = cache["frozen"][old_idx[frozen]]
+            active = np.where(~frozen)[0]
+            if active.size <= max_fraction * nseg:
+                kept = np.zeros(cache["frozen"].size, dtype=bool)
+                kept[old_idx[frozen]] = True
+                leaving = np.where(cache["frozen"] & ~kept)[0]
+                if leaving.size > 0:
+                    fz = np.where(cache["frozen"])[0]
+                    rank = np.cumsum(cache["frozen"]) - 1
+                    fold, _ = compute_segseg_force_subset(
+                        cache["R1"][fz], cache["R2"][fz], cache["burgers"][fz], G.cell, rank[leaving],
+                        self.mu, self.nu, self.a, quad_points, weights, mixed=self._mixed)
+                    cache["ffrozen"][fz] -= fold
+                    cache["frozen"][leaving] = False
+                fseg, _ = compute_segseg_force_subset(
+                    R1, R2, burgers, G.cell, active,
+                    self.mu, self.nu, self.a, quad_points, weights, mixed=self._mixed)
+                fseg[frozen] += cache["ffrozen"][old_idx[frozen]]
+
+        if fseg is None:
+            nodes_data, _ = G.get_nodes_data(copy=False)
+            pinned = nodes_data["constraints"].ravel() == DisNode.Constraints.PINNED_NODE
+            nodeids = segs_data["nodeids"]
+            frozen = pinned[nodeids[:,0]] & pinned[nodeids[:,1]] & ~touched
+            if self._pair_prev is not None:
+                frozen |= unmoved(self._pair_prev)[0]
+            fz, active = np.where(frozen)[0], np.where(~frozen)[0]
+            ffrozen = np.zeros((nseg, 6))
+            if fz.size > 0:
+                ffrozen[fz], _ = compute_segseg_force_subset(
+                    R1[fz], R2[fz], burgers[fz], G.cell, np.arange(fz.size),
+                    self.mu, self.nu, self.a, quad_points, weights, mixed=self._mixed)
+            fseg, _ = compute_segseg_force_subset(
+                R1, R2, burgers, G.cell, active,
+                self.mu, self.nu, self.a, quad_points, weights, mixed=self._mixed)
+            fseg[fz] += ffrozen[fz]
+            self._pair_cache = {
+                "Nint": Nint,
+                "index": {key: i for i, key in enumerate(keys)},
+                "R1": R1.copy(), "R2": R2.copy(), "burgers": burgers.copy(),
+                "frozen": frozen, "ffrozen": ffrozen
+            }
+
+        self._pair_prev = {
+            "index": {key: i for i, key in enumerate(keys)},
+            "R1": R1.copy(), "R2": R2.copy(), "burgers": burgers.copy()
+        }
+        return fseg
@@ -1,5 +1,5 @@
 import numpy as np
-from ctypes import c_double
+from ctypes import c_double, POINTER
 real8 = c_double
 
 try:
@@ -9,6 +9,12 @@ except ImportError:
     found_pydis = False
     raise
 
+# buffer protocol bindings releasing the GIL (pydis_ext.c), optional
+try:
+    pydis_ext = __import__('pydis_ext')
+except ImportError:
+    pydis_ext = None
+
 
 def compute_seg_stress_coord_dep(p1, p2, b, x, mu, nu, a):
     """
@@ -56,3 +62,49 @@ def compute_seg_stress_coord_indep(p1, p2, b, x, mu, nu, a):
     sigma[2,0] = sigma_vec[5]
 
     return np.array(sigma)
+
+def voigt_to_tensor(stress):
+    """
+    convert (...,6) stresses in the order xx, yy, zz, xy, yz, xz to (...,3,3)
+    """
+    stress = np.asarray(stress)
+    sigma = np.empty(stress.shape[:-1] + (3, 3))
+    sigma[...,0,0] = stress[...,0]
+    sigma[...,1,1] = stress[...,1]
+    sigma[...,2,2] = stress[...,2]
+    sigma[...,0,1] = sigma[...,1,0] = stress[...,3]
+    sigma[...,1,2] = sigma[...,2,1] = stress[...,4]
+    sigma[...,0,2] = sigma[...,2,0] = stress[...,5]
+    return sigma
+
+def compute_segs_stress_at_points(p1, p2, b, x, mu, nu, a, coord_dep=False, stress=None):
+    """
+    stress of the M dislocation segments from p1[j] to p2[j] with Burgers
+    vectors b[j] (each (M,3)) summed at the K field points x (K,3)
+    returns a (K,6) array in the order xx, yy, zz, xy, yz, xz
+    if stress is given (C-contiguous float64 (K,6)), the segment stress is
+    added to it in place
+    """
+    p1 = np.ascontiguousarray(p1, dtype=np.float64).reshape(-1, 3)
+    p2 = np.ascontiguousarray(p2, dtype=np.float64).reshape(-1, 3)
+    b = np.ascontiguousarray(b, dtype=np.float64).reshape(-1, 3)
+    x = np.ascontiguousarray(x, dtype=np.float64).reshape(-1, 3)
+    if stress is None:
+        stress = np.zeros((x.shape[0], 6))
+    elif stress.shape != (x.shape[0], 6) or stress.dtype != np.float64 or not stress.flags['C_CONTIGUOUS']:
+        raise ValueError("stress must be a C-contiguous float64 array of shape (%d,6)" % x.shape[0])
+
+    if pydis_ext is not None:
+        pydis_ext.seg_stress_at_points(x, p1, p2, b, a, mu, nu, coord_dep, stress)
+        return stress
+
+    ptr = lambda arr: arr.ctypes.data_as(POINTER(real8))
+    pydis_lib.SegStressAtPoints(
+        x.shape[0], ptr(x),
+        p1.shape[0], ptr(p1), ptr(p2), ptr(b),
+        *(a, mu, nu),
+        1 if coord_dep else 0,
+        ptr(stress)
+    )
+
+    return stress
@@ -1,5 +1,5 @@
 import numpy as np
-from ctypes import c_double
+from ctypes import c_double, c_int, POINTER, byref
 real8 = c_double
 
 try:
@@ -9,6 +9,24 @@ except ImportError:
     found_pydis = False
     raise
 
+# buffer protocol bindings releasing the GIL (pydis_ext.c), optional
+try:
+    pydis_ext = __import__('pydis_ext')
+except ImportError:
+    pydis_ext = None
+
+def _as_real8_array(x):
+    """
+    return x as a C-contiguous float64 (N,3) array, without copying if possible
+    """
+    return np.ascontiguousarray(x, dtype=np.float64).reshape(-1, 3)
+
+def _real8_ptr(x):
+    return x.ctypes.data_as(POINTER(real8))
+
+def _int_ptr(x):
+    return x.ctypes.data_as(POINTER(c_int))
+
 def compute_segseg_force_SBN1(p1, p2, p3, p4, b1, b2, mu, nu, a, quad_points, weights, seg12local=1, seg34local=1):
     """
     dislocation segment from p1 to p2 with Burgers vector b1
@@ -81,23 +99,47 @@ def compute_segseg_force_SBN1_SBA(p1, p2, p3, p4, b1, b2, mu, nu, a, quad_points
 
     return f1, f2, f3, f4
 
-# a vectorized version of the above function compute_segseg_force
+# a vectorized version of the above function compute_segseg_force_SBN1
 def compute_segseg_force_SBN1_vec(
-    p1_list, p2_list, p3_list, p4_list, b1_list, b2_list, mu, nu, a, quad_points, weights
+    p1_list, p2_list, p3_list, p4_list, b1_list, b2_list, mu, nu, a, quad_points, weights,
+    seg12local=1, seg34local=1
 ):
-    f1_list = np.empty_like(p1_list)
-    f2_list = np.empty_like(p2_list)
-    f3_list = np.empty_like(p3_list)
-    f4_list = np.empty_like(p4_list)
+    p1, p2, p3, p4, b1, b2 = (_as_real8_array(x) for x in (p1_list, p2_list, p3_list, p4_list, b1_list, b2_list))
+    quad_points = np.ascontiguousarray(quad_points, dtype=np.float64)
+    weights = np.ascontiguousarray(weights, dtype=np.float64)
+    npairs = p1.shape[0]
+    f1, f2, f3, f4 = (np.empty((npairs, 3)) for _ in range(4))
+    pydis_lib.SegSegForce_SBN1_Batch(
+        npairs,
+        *(_real8_ptr(x) for x in (p1, p2, p3, p4, b1, b2)),
+        *(a, mu, nu),
+        *(quad_points.shape[0], _real8_ptr(quad_points), _real8_ptr(weights)),
+        *(seg12local, seg34local),
+        *(_real8_ptr(x) for x in (f1, f2, f3, f4)),
+    )
 
-    for ii, (p1, p2, p3, p4, b1, b2) in enumerate(
-        zip(p1_list, p2_list, p3_list, p4_list, b1_list, b2_list)
-    ):
-        f1_list[ii], f2_list[ii], f3_list[ii], f4_list[ii] = compute_segseg_force_SBN1(
-            p1, p2, p3, p4, b1, b2, mu, nu, a, quad_points, weights
-        )
+    return f1, f2, f3, f4
 
-    return f1_list, f2_list, f3_list, f4_list
+# a vectorized version of the above function compute_segseg_force_SBN1_SBA
+def compute_segseg_force_SBN1_SBA_vec(
+    p1_list, p2_list, p3_list, p4_list, b1_list, b2_list, mu, nu, a, quad_points, weights,
+    seg12local=1, seg34local=1
+):
+    p1, p2, p3, p4, b1, b2 = (_as_real8_array(x) for x in (p1_list, p2_list, p3_list, p4_list, b1_list, b2_list))
+    quad_points = np.ascontiguousarray(quad_points, dtype=np.float64)
+    weights = np.ascontiguousarray(weights, dtype=np.float64)
+    npairs = p1.shape[0]
+    f1, f2, f3, f4 = (np.empty((npairs, 3)) for _ in range(4))
+    pydis_lib.SegSegForce_SBN1_SBA_Batch(
+        npairs,
+        *(_real8_ptr(x) for x in (p1, p2, p3, p4, b1, b2)),
+        *(a, mu, nu),
+        *(quad_points.shape[0], _real8_ptr(quad_points), _real8_ptr(weights)),
+        *(seg12local, seg34local),
+        *(_real8_ptr(x) for x in (f1, f2, f3, f4)),
+    )
+
+    return f1, f2, f3, f4
 
 def compute_segseg_force(p1, p2, p3, p4, b1, b2, mu, nu, a, seg12local=1, seg34local=1):
     """
@@ -133,24 +175,6 @@ def compute_segseg_force(p1, p2, p3, p4, b1, b2, mu, nu, a, seg12local=1, seg34l
 
 
 # a vectorized version of the above function compute_segseg_force
-def compute_segseg_force_vec(
-    p1_list, p2_list, p3_list, p4_list, b1_list, b2_list, mu, nu, a
-):
-    f1_list = np.empty_like(p1_list)
-    f2_list = np.empty_like(p2_list)
-    f3_list = np.empty_like(p3_list)
-    f4_list = np.empty_like(p4_list)
-
-    for ii, (p1, p2, p3, p4, b1, b2) in enumerate(
-        zip(p1_list, p2_list, p3_list, p4_list, b1_list, b2_list)
-    ):
-        f1_list[ii], f2_list[ii], f3_list[ii], f4_list[ii] = compute_segseg_force(
-            p1, p2, p3, p4, b1, b2, mu, nu, a
-        )
-
-    return f1_list, f2_list, f3_list, f4_list
-
-
 def compute_segseg_force_vec(
     p1_list,
     p2_list,
@@ -164,16 +188,471 @@ def compute_segseg_force_vec(
     seg12local=1,
     seg34local=1,
 ):
-    f1 = np.empty_like(p1_list)
-    f2 = np.empty_like(p2_list)
-    f3 = np.empty_like(p3_list)
-    f4 = np.empty_like(p4_list)
-
-    for ii, (p1, p2, p3, p4, b1, b2) in enumerate(
-        zip(p1_list, p2_list, p3_list, p4_list, b1_list, b2_list)
-    ):
-        f1[ii], f2[ii], f3[ii], f4[ii] = compute_segseg_force(
-            p1, p2, p3, p4, b1, b2, mu, nu, a, seg12local, seg34local
-        )
+    p1, p2, p3, p4, b1, b2 = (_as_real8_array(x) for x in (p1_list, p2_list, p3_list, p4_list, b1_list, b2_list))
+    npairs = p1.shape[0]
+    f1, f2, f3, f4 = (np.empty((npairs, 3)) for _ in range(4))
+    pydis_lib.SegSegForceBatch(
+        npairs,
+        *(_real8_ptr(x) for x in (p1, p2, p3, p4, b1, b2)),
+        *(a, mu, nu),
+        *(seg12local, seg34local),
+        *(_real8_ptr(x) for x in (f1, f2, f3, f4)),
+    )
 
     return f1, f2, f3, f4
+
+
+def _segseg_driver_arrays(nodeids, R1, R2, burgers, cell, quad_points, weights):
+    """
+    contiguous arrays shared by the segment/segment force drivers, in the
+    argument order of pydis_ext (quad_points and weights None for SBA)
+    """
+    nodeids = np.ascontiguousarray(nodeids, dtype=np.intc).reshape(-1, 2)
+    R1, R2, burgers = (_as_real8_array(x) for x in (R1, R2, burgers))
+    h = np.ascontiguousarray(cell.h, dtype=np.float64)
+    hinv = np.ascontiguousarray(cell.hinv, dtype=np.float64)
+    is_periodic = np.ascontiguousarray(cell.is_periodic, dtype=np.intc)
+    if quad_points is not None:
+        quad_points = np.ascontiguousarray(quad_points, dtype=np.float64)
+        weights = np.ascontiguousarray(weights, dtype=np.float64)
+    return (nodeids, R1, R2, burgers, h, hinv, is_periodic), (quad_points, weights)
+
+def _segseg_driver_args(nodeids, R1, R2, burgers, cell, quad_points, weights):
+    """
+    ctypes arguments shared by the SegSegForceAllPairs / SegSegForceCellList drivers
+    """
+    (nodeids, R1, R2, burgers, h, hinv, is_periodic), (quad_points, weights) = \
+        _segseg_driver_arrays(nodeids, R1, R2, burgers, cell, quad_points, weights)
+    if quad_points is None:
+        Nint = 0
+        quad_points = weights = np.zeros(1)
+    else:
+        Nint = quad_points.shape[0]
+    # keep references to the converted arrays alive together with their pointers
+    keep = (nodeids, R1, R2, burgers, h, hinv, is_periodic, quad_points, weights)
+    geom = (_int_ptr(nodeids),
+            *(_real8_ptr(x) for x in (R1, R2, burgers, h, hinv)),
+            _int_ptr(is_periodic))
+    quad = (Nint, _real8_ptr(quad_points), _real8_ptr(weights))
+    return nodeids.shape[0], geom, quad, keep
+
+def compute_segseg_force_all_pairs(num_nodes, nodeids, R1, R2, burgers, cell, mu, nu, a, quad_points=None, weights=None,
+                                   mixed=None):
+    """
+    elastic interaction forces among all segments (including self forces)
+    segment i goes from R1[i] (node nodeids[i,0]) to R2[i] (node nodeids[i,1])
+    SBN1_SBA is used if quad_points and weights are given, SBA otherwise
+    mixed: precision policy of the SBA pairs (mixed_precision_policy) or None
+    returns segforces (Nseg,6) and nodeforces (num_nodes,3)
+    """
+    if pydis_ext is not None and mixed is None:
+        geom, quad = _segseg_driver_arrays(nodeids, R1, R2, burgers, cell, quad_points, weights)
+        segforces = np.empty((geom[0].shape[0], 6))
+        nodeforces = np.empty((num_nodes, 3))
+        pydis_ext.segseg_force_all_pairs(num_nodes, *geom, a, mu, nu, *quad, segforces, nodeforces)
+        return segforces, nodeforces
+
+    nseg, geom, quad, keep = _segseg_driver_args(nodeids, R1, R2, burgers, cell, quad_points, weights)
+    segforces = np.empty((nseg, 6))
+    nodeforces = np.empty((num_nodes, 3))
+    pydis_lib.SegSegForceAllPairs(
+        num_nodes, nseg, *geom,
+        *(a, mu, nu), *quad, _mixed_ptr(mixed),
+        _real8_ptr(segforces), _real8_ptr(nodeforces),
+    )
+
+    return segforces, nodeforces
+
+def compute_segseg_force_all_pairs_multi(num_nodes, seg_offset, nodeids, R1, R2, burgers, cell, mu, nu, a,
+                                         quad_points=None, weights=None, mixed=None):
+    """
+    same as compute_segseg_force_all_pairs for several networks stored one
+    after the other: the segments seg_offset[n]:seg_offset[n+1] form network
+    n, nodeids index the nodes of all networks, and only the pairs within
+    each network are evaluated (SegSegForceAllPairsMulti)
+    returns segforces (Nseg,6) and nodeforces (num_nodes,3)
+    """
+    seg_offset = np.ascontiguousarray(seg_offset, dtype=np.intc).reshape(-1)
+    if pydis_ext is not None and mixed is None:
+        geom, quad = _segseg_driver_arrays(nodeids, R1, R2, burgers, cell, quad_points, weights)
+        segforces = np.empty((geom[0].shape[0], 6))
+        nodeforces = np.empty((num_nodes, 3))
+        pydis_ext.segseg_force_all_pairs_multi(num_nodes, seg_offset, *geom, a, mu, nu, *quad,
+                                               segforces, nodeforces)
+        return segforces, nodeforces
+
+    nseg, geom, quad, keep = _segseg_driver_args(nodeids, R1, R2, burgers, cell, quad_points, weights)
+    segforces = np.empty((nseg, 6))
+    nodeforces = np.empty((num_nodes, 3))
+    pydis_lib.SegSegForceAllPairsMulti(
+        num_nodes, nseg, seg_offset.shape[0] - 1, _int_ptr(seg_offset), *geom,
+        *(a, mu, nu), *quad, _mixed_ptr(mixed),
+        _real8_ptr(segforces), _real8_ptr(nodeforces),
+    )
+
+    return segforces, nodeforces
+
+def mixed_precision_policy(distance, check=False):
+    """
+    precision policy of the analytic segment/segment force drivers
+    (SegSegMixed_t in libpydis), to pass as mixed to the driver wrappers:
+    pairs whose midpoints are farther apart than distance (and
+    SEGSEG_FAR_RATIO times the longer segment) are evaluated in single
+    precision, all others in double precision
+    if check is set the single precision pairs are compared with the
+    double precision kernel, the statistics of all calls the policy is
+    passed to are accumulated in it, see mixed_precision_stats
+    """
+    mixed = pydis_lib.SegSegMixed_t()
+    mixed.distance = distance
+    mixed.check = 1 if check else 0
+    return mixed
+
+def _mixed_ptr(mixed):
+    return None if mixed is None else byref(mixed)
+
+def mixed_precision_stats(mixed):
+    """
+    number of single precision pairs accumulated in the policy mixed and,
+    for the checked ones, the rms force error relative to the rms force and
+    the largest error of a force component
+    """
+    stats = np.array(mixed.stats[:pydis_lib.SEGSEG_MIXED_NUM_STATS])
+    norm2 = stats[pydis_lib.SEGSEG_MIXED_NORM2]
+    return {
+        "num_pairs": int(stats[pydis_lib.SEGSEG_MIXED_PAIRS]),
+        "num_checked": int(stats[pydis_lib.SEGSEG_MIXED_CHECKED]),
+        "rms_rel_error": np.sqrt(stats[pydis_lib.SEGSEG_MIXED_ERR2] / norm2) if norm2 > 0.0 else 0.0,
+        "max_error": stats[pydis_lib.SEGSEG_MIXED_ERRMAX],
+    }
+
+def compute_segseg_force_subset(R1, R2, burgers, cell, sub_list, mu, nu, a, quad_points=None, weights=None,
+                                mixed=None):
+    """
+    contributions of the segment pairs involving at least one segment of
+    sub_list (including their self forces) to the forces on all segments
+    mixed: precision policy of the SBA pairs (mixed_precision_policy) or None
+    returns segforces (Nseg,6) and the number of pairs evaluated
+    """
+    nodeids = np.zeros((_as_real8_array(R1).shape[0], 2), dtype=np.intc)
+    nseg, geom, quad, keep = _segseg_driver_args(nodeids, R1, R2, burgers, cell, quad_points, weights)
+    sub_list = np.ascontiguousarray(sub_list, dtype=np.intc)
+    segforces = np.empty((nseg, 6))
+    num_pairs = pydis_lib.SegSegForceSubset(
+        nseg, *geom[1:],
+        sub_list.shape[0], _int_ptr(sub_list),
+        *(a, mu, nu), *quad, _mixed_ptr(mixed),
+        _real8_ptr(segforces),
+    )
+
+    return segforces, num_pairs
+
+def compute_far_field_stress(points, R1, R2, burgers, cell, cutoff, mu, nu, a):
+    """
+    stress (K,6) in the order xx, yy, zz, xy, yz, xz at the K points from
+    the segments farther than cutoff (+ half their length) from each point,
+    i.e. the segments outside the near field of compute_local_node_forces
+    """
+    nodeids = np.zeros((_as_real8_array(R1).shape[0], 2), dtype=np.intc)
+    nseg, geom, quad, keep = _segseg_driver_args(nodeids, R1, R2, burgers, cell, None, None)
+    points = _as_real8_array(points)
+    stress = np.empty((points.shape[0], 6))
+    pydis_lib.SegStressFarField(
+        points.shape[0], _real8_ptr(points),
+        nseg, *geom[1:], cutoff,
+        *(a, mu, nu),
+        _real8_ptr(stress),
+    )
+
+    return stress
+
+def compute_local_node_forces(num_nodes, nodeids, R1, R2, burgers, cell, cutoff, sub_nodes, sub_stress,
+                              mu, nu, a, quad_points=None, weights=None):
+    """
+    forces (K,3) on the K nodes sub_nodes (indices as in nodeids) from the
+    segments within cutoff of each node (all segments if cutoff <= 0) and
+    from the stress sub_stress (K,6) at each node (order xx, yy, zz, xy, yz, xz,
+    e.g. applied stress + compute_far_field_stress), or None
+    returns nodeforces (K,3) and the number of pairs evaluated
+    """
+    nseg, geom, quad, keep = _segseg_driver_args(nodeids, R1, R2, burgers, cell, quad_points, weights)
+    sub_nodes = np.ascontiguousarray(sub_nodes, dtype=np.intc)
+    if sub_stress is not None:
+        sub_stress = np.ascontiguousarray(sub_stress, dtype=np.float64).reshape(-1, 6)
+    nodeforces = np.empty((sub_nodes.shape[0], 3))
+    num_pairs = pydis_lib.LocalNodeForces(
+        num_nodes, nseg, *geom, cutoff,
+        *(a, mu, nu), *quad,
+        sub_nodes.shape[0], _int_ptr(sub_nodes),
+        None if sub_stress is None else _real8_ptr(sub_stress),
+        _real8_ptr(nodeforces),
+    )
+
+    return nodeforces, num_pairs
+
+def compute_segseg_force_cell_list(num_nodes, nodeids, R1, R2, burgers, cell, cutoff, mu, nu, a, quad_points=None, weights=None,
+                                   mixed=None):
+    """
+    same as compute_segseg_force_all_pairs but only pairs of segments
+    closer than cutoff are evaluated (cell list in libpydis)
+    returns segforces (Nseg,6), nodeforces (num_nodes,3) and the number of pairs evaluated
+    """
+    if pydis_ext is not None and mixed is None:
+        geom, quad = _segseg_driver_arrays(nodeids, R1, R2, burgers, cell, quad_points, weights)
+        segforces = np.empty((geom[0].shape[0], 6))
+        nodeforces = np.empty((num_nodes, 3))
+        num_pairs = pydis_ext.segseg_force_cell_list(num_nodes, *geom, cutoff, a, mu, nu, *quad,
+                                                     segforces, nodeforces)
+        return segforces, nodeforces, num_pairs
+
+    nseg, geom, quad, keep = _segseg_driver_args(nodeids, R1, R2, burgers, cell, quad_points, weights)
+    segforces = np.empty((nseg, 6))
+    nodeforces = np.empty((num_nodes, 3))
+    num_pairs = pydis_lib.SegSegForceCellList(
+        num_nodes, nseg, *geom, cutoff,
+        *(a, mu, nu), *quad, _mixed_ptr(mixed),
+        _real8_ptr(segforces), _real8_ptr(nodeforces),
+    )
+
+    return segforces, nodeforces, num_pairs
+
+def compute_segseg_force_pair_list(num_nodes, nodeids, R1, R2, burgers, cell, pairs, mu, nu, a, quad_points=None, weights=None,
+                                   mixed=None):
+    """
+    same as compute_segseg_force_all_pairs but only the segment pairs in
+    pairs (M,2) are evaluated, plus the self force of every segment
+    (e.g. pairs from CellList.get_nbr_pairs)
+    returns segforces (Nseg,6) and nodeforces (num_nodes,3)
+    """
+    pairs = np.ascontiguousarray(pairs, dtype=np.intc).reshape(-1, 2)
+    if pydis_ext is not None and mixed is None:
+        geom, quad = _segseg_driver_arrays(nodeids, R1, R2, burgers, cell, quad_points, weights)
+        segforces = np.empty((geom[0].shape[0], 6))
+        nodeforces = np.empty((num_nodes, 3))
+        pydis_ext.segseg_force_pair_list(num_nodes, *geom, pairs, a, mu, nu, *quad, segforces, nodeforces)
+        return segforces, nodeforces
+
+    nseg, geom, quad, keep = _segseg_driver_args(nodeids, R1, R2, burgers, cell, quad_points, weights)
+    segforces = np.empty((nseg, 6))
+    nodeforces = np.empty((num_nodes, 3))
+    pydis_lib.SegSegForcePairList(
+        num_nodes, nseg, *geom,
+        pairs.shape[0], _int_ptr(pairs),
+        *(a, mu, nu), *quad, _mixed_ptr(mixed),
+        _real8_ptr(segforces), _real8_ptr(nodeforces),
+    )
+
+    return segforces, nodeforces
+
+def compute_segseg_force_fmm(num_nodes, nodeids, R1, R2, burgers, cell, mu, nu, a,
+                             num_layers, mp_order=2, taylor_order=5, num_points=3,
+                             quad_points=None, weights=None, corr_table=None):
+    """
+    same as compute_segseg_force_all_pairs but remote interactions are computed
+    with the fast multipole method (SegSegForceFMM in libpydis)
+    pairs in the same or neighboring cells of the finest of num_layers layers
+    are evaluated directly
+    corr_table: periodic image correction table of the cell, a and orders
+    (compute_fmm_correction_table), None for the closest images only
+    returns segforces (Nseg,6) and nodeforces (num_nodes,3)
+    """
+    nseg, geom, quad, keep = _segseg_driver_args(nodeids, R1, R2, burgers, cell, quad_points, weights)
+    segforces = np.empty((nseg, 6))
+    nodeforces = np.empty((num_nodes, 3))
+    if corr_table is not None:
+        corr_table = np.ascontiguousarray(corr_table, dtype=np.float64)
+        if corr_table.size != pydis_lib.SegSegForceFMMCorrectionSize(mp_order, taylor_order):
+            raise ValueError("compute_segseg_force_fmm: corr_table does not match mp_order and taylor_order")
+    pydis_lib.SegSegForceFMM(
+        num_nodes, nseg, *geom,
+        *(a, mu, nu),
+        *(num_layers, mp_order, taylor_order, num_points),
+        None if corr_table is None else _real8_ptr(corr_table), *quad,
+        _real8_ptr(segforces), _real8_ptr(nodeforces),
+    )
+
+    return segforces, nodeforces
+
+def compute_fmm_correction_table(cell, a, mp_order=2, taylor_order=5, num_images=8):
+    """
+    periodic image correction table of compute_segseg_force_fmm for the cell
+    (periodic in all directions), core radius a and expansion orders: the
+    images up to num_images periods away but the closest ones
+    (SegSegForceFMMCorrectionTable in libpydis)
+    """
+    h = np.ascontiguousarray(cell.h, dtype=np.float64)
+    is_periodic = np.ascontiguousarray(cell.is_periodic, dtype=np.intc)
+    table = np.empty(pydis_lib.SegSegForceFMMCorrectionSize(mp_order, taylor_order))
+    pydis_lib.SegSegForceFMMCorrectionTable(
+        _real8_ptr(h), _int_ptr(is_periodic), a,
+        mp_order, taylor_order, num_images,
+        _real8_ptr(table),
+    )
+
+    return table
+
+def compute_line_tension_force(num_nodes, nodeids, R1, R2, burgers, sigext, nu, Ec, eps_L=1e-6):
+    """
+    Peach-Koehler force from the applied stress sigext (3,3) and line tension
+    self force of all segments (LineTensionForce)
+    segment i goes from R1[i] (node nodeids[i,0]) to R2[i] (node nodeids[i,1])
+    returns segforces (Nseg,6) and nodeforces (num_nodes,3)
+    """
+    nodeids = np.ascontiguousarray(nodeids, dtype=np.intc).reshape(-1, 2)
+    R1, R2, burgers = (_as_real8_array(x) for x in (R1, R2, burgers))
+    sigext = np.ascontiguousarray(sigext, dtype=np.float64).reshape(3, 3)
+    nseg = nodeids.shape[0]
+    segforces = np.empty((nseg, 6))
+    nodeforces = np.zeros((num_nodes, 3))
+    pydis_lib.LineTensionForce(
+        num_nodes, nseg, _int_ptr(nodeids),
+        *(_real8_ptr(x) for x in (R1, R2, burgers, sigext)),
+        *(nu, Ec, eps_L),
+        _real8_ptr(segforces), _real8_ptr(nodeforces),
+    )
+
+    return segforces, nodeforces
+
+def _slip_system_arrays(slip_systems):
+    """
+    Burgers vectors and plane normals (S,3) of the slip systems given as a
+    (burgers, planes) pair, or None, padded to one row for the C arrays
+    """
+    if slip_systems is None:
+        return 0, np.zeros((1, 3)), np.zeros((1, 3))
+    sys_burgers, sys_planes = (_as_real8_array(x) for x in slip_systems)
+    if sys_burgers.shape != sys_planes.shape:
+        raise ValueError("slip_systems: burgers and planes must have the same shape")
+    if sys_burgers.shape[0] == 0:
+        return 0, np.zeros((1, 3)), np.zeros((1, 3))
+    return sys_burgers.shape[0], sys_burgers, sys_planes
+
+def _plastic_strain_result(dstrain, dspin, length, sys_length, sys_shear, num_systems):
+    return {"plastic_strain": dstrain, "plastic_spin": dspin, "length": float(length.value),
+            "slip_system_length": sys_length[:num_systems], "slip_system_shear": sys_shear[:num_systems]}
+
+def compute_plastic_strain_increment(nodeids, R1, R2, disp, burgers, planes, volume, slip_systems=None):
+    """
+    plastic strain and spin increments of the areas swept by the segments
+    from R1 to R2 (R2 the closest image of the second node) whose nodes move
+    by disp (Nnode,3) (PlasticStrainIncrement)
+    slip_systems (burgers (S,3), planes (S,3)) or None
+    returns a dict of plastic_strain (6,) in the order xx, yy, zz, yz, xz, xy,
+    plastic_spin (3,) in the order yz, xz, xy, the line length at the end of
+    the step and slip_system_length (S,) and slip_system_shear (S,)
+    """
+    nodeids = np.ascontiguousarray(nodeids, dtype=np.intc).reshape(-1, 2)
+    R1, R2, disp, burgers, planes = (_as_real8_array(x) for x in (R1, R2, disp, burgers, planes))
+    num_systems, sys_burgers, sys_planes = _slip_system_arrays(slip_systems)
+    dstrain, dspin, length = np.zeros(6), np.zeros(3), real8()
+    sys_length, sys_shear = np.zeros(max(num_systems, 1)), np.zeros(max(num_systems, 1))
+    pydis_lib.PlasticStrainIncrement(
+        nodeids.shape[0], _int_ptr(nodeids), _real8_ptr(R1), _real8_ptr(R2),
+        _real8_ptr(disp), 1.0, _real8_ptr(burgers), _real8_ptr(planes), volume,
+        num_systems, _real8_ptr(sys_burgers), _real8_ptr(sys_planes),
+        _real8_ptr(dstrain), _real8_ptr(dspin), byref(length),
+        _real8_ptr(sys_length), _real8_ptr(sys_shear),
+    )
+
+    return _plastic_strain_result(dstrain, dspin, length, sys_length, sys_shear, num_systems)
+
+def compute_node_step_euler_forward(R, constraints, nodeids, burgers, cell, sigext,
+                                    force_mode, mu, nu, a, Ec, dt,
+                                    quad_points=None, weights=None, mobility_mode=0,
+                                    planes=None, slip_systems=None):
+    """
+    one forward Euler step of the network in a single call (NodeStepEulerForward):
+    forces (force_mode 0: PK and line tension, 1: PK and all pairs elasticity),
+    velocities (mobility_mode 0: Relax) and position update
+    R (Nnode,3) must be a C-contiguous float64 array, it is updated in place
+    returns segforces (Nseg,6), nodeforces (Nnode,3) and nodevels (Nnode,3)
+    if the segment planes (Nseg,3) are given, the plastic strain of the step
+    is computed in the same call (NodeStepEulerForwardStrain) and returned
+    as a fourth value (see compute_plastic_strain_increment)
+    """
+    if R.dtype != np.float64 or not R.flags.c_contiguous:
+        raise ValueError("compute_node_step_euler_forward: R must be a C-contiguous float64 array")
+    num_nodes = R.shape[0]
+    constraints = np.ascontiguousarray(constraints, dtype=np.intc).reshape(-1)
+    sigext = np.ascontiguousarray(sigext, dtype=np.float64).reshape(3, 3)
+    nodeids = np.ascontiguousarray(nodeids, dtype=np.intc).reshape(-1, 2)
+    burgers = _as_real8_array(burgers)
+    h = np.ascontiguousarray(cell.h, dtype=np.float64)
+    hinv = np.ascontiguousarray(cell.hinv, dtype=np.float64)
+    is_periodic = np.ascontiguousarray(cell.is_periodic, dtype=np.intc)
+    if quad_points is None:
+        Nint = 0
+        quad_points = weights = np.zeros(1)
+    else:
+        quad_points = np.ascontiguousarray(quad_points, dtype=np.float64)
+        weights = np.ascontiguousarray(weights, dtype=np.float64)
+        Nint = quad_points.shape[0]
+    nseg = nodeids.shape[0]
+    segforces = np.empty((nseg, 6))
+    nodeforces = np.empty((num_nodes, 3))
+    nodevels = np.empty((num_nodes, 3))
+    args = (
+        num_nodes, nseg, _int_ptr(nodeids),
+        _real8_ptr(R), _int_ptr(constraints), _real8_ptr(burgers),
+        *(_real8_ptr(x) for x in (h, hinv)), _int_ptr(is_periodic),
+        _real8_ptr(sigext), force_mode,
+        *(a, mu, nu, Ec),
+        Nint, _real8_ptr(quad_points), _real8_ptr(weights),
+        mobility_mode, dt,
+        _real8_ptr(segforces), _real8_ptr(nodeforces), _real8_ptr(nodevels),
+    )
+    if planes is None:
+        pydis_lib.NodeStepEulerForward(*args)
+        return segforces, nodeforces, nodevels
+
+    planes = _as_real8_array(planes)
+    volume = abs(np.linalg.det(h))
+    num_systems, sys_burgers, sys_planes = _slip_system_arrays(slip_systems)
+    dstrain, dspin, length = np.zeros(6), np.zeros(3), real8()
+    sys_length, sys_shear = np.zeros(max(num_systems, 1)), np.zeros(max(num_systems, 1))
+    pydis_lib.NodeStepEulerForwardStrain(
+        *args, _real8_ptr(planes), volume,
+        num_systems, _real8_ptr(sys_burgers), _real8_ptr(sys_planes),
+        _real8_ptr(dstrain), _real8_ptr(dspin), byref(length),
+        _real8_ptr(sys_length), _real8_ptr(sys_shear),
+    )
+
+    return segforces, nodeforces, nodevels, \
+        _plastic_strain_result(dstrain, dspin, length, sys_length, sys_shear, num_systems)
+
+def segseg_force_device_create(device=-1):
+    """
+    create a device (GPU) force backend on OpenMP device number device
+    (default device if negative); its segment and pair buffers stay
+    resident between calls to compute_segseg_force_device
+    """
+    return pydis_lib.SegSegForceDeviceCreate(device)
+
+def segseg_force_device_free(dev):
+    pydis_lib.SegSegForceDeviceFree(dev)
+
+def segseg_force_device_is_offloaded(dev):
+    return bool(pydis_lib.SegSegForceDeviceIsOffloaded(dev))
+
+def compute_segseg_force_device(dev, num_nodes, nodeids, R1, R2, burgers, cell, mu, nu, a, quad_points=None, weights=None, pairs=None):
+    """
+    same as compute_segseg_force_all_pairs on the device backend dev
+    the segments are uploaded on every call; pairs (Npair,2), if given,
+    replaces the resident pair list (all pairs by default), otherwise the
+    list set by a previous call is reused
+    returns segforces (Nseg,6) and nodeforces (num_nodes,3)
+    """
+    nseg, geom, quad, keep = _segseg_driver_args(nodeids, R1, R2, burgers, cell, quad_points, weights)
+    pydis_lib.SegSegForceDeviceSetSegments(dev, nseg, *geom[1:4])
+    if pairs is not None:
+        pairs = np.ascontiguousarray(pairs, dtype=np.intc).reshape(-1, 2)
+        pydis_lib.SegSegForceDeviceSetPairs(dev, pairs.shape[0], _int_ptr(pairs))
+    segforces = np.empty((nseg, 6))
+    nodeforces = np.empty((num_nodes, 3))
+    pydis_lib.SegSegForceDeviceCompute(
+        dev, num_nodes, geom[0], *geom[4:],
+        *(a, mu, nu), *quad,
+        _real8_ptr(segforces), _real8_ptr(nodeforces),
+    )
+
+    return segforces, nodeforces
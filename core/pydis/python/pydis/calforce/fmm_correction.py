@@ -0,0 +1,47 @@
+"""@package docstring
+FMM_Correction: periodic image correction tables of the FMM force modes, cached on disk
+
+A table depends only on the cell matrix, the core radius and the
+expansion orders (SegSegForceFMMCorrectionTable in libpydis).  It is
+generated once per cell geometry, stored as fm-ctab-<key>.npz in the
+cache directory (key: a hash of these parameters) and loaded by every
+later run with the same geometry.
+"""
+
+import hashlib
+import os
+import numpy as np
+from .compute_stress_force_analytic_paradis import compute_fmm_correction_table
+
+def default_cache_dir() -> str:
+    """default_cache_dir: $PYDIS_CACHE_DIR, or ~/.cache/pydis
+    """
+    return os.environ.get("PYDIS_CACHE_DIR", os.path.join(os.path.expanduser("~"), ".cache", "pydis"))
+
+def fmm_correction_table(cell, a: float, mp_order: int=2, taylor_order: int=5,
+                         num_images: int=8, cache_dir: str=None) -> np.ndarray:
+    """fmm_correction_table: correction table of compute_segseg_force_fmm, from the cache if present
+
+    A missing table is generated (compute_fmm_correction_table) and written
+    to cache_dir (default_cache_dir() if None) through a temporary file, so
+    that concurrent runs never read a partial table.
+    """
+    h = np.ascontiguousarray(cell.h, dtype=np.float64)
+    params = np.array([a, mp_order, taylor_order, num_images], dtype=np.float64)
+    key = hashlib.sha1(h.tobytes() + params.tobytes()).hexdigest()[:16]
+    if cache_dir is None:
+        cache_dir = default_cache_dir()
+    path = os.path.join(cache_dir, "fm-ctab-%s.npz" % key)
+
+    if os.path.exists(path):
+        with np.load(path) as f:
+            if np.array_equal(f["h"], h) and np.array_equal(f["params"], params):
+                return f["table"]
+
+    table = compute_fmm_correction_table(cell, a, mp_order, taylor_order, num_images)
+    os.makedirs(cache_dir, exist_ok=True)
+    tmp = "%s.%d.tmp" % (path, os.getpid())
+    with open(tmp, 'wb') as f:
+        np.savez(f, h=h, params=params, table=table)
+    os.replace(tmp, path)
+    return table
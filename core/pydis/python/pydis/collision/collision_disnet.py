@@ -6,15 +6,22 @@ Provide collision handling functions given a DisNet object
 
 import numpy as np
 from ..disnet import DisNet, DisNode
+from ..nbrlist.nbrlist import VerletList
 from framework.collision_base import Collision_Base
 from framework.disnet_manager import DisNetManager
 
 try:
     from .getmindist2_paradis import GetMinDist2_paradis as GetMinDist2
+    from .getmindist2_paradis import GetMinDist2_paradis_batch as GetMinDist2_batch
+    from .getmindist2_paradis import RetroCollision_paradis as RetroCollision
+    from .getmindist2_paradis import SelectCollisions_paradis as SelectCollisions
 except ImportError:
     # use python version instead
     print("pydis_lib not found, using python version for GetMinDist2")
     from pydis.collision.getmindist2_python  import GetMinDist2_python as GetMinDist2
+    from pydis.collision.getmindist2_python  import GetMinDist2_python_batch as GetMinDist2_batch
+    from pydis.collision.getmindist2_python  import RetroCollision_python as RetroCollision
+    from pydis.collision.getmindist2_python  import SelectCollisions_python as SelectCollisions
 
 class Collision:
     """Collision: class for detecting and handling collisions
@@ -24,11 +31,14 @@ class Collision:
         self.collision_mode = collision_mode
         self.mindist2 = state.get("rann", np.sqrt(1.0e-3))**2
         self.nbrlist = kwargs.get('nbrlist')
+        # two_phase: detect all collisions at once, then commit a conflict-free set
+        self.two_phase = kwargs.get('two_phase', False)
         if not self.nbrlist.__module__.split('.')[0] in ['pydis']:
             raise ValueError("Collision: nbrlist must come compatible modules")
 
         self.HandleCol_Functions = {
-            'Proximity': self.HandleCol_Proximity }
+            'Proximity': self.HandleCol_Proximity,
+            'Retroactive': self.HandleCol_Retroactive_ParaDiS }
         
     def HandleCol(self, DM: DisNetManager, state: dict) -> dict:
         """HandleCol: handle collision according to collision_mode
@@ -44,6 +54,9 @@ class Collision:
         """HandleCol_Proximity: handle collision using Proximity criterion
            This is a much simplified version of Proximity collision handling in ParaDiS
         """
+        if self.two_phase:
+            return self.HandleCol_TwoPhase(G, state, retroactive=False)
+
         # loop through all segment pairs to check for collision
         segs_data_with_positions = G.get_segs_data_with_positions()
         Nseg = segs_data_with_positions["nodeids"].shape[0]
@@ -51,83 +64,55 @@ class Collision:
         R2 = segs_data_with_positions["R2"]
         midpoints = 0.5*(R1 + R2)
 
-        self.nbrlist.sort_points_to_list(midpoints)
+        if not isinstance(self.nbrlist, VerletList):
+            self.nbrlist.sort_points_to_list(midpoints)
 
         collided = np.zeros(Nseg, dtype=bool)
         source_tags = segs_data_with_positions["tag1"]
         target_tags = segs_data_with_positions["tag2"]
-        for i, j in self.nbrlist.iterate_nbr_pairs(use_cell_list=all(G.cell.is_periodic)):
-                if collided[i]:
-                    continue
-                tag1, tag2 = tuple(source_tags[i]), tuple(target_tags[i])
-                if not G.has_segment(tag1, tag2):
-                    continue
-                if state['nodeflag_dict'][tag1] & DisNode.Flags.NO_COLLISIONS:
-                    continue
-                if state['nodeflag_dict'][tag2] & DisNode.Flags.NO_COLLISIONS:
-                    continue
 
+        # screen all candidate pairs in one call, only the pairs closer
+        # than mindist go through the topological changes below
+        no_col = np.array([bool(state['nodeflag_dict'][tuple(tag)] & DisNode.Flags.NO_COLLISIONS)
+                           for tag in np.concatenate((source_tags, target_tags))], dtype=bool).reshape(2, -1)
+        no_col = no_col[0] | no_col[1]
+        if isinstance(self.nbrlist, VerletList):
+            # pairs possibly within the collision distance, reused across steps
+            pairs = self.nbrlist.get_segment_pairs(segs_data_with_positions, np.sqrt(self.mindist2))
+        else:
+            pairs = self.nbrlist.get_nbr_pairs()
+        pairs = pairs.astype(int).reshape(-1, 2)
+        pi, pj = pairs[:,0], pairs[:,1]
+        same = lambda t1, t2: np.all(t1 == t2, axis=1)
+        shared = same(source_tags[pi], source_tags[pj]) | same(source_tags[pi], target_tags[pj]) \
+               | same(target_tags[pi], source_tags[pj]) | same(target_tags[pi], target_tags[pj])
+        pairs = pairs[~(no_col[pi] | no_col[pj] | shared)]
+        pi, pj = pairs[:,0], pairs[:,1]
+
+        # apply PBC
+        P1 = R1[pi]
+        P2 = G.cell.closest_image(Rref=P1, R=R2[pi])
+        P3 = G.cell.closest_image(Rref=P1, R=R1[pj])
+        P4 = G.cell.closest_image(Rref=P3, R=R2[pj])
+        # skip velocity for now
+        dist2_all, ddist2dt_all, L1_all, L2_all, hits = GetMinDist2_batch(P1, None, P2, None, P3, None, P4, None, self.mindist2)
+
+        for n in hits:
+                i, j = pi[n], pj[n]
                 if collided[i] or collided[j]:
                     continue
+                tag1, tag2 = tuple(source_tags[i]), tuple(target_tags[i])
                 if not G.has_segment(tag1, tag2):
                     continue
                 tag3, tag4 = tuple(source_tags[j]), tuple(target_tags[j])
                 if not G.has_segment(tag3, tag4):
                     continue
-                if state['nodeflag_dict'][tag3] & DisNode.Flags.NO_COLLISIONS:
-                    continue
-                if state['nodeflag_dict'][tag4] & DisNode.Flags.NO_COLLISIONS:
-                    continue
-                p1, p2 = R1[i,:].copy(), R2[i,:].copy()
-                p3, p4 = R1[j,:].copy(), R2[j,:].copy()
-                v1, v2 = np.zeros(3), np.zeros(3)
-                v3, v4 = np.zeros(3), np.zeros(3)
-                if tag1 != tag3 and tag1 != tag4 and tag2 != tag3 and tag2 != tag4:
-                    # no nodes are shared
-                    # apply PBC
-                    p2 = G.cell.closest_image(Rref=p1, R=p2)
-                    p3 = G.cell.closest_image(Rref=p1, R=p3)
-                    p4 = G.cell.closest_image(Rref=p3, R=p4)
-                    dist2, ddist2dt, L1, L2 = GetMinDist2(p1, v1, p2, v2, p3, v3, p4, v4)
-                    if dist2 < self.mindist2:
-                        collided[i] = True
-                        collided[j] = True
-
-                        seg1_vec = p2 - p1
-                        close2node1 = (np.dot(seg1_vec, seg1_vec) * (L1    *L1))     < self.mindist2
-                        close2node2 = (np.dot(seg1_vec, seg1_vec) * ((1-L1)*(1-L1))) < self.mindist2
-
-                        seg2_vec = p4 - p3
-                        close2node3 = (np.dot(seg2_vec, seg2_vec) * (L2    *L2))     < self.mindist2
-                        close2node4 = (np.dot(seg2_vec, seg2_vec) * ((1-L2)*(1-L2))) < self.mindist2
-
-                        if close2node1:
-                            mergenode1, splitSeg1, newPos1 = tag1, False, p1
-                        elif close2node2:
-                            mergenode1, splitSeg1, newPos1 = tag2, False, p2
-                        else:
-                            splitSeg1, newPos1 = True, (1-L1)*p1 + L1*p2
-                            # skip velocity for now
-                            new_tag = G.get_new_tag()
-                            G.insert_node_between(tag1, tag2, new_tag, newPos1)
-                            mergenode1 = new_tag
-
-                        if close2node3:
-                            mergenode2, splitSeg2, newPos2 = tag3, False, p3
-                        elif close2node4:
-                            mergenode2, splitSeg2, newPos2 = tag4, False, p4
-                        else:
-                            splitSeg2, newPos2 = True, (1-L2)*p3 + L2*p4
-                            # skip velocity for now
-                            new_tag = G.get_new_tag()
-                            G.insert_node_between(tag3, tag4, new_tag, newPos2)
-                            mergenode2 = new_tag
-
-                        # To do: determine precise position satisfying glide constraints
-                        newPos = (newPos1 + newPos2)/2.0
-                        mergedTag, status = G.merge_node(mergenode1, mergenode2)
-                        if mergedTag != None:
-                            G.nodes(mergedTag).R = newPos
+                p1, p2, p3, p4 = P1[n], P2[n], P3[n], P4[n]
+                L1, L2 = L1_all[n], L2_all[n]
+                collided[i] = True
+                collided[j] = True
+
+                self.MergeSegments(G, tag1, tag2, tag3, tag4, p1, p2, p3, p4, L1, L2)
 
         # In ParaDiS the hinge case (zipping) is handled separately
         # They are skipped here for simplicity
@@ -137,12 +122,143 @@ class Collision:
 
         return state
 
+    def MergeSegments(self, G: DisNet, tag1, tag2, tag3, tag4, p1, p2, p3, p4, L1, L2) -> None:
+        """MergeSegments: merge the closest points L1 on segment tag1->tag2 (p1->p2)
+           and L2 on segment tag3->tag4 (p3->p4) of two colliding segments
+        """
+        seg1_vec = p2 - p1
+        close2node1 = (np.dot(seg1_vec, seg1_vec) * (L1    *L1))     < self.mindist2
+        close2node2 = (np.dot(seg1_vec, seg1_vec) * ((1-L1)*(1-L1))) < self.mindist2
+
+        seg2_vec = p4 - p3
+        close2node3 = (np.dot(seg2_vec, seg2_vec) * (L2    *L2))     < self.mindist2
+        close2node4 = (np.dot(seg2_vec, seg2_vec) * ((1-L2)*(1-L2))) < self.mindist2
+
+        if close2node1:
+            mergenode1, splitSeg1, newPos1 = tag1, False, p1
+        elif close2node2:
+            mergenode1, splitSeg1, newPos1 = tag2, False, p2
+        else:
+            splitSeg1, newPos1 = True, (1-L1)*p1 + L1*p2
+            # skip velocity for now
+            new_tag = G.get_new_tag()
+            G.insert_node_between(tag1, tag2, new_tag, newPos1)
+            mergenode1 = new_tag
+
+        if close2node3:
+            mergenode2, splitSeg2, newPos2 = tag3, False, p3
+        elif close2node4:
+            mergenode2, splitSeg2, newPos2 = tag4, False, p4
+        else:
+            splitSeg2, newPos2 = True, (1-L2)*p3 + L2*p4
+            # skip velocity for now
+            new_tag = G.get_new_tag()
+            G.insert_node_between(tag3, tag4, new_tag, newPos2)
+            mergenode2 = new_tag
+
+        # To do: determine precise position satisfying glide constraints
+        newPos = (newPos1 + newPos2)/2.0
+        mergedTag, status = G.merge_node(mergenode1, mergenode2)
+        if mergedTag != None:
+            G.nodes(mergedTag).R = newPos
+
     def HandleCol_Proximity_ParaDiS(self, G: DisNet, xold=None, dt=None) -> None:
         """HandleCol_Proximity: using ProximityCollision of ParaDiS
         """
         raise NotImplementedError("HandleCol_Proximity_ParaDiS: not implemented yet")
 
-    def HandleCol_Retroactive_ParaDiS(self, G: DisNet, xold=None, dt=None) -> None:
-        """HandleCol_Retroactive: using RetroactiveCollision of ParaDiS
+    def HandleCol_Retroactive_ParaDiS(self, G: DisNet, state: dict, xold=None, dt=None) -> dict:
+        """HandleCol_Retroactive: handle collision using the swept volume of the segments
+           between the positions at the beginning of the step (state["oldpos_dict"])
+           and the current positions, as RetroactiveCollisions of ParaDiS.
+           Collisions that happen during the step are caught even if the segments
+           have passed each other by the end of the step.
+        """
+        if self.two_phase:
+            return self.HandleCol_TwoPhase(G, state, retroactive=True)
+
+        segs_data_with_positions = G.get_segs_data_with_positions()
+        Nseg = segs_data_with_positions["nodeids"].shape[0]
+        nodeids = segs_data_with_positions["nodeids"]
+        R1 = segs_data_with_positions["R1"]
+        R2 = segs_data_with_positions["R2"]
+        source_tags = segs_data_with_positions["tag1"]
+        target_tags = segs_data_with_positions["tag2"]
+
+        # nodes without an old position (e.g. created by remesh) did not move
+        oldpos_dict = state.get('oldpos_dict', None) or {}
+        R1old = np.array([oldpos_dict.get(tuple(tag), R1[k]) for k, tag in enumerate(source_tags)]).reshape(-1, 3)
+        R2old = np.array([oldpos_dict.get(tuple(tag), R2[k]) for k, tag in enumerate(target_tags)]).reshape(-1, 3)
+
+        skip = np.array([bool(state['nodeflag_dict'][tuple(t1)] & DisNode.Flags.NO_COLLISIONS) or
+                         bool(state['nodeflag_dict'][tuple(t2)] & DisNode.Flags.NO_COLLISIONS)
+                         for t1, t2 in zip(source_tags, target_tags)], dtype=bool)
+
+        pairs, tau, dist2, L1_all, L2_all = RetroCollision(nodeids, skip, R1old, R2old, R1, R2, G.cell, self.mindist2)
+
+        # merge at the current positions, in the (reproducible) order of the pairs
+        collided = np.zeros(Nseg, dtype=bool)
+        for n, (i, j) in enumerate(pairs):
+            if collided[i] or collided[j]:
+                continue
+            tag1, tag2 = tuple(source_tags[i]), tuple(target_tags[i])
+            tag3, tag4 = tuple(source_tags[j]), tuple(target_tags[j])
+            if not G.has_segment(tag1, tag2) or not G.has_segment(tag3, tag4):
+                continue
+            collided[i] = True
+            collided[j] = True
+            p1 = R1[i].copy()
+            p2 = G.cell.closest_image(Rref=p1, R=R2[i])
+            p3 = G.cell.closest_image(Rref=p1, R=R1[j])
+            p4 = G.cell.closest_image(Rref=p3, R=R2[j])
+            self.MergeSegments(G, tag1, tag2, tag3, tag4, p1, p2, p3, p4, L1_all[n], L2_all[n])
+
+        if not G.is_sane():
+            raise ValueError("HandleCol_Retroactive_ParaDiS: sanity check failed")
+
+        return state
+
+    def HandleCol_TwoPhase(self, G: DisNet, state: dict, retroactive: bool=False) -> dict:
+        """HandleCol_TwoPhase: two-phase collision handling
+           Phase one detects all collisions of the step at once (in parallel in C),
+           phase two commits a set of collisions that do not share any node, chosen
+           greedily by collision time, distance and segment indices, so that the
+           result does not depend on the detection order.  The commits of this set
+           are independent of each other.  Collisions in conflict with a committed
+           one are skipped and, if still present, detected again at the next step.
         """
-        raise NotImplementedError("HandleCol_Retroactive_ParaDiS: not implemented yet")
+        segs_data_with_positions = G.get_segs_data_with_positions()
+        nodeids = segs_data_with_positions["nodeids"]
+        R1 = segs_data_with_positions["R1"]
+        R2 = segs_data_with_positions["R2"]
+        source_tags = segs_data_with_positions["tag1"]
+        target_tags = segs_data_with_positions["tag2"]
+
+        R1old = R2old = None
+        if retroactive:
+            oldpos_dict = state.get('oldpos_dict', None) or {}
+            R1old = np.array([oldpos_dict.get(tuple(tag), R1[k]) for k, tag in enumerate(source_tags)]).reshape(-1, 3)
+            R2old = np.array([oldpos_dict.get(tuple(tag), R2[k]) for k, tag in enumerate(target_tags)]).reshape(-1, 3)
+
+        skip = np.array([bool(state['nodeflag_dict'][tuple(t1)] & DisNode.Flags.NO_COLLISIONS) or
+                         bool(state['nodeflag_dict'][tuple(t2)] & DisNode.Flags.NO_COLLISIONS)
+                         for t1, t2 in zip(source_tags, target_tags)], dtype=bool)
+
+        # phase one: detection
+        pairs, tau, dist2, L1_all, L2_all = RetroCollision(nodeids, skip, R1old, R2old, R1, R2, G.cell, self.mindist2)
+
+        # phase two: conflict-free commit
+        for n in SelectCollisions(pairs, tau, dist2, nodeids):
+            i, j = pairs[n]
+            tag1, tag2 = tuple(source_tags[i]), tuple(target_tags[i])
+            tag3, tag4 = tuple(source_tags[j]), tuple(target_tags[j])
+            p1 = R1[i].copy()
+            p2 = G.cell.closest_image(Rref=p1, R=R2[i])
+            p3 = G.cell.closest_image(Rref=p1, R=R1[j])
+            p4 = G.cell.closest_image(Rref=p3, R=R2[j])
+            self.MergeSegments(G, tag1, tag2, tag3, tag4, p1, p2, p3, p4, L1_all[n], L2_all[n])
+
+        if not G.is_sane():
+            raise ValueError("HandleCol_TwoPhase: sanity check failed")
+
+        return state
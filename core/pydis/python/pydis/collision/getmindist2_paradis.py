@@ -1,5 +1,5 @@
 import numpy as np
-from ctypes import c_double
+from ctypes import c_double, c_int, POINTER, byref
 real8 = c_double
 
 try:
@@ -9,6 +9,12 @@ except ImportError:
     found_pydis = False
     raise
 
+# buffer protocol bindings releasing the GIL (pydis_ext.c), optional
+try:
+    pydis_ext = __import__('pydis_ext')
+except ImportError:
+    pydis_ext = None
+
 def GetMinDist2_paradis(p1, v1, p2, v2, p3, v3, p4, v4):
     """ this calculates the minimum distance between two line segments
     input:
@@ -47,6 +53,110 @@ def GetMinDist2_paradis(p1, v1, p2, v2, p3, v3, p4, v4):
 
     return dist2.value, ddist2dt.value, L1.value, L2.value
 
+def GetMinDist2_paradis_batch(p1, v1, p2, v2, p3, v3, p4, v4, mindist2):
+    """ batched version of GetMinDist2_paradis for a list of segment pairs
+    input:
+        p1, p2      (N,3) endpoints of segment 1 of each pair
+        p3, p4      (N,3) endpoints of segment 2 of each pair
+        v1..v4      (N,3) node velocities, or None for zero velocities
+        mindist2    square of the collision distance
+    return:
+        dist2, ddist2dt, L1, L2     (N,) arrays as in GetMinDist2_paradis
+        hits        indices of the pairs with dist2 < mindist2, in increasing order
+    """
+    p1, p2, p3, p4 = (np.ascontiguousarray(x, dtype=np.float64).reshape(-1, 3) for x in (p1, p2, p3, p4))
+    v1, v2, v3, v4 = (None if v is None else np.ascontiguousarray(v, dtype=np.float64).reshape(-1, 3) for v in (v1, v2, v3, v4))
+    npairs = p1.shape[0]
+    dist2, ddist2dt, L1, L2 = (np.empty(npairs) for _ in range(4))
+    hits = np.empty(npairs, dtype=np.int32)
+    if pydis_ext is not None:
+        nhits = pydis_ext.min_dist2_batch(p1, v1, p2, v2, p3, v3, p4, v4, mindist2,
+                                          dist2, ddist2dt, L1, L2, hits)
+        return dist2, ddist2dt, L1, L2, hits[:nhits]
+
+    ptr = lambda x: None if x is None else x.ctypes.data_as(POINTER(real8))
+
+    nhits = pydis_lib.GetMinDist2Batch(
+        npairs,
+        *(ptr(p1), ptr(v1), ptr(p2), ptr(v2)),
+        *(ptr(p3), ptr(v3), ptr(p4), ptr(v4)),
+        mindist2,
+        *(ptr(dist2), ptr(ddist2dt), ptr(L1), ptr(L2)),
+        hits.ctypes.data_as(POINTER(c_int))
+    )
+
+    return dist2, ddist2dt, L1, L2, hits[:nhits]
+
+def RetroCollision_paradis(nodeids, skip, R1old, R2old, R1, R2, cell, mindist2):
+    """ retroactive (swept volume) collision detection between all segments
+    input:
+        nodeids     (N,2) end node indices of each segment
+        skip        (N,) True for segments that must not collide, or None
+        R1old, R2old  (N,3) end node positions at the beginning of the step,
+                    or None for the proximity criterion at the current positions
+        R1, R2      (N,3) end node positions at the end of the step
+        cell        simulation cell
+        mindist2    square of the collision distance
+    return:
+        pairs       (M,2) segment indices (i < j) of the colliding pairs
+        tau         (M,) normalized time of the collision within the step
+        dist2, L1, L2   (M,) distance and closest points at tau
+    """
+    nodeids = np.ascontiguousarray(nodeids, dtype=np.intc).reshape(-1, 2)
+    R1, R2 = (np.ascontiguousarray(x, dtype=np.float64).reshape(-1, 3) for x in (R1, R2))
+    R1old, R2old = (None if x is None else np.ascontiguousarray(x, dtype=np.float64).reshape(-1, 3) for x in (R1old, R2old))
+    skip = None if skip is None else np.ascontiguousarray(skip, dtype=np.intc)
+    h = np.ascontiguousarray(cell.h, dtype=np.float64)
+    hinv = np.ascontiguousarray(cell.hinv, dtype=np.float64)
+    is_periodic = np.ascontiguousarray(cell.is_periodic, dtype=np.intc)
+    ptr = lambda x: None if x is None else x.ctypes.data_as(POINTER(real8))
+    iptr = lambda x: None if x is None else x.ctypes.data_as(POINTER(c_int))
+
+    max_hits = max(16, nodeids.shape[0])
+    while True:
+        pairs = np.empty((max_hits, 2), dtype=np.intc)
+        tau, dist2, L1, L2 = (np.empty(max_hits) for _ in range(4))
+        ncand = c_int()
+        nhits = pydis_lib.RetroCollisionPairs(
+            nodeids.shape[0], iptr(nodeids), iptr(skip),
+            *(ptr(x) for x in (R1old, R2old, R1, R2, h, hinv)),
+            iptr(is_periodic), mindist2, max_hits, iptr(pairs),
+            *(ptr(x) for x in (tau, dist2, L1, L2)),
+            byref(ncand)
+        )
+        if nhits <= max_hits:
+            break
+        max_hits = nhits
+
+    return pairs[:nhits], tau[:nhits], dist2[:nhits], L1[:nhits], L2[:nhits]
+
+def SelectCollisions_paradis(pairs, tau, dist2, nodeids):
+    """ select a conflict-free set of detected collisions (no two of them
+        touch the same node), greedily in the order of earliest tau, then
+        smallest dist2, then segment indices
+    input:
+        pairs       (M,2) segment indices of the detected collisions
+        tau         (M,) collision times, or None
+        dist2       (M,) squared collision distances
+        nodeids     (N,2) end node indices of each segment
+    return:
+        indices of the accepted collisions, in commit order
+    """
+    pairs = np.ascontiguousarray(pairs, dtype=np.intc).reshape(-1, 2)
+    nodeids = np.ascontiguousarray(nodeids, dtype=np.intc).reshape(-1, 2)
+    dist2 = np.ascontiguousarray(dist2, dtype=np.float64)
+    tau = None if tau is None else np.ascontiguousarray(tau, dtype=np.float64)
+    num_nodes = int(nodeids.max()) + 1 if nodeids.size > 0 else 0
+    commit = np.empty(pairs.shape[0], dtype=np.intc)
+    ncommit = pydis_lib.SelectCollisions(
+        pairs.shape[0], pairs.ctypes.data_as(POINTER(c_int)),
+        None if tau is None else tau.ctypes.data_as(POINTER(real8)),
+        dist2.ctypes.data_as(POINTER(real8)),
+        num_nodes, nodeids.ctypes.data_as(POINTER(c_int)),
+        commit.ctypes.data_as(POINTER(c_int))
+    )
+    return commit[:ncommit]
+
 def compute_segseg_force_SBN1_SBA(p1, p2, p3, p4, b1, b2, mu, nu, a, quad_points, weights, seg12local=1, seg34local=1):
     """
     dislocation segment from p1 to p2 with Burgers vector b1
@@ -130,4 +130,106 @@ def GetMinDist2_python(p1, v1, p2, v2, p3, v3, p4, v4, eps0 = 1.0e-12, epsM = 1e
 
     ddist2dt = 2.0 * np.dot(ddist_vecdt, dist_vec)
     
-    return dist2, ddist2dt, L1, L2
\ No newline at end of file
+    return dist2, ddist2dt, L1, L2
+
+
+def GetMinDist2_python_batch(p1, v1, p2, v2, p3, v3, p4, v4, mindist2):
+    """ batched version of GetMinDist2_python for a list of segment pairs
+        (same interface as GetMinDist2_paradis_batch)
+    """
+    p1, p2, p3, p4 = (np.asarray(x, dtype=float).reshape(-1, 3) for x in (p1, p2, p3, p4))
+    npairs = p1.shape[0]
+    v1, v2, v3, v4 = (np.zeros((npairs, 3)) if v is None else np.asarray(v, dtype=float).reshape(-1, 3) for v in (v1, v2, v3, v4))
+    dist2, ddist2dt, L1, L2 = (np.empty(npairs) for _ in range(4))
+    for n in range(npairs):
+        dist2[n], ddist2dt[n], L1[n], L2[n] = GetMinDist2_python(p1[n], v1[n], p2[n], v2[n], p3[n], v3[n], p4[n], v4[n])
+    hits = np.nonzero(dist2 < mindist2)[0]
+    return dist2, ddist2dt, L1, L2, hits
+
+
+def SweptMinDist2_python(xold, x, mindist2, nsub=8, niter=32):
+    """ retroactive collision test of two segments x[0]->x[1] and x[2]->x[3]
+        whose nodes move linearly from xold to x during the step
+        (same algorithm as SweptMinDist2 in RetroCollision.c)
+    return:
+        hit, tau, dist2, L1, L2
+    """
+    v = x - xold
+    def at(t):
+        p = xold + t*v
+        return GetMinDist2_python(p[0], v[0], p[1], v[1], p[2], v[2], p[3], v[3])
+    t = np.linspace(0.0, 1.0, nsub+1)
+    res = [at(tk) for tk in t]
+    if res[0][0] < mindist2:
+        return True, 0.0, res[0][0], res[0][2], res[0][3]
+    for k in range(1, nsub+1):
+        ta = t[k-1]
+        if res[k][0] < mindist2:
+            tb, rb = t[k], res[k]
+        elif res[k-1][1] < 0.0 and res[k][1] > 0.0:
+            lo, hi = t[k-1], t[k]
+            for _ in range(niter):
+                tm = 0.5*(lo + hi)
+                if at(tm)[1] < 0.0: lo = tm
+                else: hi = tm
+            tb = 0.5*(lo + hi)
+            rb = at(tb)
+            if rb[0] >= mindist2:
+                continue
+        else:
+            continue
+        for _ in range(niter):
+            tm = 0.5*(ta + tb)
+            rm = at(tm)
+            if rm[0] < mindist2: tb, rb = tm, rm
+            else: ta = tm
+        return True, tb, rb[0], rb[2], rb[3]
+    k = int(np.argmin([r[0] for r in res]))
+    return False, t[k], res[k][0], res[k][2], res[k][3]
+
+def RetroCollision_python(nodeids, skip, R1old, R2old, R1, R2, cell, mindist2):
+    """ retroactive (swept volume) collision detection between all segments
+        (same interface as RetroCollision_paradis, brute force over the
+        swept boxes of all segment pairs)
+    """
+    nodeids = np.asarray(nodeids).reshape(-1, 2)
+    nseg = nodeids.shape[0]
+    R1old = R1 if R1old is None else R1old
+    R2old = R2 if R2old is None else R2old
+    R2 = cell.closest_image(Rref=R1, R=R2)
+    R1old = cell.closest_image(Rref=R1, R=R1old)
+    R2old = cell.closest_image(Rref=R2, R=R2old)
+    X = np.stack((R1old, R2old, R1, R2), axis=1)
+    pad = 0.5*np.sqrt(mindist2)
+    center = 0.5*(X.min(axis=1) + X.max(axis=1))
+    half = 0.5*(X.max(axis=1) - X.min(axis=1)) + pad
+    pairs, tau, dist2, L1, L2 = [], [], [], [], []
+    for i in range(nseg):
+        if skip is not None and skip[i]: continue
+        for j in range(i+1, nseg):
+            if skip is not None and skip[j]: continue
+            if len(set(nodeids[i]) & set(nodeids[j])) > 0: continue
+            cj = cell.closest_image(Rref=center[i], R=center[j])
+            if np.any(np.abs(cj - center[i]) > half[i] + half[j]): continue
+            xj = X[j] + (cj - center[j])
+            hit, t, d2, l1, l2 = SweptMinDist2_python(np.vstack((X[i,:2], xj[:2])), np.vstack((X[i,2:], xj[2:])), mindist2)
+            if hit:
+                pairs.append((i, j)); tau.append(t); dist2.append(d2); L1.append(l1); L2.append(l2)
+    return np.array(pairs, dtype=int).reshape(-1, 2), np.array(tau), np.array(dist2), np.array(L1), np.array(L2)
+
+def SelectCollisions_python(pairs, tau, dist2, nodeids):
+    """ select a conflict-free set of detected collisions
+        (same interface as SelectCollisions_paradis)
+    """
+    pairs = np.asarray(pairs, dtype=int).reshape(-1, 2)
+    nodeids = np.asarray(nodeids).reshape(-1, 2)
+    tau = np.zeros(pairs.shape[0]) if tau is None else np.asarray(tau)
+    order = np.lexsort((pairs[:,1], pairs[:,0], np.asarray(dist2), tau))
+    used, commit = set(), []
+    for n in order:
+        nodes = set(nodeids[pairs[n,0]]) | set(nodeids[pairs[n,1]])
+        if used & nodes:
+            continue
+        used |= nodes
+        commit.append(n)
+    return np.array(commit, dtype=int)
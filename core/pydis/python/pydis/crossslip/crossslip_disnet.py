@@ -0,0 +1,77 @@
+"""@package docstring
+CrossSlip_DisNet: class for cross-slip of screw dislocation segments
+
+Provide cross-slip handling functions given a DisNet object
+"""
+
+import numpy as np
+from ..disnet import DisNet
+from framework.disnet_manager import DisNetManager
+
+from ..calforce.compute_stress_analytic_paradis import compute_segs_stress_at_points
+from .crossslip_paradis import cross_slip_screw_segments_paradis
+
+# {111} slip planes of FCC crystals
+FCC_SLIP_PLANES = np.array([[ 1.0,  1.0,  1.0],
+                            [-1.0,  1.0,  1.0],
+                            [ 1.0, -1.0,  1.0],
+                            [ 1.0,  1.0, -1.0]]) / np.sqrt(3.0)
+
+class CrossSlip:
+    """CrossSlip: class for cross-slip of screw segments
+
+    The screw segments are identified and moved to their cross-slip plane in
+    one call to libpydis (CrossSlipScrewSegments) per step.  The stress at the
+    segment midpoints is the applied stress plus, if elastic, the stress of
+    all segments (SegStressAtPoints, without periodic images).  A screw
+    segment cross-slips with the given probability when the glide force on
+    another slip plane containing its Burgers vector exceeds force_ratio
+    times the one on its current plane.  The random streams are set by the
+    seed and the number of calls to Handle, so runs are reproducible for any
+    number of threads.
+    """
+    def __init__(self, state: dict={}, slip_planes: np.ndarray=FCC_SLIP_PLANES,
+                 screw_angle: float=1.0, force_ratio: float=1.1, probability: float=1.0,
+                 seed: int=0, elastic: bool=True) -> None:
+        self.mu = state.get("mu", 1.0)
+        self.nu = state.get("nu", 0.3)
+        self.a =  state.get("a", 0.01)
+        self.slip_planes = np.array(slip_planes, dtype=np.float64).reshape(-1, 3)
+        self.screw_sin = np.sin(np.deg2rad(screw_angle))
+        self.force_ratio = force_ratio
+        self.probability = probability
+        self.seed = seed
+        self.elastic = elastic
+        self.step = 0
+
+    def SegmentStress(self, segs_data: dict, state: dict) -> np.ndarray:
+        """SegmentStress: stress (Nseg,6) at the segment midpoints in the
+        order xx, yy, zz, xy, yz, xz
+        """
+        # applied_stress is xx, yy, zz, yz, xz, xy
+        applied_stress = np.asarray(state["applied_stress"], dtype=np.float64)
+        stress = np.tile(applied_stress[[0, 1, 2, 5, 3, 4]], (segs_data["R1"].shape[0], 1))
+        if self.elastic and stress.shape[0] > 0:
+            midpoints = 0.5 * (segs_data["R1"] + segs_data["R2"])
+            compute_segs_stress_at_points(segs_data["R1"], segs_data["R2"], segs_data["burgers"],
+                                          midpoints, self.mu, self.nu, self.a, stress=stress)
+        return stress
+
+    def Handle(self, DM: DisNetManager, state: dict) -> dict:
+        """Handle: cross-slip the screw segments of the network
+        """
+        G = DM.get_disnet(DisNet)
+        nodes_data, ntags = G.get_nodes_data()
+        segs_data = G.get_segs_data_with_positions()
+
+        new_planes, crossslipped = cross_slip_screw_segments_paradis(
+            nodes_data["positions"], nodes_data["constraints"], segs_data["nodeids"],
+            segs_data["burgers"], segs_data["planes"], self.SegmentStress(segs_data, state),
+            self.slip_planes, G.cell, self.screw_sin, self.force_ratio, self.probability,
+            self.seed, self.step)
+        self.step += 1
+
+        segids = np.flatnonzero(crossslipped)
+        G.set_segs_planes(segids, new_planes[segids])
+        state["num_cross_slips"] = segids.size
+        return state
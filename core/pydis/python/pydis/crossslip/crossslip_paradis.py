@@ -0,0 +1,55 @@
+import numpy as np
+from ctypes import c_double, c_int, POINTER
+real8 = c_double
+
+try:
+    pydis_lib = __import__('pydis_lib')
+    found_pydis = True
+except ImportError:
+    found_pydis = False
+    raise
+
+def cross_slip_screw_segments_paradis(R, constraints, nodeids, burgers, planes, seg_stress,
+                                      slip_planes, cell, screw_sin, force_ratio, probability,
+                                      seed, step):
+    """ cross-slip of the screw segments of a network (CrossSlipScrewSegments)
+    input:
+        R            (Nnode,3) node positions
+        constraints  (Nnode,) node constraints
+        nodeids      (Nseg,2) end node indices of each segment
+        burgers      (Nseg,3) Burgers vectors
+        planes       (Nseg,3) glide plane normals
+        seg_stress   (Nseg,6) stress at the segment midpoints, order xx, yy, zz, xy, yz, xz
+        slip_planes  (P,3) slip plane normals of the crystal
+        cell         simulation cell
+        screw_sin    sine of the screw tolerance angle
+        force_ratio  glide force ratio of the cross-slip and current planes
+        probability  cross-slip probability of the segments meeting the criterion
+        seed, step   random stream of the call
+    return:
+        new_planes   (Nseg,3) glide plane normals after cross-slip
+        crossslipped (Nseg,) True for the segments that cross-slipped
+    """
+    R, burgers, planes = (np.ascontiguousarray(x, dtype=np.float64).reshape(-1, 3) for x in (R, burgers, planes))
+    seg_stress = np.ascontiguousarray(seg_stress, dtype=np.float64).reshape(-1, 6)
+    slip_planes = np.ascontiguousarray(slip_planes, dtype=np.float64).reshape(-1, 3)
+    constraints = np.ascontiguousarray(constraints, dtype=np.intc).reshape(-1)
+    nodeids = np.ascontiguousarray(nodeids, dtype=np.intc).reshape(-1, 2)
+    h = np.ascontiguousarray(cell.h, dtype=np.float64)
+    hinv = np.ascontiguousarray(cell.hinv, dtype=np.float64)
+    is_periodic = np.ascontiguousarray(cell.is_periodic, dtype=np.intc)
+    new_planes = np.empty_like(planes)
+    crossslipped = np.zeros(nodeids.shape[0], dtype=np.intc)
+
+    ptr = lambda x: x.ctypes.data_as(POINTER(real8))
+    iptr = lambda x: x.ctypes.data_as(POINTER(c_int))
+    pydis_lib.CrossSlipScrewSegments(
+        nodeids.shape[0], iptr(nodeids), ptr(R), iptr(constraints),
+        ptr(burgers), ptr(planes), ptr(seg_stress),
+        slip_planes.shape[0], ptr(slip_planes),
+        ptr(h), ptr(hinv), iptr(is_periodic),
+        screw_sin, force_ratio, probability,
+        seed, step, ptr(new_planes), iptr(crossslipped)
+    )
+
+    return new_planes, crossslipped.astype(bool)
@@ -40,17 +40,68 @@ class DisNode():
 
     def __init__(self, R: np.ndarray,
                  constraint: int=Constraints.UNCONSTRAINED) -> None:
+        self._arrays = None
+        self._index = -1
         self.R = R
         self.constraint = int(constraint)
 
+    @property
+    def R(self) -> np.ndarray:
+        """R: node position, a view into the network arrays once the node is added
+
+        The view aliases the storage of the network: element-wise writes
+        (node.R[0] = x, node.R += dr) bypass the change tracking and trial
+        journal, and after nodes are added or removed the view may refer to
+        a reallocated array or to the slot of another node.  Assign node.R
+        to change the position, and copy it (node.R.copy()) to keep it.
+        """
+        return self._R if self._arrays is None else self._arrays.R[self._index]
+
+    @R.setter
+    def R(self, R: np.ndarray) -> None:
+        if self._arrays is None:
+            self._R = R
+        else:
+            self._arrays.log_attr(self, "R")
+            self._arrays.R[self._index] = R
+            self._arrays.node_dirty[self._index] = True
+
+    @property
+    def constraint(self) -> int:
+        return self._constraint if self._arrays is None else int(self._arrays.constraint[self._index])
+
+    @constraint.setter
+    def constraint(self, constraint: int) -> None:
+        if self._arrays is None:
+            self._constraint = int(constraint)
+        else:
+            self._arrays.log_attr(self, "constraint")
+            self._arrays.constraint[self._index] = constraint
+            self._arrays.node_dirty[self._index] = True
+
+    def _bind(self, arrays, index: int) -> None:
+        """_bind: move the node attributes into slot index of arrays
+        """
+        arrays.R[index] = self._R
+        arrays.constraint[index] = self._constraint
+        self._arrays, self._index = arrays, index
+        self._R = None
+
+    def _unbind(self) -> None:
+        """_unbind: take the node attributes back out of the network arrays
+        """
+        self._R = self.R.copy()
+        self._constraint = self.constraint
+        self._arrays, self._index = None, -1
+
     def is_equivalent(self, other) -> bool:
         # check if all attributes in self have the same value in other
-        for key, value in vars(self).items():
+        for key, value in self.view().items():
             if type(value) == np.ndarray:
-                if not np.all(value == vars(other)[key]):
+                if not np.all(value == other.view()[key]):
                     return False
             else:
-                if value != vars(other)[key]:
+                if value != other.view()[key]:
                     return False
         return True
 
@@ -62,7 +113,7 @@ class DisNode():
     def view(self):
         """view: return a dictionary view of the node attr
         """
-        return vars(self)
+        return {"R": self.R, "constraint": self.constraint}
 
 class DisEdge():
     """DisEdge: class for dislocation edge (properties)
@@ -70,19 +121,77 @@ class DisEdge():
     Defines the basic features on a edge
     """
     def __init__(self, source_tag: Tag, target_tag: Tag, burg_vec: np.ndarray, plane_normal: np.ndarray=None) -> None:
+        self._arrays = None
+        self._index = -1
+        self._has_plane = False
         self.source_tag = source_tag
         self.target_tag = target_tag
         self.burg_vec = burg_vec
         if plane_normal is not None:
             self.plane_normal = plane_normal
 
+    @property
+    def burg_vec(self) -> np.ndarray:
+        """burg_vec: Burgers vector from source_tag, a view into the network arrays once the edge is added
+           (aliasing the network storage as DisNode.R)
+        """
+        return self._burg_vec if self._arrays is None else self._arrays.burgers[self._index]
+
+    @burg_vec.setter
+    def burg_vec(self, burg_vec: np.ndarray) -> None:
+        if self._arrays is None:
+            self._burg_vec = burg_vec
+        else:
+            self._arrays.log_attr(self, "burg_vec")
+            self._arrays.burgers[self._index] = burg_vec
+            self._arrays.seg_dirty[self._index] = True
+
+    @property
+    def plane_normal(self) -> np.ndarray:
+        """plane_normal: glide plane normal (attribute absent if never set)
+        """
+        if not self._has_plane:
+            raise AttributeError("plane_normal")
+        return self._plane_normal if self._arrays is None else self._arrays.planes[self._index]
+
+    @plane_normal.setter
+    def plane_normal(self, plane_normal: np.ndarray) -> None:
+        if self._arrays is None:
+            self._has_plane = True
+            self._plane_normal = plane_normal
+        else:
+            self._arrays.log_attr(self, "plane_normal")
+            self._has_plane = True
+            self._arrays.planes[self._index] = plane_normal
+            self._arrays.seg_dirty[self._index] = True
+
+    def _bind(self, arrays, index: int, source_tag: Tag) -> None:
+        """_bind: move the edge attributes into slot index of arrays
+           the Burgers vector is stored from source_tag (the first end node of the slot)
+        """
+        if self.source_tag != source_tag and self.target_tag == source_tag:
+            self.source_tag, self.target_tag = self.target_tag, self.source_tag
+            self._burg_vec = -self._burg_vec
+        arrays.burgers[index] = self._burg_vec
+        arrays.planes[index] = self._plane_normal if self._has_plane else 0.0
+        self._arrays, self._index = arrays, index
+        self._burg_vec = self._plane_normal = None
+
+    def _unbind(self) -> None:
+        """_unbind: take the edge attributes back out of the network arrays
+        """
+        self._burg_vec = self.burg_vec.copy()
+        if self._has_plane:
+            self._plane_normal = self.plane_normal.copy()
+        self._arrays, self._index = None, -1
+
     def burg_vec_from(self, from_tag: Tag) -> np.ndarray:
         if from_tag != self.source_tag and from_tag != self.target_tag:
             raise ValueError("burg_vec_from: from_tag not in edge")
         return self.burg_vec if self.source_tag == from_tag else -self.burg_vec
 
     def add(self, other) -> None:
-        self.burg_vec += other.burg_vec_from(self.source_tag)
+        self.burg_vec = self.burg_vec + other.burg_vec_from(self.source_tag)
         # To do: update glide plane normal
 
     def is_equivalent(self, other) -> bool:
@@ -101,7 +210,163 @@ class DisEdge():
     def view(self):
         """view: return a dictionary view of the edge attr
         """
-        return vars(self)
+        result = {"source_tag": self.source_tag, "target_tag": self.target_tag, "burg_vec": self.burg_vec}
+        if self._has_plane:
+            result["plane_normal"] = self.plane_normal
+        return result
+
+class DisNetArrays:
+    """DisNetArrays: contiguous storage of the node and segment data of a DisNet
+
+    Node tags, positions and constraints, and segment end nodes, Burgers
+    vectors (from the first end node) and plane normals are kept in growable
+    arrays.  Slots are handed out in insertion order and removed slots are left
+    as holes until compact(), so the active slots are always in the iteration
+    order of the network.  The attributes of added nodes and edges read and
+    write their slot directly.  Integer arrays are C int so that they can be
+    passed to the C library without conversion.
+
+    Changes are tracked until clear_changes(): slots of added nodes and
+    segments and of attributes assigned to are marked dirty, and the tags of
+    removed nodes and segments are recorded.  Element-wise writes into an
+    attribute (node.R[0] = x) are not tracked.
+
+    While journal is a list (see DisNet.begin_trial), assignments to the
+    attributes of added nodes and edges append their previous value to it.
+    """
+    def __init__(self, capacity: int=64) -> None:
+        capacity = max(int(capacity), 1)
+        self.node_tags = np.zeros((capacity, 2), dtype=np.intc)
+        self.R = np.zeros((capacity, 3))
+        self.constraint = np.zeros(capacity, dtype=np.intc)
+        self.seg_nodes = np.zeros((capacity, 2), dtype=np.intc)
+        self.burgers = np.zeros((capacity, 3))
+        self.planes = np.zeros((capacity, 3))
+        self.node_dirty = np.zeros(capacity, dtype=bool)
+        self.seg_dirty = np.zeros(capacity, dtype=bool)
+        # node attr / edge of each slot (None for holes)
+        self.node_attrs = []
+        self.seg_edges = []
+        self._node_holes = 0
+        self._seg_holes = 0
+        self.removed_nodes = set()
+        self.removed_segs = set()
+        self.journal = None
+
+    @staticmethod
+    def _grow(arr: np.ndarray, n: int) -> np.ndarray:
+        if n <= arr.shape[0]:
+            return arr
+        new_arr = np.zeros((max(n, 2*arr.shape[0]),) + arr.shape[1:], dtype=arr.dtype)
+        new_arr[:arr.shape[0]] = arr
+        return new_arr
+
+    def log_attr(self, attr, name: str) -> None:
+        """log_attr: record the value of attribute name of attr before it is assigned to
+        """
+        if self.journal is None:
+            return
+        value = getattr(attr, name, None)
+        if isinstance(value, np.ndarray):
+            value = value.copy()
+        self.journal.append(("attr", attr, name, value))
+
+    def add_node(self, tag: Tag, node_attr: DisNode) -> None:
+        index = len(self.node_attrs)
+        if index >= self.R.shape[0]:
+            self.node_tags = self._grow(self.node_tags, index+1)
+            self.R = self._grow(self.R, index+1)
+            self.constraint = self._grow(self.constraint, index+1)
+            self.node_dirty = self._grow(self.node_dirty, index+1)
+        self.node_tags[index] = tag
+        self.node_dirty[index] = True
+        self.node_attrs.append(node_attr)
+        node_attr._bind(self, index)
+
+    def remove_node(self, node_attr: DisNode) -> None:
+        index = node_attr._index
+        self.removed_nodes.add((int(self.node_tags[index,0]), int(self.node_tags[index,1])))
+        self.node_dirty[index] = False
+        self.node_attrs[index] = None
+        self._node_holes += 1
+        node_attr._unbind()
+
+    def add_segment(self, edge) -> None:
+        index = len(self.seg_edges)
+        if index >= self.burgers.shape[0]:
+            self.seg_nodes = self._grow(self.seg_nodes, index+1)
+            self.burgers = self._grow(self.burgers, index+1)
+            self.planes = self._grow(self.planes, index+1)
+            self.seg_dirty = self._grow(self.seg_dirty, index+1)
+        self.seg_nodes[index] = edge.source.attr._index, edge.target.attr._index
+        self.seg_dirty[index] = True
+        self.seg_edges.append(edge)
+        edge.attr._bind(self, index, edge.source.tag)
+
+    def remove_segment(self, edge) -> None:
+        self.removed_segs.add((edge.source.tag, edge.target.tag))
+        self.seg_dirty[edge.attr._index] = False
+        self.seg_edges[edge.attr._index] = None
+        self._seg_holes += 1
+        edge.attr._unbind()
+
+    def clear(self) -> None:
+        for index, node_attr in enumerate(self.node_attrs):
+            if node_attr is not None:
+                self.removed_nodes.add((int(self.node_tags[index,0]), int(self.node_tags[index,1])))
+                node_attr._unbind()
+        for edge in self.seg_edges:
+            if edge is not None: edge.attr._unbind()
+        self.node_attrs, self.seg_edges = [], []
+        self._node_holes = self._seg_holes = 0
+
+    def num_nodes(self) -> int:
+        return len(self.node_attrs) - self._node_holes
+
+    def num_segments(self) -> int:
+        return len(self.seg_edges) - self._seg_holes
+
+    def segment_edges(self):
+        return (edge for edge in self.seg_edges if edge is not None)
+
+    def num_changes(self) -> int:
+        """num_changes: number of dirty slots and removed nodes and segments
+        """
+        return int(np.count_nonzero(self.node_dirty[:len(self.node_attrs)])) \
+             + int(np.count_nonzero(self.seg_dirty[:len(self.seg_edges)])) \
+             + len(self.removed_nodes) + len(self.removed_segs)
+
+    def clear_changes(self) -> None:
+        self.node_dirty[:] = False
+        self.seg_dirty[:] = False
+        self.removed_nodes.clear()
+        self.removed_segs.clear()
+
+    def compact(self) -> None:
+        """compact: close the holes left by removed nodes and segments
+           keeps the order of the remaining slots
+        """
+        if self._seg_holes > 0:
+            keep = np.array([edge is not None for edge in self.seg_edges], dtype=bool)
+            n = int(np.count_nonzero(keep))
+            for arr in (self.seg_nodes, self.burgers, self.planes, self.seg_dirty):
+                arr[:n] = arr[:keep.size][keep]
+            self.seg_edges = [edge for edge in self.seg_edges if edge is not None]
+            for i, edge in enumerate(self.seg_edges):
+                edge.attr._index = i
+            self._seg_holes = 0
+        if self._node_holes > 0:
+            keep = np.array([node_attr is not None for node_attr in self.node_attrs], dtype=bool)
+            n = int(np.count_nonzero(keep))
+            new_index = np.cumsum(keep) - 1
+            for arr in (self.node_tags, self.R, self.constraint, self.node_dirty):
+                arr[:n] = arr[:keep.size][keep]
+            ns = len(self.seg_edges)
+            self.seg_nodes[:ns] = new_index[self.seg_nodes[:ns]]
+            self.node_attrs = [node_attr for node_attr in self.node_attrs if node_attr is not None]
+            for i, node_attr in enumerate(self.node_attrs):
+                node_attr._index = i
+            self._node_holes = 0
 
 class Cell:
     """Cell: class for simulation cell in which dislocation network is embedded
@@ -167,8 +432,11 @@ class DisNet(DisNet_Python):
         self._G = Graph()
         # provide a reference from tags back to nodes (with attr)
         self.tags_to_nodes = {}
+        # node and segment data in contiguous arrays
+        self._arrays = DisNetArrays()
         self.cell = Cell() if cell is None else cell
         self._recycled_tags = []
+        self._trial_recycled_tags = None
         if rn is not None or links is not None:
             self.add_nodes_segments_from_list(rn, links)
 
@@ -177,6 +445,7 @@ class DisNet(DisNet_Python):
         """
         # To do: uncomment _G.clear after implemented in Graph
         self._G.clear()
+        self._arrays.clear()
         self.tags_to_nodes.clear()
         self._recycled_tags.clear()
 
@@ -243,17 +512,17 @@ class DisNet(DisNet_Python):
     def all_segments_tags(self):
         """segments: return iterator of all segments (tag pairs)
         """
-        return ( (edge.source.tag, edge.target.tag) for edge in self._G.edges() )
+        return ( (edge.source.tag, edge.target.tag) for edge in self._arrays.segment_edges() )
     
     def all_segments_mapping(self):
         """all_segments_mapping: return iterator of all segments (tag pairs) and attributes
         """
-        return ( ((edge.source.tag, edge.target.tag), edge.attr) for edge in self._G.edges() )
+        return ( ((edge.source.tag, edge.target.tag), edge.attr) for edge in self._arrays.segment_edges() )
 
     def all_segments_dict(self):
         """all_segments_dict: return dictionary of all segments (tag pairs) -> attributes
         """
-        return { (edge.source.tag, edge.target.tag): edge.attr for edge in self._G.edges() }
+        return { (edge.source.tag, edge.target.tag): edge.attr for edge in self._arrays.segment_edges() }
 
     def segments(self, tag_pair: Tuple[Tag, Tag]):
         """segments: return property of segments specified by tag_pair
@@ -270,7 +539,17 @@ class DisNet(DisNet_Python):
     def pos_array(self) -> np.ndarray:
         """pos_array: return a numpy array of node positions
         """
-        return np.array([node.attr.R for node in self.tags_to_nodes.values()])
+        self._arrays.compact()
+        return self._arrays.R[:self._arrays.num_nodes()].copy()
+
+    def positions_dict(self) -> dict:
+        """positions_dict: return a dictionary of node tags -> copies of the node positions
+           (e.g. the positions at the beginning of a step, state["oldpos_dict"])
+        """
+        arrays = self._arrays
+        arrays.compact()
+        Nnode = arrays.num_nodes()
+        return dict(zip(map(tuple, arrays.node_tags[:Nnode].tolist()), arrays.R[:Nnode].copy()))
 
     # To do: remove function node_prop_list (after removed from base class)
     def node_prop_list(self) -> list:
@@ -284,91 +563,106 @@ class DisNet(DisNet_Python):
         """
         raise NotImplementedError("seg_prop_list: not implemented")
 
-    def get_nodes_data(self):
+    def get_nodes_data(self, copy: bool=True):
         """get_nodes_data: collect nodes data into a dictionary format
            Returns:
                 nodes_data: dictionary of nodes data
                 ntags: position of each tag in the nodes array
+           With copy=False the arrays are views into the network storage,
+           valid until the network is next modified, and writes into them
+           are not tracked (see positions_updated)
         """
-        Nnode = self.num_nodes()
-        tags = np.zeros((Nnode, 2), dtype=int)
-        R = np.zeros((Nnode, 3))
-        constraints = np.zeros((Nnode, 1), dtype=int)
-        ntags = {}
-        i = 0
-        for tag, node_attr in self.all_nodes_mapping():
-            tags[i,:] = tag
-            R[i,:] = node_attr.R
-            constraints[i,:] = node_attr.constraint
-            ntags[tag] = i
-            i += 1
-        return {
-            "tags": tags,
-            "positions": R,
-            "constraints": constraints
-        }, ntags
+        arrays = self._arrays
+        arrays.compact()
+        Nnode = arrays.num_nodes()
+        ntags = {tag: i for i, tag in enumerate(self.tags_to_nodes)}
+        nodes_data = {
+            "tags": arrays.node_tags[:Nnode],
+            "positions": arrays.R[:Nnode],
+            "constraints": arrays.constraint[:Nnode].reshape(-1, 1)
+        }
+        if copy:
+            nodes_data = {key: value.copy() for key, value in nodes_data.items()}
+        return nodes_data, ntags
 
-    def get_segs_data(self, ntags: dict):
+    def positions_updated(self) -> None:
+        """positions_updated: record that the node positions were changed in place
+           through the positions array of get_nodes_data(copy=False)
+        """
+        arrays = self._arrays
+        if arrays.journal is not None:
+            raise ValueError("positions_updated: not allowed during a trial")
+        arrays.node_dirty[:len(arrays.node_attrs)] = True
+
+    def get_segs_data(self, ntags: dict, copy: bool=True):
         """get_segs_data: collect segments data into a dictionary format
+           ntags: as returned by get_nodes_data (the node ids are the positions
+           of the end nodes in the nodes arrays)
+           With copy=False the arrays are views into the network storage,
+           valid until the network is next modified
         """
-        Nseg = self.num_segments()
-        nodeids = np.zeros((Nseg, 2), dtype=int)
-        burgers = np.zeros((Nseg, 3))
-        planes = np.zeros((Nseg, 3))
-        i = 0
-        for (source, target), edge_attr in self.all_segments_dict().items():
-            nodeids[i,:] = ntags[source], ntags[target]
-            burgers[i,:] = edge_attr.burg_vec_from(source)
-            planes[i,:] = edge_attr.plane_normal
-            i += 1
-        return {
-            "nodeids": nodeids,
-            "burgers": burgers,
-            "planes": planes
+        arrays = self._arrays
+        arrays.compact()
+        Nseg = arrays.num_segments()
+        segs_data = {
+            "nodeids": arrays.seg_nodes[:Nseg],
+            "burgers": arrays.burgers[:Nseg],
+            "planes": arrays.planes[:Nseg]
         }
+        if copy:
+            segs_data = {key: value.copy() for key, value in segs_data.items()}
+        return segs_data
+
+    def nodes_index(self, tags) -> np.ndarray:
+        """nodes_index: positions of the nodes with the given tags in the nodes arrays
+           (the node ids of get_segs_data and get_segs_data_with_positions)
+        """
+        self._arrays.compact()
+        return np.array([self.tags_to_nodes[tuple(tag)].attr._index for tag in tags], dtype=np.intc)
 
-    def get_segs_data_with_positions(self):
+    def get_segs_data_with_positions(self, copy: bool=True):
         """get_segs_data_with_positions: collect segments data into a dictionary format
+           the tags and end node positions (R2 as the closest image of R1) are
+           gathered from the nodes arrays; with copy=False nodeids, burgers and
+           planes are views into the network storage, valid until the network
+           is next modified
         """
-        _, ntags = self.get_nodes_data()
-        Nseg = self.num_segments()
-        nodeids = np.zeros((Nseg, 2), dtype=int)
-        tag1 = np.zeros((Nseg, 2), dtype=int)
-        tag2 = np.zeros((Nseg, 2), dtype=int)
-        burgers = np.zeros((Nseg, 3))
-        planes = np.zeros((Nseg, 3))
-        R1 = np.zeros((Nseg, 3))
-        R2 = np.zeros((Nseg, 3))
-        i = 0
-        for (source, target), edge_attr in self.all_segments_dict().items():
-            nodeids[i,:] = ntags[source], ntags[target]
-            tag1[i,:] = source
-            tag2[i,:] = target
-            burgers[i,:] = edge_attr.burg_vec_from(source).copy()
-            planes[i,:] = getattr(edge_attr, "plane_normal", np.zeros(3)).copy()
-            r1_local = self.nodes(source).R
-            r2_local = self.nodes(target).R
-            # apply PBC
-            r2_local = self.cell.closest_image(Rref=r1_local, R=r2_local)
-            R1[i,:] = r1_local
-            R2[i,:] = r2_local
-            i += 1
+        arrays = self._arrays
+        arrays.compact()
+        Nseg = arrays.num_segments()
+        nodeids = arrays.seg_nodes[:Nseg]
+        burgers, planes = arrays.burgers[:Nseg], arrays.planes[:Nseg]
+        if copy:
+            nodeids, burgers, planes = nodeids.copy(), burgers.copy(), planes.copy()
+        R1 = arrays.R[nodeids[:,0]]
+        R2 = self.cell.closest_image(Rref=R1, R=arrays.R[nodeids[:,1]])
         return {
             "nodeids": nodeids,
-            "tag1": tag1,
-            "tag2": tag2,
+            "tag1": arrays.node_tags[nodeids[:,0]],
+            "tag2": arrays.node_tags[nodeids[:,1]],
             "burgers": burgers,
             "planes":  planes,
             "R1": R1,
             "R2": R2
         }
 
+    def set_segs_planes(self, segids, planes) -> None:
+        """set_segs_planes: assign the plane normals of the segments at positions
+           segids of the segments arrays (as returned by get_segs_data)
+        """
+        arrays = self._arrays
+        arrays.compact()
+        for i, plane in zip(segids, planes):
+            arrays.seg_edges[i].attr.plane_normal = np.array(plane)
+
     def export_data(self):
         """export_data: export network to data
+           (copies, independent of later changes to the network)
         """
-        cell = {"h": self.cell.h, "origin": self.cell.origin, "is_periodic": self.cell.is_periodic}
-        nodes_data, ntags = self.get_nodes_data()
-        segs_data = self.get_segs_data(ntags)
+        cell = {"h": np.array(self.cell.h), "origin": np.array(self.cell.origin),
+                "is_periodic": list(self.cell.is_periodic)}
+        nodes_data, ntags = self.get_nodes_data(copy=True)
+        segs_data = self.get_segs_data(ntags, copy=True)
         data = {"cell": cell, "nodes": nodes_data, "segs": segs_data}
         return data
     
@@ -384,6 +678,69 @@ class DisNet(DisNet_Python):
         segs_array = np.hstack((segs_data["nodeids"], segs_data["burgers"], segs_data["planes"]))
         self.add_nodes_segments_from_list(nodes_array, segs_array)
 
+    def num_changes(self) -> int:
+        """num_changes: number of changes recorded since the last clear_changes
+           (dirty nodes and segments plus removed nodes and segments)
+        """
+        return self._arrays.num_changes()
+
+    def clear_changes(self) -> None:
+        """clear_changes: start recording changes from the current network
+        """
+        self._arrays.clear_changes()
+
+    def export_delta(self):
+        """export_delta: export the changes since the last clear_changes
+           added or modified nodes and segments, and the tags of removed ones
+        """
+        arrays = self._arrays
+        arrays.compact()
+        nd = np.flatnonzero(arrays.node_dirty[:arrays.num_nodes()])
+        sd = np.flatnonzero(arrays.seg_dirty[:arrays.num_segments()])
+        nodeids = arrays.seg_nodes[sd]
+        cell = {"h": self.cell.h, "origin": self.cell.origin, "is_periodic": self.cell.is_periodic}
+        return {
+            "cell": cell,
+            "removed_nodes": list(arrays.removed_nodes),
+            "removed_segs": list(arrays.removed_segs),
+            "nodes": {"tags": arrays.node_tags[nd], "positions": arrays.R[nd],
+                      "constraints": arrays.constraint[nd].reshape(-1, 1)},
+            "segs": {"tags1": arrays.node_tags[nodeids[:,0]], "tags2": arrays.node_tags[nodeids[:,1]],
+                     "burgers": arrays.burgers[sd], "planes": arrays.planes[sd]}
+        }
+
+    def import_delta(self, delta):
+        """import_delta: apply changes exported by export_delta
+           the network must be equal to the source network at its last clear_changes
+        """
+        cell = delta.get("cell")
+        self.cell = Cell(h=cell.get("h"), origin=cell.get("origin"), is_periodic=cell.get("is_periodic"))
+        for tag1, tag2 in delta["removed_segs"]:
+            if self.has_segment(tag1, tag2):
+                self._remove_edge(tag1, tag2)
+        for tag in delta["removed_nodes"]:
+            if self.has_node(tag):
+                self._remove_node(tag)
+        nodes = delta["nodes"]
+        for tag, R, constraint in zip(nodes["tags"], nodes["positions"], nodes["constraints"]):
+            tag = (int(tag[0]), int(tag[1]))
+            if self.has_node(tag):
+                node_attr = self.nodes(tag)
+                node_attr.R = R
+                node_attr.constraint = int(constraint[0])
+            else:
+                self._add_node(tag, DisNode(R=R.copy(), constraint=int(constraint[0])))
+        segs = delta["segs"]
+        for tag1, tag2, bv, pn in zip(segs["tags1"], segs["tags2"], segs["burgers"], segs["planes"]):
+            tag1, tag2 = (int(tag1[0]), int(tag1[1])), (int(tag2[0]), int(tag2[1]))
+            if self.has_segment(tag1, tag2):
+                edge_attr = self.segments((tag1, tag2))
+                edge_attr.burg_vec = bv if edge_attr.source_tag == tag1 else -bv
+                edge_attr.plane_normal = pn
+            else:
+                self._add_edge(tag1, tag2, DisEdge(tag1, tag2, burg_vec=bv.copy(), plane_normal=pn.copy()))
+        self._recycled_tags = [tag for tag in self._recycled_tags if not self.has_node(tag)]
+
     def copy(self):
         """copy: return a deep copy of the network
         """
@@ -403,15 +760,15 @@ class DisNet(DisNet_Python):
         import networkx as nx
         nx_graph = nx.DiGraph()
         for tag, node in self.all_nodes_mapping():
-            nx_graph.add_node(tag, **vars(node))
+            nx_graph.add_node(tag, **node.copy().view())
 
         for (source, target), edge_attr in self.all_segments_dict().items():
-            edge_dict = vars(edge_attr.copy())
+            edge_dict = edge_attr.copy().view()
             del edge_dict["source_tag"]
             edge_dict["burg_vec"] = edge_attr.burg_vec_from(source)
             nx_graph.add_edge(source, target, **edge_dict)
 
-            edge_dict = vars(edge_attr.copy())
+            edge_dict = edge_attr.copy().view()
             del edge_dict["source_tag"]
             edge_dict["burg_vec"] = edge_attr.burg_vec_from(target)
             nx_graph.add_edge(target, source, **edge_dict)
@@ -467,6 +824,8 @@ class DisNet(DisNet_Python):
         node = self.Node_with_attr(tag, node_attr)
         self.tags_to_nodes[tag] = node
         self._G.add_node(node)
+        self._arrays.add_node(tag, node_attr)
+        self._log("add_node", tag)
     
     def _add_edge(self, tag1: Tag, tag2: Tag, edge_attr: DisEdge) -> None:
         """add_edge: add an edge to the network
@@ -480,13 +839,20 @@ class DisNet(DisNet_Python):
 
         edge = self.Edge_with_attr(node1, node2, edge_attr)
         self._G.add_edge(edge)
+        self._arrays.add_segment(edge)
+        self._log("add_edge", tag1, tag2)
 
     def _remove_node(self, tag: Tag) -> None:
         """remove_edge: remove a node from the network
            user is not supposed to call this low level function, does not guarantee sanity
         """
         node = self.tags_to_nodes.pop(tag)
+        for edge in list(node.edges()):
+            self._arrays.remove_segment(edge)
+            self._log("remove_edge", edge.source.tag, edge.target.tag, edge.attr)
         self._G.remove_node(node)
+        self._arrays.remove_node(node.attr)
+        self._log("remove_node", tag, node.attr)
         self._recycled_tags.append(tag)
 
     def _remove_edge(self, tag1: Tag, tag2: Tag) -> None:
@@ -497,6 +863,8 @@ class DisNet(DisNet_Python):
         node2 = self.tags_to_nodes[tag2]
         edge = self._G.edge_between(node1, node2)
         self._G.remove_edge(edge)
+        self._arrays.remove_segment(edge)
+        self._log("remove_edge", edge.source.tag, edge.target.tag, edge.attr)
 
     def _combine_edge(self, tag1: Tag, tag2: Tag, edge_attr: DisEdge) -> None:
         """combine_edge: combine an edge with an existing edge
@@ -510,6 +878,80 @@ class DisNet(DisNet_Python):
         node2 = self.tags_to_nodes[tag2]
         self._G.edge_between(node1, node2).attr.add(edge_attr)
 
+    def _log(self, *entry) -> None:
+        """_log: record a topological edit in the journal of an open trial
+        """
+        if self._arrays.journal is not None:
+            self._arrays.journal.append(entry)
+
+    def begin_trial(self) -> None:
+        """begin_trial: start recording edits so that they can be undone by rollback_trial
+           Nodes and segments added or removed by the DisNet methods and attributes
+           assigned to are journaled, so the cost of a trial is proportional to the
+           size of the edit and not of the network.  Trials cannot be nested, and
+           clear_graph and reorder_nodes are not journaled.
+        """
+        if self._arrays.journal is not None:
+            raise ValueError("begin_trial: a trial is already open")
+        self._arrays.journal = []
+        self._trial_recycled_tags = list(self._recycled_tags)
+
+    def commit_trial(self) -> None:
+        """commit_trial: keep the edits made since begin_trial and stop recording
+        """
+        if self._arrays.journal is None:
+            raise ValueError("commit_trial: no trial is open")
+        self._arrays.journal = None
+        self._trial_recycled_tags = None
+
+    def rollback_trial(self) -> None:
+        """rollback_trial: undo the edits made since begin_trial and stop recording
+           Restored nodes and segments keep their tags and attribute objects but may
+           change position in the iteration order
+        """
+        journal = self._arrays.journal
+        if journal is None:
+            raise ValueError("rollback_trial: no trial is open")
+        self._arrays.journal = None
+        for entry in reversed(journal):
+            op = entry[0]
+            if op == "add_node":
+                self._remove_node(entry[1])
+            elif op == "remove_node":
+                self._add_node(entry[1], entry[2])
+            elif op == "add_edge":
+                self._remove_edge(entry[1], entry[2])
+            elif op == "remove_edge":
+                self._add_edge(entry[1], entry[2], entry[3])
+            else:
+                attr, name, value = entry[1:]
+                if value is None:
+                    attr._has_plane = False
+                else:
+                    setattr(attr, name, value)
+        self._recycled_tags = self._trial_recycled_tags
+        self._trial_recycled_tags = None
+
+    def reorder_nodes(self, node_tags: list) -> None:
+        """reorder_nodes: change the iteration order of nodes and segments
+           node_tags: all node tags in the new order
+           Tags and attributes are unchanged, segments are ordered by the
+           position of their first and second end node in node_tags
+        """
+        if len(node_tags) != self.num_nodes():
+            raise ValueError("reorder_nodes: expected %d tags, got %d" % (self.num_nodes(), len(node_tags)))
+        rank = {tag: i for i, tag in enumerate(node_tags)}
+        nodes = [(tag, self.nodes(tag)) for tag in node_tags]
+        segs = list(self.all_segments_dict().items())
+        segs.sort(key=lambda seg: sorted((rank[seg[0][0]], rank[seg[0][1]])))
+        recycled_tags = list(self._recycled_tags)
+        self.clear_graph()
+        for tag, node_attr in nodes:
+            self._add_node(tag, node_attr)
+        for (source, target), edge_attr in segs:
+            self._add_edge(source, target, edge_attr)
+        self._recycled_tags = recycled_tags
+
     def add_nodes_segments_from_list(self, rn, links) -> None:
         """add_nodes_segments_from_list: add nodes and edges stored in lists to network
            sanity after this operation depends on the input
@@ -560,6 +1002,18 @@ class DisNet(DisNet_Python):
             max_tag = max(self.all_nodes_tags())
             return (max_tag[0], max_tag[1]+1)
 
+    def get_new_tags(self, num: int, recycle = True) -> list:
+        """get_new_tags: return num distinct tags for new nodes, as num calls
+           to get_new_tag would if the nodes were added in between
+        """
+        num_recycled = min(num, len(self._recycled_tags)) if recycle else 0
+        new_tags = self._recycled_tags[:num_recycled]
+        del self._recycled_tags[:num_recycled]
+        if num > num_recycled:
+            max_tag = max(list(self.all_nodes_tags()) + new_tags)
+            new_tags += [(max_tag[0], max_tag[1]+i) for i in range(1, num-num_recycled+1)]
+        return new_tags
+
     def insert_node(self, tag1: Tag, tag2: Tag, new_tag: Tag, R: np.ndarray) -> None:
         insert_node_between(tag1, tag2, new_tag, R)
 
@@ -617,6 +1071,8 @@ class DisNet(DisNet_Python):
                 edges_to_remove.append(edge)
         for edge in edges_to_remove:
             self._G.remove_edge(edge)
+            self._arrays.remove_segment(edge)
+            self._log("remove_edge", edge.source.tag, edge.target.tag, edge.attr)
 
         if node.num_neighbors() == 0:
             self._remove_node(node.tag)
@@ -11,6 +11,12 @@ from framework.disnet_manager import DisNetManager
 from typing import Tuple
 Tag = Tuple[int, int]
 
+try:
+    from .mobility_paradis import node_arms_csr, mobility_simple_glide_paradis
+    found_pydis_lib = True
+except ImportError:
+    found_pydis_lib = False
+
 
 class MobilityLaw:
     """MobilityLaw: class for mobility laws
@@ -33,6 +39,10 @@ class MobilityLaw:
             DisNet.convert_nodeforce_array_to_dict(state)
 
         nodeforce_dict = state["nodeforce_dict"]
+        if self.mobility_law == 'SimpleGlide' and found_pydis_lib:
+            state["vel_dict"] = self.Mobility_SimpleGlide_Batch(G, nodeforce_dict)
+            return DisNet.convert_nodevel_dict_to_array(state)
+
         vel_dict = nodeforce_dict.copy()
         for tag in G.all_nodes_tags():
             f = vel_dict[tag].copy()
@@ -63,6 +73,18 @@ class MobilityLaw:
                 state["nodeveltags"] = np.array([tag])
         return v
     
+    def Mobility_SimpleGlide_Batch(self, G: DisNet, nodeforce_dict: dict) -> dict:
+        """Mobility_SimpleGlide_Batch: NodeMobility_SimpleGlide for all nodes in one call to libpydis
+        """
+        nodes_data, ntags = G.get_nodes_data(copy=False)
+        segs_data = G.get_segs_data(ntags, copy=False)
+        all_tags = list(ntags.keys())
+        f = np.array([nodeforce_dict[tag] for tag in all_tags]).reshape(-1, 3)
+        arm_start, arm_nbr, arm_planes = node_arms_csr(len(all_tags), segs_data["nodeids"], segs_data["planes"])
+        vel = mobility_simple_glide_paradis(nodes_data["positions"], nodes_data["constraints"], f,
+                                            arm_start, arm_nbr, arm_planes, G.cell, self.mob, self.vmax)
+        return dict(zip(all_tags, vel))
+
     def NodeMobility_Relax(self, G: DisNet, tag: Tag, f: np.array) -> np.array:
         """NodeMobility_Relax: node velocity equal node force
         """
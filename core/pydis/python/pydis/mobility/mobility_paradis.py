@@ -0,0 +1,74 @@
+import numpy as np
+from ctypes import c_double, c_int, POINTER
+real8 = c_double
+
+try:
+    pydis_lib = __import__('pydis_lib')
+    found_pydis = True
+except ImportError:
+    found_pydis = False
+    raise
+
+# buffer protocol bindings releasing the GIL (pydis_ext.c), optional
+try:
+    pydis_ext = __import__('pydis_ext')
+except ImportError:
+    pydis_ext = None
+
+def node_arms_csr(num_nodes, nodeids, planes):
+    """ arms of every node in compressed sparse row form
+    input:
+        num_nodes   number of nodes
+        nodeids     (N,2) end node indices of each segment
+        planes      (N,3) glide plane normal of each segment
+    return:
+        arm_start   (num_nodes+1,) the arms of node i are arm_start[i]:arm_start[i+1]
+        arm_nbr     (2N,) neighbor node index of each arm
+        arm_planes  (2N,3) glide plane normal of each arm
+    """
+    nodeids = np.asarray(nodeids, dtype=np.intc).reshape(-1, 2)
+    planes = np.asarray(planes, dtype=np.float64).reshape(-1, 3)
+    arm_node = np.concatenate((nodeids[:,0], nodeids[:,1]))
+    order = np.argsort(arm_node, kind='stable')
+    arm_nbr = np.concatenate((nodeids[:,1], nodeids[:,0]))[order]
+    arm_planes = np.vstack((planes, planes))[order]
+    arm_start = np.zeros(num_nodes+1, dtype=np.intc)
+    arm_start[1:] = np.cumsum(np.bincount(arm_node, minlength=num_nodes))
+    return arm_start, np.ascontiguousarray(arm_nbr, dtype=np.intc), np.ascontiguousarray(arm_planes)
+
+def mobility_simple_glide_paradis(R, constraints, nodeforces, arm_start, arm_nbr, arm_planes,
+                                  cell, mob, vmax, eps_normal=1.0e-10):
+    """ SimpleGlide velocities of all nodes (MobilitySimpleGlide)
+    input:
+        R           (Nnode,3) node positions
+        constraints (Nnode,) node constraints
+        nodeforces  (Nnode,3) nodal forces
+        arm_start, arm_nbr, arm_planes  arms of the nodes (see node_arms_csr)
+        cell        simulation cell
+        mob, vmax   mobility and maximum velocity
+    return:
+        nodevels    (Nnode,3) nodal velocities
+    """
+    R, nodeforces = (np.ascontiguousarray(x, dtype=np.float64).reshape(-1, 3) for x in (R, nodeforces))
+    constraints = np.ascontiguousarray(constraints, dtype=np.intc).reshape(-1)
+    arm_start, arm_nbr = (np.ascontiguousarray(x, dtype=np.intc) for x in (arm_start, arm_nbr))
+    arm_planes = np.ascontiguousarray(arm_planes, dtype=np.float64).reshape(-1, 3)
+    h = np.ascontiguousarray(cell.h, dtype=np.float64)
+    hinv = np.ascontiguousarray(cell.hinv, dtype=np.float64)
+    is_periodic = np.ascontiguousarray(cell.is_periodic, dtype=np.intc)
+    nodevels = np.empty_like(R)
+    if pydis_ext is not None:
+        pydis_ext.mobility_simple_glide(R, constraints, nodeforces, arm_start, arm_nbr, arm_planes,
+                                        h, hinv, is_periodic, mob, vmax, eps_normal, nodevels)
+        return nodevels
+
+    ptr = lambda x: x.ctypes.data_as(POINTER(real8))
+    iptr = lambda x: x.ctypes.data_as(POINTER(c_int))
+    pydis_lib.MobilitySimpleGlide(
+        R.shape[0], ptr(R), iptr(constraints), ptr(nodeforces),
+        iptr(arm_start), iptr(arm_nbr), ptr(arm_planes),
+        ptr(h), ptr(hinv), iptr(is_periodic),
+        mob, vmax, eps_normal, ptr(nodevels)
+    )
+
+    return nodevels
@@ -5,75 +5,339 @@ Provide neighbor list iterator given a set of points (and cell)
 """
 
 import numpy as np
+from ctypes import c_double, c_int, POINTER
 from ..disnet import DisNet, Cell
 
+try:
+    pydis_lib = __import__('pydis_lib')
+    found_pydis_lib = True
+except ImportError:
+    found_pydis_lib = False
+
 class CellList:
     """CellList: class for cell list
 
     Implements cell list for efficient neighbor search
-    Note: only works for PBC in all 3 directions
+    The cell list is stored in compressed form (CSR): the points in cell c are
+    cell_points[cell_start[c]:cell_start[c+1]], with cells numbered
+    c = (i0*n_div[1] + i1)*n_div[2] + i2.
+    Directions that are not periodic are divided over the extent of the points.
     """
     def __init__(self, cell: Cell=None, n_div: np.array=[3,3,3]) -> None:
         # To do: comput ndiv from cell and cutoff
         self.cell = Cell() if cell is None else cell
         self.n_div = n_div
-        self._cell_list = [[[ [] for n2 in range(self.n_div[2])] for n1 in range(self.n_div[1])] for n0 in range(self.n_div[0])]
+        self._cell_start = np.zeros(int(np.prod(self.n_div))+1, dtype=np.intc)
+        self._cell_points = np.zeros(0, dtype=np.intc)
+        self._point_cell = np.zeros(0, dtype=np.intc)
         self._cell_indices = None
 
+    def _cell_args(self):
+        n_div = np.ascontiguousarray(self.n_div, dtype=np.intc)
+        is_periodic = np.ascontiguousarray(self.cell.is_periodic, dtype=np.intc)
+        return n_div, is_periodic
+
     def get_cell_index(self, R: np.ndarray) -> np.ndarray:
         """get_cell_index: get cell index of a position
         """
+        R = np.asarray(R, dtype=float).reshape(-1, 3)
+        periodic = np.asarray(self.cell.is_periodic, dtype=bool)
+        n_div = np.array(self.n_div)
         s = np.dot(self.cell.hinv, R.T - np.broadcast_to(self.cell.center(), shape=R.shape).T).T
-        s -= np.round(s)
-        ind = np.floor((s+0.5)*self.n_div).astype(int)
-        ind = np.minimum(np.maximum(ind, 0), np.array(self.n_div)-1)
+        s[:, periodic] -= np.round(s[:, periodic])
+        smin, smax = -0.5*np.ones(3), 0.5*np.ones(3)
+        if R.shape[0] > 0:
+            smin[~periodic] = s[:, ~periodic].min(axis=0)
+            smax[~periodic] = s[:, ~periodic].max(axis=0)
+        span = np.where(smax > smin, smax - smin, 1.0)
+        ind = np.floor((s - smin)/span*n_div).astype(int)
+        ind = np.minimum(np.maximum(ind, 0), n_div-1)
         return ind
 
     def sort_points_to_list(self, R: np.ndarray) -> None:
         """build: build cell list
-
-        Note: only do this when PBC is applied in all 3 directions
         """
-        self._cell_list = [[[ [] for n2 in range(self.n_div[2])] for n1 in range(self.n_div[1])] for n0 in range(self.n_div[0])]
-        if all(self.cell.is_periodic):
-            self._cell_indices = self.get_cell_index(R)
-            for i, ind in enumerate(self._cell_indices):
-                self._cell_list[ind[0]][ind[1]][ind[2]].append(i)
+        R = np.ascontiguousarray(R, dtype=np.float64).reshape(-1, 3)
+        n = R.shape[0]
+        num_cells = int(np.prod(self.n_div))
+        if found_pydis_lib:
+            n_div, is_periodic = self._cell_args()
+            hinv = np.ascontiguousarray(self.cell.hinv, dtype=np.float64)
+            center = np.ascontiguousarray(self.cell.center(), dtype=np.float64)
+            self._cell_start = np.empty(num_cells+1, dtype=np.intc)
+            self._cell_points = np.empty(n, dtype=np.intc)
+            self._point_cell = np.empty(n, dtype=np.intc)
+            pydis_lib.CellListBin(
+                n, R.ctypes.data_as(POINTER(c_double)),
+                hinv.ctypes.data_as(POINTER(c_double)),
+                is_periodic.ctypes.data_as(POINTER(c_int)),
+                center.ctypes.data_as(POINTER(c_double)),
+                *(x.ctypes.data_as(POINTER(c_int)) for x in (n_div, self._cell_start, self._cell_points, self._point_cell))
+            )
         else:
-            self._cell_indices = [None]*len(R)
+            ind = self.get_cell_index(R)
+            self._point_cell = ((ind[:,0]*self.n_div[1] + ind[:,1])*self.n_div[2] + ind[:,2]).astype(np.intc)
+            self._cell_points = np.argsort(self._point_cell, kind='stable').astype(np.intc)
+            self._cell_start = np.zeros(num_cells+1, dtype=np.intc)
+            self._cell_start[1:] = np.cumsum(np.bincount(self._point_cell, minlength=num_cells))
+        n12 = self.n_div[1]*self.n_div[2]
+        c = self._point_cell.astype(int)
+        self._cell_indices = np.stack((c // n12, (c // self.n_div[2]) % self.n_div[1], c % self.n_div[2]), axis=1)
         return
 
     def get_objs_in_cell(self, ind: np.ndarray) -> list:
         """get_indices_in_cell: get indices in a cell
         """
-        return self._cell_list[ind[0]][ind[1]][ind[2]]
+        c = (ind[0]*self.n_div[1] + ind[1])*self.n_div[2] + ind[2]
+        return self._cell_points[self._cell_start[c]:self._cell_start[c+1]].tolist()
+
+    def get_nbr_cells(self, ind: np.ndarray) -> list:
+        """get_nbr_cells: distinct indices of a cell and its neighbor cells
+        """
+        nbr = []
+        for d in range(3):
+            idx = [ind[d]+k for k in (-1, 0, 1)]
+            if self.cell.is_periodic[d]:
+                idx = [i % self.n_div[d] for i in idx]
+            idx = [i for i in idx if 0 <= i < self.n_div[d]]
+            nbr.append(list(dict.fromkeys(idx)))
+        return [(i, j, k) for i in nbr[0] for j in nbr[1] for k in nbr[2]]
 
     def get_objs_in_nbr_cells(self, obj_id: int) -> list:
         """get_indices_in_cell: get indices in the same cell of a point and all neighbor cells
         """
-        ind = self._cell_indices[obj_id]
         nbr_ids = []
-        for i in range(-1, 2):
-            for j in range(-1, 2):
-                for k in range(-1, 2):
-                    ind_nbr = np.array([ind[0]+i, ind[1]+j, ind[2]+k])
-                    ind_nbr = np.mod(ind_nbr, self.n_div)
-                    nbr_ids.extend(self.get_objs_in_cell(ind_nbr))
+        for ind_nbr in self.get_nbr_cells(self._cell_indices[obj_id]):
+            nbr_ids.extend(self.get_objs_in_cell(ind_nbr))
         return nbr_ids
 
+    def get_nbr_pairs(self) -> np.ndarray:
+        """get_nbr_pairs: all pairs (i, j), i < j, of points in the same or
+        neighbor cells as an (M,2) array, ordered by i
+        """
+        n = self._point_cell.shape[0]
+        if not found_pydis_lib:
+            pairs = [(i, j) for i in range(n) for j in self.get_objs_in_nbr_cells(i) if i < j]
+            return np.array(pairs, dtype=int).reshape(-1, 2)
+        n_div, is_periodic = self._cell_args()
+        args = (n, n_div.ctypes.data_as(POINTER(c_int)), is_periodic.ctypes.data_as(POINTER(c_int)),
+                *(x.ctypes.data_as(POINTER(c_int)) for x in (self._cell_start, self._cell_points, self._point_cell)))
+        num_pairs = pydis_lib.CellListPairs(*args, 0, None)
+        pairs = np.empty((num_pairs, 2), dtype=np.intc)
+        pydis_lib.CellListPairs(*args, num_pairs, pairs.ctypes.data_as(POINTER(c_int)))
+        return pairs
+
     def iterate_nbr_pairs(self, use_cell_list: bool=True):
         """iterate_nbr_pairs: iterate over all pairs of segments in the same cell and all neighbor cells
 
         Note: self pairs (i, i) not included
         """
+        n = self._point_cell.shape[0]
         if not use_cell_list:
-            n = len(self._cell_indices)
             for i in range(n):
                 for j in range(i+1, n):
                     yield i, j
         else:
-            n = len(self._cell_indices)
-            for i in range(n):
-                nbr_ids = self.get_objs_in_nbr_cells(i)
-                for j in nbr_ids:
-                    if i < j: yield i, j
+            for i, j in self.get_nbr_pairs():
+                yield int(i), int(j)
+
+def morton_order(R: np.ndarray, cell: Cell=None) -> np.ndarray:
+    """morton_order: permutation sorting points along a Morton (Z-order) curve
+
+    Fractional coordinates (wrapped along periodic directions, scaled to the
+    extent of the points along free directions) are quantized to 21 bits and
+    interleaved, ties keep the original order.
+    """
+    cell = Cell() if cell is None else cell
+    R = np.ascontiguousarray(R, dtype=np.float64).reshape(-1, 3)
+    n = R.shape[0]
+    if n == 0:
+        return np.zeros(0, dtype=int)
+    if found_pydis_lib:
+        hinv = np.ascontiguousarray(cell.hinv, dtype=np.float64)
+        center = np.ascontiguousarray(cell.center(), dtype=np.float64)
+        is_periodic = np.ascontiguousarray(cell.is_periodic, dtype=np.intc)
+        order = np.empty(n, dtype=np.intc)
+        pydis_lib.MortonOrder(
+            n, R.ctypes.data_as(POINTER(c_double)),
+            hinv.ctypes.data_as(POINTER(c_double)),
+            is_periodic.ctypes.data_as(POINTER(c_int)),
+            center.ctypes.data_as(POINTER(c_double)),
+            order.ctypes.data_as(POINTER(c_int))
+        )
+        return order.astype(int)
+    periodic = np.asarray(cell.is_periodic, dtype=bool)
+    s = np.dot(cell.hinv, (R - cell.center()).T).T
+    s[:, periodic] -= np.round(s[:, periodic])
+    smin, smax = -0.5*np.ones(3), 0.5*np.ones(3)
+    smin[~periodic] = s[:, ~periodic].min(axis=0)
+    smax[~periodic] = s[:, ~periodic].max(axis=0)
+    max_q = (1 << 21) - 1
+    span = np.where(smax > smin, smax - smin, 1.0)
+    q = np.clip(np.floor((s - smin)/span*max_q), 0, max_q).astype(np.uint64)
+    q[:, ~(smax > smin)] = 0
+    key = np.zeros(n, dtype=np.uint64)
+    for b in range(21):
+        for d in range(3):
+            key |= ((q[:, d] >> np.uint64(b)) & np.uint64(1)) << np.uint64(3*b + d)
+    return np.argsort(key, kind='stable')
+
+def morton_reorder(G: DisNet) -> None:
+    """morton_reorder: reorder nodes and segments of G along a Morton curve
+
+    Spatially close nodes and segments become close in the nodes and segments
+    arrays, which improves memory locality in the pair loops
+    """
+    tags = list(G.all_nodes_tags())
+    if len(tags) == 0:
+        return
+    order = morton_order(G.pos_array(), G.cell)
+    G.reorder_nodes([tags[i] for i in order])
+
+class VerletList:
+    """VerletList: segment pair list with a skin, reused across timesteps
+
+    Stores the pairs of segments whose midpoint distance minus their half
+    lengths is within cutoff + 2*skin.  A segment end moving by d changes this
+    measure by at most 2*d for each of the two segments, so as long as no node
+    moved more than skin/2 since the list was built, every pair within cutoff
+    is in the list.  The list is only rebuilt (with a CellList) when this is
+    violated.  Segments are identified by the tags of their end nodes, so the
+    list survives remesh and topology changes: pairs of removed segments are
+    dropped and pairs of new segments are added against all current segments.
+    """
+    def __init__(self, cell: Cell=None, cutoff: float=0.0, skin: float=0.0) -> None:
+        self.cell = Cell() if cell is None else cell
+        self.cutoff = cutoff
+        self.skin = skin
+        self.num_builds = 0
+        self.num_updates = 0
+        self._keys = []
+        self._key_index = {}
+        self._pairs = np.zeros((0, 2), dtype=int)
+        self._ref_pos = {}
+
+    @staticmethod
+    def _segment_keys(segs_data: dict) -> list:
+        return [(tuple(t1), tuple(t2)) if tuple(t1) <= tuple(t2) else (tuple(t2), tuple(t1))
+                for t1, t2 in zip(segs_data["tag1"], segs_data["tag2"])]
+
+    @staticmethod
+    def _mid_and_half_length(segs_data: dict):
+        R1, R2 = segs_data["R1"], segs_data["R2"]
+        return 0.5*(R1 + R2), 0.5*np.linalg.norm(R2 - R1, axis=1)
+
+    def _pair_measure(self, mid, half, i, j) -> np.ndarray:
+        """midpoint distance minus half lengths, a lower bound of the distance of the segments
+        """
+        dm = self.cell.closest_image(Rref=mid[i], R=mid[j]) - mid[i]
+        return np.linalg.norm(dm.reshape(-1, 3), axis=1) - half[i] - half[j]
+
+    def _build(self, segs_data: dict, keys: list) -> None:
+        mid, half = self._mid_and_half_length(segs_data)
+        nseg = mid.shape[0]
+        radius = self.cutoff + 2.0*self.skin
+        width = radius + 2.0*(half.max() if nseg > 0 else 0.0)
+        # number of cells with widths of at least radius + longest segment
+        periodic = np.asarray(self.cell.is_periodic, dtype=bool)
+        s = np.dot(self.cell.hinv, mid.T).T if nseg > 0 else np.zeros((1, 3))
+        span = np.where(periodic, 1.0, s.max(axis=0) - s.min(axis=0))
+        cell_width = span/np.linalg.norm(self.cell.hinv, axis=1)
+        n_div = np.maximum(1, np.floor(cell_width/max(width, 1e-30))).astype(int)
+        n_div = np.minimum(n_div, max(1, nseg))
+        cl = CellList(cell=self.cell, n_div=list(n_div))
+        cl.sort_points_to_list(mid)
+        pairs = cl.get_nbr_pairs().astype(int).reshape(-1, 2)
+        if pairs.shape[0] > 0:
+            pairs = pairs[self._pair_measure(mid, half, pairs[:,0], pairs[:,1]) <= radius]
+
+        self._keys = list(keys)
+        self._key_index = {key: i for i, key in enumerate(keys)}
+        self._pairs = pairs
+        self._ref_pos = {}
+        self._set_ref_pos(segs_data, keys, overwrite=True)
+        self.num_builds += 1
+
+    def _set_ref_pos(self, segs_data: dict, keys: list, overwrite: bool=False) -> None:
+        for t1, t2, r1, r2 in zip(segs_data["tag1"], segs_data["tag2"], segs_data["R1"], segs_data["R2"]):
+            for tag, r in ((tuple(t1), r1), (tuple(t2), r2)):
+                if overwrite or tag not in self._ref_pos:
+                    self._ref_pos[tag] = r.copy()
+
+    def max_displacement(self, segs_data: dict) -> float:
+        """max_displacement: largest move of a node since the last build
+        """
+        tags, R, Rref = [], [], []
+        for t1, t2, r1, r2 in zip(segs_data["tag1"], segs_data["tag2"], segs_data["R1"], segs_data["R2"]):
+            for tag, r in ((tuple(t1), r1), (tuple(t2), r2)):
+                if tag in self._ref_pos:
+                    R.append(r)
+                    Rref.append(self._ref_pos[tag])
+        if len(R) == 0:
+            return 0.0
+        R, Rref = np.array(R), np.array(Rref)
+        dR = self.cell.closest_image(Rref=Rref, R=R) - Rref
+        return float(np.max(np.linalg.norm(dR, axis=1)))
+
+    def update(self, segs_data: dict) -> None:
+        """update: rebuild or patch the stored list for the current segments
+        """
+        keys = self._segment_keys(segs_data)
+        self.num_updates += 1
+        if self.num_builds == 0:
+            return self._build(segs_data, keys)
+        disp = self.max_displacement(segs_data)
+        if disp > 0.5*self.skin:
+            return self._build(segs_data, keys)
+
+        # drop the pairs of removed segments
+        cur_index = {key: i for i, key in enumerate(keys)}
+        alive = np.array([key in cur_index for key in self._keys], dtype=bool)
+        for k in np.nonzero(~alive)[0]:
+            # the slot stays unused, a segment re-created later gets a new one
+            self._key_index.pop(self._keys[k], None)
+        if self._pairs.shape[0] > 0:
+            self._pairs = self._pairs[alive[self._pairs[:,0]] & alive[self._pairs[:,1]]]
+
+        # add the pairs of new segments, computed at the current positions with
+        # a radius enlarged by the moves since the last build
+        new = [i for i, key in enumerate(keys) if key not in self._key_index]
+        if len(new) > 0:
+            mid, half = self._mid_and_half_length(segs_data)
+            radius = self.cutoff + 2.0*self.skin + 4.0*disp
+            for i in new:
+                self._key_index[keys[i]] = len(self._keys)
+                self._keys.append(keys[i])
+            is_new = np.zeros(len(keys), dtype=bool)
+            is_new[new] = True
+            added = []
+            for i in new:
+                j = np.arange(len(keys))
+                j = j[(j != i) & (~is_new[j] | (j > i))]
+                if j.size == 0:
+                    continue
+                j = j[self._pair_measure(mid, half, np.full(j.size, i), j) <= radius]
+                added.extend((self._key_index[keys[i]], self._key_index[keys[k]]) for k in j)
+            if len(added) > 0:
+                self._pairs = np.vstack((self._pairs, np.array(added, dtype=int)))
+            self._set_ref_pos(segs_data, keys)
+
+    def get_segment_pairs(self, segs_data: dict, cutoff: float=None) -> np.ndarray:
+        """get_segment_pairs: pairs (i, j) of current segment indices whose midpoint
+        distance minus half lengths is within cutoff (default: self.cutoff), as an
+        (M,2) array ordered by i then j
+        """
+        self.update(segs_data)
+        cutoff = self.cutoff if cutoff is None else cutoff
+        keys = self._segment_keys(segs_data)
+        cur_index = np.array([self._key_index[key] for key in keys], dtype=int)
+        to_cur = -np.ones(len(self._keys), dtype=int)
+        to_cur[cur_index] = np.arange(len(keys))
+        pairs = to_cur[self._pairs].reshape(-1, 2)
+        pairs = pairs[(pairs[:,0] >= 0) & (pairs[:,1] >= 0)]
+        pairs = np.sort(pairs, axis=1)
+        if pairs.shape[0] > 0:
+            mid, half = self._mid_and_half_length(segs_data)
+            pairs = pairs[self._pair_measure(mid, half, pairs[:,0], pairs[:,1]) <= cutoff]
+            pairs = pairs[np.lexsort((pairs[:,1], pairs[:,0]))]
+        return pairs
@@ -12,10 +12,14 @@ class Remesh:
     """Remesh: class for remeshing dislocation network
 
     """
-    def __init__(self, state: dict={}, remesh_rule: str='LengthBased') -> None:
+    def __init__(self, state: dict={}, remesh_rule: str='LengthBased', check_sane: bool=False) -> None:
         self.remesh_rule = remesh_rule
+        self.check_sane = check_sane # run the full is_sane check after each phase (debug)
         self.maxseg = state.get("maxseg", None)
         self.minseg = state.get("minseg", None)
+        self.rtol = state.get("rtol", None)
+        self.pydis_paradis = None
+        self.home = None
 
         self.Remesh_Functions = {
             'LengthBased': self.Remesh_LengthBased,
@@ -25,60 +29,105 @@ class Remesh:
         """Remesh: remesh dislocation network according to remesh_rule
         """
         G = DM.get_disnet(DisNet)
-        self.Remesh_Functions[self.remesh_rule](G)
+        self.Remesh_Functions[self.remesh_rule](G, state)
         return state
 
-    def Remesh_LengthBased(self, G: DisNet) -> None:
+    def Remesh_LengthBased(self, G: DisNet, state: dict={}) -> None:
         """Remesh_LengthBased: remesh dislocation network according to segment length
+
+        All segment lengths are computed in one pass, then the nodes to
+        coarsen out and the segments to bisect are applied as one batch each
         """
-        # mesh coarsen
-        nodes_to_remove = []
-        segs_data_with_positions = G.get_segs_data_with_positions()
-        Nseg = segs_data_with_positions["nodeids"].shape[0]
-        source_tags = segs_data_with_positions["tag1"]
-        target_tags = segs_data_with_positions["tag2"]
-        R1 = segs_data_with_positions["R1"]
-        R2 = segs_data_with_positions["R2"]
-        for i in range(Nseg):
-            tag1, tag2 = tuple(source_tags[i]), tuple(target_tags[i])
-            node1, node2 = G.nodes(tag1), G.nodes(tag2)
-            #R1, R2 = node1.R, node2.R
-            r1, r2 = R1[i,:].copy(), R2[i,:].copy()
-            # apply PBC
-            r2 = G.cell.closest_image(Rref=r1, R=r2)
-            L = np.linalg.norm(r2-r1)
-            if (L < self.minseg):
-                if G.out_degree(tag1) == 2 and node1.constraint != DisNode.Constraints.PINNED_NODE:
-                    nodes_to_remove.append(tag1)
-                elif G.out_degree(tag2) == 2 and node2.constraint != DisNode.Constraints.PINNED_NODE:
-                    nodes_to_remove.append(tag2)
-        for tag in set(nodes_to_remove):
-            if G.has_node(tag):
+        pinned = DisNode.Constraints.PINNED_NODE
+
+        # mesh coarsen: remove an unpinned two-arm end node of each short segment
+        nodes_data, _ = G.get_nodes_data()
+        segs_data = G.get_segs_data_with_positions()
+        nodeids = segs_data["nodeids"]
+        L = np.linalg.norm(segs_data["R2"] - segs_data["R1"], axis=1)
+        degree = np.bincount(nodeids.ravel(), minlength=nodes_data["tags"].shape[0])
+        removable = (degree == 2) & (nodes_data["constraints"][:,0] != pinned)
+        n1, n2 = nodeids[:,0], nodeids[:,1]
+        candidates = np.where(removable[n1], n1, np.where(removable[n2], n2, -1))[L < self.minseg]
+        candidates = np.unique(candidates[candidates >= 0])
+        for tag in list(map(tuple, nodes_data["tags"][candidates].tolist())):
+            if G.has_node(tag) and G.out_degree(tag) == 2:
                 G.remove_two_arm_node(tag)
 
-        if not G.is_sane():
+        if self.check_sane and not G.is_sane():
             raise ValueError("Remesh_LengthBased: sanity check failed 1")
 
-        # mesh refine
-        all_segments_list = list(G.all_segments_tags())
-        for tag1, tag2 in all_segments_list:
-            node1, node2 = G.nodes(tag1), G.nodes(tag2)
-            r1, r2 = node1.R.copy(), node2.R.copy()
-            # apply PBC
-            r2 = G.cell.closest_image(Rref=r1, R=r2)
-            L = np.linalg.norm(r2-r1)
-            if (L > self.maxseg) and ((node1.constraint != DisNode.Constraints.PINNED_NODE) or (node2.constraint != DisNode.Constraints.PINNED_NODE)):
-                # insert new node on segment
-                new_tag = G.get_new_tag()
-                r = (r1 + r2)/2.0
-                G.insert_node_between(tag1, tag2, new_tag, r)
-                if not G.is_sane():
-                    raise ValueError("Remesh_LengthBased: sanity check failed 1a")
-
-        if not G.is_sane():
+        # mesh refine: bisect the long segments with at least one unpinned end
+        nodes_data, _ = G.get_nodes_data()
+        segs_data = G.get_segs_data_with_positions()
+        nodeids = segs_data["nodeids"]
+        R1, R2 = segs_data["R1"], segs_data["R2"]
+        is_pinned = nodes_data["constraints"][:,0] == pinned
+        refine = (np.linalg.norm(R2 - R1, axis=1) > self.maxseg) & \
+                 ~(is_pinned[nodeids[:,0]] & is_pinned[nodeids[:,1]])
+        tags1 = list(map(tuple, segs_data["tag1"][refine].tolist()))
+        tags2 = list(map(tuple, segs_data["tag2"][refine].tolist()))
+        midpoints = 0.5 * (R1[refine] + R2[refine])
+        new_tags = G.get_new_tags(len(tags1))
+        for tag1, tag2, new_tag, r in zip(tags1, tags2, new_tags, midpoints):
+            G.insert_node_between(tag1, tag2, new_tag, r)
+
+        if self.check_sane and not G.is_sane():
             raise ValueError("Remesh_LengthBased: sanity check failed 2")
 
-    def RemeshRule_2_ParaDiS(self, G: DisNet) -> None:
+    def RemeshRule_2_ParaDiS(self, G: DisNet, state: dict={}) -> None:
         """RemeshRule_2_ParaDiS: using RemeshRule_2 of ParaDiS
+
+        The network is sent to ParaDiS home in one bulk transfer with the
+        velocities and segment forces of state, and the changes made by
+        RemeshRule_2 are applied back to G without rebuilding it
         """
-        raise NotImplementedError("RemeshRule_2_ParaDiS: not implemented yet")
+        if self.home is None:
+            from ..util.paradis_util import paradis_lib
+            self.pydis_paradis = paradis_lib()
+            self.home = self.pydis_paradis.paradis_init()
+        lib, home = self.pydis_paradis, self.home
+
+        # remesh area criteria as in SetRemainingDefaults() of ParaDiS
+        param = home.contents.param.contents
+        param.remeshRule = 2
+        param.maxSeg, param.minSeg = self.maxseg, self.minseg
+        param.rann = state.get("rann", 0.0)
+        param.remeshAreaMin = self.minseg**2 * np.sqrt(3.0) / 4.0
+        if self.rtol is not None:
+            param.remeshAreaMin = min(param.remeshAreaMin, 2.0 * self.rtol * self.maxseg)
+        param.remeshAreaMax = 0.5 * (4.0 * param.remeshAreaMin + 0.25 * np.sqrt(3.0) * self.maxseg**2)
+        # elastic constants let the force estimates correct the cached
+        # arm forces for the segments being split or merged
+        if all(k in state for k in ("mu", "nu", "a")):
+            param.shearModulus, param.pois, param.rc = state["mu"], state["nu"], state["a"]
+        lib.set_home_cell(home, G.cell)
+
+        try:
+            lib.disnet_to_home(home, G)
+            lib.set_home_state(home, state.get("vel_dict"), state.get("segforce_dict"))
+            lib.HomeClearChanges(home)
+            lib.check(lib.Remesh(home), "Remesh")
+        except ValueError:
+            # a failed call leaves home inconsistent: start over next time
+            lib.free_home(home)
+            self.home = None
+            raise
+
+        vel_changed, removed_tags = lib.home_changes_to_disnet(home, G)
+
+        # removed nodes lose their state, changed nodes take the velocity
+        # set by ParaDiS and their forces must be recomputed
+        if "vel_dict" in state:
+            for tag in removed_tags:
+                state["vel_dict"].pop(tag, None)
+            state["vel_dict"].update(vel_changed)
+        if "nodeflag_dict" in state:
+            nodeflag_dict = state["nodeflag_dict"]
+            for tag in removed_tags:
+                nodeflag_dict.pop(tag, None)
+            for tag in vel_changed:
+                nodeflag_dict[tag] = nodeflag_dict.get(tag, 0) | DisNode.Flags.NODE_RESET_FORCES
+
+        if self.check_sane and not G.is_sane():
+            raise ValueError("RemeshRule_2_ParaDiS: sanity check failed")
@@ -0,0 +1,190 @@
+"""@package docstring
+Ensemble: run many independent SimulateNetwork simulations in one process
+
+The simulations (members) of an ensemble differ only in their setup, e.g.
+the applied stress or the orientation of a Frank-Read source, and run
+concurrently over a thread or a process pool. With threads the members
+share the loaded library and its read-only tables (quadrature, kernel
+dispatch), and the all-pairs elasticity forces of the members can be
+evaluated together in one native call (ForceBatcher), so the SIMD and
+OpenMP paths of the kernels get the work of the whole ensemble.
+"""
+
+import numpy as np
+import threading
+from concurrent.futures import ThreadPoolExecutor, ProcessPoolExecutor
+
+try:
+    from ..calforce.compute_stress_force_analytic_paradis import compute_segseg_force_all_pairs_multi
+except ImportError:
+    compute_segseg_force_all_pairs_multi = None
+
+class ForceBatcher:
+    """ForceBatcher: evaluate the all-pairs elasticity forces of several networks in one native call
+
+    Every running member calls evaluate() (through CalForce.batcher) and
+    waits until all running members have called it or left; the requests
+    with the same elastic constants, quadrature and cell are then
+    concatenated and computed by SegSegForceAllPairsMulti over the pairs
+    within each network, and the forces split back to the members.
+    """
+    def __init__(self) -> None:
+        self._cond = threading.Condition()
+        self._active = 0
+        self._pending = {}
+        self._results = {}
+        self.num_calls = 0
+        self.num_requests = 0
+
+    def join(self) -> None:
+        """join: count the calling thread as a running member
+        """
+        with self._cond:
+            self._active += 1
+
+    def leave(self) -> None:
+        """leave: the calling member is done, flush the requests waiting for it
+        """
+        with self._cond:
+            self._active -= 1
+            if self._pending and len(self._pending) >= self._active:
+                self._flush()
+
+    def evaluate(self, num_nodes, nodeids, R1, R2, burgers, cell, mu, nu, a,
+                 quad_points=None, weights=None):
+        """evaluate: same arguments and results as compute_segseg_force_all_pairs
+        """
+        key = threading.get_ident()
+        request = (num_nodes, np.asarray(nodeids, dtype=np.intc).reshape(-1, 2),
+                   np.asarray(R1, dtype=np.float64).reshape(-1, 3),
+                   np.asarray(R2, dtype=np.float64).reshape(-1, 3),
+                   np.asarray(burgers, dtype=np.float64).reshape(-1, 3),
+                   cell, mu, nu, a, quad_points, weights)
+        with self._cond:
+            self._pending[key] = request
+            if len(self._pending) >= self._active:
+                self._flush()
+            while key not in self._results:
+                self._cond.wait()
+            result = self._results.pop(key)
+        if isinstance(result, Exception):
+            raise result
+        return result
+
+    @staticmethod
+    def _group_key(request) -> tuple:
+        cell, mu, nu, a, quad_points = request[5:10]
+        quad = None if quad_points is None else tuple(np.asarray(quad_points).tolist())
+        return (mu, nu, a, quad, np.asarray(cell.h, dtype=np.float64).tobytes(),
+                tuple(bool(p) for p in cell.is_periodic))
+
+    def _flush(self) -> None:
+        """_flush: compute all pending requests (called with the lock held)
+        """
+        groups = {}
+        for key, request in self._pending.items():
+            groups.setdefault(self._group_key(request), []).append((key, request))
+        self._pending = {}
+        for members in groups.values():
+            try:
+                results = self._compute([request for _, request in members])
+            except Exception as e:
+                results = [e] * len(members)
+            for (key, _), result in zip(members, results):
+                self._results[key] = result
+            self.num_calls += 1
+            self.num_requests += len(members)
+        self._cond.notify_all()
+
+    @staticmethod
+    def _compute(requests: list) -> list:
+        """_compute: forces of the requests of one group in one SegSegForceAllPairsMulti call
+        """
+        num_nodes = [r[0] for r in requests]
+        num_segs = [r[1].shape[0] for r in requests]
+        node_offset = np.concatenate(([0], np.cumsum(num_nodes)))
+        seg_offset = np.concatenate(([0], np.cumsum(num_segs)))
+        nodeids = np.vstack([r[1] + node_offset[i] for i, r in enumerate(requests)])
+        R1, R2, burgers = (np.vstack([r[k] for r in requests]) for k in (2, 3, 4))
+
+        cell, mu, nu, a, quad_points, weights = requests[0][5:11]
+        fseg, fnode = compute_segseg_force_all_pairs_multi(
+            int(node_offset[-1]), seg_offset, nodeids, R1, R2, burgers, cell,
+            mu, nu, a, quad_points, weights)
+        return [(fseg[seg_offset[i]:seg_offset[i+1]], fnode[node_offset[i]:node_offset[i+1]])
+                for i in range(len(requests))]
+
+def batchable(sim) -> bool:
+    """batchable: if the forces of sim go through the all-pairs elasticity driver at every step
+    """
+    calforce = sim.calforce
+    return (compute_segseg_force_all_pairs_multi is not None and not sim.fused_step
+            and getattr(calforce, "force_mode", None) in ('Elasticity_SBA', 'Elasticity_SBN1_SBA')
+            and not calforce.incremental and calforce.frozen_tol is None
+            and not calforce.use_device and calforce.decomp is None)
+
+def _run_member(build, param, batcher=None):
+    """_run_member: build and run one member, return its final network data and state
+    """
+    sim, DM, state = build(param)
+    if batcher is not None and batchable(sim):
+        sim.calforce.batcher = batcher
+        batcher.join()
+        try:
+            state = sim.run(DM, state)
+        finally:
+            batcher.leave()
+            sim.calforce.batcher = None
+    else:
+        state = sim.run(DM, state)
+    return DM.export_data(), state
+
+class SimulateEnsemble:
+    """SimulateEnsemble: run one SimulateNetwork per parameter concurrently
+
+    build(param) returns the (sim, DM, state) of the member for param, it
+    is called in the worker running the member (so that with processes
+    nothing but param and the results crosses the process boundary).
+
+    executor: 'thread' (default; the native library is reentrant and
+              releases the GIL in its kernels), 'process' (one python
+              process per worker, each running many members with a single
+              import and library setup; build must be picklable, i.e. a
+              module level function) or 'serial'
+    batch_forces: with threads, evaluate the all-pairs elasticity forces
+              of the members sharing elastic constants and cell in one
+              native call (ForceBatcher); the running members then
+              advance in lock step
+    """
+    def __init__(self, build, params: list, executor: str='thread',
+                 max_workers: int=None, batch_forces: bool=False) -> None:
+        if executor not in ('thread', 'process', 'serial'):
+            raise ValueError("SimulateEnsemble: unknown executor %s" % executor)
+        if batch_forces and executor != 'thread':
+            raise ValueError("SimulateEnsemble: batch_forces requires executor='thread'")
+        self.build = build
+        self.params = list(params)
+        self.executor = executor
+        self.max_workers = max_workers
+        self.batch_forces = batch_forces
+        self.batcher = None
+
+    def run(self) -> list:
+        """run: run all members, return their (network data, state) in the order of params
+
+        The network data is that of DisNetManager.export_data.
+        """
+        if self.executor == 'serial' or not self.params:
+            return [_run_member(self.build, param) for param in self.params]
+
+        if self.executor == 'process':
+            with ProcessPoolExecutor(max_workers=self.max_workers) as pool:
+                futures = [pool.submit(_run_member, self.build, param) for param in self.params]
+                return [f.result() for f in futures]
+
+        # only the members running in a worker take part in a batch, the
+        # others join when a worker becomes free
+        self.batcher = ForceBatcher() if self.batch_forces else None
+        with ThreadPoolExecutor(max_workers=self.max_workers) as pool:
+            futures = [pool.submit(_run_member, self.build, param, self.batcher) for param in self.params]
+            return [f.result() for f in futures]
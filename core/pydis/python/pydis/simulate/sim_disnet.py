@@ -11,7 +11,23 @@ from ..calforce.calforce_disnet import CalForce
 from ..mobility.mobility_disnet import MobilityLaw
 from ..timeint.timeint_disnet import TimeIntegration
 from ..visualize.vis_disnet import VisualizeNetwork
+from ..visualize.vis_lod import LODVisualizer
+from ..nbrlist.nbrlist import morton_reorder
+from ..calforce.calforce_disnet import voigt_vector_to_tensor
 from framework.disnet_manager import DisNetManager
+from framework.output_writer import OutputWriter, snapshot
+from framework.trajectory import TrajectoryWriter
+from framework.profiler import Profiler, NullProfiler
+
+try:
+    from ..calforce.compute_stress_force_analytic_paradis import compute_node_step_euler_forward
+except ImportError:
+    compute_node_step_euler_forward = None
+
+try:
+    from ..util.native_profile import NativeProfile
+except ImportError:
+    NativeProfile = None
 
 try:
     import matplotlib.pyplot as plt
@@ -22,6 +38,17 @@ except ImportError:
     print(' cannot import matplotlib or mpl_toolkits')
     print('-----------------------------------------')
 
+def write_pickle(filename: str, obj) -> None:
+    with open(filename, 'wb') as file:
+        pickle.dump(obj, file)
+
+class SyncWriter:
+    """SyncWriter: run output jobs immediately (same interface as OutputWriter)
+    """
+    @staticmethod
+    def submit(func, *args, **kwargs) -> None:
+        func(*args, **kwargs)
+
 class SimulateNetwork:
     """SimulateNetwork: class for simulating dislocation network
 
@@ -39,6 +66,18 @@ class SimulateNetwork:
                  write_freq: int=None,
                  write_dir: str=".",
                  save_state: bool=False,
+                 write_format: str='json',
+                 async_write: bool=False,
+                 write_queue: int=2,
+                 trajectory_freq: int=None,
+                 trajectory_file: str="trajectory.dtraj",
+                 trajectory_keyframe: int=50,
+                 trajectory_quantum: float=None,
+                 profile=False,
+                 profile_file: str=None,
+                 reorder_freq: int=None,
+                 fused_step: bool=False,
+                 state_dicts: bool=None,
                  **kwargs) -> None:
         self.calforce = calforce
         self.mobility = mobility
@@ -58,38 +97,212 @@ class SimulateNetwork:
         self.write_freq = write_freq
         self.write_dir = write_dir
         self.save_state = save_state
+        # 'json' (write_json, state pickled) or 'checkpoint' (binary
+        # write_checkpoint, state arrays stored in the same file)
+        if write_format not in ('json', 'checkpoint'):
+            raise ValueError("SimulateNetwork: unknown write_format %s" % write_format)
+        self.write_format = write_format
+        # hand output to a background writer (framework.output_writer),
+        # with at most write_queue snapshots pending
+        self.async_write = async_write
+        self.write_queue = write_queue
+        # delta compressed trajectory (framework.trajectory) recorded every
+        # trajectory_freq steps to trajectory_file in write_dir
+        self.trajectory_freq = trajectory_freq
+        self.trajectory_file = trajectory_file
+        self.trajectory_keyframe = trajectory_keyframe
+        self.trajectory_quantum = trajectory_quantum
+        # per phase wall time and counters of every step, in python and in
+        # the native kernels (profile may also be a framework.profiler.Profiler);
+        # profile_file in write_dir receives one JSON line per step
+        if isinstance(profile, (Profiler, NullProfiler)):
+            self.profiler = profile
+        elif profile:
+            native = NativeProfile() if NativeProfile is not None else None
+            dump_file = os.path.join(write_dir, profile_file) if profile_file is not None else None
+            self.profiler = Profiler(native=native, dump_file=dump_file)
+        else:
+            self.profiler = NullProfiler()
+        # reorder nodes and segments along a Morton curve every reorder_freq steps
+        self.reorder_freq = reorder_freq
+        # force, mobility and time integration in one native call on the
+        # network arrays (see step_fused); the per node dictionaries of state
+        # are then only built if state_dicts is set, by default if a later
+        # module of the step reads them
+        self.fused_step = fused_step
+        self.state_dicts = (topology is not None or remesh is not None) if state_dicts is None else state_dicts
+        if fused_step:
+            if compute_node_step_euler_forward is None:
+                raise ValueError("SimulateNetwork: fused_step requires pydis_lib")
+            self.fused_modes = self.FusedStepModes()
 
         state["applied_stress"] = np.array(applied_stress)
 
     def step(self, DM: DisNetManager, state: dict):
         """step: take a time step of DD simulation on DisNet G
         """
-        state = self.calforce.NodeForce(DM, state)
+        prof = self.profiler
+        if self.fused_step:
+            with prof.phase("integrate"):
+                state = self.step_fused(DM, state)
+        else:
+            with prof.phase("force"):
+                state = self.calforce.NodeForce(DM, state)
 
-        state = self.mobility.Mobility(DM, state)
+            with prof.phase("mobility"):
+                state = self.mobility.Mobility(DM, state)
 
-        state = self.timeint.Update(DM, state)
+            with prof.phase("integrate"):
+                state = self.timeint.Update(DM, state)
         
         if self.cross_slip is not None:
-            self.cross_slip.Handle(DM, state)
+            with prof.phase("cross_slip"):
+                self.cross_slip.Handle(DM, state)
         
         if self.topology is not None:
-            state = self.topology.Handle(DM, state)
+            with prof.phase("topology"):
+                state = self.topology.Handle(DM, state)
 
         if self.collision is not None:
-            state = self.collision.HandleCol(DM, state)
+            with prof.phase("collision"):
+                state = self.collision.HandleCol(DM, state)
 
         if self.remesh is not None:
-            state = self.remesh.Remesh(DM, state)
+            with prof.phase("remesh"):
+                state = self.remesh.Remesh(DM, state)
+
+        return state
+
+    def FusedStepModes(self) -> tuple:
+        """FusedStepModes: force and mobility modes of NodeStepEulerForward for the modules of the step
+        """
+        quad_points = np.array([-0.774596669241483, 0.0, 0.774596669241483])
+        weights = np.array([0.555555555555556, 0.888888888888889, 0.555555555555556])
+        force_modes = {
+            'LineTension': (0, None, None),
+            'Elasticity_SBA': (1, None, None),
+            'Elasticity_SBN1_SBA': (1, quad_points, weights) }
+        mobility_modes = { 'Relax': 0 }
+        force_mode = getattr(self.calforce, "force_mode", None)
+        mobility_law = getattr(self.mobility, "mobility_law", None)
+        integrator = getattr(self.timeint, "integrator", None)
+        if force_mode not in force_modes or getattr(self.calforce, "incremental", False) \
+           or getattr(self.calforce, "frozen_tol", None) is not None \
+           or getattr(self.calforce, "use_device", False):
+            raise ValueError("SimulateNetwork: fused_step does not support force_mode %s" % force_mode)
+        if mobility_law not in mobility_modes:
+            raise ValueError("SimulateNetwork: fused_step does not support mobility_law %s" % mobility_law)
+        if integrator != 'EulerForward':
+            raise ValueError("SimulateNetwork: fused_step does not support integrator %s" % integrator)
+        return force_modes[force_mode], mobility_modes[mobility_law]
+
+    def step_fused(self, DM: DisNetManager, state: dict) -> dict:
+        """step_fused: nodal forces, velocities and forward Euler update in one native call
+
+        Works in place on the node position array of the network. State
+        receives the nodeforces/nodevels arrays (and their tags) as given
+        by the exadis compatible modules, the per node dictionaries are
+        only built if self.state_dicts is set. The positions at the
+        beginning of the step are left in state["oldpos_dict"], as by
+        TimeIntegration.Update.
+        """
+        G = DM.get_disnet(DisNet)
+        state["oldpos_dict"] = G.positions_dict()
+        (force_mode, quad_points, weights), mobility_mode = self.fused_modes
+        nodes_data, ntags = G.get_nodes_data(copy=False)
+        segs_data = G.get_segs_data(ntags, copy=False)
+        sigext = voigt_vector_to_tensor(state["applied_stress"])
+        calforce = self.calforce
+
+        # plastic strain of the step accumulated in the same native call
+        plastic_strain = getattr(self.timeint, "plastic_strain", False)
+        strain_args = {"planes": segs_data["planes"], "slip_systems": self.timeint.slip_systems} \
+            if plastic_strain else {}
 
+        result = compute_node_step_euler_forward(
+            nodes_data["positions"], nodes_data["constraints"],
+            segs_data["nodeids"], segs_data["burgers"], G.cell, sigext,
+            force_mode, calforce.mu, calforce.nu, calforce.a, calforce.Ec,
+            self.timeint.dt, quad_points, weights, mobility_mode, **strain_args)
+        G.positions_updated()
+        fseg, fnode, vnode = result[:3]
+        if plastic_strain:
+            volume = abs(np.linalg.det(np.array(G.cell.h)))
+            state = self.timeint.AccumulatePlasticStrain(state, result[3], volume)
+
+        tags = nodes_data["tags"].copy()
+        state["nodeforces"], state["nodeforcetags"] = fnode, tags
+        state["nodevels"], state["nodeveltags"] = vnode, tags
+        state["dt"] = self.timeint.dt
+        if self.state_dicts:
+            state = DisNet.convert_nodeforce_array_to_dict(state)
+            state = DisNet.convert_nodevel_array_to_dict(state)
+            nodeids = segs_data["nodeids"]
+            state["segforce_dict"] = dict(zip(zip(map(tuple, tags[nodeids[:,0]]), map(tuple, tags[nodeids[:,1]])), fseg))
+        else:
+            for key in ("nodeforce_dict", "vel_dict", "segforce_dict"):
+                state.pop(key, None)
         return state
 
+    def write_output(self, DM: DisNetManager, state: dict, tstep: int, writer=None) -> None:
+        """write_output: write the network (and the state if save_state is set) of step tstep
+
+        With a writer (OutputWriter), the network and state are snapshot
+        and written in the background.
+        """
+        save_state = state if self.save_state else None
+        if writer is not None:
+            data = DM.snapshot_data()
+            save_state = snapshot(save_state)
+        else:
+            data = None
+            writer = SyncWriter
+
+        if self.write_format == 'checkpoint':
+            writer.submit(DM.write_checkpoint, os.path.join(self.write_dir, f'disnet_{tstep}.ckpt'),
+                          save_state, data)
+        else:
+            writer.submit(DM.write_json, os.path.join(self.write_dir, f'disnet_{tstep}.json'), data)
+            if save_state is not None:
+                writer.submit(write_pickle, os.path.join(self.write_dir, f'state_{tstep}.pickle'), save_state)
+
+    def write_trajectory(self, DM: DisNetManager, tstep: int, trajectory, writer=None) -> None:
+        """write_trajectory: append the network of step tstep to the trajectory
+        """
+        if writer is not None:
+            writer.submit(trajectory.append, tstep, DM.snapshot_data())
+        else:
+            trajectory.append(tstep, DM.export_data())
+
     def run(self, DM: DisNetManager, state: dict):
-        if self.write_freq != None:
+        if self.write_freq != None or self.trajectory_freq != None:
             os.makedirs(self.write_dir, exist_ok=True)
+        writes = self.write_freq != None or self.trajectory_freq != None
+        writer = OutputWriter(self.write_queue) if self.async_write and writes else None
+        trajectory = None
+        if self.trajectory_freq != None:
+            trajectory = TrajectoryWriter(os.path.join(self.write_dir, self.trajectory_file),
+                                          keyframe_interval=self.trajectory_keyframe,
+                                          quantum=self.trajectory_quantum)
+        try:
+            return self.run_steps(DM, state, writer, trajectory)
+        finally:
+            if writer is not None:
+                writer.close()
+            if trajectory is not None:
+                trajectory.close()
+            if isinstance(self.vis, LODVisualizer):
+                self.vis.close()
+            self.profiler.close()
 
+    def run_steps(self, DM: DisNetManager, state: dict, writer=None, trajectory=None):
+        """run_steps: time loop of run, output going through writer if given
+        """
         G = DM.get_disnet(DisNet)
-        if self.plot_freq != None:
+        # a LODVisualizer renders or exports in the background, the others
+        # plot with pyplot here
+        lod = isinstance(self.vis, LODVisualizer)
+        if self.plot_freq != None and not lod:
             try: 
                 fig = plt.figure(figsize=(8,8))
                 ax = plt.axes(projection='3d')
@@ -97,15 +310,29 @@ class SimulateNetwork:
             # plot initial configuration
             self.vis.plot_disnet(G, fig=fig, ax=ax, trim=True, block=False)
 
+        prof = self.profiler
         for tstep in range(self.max_step):
-            self.step(DM, state)
+            prof.begin_step(tstep)
+            if self.reorder_freq != None:
+                if tstep % self.reorder_freq == 0:
+                    with prof.phase("reorder"):
+                        morton_reorder(DM.get_disnet(DisNet))
+
+            with prof.phase("step"):
+                self.step(DM, state)
 
-            if self.write_freq != None:
-                if tstep % self.write_freq == 0:
-                    DM.write_json(os.path.join(self.write_dir, f'disnet_{tstep}.json'))
-                    if self.save_state:
-                        with open(os.path.join(self.write_dir, f'state_{tstep}.pickle'), 'wb') as file:
-                            pickle.dump(state, file)
+            with prof.phase("output"):
+                if self.write_freq != None:
+                    if tstep % self.write_freq == 0:
+                        self.write_output(DM, state, tstep, writer)
+
+                if trajectory is not None:
+                    if tstep % self.trajectory_freq == 0:
+                        self.write_trajectory(DM, tstep, trajectory, writer)
+
+            prof.count("step_nodes", DM.num_nodes())
+            prof.count("step_segments", DM.num_segments())
+            prof.end_step()
 
             if self.print_freq != None:
                 if tstep % self.print_freq == 0:
@@ -114,11 +341,18 @@ class SimulateNetwork:
             G = DM.get_disnet(DisNet)
             if self.plot_freq != None:
                 if tstep % self.plot_freq == 0:
-                    self.vis.plot_disnet(G, fig=fig, ax=ax, trim=True, block=False, pause_seconds=self.plot_pause_seconds)
+                    if lod:
+                        self.vis.submit(DM, tstep)
+                    else:
+                        self.vis.plot_disnet(G, fig=fig, ax=ax, trim=True, block=False, pause_seconds=self.plot_pause_seconds)
 
         # plot final configuration
         if self.plot_freq != None:
-            G = DM.get_disnet(DisNet)
-            self.vis.plot_disnet(G, fig=fig, ax=ax, trim=True, block=False)
+            if lod:
+                if self.max_step > 0 and self.vis.last_step != self.max_step-1:
+                    self.vis.submit(DM, self.max_step-1, block=True)
+            else:
+                G = DM.get_disnet(DisNet)
+                self.vis.plot_disnet(G, fig=fig, ax=ax, trim=True, block=False)
 
         return state
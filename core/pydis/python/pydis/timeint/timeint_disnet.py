@@ -4,33 +4,137 @@ TimeInt_DisNet: class for Time Integration
 Provide time integration functions given a DisNet object
 """
 
+import warnings
 import numpy as np
 from ..disnet import DisNet
+from ..nbrlist.nbrlist import VerletList
 from framework.disnet_manager import DisNetManager
 
+try:
+    from ..calforce.compute_stress_force_analytic_paradis import compute_segseg_force_pair_list
+    from ..calforce.compute_stress_force_analytic_paradis import compute_plastic_strain_increment
+except ImportError:
+    compute_segseg_force_pair_list = None
+    compute_plastic_strain_increment = None
+
 class TimeIntegration:
     """TimeIntegration: class for time integration
 
     """
     def __init__(self, state: dict={}, integrator: str='EulerForward',
-                 dt: float=1e-8) -> None:
+                 dt: float=1e-8, force=None, mobility=None,
+                 rtol: float=None, dtmax: float=1e-7,
+                 dt_increment: float=1.2, dt_decrement: float=0.5,
+                 dt_exponent: float=4.0, max_trials: int=20,
+                 rgroups: list=None, plastic_strain: bool=False,
+                 slip_systems=None) -> None:
         self.integrator = integrator
         self.dt = dt
+        # force and mobility modules evaluated at the trial positions of the
+        # error controlled integrators
+        self.force = force
+        self.mobility = mobility
+        # error control as in the trapezoid integrator of ParaDiS (rTol,
+        # maxDT, dtIncrementFact, dtDecrementFact, dtExponent)
+        self.rtol = state.get("rtol", rtol)
+        if self.rtol is None and "a" in state:
+            self.rtol = 0.25 * state["a"]
+        self.dtmax = dtmax
+        self.dt_increment = dt_increment
+        self.dt_decrement = dt_decrement
+        self.dt_exponent = dt_exponent
+        self.max_trials = max_trials
+        self.next_dt = dt
+        # subcycling: increasing pair distances [r0, r1, .., rn] delimiting
+        # the short range groups, group k holding the pairs of unconnected
+        # segments at distance in [r(k-1), r(k)) (see Update_Subcycling)
+        self.rgroups = None if rgroups is None else sorted(rgroups)
+        self.next_dt_sub = None
+        self._verlet = None
+        # plastic strain, spin and dislocation density accumulated in state
+        # from the areas swept by the segments in every step (see
+        # AccumulatePlasticStrain), slip_systems a (burgers (S,3), planes
+        # (S,3)) pair for the per slip system densities and shears
+        self.plastic_strain = plastic_strain
+        self.slip_systems = slip_systems
+        if plastic_strain and compute_plastic_strain_increment is None:
+            raise ValueError("TimeIntegration: plastic_strain requires pydis_lib")
 
         self.Update_Functions = {
             'EulerForward': self.Update_EulerForward }
-        
+
+        if integrator in ('Trapezoid', 'Subcycling'):
+            if force is None or mobility is None:
+                raise ValueError("TimeIntegration: %s requires force and mobility modules" % integrator)
+            if self.rtol is None:
+                raise ValueError("TimeIntegration: %s requires rtol (or a in state)" % integrator)
+        if integrator == 'Subcycling':
+            if self.rgroups is None or len(self.rgroups) < 2:
+                raise ValueError("TimeIntegration: Subcycling requires at least two rgroups")
+            if compute_segseg_force_pair_list is None:
+                raise ValueError("TimeIntegration: Subcycling requires pydis_lib")
+            self.next_dt_sub = [dt] * (len(self.rgroups) - 1)
+
     def Update(self, DM: DisNetManager, state: dict) -> None:
         """TimeIntegration: update node position given velocity
+
+        The node positions at the beginning of the step are left in
+        state["oldpos_dict"] for the retroactive collision handling.
         """
         G = DM.get_disnet(DisNet)
+        state["oldpos_dict"] = G.positions_dict()
         if "nodevels" in state and "nodeveltags" in state:
             DisNet.convert_nodevel_array_to_dict(state)
 
-        vel_dict = state["vel_dict"]
-        applied_stress = state["applied_stress"]
-        self.Update_Functions[self.integrator](G, vel_dict, applied_stress)
-        state["dt"] = self.dt
+        if self.plastic_strain:
+            segs_data = G.get_segs_data_with_positions()
+            nodeids, R1, R2 = segs_data["nodeids"], segs_data["R1"], segs_data["R2"]
+            burgers, planes = segs_data["burgers"], segs_data["planes"]
+            R0 = G.get_nodes_data()[0]["positions"]
+
+        if self.integrator == 'Trapezoid':
+            state = self.Update_Trapezoid(DM, state)
+        elif self.integrator == 'Subcycling':
+            state = self.Update_Subcycling(DM, state)
+        else:
+            vel_dict = state["vel_dict"]
+            applied_stress = state["applied_stress"]
+            self.Update_Functions[self.integrator](G, vel_dict, applied_stress)
+            state["dt"] = self.dt
+
+        if self.plastic_strain:
+            R = G.get_nodes_data(copy=False)[0]["positions"]
+            disp = G.cell.closest_image(Rref=R0, R=R) - R0 if R0.shape[0] > 0 else np.zeros((0, 3))
+            volume = abs(np.linalg.det(np.array(G.cell.h)))
+            strain = compute_plastic_strain_increment(nodeids, R1, R2, disp.reshape(-1, 3), burgers,
+                                                      planes, volume, self.slip_systems)
+            state = self.AccumulatePlasticStrain(state, strain, volume)
+        return state
+
+    def AccumulatePlasticStrain(self, state: dict, strain: dict, volume: float) -> dict:
+        """AccumulatePlasticStrain: add the plastic strain increment of a step to state
+
+        strain as returned by compute_plastic_strain_increment. Sets the
+        increments and totals of plastic_strain (xx, yy, zz, yz, xz, xy as
+        applied_stress) and plastic_spin (yz, xz, xy), the dislocation
+        density (line length per volume, divided by burgmag**2 if in state)
+        and, for slip_systems, slip_system_density, slip_system_strain_increment
+        and slip_system_strain (resolved shears).
+        """
+        scale = 1.0 / volume
+        if "burgmag" in state:
+            scale /= state["burgmag"] ** 2
+
+        state["plastic_strain_increment"] = strain["plastic_strain"]
+        state["plastic_strain"] = state.get("plastic_strain", np.zeros(6)) + strain["plastic_strain"]
+        state["plastic_spin_increment"] = strain["plastic_spin"]
+        state["plastic_spin"] = state.get("plastic_spin", np.zeros(3)) + strain["plastic_spin"]
+        state["density"] = strain["length"] * scale
+        if self.slip_systems is not None:
+            sys_shear = strain["slip_system_shear"]
+            state["slip_system_density"] = strain["slip_system_length"] * scale
+            state["slip_system_strain_increment"] = sys_shear
+            state["slip_system_strain"] = state.get("slip_system_strain", np.zeros_like(sys_shear)) + sys_shear
         return state
 
     def Update_EulerForward(self, G: DisNet, vel_dict: dict, applied_stress: np.ndarray) -> None:
@@ -38,3 +142,251 @@ class TimeIntegration:
         """
         for tag, vel in vel_dict.items():
             G.nodes(tag).R += vel * self.dt
+
+
+    def NodeVelocities(self, DM: DisNetManager, state: dict, nodeforce_dict: dict, tags: list) -> np.ndarray:
+        """NodeVelocities: velocities (len(tags),3) of the mobility module for the given node forces
+        """
+        state["nodeforce_dict"] = nodeforce_dict
+        state = DisNet.convert_nodeforce_dict_to_array(state)
+        state = self.mobility.Mobility(DM, state)
+        vel_dict = state["vel_dict"]
+        return np.array([vel_dict.get(tag, np.zeros(3)) for tag in tags])
+
+    def TrapezoidStep(self, DM: DisNetManager, state: dict, tags: list, V0: np.ndarray,
+                      velocity_func, dt: float):
+        """TrapezoidStep: one error controlled trapezoid step of the nodes of tags
+
+        velocity_func(DM, state) returns the velocities (len(tags),3) at the
+        current positions of the network and V0 those at the start of the
+        step. The step is retried with dt reduced by dt_decrement until the
+        corrector and predictor positions of every node are within rtol.
+        If they are still not after max_trials, the last step is taken
+        uncontrolled with a warning and counted in state["dt_uncontrolled"],
+        its error being left in state["dt_uncontrolled_err"].
+        Leaves the nodes at the corrector positions and returns the mean
+        velocity of the step, the dt taken and the dt to attempt next.
+        """
+        G = DM.get_disnet(DisNet)
+        R0 = np.array([G.nodes(tag).R for tag in tags])
+
+        for trial in range(self.max_trials):
+            Rp = R0 + V0 * dt
+            for i, tag in enumerate(tags):
+                G.nodes(tag).R = Rp[i]
+
+            V1 = velocity_func(DM, state)
+
+            R1 = R0 + 0.5 * (V0 + V1) * dt
+            err = np.max(np.linalg.norm(R1 - Rp, axis=1))
+            if err <= self.rtol:
+                break
+            if trial == self.max_trials - 1:
+                warnings.warn("TimeIntegration: step error %e above rtol %e after %d trials, "
+                              "taking dt = %e uncontrolled" % (err, self.rtol, self.max_trials, dt),
+                              RuntimeWarning)
+                state["dt_uncontrolled"] = state.get("dt_uncontrolled", 0) + 1
+                state["dt_uncontrolled_err"] = err
+                break
+            dt *= self.dt_decrement
+
+        for i, tag in enumerate(tags):
+            G.nodes(tag).R = R1[i]
+
+        next_dt = dt
+        if trial == 0:
+            factor = self.dt_increment
+            if err > 0.0:
+                factor = min(factor, (self.rtol / err) ** (1.0 / self.dt_exponent))
+            next_dt = min(self.dtmax, dt * max(factor, 1.0))
+
+        return 0.5 * (V0 + V1), dt, next_dt
+
+    def Update_Trapezoid(self, DM: DisNetManager, state: dict) -> dict:
+        """TimeIntegration_Trapezoid: error controlled trapezoid time integration
+
+        Forward Euler predictor followed by a trapezoid corrector that uses
+        the velocities re-evaluated at the predicted positions. The step is
+        accepted when no node's corrector and predictor positions differ by
+        more than rtol; otherwise the positions are restored and the step is
+        retried with dt reduced by dt_decrement. After an accepted step the
+        next dt is grown by up to dt_increment, scaled by
+        (rtol/err)**(1/dt_exponent), and capped at dtmax.
+        On return vel_dict holds the mean velocity (R1-R0)/dt of the step.
+        """
+        vel_dict = state["vel_dict"]
+        tags = list(vel_dict.keys())
+        if len(tags) == 0:
+            state["dt"] = self.dt
+            return state
+
+        def velocity_func(DM, state):
+            state = self.force.NodeForce(DM, state)
+            state = self.mobility.Mobility(DM, state)
+            return np.array([state["vel_dict"].get(tag, np.zeros(3)) for tag in tags])
+
+        V0 = np.array([vel_dict[tag] for tag in tags])
+        V, dt, self.next_dt = self.TrapezoidStep(DM, state, tags, V0, velocity_func,
+                                                 min(self.next_dt, self.dtmax))
+
+        state["vel_dict"] = {tag: V[i] for i, tag in enumerate(tags)}
+        state = DisNet.convert_nodevel_dict_to_array(state)
+        self.dt = dt
+        state["dt"] = dt
+        return state
+
+    def SubcyclingGroups(self, G: DisNet) -> list:
+        """SubcyclingGroups: segment pairs (M,2) of each short range group
+
+        The distance of a pair is the midpoint distance minus the half
+        lengths of the segments (a lower bound of their closest approach,
+        clamped at zero). Group k holds the pairs at distance in
+        [rgroups[k-1], rgroups[k]), so that pairs closer than rgroups[0]
+        stay in group 0 with the self forces and the pairs of segments
+        sharing a node.
+        """
+        segs_data = G.get_segs_data_with_positions()
+        nodeids = segs_data["nodeids"]
+        R1, R2 = segs_data["R1"], segs_data["R2"]
+        nseg = nodeids.shape[0]
+        if self._verlet is None:
+            self._verlet = VerletList(cell=G.cell, cutoff=self.rgroups[-1], skin=0.0)
+        self._verlet.cell = G.cell
+        pairs = self._verlet.get_segment_pairs(segs_data, self.rgroups[-1]) if nseg > 1 else np.zeros((0, 2), dtype=int)
+
+        i, j = pairs[:,0], pairs[:,1]
+        connected = (nodeids[i,0] == nodeids[j,0]) | (nodeids[i,0] == nodeids[j,1]) | \
+                    (nodeids[i,1] == nodeids[j,0]) | (nodeids[i,1] == nodeids[j,1])
+        pairs = pairs[~connected]
+
+        mid, half = 0.5*(R1 + R2), 0.5*np.linalg.norm(R2 - R1, axis=1)
+        dm = G.cell.closest_image(Rref=mid[pairs[:,0]], R=mid[pairs[:,1]]) - mid[pairs[:,0]]
+        dist = np.linalg.norm(dm.reshape(-1, 3), axis=1) - half[pairs[:,0]] - half[pairs[:,1]]
+        dist = np.maximum(dist, 0.0)
+
+        groups = []
+        for k in range(1, len(self.rgroups)):
+            in_group = (dist >= self.rgroups[k-1]) & (dist < self.rgroups[k])
+            groups.append(pairs[in_group])
+        return groups
+
+    def GroupSegments(self, segs_data: dict, pairs: np.ndarray) -> dict:
+        """GroupSegments: segment arrays of a short range group for GroupNodeForces
+
+        Only the segments of the pairs and their end nodes enter the group
+        forces. They are renumbered once per step, as the segments of the
+        network do not change during the step, and GroupNodeForces only
+        gathers the current positions of the group nodes.
+        """
+        segs, local_pairs = np.unique(pairs.reshape(-1), return_inverse=True)
+        nodes, local_nodeids = np.unique(segs_data["nodeids"][segs].reshape(-1), return_inverse=True)
+        return {
+            "pairs": local_pairs.reshape(-1, 2).astype(np.intc),
+            "nodes": nodes,
+            "nodeids": local_nodeids.reshape(-1, 2),
+            "burgers": np.ascontiguousarray(segs_data["burgers"][segs])
+        }
+
+    def GroupNodeForces(self, G: DisNet, group: dict) -> np.ndarray:
+        """GroupNodeForces: nodal forces (len(group["nodes"]),3) of the elastic interactions of the group pairs only
+
+        group holds the segment arrays of GroupSegments, the forces are those
+        on the nodes group["nodes"] (positions in the nodes arrays of G).
+        """
+        R = G.pos_array()[group["nodes"]]
+        nodeids = group["nodeids"]
+        R1 = R[nodeids[:,0]]
+        R2 = G.cell.closest_image(Rref=R1, R=R[nodeids[:,1]])
+        args = (R.shape[0], nodeids, R1, R2, group["burgers"], G.cell)
+        mu, nu, a = self.force.mu, self.force.nu, self.force.a
+        _, fpairs = compute_segseg_force_pair_list(*args, group["pairs"], mu, nu, a)
+        _, fself = compute_segseg_force_pair_list(*args, np.zeros((0, 2), dtype=np.intc), mu, nu, a)
+        return fpairs - fself
+
+    def Update_Subcycling(self, DM: DisNetManager, state: dict) -> dict:
+        """TimeIntegration_Subcycling: subcycling time integration over segment pair groups
+
+        The elastic interactions of unconnected segment pairs closer than
+        rgroups[-1] are split into short range groups by distance (see
+        SubcyclingGroups), fixed for the step. Group 0 holds everything
+        else (applied stress, self and connected segment forces and the
+        remote pairs) and is integrated first with the error controlled
+        trapezoid step of the global dt, its forces being the full forces
+        of the force module minus those of the short range groups. Each
+        short range group, from the farthest to the closest, is then
+        integrated over the same interval with trapezoid steps of its own
+        dt, moving only the nodes of its segments. Only the closest pairs,
+        which are cheap to evaluate, are thus integrated with small steps.
+        Assumes the mobility law is linear in the force.
+        On return vel_dict holds the mean velocity of the step.
+        """
+        G = DM.get_disnet(DisNet)
+        vel_dict = state["vel_dict"]
+        tags = list(vel_dict.keys())
+        if len(tags) == 0:
+            state["dt"] = self.dt
+            return state
+
+        segs_data = G.get_segs_data_with_positions()
+        all_tags = list(G.all_nodes_tags())
+        groups = [self.GroupSegments(segs_data, pairs) if pairs.shape[0] > 0 else None
+                  for pairs in self.SubcyclingGroups(G)]
+
+        def short_range_forces(G):
+            fsum = np.zeros((len(all_tags), 3))
+            for group in groups:
+                if group is not None:
+                    fsum[group["nodes"]] += self.GroupNodeForces(G, group)
+            return {tag: fsum[i] for i, tag in enumerate(all_tags)}
+
+        full_forces = {}
+        def group0_velocities(DM, state):
+            G = DM.get_disnet(DisNet)
+            state = self.force.NodeForce(DM, state)
+            full_forces["nodeforce_dict"] = state["nodeforce_dict"]
+            fshort = short_range_forces(G)
+            f0 = {tag: state["nodeforce_dict"][tag] - fshort[tag] for tag in all_tags}
+            return self.NodeVelocities(DM, state, f0, tags)
+
+        R_start = np.array([G.nodes(tag).R for tag in tags])
+        dt0 = min(self.next_dt, self.dtmax)
+        V0 = group0_velocities(DM, state) if any(g is not None for g in groups) else \
+             np.array([vel_dict[tag] for tag in tags])
+        _, dt, self.next_dt = self.TrapezoidStep(DM, state, tags, V0, group0_velocities, dt0)
+
+        for k in reversed(range(len(groups))):
+            group = groups[k]
+            if group is None:
+                continue
+            gtags = [all_tags[n] for n in group["nodes"] if all_tags[n] in vel_dict]
+            if len(gtags) == 0:
+                continue
+
+            def group_velocities(DM, state, group=group, gtags=gtags):
+                fk = np.zeros((len(all_tags), 3))
+                fk[group["nodes"]] = self.GroupNodeForces(DM.get_disnet(DisNet), group)
+                fk = {tag: fk[i] for i, tag in enumerate(all_tags)}
+                return self.NodeVelocities(DM, state, fk, gtags)
+
+            t, dtk = 0.0, min(self.next_dt_sub[k], dt)
+            while t < dt * (1.0 - 1e-12):
+                h = min(dtk, dt - t)
+                Vk = group_velocities(DM, state)
+                _, h, next_h = self.TrapezoidStep(DM, state, gtags, Vk, group_velocities, h)
+                t += h
+                # a step shortened to reach the end of the interval does not
+                # limit the next one
+                dtk = max(dtk, next_h) if h < dtk else next_h
+            self.next_dt_sub[k] = dtk
+
+        # leave the forces of the last full evaluation in state
+        if "nodeforce_dict" in full_forces:
+            state["nodeforce_dict"] = full_forces["nodeforce_dict"]
+            state = DisNet.convert_nodeforce_dict_to_array(state)
+
+        R_end = np.array([G.nodes(tag).R for tag in tags])
+        state["vel_dict"] = {tag: (R_end[i] - R_start[i]) / dt for i, tag in enumerate(tags)}
+        state = DisNet.convert_nodevel_dict_to_array(state)
+        self.dt = dt
+        state["dt"] = dt
+        return state
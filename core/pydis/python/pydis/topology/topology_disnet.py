@@ -5,7 +5,6 @@ Provide topology handling functions given a DisNet object
 """
 
 import numpy as np
-from copy import deepcopy
 import itertools
 
 from ..disnet import DisNet, DisNode, Tag
@@ -61,11 +60,32 @@ class Topology:
         split_node1, split_node2 = G.split_node(tag, pos1, pos2, nbrs_to_split)
         # calculate nodal forces and velocities for the trial split
         # To do: pass DisNetManager instead of DisNet in these static methods
-        f1 = force.OneNodeForce(DisNetManager(G), state, split_node1, update_state=True)
-        f2 = force.OneNodeForce(DisNetManager(G), state, split_node2, update_state=True)
+        Topology.local_node_forces(G, state, [split_node1, split_node2], force, update_state=True)
         state = mobility.Mobility(DisNetManager(G), state)
         return state, split_node1, split_node2
 
+    @staticmethod
+    def local_node_forces(G, state, tags, force, update_state=False) -> dict:
+        """local_node_forces: forces on the nodes in tags, in one call if force
+           provides the local evaluator (LocalNodeForce)
+        """
+        DM = DisNetManager(G)
+        if hasattr(force, "LocalNodeForce"):
+            return force.LocalNodeForce(DM, state, tags, update_state=update_state)
+        return {tag: force.OneNodeForce(DM, state, tag, update_state=update_state) for tag in tags}
+
+    @staticmethod
+    def trial_split_power(G, state, tags, force, mobility) -> float:
+        """trial_split_power: total power (force dot velocity) of the nodes of a trial split
+           without updating the forces and velocities in state
+        """
+        DM = DisNetManager(G)
+        power = 0.0
+        for tag, f in Topology.local_node_forces(G, state, tags, force).items():
+            v = mobility.OneNodeMobility(DM, state, tag, f, update_state=False)
+            power += np.dot(f, v)
+        return power
+
     @staticmethod
     def trial_split_multi_node(G, tag: Tag, state: dict, force, mobility, power_th=1e-3) -> dict:
         """trial_split_multi_node: try to split multi-arm node in different ways
@@ -88,19 +108,18 @@ class Topology:
         #print("trial_split_multi_node (%s): power0 = %e"%(tag, power0))
         #print("edges = %s"%(str(G.edges(tag))))
 
-        pos0 = G.nodes(tag).R
+        pos0 = G.nodes(tag).R.copy()
         n_splits = len(nbr_idx_list)
         power_diss = np.zeros(n_splits)
         for k in range(n_splits):
             nbrs_to_split = [nbrs[i] for i in nbr_idx_list[k]]
 
-            # make a copy of the network G to make trial splits
-            G_trial = G.copy()
-            state_trial = deepcopy(state)
-            state_trial, split_node1, split_node2 = Topology.split_node_and_update_forces(G_trial, state_trial, tag, pos0.copy(), pos0.copy(), nbrs_to_split, force, mobility)
-
-            power_diss[k] = np.dot(state_trial["nodeforce_dict"][split_node1], state_trial["vel_dict"][split_node1]) \
-                          + np.dot(state_trial["nodeforce_dict"][split_node2], state_trial["vel_dict"][split_node2])
+            # make the trial split in place and undo it afterwards, only the
+            # two split nodes are evaluated so state is left untouched
+            G.begin_trial()
+            split_node1, split_node2 = G.split_node(tag, pos0.copy(), pos0.copy(), nbrs_to_split)
+            power_diss[k] = Topology.trial_split_power(G, state, [split_node1, split_node2], force, mobility)
+            G.rollback_trial()
 
             #print("trial_split_multi_node (%s): power_diss[%d] = %e"%(str(tag), k, power_diss[k]))
 
@@ -0,0 +1,248 @@
+import atexit
+import numpy as np
+from ctypes import c_double, c_int, POINTER, byref
+
+try:
+    pydis_lib = __import__('pydis_lib')
+    found_pydis = True
+except ImportError:
+    found_pydis = False
+    raise
+
+def _real8_ptr(x):
+    return x.ctypes.data_as(POINTER(c_double))
+
+def _int_ptr(x):
+    return x.ctypes.data_as(POINTER(c_int))
+
+def _real8_array(x, n=3):
+    return np.ascontiguousarray(x, dtype=np.float64).reshape(-1, n)
+
+def factor_domains(num_domains: int) -> tuple:
+    """ split num_domains into nx >= ny >= nz domains, as cubic as possible
+    """
+    best = (num_domains, 1, 1)
+    for nx in range(1, num_domains+1):
+        if num_domains % nx:
+            continue
+        for ny in range(1, nx+1):
+            if (num_domains // nx) % ny:
+                continue
+            nz = num_domains // nx // ny
+            if nz > ny:
+                continue
+            if max(nx, ny, nz) < max(best):
+                best = (nx, ny, nz)
+    return best
+
+# load criteria of DomainDecompRebalance (Decomp.h)
+DLB_USE_WALLCLK_TIME = 0
+DLB_USE_FORCECALC_COUNT = 1
+
+_finalize_registered = False
+
+class DomainDecomposition:
+    """ spatial domain decomposition of the segment forces over the MPI
+        ranks (DomainDecomp.h); with a libpydis built without
+        PYDIS_ENABLE_MPI there is a single domain
+
+        num_domains:  (nx, ny, nz) domains, one per rank; chosen from the
+                      number of ranks if not given
+        decomp_type:  1 recursive sectioning, 2 recursive bisection
+                      (decompType control parameter)
+        dlb_freq:     elastic_forces() rebalances the domains for the
+                      measured load every dlb_freq calls (DLBfreq)
+        dlb_criteria: load measure, DLB_USE_FORCECALC_COUNT (segment
+                      pairs) or DLB_USE_WALLCLK_TIME (force time)
+    """
+    def __init__(self, cell, num_domains: tuple=None, decomp_type: int=1, dlb_freq: int=3,
+                 dlb_criteria: int=DLB_USE_FORCECALC_COUNT) -> None:
+        global _finalize_registered
+        rank, size = c_int(), c_int()
+        if pydis_lib.DomainDecompInit(byref(rank), byref(size)) != 0:
+            raise ValueError("DomainDecomposition: cannot initialize MPI")
+        if not _finalize_registered:
+            atexit.register(pydis_lib.DomainDecompFinalize)
+            _finalize_registered = True
+        self.rank, self.size = rank.value, size.value
+        self.num_domains = tuple(num_domains) if num_domains is not None else factor_domains(self.size)
+        if len(self.num_domains) != 3 or int(np.prod(self.num_domains)) != self.size:
+            raise ValueError("DomainDecomposition: %s domains for %d ranks" % (str(self.num_domains), self.size))
+        h = np.ascontiguousarray(cell.h, dtype=np.float64)
+        origin = np.ascontiguousarray(cell.origin, dtype=np.float64)
+        is_periodic = np.ascontiguousarray(cell.is_periodic, dtype=np.intc)
+        self._dd = pydis_lib.DomainDecompCreate(*self.num_domains, _real8_ptr(h), _real8_ptr(origin),
+                                                _int_ptr(is_periodic))
+        if not self._dd:
+            raise ValueError("DomainDecomposition: cannot create the decomposition")
+        if pydis_lib.DomainDecompSetType(self._dd, decomp_type) != 0:
+            raise ValueError("DomainDecomposition: unknown decomp_type %s" % str(decomp_type))
+        self.decomp_type = decomp_type
+        self.dlb_freq = dlb_freq
+        self.dlb_criteria = dlb_criteria
+        self._calls = 0
+        self._natives = None
+
+    def __del__(self):
+        self.close()
+
+    def close(self) -> None:
+        if getattr(self, "_dd", None):
+            pydis_lib.DomainDecompFree(self._dd)
+            self._dd = None
+
+    def balance(self, R1: np.ndarray, R2: np.ndarray) -> int:
+        """ place the domain boundaries for the segments of all ranks
+            (collective, each rank passes its own segments); returns the
+            total number of segments
+        """
+        R1, R2 = _real8_array(R1), _real8_array(R2)
+        return pydis_lib.DomainDecompBalance(self._dd, R1.shape[0], _real8_ptr(R1), _real8_ptr(R2))
+
+    def balance_load(self, R1: np.ndarray, R2: np.ndarray, load: np.ndarray) -> int:
+        """ place the domain boundaries for segments of the given load
+            (collective, like balance())
+        """
+        R1, R2 = _real8_array(R1), _real8_array(R2)
+        load = np.ascontiguousarray(load, dtype=np.float64)
+        return pydis_lib.DomainDecompBalanceLoad(self._dd, R1.shape[0], _real8_ptr(R1), _real8_ptr(R2),
+                                                 _real8_ptr(load))
+
+    def segment_loads(self, criteria: int=None) -> np.ndarray:
+        """ measured load of each native segment of the last seg_forces()
+        """
+        criteria = self.dlb_criteria if criteria is None else criteria
+        load = np.zeros(getattr(self, "_num_natives", 0) + 1)
+        n = pydis_lib.DomainDecompGetSegLoad(self._dd, criteria, _real8_ptr(load))
+        return load[:n]
+
+    def imbalance(self, criteria: int=None) -> float:
+        """ maximum over mean domain load of the last seg_forces()
+            (collective)
+        """
+        loads = np.zeros(self.size)
+        loads[self.rank] = np.sum(self.segment_loads(criteria))
+        self.sum(loads)
+        mean = np.mean(loads)
+        return float(np.max(loads) / mean) if mean > 0.0 else 1.0
+
+    def rebalance(self, seg_nodes: np.ndarray, R1: np.ndarray, R2: np.ndarray, burgers: np.ndarray,
+                  criteria: int=None) -> tuple:
+        """ dynamic load balancing: rebalance the domains for the load
+            measured by the last seg_forces(), which had these native
+            segments, and migrate the segments to their new domains
+            (collective); returns the segments now native to this rank
+        """
+        R1, R2 = _real8_array(R1), _real8_array(R2)
+        pydis_lib.DomainDecompRebalance(self._dd, R1.shape[0], _real8_ptr(R1), _real8_ptr(R2),
+                                        self.dlb_criteria if criteria is None else criteria)
+        return self.migrate(seg_nodes, R1, R2, burgers)
+
+    def bounds(self, domain: int=None) -> tuple:
+        """ fractional coordinate bounds (smin, smax) of a domain
+        """
+        smin, smax = np.zeros(3), np.zeros(3)
+        pydis_lib.DomainDecompGetBounds(self._dd, self.rank if domain is None else domain,
+                                        _real8_ptr(smin), _real8_ptr(smax))
+        return smin, smax
+
+    def owners(self, R1: np.ndarray, R2: np.ndarray) -> np.ndarray:
+        """ domain of each segment (the domain of its midpoint)
+        """
+        R1, R2 = _real8_array(R1), _real8_array(R2)
+        owners = np.zeros(R1.shape[0], dtype=np.intc)
+        pydis_lib.DomainDecompSegOwners(self._dd, R1.shape[0], _real8_ptr(R1), _real8_ptr(R2), _int_ptr(owners))
+        return owners
+
+    def migrate(self, seg_nodes: np.ndarray, R1: np.ndarray, R2: np.ndarray, burgers: np.ndarray) -> tuple:
+        """ send every segment to the rank of its domain (collective);
+            returns the segments now native to this rank
+        """
+        seg_nodes = np.ascontiguousarray(seg_nodes, dtype=np.intc).reshape(-1, 2)
+        R1, R2, burgers = _real8_array(R1), _real8_array(R2), _real8_array(burgers)
+        n = pydis_lib.DomainDecompMigrate(self._dd, seg_nodes.shape[0], _int_ptr(seg_nodes),
+                                          _real8_ptr(R1), _real8_ptr(R2), _real8_ptr(burgers))
+        seg_nodes = np.zeros((n, 2), dtype=np.intc)
+        R1, R2, burgers = np.zeros((n, 3)), np.zeros((n, 3)), np.zeros((n, 3))
+        pydis_lib.DomainDecompGetSegments(self._dd, _int_ptr(seg_nodes), _real8_ptr(R1),
+                                          _real8_ptr(R2), _real8_ptr(burgers))
+        return seg_nodes, R1, R2, burgers
+
+    def seg_forces(self, R1: np.ndarray, R2: np.ndarray, burgers: np.ndarray, cutoff: float,
+                   mu: float, nu: float, a: float, quad_points: np.ndarray=None,
+                   weights: np.ndarray=None) -> np.ndarray:
+        """ elastic forces (Nseg,6) on the native segments of this rank
+            (collective); ghosts within cutoff are exchanged, all segments
+            interact if cutoff is None
+        """
+        R1, R2, burgers = _real8_array(R1), _real8_array(R2), _real8_array(burgers)
+        if quad_points is None:
+            Nint, quad_points, weights = 0, np.zeros(1), np.zeros(1)
+        else:
+            quad_points = np.ascontiguousarray(quad_points, dtype=np.float64)
+            weights = np.ascontiguousarray(weights, dtype=np.float64)
+            Nint = quad_points.shape[0]
+        segforces = np.zeros((R1.shape[0], 6))
+        self._num_natives = R1.shape[0]
+        self.num_ghosts = pydis_lib.DomainDecompSegForces(
+            self._dd, R1.shape[0], _real8_ptr(R1), _real8_ptr(R2), _real8_ptr(burgers),
+            0.0 if cutoff is None else cutoff, a, mu, nu,
+            Nint, _real8_ptr(quad_points), _real8_ptr(weights), _real8_ptr(segforces))
+        return segforces
+
+    def node_forces(self, seg_nodes: np.ndarray, segforces: np.ndarray,
+                    node_tags: np.ndarray, node_pos: np.ndarray) -> np.ndarray:
+        """ total forces (N,3) on the nodes node_tags (at node_pos) from the
+            segment forces of all ranks (collective); node_tags must
+            include the end nodes of seg_nodes
+        """
+        seg_nodes = np.ascontiguousarray(seg_nodes, dtype=np.intc).reshape(-1, 2)
+        segforces = _real8_array(segforces, 6)
+        node_tags = np.ascontiguousarray(node_tags, dtype=np.intc)
+        node_pos = _real8_array(node_pos)
+        nodeforces = np.zeros((node_tags.shape[0], 3))
+        if pydis_lib.DomainDecompNodeForces(self._dd, seg_nodes.shape[0], _int_ptr(seg_nodes),
+                                            _real8_ptr(segforces), node_tags.shape[0], _int_ptr(node_tags),
+                                            _real8_ptr(node_pos), _real8_ptr(nodeforces)) != 0:
+            raise ValueError("DomainDecomposition: segment end node missing from node_tags")
+        return nodeforces
+
+    def sum(self, values: np.ndarray) -> np.ndarray:
+        """ sum a float64 array over all ranks, in place (collective)
+        """
+        if pydis_lib.DomainDecompSum(self._dd, values.size, _real8_ptr(values)) != 0:
+            raise ValueError("DomainDecomposition: reduction failed")
+        return values
+
+    def elastic_forces(self, num_nodes: int, nodeids: np.ndarray, R1: np.ndarray, R2: np.ndarray,
+                       burgers: np.ndarray, cell, cutoff: float, mu: float, nu: float, a: float,
+                       quad_points: np.ndarray=None, weights: np.ndarray=None) -> tuple:
+        """ elastic forces of a network replicated on every rank, in the
+            interface of compute_segseg_force_all_pairs: each rank
+            evaluates the segments of its domain and the segment forces
+            are summed over the ranks (collective); every dlb_freq calls
+            the domains are rebalanced for the load measured on the
+            natives of the previous call, which moves the segments
+            between the ranks
+            returns segforces (Nseg,6) and nodeforces (num_nodes,3)
+        """
+        R1, R2, burgers = _real8_array(R1), _real8_array(R2), _real8_array(burgers)
+        nodeids = np.asarray(nodeids, dtype=int).reshape(-1, 2)
+        if self._calls == 0:
+            self.balance(R1[self.rank::self.size], R2[self.rank::self.size])
+        elif self.dlb_freq > 0 and self._calls % self.dlb_freq == 0:
+            pydis_lib.DomainDecompRebalance(self._dd, self._natives[0].shape[0], _real8_ptr(self._natives[0]),
+                                            _real8_ptr(self._natives[1]), self.dlb_criteria)
+        self._calls += 1
+
+        native = np.where(self.owners(R1, R2) == self.rank)[0]
+        self._natives = (np.ascontiguousarray(R1[native]), np.ascontiguousarray(R2[native]))
+        segforces = np.zeros((R1.shape[0], 6))
+        segforces[native] = self.seg_forces(R1[native], R2[native], burgers[native], cutoff,
+                                            mu, nu, a, quad_points, weights)
+        self.sum(segforces)
+
+        nodeforces = np.zeros((num_nodes, 3))
+        np.add.at(nodeforces, nodeids[:,0], segforces[:,0:3])
+        np.add.at(nodeforces, nodeids[:,1], segforces[:,3:6])
+        return segforces, nodeforces
@@ -0,0 +1,120 @@
+import numpy as np
+from ctypes import c_double, c_int, c_longlong, POINTER
+
+try:
+    pydis_lib = __import__('pydis_lib')
+    found_pydis = True
+except ImportError:
+    found_pydis = False
+    raise
+
+PROFILE_PHASES = ['force', 'mobility', 'integrate', 'topology', 'collision', 'remesh', 'cross_slip']
+PROFILE_COUNTERS = ['pairs', 'collisions', 'remesh_ops', 'nodes', 'cross_slips']
+PROFILE_HW_COUNTERS = ['cycles', 'instructions', 'llc_misses', 'dp_ops', 'dp_vec_ops']
+CACHE_LINE_BYTES = 64
+
+class NativeProfile:
+    """ profile of the native kernels (Profile.h) of the calling thread,
+        in the reset()/read() interface of framework.profiler.Profiler.
+        The profile is thread local: enable(), reset() and read() only
+        act on the phases and counters of the thread that calls them,
+        so kernels run by other threads (e.g. concurrent simulations)
+        are not included
+    """
+    def __init__(self, enable: bool=True):
+        self.enable(enable)
+
+    def enable(self, enable: bool=True):
+        pydis_lib.ProfileEnable(1 if enable else 0)
+
+    def reset(self):
+        pydis_lib.ProfileReset()
+
+    def read(self) -> dict:
+        time = np.zeros(pydis_lib.PROFILE_NUM_PHASES)
+        calls = np.zeros(pydis_lib.PROFILE_NUM_PHASES, dtype=np.intc)
+        counts = np.zeros(pydis_lib.PROFILE_NUM_COUNTERS, dtype=np.longlong)
+        pydis_lib.ProfileGet(time.ctypes.data_as(POINTER(c_double)),
+                             calls.ctypes.data_as(POINTER(c_int)),
+                             counts.ctypes.data_as(POINTER(c_longlong)))
+        hw = np.zeros(pydis_lib.PROFILE_NUM_PHASES*pydis_lib.PROFILE_NUM_HW_COUNTERS, dtype=np.longlong)
+        num_hw = pydis_lib.ProfileGetHW(hw.ctypes.data_as(POINTER(c_longlong)))
+        result = {
+            "phases": {name: {"time": float(time[i]), "calls": int(calls[i])}
+                       for i, name in enumerate(PROFILE_PHASES)},
+            "counters": {name: int(counts[i]) for i, name in enumerate(PROFILE_COUNTERS)},
+        }
+        if num_hw > 0:
+            # hardware counters of the phases (Profile.h), -1 if unavailable
+            hw = hw.reshape(len(PROFILE_PHASES), len(PROFILE_HW_COUNTERS))
+            result["hwcounters"] = {phase: {name: int(hw[i,j]) for j, name in enumerate(PROFILE_HW_COUNTERS)
+                                            if hw[i,j] >= 0}
+                                    for i, phase in enumerate(PROFILE_PHASES)}
+        return result
+
+def roofline(results: dict, peak_gflops: float=None, peak_bandwidth: float=None) -> dict:
+    """ roofline-style summary per native phase from the results() of a
+        framework.profiler.Profiler with a NativeProfile: GFLOP/s,
+        arithmetic intensity (flops per byte of last level cache miss
+        traffic), vector fraction of the flops and instructions per cycle.
+        Given the machine peaks (GFLOP/s, GB/s) the attainable GFLOP/s
+        and whether the phase is compute or memory bound are added.
+    """
+    phases, counters = results["phases"], results["counters"]
+    summary = {}
+    for phase in PROFILE_PHASES:
+        hw = {name: counters["hw/%s/%s" % (phase, name)] for name in PROFILE_HW_COUNTERS
+              if "hw/%s/%s" % (phase, name) in counters}
+        t = phases.get("native/" + phase, {}).get("time", 0.0)
+        if not hw or t <= 0.0:
+            continue
+        entry = {"time": t}
+        flops = hw.get("dp_ops")
+        traffic = CACHE_LINE_BYTES * hw["llc_misses"] if "llc_misses" in hw else None
+        if flops is not None:
+            entry["gflops"] = 1.0e-9 * flops / t
+            if flops > 0 and "dp_vec_ops" in hw:
+                entry["vector_fraction"] = hw["dp_vec_ops"] / flops
+        if traffic is not None:
+            entry["gbytes_per_s"] = 1.0e-9 * traffic / t
+        if flops is not None and traffic:
+            entry["intensity"] = flops / traffic
+        if hw.get("cycles"):
+            entry["ipc"] = hw.get("instructions", 0) / hw["cycles"]
+        if "intensity" in entry and peak_gflops and peak_bandwidth:
+            entry["attainable_gflops"] = min(peak_gflops, entry["intensity"] * peak_bandwidth)
+            entry["bound"] = "compute" if entry["intensity"] >= peak_gflops / peak_bandwidth else "memory"
+        summary[phase] = entry
+    return summary
+
+def roofline_report(results: dict, peak_gflops: float=None, peak_bandwidth: float=None) -> str:
+    """ roofline() as a text table
+    """
+    lines = ["%-12s %10s %10s %10s %10s %8s %6s %8s" % ("phase", "time (s)", "GFLOP/s", "GB/s",
+                                                       "flops/B", "vector%", "IPC", "bound")]
+    fmt = lambda entry, key, f: (f % entry[key]) if key in entry else "-"
+    for phase, entry in roofline(results, peak_gflops, peak_bandwidth).items():
+        vector = dict(entry)
+        if "vector_fraction" in vector:
+            vector["vector_fraction"] *= 100.0
+        lines.append("%-12s %10.4f %10s %10s %10s %8s %6s %8s" % (
+            phase, entry["time"], fmt(entry, "gflops", "%.3f"), fmt(entry, "gbytes_per_s", "%.3f"),
+            fmt(entry, "intensity", "%.2f"), fmt(vector, "vector_fraction", "%.1f"),
+            fmt(entry, "ipc", "%.2f"), entry.get("bound", "-")))
+    return "\n".join(lines)
+
+def home_timers(home) -> dict:
+    """ accumulated and last increment times of the Timer_t timers of a
+        ParaDiS home (TimerInit), by timer name
+    """
+    timers = home.contents.timers
+    result = {}
+    if not timers:
+        return result
+    for i in range(pydis_lib.TIMER_BLOCK_SIZE):
+        timer = timers[i]
+        if not timer.name:
+            continue
+        name = timer.name.decode().strip() if isinstance(timer.name, bytes) else str(timer.name).strip()
+        result[name] = {"accum": timer.accum, "incr": timer.incr}
+    return result
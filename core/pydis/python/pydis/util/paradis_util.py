@@ -1,5 +1,5 @@
 import numpy as np
-from ctypes import c_double, POINTER, byref
+from ctypes import c_double, c_int, c_void_p, POINTER, byref, cast
 real8 = c_double
 
 try:
@@ -9,16 +9,224 @@ except ImportError:
     found_pydis = False
     raise
 
+# buffer protocol bindings releasing the GIL (pydis_ext.c), optional
+try:
+    pydis_ext = __import__('pydis_ext')
+except ImportError:
+    pydis_ext = None
+
 class paradis_lib:
     def __init__(self):
         for item in pydis_lib.__dict__:
             self.__dict__[item] = pydis_lib.__dict__[item]
 
+    def error_message(self):
+        """
+        Message of the last error of the native library in this thread
+        """
+        msg = self.ErrorMessage()
+        return msg.decode() if isinstance(msg, bytes) else str(msg)
+
+    def check(self, ret, name: str):
+        """
+        Raise the last native error if ret is a failed return code
+        """
+        if ret < 0:
+            msg = self.error_message()
+            self.ErrorClear()
+            raise ValueError("%s: %s" % (name, msg))
+        return ret
+
     def paradis_init(self):
         """
-        Initialize ParaDiS home structure
+        Initialize ParaDiS home structure, an independent instance
+        to be released with free_home
         """
         home = POINTER(pydis_lib.Home_t)()
-        self.ParadisInit_lean(byref(home))
+        self.check(self.ParadisInit_lean(byref(home)), "paradis_init")
 
         return home
+
+    def free_home(self, home):
+        """
+        Free a home structure created by paradis_init, also after a
+        failed call left it inconsistent
+        """
+        if home:
+            self.HomeFree(home)
+
+    def read_data_file(self, filename, is_periodic: list=[True,True,True]):
+        """
+        Read a ParaDiS nodal data (restart) file with the native loader
+        (DataFileOpen, DataFileReadNodes) into network data in the format
+        of DisNet.import_data, the cell spanning min/maxCoordinates
+        """
+        df = self.DataFileOpen(filename.encode())
+        if not df:
+            self.check(-1, "read_data_file")
+        try:
+            info = df.contents
+            num_nodes, num_arms = info.numNodes, info.numArms
+            tags = np.zeros((num_nodes, 2), dtype=np.intc)
+            R = np.zeros((num_nodes, 3))
+            constraints = np.zeros(num_nodes, dtype=np.intc)
+            nodeids = np.zeros((num_arms//2, 2), dtype=np.intc)
+            burgers = np.zeros((num_arms//2, 3))
+            planes = np.zeros((num_arms//2, 3))
+            num_segs = self.DataFileReadNodes(df, tags.ctypes.data_as(POINTER(c_int)),
+                                              R.ctypes.data_as(POINTER(c_double)),
+                                              constraints.ctypes.data_as(POINTER(c_int)), nodeids.shape[0],
+                                              nodeids.ctypes.data_as(POINTER(c_int)),
+                                              burgers.ctypes.data_as(POINTER(c_double)),
+                                              planes.ctypes.data_as(POINTER(c_double)))
+            rmin, rmax = np.array(info.minCoordinates[:3]), np.array(info.maxCoordinates[:3])
+        finally:
+            self.DataFileClose(df)
+        self.check(num_segs, "read_data_file")
+        cell = {"h": np.diag(rmax - rmin), "origin": rmin, "is_periodic": list(is_periodic)}
+        return {
+            "cell": cell,
+            "nodes": {"tags": tags, "positions": R, "constraints": constraints[:,None]},
+            "segs": {"nodeids": nodeids[:num_segs], "burgers": burgers[:num_segs], "planes": planes[:num_segs]},
+        }
+
+    def disnet_to_home(self, home, G):
+        """
+        Replace the nodes of home with the network G in one bulk transfer
+        (HomeImportArrays), the DisNet arrays are passed without copies
+        """
+        nodes_data, ntags = G.get_nodes_data(copy=False)
+        segs_data = G.get_segs_data(ntags, copy=False)
+        tags = np.ascontiguousarray(nodes_data["tags"], dtype=np.intc)
+        R = np.ascontiguousarray(nodes_data["positions"], dtype=np.float64)
+        constraints = np.ascontiguousarray(nodes_data["constraints"], dtype=np.intc)
+        nodeids = np.ascontiguousarray(segs_data["nodeids"], dtype=np.intc)
+        burgers = np.ascontiguousarray(segs_data["burgers"], dtype=np.float64)
+        planes = np.ascontiguousarray(segs_data["planes"], dtype=np.float64)
+        self.FreeAllNodes(home)
+        if pydis_ext is not None:
+            pydis_ext.home_import_arrays(cast(home, c_void_p).value, tags, R, constraints,
+                                         nodeids, burgers, planes)
+            return
+        self.check(self.HomeImportArrays(home, tags.shape[0],
+                                         tags.ctypes.data_as(POINTER(c_int)), R.ctypes.data_as(POINTER(c_double)),
+                                         constraints.ctypes.data_as(POINTER(c_int)), nodeids.shape[0],
+                                         nodeids.ctypes.data_as(POINTER(c_int)),
+                                         burgers.ctypes.data_as(POINTER(c_double)),
+                                         planes.ctypes.data_as(POINTER(c_double))), "disnet_to_home")
+
+    def home_to_disnet(self, home, G, positions_only: bool=False):
+        """
+        Export the nodes of home to the network G (HomeExportArrays)
+        positions_only: if the topology is unchanged, copy only the node
+                        positions, directly into the DisNet arrays
+        """
+        if positions_only:
+            nodes_data, _ = G.get_nodes_data(copy=False)
+            tags, R = nodes_data["tags"], nodes_data["positions"]
+            num_missing = self.HomeGetPositions(home, tags.shape[0],
+                                                tags.ctypes.data_as(POINTER(c_int)),
+                                                R.ctypes.data_as(POINTER(c_double)))
+            if num_missing > 0:
+                raise ValueError("home_to_disnet: %d nodes of G not found in home" % num_missing)
+            return
+
+        address = cast(home, c_void_p).value
+        if pydis_ext is not None:
+            num_nodes, num_segs = pydis_ext.home_export_arrays(address)
+        else:
+            nsegs = c_int(0)
+            num_nodes = self.check(self.HomeExportArrays(home, 0, None, None, None, 0, byref(nsegs), None, None, None),
+                                   "home_to_disnet")
+            num_segs = nsegs.value
+        tags = np.zeros((num_nodes, 2), dtype=np.intc)
+        R = np.zeros((num_nodes, 3))
+        constraints = np.zeros(num_nodes, dtype=np.intc)
+        nodeids = np.zeros((num_segs, 2), dtype=np.intc)
+        burgers = np.zeros((num_segs, 3))
+        planes = np.zeros((num_segs, 3))
+        if pydis_ext is not None:
+            pydis_ext.home_export_arrays(address, tags, R, constraints, nodeids, burgers, planes)
+        else:
+            self.check(self.HomeExportArrays(home, num_nodes, tags.ctypes.data_as(POINTER(c_int)),
+                                             R.ctypes.data_as(POINTER(c_double)), constraints.ctypes.data_as(POINTER(c_int)),
+                                             num_segs, byref(nsegs), nodeids.ctypes.data_as(POINTER(c_int)),
+                                             burgers.ctypes.data_as(POINTER(c_double)),
+                                             planes.ctypes.data_as(POINTER(c_double))), "home_to_disnet")
+        G.clear_graph()
+        G.add_nodes_segments_from_list(np.hstack((tags, R, constraints[:,None])),
+                                       np.hstack((nodeids, burgers, planes)))
+
+    def set_home_cell(self, home, cell):
+        """
+        Set the simulation box of home from a DisNet cell
+        (ParaDiS boxes are orthorhombic: only the diagonal of h is used)
+        """
+        param = home.contents.param.contents
+        origin, L = np.asarray(cell.origin, dtype=float), np.diag(cell.h)
+        param.minSideX, param.minSideY, param.minSideZ = origin
+        param.maxSideX, param.maxSideY, param.maxSideZ = origin + L
+        # BoundType_t: Periodic=0, Free=1
+        param.xBoundType, param.yBoundType, param.zBoundType = \
+            [0 if p else 1 for p in cell.is_periodic]
+        self.SetBoxSize(home.contents.param)
+
+    def set_home_state(self, home, vel_dict: dict=None, segforce_dict: dict=None):
+        """
+        Copy node velocities and segment forces into the nodes of home
+        (HomeSetVelocities, HomeSetSegForces)
+        """
+        if vel_dict:
+            tags = np.ascontiguousarray(list(vel_dict.keys()), dtype=np.intc)
+            V = np.ascontiguousarray(list(vel_dict.values()), dtype=np.float64)
+            self.HomeSetVelocities(home, tags.shape[0], tags.ctypes.data_as(POINTER(c_int)),
+                                   V.ctypes.data_as(POINTER(c_double)))
+        if segforce_dict:
+            tags = np.ascontiguousarray(list(segforce_dict.keys()), dtype=np.intc)
+            tags1, tags2 = np.ascontiguousarray(tags[:,0,:]), np.ascontiguousarray(tags[:,1,:])
+            fseg = np.ascontiguousarray(list(segforce_dict.values()), dtype=np.float64)
+            self.HomeSetSegForces(home, tags.shape[0], tags1.ctypes.data_as(POINTER(c_int)),
+                                  tags2.ctypes.data_as(POINTER(c_int)), fseg.ctypes.data_as(POINTER(c_double)))
+
+    def home_changes_to_disnet(self, home, G):
+        """
+        Apply the changes made to home since the last HomeClearChanges
+        (HomeExportChanges) to G, which must be the network imported into
+        home, without rebuilding it
+        Returns the velocities of the changed nodes and the removed tags
+        """
+        num_segs, num_removed = c_int(0), c_int(0)
+        num_nodes = self.HomeExportChanges(home, 0, None, None, None, None, 0, byref(num_segs),
+                                           None, None, None, 0, byref(num_removed), None)
+        tags = np.zeros((num_nodes, 2), dtype=np.intc)
+        R = np.zeros((num_nodes, 3))
+        V = np.zeros((num_nodes, 3))
+        constraints = np.zeros(num_nodes, dtype=np.intc)
+        seg_tags = np.zeros((num_segs.value, 4), dtype=np.intc)
+        burgers = np.zeros((num_segs.value, 3))
+        planes = np.zeros((num_segs.value, 3))
+        removed = np.zeros((num_removed.value, 2), dtype=np.intc)
+        self.HomeExportChanges(home, num_nodes, tags.ctypes.data_as(POINTER(c_int)),
+                               R.ctypes.data_as(POINTER(c_double)), V.ctypes.data_as(POINTER(c_double)),
+                               constraints.ctypes.data_as(POINTER(c_int)),
+                               num_segs.value, byref(num_segs), seg_tags.ctypes.data_as(POINTER(c_int)),
+                               burgers.ctypes.data_as(POINTER(c_double)), planes.ctypes.data_as(POINTER(c_double)),
+                               num_removed.value, byref(num_removed), removed.ctypes.data_as(POINTER(c_int)))
+
+        # all arms of the changed nodes are exported: the segments of G
+        # between changed nodes that are no longer there were removed
+        changed = [tuple(tag) for tag in tags.tolist()]
+        removed_tags = [tuple(tag) for tag in removed.tolist()]
+        arms = {tag: set() for tag in changed}
+        for tag1, tag2 in zip(map(tuple, seg_tags[:,:2].tolist()), map(tuple, seg_tags[:,2:].tolist())):
+            arms.setdefault(tag1, set()).add(tag2)
+            arms.setdefault(tag2, set()).add(tag1)
+        removed_segs = [(tag, nbr) for tag in changed if G.has_node(tag)
+                        for nbr in G.neighbors_tags(tag) if nbr not in arms[tag]]
+
+        G.import_delta({"cell": G.cell.view(), "removed_nodes": removed_tags, "removed_segs": removed_segs,
+                        "nodes": {"tags": tags, "positions": R, "constraints": constraints[:,None]},
+                        "segs": {"tags1": seg_tags[:,:2], "tags2": seg_tags[:,2:],
+                                 "burgers": burgers, "planes": planes}})
+
+        return dict(zip(changed, V)), removed_tags
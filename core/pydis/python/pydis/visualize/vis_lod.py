@@ -0,0 +1,291 @@
+"""@package docstring
+Vis_LOD: level-of-detail rendering and export of large dislocation networks
+
+The network arrays (export_data) are reduced to a decimated line set:
+chains of two-armed nodes are merged into straight lines where the
+dropped nodes lie within a tolerance of them (by default the size of one
+pixel of the rendered box), and the sub-pixel segments left between
+junctions are dropped. The reduction and the rendering or export run in
+a background thread (framework.output_writer); the simulation thread
+only copies the arrays, and frames submitted while the background
+thread is busy are skipped.
+
+LOD line file (export mode), little-endian:
+
+    8 bytes   magic b'DISLOD01'
+    frames    header: int64 step, int64 number of lines n, float64 box
+              bounds (lower xyz, upper xyz), then the float32 line end
+              points (n,2,3) and the float32 burgers vectors (n,3)
+
+A frame is appended and flushed at once, so a viewer can follow the file
+of a running simulation (read_lod_frames stops at a partial frame).
+"""
+
+import os
+import numpy as np
+from ..disnet import Cell
+from framework.output_writer import OutputWriter
+
+LOD_MAGIC = b'DISLOD01'
+LOD_HEADER = np.dtype([("step", "<i8"), ("num_lines", "<i8"), ("bounds", "<f8", (2,3))])
+
+
+def segment_lines(data: dict):
+    """segment_lines: segments of export_data as end positions
+       Returns the cell, the end node ids (Ns,2), the end positions (Ns,2,3)
+       with the second end the closest image of the first, and the burgers
+       vectors (Ns,3)
+    """
+    cell_data = data["cell"]
+    cell = Cell(h=np.asarray(cell_data["h"], dtype=np.float64),
+                origin=np.asarray(cell_data["origin"], dtype=np.float64),
+                is_periodic=np.asarray(cell_data["is_periodic"], dtype=bool))
+    R = np.asarray(data["nodes"]["positions"], dtype=np.float64).reshape(-1, 3)
+    ends = np.asarray(data["segs"]["nodeids"]).astype(np.intp).reshape(-1, 2)
+    burgers = np.asarray(data["segs"]["burgers"], dtype=np.float64).reshape(-1, 3)
+    P = np.empty((ends.shape[0], 2, 3))
+    P[:,0] = R[ends[:,0]]
+    P[:,1] = cell.closest_image(Rref=P[:,0], R=R[ends[:,1]])
+    return cell, ends, P, burgers
+
+
+def decimate_lines(ends: np.ndarray, P: np.ndarray, burgers: np.ndarray,
+                   tol: float, max_passes: int=6, seed: int=0):
+    """decimate_lines: merge chains of two-armed nodes into lines and drop sub-pixel segments
+
+       ends: end node ids of the segments (Ns,2)
+       P: end positions of the segments (Ns,2,3), any image per segment
+       burgers: burgers vectors of the segments (Ns,3)
+
+       A pass drops the two-armed nodes lying within tol/max_passes of the
+       segment between their two neighbors, joining their two segments.
+       The dropped nodes of a pass are not neighbors (random priorities
+       pick them), so every dropped node stays within tol of the final
+       lines. Segments shorter than tol are dropped at the end.
+       Returns the lines (M,2,3) and their burgers vectors (M,3)
+    """
+    ends = np.array(ends, dtype=np.intp).reshape(-1, 2)
+    P = np.array(P, dtype=np.float64).reshape(-1, 2, 3)
+    b = np.array(burgers, dtype=np.float64).reshape(-1, 3)
+    ptol = tol / max(int(max_passes), 1)
+    rng = np.random.default_rng(seed)
+
+    for _ in range(max(int(max_passes), 1)):
+        Ns = ends.shape[0]
+        if Ns == 0:
+            break
+        num_nodes = int(ends.max()) + 1
+        ids = ends.ravel()
+        deg = np.bincount(ids, minlength=num_nodes)
+        order = np.argsort(ids, kind='stable')
+        start = np.cumsum(deg) - deg
+        nodes = np.flatnonzero(deg == 2)
+        if nodes.size == 0:
+            break
+
+        # the two segments (s1, s2) of each two-armed node, the side of the
+        # node in them and the neighbors (u, w) at their other ends
+        slot1, slot2 = order[start[nodes]], order[start[nodes]+1]
+        s1, side1 = slot1 // 2, slot1 % 2
+        s2, side2 = slot2 // 2, slot2 % 2
+        u, w = ends[s1, 1-side1], ends[s2, 1-side2]
+        e1 = P[s1, 1-side1] - P[s1, side1]
+        e2 = P[s2, 1-side2] - P[s2, side2]
+
+        # distance of the node from the segment between its neighbors
+        chord = e2 - e1
+        clen2 = np.einsum('ij,ij->i', chord, chord)
+        t = np.divide(-np.einsum('ij,ij->i', e1, chord), clen2,
+                      out=np.zeros_like(clen2), where=clen2 > 0)
+        t = np.clip(t, 0.0, 1.0)
+        dist = np.linalg.norm(e1 + t[:,None]*chord, axis=1)
+
+        ok = (s1 != s2) & (u != w) & (dist <= ptol)
+        cand = np.zeros(num_nodes, dtype=bool)
+        cand[nodes[ok]] = True
+        prio = rng.random(num_nodes)
+        sel = ok & ~(cand[u] & (prio[u] < prio[nodes])) & ~(cand[w] & (prio[w] < prio[nodes]))
+        if not sel.any():
+            break
+
+        # s1 becomes the line from u to w, s2 is dropped
+        a, sa = s1[sel], side1[sel]
+        Pu = P[a, 1-sa]
+        Pw = P[a, sa] + e2[sel]
+        ba = np.where((sa == 1)[:,None], b[a], -b[a])
+        ends[a,0], ends[a,1] = u[sel], w[sel]
+        P[a,0], P[a,1], b[a] = Pu, Pw, ba
+        keep = np.ones(Ns, dtype=bool)
+        keep[s2[sel]] = False
+        ends, P, b = ends[keep], P[keep], b[keep]
+
+    length = np.linalg.norm(P[:,1] - P[:,0], axis=1)
+    keep = length >= tol
+    return P[keep], b[keep]
+
+
+def read_lod_frames(filename: str):
+    """read_lod_frames: iterate over the (step, bounds, lines, burgers) frames of a LOD line file
+    """
+    itemsize = LOD_HEADER.itemsize
+    with open(filename, 'rb') as f:
+        if f.read(len(LOD_MAGIC)) != LOD_MAGIC:
+            raise ValueError("read_lod_frames: %s is not a LOD line file" % filename)
+        while True:
+            head = f.read(itemsize)
+            if len(head) < itemsize:
+                return
+            header = np.frombuffer(head, dtype=LOD_HEADER)[0]
+            n = int(header["num_lines"])
+            buf = f.read(36*n)
+            if len(buf) < 36*n:
+                return
+            lines = np.frombuffer(buf, dtype='<f4', count=6*n).reshape(n, 2, 3)
+            burgers = np.frombuffer(buf, dtype='<f4', count=3*n, offset=24*n).reshape(n, 3)
+            yield int(header["step"]), header["bounds"].copy(), lines, burgers
+
+
+class LODVisualizer:
+    """LODVisualizer: decimated rendering or export of the network off the simulation thread
+
+    Passed as vis to SimulateNetwork, which submits the network every
+    plot_freq steps instead of plotting it with VisualizeNetwork.
+
+    mode: 'image' renders every frame to <prefix>_<step>.<image_format> in
+          write_dir (matplotlib Agg, no window), 'export' appends it to
+          the LOD line file write_dir/filename for an external viewer
+    resolution: pixels across the box; the decimation tolerance is the
+          size of one pixel unless tol is given
+    max_queue: frames pending in the background, a frame submitted while
+          the queue is full is skipped (num_skipped)
+    trim: as in VisualizeNetwork.plot_disnet, only keep the lines inside the box
+    """
+    def __init__(self, mode: str='image', write_dir: str=".", filename: str="disnet.lod",
+                 prefix: str="disnet", image_format: str='png', resolution: int=1024,
+                 tol: float=None, max_passes: int=6, max_queue: int=1, trim: bool=False,
+                 **kwargs) -> None:
+        if mode not in ('image', 'export'):
+            raise ValueError("LODVisualizer: unknown mode %s" % mode)
+        self.mode = mode
+        self.write_dir = write_dir
+        self.filename = filename
+        self.prefix = prefix
+        self.image_format = image_format
+        self.resolution = resolution
+        self.tol = tol
+        self.max_passes = max_passes
+        self.max_queue = max_queue
+        self.trim = trim
+        self.num_frames = 0
+        self.num_skipped = 0
+        self.last_step = None
+        self._writer = None
+        self._file = None
+        self._started = False
+        self._fig = None
+        self._ax = None
+
+    def lines(self, data: dict):
+        """lines: decimated lines of export_data, their burgers vectors and the box bounds
+
+        Every line is shifted by a lattice vector so that its first end is
+        the image closest to the center of the cell.
+        """
+        cell, ends, P, burgers = segment_lines(data)
+        center = cell.center()
+        bounds = np.array([-0.5*np.diag(cell.h), 0.5*np.diag(cell.h)]) + center
+        tol = self.tol
+        if tol is None:
+            tol = np.max(np.linalg.norm(cell.h, axis=0)) / self.resolution
+        lines, burgers = decimate_lines(ends, P, burgers, tol, self.max_passes)
+        if lines.shape[0] > 0:
+            first = cell.closest_image(Rref=center, R=lines[:,0])
+            lines += (first - lines[:,0])[:,None,:]
+        if self.trim:
+            inside = np.all((lines >= bounds[0]) & (lines <= bounds[1]), axis=(1,2))
+            lines, burgers = lines[inside], burgers[inside]
+        return lines, burgers, bounds
+
+    def submit(self, DM, tstep: int, block: bool=False) -> bool:
+        """submit: hand the network of DM at step tstep to the background thread
+
+        Only the network arrays are copied here. Returns False if the frame
+        was skipped because the queue is full (never with block).
+        """
+        data = DM.export_data()
+        frame = {
+            "cell": {key: np.array(value) for key, value in data["cell"].items()},
+            "nodes": {"positions": np.array(data["nodes"]["positions"])},
+            "segs": {"nodeids": np.array(data["segs"]["nodeids"]),
+                     "burgers": np.array(data["segs"]["burgers"])},
+        }
+        if self._writer is None:
+            os.makedirs(self.write_dir, exist_ok=True)
+            self._writer = OutputWriter(self.max_queue)
+        if block:
+            self._writer.submit(self._frame, tstep, frame)
+        elif not self._writer.try_submit(self._frame, tstep, frame):
+            self.num_skipped += 1
+            return False
+        self.last_step = tstep
+        return True
+
+    def _frame(self, tstep: int, data: dict) -> None:
+        lines, burgers, bounds = self.lines(data)
+        if self.mode == 'export':
+            self._write_frame(tstep, lines, burgers, bounds)
+        else:
+            self._render(tstep, lines, bounds)
+        self.num_frames += 1
+
+    def _write_frame(self, tstep: int, lines: np.ndarray, burgers: np.ndarray, bounds: np.ndarray) -> None:
+        if self._file is None:
+            path = os.path.join(self.write_dir, self.filename)
+            self._file = open(path, 'ab' if self._started else 'wb')
+            if not self._started:
+                self._file.write(LOD_MAGIC)
+                self._started = True
+        header = np.zeros(1, dtype=LOD_HEADER)
+        header["step"] = tstep
+        header["num_lines"] = lines.shape[0]
+        header["bounds"] = bounds
+        self._file.write(header.tobytes())
+        self._file.write(np.ascontiguousarray(lines, dtype='<f4').tobytes())
+        self._file.write(np.ascontiguousarray(burgers, dtype='<f4').tobytes())
+        self._file.flush()
+
+    def _render(self, tstep: int, lines: np.ndarray, bounds: np.ndarray) -> None:
+        # a figure of its own on the Agg canvas: pyplot is not thread safe
+        from mpl_toolkits.mplot3d.art3d import Line3DCollection
+        if self._fig is None:
+            from matplotlib.figure import Figure
+            from matplotlib.backends.backend_agg import FigureCanvasAgg
+            self._fig = Figure(figsize=(8,8))
+            FigureCanvasAgg(self._fig)
+            self._ax = self._fig.add_subplot(projection='3d')
+        ax = self._ax
+        ax.cla()
+        ax.add_collection(Line3DCollection(lines, linewidths=0.5, colors='b'))
+        ax.set_xlim(bounds[0][0], bounds[1][0])
+        ax.set_ylim(bounds[0][1], bounds[1][1])
+        ax.set_zlim(bounds[0][2], bounds[1][2])
+        ax.set_xlabel('x')
+        ax.set_ylabel('y')
+        ax.set_zlabel('z')
+        ax.set_title("step %d: %d lines" % (tstep, lines.shape[0]))
+        try: ax.set_box_aspect([1,1,1])
+        except AttributeError: pass
+        path = os.path.join(self.write_dir, "%s_%d.%s" % (self.prefix, tstep, self.image_format))
+        self._fig.savefig(path, dpi=self.resolution/8)
+
+    def close(self) -> None:
+        """close: finish the submitted frames and close the LOD line file
+        """
+        try:
+            if self._writer is not None:
+                self._writer.close()
+        finally:
+            self._writer = None
+            if self._file is not None:
+                self._file.close()
+                self._file = None
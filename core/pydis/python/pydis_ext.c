@@ -0,0 +1,795 @@
+/***************************************************************************
+ *
+ *	Module:		pydis_ext.c
+ *	Description:	Python extension module with the hot entry points of
+ *			libpydis: the segment/segment force drivers, the
+ *			segment stress at field points, the batched minimum
+ *			distance, the SimpleGlide mobility and the bulk
+ *			Home_t transfer.
+ *
+ *			Arrays are taken through the buffer protocol (any
+ *			C-contiguous float64 or int32 buffer, e.g. NumPy
+ *			arrays) without copies; outputs are written in place
+ *			into buffers allocated by the caller.  The GIL is
+ *			released during the native work, and errors raised
+ *			by the library (Error.h) are turned into ValueError
+ *			instead of exiting the process.  The ctypes bindings
+ *			(pydis_lib.py) remain the fallback for everything.
+ *
+ *	Included functions:
+ *
+ *		segseg_force_all_pairs
+ *		segseg_force_all_pairs_multi
+ *		segseg_force_cell_list
+ *		segseg_force_pair_list
+ *		seg_stress_at_points
+ *		min_dist2_batch
+ *		mobility_simple_glide
+ *		home_import_arrays
+ *		home_export_arrays
+ *
+ **************************************************************************/
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include "ParadisProto.h"
+#include "Error.h"
+#include "SegSegForceDriver.h"
+#include "SegStressBatch.h"
+#include "GetMinDist2Batch.h"
+#include "MobilityGlide.h"
+
+/*
+ *      Maximum number of buffers held by one call
+ */
+#define EXT_MAX_BUFFERS 16
+
+typedef struct {
+        int       num;
+        Py_buffer view[EXT_MAX_BUFFERS];
+} BufferList_t;
+
+/*
+ *      Run the library call stmt with the GIL released and an error trap
+ *      set; failed is set (non-zero) if the library raised an error.
+ */
+#define EXT_NATIVE_CALL(failed, stmt)                           \
+        do {                                                    \
+            ErrorTrap_t trap_;                                  \
+            Py_BEGIN_ALLOW_THREADS                              \
+            ErrorTrapPush(&trap_);                              \
+            if (setjmp(trap_.env) == 0) {                       \
+                stmt;                                           \
+                ErrorTrapPop(&trap_);                           \
+            } else {                                            \
+                (failed) = 1;                                   \
+            }                                                   \
+            Py_END_ALLOW_THREADS                                \
+        } while (0)
+
+
+static void ReleaseBuffers(BufferList_t *list)
+{
+        int i;
+
+        for (i = 0; i < list->num; i++) {
+            PyBuffer_Release(&list->view[i]);
+        }
+        list->num = 0;
+
+        return;
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *	Function:	GetBuffer
+ *	Description:	Get the C-contiguous buffer of obj with items of
+ *			type 'd' (real8) or 'i' (int) and at least minItems
+ *			items, writable if requested.  None gives a NULL
+ *			pointer if optional.  The buffer is added to list
+ *			and released with it.
+ *
+ *	Returns:	0 on success, -1 with a Python exception set
+ *
+ *------------------------------------------------------------------------*/
+static int GetBuffer(BufferList_t *list, PyObject *obj, const char *name,
+                     char type, Py_ssize_t minItems, int writable,
+                     int optional, void **ptr)
+{
+        int        flags, typeOK;
+        Py_ssize_t itemSize;
+        Py_buffer  *view;
+        const char *format;
+
+        *ptr = NULL;
+
+        if (obj == Py_None) {
+            if (optional) return(0);
+            PyErr_Format(PyExc_TypeError, "%s must not be None", name);
+            return(-1);
+        }
+
+        if (list->num >= EXT_MAX_BUFFERS) {
+            PyErr_SetString(PyExc_RuntimeError, "too many buffers");
+            return(-1);
+        }
+
+        flags = PyBUF_C_CONTIGUOUS | PyBUF_FORMAT;
+        if (writable) flags |= PyBUF_WRITABLE;
+
+        view = &list->view[list->num];
+        if (PyObject_GetBuffer(obj, view, flags) != 0) {
+            PyErr_Clear();
+            PyErr_Format(PyExc_TypeError,
+                         "%s must be a C-contiguous%s buffer", name,
+                         writable ? " writable" : "");
+            return(-1);
+        }
+        list->num++;
+
+/*
+ *      Accept the native byte order codes of the struct module for a
+ *      single item of the native type ('=', '<' or '@' prefix).
+ */
+        format = (view->format != NULL) ? view->format : "B";
+        if ((*format == '@') || (*format == '=') || (*format == '<')) {
+            format++;
+        }
+
+        if (type == 'd') {
+            itemSize = sizeof(real8);
+            typeOK = (strcmp(format, "d") == 0);
+        } else {
+            itemSize = sizeof(int);
+            typeOK = (strcmp(format, "i") == 0) ||
+                     ((strcmp(format, "l") == 0) && (sizeof(long) == sizeof(int)));
+        }
+
+        if (!typeOK || (view->itemsize != itemSize)) {
+            PyErr_Format(PyExc_TypeError, "%s must be a %s buffer", name,
+                         (type == 'd') ? "float64" : "int32");
+            return(-1);
+        }
+
+        if (view->len < minItems * itemSize) {
+            PyErr_Format(PyExc_ValueError,
+                         "%s has %zd items, at least %zd are needed",
+                         name, view->len / itemSize, minItems);
+            return(-1);
+        }
+
+        *ptr = view->buf;
+
+        return(0);
+}
+
+
+/*
+ *      Number of items of a buffer already checked by GetBuffer
+ */
+static Py_ssize_t BufferItems(BufferList_t *list, int index)
+{
+        return(list->view[index].len / list->view[index].itemsize);
+}
+
+
+static PyObject *NativeError(const char *name)
+{
+        PyErr_Format(PyExc_ValueError, "%s: %s", name, ErrorMessage());
+        ErrorClear();
+
+        return(NULL);
+}
+
+
+/*-------------------------------------------------------------------------
+ *
+ *	Function:	GetDriverBuffers
+ *	Description:	Buffers of the arguments shared by the segment/segment
+ *			force drivers:
+ *
+ *			    nodeids (numSegs,2), R1, R2, burgers (numSegs,3),
+ *			    h, hinv (3,3), is_periodic (3,),
+ *			    quad_points, weights (Nint,) or None
+ *
+ *			The buffers are the first ones of list (nodeids is
+ *			buffer 0).
+ *
+ *------------------------------------------------------------------------*/
+static int GetDriverBuffers(BufferList_t *list, PyObject **obj,
+                            int *numSegs, int **nodeIDs, real8 **R1,
+                            real8 **R2, real8 **burgers, real8 **h,
+                            real8 **hinv, int **isPeriodic, int *Nint,
+                            real8 **quadPoints, real8 **weights)
+{
+        Py_ssize_t n;
+
+        if (GetBuffer(list, obj[0], "nodeids", 'i', 0, 0, 0,
+                      (void **)nodeIDs) != 0) {
+            return(-1);
+        }
+        n = BufferItems(list, 0) / 2;
+        *numSegs = (int)n;
+
+        if ((GetBuffer(list, obj[1], "R1", 'd', 3*n, 0, 0, (void **)R1) != 0) ||
+            (GetBuffer(list, obj[2], "R2", 'd', 3*n, 0, 0, (void **)R2) != 0) ||
+            (GetBuffer(list, obj[3], "burgers", 'd', 3*n, 0, 0,
+                       (void **)burgers) != 0) ||
+            (GetBuffer(list, obj[4], "h", 'd', 9, 0, 0, (void **)h) != 0) ||
+            (GetBuffer(list, obj[5], "hinv", 'd', 9, 0, 0, (void **)hinv) != 0) ||
+            (GetBuffer(list, obj[6], "is_periodic", 'i', 3, 0, 0,
+                       (void **)isPeriodic) != 0) ||
+            (GetBuffer(list, obj[7], "quad_points", 'd', 0, 0, 1,
+                       (void **)quadPoints) != 0)) {
+            return(-1);
+        }
+
+        *Nint = (*quadPoints == NULL) ? 0 : (int)BufferItems(list, list->num-1);
+
+        if (GetBuffer(list, obj[8], "weights", 'd', *Nint, 0, *Nint == 0,
+                      (void **)weights) != 0) {
+            return(-1);
+        }
+
+        if (*Nint == 0) *weights = NULL;
+
+        return(0);
+}
+
+
+static PyObject *ext_segseg_force_all_pairs(PyObject *self, PyObject *args)
+{
+        int          numNodes, numSegs, Nint, failed = 0;
+        int          *nodeIDs, *isPeriodic;
+        real8        a, MU, NU;
+        real8        *R1, *R2, *burgers, *h, *hinv, *quadPoints, *weights;
+        real8        *segForces, *nodeForces;
+        PyObject     *obj[9], *segObj, *nodeObj;
+        BufferList_t list = { 0 };
+
+        if (!PyArg_ParseTuple(args, "iOOOOOOOdddOOOO:segseg_force_all_pairs",
+                              &numNodes, &obj[0], &obj[1], &obj[2], &obj[3],
+                              &obj[4], &obj[5], &obj[6], &a, &MU, &NU,
+                              &obj[7], &obj[8], &segObj, &nodeObj)) {
+            return(NULL);
+        }
+
+        if ((GetDriverBuffers(&list, obj, &numSegs, &nodeIDs, &R1, &R2,
+                              &burgers, &h, &hinv, &isPeriodic, &Nint,
+                              &quadPoints, &weights) != 0) ||
+            (GetBuffer(&list, segObj, "segforces", 'd', 6*(Py_ssize_t)numSegs,
+                       1, 0, (void **)&segForces) != 0) ||
+            (GetBuffer(&list, nodeObj, "nodeforces", 'd', 3*(Py_ssize_t)numNodes,
+                       1, 0, (void **)&nodeForces) != 0)) {
+            ReleaseBuffers(&list);
+            return(NULL);
+        }
+
+        EXT_NATIVE_CALL(failed,
+                SegSegForceAllPairs(numNodes, numSegs, nodeIDs, R1, R2,
+                                    burgers, h, hinv, isPeriodic, a, MU, NU,
+                                    Nint, quadPoints, weights, NULL,
+                                    segForces, nodeForces));
+        ReleaseBuffers(&list);
+
+        if (failed) return(NativeError("segseg_force_all_pairs"));
+
+        Py_RETURN_NONE;
+}
+
+
+static PyObject *ext_segseg_force_all_pairs_multi(PyObject *self,
+                                                  PyObject *args)
+{
+        int          numNodes, numSegs, numNetworks, Nint, failed = 0;
+        int          *nodeIDs, *isPeriodic, *segOffset;
+        real8        a, MU, NU;
+        real8        *R1, *R2, *burgers, *h, *hinv, *quadPoints, *weights;
+        real8        *segForces, *nodeForces;
+        PyObject     *obj[9], *offsetObj, *segObj, *nodeObj;
+        BufferList_t list = { 0 };
+
+        if (!PyArg_ParseTuple(args, "iOOOOOOOOdddOOOO:segseg_force_all_pairs_multi",
+                              &numNodes, &offsetObj, &obj[0], &obj[1], &obj[2],
+                              &obj[3], &obj[4], &obj[5], &obj[6], &a, &MU, &NU,
+                              &obj[7], &obj[8], &segObj, &nodeObj)) {
+            return(NULL);
+        }
+
+        if ((GetDriverBuffers(&list, obj, &numSegs, &nodeIDs, &R1, &R2,
+                              &burgers, &h, &hinv, &isPeriodic, &Nint,
+                              &quadPoints, &weights) != 0) ||
+            (GetBuffer(&list, offsetObj, "seg_offset", 'i', 2, 0, 0,
+                       (void **)&segOffset) != 0)) {
+            ReleaseBuffers(&list);
+            return(NULL);
+        }
+
+        numNetworks = (int)BufferItems(&list, list.num-1) - 1;
+
+        if ((GetBuffer(&list, segObj, "segforces", 'd', 6*(Py_ssize_t)numSegs,
+                       1, 0, (void **)&segForces) != 0) ||
+            (GetBuffer(&list, nodeObj, "nodeforces", 'd', 3*(Py_ssize_t)numNodes,
+                       1, 0, (void **)&nodeForces) != 0)) {
+            ReleaseBuffers(&list);
+            return(NULL);
+        }
+
+        EXT_NATIVE_CALL(failed,
+                SegSegForceAllPairsMulti(numNodes, numSegs, numNetworks,
+                                         segOffset, nodeIDs, R1, R2, burgers,
+                                         h, hinv, isPeriodic, a, MU, NU,
+                                         Nint, quadPoints, weights, NULL,
+                                         segForces, nodeForces));
+        ReleaseBuffers(&list);
+
+        if (failed) return(NativeError("segseg_force_all_pairs_multi"));
+
+        Py_RETURN_NONE;
+}
+
+
+static PyObject *ext_segseg_force_cell_list(PyObject *self, PyObject *args)
+{
+        int          numNodes, numSegs, Nint, failed = 0;
+        int          *nodeIDs, *isPeriodic;
+        volatile int numPairs = 0;
+        real8        cutoff, a, MU, NU;
+        real8        *R1, *R2, *burgers, *h, *hinv, *quadPoints, *weights;
+        real8        *segForces, *nodeForces;
+        PyObject     *obj[9], *segObj, *nodeObj;
+        BufferList_t list = { 0 };
+
+        if (!PyArg_ParseTuple(args, "iOOOOOOOddddOOOO:segseg_force_cell_list",
+                              &numNodes, &obj[0], &obj[1], &obj[2], &obj[3],
+                              &obj[4], &obj[5], &obj[6], &cutoff, &a, &MU, &NU,
+                              &obj[7], &obj[8], &segObj, &nodeObj)) {
+            return(NULL);
+        }
+
+        if ((GetDriverBuffers(&list, obj, &numSegs, &nodeIDs, &R1, &R2,
+                              &burgers, &h, &hinv, &isPeriodic, &Nint,
+                              &quadPoints, &weights) != 0) ||
+            (GetBuffer(&list, segObj, "segforces", 'd', 6*(Py_ssize_t)numSegs,
+                       1, 0, (void **)&segForces) != 0) ||
+            (GetBuffer(&list, nodeObj, "nodeforces", 'd', 3*(Py_ssize_t)numNodes,
+                       1, 0, (void **)&nodeForces) != 0)) {
+            ReleaseBuffers(&list);
+            return(NULL);
+        }
+
+        EXT_NATIVE_CALL(failed,
+                numPairs = SegSegForceCellList(numNodes, numSegs, nodeIDs,
+                                               R1, R2, burgers, h, hinv,
+                                               isPeriodic, cutoff, a, MU, NU,
+                                               Nint, quadPoints, weights, NULL,
+                                               segForces, nodeForces));
+        ReleaseBuffers(&list);
+
+        if (failed) return(NativeError("segseg_force_cell_list"));
+
+        return(PyLong_FromLong(numPairs));
+}
+
+
+static PyObject *ext_segseg_force_pair_list(PyObject *self, PyObject *args)
+{
+        int          numNodes, numSegs, numPairs, Nint, failed = 0;
+        int          *nodeIDs, *isPeriodic, *pairs;
+        real8        a, MU, NU;
+        real8        *R1, *R2, *burgers, *h, *hinv, *quadPoints, *weights;
+        real8        *segForces, *nodeForces;
+        PyObject     *obj[9], *pairObj, *segObj, *nodeObj;
+        BufferList_t list = { 0 };
+
+        if (!PyArg_ParseTuple(args, "iOOOOOOOOdddOOOO:segseg_force_pair_list",
+                              &numNodes, &obj[0], &obj[1], &obj[2], &obj[3],
+                              &obj[4], &obj[5], &obj[6], &pairObj, &a, &MU, &NU,
+                              &obj[7], &obj[8], &segObj, &nodeObj)) {
+            return(NULL);
+        }
+
+        if ((GetDriverBuffers(&list, obj, &numSegs, &nodeIDs, &R1, &R2,
+                              &burgers, &h, &hinv, &isPeriodic, &Nint,
+                              &quadPoints, &weights) != 0) ||
+            (GetBuffer(&list, pairObj, "pairs", 'i', 0, 0, 0,
+                       (void **)&pairs) != 0)) {
+            ReleaseBuffers(&list);
+            return(NULL);
+        }
+
+        numPairs = (int)(BufferItems(&list, list.num-1) / 2);
+
+        if ((GetBuffer(&list, segObj, "segforces", 'd', 6*(Py_ssize_t)numSegs,
+                       1, 0, (void **)&segForces) != 0) ||
+            (GetBuffer(&list, nodeObj, "nodeforces", 'd', 3*(Py_ssize_t)numNodes,
+                       1, 0, (void **)&nodeForces) != 0)) {
+            ReleaseBuffers(&list);
+            return(NULL);
+        }
+
+        EXT_NATIVE_CALL(failed,
+                SegSegForcePairList(numNodes, numSegs, nodeIDs, R1, R2,
+                                    burgers, h, hinv, isPeriodic,
+                                    numPairs, pairs, a, MU, NU,
+                                    Nint, quadPoints, weights, NULL,
+                                    segForces, nodeForces));
+        ReleaseBuffers(&list);
+
+        if (failed) return(NativeError("segseg_force_pair_list"));
+
+        Py_RETURN_NONE;
+}
+
+
+static PyObject *ext_seg_stress_at_points(PyObject *self, PyObject *args)
+{
+        int          numPoints, numSegs, coordDep, failed = 0;
+        real8        a, MU, NU;
+        real8        *points, *R1, *R2, *burgers, *stress;
+        PyObject     *pointObj, *R1Obj, *R2Obj, *burgObj, *stressObj;
+        BufferList_t list = { 0 };
+
+        if (!PyArg_ParseTuple(args, "OOOOdddpO:seg_stress_at_points",
+                              &pointObj, &R1Obj, &R2Obj, &burgObj,
+                              &a, &MU, &NU, &coordDep, &stressObj)) {
+            return(NULL);
+        }
+
+        if (GetBuffer(&list, pointObj, "points", 'd', 0, 0, 0,
+                      (void **)&points) != 0) {
+            return(NULL);
+        }
+        numPoints = (int)(BufferItems(&list, 0) / 3);
+
+        if (GetBuffer(&list, R1Obj, "R1", 'd', 0, 0, 0, (void **)&R1) != 0) {
+            ReleaseBuffers(&list);
+            return(NULL);
+        }
+        numSegs = (int)(BufferItems(&list, 1) / 3);
+
+        if ((GetBuffer(&list, R2Obj, "R2", 'd', 3*(Py_ssize_t)numSegs, 0, 0,
+                       (void **)&R2) != 0) ||
+            (GetBuffer(&list, burgObj, "burgers", 'd', 3*(Py_ssize_t)numSegs,
+                       0, 0, (void **)&burgers) != 0) ||
+            (GetBuffer(&list, stressObj, "stress", 'd', 6*(Py_ssize_t)numPoints,
+                       1, 0, (void **)&stress) != 0)) {
+            ReleaseBuffers(&list);
+            return(NULL);
+        }
+
+        EXT_NATIVE_CALL(failed,
+                SegStressAtPoints(numPoints, points, numSegs, R1, R2, burgers,
+                                  a, MU, NU, coordDep, stress));
+        ReleaseBuffers(&list);
+
+        if (failed) return(NativeError("seg_stress_at_points"));
+
+        Py_RETURN_NONE;
+}
+
+
+static PyObject *ext_min_dist2_batch(PyObject *self, PyObject *args)
+{
+        int          i, numPairs, failed = 0;
+        int          *hitList;
+        volatile int numHits = 0;
+        real8        mindist2;
+        real8        *pv[8], *dist2, *ddist2dt, *L1, *L2;
+        PyObject     *pvObj[8], *outObj[4], *hitObj;
+        BufferList_t list = { 0 };
+        static const char *pvName[8] = { "p1", "v1", "p2", "v2",
+                                         "p3", "v3", "p4", "v4" };
+        static const char *outName[4] = { "dist2", "ddist2dt", "L1", "L2" };
+
+        if (!PyArg_ParseTuple(args, "OOOOOOOOdOOOOO:min_dist2_batch",
+                              &pvObj[0], &pvObj[1], &pvObj[2], &pvObj[3],
+                              &pvObj[4], &pvObj[5], &pvObj[6], &pvObj[7],
+                              &mindist2, &outObj[0], &outObj[1], &outObj[2],
+                              &outObj[3], &hitObj)) {
+            return(NULL);
+        }
+
+        if (GetBuffer(&list, pvObj[0], pvName[0], 'd', 0, 0, 0,
+                      (void **)&pv[0]) != 0) {
+            return(NULL);
+        }
+        numPairs = (int)(BufferItems(&list, 0) / 3);
+
+/*
+ *      Velocities (odd indices) are optional, None for zero velocities
+ */
+        for (i = 1; i < 8; i++) {
+            if (GetBuffer(&list, pvObj[i], pvName[i], 'd', 3*(Py_ssize_t)numPairs,
+                          0, i % 2, (void **)&pv[i]) != 0) {
+                ReleaseBuffers(&list);
+                return(NULL);
+            }
+        }
+
+        if ((GetBuffer(&list, outObj[0], outName[0], 'd', numPairs, 1, 0,
+                       (void **)&dist2) != 0) ||
+            (GetBuffer(&list, outObj[1], outName[1], 'd', numPairs, 1, 0,
+                       (void **)&ddist2dt) != 0) ||
+            (GetBuffer(&list, outObj[2], outName[2], 'd', numPairs, 1, 0,
+                       (void **)&L1) != 0) ||
+            (GetBuffer(&list, outObj[3], outName[3], 'd', numPairs, 1, 0,
+                       (void **)&L2) != 0) ||
+            (GetBuffer(&list, hitObj, "hits", 'i', numPairs, 1, 0,
+                       (void **)&hitList) != 0)) {
+            ReleaseBuffers(&list);
+            return(NULL);
+        }
+
+        EXT_NATIVE_CALL(failed,
+                numHits = GetMinDist2Batch(numPairs, pv[0], pv[1], pv[2],
+                                           pv[3], pv[4], pv[5], pv[6], pv[7],
+                                           mindist2, dist2, ddist2dt, L1, L2,
+                                           hitList));
+        ReleaseBuffers(&list);
+
+        if (failed) return(NativeError("min_dist2_batch"));
+
+        return(PyLong_FromLong(numHits));
+}
+
+
+static PyObject *ext_mobility_simple_glide(PyObject *self, PyObject *args)
+{
+        int          numNodes, numArms, failed = 0;
+        int          *constraints, *armStart, *armNbr, *isPeriodic;
+        real8        mob, vmax, epsNormal;
+        real8        *R, *nodeForces, *armPlanes, *h, *hinv, *nodeVels;
+        PyObject     *RObj, *conObj, *forceObj, *startObj, *nbrObj, *planeObj;
+        PyObject     *hObj, *hinvObj, *pbcObj, *velObj;
+        BufferList_t list = { 0 };
+
+        if (!PyArg_ParseTuple(args, "OOOOOOOOOdddO:mobility_simple_glide",
+                              &RObj, &conObj, &forceObj, &startObj, &nbrObj,
+                              &planeObj, &hObj, &hinvObj, &pbcObj,
+                              &mob, &vmax, &epsNormal, &velObj)) {
+            return(NULL);
+        }
+
+        if (GetBuffer(&list, RObj, "R", 'd', 0, 0, 0, (void **)&R) != 0) {
+            return(NULL);
+        }
+        numNodes = (int)(BufferItems(&list, 0) / 3);
+
+        if ((GetBuffer(&list, nbrObj, "arm_nbr", 'i', 0, 0, 0,
+                       (void **)&armNbr) != 0)) {
+            ReleaseBuffers(&list);
+            return(NULL);
+        }
+        numArms = (int)BufferItems(&list, 1);
+
+        if ((GetBuffer(&list, conObj, "constraints", 'i', numNodes, 0, 0,
+                       (void **)&constraints) != 0) ||
+            (GetBuffer(&list, forceObj, "nodeforces", 'd', 3*(Py_ssize_t)numNodes,
+                       0, 0, (void **)&nodeForces) != 0) ||
+            (GetBuffer(&list, startObj, "arm_start", 'i', (Py_ssize_t)numNodes+1,
+                       0, 0, (void **)&armStart) != 0) ||
+            (GetBuffer(&list, planeObj, "arm_planes", 'd', 3*(Py_ssize_t)numArms,
+                       0, 0, (void **)&armPlanes) != 0) ||
+            (GetBuffer(&list, hObj, "h", 'd', 9, 0, 0, (void **)&h) != 0) ||
+            (GetBuffer(&list, hinvObj, "hinv", 'd', 9, 0, 0, (void **)&hinv) != 0) ||
+            (GetBuffer(&list, pbcObj, "is_periodic", 'i', 3, 0, 0,
+                       (void **)&isPeriodic) != 0) ||
+            (GetBuffer(&list, velObj, "nodevels", 'd', 3*(Py_ssize_t)numNodes,
+                       1, 0, (void **)&nodeVels) != 0)) {
+            ReleaseBuffers(&list);
+            return(NULL);
+        }
+
+        if (armStart[numNodes] > numArms) {
+            ReleaseBuffers(&list);
+            PyErr_Format(PyExc_ValueError, "arm_start refers to %d arms, "
+                         "arm_nbr has %d", armStart[numNodes], numArms);
+            return(NULL);
+        }
+
+        EXT_NATIVE_CALL(failed,
+                MobilitySimpleGlide(numNodes, R, constraints, nodeForces,
+                                    armStart, armNbr, armPlanes,
+                                    h, hinv, isPeriodic, mob, vmax, epsNormal,
+                                    nodeVels));
+        ReleaseBuffers(&list);
+
+        if (failed) return(NativeError("mobility_simple_glide"));
+
+        Py_RETURN_NONE;
+}
+
+
+/*
+ *      Home_t structures are passed as their address (an integer, e.g.
+ *      ctypes.cast(home, ctypes.c_void_p).value).
+ */
+static int GetHome(PyObject *obj, Home_t **home)
+{
+        *home = (Home_t *)PyLong_AsVoidPtr(obj);
+
+        if (*home == (Home_t *)NULL) {
+            if (!PyErr_Occurred()) {
+                PyErr_SetString(PyExc_ValueError, "home is NULL");
+            }
+            return(-1);
+        }
+
+        return(0);
+}
+
+
+static PyObject *ext_home_import_arrays(PyObject *self, PyObject *args)
+{
+        int          numNodes, numSegs, failed = 0;
+        int          *tags, *constraints, *segNodes;
+        volatile int status = 0;
+        real8        *R, *burgers, *planes;
+        Home_t       *home;
+        PyObject     *homeObj, *tagObj, *RObj, *conObj, *segObj, *burgObj;
+        PyObject     *planeObj;
+        BufferList_t list = { 0 };
+
+        if (!PyArg_ParseTuple(args, "OOOOOOO:home_import_arrays", &homeObj,
+                              &tagObj, &RObj, &conObj, &segObj, &burgObj,
+                              &planeObj)) {
+            return(NULL);
+        }
+
+        if (GetHome(homeObj, &home) != 0) return(NULL);
+
+        if (GetBuffer(&list, tagObj, "tags", 'i', 0, 0, 0, (void **)&tags) != 0) {
+            return(NULL);
+        }
+        numNodes = (int)(BufferItems(&list, 0) / 2);
+
+        if (GetBuffer(&list, segObj, "nodeids", 'i', 0, 0, 0,
+                      (void **)&segNodes) != 0) {
+            ReleaseBuffers(&list);
+            return(NULL);
+        }
+        numSegs = (int)(BufferItems(&list, 1) / 2);
+
+        if ((GetBuffer(&list, RObj, "R", 'd', 3*(Py_ssize_t)numNodes, 0, 0,
+                       (void **)&R) != 0) ||
+            (GetBuffer(&list, conObj, "constraints", 'i', numNodes, 0, 0,
+                       (void **)&constraints) != 0) ||
+            (GetBuffer(&list, burgObj, "burgers", 'd', 3*(Py_ssize_t)numSegs,
+                       0, 0, (void **)&burgers) != 0) ||
+            (GetBuffer(&list, planeObj, "planes", 'd', 3*(Py_ssize_t)numSegs,
+                       0, 0, (void **)&planes) != 0)) {
+            ReleaseBuffers(&list);
+            return(NULL);
+        }
+
+/*
+ *      HomeImportArrays sets its own error trap and returns -1 on error
+ */
+        EXT_NATIVE_CALL(failed,
+                status = HomeImportArrays(home, numNodes, tags, R, constraints,
+                                          numSegs, segNodes, burgers, planes));
+        ReleaseBuffers(&list);
+
+        if (failed || (status < 0)) return(NativeError("home_import_arrays"));
+
+        Py_RETURN_NONE;
+}
+
+
+static PyObject *ext_home_export_arrays(PyObject *self, PyObject *args)
+{
+        int          maxNodes = 0, maxSegs = 0, numSegs = 0, failed = 0;
+        int          *tags, *constraints, *segNodes;
+        volatile int numNodes = 0;
+        real8        *R, *burgers, *planes;
+        Home_t       *home;
+        PyObject     *homeObj, *tagObj, *RObj, *conObj, *segObj, *burgObj;
+        PyObject     *planeObj;
+        BufferList_t list = { 0 };
+
+        tagObj = RObj = conObj = segObj = burgObj = planeObj = Py_None;
+
+        if (!PyArg_ParseTuple(args, "O|OOOOOO:home_export_arrays", &homeObj,
+                              &tagObj, &RObj, &conObj, &segObj, &burgObj,
+                              &planeObj)) {
+            return(NULL);
+        }
+
+        if (GetHome(homeObj, &home) != 0) return(NULL);
+
+/*
+ *      Without arrays only the numbers of nodes and segments are returned
+ */
+        if (GetBuffer(&list, tagObj, "tags", 'i', 0, 1, 1, (void **)&tags) != 0) {
+            return(NULL);
+        }
+        if (tags != NULL) maxNodes = (int)(BufferItems(&list, 0) / 2);
+
+        if (GetBuffer(&list, segObj, "nodeids", 'i', 0, 1, 1,
+                      (void **)&segNodes) != 0) {
+            ReleaseBuffers(&list);
+            return(NULL);
+        }
+        if (segNodes != NULL) maxSegs = (int)(BufferItems(&list, list.num-1) / 2);
+
+        if ((GetBuffer(&list, RObj, "R", 'd', 3*(Py_ssize_t)maxNodes, 1,
+                       tags == NULL, (void **)&R) != 0) ||
+            (GetBuffer(&list, conObj, "constraints", 'i', maxNodes, 1,
+                       tags == NULL, (void **)&constraints) != 0) ||
+            (GetBuffer(&list, burgObj, "burgers", 'd', 3*(Py_ssize_t)maxSegs, 1,
+                       segNodes == NULL, (void **)&burgers) != 0) ||
+            (GetBuffer(&list, planeObj, "planes", 'd', 3*(Py_ssize_t)maxSegs, 1,
+                       segNodes == NULL, (void **)&planes) != 0)) {
+            ReleaseBuffers(&list);
+            return(NULL);
+        }
+
+        EXT_NATIVE_CALL(failed,
+                numNodes = HomeExportArrays(home, maxNodes, tags, R,
+                                            constraints, maxSegs, &numSegs,
+                                            segNodes, burgers, planes));
+        ReleaseBuffers(&list);
+
+        if (failed || (numNodes < 0)) return(NativeError("home_export_arrays"));
+
+        return(Py_BuildValue("(ii)", (int)numNodes, numSegs));
+}
+
+
+static PyMethodDef pydisExtMethods[] = {
+        { "segseg_force_all_pairs", ext_segseg_force_all_pairs, METH_VARARGS,
+          "segseg_force_all_pairs(num_nodes, nodeids, R1, R2, burgers, h, hinv, "
+          "is_periodic, a, mu, nu, quad_points, weights, segforces, nodeforces)\n"
+          "SegSegForceAllPairs into segforces (Nseg,6) and nodeforces (num_nodes,3)" },
+        { "segseg_force_all_pairs_multi", ext_segseg_force_all_pairs_multi,
+          METH_VARARGS,
+          "segseg_force_all_pairs_multi(num_nodes, seg_offset, nodeids, R1, R2, "
+          "burgers, h, hinv, is_periodic, a, mu, nu, quad_points, weights, "
+          "segforces, nodeforces)\nSegSegForceAllPairsMulti over the networks "
+          "of the segments seg_offset[n]:seg_offset[n+1]" },
+        { "segseg_force_cell_list", ext_segseg_force_cell_list, METH_VARARGS,
+          "segseg_force_cell_list(num_nodes, nodeids, R1, R2, burgers, h, hinv, "
+          "is_periodic, cutoff, a, mu, nu, quad_points, weights, segforces, "
+          "nodeforces)\nSegSegForceCellList, returns the number of pairs evaluated" },
+        { "segseg_force_pair_list", ext_segseg_force_pair_list, METH_VARARGS,
+          "segseg_force_pair_list(num_nodes, nodeids, R1, R2, burgers, h, hinv, "
+          "is_periodic, pairs, a, mu, nu, quad_points, weights, segforces, "
+          "nodeforces)\nSegSegForcePairList over the segment pairs (M,2)" },
+        { "seg_stress_at_points", ext_seg_stress_at_points, METH_VARARGS,
+          "seg_stress_at_points(points, R1, R2, burgers, a, mu, nu, coord_dep, "
+          "stress)\nSegStressAtPoints, adds to stress (K,6)" },
+        { "min_dist2_batch", ext_min_dist2_batch, METH_VARARGS,
+          "min_dist2_batch(p1, v1, p2, v2, p3, v3, p4, v4, mindist2, dist2, "
+          "ddist2dt, L1, L2, hits)\nGetMinDist2Batch (velocities may be None), "
+          "returns the number of hits" },
+        { "mobility_simple_glide", ext_mobility_simple_glide, METH_VARARGS,
+          "mobility_simple_glide(R, constraints, nodeforces, arm_start, arm_nbr, "
+          "arm_planes, h, hinv, is_periodic, mob, vmax, eps_normal, nodevels)\n"
+          "MobilitySimpleGlide into nodevels (Nnode,3)" },
+        { "home_import_arrays", ext_home_import_arrays, METH_VARARGS,
+          "home_import_arrays(home, tags, R, constraints, nodeids, burgers, planes)\n"
+          "HomeImportArrays, home is the address of the Home_t" },
+        { "home_export_arrays", ext_home_export_arrays, METH_VARARGS,
+          "home_export_arrays(home[, tags, R, constraints, nodeids, burgers, planes])\n"
+          "HomeExportArrays, returns (num_nodes, num_segs)" },
+        { NULL, NULL, 0, NULL }
+};
+
+
+static struct PyModuleDef pydisExtModule = {
+        PyModuleDef_HEAD_INIT,
+        "pydis_ext",
+        "Buffer protocol bindings of the hot libpydis entry points, "
+        "releasing the GIL during the native work",
+        -1,
+        pydisExtMethods
+};
+
+
+PyMODINIT_FUNC PyInit_pydis_ext(void)
+{
+        return(PyModule_Create(&pydisExtModule));
+}
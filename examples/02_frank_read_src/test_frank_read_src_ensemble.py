@@ -0,0 +1,53 @@
+import numpy as np
+import sys, os
+
+pydis_paths = ['../../python', '../../lib', '../../core/pydis/python']
+[sys.path.append(os.path.abspath(path)) for path in pydis_paths if not path in sys.path]
+np.set_printoptions(threshold=20, edgeitems=5)
+
+from pydis import CellList
+from pydis import CalForce, MobilityLaw, TimeIntegration, Topology
+from pydis import Collision, Remesh, SimulateNetwork, SimulateEnsemble
+from test_frank_read_src_pydis import init_frank_read_src_loop
+
+Lbox = 1000.0
+
+def build_member(stress: float):
+    '''Frank-Read source under the resolved shear stress <stress>, one member of the ensemble
+    '''
+    net = init_frank_read_src_loop(box_length=Lbox, arm_length=0.125*Lbox, pbc=True)
+    nbrlist = CellList(cell=net.cell, n_div=[8,8,8])
+
+    state = {"burgmag": 3e-10, "mu": 50e9, "nu": 0.3, "a": 1.0, "maxseg": 0.04*Lbox, "minseg": 0.01*Lbox, "rann": 3.0}
+
+    calforce  = CalForce(force_mode='Elasticity_SBA', state=state)
+    mobility  = MobilityLaw(mobility_law='SimpleGlide', state=state)
+    timeint   = TimeIntegration(integrator='EulerForward', dt=1.0e-8, state=state)
+    topology  = Topology(split_mode='MaxDiss', state=state, force=calforce, mobility=mobility)
+    collision = Collision(collision_mode='Proximity', state=state, nbrlist=nbrlist)
+    remesh    = Remesh(remesh_rule='LengthBased', state=state)
+
+    sim = SimulateNetwork(calforce=calforce, mobility=mobility, timeint=timeint,
+                          topology=topology, collision=collision, remesh=remesh,
+                          state=state, max_step=100, loading_mode="stress",
+                          applied_stress=np.array([0.0, 0.0, 0.0, 0.0, -stress, 0.0]))
+    return sim, net, state
+
+def main(executor: str='thread'):
+    global results
+
+    stresses = np.linspace(2.0e8, 6.0e8, 8)
+    ensemble = SimulateEnsemble(build_member, stresses, executor=executor,
+                                batch_forces=(executor == 'thread'))
+    results = ensemble.run()
+
+    for stress, (data, state) in zip(stresses, results):
+        print("stress = %e: %d nodes" % (stress, len(data["nodes"]["tags"])))
+    if ensemble.batcher is not None:
+        print("%d force requests in %d native calls" % (ensemble.batcher.num_requests, ensemble.batcher.num_calls))
+
+    return len(results) == len(stresses)
+
+
+if __name__ == "__main__":
+    main(sys.argv[1] if len(sys.argv) > 1 else 'thread')
@@ -0,0 +1,150 @@
+"""@package docstring
+Checkpoint: binary memory-mappable file format for dislocation networks
+
+A checkpoint file holds a small JSON header followed by raw arrays:
+
+    8 bytes   magic b'DISNETCK'
+    8 bytes   header length (little-endian uint64)
+    header    UTF-8 JSON, padded with spaces to CHECKPOINT_ALIGN
+    arrays    raw C-ordered data, each starting on CHECKPOINT_ALIGN bytes
+
+The header carries the 'version', 'nodes_attr' and 'segs_attr' schema of
+DisNetManager.write_json, the cell, and for every array its name, dtype,
+shape and file offset. The 'nodes' and 'segs' arrays are the (N,6) and
+(M,8) float64 tables described by nodes_attr and segs_attr; any other
+array (e.g. from the simulation state) is stored as is. On read the
+arrays are numpy memmaps, so opening a checkpoint does not parse or copy
+its data.
+"""
+import json
+import numpy as np
+
+CHECKPOINT_MAGIC = b'DISNETCK'
+CHECKPOINT_FORMAT_VERSION = 1
+CHECKPOINT_ALIGN = 64
+
+NODES_ATTR = ['domain', 'index', 'x', 'y', 'z', 'constraint']
+SEGS_ATTR = ['node1', 'node2', 'bx', 'by', 'bz', 'nx', 'ny', 'nz']
+
+
+def _aligned(n: int) -> int:
+    return (n + CHECKPOINT_ALIGN - 1) // CHECKPOINT_ALIGN * CHECKPOINT_ALIGN
+
+
+def _as_table(data, keys: tuple, ncol: int) -> np.ndarray:
+    """_as_table: (N,ncol) float64 table of a nodes or segs entry of export_data
+       (a dict of arrays, hstacked in the order of keys, or already a table)
+    """
+    if isinstance(data, dict):
+        n = len(data[keys[0]])
+        if n == 0:
+            return np.zeros((0, ncol))
+        table = np.hstack([np.asarray(data[key], dtype=np.float64).reshape(n, -1) for key in keys])
+    else:
+        table = np.asarray(data, dtype=np.float64).reshape(-1, ncol)
+    return np.ascontiguousarray(table)
+
+
+def write_checkpoint_file(filename: str, data: dict, arrays: dict=None, attrs: dict=None) -> None:
+    """write_checkpoint_file: write network data (as from export_data) to a checkpoint file
+
+       arrays: additional numeric arrays stored by name
+       attrs:  additional JSON serializable values stored in the header
+    """
+    tables = {
+        "nodes": _as_table(data["nodes"], ("tags", "positions", "constraints"), len(NODES_ATTR)),
+        "segs": _as_table(data["segs"], ("nodeids", "burgers", "planes"), len(SEGS_ATTR)),
+    }
+    for name, arr in (arrays or {}).items():
+        if name in tables:
+            raise ValueError("write_checkpoint_file: array name %s is reserved" % name)
+        tables[name] = np.ascontiguousarray(arr)
+
+    cell = data["cell"]
+    header = {
+        "format": "disnet-checkpoint",
+        "format_version": CHECKPOINT_FORMAT_VERSION,
+        "version": "1.0",
+        "nodes_attr": NODES_ATTR,
+        "segs_attr": SEGS_ATTR,
+        "cell": {
+            "h": np.asarray(cell["h"], dtype=np.float64).tolist(),
+            "origin": np.asarray(cell["origin"], dtype=np.float64).tolist(),
+            "is_periodic": [bool(p) for p in cell["is_periodic"]],
+        },
+        "attrs": attrs or {},
+        "arrays": [],
+    }
+
+    # the offsets depend on the header length, which depends on the offsets:
+    # lay the arrays out after a header estimate and grow it until it fits
+    header_space = CHECKPOINT_ALIGN
+    while True:
+        offset = header_space
+        header["arrays"] = []
+        for name, arr in tables.items():
+            header["arrays"].append({"name": name, "dtype": arr.dtype.str,
+                                     "shape": list(arr.shape), "offset": offset})
+            offset = _aligned(offset + arr.nbytes)
+        text = json.dumps(header).encode('utf-8')
+        if 16 + len(text) <= header_space:
+            break
+        header_space = _aligned(16 + len(text))
+
+    with open(filename, 'wb') as f:
+        f.write(CHECKPOINT_MAGIC)
+        f.write(np.array([len(text)], dtype='<u8').tobytes())
+        f.write(text)
+        f.write(b' ' * (header_space - 16 - len(text)))
+        for entry, arr in zip(header["arrays"], tables.values()):
+            f.seek(entry["offset"])
+            f.write(arr.tobytes())
+        f.truncate(max(offset, header_space))
+
+
+def read_checkpoint_header(filename: str) -> dict:
+    """read_checkpoint_header: return the header of a checkpoint file
+    """
+    with open(filename, 'rb') as f:
+        if f.read(8) != CHECKPOINT_MAGIC:
+            raise ValueError("read_checkpoint_header: %s is not a checkpoint file" % filename)
+        length = int(np.frombuffer(f.read(8), dtype='<u8')[0])
+        header = json.loads(f.read(length).decode('utf-8'))
+    if header.get("format_version", 0) > CHECKPOINT_FORMAT_VERSION:
+        raise ValueError("read_checkpoint_header: format version %s not supported" % header.get("format_version"))
+    if header.get("version") != "1.0":
+        raise ValueError("read_checkpoint_header: version not supported")
+    return header
+
+
+def open_checkpoint(filename: str, mmap: bool=True):
+    """open_checkpoint: return the header and the arrays of a checkpoint file
+
+       The arrays are read-only memmaps of the file if mmap is set, copies
+       in memory otherwise.
+    """
+    header = read_checkpoint_header(filename)
+    arrays = {}
+    for entry in header["arrays"]:
+        shape = tuple(entry["shape"])
+        if int(np.prod(shape)) == 0:
+            arrays[entry["name"]] = np.zeros(shape, dtype=entry["dtype"])
+            continue
+        arr = np.memmap(filename, dtype=entry["dtype"], mode='r', offset=entry["offset"], shape=shape)
+        arrays[entry["name"]] = arr if mmap else np.array(arr)
+    return header, arrays
+
+
+def checkpoint_to_data(header: dict, arrays: dict) -> dict:
+    """checkpoint_to_data: network data in the format of import_data from an opened checkpoint
+    """
+    nodes, segs = arrays["nodes"], arrays["segs"]
+    cell = header["cell"]
+    return {
+        "cell": {"h": np.array(cell["h"]), "origin": np.array(cell["origin"]),
+                 "is_periodic": list(cell["is_periodic"])},
+        "nodes": {"tags": nodes[:,0:2].astype(int), "positions": nodes[:,2:5],
+                  "constraints": nodes[:,5:6].astype(int)},
+        "segs": {"nodeids": segs[:,0:2].astype(int), "burgers": segs[:,2:5],
+                 "planes": segs[:,5:8]},
+    }
@@ -49,6 +49,27 @@ class DisNet_Base(ABC):
         """
         pass
 
+    def num_changes(self):
+        """num_changes: number of changes since the last clear_changes,
+           None if the implementation does not track changes
+        """
+        return None
+
+    def clear_changes(self):
+        """clear_changes: start recording changes from the current network
+        """
+        pass
+
+    def export_delta(self):
+        """export_delta: export the changes since the last clear_changes
+        """
+        raise NotImplementedError("export_delta: change tracking not implemented")
+
+    def import_delta(self, delta):
+        """import_delta: apply changes exported by export_delta
+        """
+        raise NotImplementedError("import_delta: change tracking not implemented")
+
 
 class DisNet_Python(DisNet_Base):
     """DisNet_Python: base class for DisNet inherited by PyDiS
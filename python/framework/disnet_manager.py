@@ -10,7 +10,7 @@ class DisNetManager:
 
     Implements synchronization between different implementations of DisNet
     """
-    def __init__(self, disnet=None):
+    def __init__(self, disnet=None, delta_threshold: float=0.5):
         self.disnet_dict = {}
         if disnet is not None and not isinstance(disnet, type):
             self.disnet_dict[type(disnet)] = disnet
@@ -18,6 +18,13 @@ class DisNetManager:
             raise ValueError("DisNetManager: user need to provide a disnet object (not class)")
         self._last_active_type = list(self.disnet_dict)[0] if self.disnet_dict else None
         self._active_type = None
+        # synchronize by changes only if they are at most delta_threshold
+        # times the number of nodes and segments
+        self.delta_threshold = delta_threshold
+        # types whose networks were identical at the last synchronization
+        self._synced_types = set(self.disnet_dict)
+        self.num_full_syncs = 0
+        self.num_delta_syncs = 0
 
     def add_disnet(self, disnet=None, cell=None, cell_list=None):
         """Add DisNet object of disnet_type
@@ -28,6 +35,7 @@ class DisNetManager:
 
         self.disnet_dict[type(disnet)] = disnet
         self._last_active_type = type(disnet)
+        self._synced_types = {type(disnet)}
 
     def synchronize_disnet(self, disnet_src, disnet_des):
         """Synchronize DisNet between disnet_src and disnet_des
@@ -51,10 +59,33 @@ class DisNetManager:
             G_des = disnet_des()
             self.add_disnet(G_des)
 
-        G_des.import_data(G_src.export_data())
+        if not self._synchronize_delta(disnet_src, disnet_des, G_src, G_des):
+            G_des.import_data(G_src.export_data())
+            self.num_full_syncs += 1
+        G_src.clear_changes()
+        G_des.clear_changes()
+        self._synced_types = {disnet_src, disnet_des}
 
         self._last_active_type = disnet_des
 
+    def _synchronize_delta(self, disnet_src, disnet_des, G_src, G_des) -> bool:
+        """Ship only the changes of G_src since the last synchronization
+           Returns False if a full synchronization is needed instead
+        """
+        if disnet_src not in self._synced_types or disnet_des not in self._synced_types:
+            return False
+        num_changes = G_src.num_changes()
+        if num_changes is None:
+            return False
+        if num_changes > self.delta_threshold * (G_src.num_nodes() + G_src.num_segments()):
+            return False
+        try:
+            G_des.import_delta(G_src.export_delta())
+        except NotImplementedError:
+            return False
+        self.num_delta_syncs += 1
+        return True
+
     def get_disnet(self, disnet_type=None):
         """Get DisNet object of disnet_type
         """
@@ -90,10 +121,13 @@ class DisNetManager:
         G = self.get_disnet()
         return G.import_data(data)
 
-    def write_json(self, filename):
+    def write_json(self, filename, data: dict=None):
         """Write DisNetManager data to JSON file
+
+        data (as from export_data, e.g. a snapshot taken earlier) is written
+        instead of the current network if given
         """
-        data = self.export_data()
+        data = self.export_data() if data is None else dict(data)
         data['version'] = '1.0'
         data['nodes_attr'] = ['domain', 'index', 'x', 'y', 'z', 'constraint']
         data['segs_attr'] = ['node1', 'node2', 'bx', 'by', 'bz', 'nx', 'ny', 'nz']
@@ -122,6 +156,63 @@ class DisNetManager:
         data['segs']  = np.array(data['segs'])
         self.import_data(data)
 
+    def read_paradis(self, filename, is_periodic: list=[True,True,True]):
+        """Read a ParaDiS nodal data (restart) file with the native pydis loader
+        """
+        from pydis.util.paradis_util import paradis_lib
+        self.import_data(paradis_lib().read_data_file(filename, is_periodic))
+
+    def write_checkpoint(self, filename, state: dict=None, data: dict=None):
+        """Write DisNetManager data to a binary checkpoint file (see checkpoint.py)
+
+        The numeric arrays and scalar values of state are stored with the
+        network, other entries (e.g. the per node dictionaries) are not.
+        data is written instead of the current network if given, as in
+        write_json.
+        """
+        from .checkpoint import write_checkpoint_file
+        arrays, attrs = {}, {}
+        for key, value in (state or {}).items():
+            if isinstance(value, np.ndarray) and value.dtype.kind in 'biuf':
+                arrays["state/" + key] = value
+            elif isinstance(value, (bool, int, float, str)):
+                attrs[key] = value
+        write_checkpoint_file(filename, self.export_data() if data is None else data, arrays, attrs)
+
+    def snapshot_data(self) -> dict:
+        """Copy of the DisNet data that stays valid while the network changes
+
+        (the export_data of a network type may share its storage)
+        """
+        from .output_writer import snapshot
+        return snapshot(self.export_data())
+
+    def read_checkpoint(self, filename, mmap: bool=True) -> dict:
+        """Read DisNetManager data from a binary checkpoint file
+
+        Returns the state stored with the network; its arrays are read-only
+        memmaps of the file if mmap is set.
+        """
+        from .checkpoint import open_checkpoint, checkpoint_to_data
+        header, arrays = open_checkpoint(filename, mmap=mmap)
+        self.import_data(checkpoint_to_data(header, arrays))
+        state = dict(header.get("attrs", {}))
+        for name, arr in arrays.items():
+            if name.startswith("state/"):
+                state[name[len("state/"):]] = arr
+        return state
+
+    def read_trajectory(self, filename, step: int=None, frame: int=-1):
+        """Read the network of a step (or by default of the last frame) from a trajectory file
+
+        (see trajectory.py; use trajectory.TrajectoryReader directly to read
+        many frames of the same file)
+        """
+        from .trajectory import TrajectoryReader
+        reader = TrajectoryReader(filename)
+        data = reader.read_step(step) if step is not None else reader.read_frame(frame)
+        self.import_data(data)
+
     @property
     def G(self):
         """Return graph of DisNet
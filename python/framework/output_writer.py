@@ -0,0 +1,95 @@
+"""@package docstring
+OutputWriter: background writer for simulation output
+
+Jobs are run in order by a background thread. The queue holds at most
+max_queue pending jobs; submitting to a full queue blocks until the
+writer catches up, which bounds the memory held by pending snapshots.
+"""
+import queue
+import threading
+import numpy as np
+
+
+def snapshot(obj):
+    """snapshot: copy of obj safe to hand to the writer
+
+       numpy arrays (including views into the network storage) are copied,
+       dicts, lists and tuples are rebuilt around copied elements, any
+       other object is shared.
+    """
+    if isinstance(obj, np.ndarray):
+        return np.array(obj)
+    if isinstance(obj, dict):
+        return {key: snapshot(value) for key, value in obj.items()}
+    if isinstance(obj, (list, tuple)):
+        return type(obj)(snapshot(value) for value in obj)
+    return obj
+
+
+class OutputWriter:
+    """OutputWriter: run output jobs in a background thread with a bounded queue
+    """
+    def __init__(self, max_queue: int=2) -> None:
+        self._queue = queue.Queue(maxsize=max(int(max_queue), 1))
+        self._error = None
+        self._thread = threading.Thread(target=self._run, daemon=True)
+        self._thread.start()
+
+    def _run(self) -> None:
+        while True:
+            job = self._queue.get()
+            try:
+                if job is None:
+                    return
+                func, args, kwargs = job
+                if self._error is None:
+                    func(*args, **kwargs)
+            except Exception as e:
+                self._error = e
+            finally:
+                self._queue.task_done()
+
+    def _raise_error(self) -> None:
+        if self._error is not None:
+            error, self._error = self._error, None
+            raise error
+
+    def submit(self, func, *args, **kwargs) -> None:
+        """submit: queue func(*args, **kwargs), blocking while the queue is full
+
+           The arguments must not be modified afterwards (see snapshot).
+           Raises the error of a previous job if one failed.
+        """
+        self._raise_error()
+        if not self._thread.is_alive():
+            raise ValueError("OutputWriter: writer is closed")
+        self._queue.put((func, args, kwargs))
+
+    def try_submit(self, func, *args, **kwargs) -> bool:
+        """try_submit: queue func(*args, **kwargs) unless the queue is full
+
+           Returns False (and drops the job) instead of blocking, for
+           output that may skip frames, e.g. monitoring.
+        """
+        self._raise_error()
+        if not self._thread.is_alive():
+            raise ValueError("OutputWriter: writer is closed")
+        try:
+            self._queue.put_nowait((func, args, kwargs))
+        except queue.Full:
+            return False
+        return True
+
+    def flush(self) -> None:
+        """flush: wait until all submitted jobs are done
+        """
+        self._queue.join()
+        self._raise_error()
+
+    def close(self) -> None:
+        """close: finish the submitted jobs and stop the writer thread
+        """
+        if self._thread.is_alive():
+            self._queue.put(None)
+            self._thread.join()
+        self._raise_error()
@@ -0,0 +1,175 @@
+"""@package docstring
+Profiler: nested per-phase wall time and event counters of a simulation
+
+Phases are timed with the phase() context manager; a phase entered
+inside another one is recorded under the joined path, e.g.
+"step/force". Counters are added with count(). Between begin_step() and
+end_step() the times and counters of one step are gathered, merged with
+the native profile (see pydis.util.native_profile) under "native/...",
+added to the totals and, if a dump file is given, written as one JSON
+line per step. Native hardware counters, if the library was built with
+them, are counters named "hw/<phase>/<counter>".
+"""
+import json
+import time
+
+
+class _Phase:
+    __slots__ = ("profiler", "name", "start")
+
+    def __init__(self, profiler, name: str) -> None:
+        self.profiler = profiler
+        self.name = name
+
+    def __enter__(self):
+        profiler = self.profiler
+        profiler._stack.append(self.name)
+        self.start = time.perf_counter()
+        return self
+
+    def __exit__(self, *exc) -> bool:
+        elapsed = time.perf_counter() - self.start
+        profiler = self.profiler
+        path = "/".join(profiler._stack)
+        profiler._stack.pop()
+        entry = profiler._step_phases.get(path)
+        if entry is None:
+            profiler._step_phases[path] = [elapsed, 1]
+        else:
+            entry[0] += elapsed
+            entry[1] += 1
+        return False
+
+
+class _NullPhase:
+    __slots__ = ()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc) -> bool:
+        return False
+
+
+class Profiler:
+    """Profiler: nested per-phase wall time and counters, per step and in total
+
+    native:    object with reset() and read() methods for the native
+               profile, read() returning {"phases": {name: {"time", "calls"}},
+               "counters": {name: value}} (see pydis.util.native_profile)
+    dump_file: if given, every step is appended to it as a JSON line
+    """
+    def __init__(self, native=None, dump_file: str=None) -> None:
+        self.native = native
+        self.dump_file = dump_file
+        self._dump = None
+        self._stack = []
+        self._step = None
+        self._step_phases = {}
+        self._step_counters = {}
+        self.phases = {}
+        self.counters = {}
+        self.num_steps = 0
+        self.last_step = None
+
+    def phase(self, name: str) -> _Phase:
+        """phase: context manager timing the enclosed code as phase name
+        """
+        return _Phase(self, name)
+
+    def count(self, name: str, n: int=1) -> None:
+        """count: add n to counter name of the current step
+        """
+        self._step_counters[name] = self._step_counters.get(name, 0) + n
+
+    def begin_step(self, step: int) -> None:
+        """begin_step: start gathering the phases and counters of step
+        """
+        self._step = step
+        self._step_phases = {}
+        self._step_counters = {}
+        if self.native is not None:
+            self.native.reset()
+
+    def end_step(self) -> dict:
+        """end_step: add the current step to the totals and return its record
+        """
+        phases = {path: {"time": t, "calls": n} for path, (t, n) in self._step_phases.items()}
+        counters = dict(self._step_counters)
+        if self.native is not None:
+            native = self.native.read()
+            for name, entry in native["phases"].items():
+                if entry["calls"] > 0:
+                    phases["native/" + name] = dict(entry)
+            for name, value in native["counters"].items():
+                if value:
+                    counters[name] = counters.get(name, 0) + value
+            for phase, hw in native.get("hwcounters", {}).items():
+                if native["phases"].get(phase, {}).get("calls", 0) > 0:
+                    for name, value in hw.items():
+                        counters["hw/%s/%s" % (phase, name)] = value
+
+        for path, entry in phases.items():
+            total = self.phases.setdefault(path, {"time": 0.0, "calls": 0})
+            total["time"] += entry["time"]
+            total["calls"] += entry["calls"]
+        for name, value in counters.items():
+            self.counters[name] = self.counters.get(name, 0) + value
+        self.num_steps += 1
+
+        record = {"step": self._step, "phases": phases, "counters": counters}
+        self.last_step = record
+        if self.dump_file is not None:
+            if self._dump is None:
+                self._dump = open(self.dump_file, 'w')
+            self._dump.write(json.dumps(record) + '\n')
+        self._step_phases = {}
+        self._step_counters = {}
+        return record
+
+    def results(self) -> dict:
+        """results: totals over all finished steps
+        """
+        return {"steps": self.num_steps,
+                "phases": {path: dict(entry) for path, entry in self.phases.items()},
+                "counters": dict(self.counters)}
+
+    def report(self) -> str:
+        """report: totals as a text table, phases in path order
+        """
+        lines = ["%-32s %12s %8s %10s" % ("phase", "time (s)", "calls", "per step")]
+        for path in sorted(self.phases):
+            entry = self.phases[path]
+            lines.append("%-32s %12.6f %8d %10.6f" % (path, entry["time"], entry["calls"],
+                                                     entry["time"] / max(self.num_steps, 1)))
+        for name in sorted(self.counters):
+            lines.append("%-32s %12d" % (name, self.counters[name]))
+        return "\n".join(lines)
+
+    def close(self) -> None:
+        """close: close the dump file
+        """
+        if self._dump is not None:
+            self._dump.close()
+            self._dump = None
+
+
+class NullProfiler:
+    """NullProfiler: Profiler interface that records nothing
+    """
+    _phase = _NullPhase()
+
+    def phase(self, name: str) -> _NullPhase:
+        return self._phase
+
+    def count(self, name: str, n: int=1) -> None:
+        pass
+
+    def begin_step(self, step: int) -> None:
+        pass
+
+    def end_step(self) -> None:
+        return None
+
+    def close(self) -> None:
+        pass
@@ -0,0 +1,338 @@
+"""@package docstring
+Trajectory: streaming delta-compressed trajectory store
+
+A trajectory file is a sequence of frames, each one a keyframe holding
+the full network or a delta from the previous frame:
+
+    8 bytes   magic b'DISTRAJ1'
+    frames    8 bytes record length (little-endian uint64), then the
+              record: a JSON header line and the zlib compressed arrays
+              listed in it
+    index     a last record (type 'index') with the offset and step of
+              every frame, followed by b'TRAJIDX1' and its offset
+
+A delta holds the position changes of the nodes kept from the previous
+frame, and the removed and added nodes and segments (by node tag, so
+node order does not matter). With a quantum, the position changes are
+stored as integer multiples of it; the writer tracks the positions as
+the reader will reconstruct them, so the error stays within quantum/2
+and does not accumulate. Without a quantum the changes are float64 and
+the positions are exact up to rounding.
+
+Any frame can be read by applying the deltas since the previous
+keyframe (at most keyframe_interval-1 of them). A file left without an
+index (e.g. by a crash) is read by scanning its records.
+"""
+import json
+import zlib
+import numpy as np
+from .checkpoint import _as_table, NODES_ATTR, SEGS_ATTR
+
+TRAJECTORY_MAGIC = b'DISTRAJ1'
+TRAJECTORY_INDEX_MAGIC = b'TRAJIDX1'
+
+
+def _node_keys(tags: np.ndarray) -> np.ndarray:
+    """_node_keys: one int64 key per node tag (domain, index)
+    """
+    tags = np.asarray(tags, dtype=np.int64).reshape(-1, 2)
+    return (tags[:,0] << 32) | (tags[:,1] & 0xffffffff)
+
+
+def _key_tags(keys: np.ndarray) -> np.ndarray:
+    keys = np.asarray(keys, dtype=np.int64)
+    index = keys & 0xffffffff
+    index = np.where(index >= 2**31, index - 2**32, index)
+    return np.stack((keys >> 32, index), axis=1)
+
+
+def _frame_from_data(data: dict) -> dict:
+    """_frame_from_data: network of export_data as node keys and positions,
+       and segments as node key pairs and burgers and plane vectors
+    """
+    nodes = _as_table(data["nodes"], ("tags", "positions", "constraints"), len(NODES_ATTR))
+    segs = _as_table(data["segs"], ("nodeids", "burgers", "planes"), len(SEGS_ATTR))
+    keys = _node_keys(nodes[:,0:2])
+    ids = segs[:,0:2].astype(int)
+    return {
+        "keys": keys,
+        "R": np.ascontiguousarray(nodes[:,2:5]),
+        "constraint": nodes[:,5].astype(np.int32),
+        "seg_keys": np.ascontiguousarray(keys[ids].reshape(-1, 2)),
+        "seg_vals": np.ascontiguousarray(segs[:,2:8]),
+    }
+
+
+def _frame_to_data(frame: dict, cell: dict) -> dict:
+    """_frame_to_data: network data in the format of import_data
+    """
+    keys = frame["keys"]
+    order = np.argsort(keys, kind='stable')
+    ids = order[np.searchsorted(keys[order], frame["seg_keys"].reshape(-1))].reshape(-1, 2)
+    return {
+        "cell": {"h": np.array(cell["h"]), "origin": np.array(cell["origin"]),
+                 "is_periodic": list(cell["is_periodic"])},
+        "nodes": {"tags": _key_tags(keys), "positions": frame["R"].copy(),
+                  "constraints": frame["constraint"].astype(int).reshape(-1, 1)},
+        "segs": {"nodeids": ids, "burgers": frame["seg_vals"][:,0:3].copy(),
+                 "planes": frame["seg_vals"][:,3:6].copy()},
+    }
+
+
+def _keyframe(arrays: dict) -> dict:
+    return {name: arrays[name] for name in ("keys", "R", "constraint", "seg_keys", "seg_vals")}
+
+
+def _apply_delta(prev: dict, arrays: dict, quantum: float) -> dict:
+    """_apply_delta: frame following prev given the arrays of a delta record
+    """
+    keep = ~np.isin(prev["keys"], arrays["removed_nodes"])
+    dR = arrays["dR"]
+    dR = dR * quantum if quantum is not None else dR
+    keys = np.concatenate((prev["keys"][keep], arrays["added_nodes"]))
+    R = np.vstack((prev["R"][keep] + dR, arrays["added_R"]))
+    constraint = np.concatenate((arrays["constraint"], arrays["added_constraint"]))
+
+    if arrays["removed_segs"].shape[0] > 0:
+        rows = {(int(k[0]), int(k[1])): i for i, k in enumerate(prev["seg_keys"])}
+        drop = np.zeros(prev["seg_keys"].shape[0], dtype=bool)
+        for k in arrays["removed_segs"]:
+            drop[rows[(int(k[0]), int(k[1]))]] = True
+        seg_keys, seg_vals = prev["seg_keys"][~drop], prev["seg_vals"][~drop]
+    else:
+        seg_keys, seg_vals = prev["seg_keys"], prev["seg_vals"]
+    seg_keys = np.vstack((seg_keys, arrays["added_segs"]))
+    seg_vals = np.vstack((seg_vals, arrays["added_seg_vals"]))
+
+    return {"keys": keys, "R": R, "constraint": constraint.astype(np.int32),
+            "seg_keys": seg_keys, "seg_vals": seg_vals}
+
+
+def _pack(header: dict, arrays: dict, level: int) -> bytes:
+    header = dict(header)
+    header["arrays"] = [{"name": name, "dtype": arr.dtype.str, "shape": list(arr.shape)}
+                        for name, arr in arrays.items()]
+    payload = zlib.compress(b''.join(np.ascontiguousarray(arr).tobytes() for arr in arrays.values()), level)
+    return json.dumps(header).encode('utf-8') + b'\n' + payload
+
+
+def _unpack(record: bytes):
+    line, payload = record.split(b'\n', 1)
+    header = json.loads(line.decode('utf-8'))
+    raw = zlib.decompress(payload) if header["arrays"] else b''
+    arrays, offset = {}, 0
+    for entry in header["arrays"]:
+        dtype, shape = np.dtype(entry["dtype"]), tuple(entry["shape"])
+        nbytes = int(np.prod(shape)) * dtype.itemsize
+        arrays[entry["name"]] = np.frombuffer(raw, dtype=dtype, count=int(np.prod(shape)), offset=offset).reshape(shape)
+        offset += nbytes
+    return header, arrays
+
+
+class TrajectoryWriter:
+    """TrajectoryWriter: append network frames to a trajectory file
+
+    keyframe_interval: a full keyframe every keyframe_interval frames
+    quantum: position quantization length of the deltas (None: float64)
+    """
+    def __init__(self, filename: str, keyframe_interval: int=50, quantum: float=None,
+                 compress_level: int=1) -> None:
+        self.filename = filename
+        self.keyframe_interval = max(int(keyframe_interval), 1)
+        self.quantum = quantum
+        self.compress_level = compress_level
+        self._file = open(filename, 'wb')
+        self._file.write(TRAJECTORY_MAGIC)
+        self._offsets, self._steps, self._types = [], [], []
+        self._prev = None
+        self._since_keyframe = 0
+
+    def _write_record(self, record: bytes) -> int:
+        offset = self._file.tell()
+        self._file.write(np.array([len(record)], dtype='<u8').tobytes())
+        self._file.write(record)
+        return offset
+
+    def append(self, step: int, data: dict) -> None:
+        """append: add the network data (as from export_data) of step
+        """
+        frame = _frame_from_data(data)
+        cell = data["cell"]
+        header = {"step": int(step), "quantum": self.quantum,
+                  "cell": {"h": np.asarray(cell["h"], dtype=np.float64).tolist(),
+                           "origin": np.asarray(cell["origin"], dtype=np.float64).tolist(),
+                           "is_periodic": [bool(p) for p in cell["is_periodic"]]}}
+
+        arrays = None
+        if self._prev is not None and self._since_keyframe < self.keyframe_interval:
+            arrays = self._delta_arrays(self._prev, frame)
+
+        if arrays is None:
+            header["type"] = "keyframe"
+            arrays = _keyframe(frame)
+            self._prev = frame
+            self._since_keyframe = 1
+        else:
+            header["type"] = "delta"
+            # continue from the frame as read back, not the exact one
+            self._prev = _apply_delta(self._prev, arrays, self.quantum)
+            self._since_keyframe += 1
+
+        self._offsets.append(self._write_record(_pack(header, arrays, self.compress_level)))
+        self._steps.append(int(step))
+        self._types.append(header["type"])
+
+    def _delta_arrays(self, prev: dict, frame: dict) -> dict:
+        """_delta_arrays: arrays of the delta record from prev to frame,
+           None if a keyframe is needed (quantized changes out of range)
+        """
+        if np.array_equal(prev["keys"], frame["keys"]):
+            kept_prev = np.ones(prev["keys"].shape[0], dtype=bool)
+            cur_index = np.arange(frame["keys"].shape[0])
+            added = np.zeros(frame["keys"].shape[0], dtype=bool)
+        else:
+            order = np.argsort(frame["keys"], kind='stable')
+            sorted_keys = frame["keys"][order]
+            pos = np.clip(np.searchsorted(sorted_keys, prev["keys"]), 0, max(len(sorted_keys)-1, 0))
+            kept_prev = (sorted_keys[pos] == prev["keys"]) if len(sorted_keys) > 0 else \
+                        np.zeros(prev["keys"].shape[0], dtype=bool)
+            cur_index = order[pos[kept_prev]]
+            added = np.ones(frame["keys"].shape[0], dtype=bool)
+            added[cur_index] = False
+
+        dR = frame["R"][cur_index] - prev["R"][kept_prev]
+        if self.quantum is not None:
+            dq = np.rint(dR / self.quantum)
+            if dq.size > 0 and np.max(np.abs(dq)) >= 2**31:
+                return None
+            dR = dq.astype(np.int32)
+
+        if np.array_equal(prev["seg_keys"], frame["seg_keys"]) and \
+           np.array_equal(prev["seg_vals"], frame["seg_vals"]):
+            removed_segs = np.zeros((0, 2), dtype=np.int64)
+            added_segs = np.zeros(frame["seg_keys"].shape[0], dtype=bool)
+        else:
+            prev_rows = {(int(k[0]), int(k[1])): tuple(v) for k, v in zip(prev["seg_keys"], prev["seg_vals"])}
+            cur_rows = {(int(k[0]), int(k[1])): tuple(v) for k, v in zip(frame["seg_keys"], frame["seg_vals"])}
+            removed_segs = np.array([k for k, v in prev_rows.items() if cur_rows.get(k) != v],
+                                    dtype=np.int64).reshape(-1, 2)
+            added_segs = np.array([prev_rows.get((int(k[0]), int(k[1]))) != tuple(v)
+                                   for k, v in zip(frame["seg_keys"], frame["seg_vals"])], dtype=bool)
+
+        return {
+            "removed_nodes": prev["keys"][~kept_prev],
+            "dR": np.ascontiguousarray(dR),
+            "constraint": frame["constraint"][cur_index],
+            "added_nodes": frame["keys"][added],
+            "added_R": frame["R"][added],
+            "added_constraint": frame["constraint"][added],
+            "removed_segs": removed_segs,
+            "added_segs": frame["seg_keys"][added_segs].reshape(-1, 2),
+            "added_seg_vals": frame["seg_vals"][added_segs].reshape(-1, 6),
+        }
+
+    def close(self) -> None:
+        """close: write the frame index and close the file
+        """
+        if self._file is None:
+            return
+        offset = self._write_record(_pack({"type": "index", "offsets": self._offsets,
+                                           "steps": self._steps,
+                                           "types": self._types}, {}, self.compress_level))
+        self._file.write(TRAJECTORY_INDEX_MAGIC)
+        self._file.write(np.array([offset], dtype='<u8').tobytes())
+        self._file.close()
+        self._file = None
+
+    def __del__(self):
+        if getattr(self, "_file", None) is not None:
+            self.close()
+
+
+class TrajectoryReader:
+    """TrajectoryReader: random access to the frames of a trajectory file
+    """
+    def __init__(self, filename: str) -> None:
+        self.filename = filename
+        with open(filename, 'rb') as f:
+            if f.read(8) != TRAJECTORY_MAGIC:
+                raise ValueError("TrajectoryReader: %s is not a trajectory file" % filename)
+            f.seek(0, 2)
+            size = f.tell()
+            index = None
+            if size >= 8 + 16:
+                f.seek(size - 16)
+                tail = f.read(16)
+                if tail[:8] == TRAJECTORY_INDEX_MAGIC:
+                    header, _ = _unpack(self._read_record(f, int(np.frombuffer(tail[8:], dtype='<u8')[0])))
+                    index = (header["offsets"], header["steps"], header["types"])
+            if index is None:
+                index = self._scan(f, size)
+        self.offsets, self.steps, self.types = list(index[0]), list(index[1]), list(index[2])
+        self._cache = None
+
+    @staticmethod
+    def _read_record(f, offset: int) -> bytes:
+        f.seek(offset)
+        length = int(np.frombuffer(f.read(8), dtype='<u8')[0])
+        return f.read(length)
+
+    def _scan(self, f, size: int):
+        """_scan: frame offsets, steps and types of a file without index
+        """
+        offsets, steps, types, offset = [], [], [], 8
+        while offset + 8 <= size:
+            f.seek(offset)
+            length = int(np.frombuffer(f.read(8), dtype='<u8')[0])
+            if offset + 8 + length > size:
+                break
+            line = f.readline()
+            header = json.loads(line.decode('utf-8'))
+            if header.get("type") not in ("keyframe", "delta"):
+                break
+            offsets.append(offset)
+            steps.append(header["step"])
+            types.append(header["type"])
+            offset += 8 + length
+        return offsets, steps, types
+
+    def __len__(self) -> int:
+        return len(self.offsets)
+
+    def _read(self, f, i: int):
+        return _unpack(self._read_record(f, self.offsets[i]))
+
+    def read_frame(self, i: int) -> dict:
+        """read_frame: network data (format of import_data) of frame i
+        """
+        if i < 0:
+            i += len(self.offsets)
+        if i < 0 or i >= len(self.offsets):
+            raise IndexError("TrajectoryReader: frame %d out of range" % i)
+        # start from the last keyframe before i, or from the frame read
+        # last if it lies in between
+        k = i
+        while self.types[k] != "keyframe" and not (self._cache is not None and self._cache[0] == k):
+            k -= 1
+        with open(self.filename, 'rb') as f:
+            if self._cache is not None and self._cache[0] == k:
+                frame, cell = self._cache[1], self._cache[2]
+            else:
+                header, arrays = self._read(f, k)
+                frame, cell = _keyframe(arrays), header["cell"]
+            for j in range(k + 1, i + 1):
+                header, arrays = self._read(f, j)
+                if header["type"] == "keyframe":
+                    frame = _keyframe(arrays)
+                else:
+                    frame = _apply_delta(frame, arrays, header["quantum"])
+                cell = header["cell"]
+        self._cache = (i, frame, cell)
+        return _frame_to_data(frame, cell)
+
+    def read_step(self, step: int) -> dict:
+        """read_step: network data of the frame recorded at step
+        """
+        if step not in self.steps:
+            raise ValueError("TrajectoryReader: step %d not recorded" % step)
+        return self.read_frame(self.steps.index(step))
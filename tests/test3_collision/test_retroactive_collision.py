@@ -0,0 +1,78 @@
+import numpy as np
+import sys, os
+
+pydis_paths = ['../../python', '../../lib', '../../core/pydis/python']
+[sys.path.append(os.path.abspath(path)) for path in pydis_paths if not path in sys.path]
+np.set_printoptions(threshold=20, edgeitems=5)
+
+from framework.disnet_manager import DisNetManager
+from pydis import DisNode, DisNet, Cell, CellList
+from pydis import TimeIntegration, Collision
+
+def init_crossing_segments(box_length=100.0):
+    '''Two perpendicular segments with pinned end nodes, segment 2-3 at
+       z = 0 and segment 0-1 at z = 1 above it
+    '''
+    cell = Cell(h=box_length*np.eye(3), is_periodic=[False,False,False])
+    rn    = np.array([[-1.0,  0.0, 1.0, DisNode.Constraints.PINNED_NODE],
+                      [ 1.0,  0.0, 1.0, DisNode.Constraints.PINNED_NODE],
+                      [ 0.0, -1.0, 0.0, DisNode.Constraints.PINNED_NODE],
+                      [ 0.0,  1.0, 0.0, DisNode.Constraints.PINNED_NODE]])
+    rn[:,0:3] += cell.center()
+    links = np.array([[0, 1, 1.0, 0.0, 0.0, 0.0, 0.0, 1.0],
+                      [2, 3, 0.0, 1.0, 0.0, 0.0, 0.0, 1.0]])
+    return DisNetManager(DisNet(cell=cell, rn=rn, links=links))
+
+def step_and_collide(collision_mode, two_phase=False, dt=1.0e-8):
+    '''Move segment 0-1 from z = 1 to z = -1 in one forward Euler step,
+       crossing segment 2-3 half way through the step, then handle the
+       collisions. Returns the network and the state.
+    '''
+    net = init_crossing_segments()
+    G = net.get_disnet(DisNet)
+    state = {"rann": 0.1}
+    state["nodeflag_dict"] = {tag: DisNode.Flags.CLEAR for tag in G.all_nodes_tags()}
+    state["applied_stress"] = np.zeros(6)
+    vel = np.array([0.0, 0.0, -2.0/dt])
+    state["vel_dict"] = {(0, 0): vel, (0, 1): vel, (0, 2): np.zeros(3), (0, 3): np.zeros(3)}
+
+    timeint   = TimeIntegration(integrator='EulerForward', dt=dt, state=state)
+    nbrlist   = CellList(cell=G.cell, n_div=[4,4,4])
+    collision = Collision(collision_mode=collision_mode, state=state, nbrlist=nbrlist, two_phase=two_phase)
+
+    state = timeint.Update(net, state)
+    state = collision.HandleCol(net, state)
+    return G, state
+
+def main():
+    G, state = step_and_collide('Retroactive')
+    oldpos_dict = state.get("oldpos_dict", {})
+    has_oldpos = len(oldpos_dict) == 4 and np.isclose(oldpos_dict[(0, 0)][2] - G.cell.center()[2], 1.0)
+    print("oldpos_dict recorded: %s" % has_oldpos)
+
+    # the segments crossed during the step and are joined at a new node
+    crossed = G.num_nodes() == 5 and G.is_sane()
+    print("Retroactive: num_nodes = %d (expected 5)" % G.num_nodes())
+
+    G, state = step_and_collide('Retroactive', two_phase=True)
+    crossed_two_phase = G.num_nodes() == 5 and G.is_sane()
+    print("Retroactive (two phase): num_nodes = %d (expected 5)" % G.num_nodes())
+
+    # at the end positions the segments are too far apart for the proximity criterion
+    G, state = step_and_collide('Proximity')
+    missed_proximity = G.num_nodes() == 4
+    print("Proximity: num_nodes = %d (expected 4)" % G.num_nodes())
+
+    return has_oldpos and crossed and crossed_two_phase and missed_proximity
+
+
+if __name__ == "__main__":
+    collision_detected = main()
+    print("collision_detected = %s" % collision_detected)
+
+    if collision_detected:
+        print("test" + '\033[32m' + " PASSED" + '\033[0m')
+    else:
+        print("test" + '\033[31m' + " FAILED" + '\033[0m')
+
+    exit(0 if collision_detected else 1)